@@ -48,6 +48,11 @@
 // I2C power for talking to RTC
 #define BW_SW_POWER_EN   (41)
 
+// Analog sensing, GPIO40 onwards are ADC0-7
+#define BW_VBAT_SENSE    (40) // Half the battery voltage
+#define BW_SENSE_1V1     (42) // 1.1V reference, for calibrating VBAT_SENSE
+#define BW_LIGHT_SENSE   (43)
+
 // Interrupt channels for GPIO wakeup
 #define BW_VBUS_DETECT   (12) // No pull, active high?
 #define BW_RTC_ALARM     (13) // Pull up, active low
@@ -0,0 +1,228 @@
+APP_DIR = "/system/apps/benchmark"
+
+import os
+import sys
+
+# Standalone bootstrap for finding app assets
+os.chdir(APP_DIR)
+
+# Standalone bootstrap for module imports
+sys.path.insert(0, APP_DIR)
+
+from badgeware import run
+import gc
+import random
+import time
+
+# every measurement repeats its test for this long, longer is steadier
+DURATION_MS = 500
+
+# results from every run are appended here, one row per measurement, so
+# firmware builds can be compared side by side
+RESULTS = "/benchmark.csv"
+
+# the same seed for every test gives every build the same shapes to draw
+SEED = 2350
+
+AA_LEVELS = (
+    ("off", image.OFF),
+    ("x2", image.X2),
+    ("x4", image.X4),
+    ("analytic", image.ANALYTIC),
+)
+
+BUILD = os.uname().version
+
+mode(LORES)
+screen.antialias = image.OFF
+sins = rom_font.sins
+vector_font = font.load("/system/assets/fonts/MonaSans-Medium.af")
+
+results = []
+
+
+def report(test, target, variant, value, unit):
+    results.append((test, target, variant, value, unit))
+    print(f"{test:10} {target:12} {variant:9} {value:10.2f} {unit}")
+
+
+# calls fn until DURATION_MS is up, returns the calls made, the time they
+# took in us and picovector's profile of them
+def measure(fn):
+    gc.collect()
+    profile(True)
+    n = 0
+    start = time.ticks_us()
+    elapsed = 0
+    while elapsed < DURATION_MS * 1000:
+        fn()
+        n += 1
+        elapsed = time.ticks_diff(time.ticks_us(), start)
+    return n, elapsed, profile()
+
+
+def mpixels(stats, point, elapsed):
+    return stats[point][1] / elapsed
+
+
+def make_targets():
+    # lores only lands in sram on builds with a PV_SRAM_POOL_SIZE big enough
+    # for it, otherwise every target is on the psram heap
+    return (
+        ("lores_sram", image(160, 120, memory=image.SRAM)),
+        ("lores_psram", image(160, 120, memory=image.PSRAM)),
+        ("hires_psram", image(320, 240, memory=image.PSRAM)),
+    )
+
+
+def make_shapes(w, h):
+    random.seed(SEED)
+    shapes = []
+    for i in range(32):
+        x, y = random.uniform(0, w), random.uniform(0, h)
+        r = random.uniform(4, h / 4)
+        kind = i % 4
+        if kind == 0:
+            shapes.append(shape.circle(x, y, r))
+        elif kind == 1:
+            shapes.append(shape.star(x, y, 5, r, r / 2))
+        elif kind == 2:
+            shapes.append(shape.rounded_rectangle(x - r, y - r, r * 2, r, r / 4, r / 4, r / 4, r / 4))
+        else:
+            shapes.append(shape.regular_polygon(x, y, r, 6).stroke(2))
+    return shapes
+
+
+def bench_shapes(name, target):
+    shapes = make_shapes(target.width, target.height)
+    pens = [color.rgb(random.randint(0, 255), random.randint(0, 255), random.randint(0, 255), 200) for _ in shapes]
+
+    def draw():
+        for s, p in zip(shapes, pens):
+            target.pen = p
+            target.shape(s)
+
+    for aa_name, aa in AA_LEVELS:
+        target.antialias = aa
+        n, elapsed, stats = measure(draw)
+        report("shapes", name, aa_name, n * len(shapes) * 1000000 / elapsed, "shapes/s")
+        report("shapes", name, aa_name, mpixels(stats, "render", elapsed), "Mpixels/s")
+    target.antialias = image.OFF
+
+
+TEXT = "The quick brown fox jumps over the lazy dog"
+
+
+def bench_text(name, target):
+    target.pen = color.rgb(255, 255, 255)
+
+    target.font = sins
+    n, elapsed, stats = measure(lambda: target.text(TEXT, 0, 0))
+    report("text", name, "pixel", n * len(TEXT) * 1000000 / elapsed, "glyphs/s")
+
+    target.font = vector_font
+    for aa_name, aa in AA_LEVELS:
+        target.antialias = aa
+        n, elapsed, stats = measure(lambda: target.text(TEXT, 0, 0, 16))
+        report("text", name, "vec_" + aa_name, n * len(TEXT) * 1000000 / elapsed, "glyphs/s")
+        report("text", name, "vec_" + aa_name, mpixels(stats, "glyph", elapsed), "Mpixels/s")
+    target.antialias = image.OFF
+
+
+def bench_blits(name, target):
+    random.seed(SEED)
+    points = [vec2(random.randint(-16, target.width - 16), random.randint(-16, target.height - 16)) for _ in range(16)]
+
+    for variant, alpha in (("opaque", 255), ("alpha", 128)):
+        sprite = image(32, 32)
+        sprite.pen = color.rgb(200, 100, 50, alpha)
+        sprite.clear()
+
+        def draw():
+            for p in points:
+                target.blit(sprite, p)
+
+        n, elapsed, stats = measure(draw)
+        report("blit", name, variant, n * len(points) * 1000000 / elapsed, "blits/s")
+        report("blit", name, variant, mpixels(stats, "blit", elapsed), "Mpixels/s")
+
+
+def bench_filters(name, target):
+    target.pen = color.rgb(100, 150, 200)
+    target.clear()
+    for variant, fn in (("blur", lambda: target.blur(2)), ("dither", target.dither), ("monochrome", target.monochrome)):
+        n, elapsed, stats = measure(fn)
+        report("filter", name, variant, elapsed / n / 1000, "ms")
+        report("filter", name, variant, mpixels(stats, "filter", elapsed), "Mpixels/s")
+
+
+def bench_clear(name, target):
+    target.pen = color.rgb(20, 40, 60)
+    n, elapsed, stats = measure(target.clear)
+    report("clear", name, "-", mpixels(stats, "clear", elapsed), "Mpixels/s")
+
+
+def bench_png():
+    n, elapsed, stats = measure(lambda: image.load("/system/assets/skull.png"))
+    report("png", "-", "skull", elapsed / n / 1000, "ms")
+
+
+def bench_present():
+    for variant, m in (("lores", LORES), ("hires", HIRES)):
+        mode(m)
+        n, elapsed, stats = measure(lambda: present(True))
+        report("present", "-", variant, elapsed / n / 1000, "ms")
+    mode(LORES)
+
+
+def save():
+    # flash writes stall psram, as in State.save()
+    display.wait()
+    new = not file_exists(RESULTS)
+    with open(RESULTS, "a") as f:
+        if new:
+            f.write("build,test,target,variant,value,unit\n")
+        for test, target, variant, value, unit in results:
+            f.write(f"{BUILD},{test},{target},{variant},{value:.3f},{unit}\n")
+
+
+def benchmarks():
+    for name, target in make_targets():
+        for bench in (bench_shapes, bench_text, bench_blits, bench_filters, bench_clear):
+            yield f"{bench.__name__[6:]} {name}"
+            bench(name, target)
+        del target
+        gc.collect()
+    yield "png"
+    bench_png()
+    yield "present"
+    bench_present()
+    save()
+
+
+steps = benchmarks()
+status = "starting"
+finished = False
+
+
+def update():
+    global status, finished
+
+    screen.font = sins
+    screen.pen = color.rgb(255, 255, 255)
+    screen.text("picovector benchmark", 2, 2)
+
+    if not finished:
+        screen.text(f"running {status}", 2, 14)
+        try:
+            # each step's label is shown before it runs
+            status = next(steps)
+        except StopIteration:
+            finished = True
+    else:
+        screen.text(f"{len(results)} results", 2, 14)
+        screen.text(f"saved to {RESULTS}", 2, 26)
+
+
+if __name__ == "__main__":
+    run(update)
@@ -0,0 +1,24 @@
+import math
+
+sky = brush.linear_gradient(vec2(0, 0), vec2(0, 120), (
+  color.rgb(20, 20, 60),
+  color.rgb(120, 60, 140),
+  color.rgb(255, 160, 80)))
+
+def update():
+  screen.pen = sky
+  screen.clear()
+
+  x = 80 + math.cos(io.ticks / 1000) * 40
+  y = 60 + math.sin(io.ticks / 700) * 20
+  glow = brush.radial_gradient(vec2(x, y), 30, (
+    (0.0, color.rgb(255, 255, 200)),
+    (0.4, color.rgb(255, 200, 80, 200)),
+    (1.0, color.rgb(255, 120, 40, 0))), brush.NONE)
+  screen.pen = glow
+  screen.shape(shape.circle(x, y, 30))
+
+  screen.pen = brush.linear_gradient(vec2(0, 0), vec2(8, 8), (
+    color.rgb(255, 255, 255, 120),
+    color.rgb(255, 255, 255, 0)), brush.MIRROR)
+  screen.shape(shape.rectangle(10, 90, 140, 20))
@@ -0,0 +1,43 @@
+import math
+import time
+
+# draws the same shapes with both rasterisers on alternate frames and shows
+# the average time each takes
+
+names = {image.FLOAT: "float", image.FIXED: "fixed"}
+totals = {image.FLOAT: 0, image.FIXED: 0}
+frames = {image.FLOAT: 0, image.FIXED: 0}
+engine = image.FLOAT
+
+
+def update():
+  global engine
+
+  screen.antialias = image.X4
+  screen.rasteriser = engine
+
+  shapes = [
+    shape.circle(0, 0, 1),
+    shape.star(0, 0, 7, 0.4, 1),
+    shape.squircle(0, 0, 1).stroke(0.2),
+    shape.regular_polygon(0, 0, 1, 6),
+  ]
+
+  start = time.ticks_us()
+  for i in range(24):
+    s = shapes[i % len(shapes)]
+    screen.pen = color.oklch(220, 128, i * 15, 150)
+    s.transform = mat3().translate(20 + (i % 6) * 24, 20 + (i // 6) * 22).rotate(io.ticks / 20 + i * 15).scale(10 + math.sin(io.ticks / 500 + i) * 3)
+    screen.shape(s)
+  totals[engine] += time.ticks_diff(time.ticks_us(), start)
+  frames[engine] += 1
+
+  screen.rasteriser = image.FLOAT
+  screen.pen = color.rgb(255, 255, 255)
+  y = 95
+  for e in (image.FLOAT, image.FIXED):
+    if frames[e]:
+      screen.text(f"{names[e]}: {totals[e] // frames[e]}us", 5, y)
+    y += 10
+
+  engine = image.FIXED if engine == image.FLOAT else image.FLOAT
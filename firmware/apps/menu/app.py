@@ -1,6 +1,6 @@
 import os
 import math
-from badgeware import is_dir, file_exists
+from badgeware import is_dir, file_exists, IconAtlas
 
 import ui
 
@@ -116,12 +116,17 @@ class Apps:
                 return word
             return word[0].upper() + word[1:]
 
+        paths = []
         for path in sorted(os.listdir(root)):
-            name = " ".join([capitalize(word) for word in path.split("_")])
-
             if is_dir(f"{root}/{path}"):
                 if file_exists(f"{root}/{path}/icon.png"):
-                    App(self.apps, name, path, image.load(f"{root}/{path}/icon.png"))
+                    paths.append(path)
+
+        # every icon comes out of one atlas image, cached between launches
+        atlas = IconAtlas(root, paths)
+        for path in paths:
+            name = " ".join([capitalize(word) for word in path.split("_")])
+            App(self.apps, name, path, atlas.icon(path))
 
     @property
     def active(self):
@@ -12,11 +12,12 @@ os.chdir(APP_DIR)
 sys.path.insert(0, APP_DIR)
 
 import math
+import struct
 
 from badgeware import run, fatal_error
 from breakout_bme280 import BreakoutBME280
 from breakout_ltr559 import BreakoutLTR559
-from lsm6ds3 import LSM6DS3, NORMAL_MODE_104HZ
+from lsm6ds3 import LSM6DS3, NORMAL_MODE_104HZ, FIFO_SAMPLE_BYTES
 from machine import I2C
 
 BACKGROUND = brush.pattern(color.rgb(255, 255, 255), color.rgb(188, 211, 224), 26)
@@ -29,6 +30,7 @@ screen.antialias = image.X2
 
 try:
     motion_sensor = LSM6DS3(I2C(), mode=NORMAL_MODE_104HZ)
+    motion_sensor.fifo_start()
     temperature_sensor = BreakoutBME280(I2C())
     light_sensor = BreakoutLTR559(I2C())
 except OSError:
@@ -161,24 +163,30 @@ def draw_motion(_wx, wy, ww, wh):
     # clamp radius to window bounds
     radius = (min(ww, wh) / 2) * 0.5
 
-    ax, ay, az, _, _, _ = motion_sensor.get_readings()
-
-    # convert 16bit motion into Gs
-    ax /= 16384
-    ay /= 16384
-    az /= 16384
-
-    # clamp to between -1G and 1G
-    magnitude = math.sqrt(ax ** 2 + ay ** 2 + az ** 2)
-    if magnitude > 1:
-        ax /= magnitude
-        ay /= magnitude
-        az /= magnitude
-
-    # add to motion sample buffer
-    motion_samples.append((ax, ay, az))
+    # every reading the sensor queued since the last frame
+    readings = motion_sensor.read_fifo()
+    for i in range(0, len(readings), FIFO_SAMPLE_BYTES):
+        _, _, _, ax, ay, az = struct.unpack_from("<6h", readings, i)
+
+        # convert 16bit motion into Gs
+        ax /= 16384
+        ay /= 16384
+        az /= 16384
+
+        # clamp to between -1G and 1G
+        magnitude = math.sqrt(ax ** 2 + ay ** 2 + az ** 2)
+        if magnitude > 1:
+            ax /= magnitude
+            ay /= magnitude
+            az /= magnitude
+
+        # add to motion sample buffer
+        motion_samples.append((ax, ay, az))
     motion_samples = motion_samples[-20:]
 
+    if not motion_samples:
+        return
+
     x, y, z = 0, 0, 0
 
     for sample in motion_samples:
@@ -3,6 +3,8 @@
 
 namespace picovector {
 
+  class image_t;
+
   bool clip_line(vec2_t &p1, vec2_t &p2, const rect_t r);
 
 
@@ -11,4 +13,12 @@ namespace picovector {
 
   //typedef bool (*dda_callback_t)(float, float, int, int, int, float, float);
   void dda(vec2_t p, vec2_t v, dda_callback_t cb);
-}
\ No newline at end of file
+
+  // renders a grid world into the target's clip one column each. map holds
+  // map_w by map_h cells where zero is open floor and any other value is a
+  // wall textured with square tile value - 1 of the textures atlas. pos is
+  // in map cells, angle and fov in degrees. walls fade to black at
+  // shade_distance cells unless it's zero, and the distance to the wall in
+  // each column is written to depth when it's given
+  void raycast(image_t *target, image_t *textures, int tex_size, const uint8_t *map, int map_w, int map_h, vec2_t pos, float angle, float fov, float shade_distance, float *depth);
+}
@@ -0,0 +1,109 @@
+#include <math.h>
+#include <float.h>
+#include <algorithm>
+
+#include "algorithms.hpp"
+#include "../image.hpp"
+#include "../blit.hpp"
+
+using std::min, std::max;
+
+namespace picovector {
+
+  // the rays are spread across a camera plane rather than by angle so
+  // walls come out straight, the distance used is measured along the view
+  // direction for the same reason
+  void raycast(image_t *target, image_t *textures, int tex_size, const uint8_t *map, int map_w, int map_h, vec2_t pos, float angle, float fov, float shade_distance, float *depth) {
+    rect_t c = target->clip().intersection(target->bounds());
+    int cx1 = c.x, cy1 = c.y, cw = c.w, ch = c.h;
+    if(cw <= 0 || ch <= 0 || tex_size <= 0) return;
+
+    rect_t tb = textures->bounds();
+    int across = tb.w / tex_size;
+    int tex_count = across * int(tb.h / tex_size);
+    if(!tex_count) return;
+
+    float a = angle * float(M_PI / 180.0);
+    float half_fov = tanf(fov * float(M_PI / 360.0));
+    vec2_t dir(cosf(a), sinf(a));
+    vec2_t plane(-dir.y * half_fov, dir.x * half_fov);
+
+    // screen height of a wall one cell tall at a distance of one cell
+    float proj = (cw / 2.0f) / half_fov;
+    float horizon = cy1 + ch / 2.0f;
+
+    tex_column_t fn = tex_column(textures, target);
+    blend_func_t bf = target->_blend_func;
+    fx16_t v_max = (fx16_t(tex_size) << 16) - 1;
+
+    for(int x = 0; x < cw; x++) {
+      float cam = 2.0f * (float(x) + 0.5f) / float(cw) - 1.0f;
+      vec2_t ray(dir.x + plane.x * cam, dir.y + plane.y * cam);
+
+      int mx = floorf(pos.x), my = floorf(pos.y);
+      float delta_x = ray.x == 0.0f ? FLT_MAX : fabsf(1.0f / ray.x);
+      float delta_y = ray.y == 0.0f ? FLT_MAX : fabsf(1.0f / ray.y);
+      int step_x = ray.x < 0.0f ? -1 : 1;
+      int step_y = ray.y < 0.0f ? -1 : 1;
+      float side_x = (ray.x < 0.0f ? pos.x - mx : mx + 1.0f - pos.x) * delta_x;
+      float side_y = (ray.y < 0.0f ? pos.y - my : my + 1.0f - pos.y) * delta_y;
+
+      // walk the grid until a wall is hit or the ray leaves the map
+      int cell = 0, side = 0;
+      for(int steps = 0; steps < map_w + map_h; steps++) {
+        if(side_x < side_y) {
+          side_x += delta_x; mx += step_x; side = 0;
+        }else{
+          side_y += delta_y; my += step_y; side = 1;
+        }
+        if(mx < 0 || my < 0 || mx >= map_w || my >= map_h) break;
+        if((cell = map[my * map_w + mx])) break;
+      }
+
+      if(!cell) {
+        if(depth) depth[x] = FLT_MAX;
+        continue;
+      }
+
+      float dist = side == 0 ? side_x - delta_x : side_y - delta_y;
+      dist = max(dist, 1e-4f);
+      if(depth) depth[x] = dist;
+
+      // where across the wall face the ray landed, mirrored so textures
+      // read the same way round on every face
+      float wall = side == 0 ? pos.y + dist * ray.y : pos.x + dist * ray.x;
+      int u = int((wall - floorf(wall)) * tex_size);
+      u = min(u, tex_size - 1);
+      if((side == 0 && ray.x < 0.0f) || (side == 1 && ray.y > 0.0f)) {
+        u = tex_size - 1 - u;
+      }
+
+      float height = proj / dist;
+      float top = horizon - height / 2.0f;
+      int y1 = max(cy1, int(ceilf(top - 0.5f)));
+      int y2 = min(cy1 + ch, int(ceilf(top + height - 0.5f)));
+      if(y1 >= y2) continue;
+
+      // texture rows sampled at pixel centres, the step is trimmed if
+      // rounding would carry the last pixel past the bottom of the tile
+      float scale = tex_size / height;
+      fx16_t v = max(0.0f, (float(y1) + 0.5f - top) * scale) * 65536.0f;
+      fx16_t v_step = scale * 65536.0f;
+      int n = y2 - y1;
+      if(n > 1 && v + int64_t(v_step) * (n - 1) > v_max) {
+        v_step = (v_max - min(v, v_max)) / (n - 1);
+      }
+      v = min(v, v_max);
+
+      uint32_t shade = 256;
+      if(shade_distance > 0.0f) {
+        shade = uint32_t(max(0.0f, 1.0f - dist / shade_distance) * 256.0f);
+      }
+
+      int t = (cell - 1) % tex_count;
+      int tx = tb.x + (t % across) * tex_size, ty = tb.y + (t / across) * tex_size;
+      fn(textures, target, bf, fx16_t(tx + u) << 16, 0, (fx16_t(ty) << 16) + v, v_step, cx1 + x, y1, n, shade);
+    }
+  }
+
+}
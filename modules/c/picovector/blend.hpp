@@ -28,6 +28,39 @@ uint32_t _premul_mul_alpha_channel(uint32_t c, uint32_t a) {
   return (c * a + 128) >> 8;
 }
 
+// rgb565 is stored in native (little endian) byte order, alpha is implied 255
+static inline __attribute__((always_inline))
+uint32_t _rgb565_to_rgba8888(const uint16_t c) {
+  uint32_t r = (c >> 11) & 0x1fu;
+  uint32_t g = (c >>  5) & 0x3fu;
+  uint32_t b =  c        & 0x1fu;
+  r = (r << 3) | (r >> 2);
+  g = (g << 2) | (g >> 4);
+  b = (b << 3) | (b >> 2);
+  return r | (g << 8) | (b << 16) | 0xff000000u;
+}
+
+static inline __attribute__((always_inline))
+uint16_t _rgba8888_to_rgb565(const uint32_t c) {
+  return ((c & 0xf8u) << 8) | ((c & 0xfc00u) >> 5) | ((c & 0xf80000u) >> 19);
+}
+
+// rgba4444 holds red in the top nibble down to alpha in the bottom one, in
+// native byte order, and like rgba8888 is premultiplied
+static inline __attribute__((always_inline))
+uint32_t _rgba4444_to_rgba8888(const uint16_t c) {
+  uint32_t r = (c >> 12) & 0xfu;
+  uint32_t g = (c >>  8) & 0xfu;
+  uint32_t b = (c >>  4) & 0xfu;
+  uint32_t a =  c        & 0xfu;
+  return (r | (g << 8) | (b << 16) | (a << 24)) * 17u;
+}
+
+static inline __attribute__((always_inline))
+uint16_t _rgba8888_to_rgba4444(const uint32_t c) {
+  return ((c & 0xf0u) << 8) | ((c & 0xf000u) >> 4) | ((c & 0xf00000u) >> 16) | (c >> 28);
+}
+
 typedef uint32_t (*blend_func_t)(uint32_t dst, uint32_t r, uint32_t g, uint32_t b, uint32_t a);
 
 static inline uint32_t blend_func_over(uint32_t dst, uint32_t r, uint32_t g, uint32_t b, uint32_t a) {
@@ -49,6 +82,14 @@ static inline uint32_t blend_func_over(uint32_t dst, uint32_t r, uint32_t g, uin
     return r | (g << 8) | (b << 16) | (a << 24);
 }
 
+// blends through fn, or with source over inlined when OVER is set. span
+// functions test the target's blend mode once per span and run an OVER
+// instantiation when they can
+template<bool OVER> static inline __attribute__((always_inline))
+uint32_t _blend(blend_func_t fn, uint32_t dst, uint32_t r, uint32_t g, uint32_t b, uint32_t a) {
+  return OVER ? blend_func_over(dst, r, g, b, a) : fn(dst, r, g, b, a);
+}
+
 // // blends one rgba source pixel over a horizontal span of destination pixels
 // static inline __attribute__((always_inline))
 // void span_blend_rgba_rgba(uint8_t *dst, uint8_t *src, uint32_t w) {
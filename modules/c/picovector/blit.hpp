@@ -1,73 +1,388 @@
 #pragma once
 
 #include <stdint.h>
+#include <string.h>
 
 #include "image.hpp"
 
 namespace picovector {
 
+  // pixel load/store for the supported storage formats, everything is blended
+  // as rgba8888
+  static inline __attribute__((always_inline))
+  uint32_t _load_pixel(const uint32_t *p) {return *p;}
+  static inline __attribute__((always_inline))
+  uint32_t _load_pixel(const uint16_t *p) {return _rgb565_to_rgba8888(*p);}
+  static inline __attribute__((always_inline))
+  void _store_pixel(uint32_t *p, uint32_t c) {*p = c;}
+  static inline __attribute__((always_inline))
+  void _store_pixel(uint16_t *p, uint32_t c) {*p = _rgba8888_to_rgb565(c);}
+
+  // rgba4444 is also 16 bits a pixel so gets its own storage type to tell it
+  // apart from rgb565 in the kernel templates
+  struct rgba4444_t {
+    uint16_t v;
+  };
+  static inline __attribute__((always_inline))
+  uint32_t _load_pixel(const rgba4444_t *p) {return _rgba4444_to_rgba8888(p->v);}
+  static inline __attribute__((always_inline))
+  void _store_pixel(rgba4444_t *p, uint32_t c) {p->v = _rgba8888_to_rgba4444(c);}
+
+  // a8 coverage is premultiplied white, only alpha is kept when stored
+  struct a8_t {
+    uint8_t v;
+  };
+  static inline __attribute__((always_inline))
+  uint32_t _load_pixel(const a8_t *p) {return p->v * 0x01010101u;}
+  static inline __attribute__((always_inline))
+  void _store_pixel(a8_t *p, uint32_t c) {p->v = _a(c);}
+
+  // solid runs for opaque fills, unrolled and for rgb565 written two pixels
+  // to a 32-bit store once the pointer is word aligned
+  static inline void _fill_pixels(uint32_t *p, uint32_t c, int w) {
+    while(w >= 4) {
+      p[0] = c; p[1] = c; p[2] = c; p[3] = c;
+      p += 4; w -= 4;
+    }
+    while(w-- > 0) *p++ = c;
+  }
+
+  static inline void _fill_pixels16(uint16_t *p, uint16_t c16, int w) {
+    if((uintptr_t(p) & 2) && w > 0) {
+      *p++ = c16; w--;
+    }
+    uint32_t c32 = c16 | (uint32_t(c16) << 16);
+    uint32_t *p32 = (uint32_t *)p;
+    while(w >= 8) {
+      p32[0] = c32; p32[1] = c32; p32[2] = c32; p32[3] = c32;
+      p32 += 4; w -= 8;
+    }
+    while(w >= 2) {
+      *p32++ = c32; w -= 2;
+    }
+    if(w > 0) *(uint16_t *)p32 = c16;
+  }
+
+  static inline void _fill_pixels(uint16_t *p, uint32_t c, int w) {
+    _fill_pixels16(p, _rgba8888_to_rgb565(c), w);
+  }
+
+  // texel fetch and blended store shared by the blit and column kernels,
+  // indexed images are read through their palette and written as the
+  // nearest entry
+  template<typename S> static inline __attribute__((always_inline))
+  uint32_t _fetch_texel(const S *p, const palette_t &palette) {return _load_pixel(p);}
+  template<> inline __attribute__((always_inline))
+  uint32_t _fetch_texel(const uint8_t *p, const palette_t &palette) {return palette[*p];}
+
+  template<typename D> static inline __attribute__((always_inline))
+  void _blend_texel(image_t *dst, D *p, blend_func_t bf, uint32_t c) {
+    _store_pixel(p, bf(_load_pixel(p), _r(c), _g(c), _b(c), _a(c)));
+  }
+  template<> inline __attribute__((always_inline))
+  void _blend_texel(image_t *dst, uint8_t *p, blend_func_t bf, uint32_t c) {
+    if(_a(c)) {
+      *p = dst->palette_index(bf(dst->palette()[*p], _r(c), _g(c), _b(c), _a(c)));
+    }
+  }
+
+  // as _blend_texel() but OVER kernels inline the source over blend, so
+  // transparent pixels are skipped and opaque ones stored without reading
+  // the target back
+  template<bool OVER, typename D> static inline __attribute__((always_inline))
+  void _blit_texel(image_t *dst, D *p, blend_func_t bf, uint32_t c) {
+    if(!OVER) {
+      _blend_texel(dst, p, bf, c);
+    }else if(_a(c) == 255) {
+      _store_pixel(p, c);
+    }else if(_a(c)) {
+      _store_pixel(p, blend_func_over(_load_pixel(p), _r(c), _g(c), _b(c), _a(c)));
+    }
+  }
+  template<bool OVER> static inline __attribute__((always_inline))
+  void _blit_texel(image_t *dst, uint8_t *p, blend_func_t bf, uint32_t c) {
+    if(!OVER) {
+      _blend_texel(dst, p, bf, c);
+    }else if(_a(c) == 255) {
+      *p = dst->palette_index(c);
+    }else if(_a(c)) {
+      *p = dst->palette_index(blend_func_over(dst->palette()[*p], _r(c), _g(c), _b(c), _a(c)));
+    }
+  }
+
+  /*
+    row kernels, specialised on the source and target storage (S and D are
+    uint32_t for rgba8888, uint16_t for rgb565 and uint8_t for indexed), on
+    whether the source alpha fades every pixel (FADE) and on whether the
+    target blends source over (OVER) so the blend can be inlined
+
+    plain kernels read w pixels from (sx, sy) walking STEP pixels at a time,
+    -1 for mirrored rows. scaled kernels read row sy >> 16 from sx by
+    sx_step, both in 16.16 fixed point
+  */
+  template<typename S, typename D, bool FADE, bool OVER, int STEP = 1>
   void span_blit(image_t *src, image_t *dst, blend_func_t bf, int sx, int sy, int dx, int dy, int w) {
-    uint32_t *ps = (uint32_t *)src->ptr(sx, sy);
-    uint32_t *pd = (uint32_t *)dst->ptr(dx, dy);
+    const S *ps = (const S *)src->ptr(sx, sy);
+    D *pd = (D *)dst->ptr(dx, dy);
+    const palette_t &palette = src->palette();
     uint32_t src_alpha = src->alpha();
 
     while(w--) {
-      uint32_t c = *ps;
-      if(src->alpha() != 255) {
-        c = _premul_mul_alpha(c, src->alpha());
+      uint32_t c = _fetch_texel(ps, palette);
+      if(FADE) {
+        c = _premul_mul_alpha(c, src_alpha);
       }
-      *pd = bf(*pd, _r(c), _g(c), _b(c), _a(c));
+      _blit_texel<OVER>(dst, pd, bf, c);
       pd++;
-      ps++;
+      ps += STEP;
     }
   }
 
-  void span_blit(image_t *src, image_t *dst, blend_func_t bf, int sx, int sy, int dx, int dy, int w, palette_t palette) {
-    uint8_t *ps = (uint8_t *)src->ptr(sx, sy);
-    uint32_t *pd = (uint32_t *)dst->ptr(dx, dy);
+  template<typename S, typename D, bool FADE, bool OVER>
+  void span_blit_scale(image_t *src, image_t *dst, blend_func_t bf, fx16_t sx, fx16_t sx_step, fx16_t sy, int dx, int dy, int w) {
+    const S *ps = (const S *)src->ptr(0, sy >> 16);
+    D *pd = (D *)dst->ptr(dx, dy);
+    const palette_t &palette = src->palette();
     uint32_t src_alpha = src->alpha();
 
+    while(w--) {
+      uint32_t c = _fetch_texel(ps + (sx >> 16), palette);
+      if(FADE) {
+        c = _premul_mul_alpha(c, src_alpha);
+      }
+      _blit_texel<OVER>(dst, pd, bf, c);
+      pd++;
+      sx += sx_step;
+    }
+  }
+
+  // opaque sources drawn over a target with the same storage are copied a
+  // row at a time
+  template<typename T>
+  void span_copy(image_t *src, image_t *dst, blend_func_t bf, int sx, int sy, int dx, int dy, int w) {
+    memcpy(dst->ptr(dx, dy), src->ptr(sx, sy), w * sizeof(T));
+  }
+
+  // opaque sources drawn over a direct colour target of another format are
+  // converted without blending, with KEY set transparent pixels are skipped
+  // and everything else stored as is (for BINARY_ALPHA sources)
+  template<typename S, typename D, bool KEY, int STEP = 1>
+  void span_convert(image_t *src, image_t *dst, blend_func_t bf, int sx, int sy, int dx, int dy, int w) {
+    const S *ps = (const S *)src->ptr(sx, sy);
+    D *pd = (D *)dst->ptr(dx, dy);
+    const palette_t &palette = src->palette();
+
+    while(w--) {
+      uint32_t c = _fetch_texel(ps, palette);
+      if(!KEY || _a(c)) {
+        _store_pixel(pd, c);
+      }
+      pd++;
+      ps += STEP;
+    }
+  }
+
+  template<typename S, typename D, bool KEY>
+  void span_convert_scale(image_t *src, image_t *dst, blend_func_t bf, fx16_t sx, fx16_t sx_step, fx16_t sy, int dx, int dy, int w) {
+    const S *ps = (const S *)src->ptr(0, sy >> 16);
+    D *pd = (D *)dst->ptr(dx, dy);
+    const palette_t &palette = src->palette();
+
+    while(w--) {
+      uint32_t c = _fetch_texel(ps + (sx >> 16), palette);
+      if(!KEY || _a(c)) {
+        _store_pixel(pd, c);
+      }
+      pd++;
+      sx += sx_step;
+    }
+  }
+
+  // indexed images sharing a palette, opaque indices are copied across and
+  // everything else is blended and matched to the nearest entry
+  template<int STEP = 1>
+  void span_blit_shared(image_t *src, image_t *dst, blend_func_t bf, int sx, int sy, int dx, int dy, int w) {
+    const uint8_t *ps = (const uint8_t *)src->ptr(sx, sy);
+    uint8_t *pd = (uint8_t *)dst->ptr(dx, dy);
+    const palette_t &palette = src->palette();
+
     while(w--) {
       uint32_t c = palette[*ps];
-      if(src->alpha() != 255) {
-        c = _premul_mul_alpha(c, src->alpha());
+      if(_a(c) == 255) {
+        *pd = *ps;
+      }else if(_a(c)) {
+        *pd = dst->palette_index(blend_func_over(palette[*pd], _r(c), _g(c), _b(c), _a(c)));
       }
-      *pd = bf(*pd, _r(c), _g(c), _b(c), _a(c));
       pd++;
-      ps++;
+      ps += STEP;
     }
   }
 
-  void span_blit_scale(image_t *src, image_t *dst, blend_func_t bf, fx16_t sx, fx16_t sx_step, fx16_t sy, int dx, int dy, int w) {
-    uint32_t *ps = (uint32_t *)src->ptr(0, sy >> 16);
-    uint32_t *pd = (uint32_t *)dst->ptr(dx, dy);
-    uint32_t src_alpha = src->alpha();
+  static inline void span_blit_scale_shared(image_t *src, image_t *dst, blend_func_t bf, fx16_t sx, fx16_t sx_step, fx16_t sy, int dx, int dy, int w) {
+    const uint8_t *ps = (const uint8_t *)src->ptr(0, sy >> 16);
+    uint8_t *pd = (uint8_t *)dst->ptr(dx, dy);
+    const palette_t &palette = src->palette();
 
     while(w--) {
-      uint32_t c = *(ps + (sx >> 16));
-      if(src->alpha() != 255) {
-        c = _premul_mul_alpha(c, src->alpha());
+      uint8_t i = ps[sx >> 16];
+      uint32_t c = palette[i];
+      if(_a(c) == 255) {
+        *pd = i;
+      }else if(_a(c)) {
+        *pd = dst->palette_index(blend_func_over(palette[*pd], _r(c), _g(c), _b(c), _a(c)));
       }
-      *pd = bf(*pd, _r(c), _g(c), _b(c), _a(c));
       pd++;
       sx += sx_step;
     }
   }
 
-  void span_blit_scale(image_t *src, image_t *dst, blend_func_t bf, fx16_t sx, fx16_t sx_step, fx16_t sy, int dx, int dy, int w, palette_t palette) {
-    uint8_t *ps = (uint8_t *)src->ptr(0, sy >> 16);
-    uint32_t *pd = (uint32_t *)dst->ptr(dx, dy);
+  // blends two premultiplied pixels two channels at a time, f is the weight
+  // of b from 0 to 256
+  static inline __attribute__((always_inline))
+  uint32_t _lerp_pixel(uint32_t a, uint32_t b, uint32_t f) {
+    uint32_t rb = ((a & 0x00ff00ffu) * (256 - f) + (b & 0x00ff00ffu) * f) >> 8;
+    uint32_t ag = ((a >> 8) & 0x00ff00ffu) * (256 - f) + ((b >> 8) & 0x00ff00ffu) * f;
+    return (rb & 0x00ff00ffu) | (ag & 0xff00ff00u);
+  }
+
+  /*
+    affine kernel, steps (u, v) through the source by (du, dv) per target
+    pixel in 16.16 fixed point. the caller keeps every (u, v) inside the
+    source so nearest sampling reads texel (u >> 16, v >> 16) unchecked.
+    bilinear sampling centres the four taps on (u, v) and clamps the taps
+    that fall off the edge, so edges stay sharp rather than fading out
+  */
+  template<typename S, typename D, bool FADE, bool OVER, bool BILINEAR>
+  void span_blit_affine(image_t *src, image_t *dst, blend_func_t bf, fx16_t u, fx16_t du, fx16_t v, fx16_t dv, int dx, int dy, int w) {
+    const uint8_t *ps = (const uint8_t *)src->ptr(0, 0);
+    D *pd = (D *)dst->ptr(dx, dy);
+    size_t stride = src->row_stride();
+    const palette_t &palette = src->palette();
     uint32_t src_alpha = src->alpha();
+    int xmax = src->bounds().w - 1, ymax = src->bounds().h - 1;
 
     while(w--) {
-      uint32_t c = palette[*(ps + (sx >> 16))];
-      if(src->alpha() != 255) {
-        c = _premul_mul_alpha(c, src->alpha());
+      uint32_t c;
+      if(BILINEAR) {
+        fx16_t bu = u - 32768, bv = v - 32768;
+        int x0 = bu >> 16, y0 = bv >> 16;
+        uint32_t fx = (bu >> 8) & 0xff, fy = (bv >> 8) & 0xff;
+        int x1 = min(x0 + 1, xmax), y1 = min(y0 + 1, ymax);
+        x0 = max(x0, 0); y0 = max(y0, 0);
+        const S *r0 = (const S *)(ps + y0 * stride);
+        const S *r1 = (const S *)(ps + y1 * stride);
+        uint32_t top = _lerp_pixel(_fetch_texel(r0 + x0, palette), _fetch_texel(r0 + x1, palette), fx);
+        uint32_t bottom = _lerp_pixel(_fetch_texel(r1 + x0, palette), _fetch_texel(r1 + x1, palette), fx);
+        c = _lerp_pixel(top, bottom, fy);
+      }else{
+        c = _fetch_texel((const S *)(ps + (v >> 16) * stride) + (u >> 16), palette);
+      }
+      if(FADE) {
+        c = _premul_mul_alpha(c, src_alpha);
+      }
+      _blit_texel<OVER>(dst, pd, bf, c);
+      pd++;
+      u += du;
+      v += dv;
+    }
+  }
+
+  // indexed images with different palettes. source indices are translated
+  // to the target's through blit_remap, which blit_remap_reset() empties
+  // (every entry -1) when the kernel is picked and which is filled in as
+  // indices turn up, so each is matched against the target's palette once
+  // per blit rather than once per pixel
+  extern int16_t blit_remap[256];
+  void blit_remap_reset();
+
+  static inline __attribute__((always_inline))
+  uint8_t _remap_index(image_t *dst, uint8_t i, uint32_t c) {
+    int16_t r = blit_remap[i];
+    if(r < 0) {
+      r = blit_remap[i] = dst->palette_index(c);
+    }
+    return r;
+  }
+
+  template<int STEP = 1>
+  void span_blit_remap(image_t *src, image_t *dst, blend_func_t bf, int sx, int sy, int dx, int dy, int w) {
+    const uint8_t *ps = (const uint8_t *)src->ptr(sx, sy);
+    uint8_t *pd = (uint8_t *)dst->ptr(dx, dy);
+    const palette_t &palette = src->palette();
+
+    while(w--) {
+      uint8_t i = *ps;
+      uint32_t c = palette[i];
+      if(_a(c) == 255) {
+        *pd = _remap_index(dst, i, c);
+      }else if(_a(c)) {
+        *pd = dst->palette_index(blend_func_over(dst->palette()[*pd], _r(c), _g(c), _b(c), _a(c)));
+      }
+      pd++;
+      ps += STEP;
+    }
+  }
+
+  static inline void span_blit_scale_remap(image_t *src, image_t *dst, blend_func_t bf, fx16_t sx, fx16_t sx_step, fx16_t sy, int dx, int dy, int w) {
+    const uint8_t *ps = (const uint8_t *)src->ptr(0, sy >> 16);
+    uint8_t *pd = (uint8_t *)dst->ptr(dx, dy);
+    const palette_t &palette = src->palette();
+
+    while(w--) {
+      uint8_t i = ps[sx >> 16];
+      uint32_t c = palette[i];
+      if(_a(c) == 255) {
+        *pd = _remap_index(dst, i, c);
+      }else if(_a(c)) {
+        *pd = dst->palette_index(blend_func_over(dst->palette()[*pd], _r(c), _g(c), _b(c), _a(c)));
       }
-      *pd = bf(*pd, _r(c), _g(c), _b(c), _a(c));
       pd++;
       sx += sx_step;
     }
   }
 
-}
\ No newline at end of file
+  typedef void (*blit_span_t)(image_t *src, image_t *dst, blend_func_t bf, int sx, int sy, int dx, int dy, int w);
+  typedef void (*blit_scale_span_t)(image_t *src, image_t *dst, blend_func_t bf, fx16_t sx, fx16_t sx_step, fx16_t sy, int dx, int dy, int w);
+
+  // pick the row kernel for drawing src onto dst as things stand (formats,
+  // palettes, src's alpha and transparency and dst's blend mode), once per
+  // blit rather than per row. mirrored kernels start at the rightmost source pixel and walk
+  // left
+  blit_span_t blit_span(image_t *src, image_t *dst, bool mirrored = false);
+  blit_scale_span_t blit_scale_span(image_t *src, image_t *dst);
+
+  typedef void (*blit_affine_span_t)(image_t *src, image_t *dst, blend_func_t bf, fx16_t u, fx16_t du, fx16_t v, fx16_t dv, int dx, int dy, int w);
+  blit_affine_span_t blit_affine_span(image_t *src, image_t *dst, bool bilinear);
+
+  // a column of texture, stepping through the source from (sx, sy) by
+  // (sx_step, sy_step) per target pixel in 16.16 fixed point. shade scales
+  // the colour, leaving its alpha alone, with 256 meaning unchanged
+  template<typename S, typename D>
+  void span_tex_column(image_t *src, image_t *dst, blend_func_t bf, fx16_t sx, fx16_t sx_step, fx16_t sy, fx16_t sy_step, int dx, int dy, int h, uint32_t shade) {
+    const uint8_t *ps = (const uint8_t *)src->ptr(0, 0);
+    uint8_t *pd = (uint8_t *)dst->ptr(dx, dy);
+    size_t src_stride = src->row_stride(), dst_stride = dst->row_stride();
+    const palette_t &palette = src->palette();
+    uint32_t src_alpha = src->alpha();
+
+    while(h--) {
+      uint32_t c = _fetch_texel((const S *)(ps + (sy >> 16) * src_stride) + (sx >> 16), palette);
+      if(src_alpha != 255) {
+        c = _premul_mul_alpha(c, src_alpha);
+      }
+      if(shade != 256) {
+        c = ((_r(c) * shade) >> 8) | (((_g(c) * shade) >> 8) << 8) | (((_b(c) * shade) >> 8) << 16) | (c & 0xff000000u);
+      }
+      _blend_texel(dst, (D *)pd, bf, c);
+      pd += dst_stride;
+      sx += sx_step;
+      sy += sy_step;
+    }
+  }
+
+  typedef void (*tex_column_t)(image_t *src, image_t *dst, blend_func_t bf, fx16_t sx, fx16_t sx_step, fx16_t sy, fx16_t sy_step, int dx, int dy, int h, uint32_t shade);
+
+  // picks the column kernel for texturing dst from src
+  tex_column_t tex_column(image_t *src, image_t *dst);
+
+}
@@ -2,6 +2,7 @@
 #include "blend.hpp"
 
 #include "brush.hpp"
+#include "worker.hpp"
 
 namespace picovector {
 
@@ -9,5 +10,186 @@ namespace picovector {
   void span_func_nop(image_t *target, brush_t *brush, int x, int y, int w) {}
   void masked_span_func_nop(image_t *target, brush_t *brush, int x, int y, int w, uint8_t *mask) {}
 
+  // brushes write rgba8888 pixels at target->ptr(x, y) so we give them a one
+  // row scratch image with zero stride whose buffer is offset so that ptr(x, y)
+  // lands on row[0]
+  static const int SCRATCH_WIDTH = 64;
+
+  image_t *brush_t::scratch(image_t *target, uint32_t *row, int x, int y) {
+    // one per core, both may be rendering at once
+    static image_t scratch_images[2];
+    image_t &scratch = scratch_images[current_core()];
+    scratch._buffer = (void *)(row - x);
+    scratch._managed_buffer = false;
+    scratch._row_stride = 0;
+    scratch._bytes_per_pixel = sizeof(uint32_t);
+    scratch._bounds = target->_bounds;
+    scratch._clip = target->_clip;
+    scratch._alpha = target->_alpha;
+    scratch._blend_func = target->_blend_func;
+    return &scratch;
+  }
+
+  void rgb565_adapter_span_func(image_t *target, brush_t *brush, int x, int y, int w) {
+    uint32_t row[SCRATCH_WIDTH];
+    span_func_t fn = brush->span_func();
+    uint16_t *dst = (uint16_t*)target->ptr(x, y);
+
+    while(w > 0) {
+      int c = w < SCRATCH_WIDTH ? w : SCRATCH_WIDTH;
+      for(int i = 0; i < c; i++) {
+        row[i] = _rgb565_to_rgba8888(dst[i]);
+      }
+      fn(brush_t::scratch(target, row, x, y), brush, x, y, c);
+      for(int i = 0; i < c; i++) {
+        dst[i] = _rgba8888_to_rgb565(row[i]);
+      }
+      dst += c; x += c; w -= c;
+    }
+  }
+
+  void rgb565_adapter_masked_span_func(image_t *target, brush_t *brush, int x, int y, int w, uint8_t *mask) {
+    uint32_t row[SCRATCH_WIDTH];
+    masked_span_func_t fn = brush->masked_span_func();
+    uint16_t *dst = (uint16_t*)target->ptr(x, y);
+
+    while(w > 0) {
+      int c = w < SCRATCH_WIDTH ? w : SCRATCH_WIDTH;
+      for(int i = 0; i < c; i++) {
+        row[i] = _rgb565_to_rgba8888(dst[i]);
+      }
+      fn(brush_t::scratch(target, row, x, y), brush, x, y, c, mask);
+      for(int i = 0; i < c; i++) {
+        dst[i] = _rgba8888_to_rgb565(row[i]);
+      }
+      dst += c; x += c; w -= c; mask += c;
+    }
+  }
+
+  void rgba4444_adapter_span_func(image_t *target, brush_t *brush, int x, int y, int w) {
+    uint32_t row[SCRATCH_WIDTH];
+    span_func_t fn = brush->span_func();
+    uint16_t *dst = (uint16_t*)target->ptr(x, y);
+
+    while(w > 0) {
+      int c = w < SCRATCH_WIDTH ? w : SCRATCH_WIDTH;
+      for(int i = 0; i < c; i++) {
+        row[i] = _rgba4444_to_rgba8888(dst[i]);
+      }
+      fn(brush_t::scratch(target, row, x, y), brush, x, y, c);
+      for(int i = 0; i < c; i++) {
+        dst[i] = _rgba8888_to_rgba4444(row[i]);
+      }
+      dst += c; x += c; w -= c;
+    }
+  }
+
+  void rgba4444_adapter_masked_span_func(image_t *target, brush_t *brush, int x, int y, int w, uint8_t *mask) {
+    uint32_t row[SCRATCH_WIDTH];
+    masked_span_func_t fn = brush->masked_span_func();
+    uint16_t *dst = (uint16_t*)target->ptr(x, y);
+
+    while(w > 0) {
+      int c = w < SCRATCH_WIDTH ? w : SCRATCH_WIDTH;
+      for(int i = 0; i < c; i++) {
+        row[i] = _rgba4444_to_rgba8888(dst[i]);
+      }
+      fn(brush_t::scratch(target, row, x, y), brush, x, y, c, mask);
+      for(int i = 0; i < c; i++) {
+        dst[i] = _rgba8888_to_rgba4444(row[i]);
+      }
+      dst += c; x += c; w -= c; mask += c;
+    }
+  }
+
+  void a8_adapter_span_func(image_t *target, brush_t *brush, int x, int y, int w) {
+    uint32_t row[SCRATCH_WIDTH];
+    span_func_t fn = brush->span_func();
+    uint8_t *dst = (uint8_t*)target->ptr(x, y);
+
+    while(w > 0) {
+      int c = w < SCRATCH_WIDTH ? w : SCRATCH_WIDTH;
+      for(int i = 0; i < c; i++) {
+        row[i] = dst[i] * 0x01010101u;
+      }
+      fn(brush_t::scratch(target, row, x, y), brush, x, y, c);
+      for(int i = 0; i < c; i++) {
+        dst[i] = _a(row[i]);
+      }
+      dst += c; x += c; w -= c;
+    }
+  }
+
+  void a8_adapter_masked_span_func(image_t *target, brush_t *brush, int x, int y, int w, uint8_t *mask) {
+    uint32_t row[SCRATCH_WIDTH];
+    masked_span_func_t fn = brush->masked_span_func();
+    uint8_t *dst = (uint8_t*)target->ptr(x, y);
+
+    while(w > 0) {
+      int c = w < SCRATCH_WIDTH ? w : SCRATCH_WIDTH;
+      for(int i = 0; i < c; i++) {
+        row[i] = dst[i] * 0x01010101u;
+      }
+      fn(brush_t::scratch(target, row, x, y), brush, x, y, c, mask);
+      for(int i = 0; i < c; i++) {
+        dst[i] = _a(row[i]);
+      }
+      dst += c; x += c; w -= c; mask += c;
+    }
+  }
+
+  // pixels the brush left untouched keep their index, anything else is
+  // matched to the nearest palette entry
+  static void pal8_store_row(image_t *target, uint8_t *dst, const uint32_t *row, int c) {
+    const palette_t &palette = target->palette();
+    uint32_t last = palette[dst[0]];
+    uint8_t last_index = dst[0];
+    for(int i = 0; i < c; i++) {
+      uint32_t p = row[i];
+      if(p == palette[dst[i]]) {
+        continue;
+      }
+      if(p != last) {
+        last = p;
+        last_index = target->palette_index(p);
+      }
+      dst[i] = last_index;
+    }
+  }
+
+  void pal8_adapter_span_func(image_t *target, brush_t *brush, int x, int y, int w) {
+    uint32_t row[SCRATCH_WIDTH];
+    span_func_t fn = brush->span_func();
+    uint8_t *dst = (uint8_t*)target->ptr(x, y);
+    const palette_t &palette = target->palette();
+
+    while(w > 0) {
+      int c = w < SCRATCH_WIDTH ? w : SCRATCH_WIDTH;
+      for(int i = 0; i < c; i++) {
+        row[i] = palette[dst[i]];
+      }
+      fn(brush_t::scratch(target, row, x, y), brush, x, y, c);
+      pal8_store_row(target, dst, row, c);
+      dst += c; x += c; w -= c;
+    }
+  }
+
+  void pal8_adapter_masked_span_func(image_t *target, brush_t *brush, int x, int y, int w, uint8_t *mask) {
+    uint32_t row[SCRATCH_WIDTH];
+    masked_span_func_t fn = brush->masked_span_func();
+    uint8_t *dst = (uint8_t*)target->ptr(x, y);
+    const palette_t &palette = target->palette();
+
+    while(w > 0) {
+      int c = w < SCRATCH_WIDTH ? w : SCRATCH_WIDTH;
+      for(int i = 0; i < c; i++) {
+        row[i] = palette[dst[i]];
+      }
+      fn(brush_t::scratch(target, row, x, y), brush, x, y, c, mask);
+      pal8_store_row(target, dst, row, c);
+      dst += c; x += c; w -= c; mask += c;
+    }
+  }
+
 
 }
\ No newline at end of file
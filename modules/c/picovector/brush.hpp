@@ -8,14 +8,47 @@
 
 namespace picovector {
 
+  // renders any brush onto an rgb565 target via an rgba8888 scratch row
+  void rgb565_adapter_span_func(image_t *target, brush_t *brush, int x, int y, int w);
+  void rgb565_adapter_masked_span_func(image_t *target, brush_t *brush, int x, int y, int w, uint8_t *mask);
+
+  // renders any brush onto an rgba4444 target the same way, every brush
+  // draws into these through the adapter
+  void rgba4444_adapter_span_func(image_t *target, brush_t *brush, int x, int y, int w);
+  void rgba4444_adapter_masked_span_func(image_t *target, brush_t *brush, int x, int y, int w, uint8_t *mask);
+
+  // renders any brush onto an a8 target, keeping the alpha of the result
+  void a8_adapter_span_func(image_t *target, brush_t *brush, int x, int y, int w);
+  void a8_adapter_masked_span_func(image_t *target, brush_t *brush, int x, int y, int w, uint8_t *mask);
+
+  // renders any brush onto an indexed target, results snap to the palette
+  void pal8_adapter_span_func(image_t *target, brush_t *brush, int x, int y, int w);
+  void pal8_adapter_masked_span_func(image_t *target, brush_t *brush, int x, int y, int w, uint8_t *mask);
+
   class brush_t {
   public:
     virtual span_func_t span_func() = 0;
     virtual masked_span_func_t masked_span_func() = 0;
+
+    // brushes without native rgb565 span functions fall back to the adapter
+    virtual span_func_t span_func_rgb565() {return rgb565_adapter_span_func;}
+    virtual masked_span_func_t masked_span_func_rgb565() {return rgb565_adapter_masked_span_func;}
+    virtual span_func_t span_func_pal8() {return pal8_adapter_span_func;}
+    virtual masked_span_func_t masked_span_func_pal8() {return pal8_adapter_masked_span_func;}
+
+    // brushes that paint every pixel the same colour hand it back here so
+    // large fills can skip the span functions
+    virtual bool solid(uint32_t &c) {return false;}
+
+    static image_t *scratch(image_t *target, uint32_t *row, int x, int y);
   };
 
   void color_brush_span_func(image_t *target, brush_t *brush, int x, int y, int w);
   void color_brush_masked_span_func(image_t *target, brush_t *brush, int x, int y, int w, uint8_t *mask);
+  void color_brush_span_func_rgb565(image_t *target, brush_t *brush, int x, int y, int w);
+  void color_brush_masked_span_func_rgb565(image_t *target, brush_t *brush, int x, int y, int w, uint8_t *mask);
+  void color_brush_span_func_pal8(image_t *target, brush_t *brush, int x, int y, int w);
+  void color_brush_masked_span_func_pal8(image_t *target, brush_t *brush, int x, int y, int w, uint8_t *mask);
   class color_brush_t : public brush_t {
   public:
     color_t c;
@@ -23,6 +56,11 @@ namespace picovector {
     color_brush_t(const color_t& c);
     span_func_t span_func();
     masked_span_func_t masked_span_func();
+    span_func_t span_func_rgb565();
+    masked_span_func_t masked_span_func_rgb565();
+    span_func_t span_func_pal8();
+    masked_span_func_t masked_span_func_pal8();
+    bool solid(uint32_t &c);
   };
 
   class pattern_brush_t : public brush_t {
@@ -35,17 +73,75 @@ namespace picovector {
     pattern_brush_t(const color_t& c1, const color_t& c2, uint8_t *pattern);
     span_func_t span_func();
     masked_span_func_t masked_span_func();
+    span_func_t span_func_rgb565();
+    masked_span_func_t masked_span_func_rgb565();
+    span_func_t span_func_pal8();
+  };
+
+  // what an image brush samples beyond the edges of its image
+  enum wrap_t {
+    WRAP_REPEAT = 0,  // tiles the image
+    WRAP_CLAMP = 1,   // stretches the edge pixels outwards
+    WRAP_MIRROR = 2,  // tiles the image flipping every other copy
+    WRAP_NONE = 3     // leaves the target untouched
   };
 
   class image_brush_t : public brush_t {
   public:
     image_t *src;
     mat3_t inverse_transform;
+    wrap_t wrap = WRAP_REPEAT;
 
     image_brush_t(image_t *src);
-    image_brush_t(image_t *src, mat3_t *transform);
+    image_brush_t(image_t *src, mat3_t *transform, wrap_t wrap = WRAP_REPEAT);
+    span_func_t span_func();
+    masked_span_func_t masked_span_func();
+    span_func_t span_func_rgb565();
+    masked_span_func_t masked_span_func_rgb565();
+  };
+
+  // a colour at position t along a gradient, c is premultiplied
+  struct gradient_stop_t {
+    float t;
+    uint32_t c;
+  };
+
+  // the stops are baked into a 256 entry lut when the brush is made and
+  // spans look each pixel up from a position stepped along the row. wrap
+  // picks what lies beyond the ends, CLAMP extends the end colours, REPEAT
+  // and MIRROR tile the gradient and NONE leaves the target untouched
+  class gradient_brush_t : public brush_t {
+  public:
+    // writes the lut index of w pixels from (x, y), or -1 where untouched
+    typedef void (*sample_func_t)(gradient_brush_t *g, int x, int y, int w, int16_t *out);
+
+    uint32_t lut[256];
+    wrap_t wrap;
+    sample_func_t sample;
+
+    gradient_brush_t(const gradient_stop_t *stops, int count, wrap_t wrap);
     span_func_t span_func();
     masked_span_func_t masked_span_func();
+    span_func_t span_func_rgb565();
+    masked_span_func_t masked_span_func_rgb565();
+  };
+
+  // t runs from 0 at p1 to 1 at p2, constant at right angles to the line
+  class linear_gradient_brush_t : public gradient_brush_t {
+  public:
+    vec2_t p1;
+    vec2_t d; // change in t per pixel along x and y
+
+    linear_gradient_brush_t(vec2_t p1, vec2_t p2, const gradient_stop_t *stops, int count, wrap_t wrap = WRAP_CLAMP);
+  };
+
+  // t runs from 0 at the centre to 1 at radius r
+  class radial_gradient_brush_t : public gradient_brush_t {
+  public:
+    vec2_t centre;
+    float r;
+
+    radial_gradient_brush_t(vec2_t centre, float r, const gradient_stop_t *stops, int count, wrap_t wrap = WRAP_CLAMP);
   };
 
 }
\ No newline at end of file
@@ -1,15 +1,20 @@
+#include <string.h>
+
 #include "../brush.hpp"
+#include "../blit.hpp"
 
 namespace picovector {
 
+  // the body of the rgba8888 and rgb565 span functions, D is the target's
+  // storage and OVER inlines a source over blend
+  template<typename D, bool OVER>
+  static void color_span(image_t *target, uint32_t src, int x, int y, int w) {
+    D *dst = (D*)target->ptr(x, y);
 
-  void color_brush_span_func(image_t *target, brush_t *brush, int x, int y, int w) {
-    color_brush_t *p = (color_brush_t*)brush;
-    uint32_t *dst = (uint32_t*)target->ptr(x, y);
-    uint32_t src = p->c._p;
-
-    if(target->alpha() != 255) {
-      src = _premul_mul_alpha(src, target->alpha());
+    // opaque fills need no read back from the target
+    if(OVER && _a(src) == 255) {
+      _fill_pixels(dst, src, w);
+      return;
     }
 
     uint32_t r = _r(src);
@@ -19,33 +24,128 @@ namespace picovector {
 
     blend_func_t fn = target->_blend_func;
     while(w--) {
-      *dst = fn(*dst, r, g, b, a);
+      _store_pixel(dst, _blend<OVER>(fn, _load_pixel(dst), r, g, b, a));
       dst++;
     }
   }
 
-  void color_brush_masked_span_func(image_t *target, brush_t *brush, int x, int y, int w, uint8_t *mask) {
-    color_brush_t *p = (color_brush_t*)brush;
-    uint32_t *dst = (uint32_t*)target->ptr(x, y);
-    uint32_t src = p->c._p;
+  template<typename D, bool OVER>
+  static void color_masked_span(image_t *target, uint32_t src, int x, int y, int w, uint8_t *mask) {
+    D *dst = (D*)target->ptr(x, y);
 
+    uint32_t r = _r(src);
+    uint32_t g = _g(src);
+    uint32_t b = _b(src);
+    uint32_t a = _a(src);
+
+    blend_func_t fn = target->_blend_func;
+    while(w--) {
+      uint32_t m = *mask;
+      if(OVER && m == 255 && a == 255) {
+        _store_pixel(dst, src);
+      }else if(m) {
+        uint32_t sr = _premul_mul_alpha_channel(r, m);
+        uint32_t sg = _premul_mul_alpha_channel(g, m);
+        uint32_t sb = _premul_mul_alpha_channel(b, m);
+        uint32_t sa = _premul_mul_alpha_channel(a, m);
+        _store_pixel(dst, _blend<OVER>(fn, _load_pixel(dst), sr, sg, sb, sa));
+      }
+      dst++;
+      mask++;
+    }
+  }
+
+  static inline uint32_t color_brush_source(image_t *target, brush_t *brush) {
+    uint32_t src = ((color_brush_t*)brush)->c._p;
     if(target->alpha() != 255) {
       src = _premul_mul_alpha(src, target->alpha());
     }
+    return src;
+  }
+
+  void color_brush_span_func(image_t *target, brush_t *brush, int x, int y, int w) {
+    uint32_t src = color_brush_source(target, brush);
+    if(target->_blend_func == blend_func_over) {
+      color_span<uint32_t, true>(target, src, x, y, w);
+    }else{
+      color_span<uint32_t, false>(target, src, x, y, w);
+    }
+  }
+
+  void color_brush_masked_span_func(image_t *target, brush_t *brush, int x, int y, int w, uint8_t *mask) {
+    uint32_t src = color_brush_source(target, brush);
+    if(target->_blend_func == blend_func_over) {
+      color_masked_span<uint32_t, true>(target, src, x, y, w, mask);
+    }else{
+      color_masked_span<uint32_t, false>(target, src, x, y, w, mask);
+    }
+  }
+
+  void color_brush_span_func_rgb565(image_t *target, brush_t *brush, int x, int y, int w) {
+    uint32_t src = color_brush_source(target, brush);
+    if(target->_blend_func == blend_func_over) {
+      color_span<uint16_t, true>(target, src, x, y, w);
+    }else{
+      color_span<uint16_t, false>(target, src, x, y, w);
+    }
+  }
+
+  void color_brush_masked_span_func_rgb565(image_t *target, brush_t *brush, int x, int y, int w, uint8_t *mask) {
+    uint32_t src = color_brush_source(target, brush);
+    if(target->_blend_func == blend_func_over) {
+      color_masked_span<uint16_t, true>(target, src, x, y, w, mask);
+    }else{
+      color_masked_span<uint16_t, false>(target, src, x, y, w, mask);
+    }
+  }
+
+  void color_brush_span_func_pal8(image_t *target, brush_t *brush, int x, int y, int w) {
+    uint8_t *dst = (uint8_t*)target->ptr(x, y);
+    uint32_t src = color_brush_source(target, brush);
+
+    blend_func_t fn = target->_blend_func;
+
+    // opaque fills look the palette entry up once for the whole span
+    if(_a(src) == 255 && fn == blend_func_over) {
+      memset(dst, target->palette_index(src), w);
+      return;
+    }
+
+    pal8_adapter_span_func(target, brush, x, y, w);
+  }
+
+  void color_brush_masked_span_func_pal8(image_t *target, brush_t *brush, int x, int y, int w, uint8_t *mask) {
+    uint8_t *dst = (uint8_t*)target->ptr(x, y);
+    uint32_t src = color_brush_source(target, brush);
+
+    blend_func_t fn = target->_blend_func;
+
+    if(_a(src) != 255 || fn != blend_func_over) {
+      pal8_adapter_masked_span_func(target, brush, x, y, w, mask);
+      return;
+    }
+
+    // fully covered pixels take the brush's entry directly, only the
+    // antialiased edges need blending and matching against the palette
+    uint8_t index = target->palette_index(src);
+    const palette_t &palette = target->palette();
 
     uint32_t r = _r(src);
     uint32_t g = _g(src);
     uint32_t b = _b(src);
     uint32_t a = _a(src);
 
-    blend_func_t fn = target->_blend_func;
     while(w--) {
       uint32_t m = *mask;
-      uint32_t sr = _premul_mul_alpha_channel(r, m);
-      uint32_t sg = _premul_mul_alpha_channel(g, m);
-      uint32_t sb = _premul_mul_alpha_channel(b, m);
-      uint32_t sa = _premul_mul_alpha_channel(a, m);
-      *dst = fn(*dst, sr, sg, sb, sa);
+      if(m == 255) {
+        *dst = index;
+      }else if(m) {
+        uint32_t sr = _premul_mul_alpha_channel(r, m);
+        uint32_t sg = _premul_mul_alpha_channel(g, m);
+        uint32_t sb = _premul_mul_alpha_channel(b, m);
+        uint32_t sa = _premul_mul_alpha_channel(a, m);
+        *dst = target->palette_index(blend_func_over(palette[*dst], sr, sg, sb, sa));
+      }
       dst++;
       mask++;
     }
@@ -62,4 +162,25 @@ namespace picovector {
     return color_brush_masked_span_func;
   }
 
-}
\ No newline at end of file
+  span_func_t color_brush_t::span_func_rgb565() {
+    return color_brush_span_func_rgb565;
+  }
+
+  masked_span_func_t color_brush_t::masked_span_func_rgb565() {
+    return color_brush_masked_span_func_rgb565;
+  }
+
+  span_func_t color_brush_t::span_func_pal8() {
+    return color_brush_span_func_pal8;
+  }
+
+  masked_span_func_t color_brush_t::masked_span_func_pal8() {
+    return color_brush_masked_span_func_pal8;
+  }
+
+  bool color_brush_t::solid(uint32_t &c) {
+    c = this->c._p;
+    return true;
+  }
+
+}
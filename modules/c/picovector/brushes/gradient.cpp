@@ -0,0 +1,222 @@
+#include <math.h>
+
+#include "../brush.hpp"
+#include "../blit.hpp"
+
+namespace picovector {
+
+  // linear gradients step t along the row in 8.24 fixed point, where the
+  // top eight bits of the fraction are the lut index. repeat and mirror let
+  // the accumulator wrap since the index only depends on the low 24 (or 25)
+  // bits, clamp and none run the parts of the row beyond either end as a
+  // single index and only step through the middle
+  template<wrap_t WRAP>
+  static void linear_sample(gradient_brush_t *g, int x, int y, int w, int16_t *out) {
+    linear_gradient_brush_t *l = (linear_gradient_brush_t*)g;
+    float t = (float(x) + 0.5f - l->p1.x) * l->d.x + (float(y) + 0.5f - l->p1.y) * l->d.y;
+    float dt = l->d.x;
+
+    if(WRAP == WRAP_REPEAT || WRAP == WRAP_MIRROR) {
+      t -= WRAP == WRAP_MIRROR ? floorf(t * 0.5f) * 2.0f : floorf(t);
+      uint32_t T = uint32_t(t * 16777216.0f);
+      uint32_t dT = uint32_t(int32_t(dt * 16777216.0f));
+      while(w--) {
+        if(WRAP == WRAP_REPEAT) {
+          *out++ = (T >> 16) & 0xff;
+        }else{
+          uint32_t i = (T >> 16) & 0x1ff;
+          *out++ = i < 256 ? i : 511 - i;
+        }
+        T += dT;
+      }
+      return;
+    }
+
+    while(w > 0) {
+      int n = w;
+      if(t < 0.0f || t > 1.0f) {
+        // beyond an end, run on to where the gradient starts if it does
+        if(t < 0.0f && dt > 0.0f) n = min(w, int(ceilf(-t / dt)));
+        if(t > 1.0f && dt < 0.0f) n = min(w, int(ceilf((t - 1.0f) / -dt)));
+        int16_t i = WRAP == WRAP_NONE ? -1 : (t < 0.0f ? 0 : 255);
+        for(int j = 0; j < n; j++) {
+          *out++ = i;
+        }
+      }else{
+        int32_t T = int32_t(t * 16777216.0f);
+        int32_t dT = int32_t(dt * 16777216.0f);
+        if(dT > 0) n = min(w, ((1 << 24) - T) / dT + 1);
+        if(dT < 0) n = min(w, T / -dT + 1);
+        for(int j = 0; j < n; j++) {
+          *out++ = min(T >> 16, int32_t(255));
+          T += dT;
+        }
+      }
+      w -= n;
+      t += dt * float(n);
+    }
+  }
+
+  // radial gradients step the squared distance from the centre by forward
+  // differences, so only the square root is left per pixel. clamp and none
+  // skip that too for pixels beyond the radius
+  template<wrap_t WRAP>
+  static void radial_sample(gradient_brush_t *g, int x, int y, int w, int16_t *out) {
+    radial_gradient_brush_t *r = (radial_gradient_brush_t*)g;
+    float dx = float(x) + 0.5f - r->centre.x;
+    float dy = float(y) + 0.5f - r->centre.y;
+    float d2 = dx * dx + dy * dy;
+    float r2 = r->r * r->r;
+    float scale = 256.0f / r->r;
+
+    while(w--) {
+      if((WRAP == WRAP_CLAMP || WRAP == WRAP_NONE) && d2 >= r2) {
+        *out++ = WRAP == WRAP_NONE ? -1 : 255;
+      }else{
+        int32_t T = int32_t(sqrtf(d2) * scale);
+        if(WRAP == WRAP_REPEAT) {
+          *out++ = T & 0xff;
+        }else if(WRAP == WRAP_MIRROR) {
+          int32_t i = T & 0x1ff;
+          *out++ = i < 256 ? i : 511 - i;
+        }else{
+          *out++ = min(T, int32_t(255));
+        }
+      }
+      d2 += 2.0f * dx + 1.0f;
+      dx += 1.0f;
+    }
+  }
+
+  // D is the target's storage, OVER inlines a source over blend and MASKED
+  // scales each pixel by its coverage in mask. lut indices are sampled a
+  // chunk at a time, then the colours blended into the target
+  template<typename D, bool OVER, bool MASKED>
+  static void gradient_span(image_t *target, gradient_brush_t *g, int x, int y, int w, uint8_t *mask) {
+    D *dst = (D*)target->ptr(x, y);
+    blend_func_t fn = target->_blend_func;
+
+    const int chunk = 64;
+    int16_t index[chunk];
+    while(w > 0) {
+      int n = min(w, chunk);
+      g->sample(g, x, y, n, index);
+      x += n;
+      w -= n;
+
+      for(int i = 0; i < n; i++) {
+        if(index[i] < 0) {
+          dst++;
+          if(MASKED) mask++;
+          continue;
+        }
+
+        uint32_t c = g->lut[index[i]];
+
+        if(MASKED) {
+          uint32_t m = *mask++;
+          c = _premul_mul_alpha_channel(_r(c), m) | (_premul_mul_alpha_channel(_g(c), m) << 8) |
+              (_premul_mul_alpha_channel(_b(c), m) << 16) | (_premul_mul_alpha_channel(_a(c), m) << 24);
+        }
+
+        if(OVER && _a(c) == 255) {
+          _store_pixel(dst, c);
+        }else if(!OVER || _a(c)) {
+          _store_pixel(dst, _blend<OVER>(fn, _load_pixel(dst), _r(c), _g(c), _b(c), _a(c)));
+        }
+        dst++;
+      }
+    }
+  }
+
+  template<typename D, bool MASKED>
+  static void gradient_span(image_t *target, brush_t *brush, int x, int y, int w, uint8_t *mask) {
+    if(target->_blend_func == blend_func_over) {
+      gradient_span<D, true, MASKED>(target, (gradient_brush_t*)brush, x, y, w, mask);
+    }else{
+      gradient_span<D, false, MASKED>(target, (gradient_brush_t*)brush, x, y, w, mask);
+    }
+  }
+
+  void gradient_brush_span_func(image_t *target, brush_t *brush, int x, int y, int w) {
+    gradient_span<uint32_t, false>(target, brush, x, y, w, nullptr);
+  }
+
+  void gradient_brush_masked_span_func(image_t *target, brush_t *brush, int x, int y, int w, uint8_t *mask) {
+    gradient_span<uint32_t, true>(target, brush, x, y, w, mask);
+  }
+
+  void gradient_brush_span_func_rgb565(image_t *target, brush_t *brush, int x, int y, int w) {
+    gradient_span<uint16_t, false>(target, brush, x, y, w, nullptr);
+  }
+
+  void gradient_brush_masked_span_func_rgb565(image_t *target, brush_t *brush, int x, int y, int w, uint8_t *mask) {
+    gradient_span<uint16_t, true>(target, brush, x, y, w, mask);
+  }
+
+  // lut entry i is the colour at t = i / 255, the stops are expected in
+  // order of t and the colours before the first and after the last are held
+  gradient_brush_t::gradient_brush_t(const gradient_stop_t *stops, int count, wrap_t wrap) : wrap(wrap) {
+    int s = 0;
+    for(int i = 0; i < 256; i++) {
+      if(count == 0) {
+        lut[i] = 0;
+        continue;
+      }
+
+      float t = float(i) / 255.0f;
+      while(s < count - 1 && stops[s + 1].t <= t) s++;
+
+      const gradient_stop_t &a = stops[s];
+      if(t <= a.t || s == count - 1) {
+        lut[i] = a.c;
+        continue;
+      }
+
+      const gradient_stop_t &b = stops[s + 1];
+      uint32_t f = uint32_t((t - a.t) / (b.t - a.t) * 256.0f);
+      lut[i] = _lerp_pixel(a.c, b.c, min(f, uint32_t(256)));
+    }
+  }
+
+  span_func_t gradient_brush_t::span_func() {
+    return gradient_brush_span_func;
+  }
+
+  masked_span_func_t gradient_brush_t::masked_span_func() {
+    return gradient_brush_masked_span_func;
+  }
+
+  span_func_t gradient_brush_t::span_func_rgb565() {
+    return gradient_brush_span_func_rgb565;
+  }
+
+  masked_span_func_t gradient_brush_t::masked_span_func_rgb565() {
+    return gradient_brush_masked_span_func_rgb565;
+  }
+
+  linear_gradient_brush_t::linear_gradient_brush_t(vec2_t p1, vec2_t p2, const gradient_stop_t *stops, int count, wrap_t wrap) : gradient_brush_t(stops, count, wrap), p1(p1) {
+    // t is the projection onto p1 -> p2 divided by its length squared, a
+    // line shorter than a pixel gives a hard edge rather than overflowing
+    vec2_t v = p2 - p1;
+    float l2 = max(v.x * v.x + v.y * v.y, 1.0f);
+    d = vec2_t(v.x / l2, v.y / l2);
+
+    switch(wrap) {
+      case WRAP_REPEAT: sample = linear_sample<WRAP_REPEAT>; break;
+      case WRAP_MIRROR: sample = linear_sample<WRAP_MIRROR>; break;
+      case WRAP_NONE: sample = linear_sample<WRAP_NONE>; break;
+      default: sample = linear_sample<WRAP_CLAMP>; break;
+    }
+  }
+
+  radial_gradient_brush_t::radial_gradient_brush_t(vec2_t centre, float r, const gradient_stop_t *stops, int count, wrap_t wrap) : gradient_brush_t(stops, count, wrap), centre(centre), r(max(r, 0.5f)) {
+    switch(wrap) {
+      case WRAP_REPEAT: sample = radial_sample<WRAP_REPEAT>; break;
+      case WRAP_MIRROR: sample = radial_sample<WRAP_MIRROR>; break;
+      case WRAP_NONE: sample = radial_sample<WRAP_NONE>; break;
+      default: sample = radial_sample<WRAP_CLAMP>; break;
+    }
+  }
+
+}
@@ -1,76 +1,216 @@
+#include <string.h>
+
 #include "../brush.hpp"
+#include "../blit.hpp"
 
 namespace picovector {
 
-  void image_brush_span_func(image_t *target, brush_t *brush, int x, int y, int w) {
-    image_brush_t *p = (image_brush_t*)brush;
-    uint32_t *dst = (uint32_t*)target->ptr(x, y);
-    rect_t b = p->src->bounds();
-
-    fx16_vec2_t p1(x, y);
-    fx16_vec2_t p2((x + w), y);
-
-    p1 = p1.transform(&p->inverse_transform);
-    p2 = p2.transform(&p->inverse_transform);
-
-    fx16_vec2_t pd((p2.x - p1.x) / w, (p2.y - p1.y) / w);
-    fx16_vec2_t pt = p1;
-
-    int tw = int(b.w);
-    int th = int(b.h);
-
-    for(int i = 0; i < w; i++) {
-      pt.x += pd.x;
-      pt.y += pd.y;
-      int u = ((int(pt.x) >> 16) % tw + tw) % tw;
-      int v = ((int(pt.y) >> 16) % th + th) % th;
-      uint32_t c = p->src->get_unsafe(u, v);
-      uint8_t *src = (uint8_t*)&c;
-      *dst = target->_blend_func(*dst, src[0], src[1], src[2], src[3]);
-      dst++;
+  // one axis of a texture lookup, t steps by dt per target pixel in 16.16.
+  // repeat and mirror keep t within one period of the wrap (the size, or
+  // twice it when mirroring) so stepping never needs a modulo, and images
+  // that are a power of two on both axes just mask the texel index instead
+  template<wrap_t WRAP, bool POW2>
+  struct tex_axis_t {
+    fx16_t t, dt, period;
+    int n;
+
+    tex_axis_t(fx16_t t0, fx16_t d, int size) : t(t0), dt(d), n(size) {
+      period = fx16_t(size) << (WRAP == WRAP_MIRROR ? 17 : 16);
+      if(!POW2 && (WRAP == WRAP_REPEAT || WRAP == WRAP_MIRROR)) {
+        t %= period;
+        if(t < 0) t += period;
+        dt %= period;
+      }
+    }
+
+    inline __attribute__((always_inline)) void step() {
+      t += dt;
+      if(!POW2 && (WRAP == WRAP_REPEAT || WRAP == WRAP_MIRROR)) {
+        if(t >= period) {
+          t -= period;
+        }else if(t < 0) {
+          t += period;
+        }
+      }
+    }
+
+    // texel index, or -1 off the edge of the image for WRAP_NONE
+    inline __attribute__((always_inline)) int texel() const {
+      int i = t >> 16;
+      switch(WRAP) {
+        case WRAP_REPEAT: return POW2 ? i & (n - 1) : i;
+        case WRAP_MIRROR: if(POW2) i &= n * 2 - 1; return i < n ? i : n * 2 - 1 - i;
+        case WRAP_CLAMP: return i < 0 ? 0 : (i >= n ? n - 1 : i);
+        case WRAP_NONE: return i < 0 || i >= n ? -1 : i;
+      }
+      return i;
+    }
+  };
+
+  // reads w texels into out starting at (u, v) and stepping (du, dv), S is
+  // the source's storage. pixels off the edge with WRAP_NONE are written
+  // fully transparent. rows that don't rotate only look up the source row
+  // once
+  template<typename S, wrap_t WRAP, bool POW2>
+  static void image_sample(image_t *src, fx16_t u, fx16_t du, fx16_t v, fx16_t dv, int w, uint32_t *out) {
+    const uint8_t *base = (const uint8_t *)src->ptr(0, 0);
+    size_t stride = src->row_stride();
+    const palette_t &palette = src->palette();
+    rect_t b = src->bounds();
+    tex_axis_t<WRAP, POW2> au(u, du, b.w), av(v, dv, b.h);
+
+    if(dv == 0) {
+      int ty = av.texel();
+      if(ty < 0) {
+        memset(out, 0, w * sizeof(uint32_t));
+        return;
+      }
+      const S *row = (const S *)(base + ty * stride);
+      while(w--) {
+        int tx = au.texel();
+        *out++ = tx < 0 ? 0 : _fetch_texel(row + tx, palette);
+        au.step();
+      }
+      return;
+    }
+
+    while(w--) {
+      int tx = au.texel(), ty = av.texel();
+      *out++ = tx < 0 || ty < 0 ? 0 : _fetch_texel((const S *)(base + ty * stride) + tx, palette);
+      au.step();
+      av.step();
     }
   }
 
-  void image_brush_masked_span_func(image_t *target, brush_t *brush, int x, int y, int w, uint8_t *mask) {
-    image_brush_t *p = (image_brush_t*)brush;
-    uint32_t *dst = (uint32_t*)target->ptr(x, y);
-    rect_t b = p->src->bounds();
-
-    fx16_vec2_t p1(x, y);
-    fx16_vec2_t p2((x + w), y);
-
-    p1 = p1.transform(&p->inverse_transform);
-    p2 = p2.transform(&p->inverse_transform);
-
-    fx16_vec2_t pd((p2.x - p1.x) / w, (p2.y - p1.y) / w);
-    fx16_vec2_t pt = p1;
-
-    int tw = int(b.w);
-    int th = int(b.h);
-
-    for(int i = 0; i < w; i++) {
-      pt.x += pd.x;
-      pt.y += pd.y;
-      int u = ((int(pt.x) >> 16) % tw + tw) % tw;
-      int v = ((int(pt.y) >> 16) % th + th) % th;
-      uint32_t c = p->src->get_unsafe(u, v);
-      uint8_t *src = (uint8_t*)&c;
-      uint32_t m = *mask;
-      uint32_t sr = (src[0] * m + 128) >> 8;
-      uint32_t sg = (src[1] * m + 128) >> 8;
-      uint32_t sb = (src[2] * m + 128) >> 8;
-      uint32_t sa = (src[3] * m + 128) >> 8;
-
-      *dst = target->_blend_func(*dst, sr, sg, sb, sa);
-      dst++;
-      mask++;
+  typedef void (*image_sample_t)(image_t *src, fx16_t u, fx16_t du, fx16_t v, fx16_t dv, int w, uint32_t *out);
+
+  template<typename S>
+  static image_sample_t image_sampler(wrap_t wrap, bool pow2) {
+    switch(wrap) {
+      case WRAP_CLAMP: return image_sample<S, WRAP_CLAMP, false>;
+      case WRAP_MIRROR: return pow2 ? image_sample<S, WRAP_MIRROR, true> : image_sample<S, WRAP_MIRROR, false>;
+      case WRAP_NONE: return image_sample<S, WRAP_NONE, false>;
+      default: return pow2 ? image_sample<S, WRAP_REPEAT, true> : image_sample<S, WRAP_REPEAT, false>;
+    }
+  }
+
+  static image_sample_t image_sampler(image_t *src, wrap_t wrap) {
+    rect_t b = src->bounds();
+    int tw = b.w, th = b.h;
+    bool pow2 = (tw & (tw - 1)) == 0 && (th & (th - 1)) == 0;
+    if(src->has_palette()) return image_sampler<uint8_t>(wrap, pow2);
+    if(src->pixel_format() == RGB565) return image_sampler<uint16_t>(wrap, pow2);
+    if(src->pixel_format() == RGBA4444) return image_sampler<rgba4444_t>(wrap, pow2);
+    if(src->pixel_format() == A8) return image_sampler<a8_t>(wrap, pow2);
+    return image_sampler<uint32_t>(wrap, pow2);
+  }
+
+  // an unscaled, unrotated repeating opaque image stored the same way as
+  // the target is copied straight into the row a run at a time
+  template<typename D>
+  static bool image_copy_row(image_t *target, image_brush_t *p, fx16_t u, fx16_t v, int x, int y, int w) {
+    image_t *src = p->src;
+    bool same = !src->has_palette() && src->pixel_format() == (sizeof(D) == 2 ? RGB565 : RGBA8888);
+    if(!same || p->wrap != WRAP_REPEAT || src->transparency() != OPAQUE) {
+      return false;
+    }
+
+    rect_t b = src->bounds();
+    int tw = b.w, th = b.h;
+    int tx = (u >> 16) % tw, ty = (v >> 16) % th;
+    if(tx < 0) tx += tw;
+    if(ty < 0) ty += th;
+
+    const D *row = (const D *)src->ptr(0, ty);
+    D *dst = (D *)target->ptr(x, y);
+    while(w > 0) {
+      int n = min(w, tw - tx);
+      memcpy(dst, row + tx, n * sizeof(D));
+      dst += n;
+      w -= n;
+      tx = 0;
+    }
+    return true;
+  }
+
+  // D is the target's storage, OVER inlines a source over blend and MASKED
+  // scales each pixel by its coverage in mask. texels are fetched a chunk at
+  // a time by a sampler picked for the source format and wrap mode, then
+  // blended into the target
+  template<typename D, bool OVER, bool MASKED>
+  static void image_span(image_t *target, image_brush_t *p, int x, int y, int w, uint8_t *mask) {
+    D *dst = (D*)target->ptr(x, y);
+    blend_func_t fn = target->_blend_func;
+
+    // pixel i samples the texture where the left edge of pixel i + 1 lands
+    const mat3_t &m = p->inverse_transform;
+    fx16_t du = f_to_fx16(m.v00), dv = f_to_fx16(m.v10);
+    fx16_vec2_t p1 = fx16_vec2_t(x, y).transform(&p->inverse_transform);
+    fx16_t u = p1.x + du, v = p1.y + dv;
+
+    if(!MASKED && OVER && dv == 0 && du == 65536 && image_copy_row<D>(target, p, u, v, x, y, w)) {
+      return;
+    }
+
+    image_sample_t sample = image_sampler(p->src, p->wrap);
+
+    const int chunk = 64;
+    uint32_t texels[chunk];
+    while(w > 0) {
+      int n = min(w, chunk);
+      sample(p->src, u, du, v, dv, n, texels);
+      u += du * n;
+      v += dv * n;
+      w -= n;
+
+      for(int i = 0; i < n; i++) {
+        uint32_t c = texels[i];
+
+        if(MASKED) {
+          uint32_t m = *mask++;
+          c = _premul_mul_alpha_channel(_r(c), m) | (_premul_mul_alpha_channel(_g(c), m) << 8) |
+              (_premul_mul_alpha_channel(_b(c), m) << 16) | (_premul_mul_alpha_channel(_a(c), m) << 24);
+        }
+
+        if(OVER && _a(c) == 255) {
+          _store_pixel(dst, c);
+        }else if(!OVER || _a(c)) {
+          _store_pixel(dst, _blend<OVER>(fn, _load_pixel(dst), _r(c), _g(c), _b(c), _a(c)));
+        }
+        dst++;
+      }
+    }
+  }
+
+  template<typename D, bool MASKED>
+  static void image_span(image_t *target, brush_t *brush, int x, int y, int w, uint8_t *mask) {
+    if(target->_blend_func == blend_func_over) {
+      image_span<D, true, MASKED>(target, (image_brush_t*)brush, x, y, w, mask);
+    }else{
+      image_span<D, false, MASKED>(target, (image_brush_t*)brush, x, y, w, mask);
     }
   }
 
+  void image_brush_span_func(image_t *target, brush_t *brush, int x, int y, int w) {
+    image_span<uint32_t, false>(target, brush, x, y, w, nullptr);
+  }
+
+  void image_brush_masked_span_func(image_t *target, brush_t *brush, int x, int y, int w, uint8_t *mask) {
+    image_span<uint32_t, true>(target, brush, x, y, w, mask);
+  }
+
+  void image_brush_span_func_rgb565(image_t *target, brush_t *brush, int x, int y, int w) {
+    image_span<uint16_t, false>(target, brush, x, y, w, nullptr);
+  }
+
+  void image_brush_masked_span_func_rgb565(image_t *target, brush_t *brush, int x, int y, int w, uint8_t *mask) {
+    image_span<uint16_t, true>(target, brush, x, y, w, mask);
+  }
+
   image_brush_t::image_brush_t(image_t *src) : src(src) {
   }
 
-  image_brush_t::image_brush_t(image_t *src, mat3_t *transform) : src(src) {
+  image_brush_t::image_brush_t(image_t *src, mat3_t *transform, wrap_t wrap) : src(src), wrap(wrap) {
     if(transform) {
       inverse_transform = *transform;
       inverse_transform.inverse();
@@ -84,4 +224,12 @@ namespace picovector {
   masked_span_func_t image_brush_t::masked_span_func() {
     return image_brush_masked_span_func;
   }
-}
\ No newline at end of file
+
+  span_func_t image_brush_t::span_func_rgb565() {
+    return image_brush_span_func_rgb565;
+  }
+
+  masked_span_func_t image_brush_t::masked_span_func_rgb565() {
+    return image_brush_masked_span_func_rgb565;
+  }
+}
@@ -1,4 +1,5 @@
 #include "../brush.hpp"
+#include "../blit.hpp"
 
 namespace picovector {
 
@@ -44,57 +45,75 @@ namespace picovector {
     {0b11111111,0b11110111,0b11101011,0b11010101,0b10101010,0b11010101,0b11101011,0b11110111}
   };
 
-  void pattern_brush_span_func(image_t *target, brush_t *brush, int x, int y, int w) {
-    pattern_brush_t *p = (pattern_brush_t*)brush;
-    uint32_t *dst = (uint32_t*)target->ptr(x, y);
+  // D is the target's storage, OVER inlines a source over blend and MASKED
+  // scales each pixel by its coverage in mask
+  template<typename D, bool OVER, bool MASKED>
+  static void pattern_span(image_t *target, pattern_brush_t *p, int x, int y, int w, uint8_t *mask) {
+    D *dst = (D*)target->ptr(x, y);
     blend_func_t fn = target->_blend_func;
-
-    uint32_t c1c[4] = {_r(p->c1._p), _g(p->c1._p), _b(p->c1._p), _a(p->c1._p)};
-    uint32_t c2c[4] = {_r(p->c2._p), _g(p->c2._p), _b(p->c2._p), _a(p->c2._p)};
+    uint8_t bits = p->p[y & 0b111];
 
     while(w--) {
-      uint8_t u = 7 - (x & 0b111);
-      uint8_t v = y & 0b111;
-      uint8_t bit = p->p[v];
-
-      uint32_t *src = bit & (1 << u) ? c1c : c2c;
-
-      uint32_t r = src[0];
-      uint32_t g = src[1];
-      uint32_t b = src[2];
-      uint32_t a = src[3];
-
-      *dst = fn(*dst, r, g, b, a);
+      uint32_t c = bits & (0x80 >> (x & 0b111)) ? p->c1._p : p->c2._p;
+
+      if(MASKED) {
+        uint32_t m = *mask++;
+        c = _premul_mul_alpha_channel(_r(c), m) | (_premul_mul_alpha_channel(_g(c), m) << 8) |
+            (_premul_mul_alpha_channel(_b(c), m) << 16) | (_premul_mul_alpha_channel(_a(c), m) << 24);
+      }
+
+      if(OVER && _a(c) == 255) {
+        _store_pixel(dst, c);
+      }else if(!OVER || _a(c)) {
+        _store_pixel(dst, _blend<OVER>(fn, _load_pixel(dst), _r(c), _g(c), _b(c), _a(c)));
+      }
       dst++;
       x++;
     }
   }
 
-  void pattern_brush_masked_span_func(image_t *target, brush_t *brush, int x, int y, int w, uint8_t *mask) {
-    pattern_brush_t *p = (pattern_brush_t*)brush;
-    uint32_t *dst = (uint32_t*)target->ptr(x, y);
-    blend_func_t fn = target->_blend_func;
+  template<typename D, bool MASKED>
+  static void pattern_span(image_t *target, brush_t *brush, int x, int y, int w, uint8_t *mask) {
+    if(target->_blend_func == blend_func_over) {
+      pattern_span<D, true, MASKED>(target, (pattern_brush_t*)brush, x, y, w, mask);
+    }else{
+      pattern_span<D, false, MASKED>(target, (pattern_brush_t*)brush, x, y, w, mask);
+    }
+  }
 
-    uint32_t c1c[4] = {_r(p->c1._p), _g(p->c1._p), _b(p->c1._p), _a(p->c1._p)};
-    uint32_t c2c[4] = {_r(p->c2._p), _g(p->c2._p), _b(p->c2._p), _a(p->c2._p)};
+  void pattern_brush_span_func(image_t *target, brush_t *brush, int x, int y, int w) {
+    pattern_span<uint32_t, false>(target, brush, x, y, w, nullptr);
+  }
 
-    while(w--) {
-      uint8_t u = 7 - (x & 0b111);
-      uint8_t v = y & 0b111;
-      uint8_t bit = p->p[v];
+  void pattern_brush_masked_span_func(image_t *target, brush_t *brush, int x, int y, int w, uint8_t *mask) {
+    pattern_span<uint32_t, true>(target, brush, x, y, w, mask);
+  }
 
-      uint32_t *src = bit & (1 << u) ? c1c : c2c;
+  void pattern_brush_span_func_rgb565(image_t *target, brush_t *brush, int x, int y, int w) {
+    pattern_span<uint16_t, false>(target, brush, x, y, w, nullptr);
+  }
 
-      uint32_t m = *mask;
-      uint32_t r = (src[0] * m + 128) >> 8;
-      uint32_t g = (src[1] * m + 128) >> 8;
-      uint32_t b = (src[2] * m + 128) >> 8;
-      uint32_t a = (src[3] * m + 128) >> 8;
+  void pattern_brush_masked_span_func_rgb565(image_t *target, brush_t *brush, int x, int y, int w, uint8_t *mask) {
+    pattern_span<uint16_t, true>(target, brush, x, y, w, mask);
+  }
 
-      *dst = fn(*dst, r, g, b, a);
-      dst++;
+  // opaque patterns drawn source over onto an indexed target look both
+  // colours up once per span and write indices straight in, anything else
+  // goes through the adapter
+  void pattern_brush_span_func_pal8(image_t *target, brush_t *brush, int x, int y, int w) {
+    pattern_brush_t *p = (pattern_brush_t*)brush;
+    if(target->_blend_func != blend_func_over || _a(p->c1._p) != 255 || _a(p->c2._p) != 255) {
+      pal8_adapter_span_func(target, brush, x, y, w);
+      return;
+    }
+
+    uint8_t *dst = (uint8_t*)target->ptr(x, y);
+    uint8_t i1 = target->palette_index(p->c1._p);
+    uint8_t i2 = target->palette_index(p->c2._p);
+    uint8_t bits = p->p[y & 0b111];
+    while(w--) {
+      *dst++ = bits & (0x80 >> (x & 0b111)) ? i1 : i2;
       x++;
-      mask++;
     }
   }
 
@@ -114,4 +133,16 @@ namespace picovector {
     return pattern_brush_masked_span_func;
   }
 
+  span_func_t pattern_brush_t::span_func_rgb565() {
+    return pattern_brush_span_func_rgb565;
+  }
+
+  masked_span_func_t pattern_brush_t::masked_span_func_rgb565() {
+    return pattern_brush_masked_span_func_rgb565;
+  }
+
+  span_func_t pattern_brush_t::span_func_pal8() {
+    return pattern_brush_span_func_pal8;
+  }
+
 }
\ No newline at end of file
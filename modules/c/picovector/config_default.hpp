@@ -1,5 +1,12 @@
 #pragma once
-#define PICOVECTOR_STD_ALLOCATOR std::allocator
+
+#include <stdlib.h>
+
+#define PV_STD_ALLOCATOR std::allocator
 #define PV_MALLOC malloc
-#define PV_FREE free
-#define PV_REALLOC realloc
\ No newline at end of file
+#define PV_FREE pv_host_free
+#define PV_REALLOC realloc
+
+// the core passes sizes to PV_FREE when it isn't built for the pico, free()
+// doesn't want them
+static inline void pv_host_free(void *p, size_t = 0) {free(p);}
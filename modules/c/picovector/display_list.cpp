@@ -0,0 +1,175 @@
+#include <algorithm>
+#include <float.h>
+#include <string.h>
+
+#include "display_list.hpp"
+#include "shape.hpp"
+#include "font.hpp"
+#include "pixel_font.hpp"
+
+using std::min, std::max;
+
+namespace picovector {
+
+  uint8_t __attribute__((aligned(4))) band_buffer[band_buffer_size];
+
+  display_list_t::command_t &display_list_t::add(image_t *target, command_type_t type, rect_t bounds) {
+    commands.emplace_back();
+    command_t &c = commands.back();
+    c.type = type;
+    c.clip = target->clip();
+    c.bounds = bounds.intersection(c.clip);
+    c.brush = target->brush();
+    c.font = target->font();
+    c.pixel_font = target->pixel_font();
+    c.blend_func = target->_blend_func;
+    c.alpha = target->alpha();
+    c.antialias = target->antialias();
+    c.rasteriser = target->rasteriser();
+    c.owners[0] = c.owners[1] = c.owners[2] = nullptr;
+    c.shape = nullptr;
+    c.src = nullptr;
+    c.text = nullptr;
+    c.layout = nullptr;
+    return c;
+  }
+
+  rect_t display_list_t::shape_bounds(shape_t *shape, mat3_t *transform) {
+    float minx = FLT_MAX, miny = FLT_MAX, maxx = -FLT_MAX, maxy = -FLT_MAX;
+    for(auto p : shape->_points) {
+      if(transform) p = p.transform(transform);
+      minx = min(minx, p.x);
+      miny = min(miny, p.y);
+      maxx = max(maxx, p.x);
+      maxy = max(maxy, p.y);
+    }
+    if(minx > maxx) return rect_t(0, 0, 0, 0);
+
+    // a pixel of slack either side for antialiased edges, plus however far
+    // a stroke can reach past the path
+    float e = 1.0f;
+    if(shape->_stroke.width > 0.0f) {
+      e += stroke_extent(shape->_stroke) * (transform ? transform->max_scale() : 1.0f);
+    }
+    return rect_t(minx - e, miny - e, maxx - minx + e * 2, maxy - miny + e * 2).round();
+  }
+
+  void display_list_t::replay(command_t &c, image_t *band) {
+    band->clip(c.clip);
+    band->_blend_func = c.blend_func;
+    band->alpha(c.alpha);
+    band->antialias(c.antialias);
+    band->rasteriser(c.rasteriser);
+    band->font(c.font);
+    band->pixel_font(c.pixel_font);
+    if(c.brush) band->brush(c.brush);
+
+    switch(c.type) {
+      case RECTANGLE: {
+        band->rectangle(c.tr);
+      } break;
+
+      case SHAPE: {
+        band->draw(c.shape, &c.transform);
+      } break;
+
+      case BLIT: {
+        c.src->blit(band, c.p[0]);
+      } break;
+
+      case BLIT_RECT: {
+        c.src->blit(band, c.sr, c.tr);
+      } break;
+
+      case BLIT_TRANSFORM: {
+        c.src->blit(band, c.transform, c.size != 0.0f);
+      } break;
+
+      case TEXT: {
+        c.font->draw(band, c.text, c.p[0].x, c.p[0].y, c.size);
+      } break;
+
+      case PIXEL_TEXT: {
+        c.pixel_font->draw(band, c.text, c.p[0].x, c.p[0].y);
+      } break;
+
+      case TEXT_LAYOUT: {
+        c.layout->draw(band, c.p[0].x, c.p[0].y);
+      } break;
+
+      case LINE: {
+        band->line(c.p[0], c.p[1], c.size != 0.0f);
+      } break;
+
+      case CIRCLE: {
+        band->circle(c.p[0], c.size);
+      } break;
+
+      case TRIANGLE: {
+        band->triangle(c.p[0], c.p[1], c.p[2], c.size != 0.0f);
+      } break;
+
+      case ELLIPSE: {
+        band->ellipse(c.p[0], c.p[1].x, c.p[1].y, c.size != 0.0f);
+      } break;
+
+      case ROUND_RECTANGLE: {
+        band->round_rectangle(c.tr, c.p[0].x, c.size != 0.0f);
+      } break;
+
+      case RING: {
+        band->ring(c.p[0], c.size, c.p[1].x);
+      } break;
+    }
+  }
+
+  void display_list_t::flush(image_t *target) {
+    if(commands.empty()) return;
+
+    rect_t b = target->bounds();
+    size_t bpp = target->bytes_per_pixel();
+    size_t stride = b.w * bpp;
+    int band_h = max(1, int(band_buffer_size / stride));
+
+    // the band shares the target's format and palette, only its buffer and
+    // bounds move. the buffer pointer is offset so that the band can be
+    // addressed in target coordinates
+    image_t band = *target;
+    band._managed_buffer = false;
+    band._row_stride = stride;
+
+    for(int y = b.y; y < b.y + b.h; y += band_h) {
+      rect_t br(b.x, y, b.w, min(band_h, int(b.y + b.h) - y));
+
+      bool touched = false;
+      for(auto &c : commands) {
+        if(c.bounds.intersects(br)) {touched = true; break;}
+      }
+      if(!touched) continue;
+
+      int rows = br.h;
+      for(int row = 0; row < rows; row++) {
+        memcpy(&band_buffer[row * stride], target->ptr(b.x, y + row), stride);
+      }
+
+      band._buffer = band_buffer - (y * stride) - (int(b.x) * bpp);
+      band._bounds = br;
+
+      for(auto &c : commands) {
+        if(c.bounds.intersects(br)) {
+          replay(c, &band);
+        }
+      }
+
+      for(int row = 0; row < rows; row++) {
+        memcpy(target->ptr(b.x, y + row), &band_buffer[row * stride], stride);
+      }
+    }
+
+    // the band was drawn into in the target's place
+    target->_transparency = band._transparency;
+
+    commands.clear();
+  }
+
+}
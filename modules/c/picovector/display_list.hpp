@@ -0,0 +1,83 @@
+#pragma once
+
+#include <vector>
+
+#include "picovector.hpp"
+#include "image.hpp"
+#include "mat3.hpp"
+#include "types.hpp"
+#include "text_layout.hpp"
+
+namespace picovector {
+
+  // sram band that deferred frames are composited in, the target is read and
+  // written once per band rather than once per primitive
+  const size_t band_buffer_size = 16 * 1024;
+
+  // records draw calls made on an image and replays them band by band when
+  // flushed. every command keeps a snapshot of the target state it was
+  // recorded with so changing the pen or clip between calls behaves the same
+  // as drawing immediately. sources (shapes, images, text) are read when the
+  // list is flushed
+  class display_list_t {
+  public:
+    enum command_type_t {
+      RECTANGLE,
+      SHAPE,
+      BLIT,
+      BLIT_RECT,
+      BLIT_TRANSFORM,
+      TEXT,
+      PIXEL_TEXT,
+      TEXT_LAYOUT,
+      LINE,
+      CIRCLE,
+      TRIANGLE,
+      ELLIPSE,
+      ROUND_RECTANGLE,
+      RING
+    };
+
+    struct command_t {
+      command_type_t type;
+      rect_t         bounds; // area of the target touched
+
+      // target state when recorded
+      brush_t       *brush;
+      font_t        *font;
+      pixel_font_t  *pixel_font;
+      rect_t         clip;
+      blend_func_t   blend_func;
+      uint8_t        alpha;
+      antialias_t    antialias;
+      rasteriser_t   rasteriser;
+
+      // opaque references the caller wants held until the command has been
+      // replayed, the bindings use these to keep python objects reachable
+      void          *owners[3];
+
+      shape_t       *shape;
+      mat3_t         transform;
+      image_t       *src;
+      rect_t         sr, tr;
+      const char    *text;
+      text_layout_t *layout;
+      vec2_t         p[3];
+      float          size;   // text size, circle or ring radius, non zero for an antialiased line, triangle, ellipse or rounded rectangle or a bilinear blit
+    };
+
+    std::vector<command_t, PV_STD_ALLOCATOR<command_t>> commands;
+
+    // start a new command, snapshots the target's state and clips bounds
+    command_t &add(image_t *target, command_type_t type, rect_t bounds);
+
+    void flush(image_t *target);
+    bool empty() {return commands.empty();}
+
+    static rect_t shape_bounds(shape_t *shape, mat3_t *transform);
+
+  private:
+    void replay(command_t &c, image_t *band);
+  };
+
+}
@@ -0,0 +1,16 @@
+#pragma once
+
+namespace picovector {
+
+  // large solid fills are handed to a dma channel and left running. pixel
+  // access through image_t::ptr() (and so every draw, blit and buffer view)
+  // waits for the fill to land first, anything holding a raw pointer to the
+  // pixels (the display driver) calls fill_sync() before reading them
+  extern bool fill_pending;
+  void fill_wait();
+
+  inline void fill_sync() {
+    if(fill_pending) fill_wait();
+  }
+
+}
@@ -5,6 +5,10 @@
 
 #include "../picovector.hpp"
 #include "../image.hpp"
+#include "../profile.hpp"
+
+using std::min;
+using std::max;
 
 namespace picovector {
 
@@ -36,18 +40,110 @@ namespace picovector {
   }
 
 
+  // columns the vertical passes carry together. adjacent pixels share
+  // cache lines, so walking a block of them down the image reads each line
+  // once rather than once per column
+  #define BLUR_COLUMN_BLOCK 8
+
+  // the box kernel sums whole pixels two channels at a time, red and blue
+  // in one word and green and alpha in another, each in a 16 bit lane. a
+  // lane holds the sum of up to 257 pixels, which caps the radius
+  #define BLUR_BOX_MAX_RADIUS 127
+
+  static inline uint32_t box_even(uint32_t p) {return p & 0x00ff00ff;}
+  static inline uint32_t box_odd(uint32_t p) {return (p >> 8) & 0x00ff00ff;}
+
+  // the window's average, inv is 65536 / window rounded. it can't reach 256
+  // while the window is under 257 pixels
+  static inline uint32_t box_average(uint32_t even, uint32_t odd, uint32_t inv) {
+    uint32_t r = ((even & 0xffff) * inv + 0x8000) >> 16;
+    uint32_t b = ((even >> 16) * inv + 0x8000) >> 16;
+    uint32_t g = ((odd & 0xffff) * inv + 0x8000) >> 16;
+    uint32_t a = ((odd >> 16) * inv + 0x8000) >> 16;
+    return r | (g << 8) | (b << 16) | (a << 24);
+  }
+
+  // box filters n pixels, src_stride words apart, into dst. pixels
+  // past either end repeat the edge ones. the sums only ever grow before
+  // they shrink so no lane borrows from its neighbour
+  static void box_line(const uint32_t *src, int src_stride, uint32_t *dst, int dst_stride, int n, int radius, uint32_t inv) {
+    uint32_t even = 0, odd = 0;
+    for(int i = -radius; i <= radius; i++) {
+      uint32_t p = src[min(max(i, 0), n - 1) * src_stride];
+      even += box_even(p);
+      odd += box_odd(p);
+    }
+
+    for(int x = 0; x < n; x++) {
+      dst[x * dst_stride] = box_average(even, odd, inv);
+      uint32_t in = src[min(x + radius + 1, n - 1) * src_stride];
+      uint32_t out = src[max(x - radius, 0) * src_stride];
+      even = even + box_even(in) - box_even(out);
+      odd = odd + box_odd(in) - box_odd(out);
+    }
+  }
+
+  static void box_blur(image_t *image, int ax, int ay, int width, int height, int radius) {
+    uint32_t inv = (65536 + radius) / (radius * 2 + 1);
+    int stride = image->row_stride() / 4;
+
+    // each line is filtered from a copy of itself, columns a block at a
+    // time so that every row fetch covers whole cache lines
+    std::vector<uint32_t, PV_STD_ALLOCATOR<uint32_t>> line(max(width, height * BLUR_COLUMN_BLOCK));
+
+    for(int y = 0; y < height; y++) {
+      uint32_t *row = (uint32_t *)image->ptr(ax, ay + y);
+      memcpy(line.data(), row, width * 4);
+      box_line(line.data(), 1, row, 1, width, radius, inv);
+    }
+
+    for(int x = 0; x < width; x += BLUR_COLUMN_BLOCK) {
+      int n = min(BLUR_COLUMN_BLOCK, width - x);
+      uint32_t *column = (uint32_t *)image->ptr(ax + x, ay);
+      for(int y = 0; y < height; y++) {
+        memcpy(&line[y * BLUR_COLUMN_BLOCK], column + y * stride, n * 4);
+      }
+      for(int i = 0; i < n; i++) {
+        box_line(&line[i], BLUR_COLUMN_BLOCK, column + i, stride, height, radius, inv);
+      }
+    }
+  }
+
   void image_t::blur(float radius) {
+    this->blur(radius, _clip);
+  }
+
+  void image_t::blur(float radius, rect_t area, blur_kernel_t kernel) {
+    modified();
+    // filters operate on rgba8888 pixels only
+    if(_pixel_format != RGBA8888 || _has_palette) return;
+
     if (radius <= 0) return;
 
+    // only the part of area inside the clip is blurred
+    area = area.intersection(_clip).intersection(_bounds);
+    if(area.empty()) return;
+    profile_scope_t profile(PROFILE_FILTER, area.area());
+
+    if(kernel == BLUR_BOX) {
+      int r = min(int(radius + 0.5f), BLUR_BOX_MAX_RADIUS);
+      if(r > 0) {
+        box_blur(this, int(area.x), int(area.y), int(area.w), int(area.h), r);
+      }
+      return;
+    }
+
     const uint32_t k = blur_k_from_radius_q16(radius);
     if (k == 0) return;
 
-    int width = int(_bounds.w);
-    int height = int(_bounds.h);
+    int ax = int(area.x);
+    int ay = int(area.y);
+    int width = int(area.w);
+    int height = int(area.h);
 
     // ---- Horizontal pass: forward + backward (symmetric-ish) ----
     for (int y = 0; y < height; ++y) {
-        uint8_t* row = (uint8_t*)_buffer + (size_t)y * (size_t)_row_stride;
+        uint8_t* row = (uint8_t*)ptr(ax, ay + y);
 
         // Forward: left -> right
         int r = row[0], g = row[1], b = row[2], a = row[3];
@@ -79,39 +175,34 @@ namespace picovector {
         }
     }
 
-    // ---- Vertical pass: forward + backward (in-place, per column) ----
-    for (int x = 0; x < width; ++x) {
-        uint8_t* p0 = (uint8_t*)_buffer + x * 4;
+    // ---- Vertical pass: forward + backward, a block of columns at a time ----
+    // every channel of every column in the block has its own filter state,
+    // the bytes of a block row are filtered one after another
+    int s[BLUR_COLUMN_BLOCK * 4];
+    for (int x = 0; x < width; x += BLUR_COLUMN_BLOCK) {
+        int n = std::min(BLUR_COLUMN_BLOCK, width - x) * 4;
 
         // Forward: top -> bottom
-        int r = p0[0], g = p0[1], b = p0[2], a = p0[3];
+        uint8_t* p = (uint8_t*)ptr(ax + x, ay);
+        for (int i = 0; i < n; ++i) s[i] = p[i];
         for (int y = 1; y < height; ++y) {
-            uint8_t* p = (uint8_t*)_buffer + (size_t)y * (size_t)_row_stride + x * 4;
-            r = iir_step_q16(r, p[0], k);
-            g = iir_step_q16(g, p[1], k);
-            b = iir_step_q16(b, p[2], k);
-            a = iir_step_q16(a, p[3], k);
-            p[0] = (uint8_t)r;
-            p[1] = (uint8_t)g;
-            p[2] = (uint8_t)b;
-            p[3] = (uint8_t)a;
+            p += _row_stride;
+            for (int i = 0; i < n; ++i) {
+                s[i] = iir_step_q16(s[i], p[i], k);
+                p[i] = (uint8_t)s[i];
+            }
         }
 
         // Backward: bottom -> top
-        uint8_t* pb = (uint8_t*)_buffer + (size_t)(height - 1) * (size_t)_row_stride + x * 4;
-        r = pb[0]; g = pb[1]; b = pb[2]; a = pb[3];
+        for (int i = 0; i < n; ++i) s[i] = p[i];
         for (int y = height - 2; y >= 0; --y) {
-            uint8_t* p = (uint8_t*)_buffer + (size_t)y * (size_t)_row_stride + x * 4;
-            r = iir_step_q16(r, p[0], k);
-            g = iir_step_q16(g, p[1], k);
-            b = iir_step_q16(b, p[2], k);
-            a = iir_step_q16(a, p[3], k);
-            p[0] = (uint8_t)r;
-            p[1] = (uint8_t)g;
-            p[2] = (uint8_t)b;
-            p[3] = (uint8_t)a;
+            p -= _row_stride;
+            for (int i = 0; i < n; ++i) {
+                s[i] = iir_step_q16(s[i], p[i], k);
+                p[i] = (uint8_t)s[i];
+            }
         }
     }
   }
 
-}
\ No newline at end of file
+}
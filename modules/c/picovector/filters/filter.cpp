@@ -0,0 +1,70 @@
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <algorithm>
+
+#include "../picovector.hpp"
+#include "../image.hpp"
+#include "../profile.hpp"
+#include "pixel_filters.hpp"
+
+namespace picovector {
+
+  void image_t::filter(const filter_stage_t *stages, int count, rect_t area) {
+    modified();
+    // filters operate on rgba8888 pixels only
+    if(_pixel_format != RGBA8888 || _has_palette) return;
+
+    area = area.intersection(_clip).intersection(_bounds);
+    if(area.empty()) return;
+
+    int ax = int(area.x);
+    int ay = int(area.y);
+    int width = int(area.w);
+    int height = int(area.h);
+
+    int i = 0;
+    while(i < count) {
+      // blurs need their neighbours, they get passes of their own
+      if(stages[i].type == filter_stage_t::BLUR) {
+        this->blur(stages[i].radius, area, stages[i].kernel);
+        i++;
+        continue;
+      }
+
+      // a run of per pixel stages is applied a row at a time, so the row
+      // is fetched from the buffer once for all of them
+      int end = i;
+      while(end < count && stages[end].type != filter_stage_t::BLUR) {
+        end++;
+      }
+      profile_scope_t profile(PROFILE_FILTER, width * height);
+
+      for(int y = ay; y < ay + height; y++) {
+        uint8_t *row = (uint8_t *)ptr(ax, y);
+        for(int s = i; s < end; s++) {
+          uint8_t *p = row;
+          switch(stages[s].type) {
+            case filter_stage_t::MONOCHROME: {
+              for(int x = 0; x < width; x++, p += 4) filter_monochrome(p);
+            } break;
+
+            case filter_stage_t::ONEBIT: {
+              for(int x = 0; x < width; x++, p += 4) filter_onebit(p);
+            } break;
+
+            case filter_stage_t::DITHER: {
+              for(int x = ax; x < ax + width; x++, p += 4) filter_dither(p, x, y);
+            } break;
+
+            default: {
+            } break;
+          }
+        }
+      }
+
+      i = end;
+    }
+  }
+
+}
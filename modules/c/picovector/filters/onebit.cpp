@@ -8,20 +8,11 @@
 
 namespace picovector {
 
+  // the clipped part of the image, through filter() so window views and
+  // their row stride are handled there
   void image_t::onebit() {
-    int width = _bounds.w;
-    int height = _bounds.h;
-
-    for(int y = 0; y < height; y++) {
-      for(int x = 0; x < width; x++) {
-        int offset = ((y * width) + x) << 2;
-        uint8_t *p = (uint8_t*)(_buffer) + offset;
-
-        // luminence with green bias (crude but fast)
-        int pixel = (p[0] + (p[1] * 2) + p[2]) >> 2;
-        p[0] = p[1] = p[2] = (pixel > 128) ? 0xff : 0x00;
-      }
-    }
+    filter_stage_t stage = {filter_stage_t::ONEBIT, 0.0f, BLUR_IIR};
+    this->filter(&stage, 1, _clip);
   }
 
-}
\ No newline at end of file
+}
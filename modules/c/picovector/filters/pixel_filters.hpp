@@ -0,0 +1,48 @@
+#pragma once
+
+#include <stdint.h>
+
+namespace picovector {
+
+  // the per pixel filters, shared by the single filter methods and the
+  // fused rows of image_t::filter(). p is an rgba8888 pixel
+
+  // luminence with green bias (crude but fast)
+  inline int filter_luminance(const uint8_t *p) {
+    return (p[0] + (p[1] * 2) + p[2]) >> 2;
+  }
+
+  inline void filter_monochrome(uint8_t *p) {
+    p[0] = p[1] = p[2] = filter_luminance(p);
+  }
+
+  inline void filter_onebit(uint8_t *p) {
+    p[0] = p[1] = p[2] = (filter_luminance(p) > 128) ? 0xff : 0x00;
+  }
+
+  // 4x4 ordered dither to four grey levels
+  inline void filter_dither(uint8_t *p, int x, int y) {
+    static const uint8_t m[16] = {
+      0, 136, 34, 170,
+      204, 68, 238, 102,
+      51, 187, 17, 153,
+      255, 119, 221, 85
+    };
+
+    static const uint8_t ca[4] = {64, 191, 191, 255};
+    static const uint8_t cb[4] = {0, 64, 64, 191};
+
+    int pixel = filter_luminance(p);
+    int scale = m[((y & 0b11) << 2) | (x & 0b11)];
+
+    int a = ca[pixel >> 6];
+    int b = cb[pixel >> 6];
+
+    if(pixel > (b + ((a - b) * scale >> 8))) {
+      p[0] = p[1] = p[2] = a;
+    }else{
+      p[0] = p[1] = p[2] = b;
+    }
+  }
+
+}
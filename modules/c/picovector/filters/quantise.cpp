@@ -0,0 +1,137 @@
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <cmath>
+#include <algorithm>
+#include <vector>
+
+#include "../picovector.hpp"
+#include "../image.hpp"
+#include "../profile.hpp"
+
+using std::min;
+using std::max;
+
+namespace picovector {
+
+  // nearest colours are looked up from the top four bits of each channel
+  #define QUANTISE_LUT_BITS 4
+  #define QUANTISE_LUT_SIZE (1 << (QUANTISE_LUT_BITS * 3))
+
+  static inline int quantise_cell(int r, int g, int b) {
+    return ((r >> 4) << 8) | ((g >> 4) << 4) | (b >> 4);
+  }
+
+  static inline int clamp_channel(int v) {
+    return min(max(v, 0), 255);
+  }
+
+  void image_t::quantise(image_t *target, int colours, quantise_t mode) {
+    // rgba8888 in, indexed out
+    if(_pixel_format != RGBA8888 || _has_palette || !target->_has_palette) return;
+
+    colours = min(max(colours, 1), 256);
+    target->modified();
+    profile_scope_t profile(PROFILE_FILTER, _bounds.area());
+
+    // the nearest entry to the centre of every cell of the colour cube,
+    // built once for the whole image
+    std::vector<uint8_t, PV_STD_ALLOCATOR<uint8_t>> lut(QUANTISE_LUT_SIZE);
+    const palette_t &palette = target->_palette;
+    for(int i = 0; i < QUANTISE_LUT_SIZE; i++) {
+      int r = ((i >> 8) << 4) + 8;
+      int g = (((i >> 4) & 0xf) << 4) + 8;
+      int b = ((i & 0xf) << 4) + 8;
+      int best = 0;
+      int best_d = INT32_MAX;
+      for(int j = 0; j < colours; j++) {
+        uint32_t p = palette[j];
+        int dr = int(p & 0xff) - r;
+        int dg = int((p >> 8) & 0xff) - g;
+        int db = int((p >> 16) & 0xff) - b;
+        int d = dr * dr + dg * dg + db * db;
+        if(d < best_d) {
+          best_d = d;
+          best = j;
+        }
+      }
+      lut[i] = best;
+    }
+
+    int width = min(int(_bounds.w), int(target->_bounds.w));
+    int height = min(int(_bounds.h), int(target->_bounds.h));
+
+    // the bayer matrix from dither(), spread over roughly the gap between
+    // neighbouring colours of an evenly spaced palette of this size
+    static const uint8_t bayer[16] = {
+      0, 8, 2, 10,
+      12, 4, 14, 6,
+      3, 11, 1, 9,
+      15, 7, 13, 5
+    };
+    int spread = int(255.0f / max(1.0f, cbrtf(float(colours)) - 1.0f));
+
+    // diffused error is carried in three rows (this one and the two below)
+    // of three channels, with two columns of margin either side. this row
+    // also takes error pushed right of the current pixel
+    int row_size = (width + 4) * 3;
+    std::vector<int16_t, PV_STD_ALLOCATOR<int16_t>> errors;
+    if(mode == QUANTISE_FLOYD_STEINBERG || mode == QUANTISE_ATKINSON) {
+      errors.resize(row_size * 3);
+    }
+
+    for(int y = 0; y < height; y++) {
+      const uint8_t *src = (const uint8_t *)ptr(0, y);
+      uint8_t *dst = (uint8_t *)target->ptr(0, y);
+
+      if(mode == QUANTISE_NONE || mode == QUANTISE_ORDERED) {
+        const uint8_t *m = &bayer[(y & 3) << 2];
+        for(int x = 0; x < width; x++, src += 4) {
+          int o = mode == QUANTISE_ORDERED ? ((m[x & 3] * 2 + 1 - 16) * spread) >> 5 : 0;
+          dst[x] = lut[quantise_cell(clamp_channel(src[0] + o), clamp_channel(src[1] + o), clamp_channel(src[2] + o))];
+        }
+        continue;
+      }
+
+      int16_t *e0 = &errors[(y % 3) * row_size] + 6;
+      int16_t *e1 = &errors[((y + 1) % 3) * row_size] + 6;
+      int16_t *e2 = &errors[((y + 2) % 3) * row_size] + 6;
+
+      for(int x = 0; x < width; x++, src += 4) {
+        int16_t *e = &e0[x * 3];
+        int r = clamp_channel(src[0] + e[0]);
+        int g = clamp_channel(src[1] + e[1]);
+        int b = clamp_channel(src[2] + e[2]);
+
+        int index = lut[quantise_cell(r, g, b)];
+        dst[x] = index;
+
+        uint32_t p = palette[index];
+        int qe[3] = {r - int(p & 0xff), g - int((p >> 8) & 0xff), b - int((p >> 16) & 0xff)};
+        for(int c = 0; c < 3; c++) {
+          int16_t *below = &e1[x * 3 + c];
+          if(mode == QUANTISE_FLOYD_STEINBERG) {
+            e[c + 3]  += (qe[c] * 7) >> 4;
+            below[-3] += (qe[c] * 3) >> 4;
+            below[0]  += (qe[c] * 5) >> 4;
+            below[3]  += qe[c] >> 4;
+          }else{
+            // atkinson passes on three quarters of the error, an eighth to
+            // each of six neighbours
+            int d = qe[c] >> 3;
+            e[c + 3]  += d;
+            e[c + 6]  += d;
+            below[-3] += d;
+            below[0]  += d;
+            below[3]  += d;
+            e2[x * 3 + c] += d;
+          }
+        }
+      }
+
+      // this row's errors are spent, it becomes the second row below
+      memset(e0 - 6, 0, row_size * sizeof(int16_t));
+    }
+  }
+
+}
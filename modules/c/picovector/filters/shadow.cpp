@@ -0,0 +1,144 @@
+#include <cstdint>
+#include <cstring>
+#include <cmath>
+#include <algorithm>
+#include <vector>
+
+#include "../picovector.hpp"
+#include "../image.hpp"
+#include "../profile.hpp"
+#include "../shape.hpp"
+#include "../brush.hpp"
+
+using std::min;
+using std::max;
+
+namespace picovector {
+
+  // coverage is written straight into the a8 buffer, keeping the highest
+  // value where the shape's paths overlap
+  static void shadow_coverage_span_func(image_t *target, brush_t *brush, int x, int y, int w) {
+    memset(target->ptr(x, y), 255, w);
+  }
+
+  static void shadow_coverage_masked_span_func(image_t *target, brush_t *brush, int x, int y, int w, uint8_t *mask) {
+    uint8_t *p = (uint8_t *)target->ptr(x, y);
+    for(int i = 0; i < w; i++) {
+      p[i] = max(p[i], mask[i]);
+    }
+  }
+
+  class shadow_coverage_brush_t : public brush_t {
+  public:
+    span_func_t span_func() {return shadow_coverage_span_func;}
+    masked_span_func_t masked_span_func() {return shadow_coverage_masked_span_func;}
+  };
+
+  // running sum box blur of n a8 values stride apart, the line buffer holds
+  // a copy with radius zeros either side so the edges fade out
+  static void shadow_box_line(uint8_t *p, int stride, int n, int radius, uint8_t *line) {
+    memset(line, 0, radius);
+    memset(line + radius + n, 0, radius);
+    for(int i = 0; i < n; i++) {
+      line[radius + i] = p[i * stride];
+    }
+
+    uint32_t inv = (65536 + radius) / (radius * 2 + 1);
+    uint32_t sum = 0;
+    for(int i = 0; i < radius * 2; i++) {
+      sum += line[i];
+    }
+    for(int i = 0; i < n; i++) {
+      sum += line[i + radius * 2];
+      p[i * stride] = (sum * inv) >> 16;
+      sum -= line[i];
+    }
+  }
+
+  void image_t::shadow(shape_t *shape, vec2_t offset, float radius, int scale) {
+    brush_t *brush = this->brush();
+    if(!brush) return;
+    scale = max(scale, 1);
+    radius = max(radius, 0.0f);
+
+    // everything the blurred coverage can reach, limited to what can reach
+    // the clip
+    rect_t b = shape->bounds();
+    if(b.empty()) return;
+    int pad = int(ceilf(radius)) + scale;
+    int x1 = int(floorf(b.x + offset.x)) - pad;
+    int y1 = int(floorf(b.y + offset.y)) - pad;
+    int x2 = int(ceilf(b.x + b.w + offset.x)) + pad;
+    int y2 = int(ceilf(b.y + b.h + offset.y)) + pad;
+
+    rect_t area = rect_t(x1, y1, x2 - x1, y2 - y1).intersection(_clip).intersection(_bounds);
+    if(area.empty()) return;
+    profile_scope_t profile(PROFILE_FILTER, area.area());
+    x1 = max(x1, int(area.x) - pad);
+    y1 = max(y1, int(area.y) - pad);
+    x2 = min(x2, int(area.x + area.w) + pad);
+    y2 = min(y2, int(area.y + area.h) + pad);
+
+    // coverage at a fraction of the resolution, low res pixel i is centred
+    // on x1 + (i + 0.5) * scale
+    int lw = (x2 - x1 + scale - 1) / scale + 1;
+    int lh = (y2 - y1 + scale - 1) / scale + 1;
+    std::vector<uint8_t, PV_STD_ALLOCATOR<uint8_t>> coverage(lw * lh);
+
+    {
+      shadow_coverage_brush_t coverage_brush;
+      image_t canvas(coverage.data(), lw, lh, A8);
+      canvas.antialias(ANALYTIC);
+      canvas.brush(&coverage_brush);
+      canvas._span_func = shadow_coverage_span_func;
+      canvas._masked_span_func = shadow_coverage_masked_span_func;
+      mat3_t transform = mat3_t().scale(1.0f / scale).translate(offset.x - x1, offset.y - y1).multiply(shape->transform);
+      canvas.draw(shape, &transform);
+    }
+
+    // two box passes each way make a tent that's close enough to gaussian
+    // for a shadow, together they reach radius
+    int box = int(roundf(radius / (scale * 2)));
+    if(radius > 0.0f && box < 1) box = 1;
+    if(box > 0) {
+      std::vector<uint8_t, PV_STD_ALLOCATOR<uint8_t>> line(max(lw, lh) + box * 2);
+      for(int pass = 0; pass < 2; pass++) {
+        for(int y = 0; y < lh; y++) {
+          shadow_box_line(&coverage[y * lw], 1, lw, box, line.data());
+        }
+        for(int x = 0; x < lw; x++) {
+          shadow_box_line(&coverage[x], lw, lh, box, line.data());
+        }
+      }
+    }
+
+    modified();
+
+    // bilinear upsample a row at a time in 16.16, the pad leaves the
+    // outermost low res pixels empty so clamping at the edges is safe
+    std::vector<uint8_t, PV_STD_ALLOCATOR<uint8_t>> mask(int(area.w));
+    int step = 65536 / scale;
+    int u0 = (int(area.x) - x1) * step + step / 2 - 32768;
+    for(int y = area.y; y < area.y + area.h; y++) {
+      int v = (y - y1) * step + step / 2 - 32768;
+      int iy = v >> 16;
+      int fy = (v >> 8) & 0xff;
+      const uint8_t *r0 = &coverage[min(max(iy, 0), lh - 1) * lw];
+      const uint8_t *r1 = &coverage[min(max(iy + 1, 0), lh - 1) * lw];
+
+      int u = u0;
+      for(int i = 0; i < area.w; i++, u += step) {
+        int ix = u >> 16;
+        int fx = (u >> 8) & 0xff;
+        int xa = min(max(ix, 0), lw - 1);
+        int xb = min(max(ix + 1, 0), lw - 1);
+        int top = (r0[xa] << 8) + (r0[xb] - r0[xa]) * fx;
+        int bottom = (r1[xa] << 8) + (r1[xb] - r1[xa]) * fx;
+        mask[i] = ((top << 8) + (bottom - top) * fy) >> 16;
+      }
+
+      render_mask_row(this, brush, area.x, y, area.w, mask.data());
+    }
+  }
+
+}
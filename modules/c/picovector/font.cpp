@@ -36,31 +36,344 @@ namespace picovector {
     return rect_t(minx, miny, ceil(maxx) - minx, ceil(maxy) - miny);
   }
 
+  void font_t::build_index() {
+    sort(this->glyphs, this->glyphs + this->glyph_count, [](const glyph_t &a, const glyph_t &b) {
+      return a.codepoint < b.codepoint;
+    });
+
+    for(int i = 0; i < 256; i++) {
+      this->latin1[i] = -1;
+    }
+    for(int i = this->glyph_count - 1; i >= 0; i--) {
+      if(this->glyphs[i].codepoint < 256) {
+        this->latin1[this->glyphs[i].codepoint] = i;
+      }
+    }
+  }
+
+  int font_t::glyph_index(int codepoint) {
+    if(codepoint < 256) {
+      return this->latin1[codepoint];
+    }
+
+    int low = 0;
+    int high = this->glyph_count;
+    while(low < high) {
+      int mid = low + (high - low) / 2;
+      int compare = this->glyphs[mid].codepoint;
+      if(compare == codepoint) {
+        return mid;
+      }
+
+      if(compare < codepoint) {
+        low = mid + 1;
+      } else {
+        high = mid;
+      }
+    }
+
+    return -1;  // not found
+  }
+
+  uint32_t font_fallback_generation = 1;
+
+  bool font_t::resolve(int codepoint, font_t *&font, int &index) {
+    font = this;
+    index = this->glyph_index(codepoint);
+    if(index != -1 || !this->fallback) {
+      return index != -1;
+    }
+
+    auto e = this->fallback_cache.lookup(codepoint);
+    if(!e) {
+      font_t *f = this->fallback;
+      int i = -1;
+      for(; f; f = f->fallback) {
+        i = f->glyph_index(codepoint);
+        if(i != -1) {
+          break;
+        }
+      }
+      this->fallback_cache.store(codepoint, f, i);
+      e = this->fallback_cache.lookup(codepoint);
+    }
+
+    font = e->font;
+    index = e->index;
+    return index != -1;
+  }
+
+  /*
+    rasterised glyph cache. each glyph is drawn once per size, antialias
+    level and quarter pixel caret offset as a coverage bitmap, which later
+    draws hand row by row to the target's brush the same way the rasteriser
+    would. bitmaps live in one fixed pool per font, when it or the entry
+    table is full the least recently used glyphs make room
+  */
+  const int GLYPH_CACHE_ENTRIES = 128;
+  const int GLYPH_CACHE_BUCKETS = 64;
+  const size_t GLYPH_CACHE_POOL_SIZE = 16 * 1024;
+
+  struct glyph_cache_entry_t {
+    uint32_t key;     // glyph index, antialias level and subpixel offsets
+    float size;
+    int16_t x, y;     // bitmap position relative to the caret's pixel
+    uint16_t w, h;
+    uint32_t offset;  // of the bitmap in the pool
+    uint32_t used;    // when last drawn, 0 for an empty entry
+    int16_t next;     // in its hash bucket's chain
+  };
+
+  class glyph_cache_t {
+  public:
+    glyph_cache_entry_t entries[GLYPH_CACHE_ENTRIES];
+    int16_t buckets[GLYPH_CACHE_BUCKETS];
+    // live entries in order of pool offset, for finding room
+    int16_t order[GLYPH_CACHE_ENTRIES];
+    int count = 0;
+    uint32_t tick = 0;
+    uint8_t pool[GLYPH_CACHE_POOL_SIZE];
+
+    glyph_cache_t() {
+      for(int i = 0; i < GLYPH_CACHE_BUCKETS; i++) buckets[i] = -1;
+      for(int i = 0; i < GLYPH_CACHE_ENTRIES; i++) entries[i].used = 0;
+    }
+
+    static int bucket(uint32_t key, float size) {
+      uint32_t bits;
+      memcpy(&bits, &size, sizeof(bits));
+      return ((key ^ bits ^ (bits >> 13)) * 2654435761u) >> 26;
+    }
+
+    glyph_cache_entry_t *find(uint32_t key, float size) {
+      for(int i = buckets[bucket(key, size)]; i != -1; i = entries[i].next) {
+        glyph_cache_entry_t *e = &entries[i];
+        if(e->key == key && e->size == size) {
+          e->used = ++tick;
+          return e;
+        }
+      }
+      return nullptr;
+    }
+
+    void evict(int i) {
+      glyph_cache_entry_t *e = &entries[i];
+      int16_t *link = &buckets[bucket(e->key, e->size)];
+      while(*link != i) link = &entries[*link].next;
+      *link = e->next;
+      e->used = 0;
+
+      int o = 0;
+      while(order[o] != i) o++;
+      memmove(&order[o], &order[o + 1], (count - o - 1) * sizeof(int16_t));
+      count--;
+    }
+
+    void evict_oldest() {
+      int oldest = order[0];
+      for(int o = 1; o < count; o++) {
+        if(entries[order[o]].used < entries[oldest].used) oldest = order[o];
+      }
+      evict(oldest);
+    }
+
+    // the first gap in the pool that fits, as an index into order
+    bool room(size_t bytes, int &o, uint32_t &offset) {
+      uint32_t end = 0;
+      for(o = 0; o < count; o++) {
+        glyph_cache_entry_t *e = &entries[order[o]];
+        if(e->offset - end >= bytes) break;
+        end = e->offset + e->w * e->h;
+      }
+      offset = end;
+      return o < count || GLYPH_CACHE_POOL_SIZE - end >= bytes;
+    }
+
+    glyph_cache_entry_t *insert(uint32_t key, float size, int x, int y, int w, int h) {
+      if(count == GLYPH_CACHE_ENTRIES) evict_oldest();
+
+      int o;
+      uint32_t offset;
+      while(!room(w * h, o, offset)) evict_oldest();
+
+      int i = 0;
+      while(entries[i].used) i++;
+      glyph_cache_entry_t *e = &entries[i];
+      *e = {key, size, int16_t(x), int16_t(y), uint16_t(w), uint16_t(h), offset, ++tick, -1};
+
+      int b = bucket(key, size);
+      e->next = buckets[b];
+      buckets[b] = i;
+      memmove(&order[o + 1], &order[o], (count - o) * sizeof(int16_t));
+      order[o] = i;
+      count++;
+      return e;
+    }
+  };
+
+  // writes coverage into the a8 bitmaps as it is, each pixel of a glyph is
+  // only visited once
+  static void glyph_coverage_span_func(image_t *target, brush_t *brush, int x, int y, int w) {
+    memset(target->ptr(x, y), 255, w);
+  }
+
+  static void glyph_coverage_masked_span_func(image_t *target, brush_t *brush, int x, int y, int w, uint8_t *mask) {
+    memcpy(target->ptr(x, y), mask, w);
+  }
+
+  class glyph_coverage_brush_t : public brush_t {
+  public:
+    span_func_t span_func() {return glyph_coverage_span_func;}
+    masked_span_func_t masked_span_func() {return glyph_coverage_masked_span_func;}
+  };
+
+  void font_t::draw_glyph(image_t *target, int index, mat3_t *transform, float size) {
+    glyph_t *glyph = &this->glyphs[index];
+    if(!glyph->path_count) return;
+
+    // the caret's pixel and which quarter of it the glyph starts in
+    int px = floorf(transform->v02);
+    int py = floorf(transform->v12);
+    int qx = int((transform->v02 - px) * 4.0f) & 3;
+    int qy = int((transform->v12 - py) * 4.0f) & 3;
+    uint32_t key = index | (uint32_t(target->antialias()) << 16) | (qx << 20) | (qy << 22);
+
+    if(!this->cache) {
+      PV_ALLOC_SCOPE(PV_ALLOC_FONT);
+      this->cache = new(PV_MALLOC(sizeof(glyph_cache_t))) glyph_cache_t();
+    }
+
+    glyph_cache_entry_t *e = this->cache->find(key, size);
+    if(!e) {
+      mat3_t local = *transform;
+      local.v02 = qx * 0.25f;
+      local.v12 = qy * 0.25f;
+      rect_t b = glyph->bounds(&local);
+      int bx = int(floorf(b.x)) - 1;
+      int by = int(floorf(b.y)) - 1;
+      int bw = int(ceilf(b.x + b.w)) + 1 - bx;
+      int bh = int(ceilf(b.y + b.h)) + 1 - by;
+
+      // big glyphs would push everything else out, they're drawn directly
+      if(size_t(bw * bh) > GLYPH_CACHE_POOL_SIZE / 4) {
+        render_glyph(glyph, target, transform, target->brush());
+        return;
+      }
+
+      e = this->cache->insert(key, size, bx, by, bw, bh);
+      uint8_t *bits = &this->cache->pool[e->offset];
+      memset(bits, 0, bw * bh);
+
+      glyph_coverage_brush_t coverage;
+      image_t bitmap(bits, bw, bh, A8);
+      bitmap.antialias(target->antialias());
+      bitmap.brush(&coverage);
+      bitmap._span_func = glyph_coverage_span_func;
+      bitmap._masked_span_func = glyph_coverage_masked_span_func;
+      local.v02 -= bx;
+      local.v12 -= by;
+      render_glyph(glyph, &bitmap, &local, &coverage);
+    }
+
+    // composited through the same row function as the rasteriser uses
+    int tx = px + e->x;
+    int ty = py + e->y;
+    rect_t r = rect_t(tx, ty, e->w, e->h).intersection(target->clip()).intersection(target->bounds());
+    if(r.empty()) return;
+
+    uint8_t *bits = &this->cache->pool[e->offset];
+    for(int y = r.y; y < r.y + r.h; y++) {
+      render_mask_row(target, target->brush(), r.x, y, r.w, bits + (y - ty) * e->w + (int(r.x) - tx));
+    }
+  }
+
+  void font_t::free_cache() {
+    if(this->cache) {
+      this->cache->~glyph_cache_t();
+#ifdef PICO
+      PV_FREE(this->cache);
+#else
+      PV_FREE(this->cache, sizeof(glyph_cache_t));
+#endif
+      this->cache = nullptr;
+    }
+  }
+
+  int font_t::kerning(int left, int right) {
+    if(!this->kerning_count) {
+      return 0;
+    }
+
+    uint32_t pair = uint32_t(left) << 16 | uint32_t(right);
+    int low = 0;
+    int high = this->kerning_count;
+    while(low < high) {
+      int mid = low + (high - low) / 2;
+      uint32_t compare = this->kerning_pairs[mid].pair;
+      if(compare == pair) {
+        return this->kerning_pairs[mid].adjust;
+      }
+
+      if(compare < pair) {
+        low = mid + 1;
+      } else {
+        high = mid;
+      }
+    }
+
+    return 0;
+  }
+
   rect_t font_t::measure(image_t *target, const char *text, float size) {
-    rect_t r =  {0, 0, 0, 0};
+    // fnv-1a, the length and hash together pick out the string
+    uint32_t hash = 2166136261u;
+    uint32_t length = 0;
+    for(const char *p = text; *p != '\0'; p++, length++) {
+      hash = (hash ^ uint8_t(*p)) * 16777619u;
+    }
 
-    mat3_t transform;
-    transform = transform.scale(size / 128.0f, size / 128.0f);
+    // advances only depend on the text, so one entry serves every size.
+    // changing a fallback anywhere makes them stale
+    auto e = &this->measure_cache.entries[hash & (font_measure_cache_t::SIZE - 1)];
+    if(e->generation != font_fallback_generation || e->hash != hash || e->length != length) {
+      int units = 0;
+      font_t *last_font = nullptr;
+      int last = 0;
+
+      auto glyph = [&](int codepoint) {
+        font_t *font;
+        int j;
+        if(this->resolve(codepoint, font, j)) {
+          if(font == last_font) {
+            units += font->kerning(last, codepoint);
+          }
+          units += font->glyphs[j].advance;
+          last_font = font;
+          last = codepoint;
+        }
+      };
 
-    for(size_t i = 0; i < strlen(text); i++) {
-      char c = text[i];
-      // find the glyph
-      for(int j = 0; j < this->glyph_count; j++) {
-        if(this->glyphs[j].codepoint == uint16_t(c)) {
-          float a = this->glyphs[j].advance;
-          transform = transform.translate(a, 0);
-          vec2_t caret(1, 1);
-          caret = caret.transform(transform);
-          r.w = max(r.w, caret.x);
-          r.h = max(r.y, caret.y);
+      // runs of ascii skip the decoder
+      while(*text != '\0') {
+        for(const char *end = text + ascii_run(text); text < end; text++) {
+          glyph(*text);
+        }
+        if(*text != '\0') {
+          glyph(utf8_next(text));
         }
       }
+
+      e->hash = hash;
+      e->length = length;
+      e->generation = font_fallback_generation;
+      e->units = units;
     }
 
-    return r;
+    return rect_t(0, 0, e->units * size / 128.0f, size);
   }
 
   void font_t::draw(image_t *target, const char *text, float x, float y, float size) {
+    target->modified();
     vec2_t caret(x, y);
 
     mat3_t transform;
@@ -69,15 +382,31 @@ namespace picovector {
     transform = transform.scale(size / 128.0f, size / 128.0f);
 
 
-    for(size_t i = 0; i < strlen(text); i++) {
-      char c = text[i];
-      // find the glyph
-      for(int j = 0; j < this->glyph_count; j++) {
-        if(this->glyphs[j].codepoint == uint16_t(c)) {
-          render_glyph(&this->glyphs[j], target, &transform, target->brush());
-          float a = this->glyphs[j].advance;
-          transform = transform.translate(a, 0);
+    font_t *last_font = nullptr;
+    int last = 0;
+    auto glyph = [&](int codepoint) {
+      font_t *font;
+      int j;
+      if(this->resolve(codepoint, font, j)) {
+        int k = font == last_font ? font->kerning(last, codepoint) : 0;
+        if(k) {
+          transform = transform.translate(k, 0);
         }
+        font->draw_glyph(target, j, &transform, size);
+        float a = font->glyphs[j].advance;
+        transform = transform.translate(a, 0);
+        last_font = font;
+        last = codepoint;
+      }
+    };
+
+    // runs of ascii skip the decoder
+    while(*text != '\0') {
+      for(const char *end = text + ascii_run(text); text < end; text++) {
+        glyph(*text);
+      }
+      if(*text != '\0') {
+        glyph(utf8_next(text));
       }
     }
   }
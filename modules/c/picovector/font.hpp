@@ -7,6 +7,7 @@
 #include "shape.hpp"
 #include "types.hpp"
 #include "mat3.hpp"
+#include "text.hpp"
 
 namespace picovector {
 
@@ -36,13 +37,64 @@ namespace picovector {
     rect_t bounds(mat3_t *transform);
   };
 
+  // adjustment to the advance between a pair of glyphs, in font units.
+  // pair is the left codepoint << 16 | the right one
+  struct font_kerning_t {
+    uint32_t pair;
+    int8_t adjust;
+  };
+
+  // a measured string, keyed on a hash of its bytes
+  struct font_measure_cache_t {
+    static const int SIZE = 16;
+
+    struct entry_t {
+      uint32_t hash;
+      uint32_t length;
+      uint32_t generation;
+      int units;          // total advance in font units
+    } entries[SIZE];
+  };
+
+  class glyph_cache_t;
+
   class font_t {
   public:
     int glyph_count;
-    glyph_t *glyphs;
+    glyph_t *glyphs;   // sorted by codepoint once built
+    // glyph indices for codepoints below 256, -1 where there's no glyph,
+    // anything above is binary searched
+    int16_t latin1[256];
+
+    // sorts the glyphs and fills in latin1, called once they're loaded
+    void build_index();
+    int glyph_index(int codepoint);
+
+    // font to take glyphs from when this one doesn't have them, which may
+    // have a fallback of its own
+    font_t *fallback;
+    fallback_cache_t<font_t> fallback_cache;
+
+    // finds the font and glyph index used to draw codepoint, following the
+    // fallback chain, returns false if nothing in the chain has it
+    bool resolve(int codepoint, font_t *&font, int &index);
+
+    // kerning pairs sorted by pair, kerning_count may be zero
+    font_kerning_t *kerning_pairs;
+    int kerning_count;
+    int kerning(int left, int right);
+
+    // recently measured strings
+    font_measure_cache_t measure_cache;
+
+    // rasterised glyphs, made on first draw, free_cache() lets go of them
+    glyph_cache_t *cache;
 
     void draw(image_t *target, const char *text, float x, float y, float size);
+    void draw_glyph(image_t *target, int index, mat3_t *transform, float size);
+    // the advance of text by the line height, size by size
     rect_t measure(image_t *target, const char *text, float size);
+    void free_cache();
   };
 
 }
\ No newline at end of file
@@ -0,0 +1,60 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <chrono>
+#include <algorithm>
+#include <vector>
+
+#include "picovector.hpp"
+#include "image.hpp"
+#include "cases.hpp"
+
+using namespace picovector;
+
+// times every render case, or every case in group, on the host
+//
+//   picovector_bench [group] [--iterations <n>]
+//
+// each case is drawn n times (50 by default) after one untimed warm up, the
+// fastest and median times are reported so runs can be compared before and
+// after a change. a case is timed whole, filters include drawing the picture
+// they work on. build with CMAKE_BUILD_TYPE=RelWithDebInfo to profile under
+// perf or valgrind
+
+int main(int argc, char **argv) {
+  const char *group = nullptr;
+  int iterations = 50;
+
+  for(int i = 1; i < argc; i++) {
+    if(strcmp(argv[i], "--iterations") == 0 && i + 1 < argc) {
+      iterations = std::max(1, atoi(argv[++i]));
+    }else{
+      group = argv[i];
+    }
+  }
+
+  image_t target(320, 240);
+  std::vector<double> times(iterations);
+
+  printf("%-28s %10s %10s\n", "case", "min us", "median us");
+  for(int i = 0; i < render_case_count; i++) {
+    const render_case_t &c = render_cases[i];
+    if(group && !in_group(c, group)) continue;
+
+    reset_target(&target);
+    c.draw(&target);
+
+    for(int n = 0; n < iterations; n++) {
+      reset_target(&target);
+      auto start = std::chrono::steady_clock::now();
+      c.draw(&target);
+      auto end = std::chrono::steady_clock::now();
+      times[n] = std::chrono::duration<double, std::micro>(end - start).count();
+    }
+
+    std::sort(times.begin(), times.end());
+    printf("%-28s %10.1f %10.1f\n", c.name, times[0], times[iterations / 2]);
+  }
+
+  return 0;
+}
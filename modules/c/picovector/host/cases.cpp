@@ -0,0 +1,379 @@
+#include <math.h>
+
+#include "picovector.hpp"
+#include "image.hpp"
+#include "shape.hpp"
+#include "primitive.hpp"
+#include "brush.hpp"
+#include "color.hpp"
+#include "mat3.hpp"
+#include "cases.hpp"
+
+namespace picovector {
+
+  void reset_target(image_t *target) {
+    color_brush_t backdrop(rgb_color_t(16, 24, 32, 255));
+    target->clip(target->bounds());
+    target->alpha(255);
+    target->antialias(OFF);
+    target->rasteriser(FLOAT);
+    target->brush(&backdrop);
+    target->clear();
+    target->brush(nullptr);
+  }
+
+  // every case builds its shapes afresh, primitives keep the tolerance they
+  // were last flattened with and would otherwise carry it between cases
+
+  // circles, polygons and curved primitives overlapping at varying alpha
+  static void scene_shapes(image_t *target) {
+    color_brush_t red(rgb_color_t(230, 60, 40, 255));
+    color_brush_t green(rgb_color_t(60, 200, 90, 160));
+    color_brush_t blue(rgb_color_t(50, 110, 240, 200));
+    shape_t s(1);
+
+    target->brush(&red);
+    for(int i = 0; i < 12; i++) {
+      target->draw(set_circle(&s, 20.0f + i * 25.3f, 40.0f + (i % 3) * 18.7f, 4.0f + i * 1.7f));
+    }
+    target->brush(&green);
+    target->draw(set_star(&s, 90.0f, 160.0f, 7, 60.0f, 25.0f));
+    target->draw(set_squircle(&s, 230.5f, 150.25f, 55.0f, 5.0f));
+    target->brush(&blue);
+    target->draw(set_regular_polygon(&s, 160.0f, 120.0f, 9, 70.0f));
+    target->draw(set_rounded_rectangle(&s, 200.0f, 20.0f, 100.0f, 60.0f, 4.0f, 12.0f, 20.0f, 0.0f));
+    target->draw(set_arc(&s, 60.0f, 200.0f, 20.0f, 300.0f, 15.0f, 30.0f));
+    target->draw(set_pie(&s, 280.0f, 210.0f, -40.0f, 200.0f, 28.0f));
+  }
+
+  // stroked and rotated paths, thin slivers and a wavy outline with many
+  // more edges than pixels
+  static void scene_paths(image_t *target) {
+    color_brush_t white(rgb_color_t(255, 255, 255, 255));
+    color_brush_t amber(rgb_color_t(250, 180, 30, 220));
+    target->brush(&white);
+
+    shape_t wave(1);
+    wave.begin_path();
+    for(int i = 0; i < 3000; i++) {
+      float t = i * float(M_PI * 2) / 3000.0f;
+      float r = 80.0f + 8.0f * sinf(t * 150.0f);
+      wave.add_point(160.0f + r * cosf(t), 120.0f + r * sinf(t));
+    }
+    target->draw(&wave);
+
+    target->brush(&amber);
+    shape_t outline(1);
+    outline.begin_path();
+    for(int i = 0; i < 200; i++) {
+      float t = i * float(M_PI * 2) / 200.0f;
+      float r = 100.0f + 25.0f * sinf(t * 5.0f);
+      outline.add_point(160.0f + r * cosf(t), 120.0f + r * sinf(t));
+    }
+    outline.stroke(3.5f, JOIN_ROUND);
+    target->draw(&outline);
+
+    shape_t zigzag(1);
+    zigzag.begin_path(false);
+    for(int i = 0; i < 30; i++) {
+      zigzag.add_point(10.0f + i * 10.3f, (i & 1) ? 235.0f : 200.0f);
+    }
+    zigzag.stroke(1.5f, JOIN_MITER, CAP_SQUARE);
+    target->draw(&zigzag);
+
+    shape_t bar(1);
+    mat3_t m;
+    m.translate(60.0f, 60.0f).rotate(33.0f).scale(1.5f, 0.75f);
+    target->draw(set_rectangle(&bar, -30.0f, -10.0f, 60.0f, 20.0f), &m);
+    target->draw(set_line(&bar, 5.0f, 5.0f, 315.0f, 12.0f, 0.6f));
+  }
+
+  template<rasteriser_t R, antialias_t A, void (*scene)(image_t *)>
+  static void shapes_with(image_t *target) {
+    target->rasteriser(R);
+    target->antialias(A);
+    scene(target);
+  }
+
+  // the image_t drawing calls that don't go through a shape
+  static void draw_rectangles(image_t *target) {
+    color_brush_t a(rgb_color_t(200, 40, 90, 255));
+    color_brush_t b(rgb_color_t(40, 200, 190, 128));
+    target->brush(&a);
+    target->rectangle(rect_t(10, 10, 120, 80));
+    target->round_rectangle(rect_t(150, 10, 150, 80), 18);
+    target->round_rectangle(rect_t(150, 100, 150, 80), 25, true);
+    target->brush(&b);
+    target->rectangle(rect_t(60, 50, 120, 150));
+    target->fill(rect_t(5, 200, 50, 30), 0xff00ff00);
+  }
+
+  static void draw_triangles(image_t *target) {
+    color_brush_t a(rgb_color_t(240, 240, 60, 255));
+    color_brush_t b(rgb_color_t(60, 90, 240, 190));
+    target->brush(&a);
+    target->triangle(vec2_t(10, 10), vec2_t(150, 40), vec2_t(40, 220));
+    target->triangle(vec2_t(300, 5), vec2_t(310, 230), vec2_t(160.5f, 120.25f), true);
+    target->brush(&b);
+    target->triangle(vec2_t(80, 100), vec2_t(250, 60), vec2_t(200, 235), true);
+  }
+
+  static void draw_ellipses(image_t *target) {
+    color_brush_t a(rgb_color_t(255, 120, 0, 255));
+    color_brush_t b(rgb_color_t(0, 180, 255, 170));
+    target->brush(&a);
+    target->circle(vec2_t(60, 60), 45);
+    target->ring(vec2_t(160, 60), 45, 8);
+    target->ellipse(vec2_t(260, 60), 50, 30);
+    target->brush(&b);
+    target->ellipse(vec2_t(100, 170), 90, 50, true);
+    target->circle(vec2_t(250, 170), 3);
+    target->ring(vec2_t(250, 170), 60, 1);
+  }
+
+  static void draw_lines(image_t *target) {
+    color_brush_t a(rgb_color_t(255, 255, 255, 255));
+    color_brush_t b(rgb_color_t(255, 60, 60, 200));
+    target->brush(&a);
+    for(int i = 0; i < 16; i++) {
+      float t = i * float(M_PI) / 16.0f;
+      target->line(vec2_t(80, 120), vec2_t(80 + 75 * cosf(t), 120 + 75 * sinf(t)));
+    }
+    target->brush(&b);
+    for(int i = 0; i < 16; i++) {
+      float t = i * float(M_PI) / 16.0f;
+      target->line(vec2_t(240, 120), vec2_t(240 + 75 * cosf(t), 120 - 75 * sinf(t)), true);
+    }
+    for(int x = 0; x < 320; x += 3) {
+      target->put(x, (x * 7) % 240);
+    }
+  }
+
+  static void draw_plots(image_t *target) {
+    color_brush_t a(rgb_color_t(90, 250, 120, 255));
+    color_brush_t b(rgb_color_t(250, 90, 200, 160));
+    float samples[64];
+    int16_t counts[24];
+    for(int i = 0; i < 64; i++) {
+      samples[i] = sinf(i * 0.2f) + 0.3f * cosf(i * 0.9f);
+    }
+    for(int i = 0; i < 24; i++) {
+      counts[i] = int16_t((i * 37) % 100);
+    }
+    target->brush(&a);
+    target->plot(samples, 64, rect_t(10, 10, 300, 70), -1.5f, 1.5f, PLOT_LINE);
+    target->plot(counts, 24, rect_t(10, 160, 300, 70), 0.0f, 100.0f, PLOT_BARS);
+    target->brush(&b);
+    target->plot(samples, 64, rect_t(10, 90, 300, 60), -1.5f, 1.5f, PLOT_AREA);
+  }
+
+  // a small sprite with a transparent border, a translucent middle and an
+  // opaque core, blitted every way image_t offers
+  static void draw_blits(image_t *target) {
+    image_t sprite(24, 24);
+    color_brush_t mid(rgb_color_t(255, 200, 0, 128));
+    color_brush_t core(rgb_color_t(255, 40, 120, 255));
+    sprite.fill(sprite.bounds(), 0);
+    sprite.brush(&mid);
+    sprite.circle(vec2_t(12, 12), 11);
+    sprite.brush(&core);
+    sprite.rectangle(rect_t(8, 8, 8, 8));
+
+    sprite.blit(target, vec2_t(10, 10));
+    sprite.blit(target, rect_t(50, 10, 60, 40));
+    sprite.blit(target, rect_t(0, 0, 12, 24), rect_t(130, 10, -36, 72));
+
+    mat3_t m;
+    m.translate(220.0f, 60.0f).rotate(25.0f).scale(3.0f);
+    sprite.blit(target, m);
+    m = mat3_t();
+    m.translate(100.0f, 150.0f).rotate(-40.0f).scale(2.5f, 3.5f);
+    sprite.blit(target, m, true);
+
+    int16_t sprites[] = {
+      0, 0, 24, 24, 10, 200, 0,
+      0, 0, 24, 24, 40, 200, 1,
+      4, 4, 16, 16, 70, 205, 2
+    };
+    sprite.blit_sprites(target, sprites, 3, 7);
+
+    // compiled sprites take the run skipping path
+    sprite.compile();
+    sprite.blit(target, vec2_t(280, 10));
+    sprites[4] += 100;
+    sprites[11] += 100;
+    sprites[18] += 100;
+    sprite.blit_sprites(target, sprites, 3, 7);
+  }
+
+  static void draw_gradients(image_t *target) {
+    gradient_stop_t stops[] = {
+      {0.0f, 0xff2040f0},
+      {0.4f, 0xff20e0f0},
+      {1.0f, 0x80f02080}
+    };
+    linear_gradient_brush_t linear(vec2_t(0, 0), vec2_t(320, 100), stops, 3);
+    radial_gradient_brush_t radial(vec2_t(200, 150), 60.0f, stops, 3, WRAP_MIRROR);
+    shape_t s(1);
+    target->brush(&linear);
+    target->rectangle(rect_t(0, 0, 320, 100));
+    target->brush(&radial);
+    target->antialias(X4);
+    target->draw(set_circle(&s, 200.0f, 150.0f, 85.0f));
+  }
+
+  static void draw_patterns(image_t *target) {
+    image_t tile(16, 16);
+    for(int i = 0; i < 4; i++) {
+      color_brush_t c(rgb_color_t(60 * i, 255 - 60 * i, 128, 255));
+      tile.brush(&c);
+      tile.rectangle(rect_t((i & 1) * 8, (i >> 1) * 8, 8, 8));
+    }
+    tile.brush(nullptr);
+
+    shape_t s(1);
+    for(int i = 0; i < 6; i++) {
+      pattern_brush_t p(rgb_color_t(255, 255, 255, 255), rgb_color_t(200, 30, 30, 160), i * 6);
+      target->brush(&p);
+      target->rectangle(rect_t(5 + i * 52, 5, 48, 60));
+    }
+
+    mat3_t m;
+    m.rotate(20.0f).scale(1.5f);
+    image_brush_t tiled(&tile, &m);
+    target->brush(&tiled);
+    target->antialias(X2);
+    target->draw(set_star(&s, 90.0f, 160.0f, 5, 70.0f, 30.0f));
+    image_brush_t mirrored(&tile, &m, WRAP_MIRROR);
+    target->brush(&mirrored);
+    target->rectangle(rect_t(180, 90, 130, 140));
+  }
+
+  // a busy rgba8888 picture for the filters to work on
+  static void filter_source(image_t *target) {
+    gradient_stop_t stops[] = {
+      {0.0f, 0xff000000},
+      {0.5f, 0xff3080ff},
+      {1.0f, 0xffffffff}
+    };
+    linear_gradient_brush_t ramp(vec2_t(0, 0), vec2_t(320, 240), stops, 3);
+    target->brush(&ramp);
+    target->clear();
+    target->antialias(X4);
+    scene_shapes(target);
+    target->antialias(OFF);
+  }
+
+  static void filter_blur_iir(image_t *target) {
+    filter_source(target);
+    target->blur(6.0f, rect_t(0, 0, 320, 240), BLUR_IIR);
+  }
+
+  static void filter_blur_box(image_t *target) {
+    filter_source(target);
+    target->blur(6.0f, rect_t(0, 0, 320, 240), BLUR_BOX);
+  }
+
+  static void filter_blur_area(image_t *target) {
+    filter_source(target);
+    target->blur(2.5f, rect_t(40, 30, 200, 150), BLUR_IIR);
+  }
+
+  static void filter_dither(image_t *target) {
+    filter_source(target);
+    target->dither();
+  }
+
+  static void filter_monochrome(image_t *target) {
+    filter_source(target);
+    target->monochrome();
+  }
+
+  static void filter_onebit(image_t *target) {
+    filter_source(target);
+    target->onebit();
+  }
+
+  static void filter_stages(image_t *target) {
+    filter_source(target);
+    filter_stage_t stages[] = {
+      {filter_stage_t::BLUR, 3.0f, BLUR_BOX},
+      {filter_stage_t::MONOCHROME, 0.0f, BLUR_IIR},
+      {filter_stage_t::DITHER, 0.0f, BLUR_IIR}
+    };
+    target->filter(stages, 3, rect_t(20, 20, 280, 200));
+  }
+
+  // quantises onto a 16 entry palette, then expands the indices back out so
+  // the check covers the indices chosen
+  template<quantise_t Q>
+  static void filter_quantise(image_t *target) {
+    filter_source(target);
+    image_t indexed(320, 240, RGBA8888, true);
+    for(int i = 0; i < 16; i++) {
+      indexed.palette(i, 0xff000000 | ((i & 1) * 0xff) | (((i >> 1) & 1) * 0xff00) | (((i >> 2) & 1) * 0xff0000) | (i >> 3) * 0x404040);
+    }
+    target->quantise(&indexed, 16, Q);
+    for(int y = 0; y < 240; y++) {
+      for(int x = 0; x < 320; x++) {
+        *(uint32_t *)target->ptr(x, y) = indexed.palette(*(uint8_t *)indexed.ptr(x, y));
+      }
+    }
+    target->transparency(TRANSPARENCY_UNKNOWN);
+  }
+
+  static void filter_shadow(image_t *target) {
+    color_brush_t shade(rgb_color_t(0, 0, 0, 180));
+    color_brush_t face(rgb_color_t(240, 240, 240, 255));
+    shape_t s(1);
+    set_rounded_rectangle(&s, 60.0f, 50.0f, 200.0f, 120.0f, 20.0f, 20.0f, 20.0f, 20.0f);
+    target->brush(&shade);
+    target->shadow(&s, vec2_t(8, 10), 12.0f, 2);
+    target->brush(&face);
+    target->antialias(X4);
+    target->draw(&s);
+  }
+
+  const render_case_t render_cases[] = {
+    {"float/shapes",       shapes_with<FLOAT, OFF, scene_shapes>},
+    {"float/shapes_x2",    shapes_with<FLOAT, X2, scene_shapes>},
+    {"float/shapes_x4",    shapes_with<FLOAT, X4, scene_shapes>},
+    {"float/paths",        shapes_with<FLOAT, OFF, scene_paths>},
+    {"float/paths_x4",     shapes_with<FLOAT, X4, scene_paths>},
+    {"fixed/shapes",       shapes_with<FIXED, OFF, scene_shapes>},
+    {"fixed/shapes_x2",    shapes_with<FIXED, X2, scene_shapes>},
+    {"fixed/shapes_x4",    shapes_with<FIXED, X4, scene_shapes>},
+    {"fixed/paths",        shapes_with<FIXED, OFF, scene_paths>},
+    {"fixed/paths_x4",     shapes_with<FIXED, X4, scene_paths>},
+    {"analytic/shapes",    shapes_with<FLOAT, ANALYTIC, scene_shapes>},
+    {"analytic/paths",     shapes_with<FLOAT, ANALYTIC, scene_paths>},
+    {"primitives/rectangles", draw_rectangles},
+    {"primitives/triangles",  draw_triangles},
+    {"primitives/ellipses",   draw_ellipses},
+    {"primitives/lines",      draw_lines},
+    {"primitives/plots",      draw_plots},
+    {"primitives/blits",      draw_blits},
+    {"brushes/gradients",  draw_gradients},
+    {"brushes/patterns",   draw_patterns},
+    {"filters/blur_iir",   filter_blur_iir},
+    {"filters/blur_box",   filter_blur_box},
+    {"filters/blur_area",  filter_blur_area},
+    {"filters/dither",     filter_dither},
+    {"filters/monochrome", filter_monochrome},
+    {"filters/onebit",     filter_onebit},
+    {"filters/stages",     filter_stages},
+    {"filters/quantise",   filter_quantise<QUANTISE_NONE>},
+    {"filters/quantise_ordered", filter_quantise<QUANTISE_ORDERED>},
+    {"filters/quantise_fs",      filter_quantise<QUANTISE_FLOYD_STEINBERG>},
+    {"filters/quantise_atkinson", filter_quantise<QUANTISE_ATKINSON>},
+    {"filters/shadow",     filter_shadow},
+  };
+
+  const int render_case_count = sizeof(render_cases) / sizeof(render_cases[0]);
+
+  bool in_group(const render_case_t &c, const char *group) {
+    size_t n = strlen(group);
+    return strncmp(c.name, group, n) == 0 && (c.name[n] == '/' || c.name[n] == '\0');
+  }
+
+}
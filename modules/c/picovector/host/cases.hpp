@@ -0,0 +1,25 @@
+#pragma once
+
+#include "image.hpp"
+
+namespace picovector {
+
+  // a render the golden tests check and the bench runner times. draw() is
+  // handed a cleared 320x240 rgba8888 image and must leave the same pixels
+  // behind every time it's called
+  struct render_case_t {
+    const char *name;
+    void (*draw)(image_t *target);
+  };
+
+  extern const render_case_t render_cases[];
+  extern const int render_case_count;
+
+  // cases are grouped by the first part of their name, "float/circles" is
+  // in the float group
+  bool in_group(const render_case_t &c, const char *group);
+
+  // clears target to the opaque backdrop every case starts from
+  void reset_target(image_t *target);
+
+}
@@ -0,0 +1,150 @@
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <string>
+#include <map>
+
+#include "picovector.hpp"
+#include "image.hpp"
+#include "cases.hpp"
+
+using namespace picovector;
+
+// renders every case and checks a hash of its pixels against the one kept
+// in the golden file, one "name hash" pair a line
+//
+//   picovector_golden <golden file> [group] [--update] [--dump <dir>]
+//
+// group limits the run to one group of cases. --update writes the hashes of
+// every case back to the golden file, --dump writes each render out as a pam
+// image to look at
+
+static uint64_t fnv1a(image_t *image) {
+  uint64_t h = 0xcbf29ce484222325ull;
+  rect_t b = image->bounds();
+  size_t row = b.w * image->bytes_per_pixel();
+  for(int y = 0; y < b.h; y++) {
+    const uint8_t *p = (const uint8_t *)image->ptr(0, y);
+    for(size_t i = 0; i < row; i++) {
+      h = (h ^ p[i]) * 0x100000001b3ull;
+    }
+  }
+  return h;
+}
+
+static void dump(image_t *image, const char *dir, const char *name) {
+  std::string path = std::string(dir) + "/" + name + ".pam";
+  for(size_t i = strlen(dir) + 1; i < path.size(); i++) {
+    if(path[i] == '/') path[i] = '_';
+  }
+
+  FILE *f = fopen(path.c_str(), "wb");
+  if(!f) {
+    fprintf(stderr, "can't write %s\n", path.c_str());
+    return;
+  }
+  rect_t b = image->bounds();
+  fprintf(f, "P7\nWIDTH %d\nHEIGHT %d\nDEPTH 4\nMAXVAL 255\nTUPLTYPE RGB_ALPHA\nENDHDR\n", int(b.w), int(b.h));
+  for(int y = 0; y < b.h; y++) {
+    fwrite(image->ptr(0, y), 4, b.w, f);
+  }
+  fclose(f);
+}
+
+static bool load(const char *path, std::map<std::string, uint64_t> &hashes) {
+  FILE *f = fopen(path, "r");
+  if(!f) return false;
+  char line[256], name[200];
+  unsigned long long hash;
+  while(fgets(line, sizeof(line), f)) {
+    if(line[0] == '#') continue;
+    if(sscanf(line, "%199s %llx", name, &hash) == 2) {
+      hashes[name] = hash;
+    }
+  }
+  fclose(f);
+  return true;
+}
+
+int main(int argc, char **argv) {
+  const char *golden = nullptr;
+  const char *group = nullptr;
+  const char *dump_dir = nullptr;
+  bool update = false;
+
+  for(int i = 1; i < argc; i++) {
+    if(strcmp(argv[i], "--update") == 0) {
+      update = true;
+    }else if(strcmp(argv[i], "--dump") == 0 && i + 1 < argc) {
+      dump_dir = argv[++i];
+    }else if(!golden) {
+      golden = argv[i];
+    }else{
+      group = argv[i];
+    }
+  }
+
+  if(!golden) {
+    fprintf(stderr, "usage: %s <golden file> [group] [--update] [--dump <dir>]\n", argv[0]);
+    return 2;
+  }
+
+  std::map<std::string, uint64_t> expected;
+  if(!load(golden, expected) && !update) {
+    fprintf(stderr, "can't read %s\n", golden);
+    return 2;
+  }
+
+  image_t target(320, 240);
+  int failed = 0, run = 0;
+  std::map<std::string, uint64_t> actual;
+
+  for(int i = 0; i < render_case_count; i++) {
+    const render_case_t &c = render_cases[i];
+    if(group && !update && !in_group(c, group)) continue;
+
+    reset_target(&target);
+    c.draw(&target);
+    uint64_t h = fnv1a(&target);
+    actual[c.name] = h;
+    run++;
+
+    if(dump_dir) dump(&target, dump_dir, c.name);
+    if(update) continue;
+
+    auto e = expected.find(c.name);
+    if(e == expected.end()) {
+      printf("MISSING %-28s %016llx\n", c.name, (unsigned long long)h);
+      failed++;
+    }else if(e->second != h) {
+      printf("FAIL    %-28s %016llx, expected %016llx\n", c.name, (unsigned long long)h, (unsigned long long)e->second);
+      failed++;
+    }else{
+      printf("ok      %s\n", c.name);
+    }
+  }
+
+  if(update) {
+    FILE *f = fopen(golden, "w");
+    if(!f) {
+      fprintf(stderr, "can't write %s\n", golden);
+      return 2;
+    }
+    fprintf(f, "# fnv-1a hashes of the host renders in cases.cpp, regenerate with\n");
+    fprintf(f, "# picovector_golden <this file> --update once a change is known good\n");
+    for(int i = 0; i < render_case_count; i++) {
+      fprintf(f, "%s %016llx\n", render_cases[i].name, (unsigned long long)actual[render_cases[i].name]);
+    }
+    fclose(f);
+    printf("wrote %d hashes to %s\n", run, golden);
+    return 0;
+  }
+
+  if(run == 0) {
+    fprintf(stderr, "no cases in group %s\n", group);
+    return 2;
+  }
+  printf("%d of %d cases match\n", run - failed, run);
+  return failed ? 1 : 0;
+}
@@ -1,5 +1,6 @@
 #include <string.h>
 #include <math.h>
+#include <float.h>
 #include <algorithm>
 #include <vector>
 
@@ -9,12 +10,57 @@
 #include "blend.hpp"
 #include "blit.hpp"
 #include "brush.hpp"
+#include "primitive.hpp"
 #include "shape.hpp"
+#include "sram_pool.hpp"
+#include "profile.hpp"
+
+#ifdef PICO
+#include "hardware/dma.h"
+#endif
 
 using std::vector;
 
 namespace picovector {
 
+  bool fill_pending = false;
+
+#ifdef PICO
+  // fills smaller than this are quicker written by the cpu than set up
+  const size_t fill_dma_min_bytes = 4096;
+
+  static int fill_channel = -1;
+  static uint32_t fill_word;
+
+  void fill_wait() {
+    dma_channel_wait_for_finish_blocking(fill_channel);
+    fill_pending = false;
+  }
+
+  // starts a dma channel writing word over bytes (a multiple of four) at
+  // the word aligned p, reading the same address for every transfer
+  static bool fill_dma(void *p, size_t bytes, uint32_t word) {
+    if(fill_channel < 0) {
+      fill_channel = dma_claim_unused_channel(false);
+      if(fill_channel < 0) return false;
+    }
+    fill_sync();
+    fill_word = word;
+
+    dma_channel_config config = dma_channel_get_default_config(fill_channel);
+    channel_config_set_transfer_data_size(&config, DMA_SIZE_32);
+    channel_config_set_read_increment(&config, false);
+    channel_config_set_write_increment(&config, true);
+    fill_pending = true;
+    dma_channel_configure(fill_channel, &config, p, &fill_word, bytes / 4, true);
+    return true;
+  }
+#else
+  void fill_wait() {
+    fill_pending = false;
+  }
+#endif
+
   image_t::image_t() {
   }
 
@@ -25,18 +71,23 @@ namespace picovector {
     _clip = rect_t(0, 0, i.w, i.h);
     _buffer = source->ptr(i.x, i.y);
     _managed_buffer = false;
+    uncompile();
   }
 
-  image_t::image_t(int w, int h, pixel_format_t pixel_format, bool has_palette) {
+  image_t::image_t(int w, int h, pixel_format_t pixel_format, bool has_palette, memory_t memory) {
     _bounds = rect_t(0, 0, w, h);
     _clip = rect_t(0, 0, w, h);
     _brush = nullptr;
     _pixel_format = pixel_format;
     _has_palette = has_palette;
     _managed_buffer = true;
-    _bytes_per_pixel = this->_has_palette ? sizeof(uint8_t) : sizeof(uint32_t);
+    _bytes_per_pixel = bytes_per_pixel(pixel_format, has_palette);
     _row_stride = w * _bytes_per_pixel;
-    _buffer = PV_MALLOC(this->buffer_size());
+    PV_ALLOC_SCOPE(PV_ALLOC_IMAGE);
+    _buffer = memory == MEMORY_SRAM ? sram_alloc(this->buffer_size()) : nullptr;
+    if(!_buffer) {
+      _buffer = PV_MALLOC(this->buffer_size());
+    }
     if(_has_palette) {
       _palette.resize(256);
     }
@@ -50,7 +101,7 @@ namespace picovector {
     _has_palette = has_palette;
     _buffer = buffer;
     _managed_buffer = false;
-    _bytes_per_pixel = this->_has_palette ? sizeof(uint8_t) : sizeof(uint32_t);
+    _bytes_per_pixel = bytes_per_pixel(pixel_format, has_palette);
     _row_stride = w * _bytes_per_pixel;
     if(_has_palette) {
       _palette.resize(256);
@@ -59,11 +110,16 @@ namespace picovector {
 
   image_t::~image_t() {
     if(this->_managed_buffer) {
+      fill_sync();
+      if(sram_owns(this->_buffer)) {
+        sram_free(this->_buffer);
+      }else{
 #ifdef PICO
-      PV_FREE(this->_buffer);
+        PV_FREE(this->_buffer);
 #else
-      PV_FREE(this->_buffer, this->buffer_size());
+        PV_FREE(this->_buffer, this->buffer_size());
 #endif
+      }
     }
   }
 
@@ -71,6 +127,16 @@ namespace picovector {
     return this->_bytes_per_pixel * this->_bounds.w * this->_bounds.h;
   }
 
+  size_t image_t::bytes_per_pixel(pixel_format_t pixel_format, bool has_palette) {
+    if(has_palette) {
+      return sizeof(uint8_t);
+    }
+    if(pixel_format == A8) {
+      return sizeof(uint8_t);
+    }
+    return pixel_format == RGB565 || pixel_format == RGBA4444 ? sizeof(uint16_t) : sizeof(uint32_t);
+  }
+
   size_t image_t::bytes_per_pixel() {
     return this->_bytes_per_pixel;
   }
@@ -108,12 +174,40 @@ namespace picovector {
 
   void image_t::palette(uint8_t i, uint32_t c) {
     this->_palette[i] = c;
+    transparency(TRANSPARENCY_UNKNOWN);
   }
 
   uint32_t image_t::palette(uint8_t i) {
     return this->_palette[i];
   }
 
+  const palette_t &image_t::palette() {
+    return this->_palette;
+  }
+
+  // closest palette entry to an rgba8888 colour, drawing into an indexed
+  // image snaps every colour it writes to the palette
+  uint8_t image_t::palette_index(uint32_t c) {
+    int best = 0;
+    uint32_t best_d = UINT32_MAX;
+    for(int i = 0; i < 256; i++) {
+      uint32_t p = this->_palette[i];
+      if(p == c) {
+        return i;
+      }
+      int dr = int(_r(p)) - int(_r(c));
+      int dg = int(_g(p)) - int(_g(c));
+      int db = int(_b(p)) - int(_b(c));
+      int da = int(_a(p)) - int(_a(c));
+      uint32_t d = dr * dr + dg * dg + db * db + da * da;
+      if(d < best_d) {
+        best_d = d;
+        best = i;
+      }
+    }
+    return best;
+  }
+
   uint8_t image_t::alpha() {
     return this->_alpha;
   }
@@ -123,6 +217,117 @@ namespace picovector {
     this->_alpha = alpha;
   }
 
+  transparency_t image_t::transparency() {
+    if(this->_transparency == TRANSPARENCY_UNKNOWN) {
+      this->_transparency = classify();
+    }
+    return this->_transparency;
+  }
+
+  void image_t::transparency(transparency_t transparency) {
+    this->_transparency = transparency;
+    if(transparency == TRANSPARENCY_UNKNOWN) {
+      uncompile();
+    }
+  }
+
+  void image_t::compile() {
+    uncompile();
+    int w = _bounds.w, h = _bounds.h;
+    _run_rows.reserve(h + 1);
+    _run_rows.push_back(0);
+    for(int y = 0; y < h; y++) {
+      int x = 0;
+      while(x < w) {
+        uint32_t a = _a(get_unsafe(x, y));
+        if(a == 0) {
+          x++;
+          continue;
+        }
+        bool opaque = a == 255;
+        int start = x;
+        while(x < w && x - start < 0x7fff) {
+          a = _a(get_unsafe(x, y));
+          if(a == 0 || (a == 255) != opaque) break;
+          x++;
+        }
+        _runs.push_back({uint16_t(start), uint16_t(x - start), opaque});
+      }
+      _run_rows.push_back(_runs.size());
+    }
+    _runs.shrink_to_fit();
+  }
+
+  void image_t::uncompile() {
+    _runs.clear();
+    _runs.shrink_to_fit();
+    _run_rows.clear();
+    _run_rows.shrink_to_fit();
+  }
+
+  // looks at every pixel (or palette entry) for anything that isn't fully
+  // opaque, stopping at the first translucent one
+  transparency_t image_t::classify() {
+    if(_has_palette) {
+      transparency_t t = OPAQUE;
+      for(uint32_t c : _palette) {
+        if(_a(c) == 0) {
+          t = BINARY_ALPHA;
+        }else if(_a(c) != 255) {
+          return TRANSLUCENT;
+        }
+      }
+      return t;
+    }
+
+    if(_pixel_format == RGB565) {
+      return OPAQUE;
+    }
+
+    int w = _bounds.w, h = _bounds.h;
+    if(_pixel_format == RGBA4444) {
+      uint32_t all = 0xf;
+      for(int y = 0; y < h; y++) {
+        const uint16_t *p = (const uint16_t *)ptr(0, y);
+        for(int x = 0; x < w; x++) {
+          uint32_t a = p[x] & 0xf;
+          if(a != 0 && a != 0xf) {
+            return TRANSLUCENT;
+          }
+          all &= a;
+        }
+      }
+      return all ? OPAQUE : BINARY_ALPHA;
+    }
+
+    if(_pixel_format == A8) {
+      uint32_t all = 0xff;
+      for(int y = 0; y < h; y++) {
+        const uint8_t *p = (const uint8_t *)ptr(0, y);
+        for(int x = 0; x < w; x++) {
+          if(p[x] != 0 && p[x] != 0xff) {
+            return TRANSLUCENT;
+          }
+          all &= p[x];
+        }
+      }
+      return all ? OPAQUE : BINARY_ALPHA;
+    }
+
+    uint32_t all = 0xff000000u;
+    for(int y = 0; y < h; y++) {
+      const uint32_t *p = (const uint32_t *)ptr(0, y);
+      for(int x = 0; x < w; x++) {
+        uint32_t a = p[x] & 0xff000000u;
+        if(a != 0 && a != 0xff000000u) {
+          return TRANSLUCENT;
+        }
+        all &= a;
+      }
+    }
+    return all ? OPAQUE : BINARY_ALPHA;
+  }
+
   antialias_t image_t::antialias() {
     return this->_antialias;
   }
@@ -132,12 +337,45 @@ namespace picovector {
     this->_antialias = antialias;
   }
 
+  rasteriser_t image_t::rasteriser() {
+    return this->_rasteriser;
+  }
+
+  void image_t::rasteriser(rasteriser_t rasteriser) {
+    this->_rasteriser = rasteriser;
+  }
+
+  memory_t image_t::memory() {
+    if(sram_owns(_buffer)) return MEMORY_SRAM;
+#ifdef PICO
+    // rp2350 address map, psram is the second xip chip select
+    uintptr_t a = uintptr_t(_buffer);
+    if(a >= 0x20000000 && a < 0x20082000) return MEMORY_SRAM;
+    if((a & 0xfc000000) == 0x10000000 || (a & 0xfc000000) == 0x14000000) {
+      return (a & 0x01000000) ? MEMORY_PSRAM : MEMORY_FLASH;
+    }
+#endif
+    return MEMORY_ANY;
+  }
+
+  bool image_t::multicore() {
+    return this->_multicore;
+  }
+
+  void image_t::multicore(bool multicore) {
+    this->_multicore = multicore;
+  }
+
   pixel_format_t image_t::pixel_format() {
     return this->_pixel_format;
   }
 
   void image_t::pixel_format(pixel_format_t pixel_format) {
     this->_pixel_format = pixel_format;
+    // span functions are chosen per target format
+    if(this->_brush) {
+      brush(this->_brush);
+    }
   }
 
   brush_t* image_t::brush() {
@@ -146,8 +384,26 @@ namespace picovector {
 
   void image_t::brush(brush_t *brush) {
     this->_brush = brush;
-    this->_span_func = brush->span_func();
-    this->_masked_span_func = brush->masked_span_func();
+    if(!brush) {
+      // back to how a new image starts out, drawing does nothing
+      this->_span_func = span_func_nop;
+      this->_masked_span_func = masked_span_func_nop;
+    }else if(this->_has_palette) {
+      this->_span_func = brush->span_func_pal8();
+      this->_masked_span_func = brush->masked_span_func_pal8();
+    }else if(this->_pixel_format == RGB565) {
+      this->_span_func = brush->span_func_rgb565();
+      this->_masked_span_func = brush->masked_span_func_rgb565();
+    }else if(this->_pixel_format == RGBA4444) {
+      this->_span_func = rgba4444_adapter_span_func;
+      this->_masked_span_func = rgba4444_adapter_masked_span_func;
+    }else if(this->_pixel_format == A8) {
+      this->_span_func = a8_adapter_span_func;
+      this->_masked_span_func = a8_adapter_masked_span_func;
+    }else{
+      this->_span_func = brush->span_func();
+      this->_masked_span_func = brush->masked_span_func();
+    }
     // this->_span_func = brush->get_span_func(this);
     // this->_mask_span_func = brush->get_mask_span_func(this);
   }
@@ -197,6 +453,7 @@ namespace picovector {
   // }
 
   void image_t::clear() {
+    profile_scope_t profile(PROFILE_CLEAR, _clip.w * _clip.h);
     rectangle(_clip);
   }
 
@@ -235,7 +492,39 @@ namespace picovector {
     }
   }
 
+  // kernels for drawing a compiled image, opaque runs go through the first
+  // and translucent ones through the second
+  struct blit_runs_t {
+    blit_span_t opaque;
+    blit_span_t translucent;
+  };
+
+  static bool blit_runs(image_t *src, image_t *dst, bool mirrored, blit_runs_t &k);
+
+  // row sy of a compiled image, source columns sx to sx + w drawn along row
+  // dy from dx, skipping the gaps between runs. mirrored rows put source
+  // column sx + w - 1 at dx
+  static void blit_row_runs(image_t *src, image_t *dst, const blit_runs_t &k, blend_func_t bf, int sx, int sy, int dx, int dy, int w, bool mirrored) {
+    int count;
+    const pixel_run_t *r = src->runs(sy, count);
+    int sx2 = sx + w;
+    for(int i = 0; i < count; i++, r++) {
+      int a = max(int(r->x), sx), b = min(int(r->x + r->w), sx2);
+      if(a >= b) {
+        if(r->x >= sx2) break;
+        continue;
+      }
+      blit_span_t fn = r->opaque ? k.opaque : k.translucent;
+      if(mirrored) {
+        fn(src, dst, bf, b - 1, sy, dx + (sx2 - b), dy, b - a);
+      }else{
+        fn(src, dst, bf, a, sy, dx + (a - sx), dy, b - a);
+      }
+    }
+  }
+
   void image_t::blit(image_t *target, const vec2_t p) {
+    profile_scope_t profile(PROFILE_BLIT);
     rect_t sr = _bounds;
     rect_t tr(p.x, p.y, sr.w, sr.h); // target rect
 
@@ -246,21 +535,27 @@ namespace picovector {
     if(sr.w <= 0 || sr.h <= 0 || tr.w <= 0 || tr.h <= 0) {
       return;
     }
+    profile.pixels(tr.w * tr.h);
 
     blend_func_t bf = target->_blend_func;
+    blit_runs_t runs;
+    if(blit_runs(this, target, false, runs)) {
+      for(int y = 0; y < tr.h; y++) {
+        blit_row_runs(this, target, runs, bf, sr.x, sr.y + y, tr.x, tr.y + y, tr.w, false);
+      }
+      return;
+    }
 
+    blit_span_t fn = blit_span(this, target);
     for(int y = 0; y < tr.h; y++) {
-      if(_has_palette) {
-        span_blit(this, target, bf, sr.x, sr.y + y, tr.x, tr.y + y, tr.w, _palette);
-      }else{
-        span_blit(this, target, bf, sr.x, sr.y + y, tr.x, tr.y + y, tr.w);
-      }
+      fn(this, target, bf, sr.x, sr.y + y, tr.x, tr.y + y, tr.w);
     }
   }
 
 
   // blit from source rectangle into target rectangle
   void image_t::blit(image_t *target, rect_t sr, rect_t tr) {
+    profile_scope_t profile(PROFILE_BLIT);
     bool flip_h = tr.w < 0;
     bool flip_v = tr.h < 0;
 
@@ -277,6 +572,7 @@ namespace picovector {
     if(sr.w <= 0 || sr.h <= 0 || tr.w <= 0 || tr.h <= 0) {
       return;
     }
+    profile.pixels(tr.w * tr.h);
     // printf("post clip\n");
     // printf("- sr = %.2f, %.2f (%.2f x %.2f)\n", sr.x, sr.y, sr.w, sr.h);
     // printf("- tr = %.2f, %.2f (%.2f x %.2f)\n", tr.x, tr.y, tr.w, tr.h);
@@ -300,13 +596,9 @@ namespace picovector {
       srcy = ((_bounds.h - sr.y) * 65536.0f) + srcstepy;
     }
 
+    blit_scale_span_t fn = blit_scale_span(this, target);
     for(int y = tr.y; y < tr.y + tr.h; y++) {
-      if(this->_has_palette) {
-        span_blit_scale(this, target, bf, srcx, srcstepx, srcy, tr.x, y, tr.w, _palette);
-      }else{
-        span_blit_scale(this, target, bf, srcx, srcstepx, srcy, tr.x, y, tr.w);
-      }
-
+      fn(this, target, bf, srcx, srcstepx, srcy, tr.x, y, tr.w);
       srcy += srcstepy;
     }
   }
@@ -316,6 +608,428 @@ namespace picovector {
     blit(target, _bounds, tr);
   }
 
+  // draws the image through transform, which maps source pixel space (the
+  // image covering 0, 0 to w, h) onto the target. the footprint is worked
+  // out once, then each row is mapped back into the source at its first
+  // pixel centre and trimmed to the run that lands inside it before the
+  // kernel steps across in fixed point
+  void image_t::blit(image_t *target, const mat3_t &transform, bool bilinear) {
+    profile_scope_t profile(PROFILE_BLIT);
+    mat3_t m = transform;
+    if(fabsf(m.v00 * m.v11 - m.v01 * m.v10) < 1e-6f) {
+      return;
+    }
+
+    float sw = _bounds.w, sh = _bounds.h;
+    vec2_t corners[4] = {vec2_t(0, 0), vec2_t(sw, 0), vec2_t(0, sh), vec2_t(sw, sh)};
+    float minx = FLT_MAX, miny = FLT_MAX, maxx = -FLT_MAX, maxy = -FLT_MAX;
+    for(auto &p : corners) {
+      p = p.transform(m);
+      minx = min(minx, p.x); maxx = max(maxx, p.x);
+      miny = min(miny, p.y); maxy = max(maxy, p.y);
+    }
+
+    rect_t c = target->_clip.intersection(target->_bounds);
+    int x1 = max(int(floorf(minx)), int(c.x)), x2 = min(int(ceilf(maxx)), int(c.x + c.w));
+    int y1 = max(int(floorf(miny)), int(c.y)), y2 = min(int(ceilf(maxy)), int(c.y + c.h));
+    if(x1 >= x2 || y1 >= y2) {
+      return;
+    }
+    profile.pixels((x2 - x1) * (y2 - y1));
+
+    mat3_t inv = m;
+    inv.inverse();
+    fx16_t du = inv.v00 * 65536.0f, dv = inv.v10 * 65536.0f;
+    int64_t umax = int64_t(sw) << 16, vmax = int64_t(sh) << 16;
+
+    // span of x where a coordinate starting at s and moving d per pixel
+    // stays within [0, e)
+    auto range = [](float s, float d, float e, float &lo, float &hi) {
+      if(fabsf(d) < 1e-9f) {
+        if(s < 0.0f || s >= e) hi = lo;
+        return;
+      }
+      float a = -s / d, b = (e - s) / d;
+      lo = max(lo, min(a, b));
+      hi = min(hi, max(a, b));
+    };
+
+    blend_func_t bf = target->_blend_func;
+    blit_affine_span_t fn = blit_affine_span(this, target, bilinear);
+    for(int y = y1; y < y2; y++) {
+      vec2_t s = vec2_t(x1 + 0.5f, y + 0.5f).transform(inv);
+      float lo = 0.0f, hi = x2 - x1;
+      range(s.x, inv.v00, sw, lo, hi);
+      range(s.y, inv.v10, sh, lo, hi);
+      int a = max(0, int(ceilf(lo))), b = min(x2 - x1, int(ceilf(hi)));
+      if(a >= b) continue;
+
+      // rounding in the stepping can put an end sample a fraction outside
+      // the source, trim until both ends (and so everything between them)
+      // are inside
+      fx16_t u = (s.x + inv.v00 * a) * 65536.0f, v = (s.y + inv.v10 * a) * 65536.0f;
+      auto inside = [&](int i) {
+        int64_t eu = int64_t(u) + int64_t(du) * i, ev = int64_t(v) + int64_t(dv) * i;
+        return eu >= 0 && eu < umax && ev >= 0 && ev < vmax;
+      };
+      while(a < b && !inside(0)) {
+        a++; u += du; v += dv;
+      }
+      while(a < b && !inside(b - a - 1)) {
+        b--;
+      }
+      if(a >= b) continue;
+
+      fn(this, target, bf, u, du, v, dv, x1 + a, y, b - a);
+    }
+  }
+
+  // how an image stores its pixels, which decides the kernel types
+  enum storage_t {
+    STORE_PAL8,
+    STORE_RGB565,
+    STORE_RGBA4444,
+    STORE_RGBA8888,
+    STORE_A8
+  };
+
+  static storage_t storage(image_t *image) {
+    if(image->has_palette()) return STORE_PAL8;
+    switch(image->pixel_format()) {
+      case RGB565: return STORE_RGB565;
+      case RGBA4444: return STORE_RGBA4444;
+      case A8: return STORE_A8;
+      default: return STORE_RGBA8888;
+    }
+  }
+
+  /*
+    kernels are picked by handing pick_kernel() a K with the function type as
+    fn_t and a get<S, D>() returning the kernel for those storage types.
+    pick_direct_kernel() is the same for kernels that only write direct
+    colour targets
+  */
+  template<typename K, typename D>
+  static typename K::fn_t pick_source_kernel(image_t *src) {
+    switch(storage(src)) {
+      case STORE_PAL8: return K::template get<uint8_t, D>();
+      case STORE_RGB565: return K::template get<uint16_t, D>();
+      case STORE_RGBA4444: return K::template get<rgba4444_t, D>();
+      case STORE_A8: return K::template get<a8_t, D>();
+      default: return K::template get<uint32_t, D>();
+    }
+  }
+
+  template<typename K>
+  static typename K::fn_t pick_direct_kernel(image_t *src, image_t *dst) {
+    switch(storage(dst)) {
+      case STORE_RGB565: return pick_source_kernel<K, uint16_t>(src);
+      case STORE_RGBA4444: return pick_source_kernel<K, rgba4444_t>(src);
+      case STORE_A8: return pick_source_kernel<K, a8_t>(src);
+      default: return pick_source_kernel<K, uint32_t>(src);
+    }
+  }
+
+  template<typename K>
+  static typename K::fn_t pick_kernel(image_t *src, image_t *dst) {
+    if(dst->has_palette()) return pick_source_kernel<K, uint8_t>(src);
+    return pick_direct_kernel<K>(src, dst);
+  }
+
+  template<bool FADE, bool OVER, int STEP>
+  struct blit_kernel_t {
+    typedef blit_span_t fn_t;
+    template<typename S, typename D> static fn_t get() {return span_blit<S, D, FADE, OVER, STEP>;}
+  };
+
+  template<bool FADE, bool OVER>
+  struct blit_scale_kernel_t {
+    typedef blit_scale_span_t fn_t;
+    template<typename S, typename D> static fn_t get() {return span_blit_scale<S, D, FADE, OVER>;}
+  };
+
+  template<bool KEY, int STEP>
+  struct convert_kernel_t {
+    typedef blit_span_t fn_t;
+    template<typename S, typename D> static fn_t get() {return span_convert<S, D, KEY, STEP>;}
+  };
+
+  template<bool KEY>
+  struct convert_scale_kernel_t {
+    typedef blit_scale_span_t fn_t;
+    template<typename S, typename D> static fn_t get() {return span_convert_scale<S, D, KEY>;}
+  };
+
+  template<bool FADE, bool OVER, bool BILINEAR>
+  struct blit_affine_kernel_t {
+    typedef blit_affine_span_t fn_t;
+    template<typename S, typename D> static fn_t get() {return span_blit_affine<S, D, FADE, OVER, BILINEAR>;}
+  };
+
+  struct tex_column_kernel_t {
+    typedef tex_column_t fn_t;
+    template<typename S, typename D> static fn_t get() {return span_tex_column<S, D>;}
+  };
+
+  template<bool FADE, bool OVER, int STEP>
+  static blit_span_t pick_blit_span(image_t *src, image_t *dst) {
+    return pick_kernel<blit_kernel_t<FADE, OVER, STEP>>(src, dst);
+  }
+
+  template<bool FADE, bool OVER>
+  static blit_scale_span_t pick_blit_scale_span(image_t *src, image_t *dst) {
+    return pick_kernel<blit_scale_kernel_t<FADE, OVER>>(src, dst);
+  }
+
+  // indexed images with identical palettes can copy opaque indices across
+  static bool shared_palette(image_t *src, image_t *dst) {
+    return src->has_palette() && dst->has_palette() && src->is_compatible(dst);
+  }
+
+  int16_t blit_remap[256];
+
+  void blit_remap_reset() {
+    memset(blit_remap, 0xff, sizeof(blit_remap));
+  }
+
+  template<bool KEY, int STEP>
+  static blit_span_t pick_convert_span(image_t *src, image_t *dst) {
+    return pick_direct_kernel<convert_kernel_t<KEY, STEP>>(src, dst);
+  }
+
+  template<bool KEY>
+  static blit_scale_span_t pick_convert_scale_span(image_t *src, image_t *dst) {
+    return pick_direct_kernel<convert_scale_kernel_t<KEY>>(src, dst);
+  }
+
+  // same storage and nothing a blend could change, so rows can be copied
+  static bool same_storage(image_t *src, image_t *dst) {
+    if(src->has_palette() || dst->has_palette()) return shared_palette(src, dst);
+    return storage(src) == storage(dst);
+  }
+
+  static blit_span_t copy_span(image_t *src) {
+    switch(storage(src)) {
+      case STORE_PAL8:
+      case STORE_A8: return span_copy<uint8_t>;
+      case STORE_RGB565:
+      case STORE_RGBA4444: return span_copy<uint16_t>;
+      default: return span_copy<uint32_t>;
+    }
+  }
+
+  blit_span_t blit_span(image_t *src, image_t *dst, bool mirrored) {
+    dst->modified();
+    bool over = dst->_blend_func == blend_func_over;
+    bool fade = src->alpha() != 255;
+
+    if(over && !fade) {
+      transparency_t t = src->transparency();
+      if(t == OPAQUE && !mirrored && same_storage(src, dst)) {
+        return copy_span(src);
+      }
+      if(shared_palette(src, dst)) {
+        return mirrored ? span_blit_shared<-1> : span_blit_shared<1>;
+      }
+      if(src->has_palette() && dst->has_palette()) {
+        blit_remap_reset();
+        return mirrored ? span_blit_remap<-1> : span_blit_remap<1>;
+      }
+      if(!dst->has_palette() && (t == OPAQUE || t == BINARY_ALPHA)) {
+        if(t == OPAQUE) return mirrored ? pick_convert_span<false, -1>(src, dst) : pick_convert_span<false, 1>(src, dst);
+        return mirrored ? pick_convert_span<true, -1>(src, dst) : pick_convert_span<true, 1>(src, dst);
+      }
+    }
+
+    if(mirrored) {
+      if(fade) return over ? pick_blit_span<true, true, -1>(src, dst) : pick_blit_span<true, false, -1>(src, dst);
+      return over ? pick_blit_span<false, true, -1>(src, dst) : pick_blit_span<false, false, -1>(src, dst);
+    }
+    if(fade) return over ? pick_blit_span<true, true, 1>(src, dst) : pick_blit_span<true, false, 1>(src, dst);
+    return over ? pick_blit_span<false, true, 1>(src, dst) : pick_blit_span<false, false, 1>(src, dst);
+  }
+
+  blit_scale_span_t blit_scale_span(image_t *src, image_t *dst) {
+    dst->modified();
+    bool over = dst->_blend_func == blend_func_over;
+    bool fade = src->alpha() != 255;
+
+    if(over && !fade) {
+      transparency_t t = src->transparency();
+      if(shared_palette(src, dst)) {
+        return span_blit_scale_shared;
+      }
+      if(src->has_palette() && dst->has_palette()) {
+        blit_remap_reset();
+        return span_blit_scale_remap;
+      }
+      if(!dst->has_palette() && (t == OPAQUE || t == BINARY_ALPHA)) {
+        return t == OPAQUE ? pick_convert_scale_span<false>(src, dst) : pick_convert_scale_span<true>(src, dst);
+      }
+    }
+    if(fade) return over ? pick_blit_scale_span<true, true>(src, dst) : pick_blit_scale_span<true, false>(src, dst);
+    return over ? pick_blit_scale_span<false, true>(src, dst) : pick_blit_scale_span<false, false>(src, dst);
+  }
+
+  template<bool FADE, bool OVER, bool BILINEAR>
+  static blit_affine_span_t pick_blit_affine_span(image_t *src, image_t *dst) {
+    return pick_kernel<blit_affine_kernel_t<FADE, OVER, BILINEAR>>(src, dst);
+  }
+
+  template<bool BILINEAR>
+  static blit_affine_span_t pick_blit_affine_span(image_t *src, image_t *dst, bool fade, bool over) {
+    if(fade) return over ? pick_blit_affine_span<true, true, BILINEAR>(src, dst) : pick_blit_affine_span<true, false, BILINEAR>(src, dst);
+    return over ? pick_blit_affine_span<false, true, BILINEAR>(src, dst) : pick_blit_affine_span<false, false, BILINEAR>(src, dst);
+  }
+
+  blit_affine_span_t blit_affine_span(image_t *src, image_t *dst, bool bilinear) {
+    dst->modified();
+    bool over = dst->_blend_func == blend_func_over;
+    bool fade = src->alpha() != 255;
+    return bilinear ? pick_blit_affine_span<true>(src, dst, fade, over) : pick_blit_affine_span<false>(src, dst, fade, over);
+  }
+
+  // compiled images drawn plainly source over, anything faded or blended
+  // another way draws every pixel
+  static bool blit_runs(image_t *src, image_t *dst, bool mirrored, blit_runs_t &k) {
+    // drawing into a compiled image drops its runs, so this has to come
+    // first for blits onto themselves
+    dst->modified();
+    if(!src->compiled() || dst->_blend_func != blend_func_over || src->alpha() != 255) {
+      return false;
+    }
+
+    bool remap = src->has_palette() && dst->has_palette() && !shared_palette(src, dst);
+    if(remap) {
+      blit_remap_reset();
+    }
+
+    if(mirrored) {
+      k.translucent = pick_blit_span<false, true, -1>(src, dst);
+      if(shared_palette(src, dst)) k.opaque = span_blit_shared<-1>;
+      else if(remap) k.opaque = span_blit_remap<-1>;
+      else if(dst->has_palette()) k.opaque = k.translucent;
+      else k.opaque = pick_convert_span<false, -1>(src, dst);
+      return true;
+    }
+
+    k.translucent = pick_blit_span<false, true, 1>(src, dst);
+    if(same_storage(src, dst)) {
+      k.opaque = copy_span(src);
+    }else if(remap) {
+      k.opaque = span_blit_remap<1>;
+    }else if(dst->has_palette()) {
+      k.opaque = k.translucent;
+    }else{
+      k.opaque = pick_convert_span<false, 1>(src, dst);
+    }
+    return true;
+  }
+
+  tex_column_t tex_column(image_t *src, image_t *dst) {
+    dst->modified();
+    return pick_kernel<tex_column_kernel_t>(src, dst);
+  }
+
+  // draws many sprites cut from this image in one go. each entry is stride
+  // int16 values: sx, sy, sw, sh, dx, dy and, when stride is 7 or more, a
+  // flip value (bit 0 mirrors horizontally, bit 1 vertically). the span
+  // kernels are picked once for the whole batch and clipping to the atlas
+  // and the target's clip is done in integers
+  void image_t::blit_sprites(image_t *target, const int16_t *sprites, int count, int stride) {
+    profile_scope_t profile(PROFILE_BLIT);
+    blit_span_t normal = blit_span(this, target);
+    blit_span_t mirrored = blit_span(this, target, true);
+    blit_runs_t runs, mirrored_runs;
+    bool compiled = blit_runs(this, target, false, runs) && blit_runs(this, target, true, mirrored_runs);
+
+    blend_func_t bf = target->_blend_func;
+
+    int ax1 = _bounds.x, ay1 = _bounds.y;
+    int ax2 = _bounds.x + _bounds.w, ay2 = _bounds.y + _bounds.h;
+    rect_t c = target->_clip.intersection(target->_bounds);
+    int cx1 = c.x, cy1 = c.y, cx2 = c.x + c.w, cy2 = c.y + c.h;
+
+    for(int i = 0; i < count; i++) {
+      const int16_t *e = &sprites[i * stride];
+      int sx = e[0], sy = e[1], sw = e[2], sh = e[3], dx = e[4], dy = e[5];
+      int flip = stride > 6 ? e[6] : 0;
+      bool fh = flip & 1, fv = flip & 2;
+
+      // keep the source within the atlas, on a mirrored axis trimming one
+      // side of the source trims the opposite side of the sprite
+      int t;
+      if((t = ax1 - sx) > 0) {sx += t; sw -= t; if(!fh) dx += t;}
+      if((t = sx + sw - ax2) > 0) {sw -= t; if(fh) dx += t;}
+      if((t = ay1 - sy) > 0) {sy += t; sh -= t; if(!fv) dy += t;}
+      if((t = sy + sh - ay2) > 0) {sh -= t; if(fv) dy += t;}
+
+      int x1 = max(dx, cx1), x2 = min(dx + sw, cx2);
+      int y1 = max(dy, cy1), y2 = min(dy + sh, cy2);
+      if(x1 >= x2 || y1 >= y2) continue;
+      profile.pixels((x2 - x1) * (y2 - y1));
+
+      int u = fh ? sx + sw - 1 - (x1 - dx) : sx + (x1 - dx);
+      if(compiled) {
+        // the runs take the leftmost source column either way round
+        int first = fh ? u - (x2 - x1 - 1) : u;
+        for(int y = y1; y < y2; y++) {
+          int v = fv ? sy + sh - 1 - (y - dy) : sy + (y - dy);
+          blit_row_runs(this, target, fh ? mirrored_runs : runs, bf, first, v, x1, y, x2 - x1, fh);
+        }
+        continue;
+      }
+
+      blit_span_t fn = fh ? mirrored : normal;
+      for(int y = y1; y < y2; y++) {
+        int v = fv ? sy + sh - 1 - (y - dy) : sy + (y - dy);
+        fn(this, target, bf, u, v, x1, y, x2 - x1);
+      }
+    }
+  }
+
+
+  // one textured column, pixel i of the c pixels down from p samples the
+  // source at uvs + (i + 1) * (uve - uvs) / c rounded to the nearest texel.
+  // the rows are clipped before anything is stepped and both ends of what's
+  // left are pulled inside the source, so every sample between them is too
+  static void vspan_tex_column(image_t *src, image_t *target, tex_column_t fn, vec2_t p, int c, vec2_t uvs, vec2_t uve, uint32_t shade) {
+    if(c <= 0) return;
+
+    rect_t b = target->clip().intersection(target->bounds());
+    int x = p.x;
+    if(x < b.x || x >= b.x + b.w) return;
+
+    int y0 = p.y;
+    int y1 = max(y0, int(b.y)), y2 = min(int(ceilf(p.y + c)), int(b.y + b.h));
+    if(y1 >= y2) return;
+    int n = y2 - y1;
+
+    float ustep = (uve.x - uvs.x) / float(c);
+    float vstep = (uve.y - uvs.y) / float(c);
+    float first = float(y1 - y0 + 1), last = first + float(n - 1);
+
+    rect_t tb = src->bounds();
+    auto fixed = [](float v, float lo, float hi) -> int64_t {
+      int64_t f = floorf(v * 65536.0f + 0.5f * 65536.0f);
+      return max(int64_t(lo * 65536.0f), min(f, int64_t(hi * 65536.0f) - 1));
+    };
+    // the step is rounded so texel boundaries land where the float maths
+    // puts them, unless that would carry the last sample out of the source
+    auto step = [](int64_t a, int64_t b, int n, int lo, int hi) -> fx16_t {
+      if(n < 2) return 0;
+      int64_t s = ((b - a) * 2 + (b > a ? n - 1 : 1 - n)) / (2 * (n - 1));
+      int64_t e = a + s * (n - 1);
+      if(e < int64_t(lo) << 16 || e >= int64_t(hi) << 16) s = (b - a) / (n - 1);
+      return s;
+    };
+    int64_t u1 = fixed(uvs.x + ustep * first, tb.x, tb.x + tb.w), u2 = fixed(uvs.x + ustep * last, tb.x, tb.x + tb.w);
+    int64_t v1 = fixed(uvs.y + vstep * first, tb.y, tb.y + tb.h), v2 = fixed(uvs.y + vstep * last, tb.y, tb.y + tb.h);
+    fx16_t su = step(u1, u2, n, tb.x, tb.x + tb.w);
+    fx16_t sv = step(v1, v2, n, tb.y, tb.y + tb.h);
+
+    fn(src, target, target->_blend_func, u1, su, v1, sv, x, y1, n, shade);
+  }
 
   /*
     renders a vertical span onto the target image using this image as a
@@ -327,45 +1041,122 @@ namespace picovector {
     - uve: the end coordinate of the texture
   */
   void image_t::vspan_tex(image_t *target, vec2_t p, uint c, vec2_t uvs, vec2_t uve) {
-    rect_t b = target->_clip;
-    if(p.x < b.x || p.x > b.x + b.w) {
-      return;
-    }
+    vspan_tex_column(this, target, tex_column(this, target), p, c, uvs, uve, 256);
+  }
 
-    float ustep = (uve.x - uvs.x) / float(c);
-    float vstep = (uve.y - uvs.y) / float(c);
-    float u = uvs.x;
-    float v = uvs.y;
+  // draws count columns packed as stride floats each: x, y, count, u1, v1,
+  // u2, v2 as for vspan_tex() and, when stride is 8 or more, a brightness
+  // from 0 to 255. the kernel is picked once for all of them
+  void image_t::vspans_tex(image_t *target, const float *columns, int count, int stride) {
+    tex_column_t fn = tex_column(this, target);
+    for(int i = 0; i < count; i++) {
+      const float *e = &columns[i * stride];
+      uint32_t shade = 256;
+      if(stride > 7) {
+        shade = max(0.0f, min(e[7], 255.0f)) * (256.0f / 255.0f);
+      }
+      vspan_tex_column(this, target, fn, vec2_t(e[0], e[1]), e[2], vec2_t(e[3], e[4]), vec2_t(e[5], e[6]), shade);
+    }
+  }
 
-    for(int y = p.y; y < p.y + c; y++) {
-      u += ustep;
-      v += vstep;
 
-      if(y >= b.y && y < b.y + b.h) {
-        uint32_t *dst = (uint32_t *)target->ptr(p.x, y);
 
-        int tx = round(u);
-        int ty = round(v);
+  void image_t::draw(shape_t *shape) {
+    draw(shape, &shape->transform);
+  }
 
-        uint32_t col;
-        if(this->_has_palette) {
-          col = this->_palette[*(uint8_t *)this->ptr(tx, ty)];
-        } else {
-          col = *((uint32_t *)this->ptr(tx, ty));
+  void image_t::draw(shape_t *shape, mat3_t *transform) {
+    modified();
+    flatten_primitive(shape, transform, _antialias);
+
+    // the fixed point engine only supersamples, analytic coverage always
+    // goes through render()
+    if(_rasteriser == FIXED && _antialias != ANALYTIC) {
+      pvr_reset(_antialias);
+      if(shape->_stroke.width > 0.0f) {
+        float tolerance = curve_tolerance(transform, _antialias);
+        if(tolerance <= 0.0f) tolerance = 1.0f;
+        for(auto &path : shape->paths) {
+          stroke_path(shape->points(path).data(), path.count, path.closed, shape->_stroke, transform, tolerance, [](void *, vec2_t a, vec2_t b) {
+            pvr_add_line(a, b);
+          }, nullptr);
+        }
+      }else{
+        for(auto &path : shape->paths) {
+          pvr_add_path(shape->points(path).data(), path.count, transform);
         }
-
-        *dst = target->_blend_func(*dst, _r(col), _g(col), _b(col), _a(col));
       }
+      // shapes too big for the fixed point engine go through render()
+      if(pvr_render(this, _clip, _brush)) return;
     }
+
+    render(shape, this, transform, _brush);
   }
 
+  // fills a run of n pixels at p with the colour word in the target's
+  // storage, pal8 and rgb565 words hold the pixel repeated
+  static void fill_run(uint8_t *p, size_t n, storage_t storage, uint32_t word) {
+    switch(storage) {
+      case STORE_PAL8:
+      case STORE_A8: memset(p, word & 0xff, n); break;
+      case STORE_RGB565:
+      case STORE_RGBA4444: _fill_pixels16((uint16_t *)p, word & 0xffff, n); break;
+      case STORE_RGBA8888: _fill_pixels((uint32_t *)p, word, n); break;
+    }
+  }
 
-  void image_t::draw(shape_t *shape) {
-    render(shape, this, &shape->transform, _brush);
+  void image_t::fill(rect_t r, uint32_t c) {
+    r = r.intersection(_clip).intersection(_bounds);
+    if(r.empty()) return;
+    modified();
+
+    storage_t s = storage(this);
+    uint32_t word;
+    switch(s) {
+      case STORE_PAL8: word = palette_index(c) * 0x01010101u; break;
+      case STORE_RGB565: word = _rgba8888_to_rgb565(c) * 0x00010001u; break;
+      case STORE_RGBA4444: word = _rgba8888_to_rgba4444(c) * 0x00010001u; break;
+      case STORE_A8: word = _a(c) * 0x01010101u; break;
+      default: word = c; break;
+    }
+
+    size_t n = r.w;
+    int rows = r.h;
+    // rows spanning the whole buffer (clear() on a full clip) are one run
+    if(r.x == _bounds.x && r.w == _bounds.w && _row_stride == n * _bytes_per_pixel) {
+      n *= rows;
+      rows = 1;
+    }
+
+    for(int y = r.y; y < r.y + rows; y++) {
+      uint8_t *p = (uint8_t *)ptr(r.x, y);
+#ifdef PICO
+      // big runs are written by dma while the caller carries on, the cpu
+      // does the unaligned head and tail first
+      size_t bytes = n * _bytes_per_pixel;
+      if(bytes >= fill_dma_min_bytes) {
+        size_t head = (4 - (uintptr_t(p) & 3)) & 3;
+        size_t tail = (bytes - head) & 3;
+        fill_run(p, head / _bytes_per_pixel, s, word);
+        fill_run(p + bytes - tail, tail / _bytes_per_pixel, s, word);
+        if(fill_dma(p + head, bytes - head - tail, word)) continue;
+      }
+#endif
+      fill_run(p, n, s, word);
+    }
   }
 
   void image_t::rectangle(rect_t r) {
+    modified();
     r = r.intersection(_clip);
+
+    // opaque solid colours replace the pixels outright, so skip the brush
+    uint32_t c;
+    if(_blend_func == blend_func_over && _alpha == 255 && _brush && _brush->solid(c) && _a(c) == 255) {
+      fill(r, c);
+      return;
+    }
+
     span_func_t fn = this->_span_func;
     for(int y = r.y; y < r.y + r.h; y++) {
       fn(this, this->_brush, r.x, y, r.w);
@@ -373,11 +1164,12 @@ namespace picovector {
   }
 
   void image_t::span(int x, int y, int w) {
+    modified();
     if(y < _clip.y || y >= _clip.y + _clip.h) return;
-    if(x + w < 0 || x >= _clip.x + _clip.w) return;
+    if(x + w <= _clip.x || x >= _clip.x + _clip.w) return;
 
-    if(x < 0) {
-      w += x; x = 0;
+    if(x < _clip.x) {
+      w -= _clip.x - x; x = _clip.x;
     }
 
     if(x + w >= _clip.x + _clip.w) {
@@ -387,11 +1179,12 @@ namespace picovector {
   }
 
   void image_t::masked_span(int x, int y, int w, uint8_t *mask) {
+    modified();
     if(y < _clip.y || y >= _clip.y + _clip.h) return;
-    if(x + w < 0 || x >= _clip.x + _clip.w) return;
+    if(x + w <= _clip.x || x >= _clip.x + _clip.w) return;
 
-    if(x < 0) {
-      w += x; x = 0;
+    if(x < _clip.x) {
+      w -= _clip.x - x; x = _clip.x;
     }
 
     if(x + w >= _clip.x + _clip.w) {
@@ -401,111 +1194,251 @@ namespace picovector {
     this->_masked_span_func(this, this->_brush, x, y, w, mask);
   }
 
-  void image_t::circle(const vec2_t &p, const int &r) {
-    rect_t b = rect_t(p.x - r, p.y - r, r * 2, r * 2);
-    if(!b.intersects(_clip)) return;
-
-    int ox = r, oy = 0, err = -r;
-    while (ox >= oy)
-    {
-      int last_oy = oy;
+  // each row of the mask is handed to the masked span function as it is,
+  // only a mask with its own alpha is scaled into a chunk first
+  void image_t::mask(image_t *mask, const vec2_t p) {
+    if(!_brush || mask->pixel_format() != A8) return;
 
-      err += oy; oy++; err += oy;
+    int px = floorf(p.x), py = floorf(p.y);
+    rect_t mb = mask->bounds();
+    rect_t r = rect_t(px, py, mb.w, mb.h).intersection(_clip).intersection(_bounds);
+    if(r.empty()) return;
+    modified();
 
-      this->span(p.x - ox, p.y + last_oy, ox * 2 + 1);
-      if (last_oy != 0) {
-        this->span(p.x - ox, p.y - last_oy, ox * 2 + 1);
+    uint32_t alpha = mask->alpha();
+    for(int y = r.y; y < r.y + r.h; y++) {
+      uint8_t *m = (uint8_t *)mask->ptr(r.x - px, y - py);
+      if(alpha == 255) {
+        this->_masked_span_func(this, this->_brush, r.x, y, r.w, m);
+        continue;
       }
 
-      if(err >= 0 && ox != last_oy) {
-        this->span(p.x - last_oy, p.y + ox, last_oy * 2 + 1);
-        if (ox != 0) {
-          this->span(p.x - last_oy, p.y - ox, last_oy * 2 + 1);
+      const int chunk = 64;
+      uint8_t scaled[chunk];
+      for(int x = r.x; x < r.x + r.w; x += chunk) {
+        int n = min(chunk, int(r.x + r.w) - x);
+        for(int i = 0; i < n; i++) {
+          scaled[i] = _premul_mul_alpha_channel(m[i], alpha);
         }
-
-        err -= ox; ox--; err -= ox;
+        this->_masked_span_func(this, this->_brush, x, y, n, scaled);
+        m += n;
       }
     }
   }
 
-  int32_t orient2d(vec2_t p1, vec2_t p2, vec2_t p3) {
-    return (p2.x - p1.x) * (p3.y - p1.y) - (p2.y - p1.y) * (p3.x - p1.x);
-  }
+  // one edge of a triangle being scan converted, in 28.4 fixed point. the
+  // pixels on a row that are inside it are those where a * x + w >= 0, so
+  // depending on the sign of a it bounds the row on the left at
+  // ceil(-w / a) or on the right at floor(w / -a). that bound is stepped
+  // from row to row as a quotient and remainder, leaving no division in the
+  // loop
+  struct triangle_edge_t {
+    int64_t a;              // change in w per pixel along the row
+    int64_t w, b;           // w at x = 0 on the current row, and its change per row
+    int64_t q = 0, r = 0;   // ceil(-w / |a|) and q * |a| + w, 0 <= r < |a|
+    int64_t sq = 0, sr = 0; // the same split for -b, all unused when a is 0
+    int64_t d;              // |a|
+
+    static int64_t ceil_div(int64_t n, int64_t d) {
+      int64_t q = n / d;
+      if(n % d > 0) q++;
+      return q;
+    }
+
+    // the edge from p to e sampled at integer pixel positions starting on
+    // row y, bias is -1 for edges that don't own the pixels they pass through
+    triangle_edge_t(int32_t px, int32_t py, int32_t ex, int32_t ey, int y, int bias) {
+      a = int64_t(py - ey) * 16;
+      b = int64_t(ex - px) * 16;
+      w = int64_t(ex - px) * (int64_t(y) * 16 - py) + int64_t(ey - py) * px + bias;
+      d = a < 0 ? -a : a;
+      if(d) {
+        q = ceil_div(-w, d); r = q * d + w;
+        sq = ceil_div(-b, d); sr = sq * d + b;
+      }
+    }
+
+    void next() {
+      w += b;
+      if(d) {
+        q += sq; r += sr;
+        if(r >= d) {q--; r -= d;}
+      }
+    }
+
+    // narrow [x1, x2) to the part of the row inside the edge
+    void clip(int &x1, int &x2) const {
+      if(a > 0) {
+        x1 = max(x1, int(max(q, int64_t(INT32_MIN))));
+      }else if(a < 0) {
+        x2 = min(x2, int(min(1 - q, int64_t(INT32_MAX))));
+      }else if(w < 0) {
+        x2 = x1;
+      }
+    }
+  };
 
-  bool is_top_left(const vec2_t &p1, const vec2_t &p2) {
-    return (p1.y == p2.y && p1.x > p2.x) || (p1.y < p2.y);
+  static inline bool is_top_left(int32_t x1, int32_t y1, int32_t x2, int32_t y2) {
+    return (y1 == y2 && x1 > x2) || (y1 < y2);
   }
 
-  void image_t::triangle(vec2_t p1, vec2_t p2, vec2_t p3) {
-    rect_t b(
-      vec2_t(min(p1.x, min(p2.x, p3.x)), min(p1.y, min(p2.y, p3.y))),
-      vec2_t(max(p1.x, max(p2.x, p3.x)), max(p1.y, max(p2.y, p3.y)))
-    );
+  static inline int32_t to_fx4(float v) {
+    // far off screen points are pulled in enough that the edge maths can't
+    // overflow, the visible part of the triangle barely moves
+    v = max(-32768.0f, min(32767.0f, v));
+    return int32_t(floorf(v * 16.0f + 0.5f));
+  }
 
-    // clip extremes to frame buffer size
-    b = b.intersection(_clip);
+  // scanline triangle fill, each row's extent comes from stepping the three
+  // edges and is drawn with a single span. vertices are snapped to 1/16th of
+  // a pixel and pixels are sampled at their top left corner, pixels exactly
+  // on an edge belong to the triangle if it's a top or left edge so that
+  // neighbouring triangles never overdraw
+  void image_t::triangle(vec2_t p1, vec2_t p2, vec2_t p3, bool aa) {
+    modified();
+    if(aa) {
+      // antialiased triangles take the fixed point shape path, the points
+      // are added directly so nothing is allocated. if the rasteriser
+      // couldn't get its buffers the triangle is drawn without antialiasing
+      vec2_t p[3] = {p1, p2, p3};
+      pvr_reset(_antialias == X2 ? X2 : X4);
+      pvr_add_path(p, 3, nullptr);
+      if(pvr_render(this, _clip, _brush)) return;
+    }
 
-    // if triangle completely out of bounds then don't bother!
-    if (b.empty()) return;
+    int32_t x1 = to_fx4(p1.x), y1 = to_fx4(p1.y);
+    int32_t x2 = to_fx4(p2.x), y2 = to_fx4(p2.y);
+    int32_t x3 = to_fx4(p3.x), y3 = to_fx4(p3.y);
 
     // fix "winding" of vertices if needed
-    int32_t winding = orient2d(p1, p2, p3);
-    if (winding < 0) {
-      vec2_t t;
-      t = p1; p1 = p3; p3 = t;
+    int64_t winding = int64_t(x2 - x1) * (y3 - y1) - int64_t(y2 - y1) * (x3 - x1);
+    if(winding == 0) return;
+    if(winding < 0) {
+      std::swap(x1, x3); std::swap(y1, y3);
     }
 
+    // rows whose top left corners fall within the triangle's vertical
+    // extent, the edges themselves bound each row
+    int cx1 = ceilf(_clip.x), cx2 = floorf(_clip.x + _clip.w);
+    int ry1 = max(int(ceilf(_clip.y)), (min(y1, min(y2, y3)) + 15) >> 4);
+    int ry2 = min(int(floorf(_clip.y + _clip.h)), (max(y1, max(y2, y3)) + 15) >> 4);
+    if(ry1 >= ry2) return;
+
     // bias ensures no overdraw between neighbouring triangles
-    int8_t bias0 = is_top_left(p2, p3) ? 0 : -1;
-    int8_t bias1 = is_top_left(p3, p1) ? 0 : -1;
-    int8_t bias2 = is_top_left(p1, p2) ? 0 : -1;
-
-    int32_t a01 = p1.y - p2.y;
-    int32_t b01 = p2.x - p1.x;
-    int32_t a12 = p2.y - p3.y;
-    int32_t b12 = p3.x - p2.x;
-    int32_t a20 = p3.y - p1.y;
-    int32_t b20 = p1.x - p3.x;
-
-    vec2_t tl(b.x, b.y);
-    int32_t w0row = orient2d(p2, p3, tl) + bias0;
-    int32_t w1row = orient2d(p3, p1, tl) + bias1;
-    int32_t w2row = orient2d(p1, p2, tl) + bias2;
+    triangle_edge_t e0(x2, y2, x3, y3, ry1, is_top_left(x2, y2, x3, y3) ? 0 : -1);
+    triangle_edge_t e1(x3, y3, x1, y1, ry1, is_top_left(x3, y3, x1, y1) ? 0 : -1);
+    triangle_edge_t e2(x1, y1, x2, y2, ry1, is_top_left(x1, y1, x2, y2) ? 0 : -1);
 
     span_func_t fn = this->_span_func;
 
-    for (int32_t y = 0; y < b.h; y++) {
-      int32_t w0 = w0row;
-      int32_t w1 = w1row;
-      int32_t w2 = w2row;
+    for(int y = ry1; y < ry2; y++) {
+      int sx = cx1, ex = cx2;
+      e0.clip(sx, ex);
+      e1.clip(sx, ex);
+      e2.clip(sx, ex);
 
-      int xo = b.x;
-      int yo = b.y + y;
-      for (int32_t x = 0; x < b.w; x++) {
-        if ((w0 | w1 | w2) >= 0) {
-          fn(this, this->_brush, xo, yo, 1);
-        }
+      if(ex > sx) {
+        fn(this, this->_brush, sx, y, ex - sx);
+      }
 
-        xo++;
-        w0 += a12; w1 += a20; w2 += a01;
+      e0.next(); e1.next(); e2.next();
+    }
+  }
+
+  // coverage for consecutive pixels along a row, drawn as one masked span
+  // once the run ends
+  struct coverage_run_t {
+    static const int max_length = 64;
+
+    image_t *target;
+    int x = 0, y = INT32_MIN, w = 0;
+    uint8_t mask[max_length];
+
+    void flush() {
+      // the runs of an antialiased line can spill a pixel past the clip
+      rect_t c = target->clip();
+      int sx = max(x, int(c.x)), ex = min(x + w, int(c.x + c.w));
+      if(w && y >= c.y && y < c.y + c.h && ex > sx) {
+        target->_masked_span_func(target, target->brush(), sx, y, ex - sx, &mask[sx - x]);
       }
+      w = 0;
+    }
 
-      w0row += b12; w1row += b20; w2row += b01;
+    void add(int px, int py, float coverage) {
+      if(w && (py != y || px != x + w || w == max_length)) flush();
+      if(!w) {x = px; y = py;}
+      mask[w++] = uint8_t(max(0.0f, min(coverage, 1.0f)) * 255.0f + 0.5f);
+    }
+  };
+
+  // xiaolin wu's line, each step along the major axis covers two pixels
+  // split by where the line passes between them. the pixels are gathered
+  // into runs along each row so shallow lines cost a masked span per row
+  // rather than a call per pixel
+  static void wu_line(image_t *target, vec2_t p1, vec2_t p2) {
+    rect_t b = target->clip();
+    b = rect_t(b.x - 1, b.y - 1, b.w + 1, b.h + 1);
+    if(!clip_line(p1, p2, b)) {
+      return;
+    }
 
+    bool steep = fabsf(p2.y - p1.y) > fabsf(p2.x - p1.x);
+    if(steep) {
+      std::swap(p1.x, p1.y); std::swap(p2.x, p2.y);
+    }
+    if(p1.x > p2.x) {
+      std::swap(p1, p2);
     }
-  }
 
-  void round_rectangle(const rect_t &r, int radius) {
+    float dx = p2.x - p1.x;
+    float gradient = dx == 0.0f ? 1.0f : (p2.y - p1.y) / dx;
 
-  }
+    // upper and lower pixel of each step, or both pixels of a row when steep
+    coverage_run_t r0, r1;
+    r0.target = r1.target = target;
 
+    auto plot = [&](int major, float minor, float weight) {
+      int ipart = floorf(minor);
+      float f = minor - float(ipart);
+      if(steep) {
+        r0.add(ipart, major, (1.0f - f) * weight);
+        r0.add(ipart + 1, major, f * weight);
+        return;
+      }
 
-  void ellipse(const vec2_t &p, const int &rx, const int &ry) {
+      // keep each run on its own row as the line steps between rows
+      if(r0.y == ipart + 1 || r1.y == ipart) std::swap(r0, r1);
+      r0.add(major, ipart, (1.0f - f) * weight);
+      r1.add(major, ipart + 1, f * weight);
+    };
+
+    // endpoints are weighted by how much of their pixel the line covers
+    int x1 = roundf(p1.x);
+    int x2 = roundf(p2.x);
+    float y = p1.y + gradient * (float(x1) - p1.x);
+    if(x1 == x2) {
+      plot(x1, y, dx);
+    }else{
+      plot(x1, y, 1.0f - (p1.x + 0.5f - floorf(p1.x + 0.5f)));
+      y += gradient;
+      for(int x = x1 + 1; x < x2; x++) {
+        plot(x, y, 1.0f);
+        y += gradient;
+      }
+      plot(x2, y, p2.x + 0.5f - floorf(p2.x + 0.5f));
+    }
 
+    r0.flush();
+    r1.flush();
   }
 
+  void image_t::line(vec2_t p1, vec2_t p2, bool aa) {
+    modified();
+    if(aa) {
+      wu_line(this, p1, p2);
+      return;
+    }
 
-  void image_t::line(vec2_t p1, vec2_t p2) {
     rect_t b = this->_clip;
     b.w -= 1;
     b.h -= 1; // TODO: this is hacky... fix it properly
@@ -518,34 +1451,470 @@ namespace picovector {
     int y0 = p1.y;
     int y1 = p2.y;
 
+    span_func_t fn = this->_span_func;
+
+    if(x0 == x1) {
+      // vertical, one pixel per row and nothing to step
+      int sy = y0 < y1 ? 1 : -1;
+      for(int y = y0; y != y1 + sy; y += sy) {
+        fn(this, this->_brush, x0, y, 1);
+      }
+      return;
+    }
+
     int dx = abs(x1 - x0);
     int sx = x0 < x1 ? 1 : -1;
     int dy = -abs(y1 - y0);
     int sy = y0 < y1 ? 1 : -1;
     int err = dx + dy;
 
-    span_func_t fn = this->_span_func;
-
+    // bresenham picks the pixels, every pixel it places on a row is
+    // collected into a single span that's drawn when the line leaves the
+    // row. shallow lines make one call per row, steep ones one per pixel
+    int run = x0;
     while(true) {
-        fn(this, this->_brush, x0, y0, 1);
-        if (x0 == x1 && y0 == y1) break;
-        int e2 = 2 * err;
-        if (e2 >= dy) {err += dy; x0 += sx;}
-        if (e2 <= dx) {err += dx; y0 += sy;}
+      if (x0 == x1 && y0 == y1) break;
+      int e2 = 2 * err;
+      int px = x0;
+      if (e2 >= dy) {err += dy; x0 += sx;}
+      if (e2 <= dx) {
+        fn(this, this->_brush, min(run, px), y0, abs(px - run) + 1);
+        err += dx; y0 += sy;
+        run = x0;
+      }
+    }
+    fn(this, this->_brush, min(run, x0), y0, abs(x0 - run) + 1);
+  }
+  // antialiased fill of a convex shape that's symmetric about a vertical
+  // axis. each row is split by how far the outline reaches across it,
+  // pixels it can't touch are drawn as one solid span and those either side
+  // take their coverage from the signed distance to the outline at their
+  // centre. the shape gives its centre, vertical extent, half width at a
+  // height and signed distance at a point
+  template<typename outline_t> static void aa_fill_rows(image_t *target, const outline_t &o) {
+    rect_t c = target->clip();
+    int cx1 = c.x, cx2 = c.x + c.w;
+    int y1 = max(int(floorf(o.top)), int(c.y));
+    int y2 = min(int(ceilf(o.bottom)), int(c.y + c.h));
+
+    coverage_run_t run;
+    run.target = target;
+
+    for(int y = y1; y < y2; y++) {
+      // widest and narrowest the shape gets within the row
+      float outer = o.half_width(max(float(y), min(o.cy, float(y + 1))));
+      float inner = min(o.half_width(float(y)), o.half_width(float(y + 1)));
+
+      int ox1 = floorf(o.cx - outer), ox2 = ceilf(o.cx + outer);
+      int ix1 = ceilf(o.cx - inner), ix2 = floorf(o.cx + inner);
+      if(ix2 <= ix1) {
+        ix1 = ix2 = ox2;
+      }
+
+      float py = float(y) + 0.5f;
+      for(int x = max(ox1, cx1); x < min(ix1, cx2); x++) {
+        run.add(x, y, 0.5f - o.distance(float(x) + 0.5f, py));
+      }
+      run.flush();
+
+      if(ix2 > ix1) {
+        target->span(ix1, y, ix2 - ix1);
+      }
+
+      for(int x = max(ix2, cx1); x < min(ox2, cx2); x++) {
+        run.add(x, y, 0.5f - o.distance(float(x) + 0.5f, py));
+      }
+      run.flush();
+    }
+  }
+
+  struct ellipse_outline_t {
+    float cx, cy, rx, ry, top, bottom;
+
+    ellipse_outline_t(float cx, float cy, float rx, float ry)
+      : cx(cx), cy(cy), rx(rx), ry(ry), top(cy - ry), bottom(cy + ry) {}
+
+    float half_width(float y) const {
+      float d = (y - cy) / ry;
+      return d * d >= 1.0f ? 0.0f : rx * sqrtf(1.0f - d * d);
+    }
+
+    // first order estimate, exact for circles and close enough to the
+    // outline for gentle ellipses
+    float distance(float x, float y) const {
+      float dx = (x - cx) / rx, dy = (y - cy) / ry;
+      float g = sqrtf(dx * dx + dy * dy);
+      if(g < 1e-6f) return -min(rx, ry);
+      float gx = dx / (rx * g), gy = dy / (ry * g);
+      return (g - 1.0f) / sqrtf(gx * gx + gy * gy);
+    }
+  };
+
+  struct round_rectangle_outline_t {
+    float cx, cy, hw, hh, r, top, bottom;
+
+    round_rectangle_outline_t(const rect_t &rect, float r)
+      : cx(rect.x + rect.w / 2.0f), cy(rect.y + rect.h / 2.0f), hw(rect.w / 2.0f), hh(rect.h / 2.0f), r(r), top(rect.y), bottom(rect.y + rect.h) {}
+
+    float half_width(float y) const {
+      float dy = fabsf(y - cy);
+      if(dy > hh) return 0.0f;
+      float e = dy - (hh - r);
+      if(e <= 0.0f) return hw;
+      return hw - r + sqrtf(max(0.0f, r * r - e * e));
+    }
+
+    float distance(float x, float y) const {
+      float qx = fabsf(x - cx) - (hw - r), qy = fabsf(y - cy) - (hh - r);
+      float ox = max(qx, 0.0f), oy = max(qy, 0.0f);
+      return sqrtf(ox * ox + oy * oy) + min(max(qx, qy), 0.0f) - r;
+    }
+  };
+
+  // antialiased disc or ring centred on (cx, cy) between radii ri and ro,
+  // a disc when ri is zero. each row is split by how far the two circles
+  // reach across it, pixels that can't be touched by either are drawn as
+  // solid spans or skipped and only those the outlines cross have their
+  // coverage worked out, from their distance to the nearer outline
+  static void aa_ring(image_t *target, float cx, float cy, float ro, float ri) {
+    rect_t c = target->clip();
+    int cx1 = c.x, cx2 = c.x + c.w;
+    int y1 = max(int(floorf(cy - ro)), int(c.y));
+    int y2 = min(int(ceilf(cy + ro)), int(c.y + c.h));
+
+    // half width of a circle of radius r at height y, and the widest and
+    // narrowest it gets across the row starting at y
+    auto half_width = [cy](float r, float y) {
+      float d = y - cy;
+      return d * d >= r * r ? 0.0f : sqrtf(r * r - d * d);
+    };
+    auto widest = [&](float r, float y) {
+      return half_width(r, max(y, min(cy, y + 1.0f)));
+    };
+    auto narrowest = [&](float r, float y) {
+      return min(half_width(r, y), half_width(r, y + 1.0f));
+    };
+
+    coverage_run_t run;
+    run.target = target;
+
+    for(int y = y1; y < y2; y++) {
+      float fy = y;
+
+      // pixels the disc reaches and those it covers completely
+      int ox1 = floorf(cx - widest(ro, fy)), ox2 = ceilf(cx + widest(ro, fy));
+      float inner = narrowest(ro, fy);
+      int ix1 = ceilf(cx - inner), ix2 = floorf(cx + inner);
+
+      // pixels the hole reaches and those entirely within it
+      int hx1 = INT32_MIN, hx2 = INT32_MIN, hs1 = INT32_MIN, hs2 = INT32_MIN;
+      if(ri > 0.0f && fy < cy + ri && fy + 1.0f > cy - ri) {
+        hx1 = floorf(cx - widest(ri, fy)); hx2 = ceilf(cx + widest(ri, fy));
+        float hole = narrowest(ri, fy);
+        hs1 = ceilf(cx - hole); hs2 = floorf(cx + hole);
+      }
+
+      float dy = float(y) + 0.5f - cy;
+      int x = max(ox1, cx1), end = min(ox2, cx2);
+      while(x < end) {
+        if(x >= hs1 && x < hs2) {
+          x = hs2;
+          continue;
+        }
+
+        if(x >= ix1 && x < ix2 && (x < hx1 || x >= hx2)) {
+          int e = min(end, x < hx1 ? min(ix2, hx1) : ix2);
+          run.flush();
+          target->span(x, y, e - x);
+          x = e;
+          continue;
+        }
+
+        float dx = float(x) + 0.5f - cx;
+        float l = sqrtf(dx * dx + dy * dy);
+        float d = ri > 0.0f ? max(l - ro, ri - l) : l - ro;
+        run.add(x, y, 0.5f - d);
+        x++;
+      }
+      run.flush();
+    }
+  }
+
+  // filled circle centred on pixel p, the midpoint circle covers the pixels
+  // where x² + y² <= r² + r. when the image is antialiased the same area is
+  // drawn with a soft edge
+  void image_t::circle(const vec2_t &p, const int &r) {
+    modified();
+    if(_antialias != OFF) {
+      aa_ring(this, p.x + 0.5f, p.y + 0.5f, r + 0.5f, 0.0f);
+      return;
+    }
+
+    rect_t b = rect_t(p.x - r, p.y - r, r * 2, r * 2);
+    if(!b.intersects(_clip)) return;
+
+    int ox = r, oy = 0, err = -r;
+    while (ox >= oy)
+    {
+      int last_oy = oy;
+
+      err += oy; oy++; err += oy;
+
+      this->span(p.x - ox, p.y + last_oy, ox * 2 + 1);
+      if (last_oy != 0) {
+        this->span(p.x - ox, p.y - last_oy, ox * 2 + 1);
+      }
+
+      if(err >= 0 && ox != last_oy) {
+        this->span(p.x - last_oy, p.y + ox, last_oy * 2 + 1);
+        if (ox != 0) {
+          this->span(p.x - last_oy, p.y - ox, last_oy * 2 + 1);
+        }
+
+        err -= ox; ox--; err -= ox;
+      }
     }
   }
 
+  // ring of the given thickness around pixel p, that's the pixels of a
+  // circle of radius r that aren't in one of radius r - thickness. the two
+  // quadrants are stepped together so each row is at most two spans
+  void image_t::ring(const vec2_t &p, const int &r, const int &thickness) {
+    modified();
+    if(r < 0 || thickness <= 0) return;
+    int ri = r - thickness;
+    if(ri < 0) {
+      circle(p, r);
+      return;
+    }
+
+    if(_antialias != OFF) {
+      aa_ring(this, p.x + 0.5f, p.y + 0.5f, r + 0.5f, ri + 0.5f);
+      return;
+    }
+
+    int cx = p.x, cy = p.y;
+    if(!rect_t(cx - r, cy - r, r * 2 + 1, r * 2 + 1).intersects(_clip)) return;
+
+    int64_t outer_limit = int64_t(r) * r + r, inner_limit = int64_t(ri) * ri + ri;
+    int ox = r, ix = ri;
+    for(int dy = 0; dy <= r; dy++) {
+      int64_t dy2 = int64_t(dy) * dy;
+      while(ox > 0 && int64_t(ox) * ox + dy2 > outer_limit) {
+        ox--;
+      }
+      // -1 once the row is past the hole
+      while(ix >= 0 && int64_t(ix) * ix + dy2 > inner_limit) {
+        ix--;
+      }
+
+      for(int sy = dy ? -1 : 1; sy <= 1; sy += 2) {
+        int y = cy + dy * sy;
+        if(ix < 0) {
+          this->span(cx - ox, y, ox * 2 + 1);
+        }else{
+          this->span(cx - ox, y, ox - ix);
+          this->span(cx + ix + 1, y, ox - ix);
+        }
+      }
+    }
+  }
+
+  // filled ellipse centred on pixel p, one span per row. a pixel is inside
+  // when x² ry² + y² rx² <= rx² ry² + rx ry (rx + ry) / 2, for a circle
+  // that's the x² + y² <= r² + r the midpoint circle draws. walking down a
+  // quadrant the row can only get narrower so its half width steps down
+  // from rx. antialiased ellipses cover the same area with a soft edge and
+  // can sit between pixels
+  void image_t::ellipse(const vec2_t &p, const int &rx, const int &ry, bool aa) {
+    modified();
+    if(rx < 0 || ry < 0) return;
+
+    if(aa) {
+      aa_fill_rows(this, ellipse_outline_t(p.x + 0.5f, p.y + 0.5f, rx + 0.5f, ry + 0.5f));
+      return;
+    }
+
+    int cx = p.x, cy = p.y;
+    if(!rect_t(cx - rx, cy - ry, rx * 2 + 1, ry * 2 + 1).intersects(_clip)) return;
+
+    int64_t a2 = int64_t(rx) * rx, b2 = int64_t(ry) * ry;
+    int64_t limit = 2 * a2 * b2 + int64_t(rx) * ry * (rx + ry);
+
+    int dx = rx;
+    for(int dy = 0; dy <= ry; dy++) {
+      while(dx > 0 && 2 * (dx * dx * b2 + dy * dy * a2) > limit) {
+        dx--;
+      }
+      this->span(cx - dx, cy + dy, dx * 2 + 1);
+      if(dy) {
+        this->span(cx - dx, cy - dy, dx * 2 + 1);
+      }
+    }
+  }
+
+  // filled rectangle with corners that are quarters of a circle, one span
+  // per row. aliased corners are midpoint circles centred radius pixels in
+  // from each edge and the rows between them are full width, antialiased
+  // ones follow the exact outline of r
+  void image_t::round_rectangle(const rect_t &r, int radius, bool aa) {
+    modified();
+    if(aa) {
+      float rr = max(0.0f, min(float(radius), min(r.w, r.h) / 2.0f));
+      aa_fill_rows(this, round_rectangle_outline_t(r, rr));
+      return;
+    }
+
+    int x = r.x, y = r.y, w = r.w, h = r.h;
+    if(w <= 0 || h <= 0) return;
+    if(!rect_t(x, y, w, h).intersects(_clip)) return;
+    radius = max(0, min(radius, (min(w, h) - 1) / 2));
+
+    int top = y + radius, bottom = y + h - 1 - radius;
+    if(bottom - top > 1) {
+      this->rectangle(rect_t(x, top + 1, w, bottom - top - 1));
+    }
+
+    int64_t limit = int64_t(radius) * radius + radius;
+    int dx = radius;
+    for(int dy = 0; dy <= radius; dy++) {
+      while(dx > 0 && int64_t(dx) * dx + int64_t(dy) * dy > limit) {
+        dx--;
+      }
+      int inset = radius - dx;
+      this->span(x + inset, top - dy, w - inset * 2);
+      if(dy || bottom != top) {
+        this->span(x + inset, bottom + dy, w - inset * 2);
+      }
+    }
+  }
+
+  // the range of rows covered by each column of a plot is worked out for a
+  // chunk of columns at a time and then filled row by row, so runs of
+  // columns that share a row become a single span
+  static const int PLOT_CHUNK = 256;
+
+  template<typename T> static void plot_samples(image_t *target, const T *samples, int n, rect_t r, float ymin, float ymax, plot_mode_t mode) {
+    r = r.round();
+    int w = r.w, h = r.h;
+    if(n <= 0 || w <= 0 || h <= 0 || ymin == ymax) return;
+
+    rect_t c = target->clip().intersection(r);
+    if(c.w <= 0 || c.h <= 0) return;
+
+    // values map linearly onto the rows of r with ymax at the top. area and
+    // bars are filled to zero, or whichever of ymin and ymax is nearest it
+    float scale = float(h - 1) / (ymax - ymin);
+    float base = max(min(ymin, ymax), min(0.0f, max(ymin, ymax)));
+    auto row = [&](float v) -> int {
+      return max(0, min(h - 1, int(floorf((ymax - v) * scale + 0.5f))));
+    };
+    int base_row = row(base);
+
+    int16_t lo[PLOT_CHUNK], hi[PLOT_CHUNK];
+    int c0 = c.x - r.x, c1 = c0 + c.w;
+    for(int cs = c0; cs < c1; cs += PLOT_CHUNK) {
+      int ce = min(c1, cs + PLOT_CHUNK);
+      int top = h, bottom = -1;
+
+      for(int col = cs; col < ce; col++) {
+        float vmin, vmax;
+        bool gap = false;
+
+        if(mode == PLOT_BARS) {
+          // a bucket of samples per column, or a bar several columns wide
+          // per sample with a column left between bars that are wide enough
+          int i0 = int64_t(col) * n / w;
+          int i1 = max(i0 + 1, int(int64_t(col + 1) * n / w));
+          vmin = vmax = samples[i0];
+          for(int i = i0 + 1; i < i1; i++) {
+            vmin = min(vmin, float(samples[i]));
+            vmax = max(vmax, float(samples[i]));
+          }
+          if(n < w) {
+            int bx0 = int64_t(i0) * w / n, bx1 = int64_t(i0 + 1) * w / n;
+            gap = bx1 - bx0 >= 3 && col == bx1 - 1;
+          }
+        }else if(n == 1) {
+          vmin = vmax = samples[0];
+        }else{
+          // the stretch of the polyline through samples 0..n-1 that falls in
+          // this column, its ends are interpolated and every sample in
+          // between is an extreme candidate
+          float a = float(col) * float(n - 1) / float(w);
+          float b = float(col + 1) * float(n - 1) / float(w);
+          int ia = min(n - 2, int(a)), ib = min(n - 2, int(b));
+          float va = samples[ia] + (float(samples[ia + 1]) - float(samples[ia])) * (a - float(ia));
+          float vb = samples[ib] + (float(samples[ib + 1]) - float(samples[ib])) * (b - float(ib));
+          vmin = min(va, vb); vmax = max(va, vb);
+          for(int i = ia + 1; i <= ib; i++) {
+            vmin = min(vmin, float(samples[i]));
+            vmax = max(vmax, float(samples[i]));
+          }
+        }
+
+        int y0 = row(vmax), y1 = row(vmin);
+        if(ymin > ymax) std::swap(y0, y1);
+        if(mode != PLOT_LINE) {
+          y0 = min(y0, base_row);
+          y1 = max(y1, base_row);
+        }
+        if(gap) {
+          y0 = h; y1 = -1;
+        }
+
+        lo[col - cs] = y0; hi[col - cs] = y1;
+        top = min(top, y0); bottom = max(bottom, y1);
+      }
+
+      top = max(top, int(c.y - r.y));
+      bottom = min(bottom, int(c.y + c.h - r.y) - 1);
+      for(int y = top; y <= bottom; y++) {
+        int i = 0, count = ce - cs;
+        while(i < count) {
+          while(i < count && (y < lo[i] || y > hi[i])) i++;
+          int start = i;
+          while(i < count && y >= lo[i] && y <= hi[i]) i++;
+          if(i > start) {
+            target->span(r.x + cs + start, r.y + y, i - start);
+          }
+        }
+      }
+    }
+  }
+
+  /*
+    plots count samples across the columns of r, scaled so that ymin is on
+    the bottom row and ymax on the top. the samples are decimated to the
+    lowest and highest value seen by each column so the work is one pass
+    over the samples plus a span per run of filled pixels in each row
+
+    - PLOT_LINE: the samples joined by straight lines
+    - PLOT_AREA: as PLOT_LINE with everything down to zero filled
+    - PLOT_BARS: a bar from zero to each sample
+  */
+  void image_t::plot(const float *samples, int count, rect_t r, float ymin, float ymax, plot_mode_t mode) {
+    plot_samples(this, samples, count, r, ymin, ymax, mode);
+  }
+
+  void image_t::plot(const int16_t *samples, int count, rect_t r, float ymin, float ymax, plot_mode_t mode) {
+    plot_samples(this, samples, count, r, ymin, ymax, mode);
+  }
+
+
   void image_t::put(const vec2_t &p) {
     this->put(p.x, p.y);
   }
 
   void image_t::put(int x, int y) {
+    modified();
     x = max(int(_clip.x), min(x, int(_clip.x + _clip.w - 1)));
     y = max(int(_clip.y), min(y, int(_clip.y + _clip.h - 1)));
     this->_span_func(this, this->_brush, x, y, 1);
   }
 
   void image_t::put_unsafe(int x, int y) {
+    modified();
     this->_span_func(this, this->_brush, x, y, 1);
     //this->_brush->render_span(this, x, y, 1);
   }
@@ -565,6 +1934,15 @@ namespace picovector {
       uint8_t pi = *((uint8_t *)ptr(x, y));
       return this->_palette[pi];
     }
+    if(this->_pixel_format == RGB565) {
+      return _rgb565_to_rgba8888(*((uint16_t *)ptr(x, y)));
+    }
+    if(this->_pixel_format == RGBA4444) {
+      return _rgba4444_to_rgba8888(*((uint16_t *)ptr(x, y)));
+    }
+    if(this->_pixel_format == A8) {
+      return *((uint8_t *)ptr(x, y)) * 0x01010101u;
+    }
     return *((uint32_t *)ptr(x, y));
   }
 
@@ -7,6 +7,7 @@
 #include "picovector.config.hpp"
 #include "types.hpp"
 #include "blend.hpp"
+#include "fill.hpp"
 
 using std::vector;
 
@@ -27,16 +28,94 @@ namespace picovector {
     LOW   = 1,
     X2    = 1,
     HIGH  = 2,
-    X4    = 2
+    X4    = 2,
+    ANALYTIC = 3  // exact area coverage, roughly the cost of OFF
   } antialias_t;
 
+  // shape rasteriser used by draw(), FIXED is the 16:16 fixed point engine
+  // in rasteriser.cpp
+  typedef enum rasteriser_t {
+    FLOAT = 0,
+    FIXED = 1
+  } rasteriser_t;
+
+  // where an image's pixels live. ANY leaves it to PV_MALLOC, SRAM asks for
+  // the sram pool and falls back to PV_MALLOC once it's full
+  typedef enum memory_t {
+    MEMORY_ANY   = 0,
+    MEMORY_SRAM  = 1,
+    MEMORY_PSRAM = 2,
+    MEMORY_FLASH = 3  // read only, mapped assets
+  } memory_t;
+
+  // blur() kernels. IIR is a recursive lowpass that runs a pass each way
+  // in both directions, BOX a running sum window on packed channel pairs
+  // that costs the same at any radius
+  typedef enum blur_kernel_t {
+    BLUR_IIR = 0,
+    BLUR_BOX = 1
+  } blur_kernel_t;
+
+  // how quantise() spreads the difference between a pixel and the palette
+  // entry it's given
+  typedef enum quantise_t {
+    QUANTISE_NONE = 0,
+    QUANTISE_ORDERED = 1,
+    QUANTISE_FLOYD_STEINBERG = 2,
+    QUANTISE_ATKINSON = 3
+  } quantise_t;
+
+  // one step of image_t::filter()
+  struct filter_stage_t {
+    enum type_t {
+      MONOCHROME = 0,
+      ONEBIT = 1,
+      DITHER = 2,
+      BLUR = 3
+    } type;
+    float radius;          // BLUR only
+    blur_kernel_t kernel;  // BLUR only
+  };
+
+  // how image_t::plot() draws a series of samples
+  typedef enum plot_mode_t {
+    PLOT_LINE = 0,
+    PLOT_AREA = 1,
+    PLOT_BARS = 2
+  } plot_mode_t;
+
+  // A8 images only hold coverage, a byte a pixel, and read back as white
+  // at that coverage. drawing into them keeps just the alpha of what's drawn
   typedef enum pixel_format_t {
     RGBA8888 = 1,
     RGBA4444 = 2,
+    RGB565   = 3,
+    A8       = 4,
   } pixel_format_t;
 
+  // what the alpha channel of an image holds, worked out when it's first
+  // needed and kept until drawing might have changed it. blits of OPAQUE
+  // images copy instead of blending and BINARY_ALPHA ones only test for
+  // transparent pixels
+  typedef enum transparency_t {
+    TRANSPARENCY_UNKNOWN = 0,
+    OPAQUE       = 1,  // every pixel has alpha 255
+    BINARY_ALPHA = 2,  // every pixel has alpha 0 or 255
+    TRANSLUCENT  = 3
+  } transparency_t;
+
   typedef std::vector<uint32_t, PV_STD_ALLOCATOR<uint32_t>> palette_t;
 
+  // a run of visible pixels in a row of a compiled image, everything between
+  // runs is fully transparent. opaque runs are copied without blending
+  struct pixel_run_t {
+    uint16_t x;
+    uint16_t w : 15;
+    uint16_t opaque : 1;
+  };
+
+  typedef std::vector<pixel_run_t, PV_STD_ALLOCATOR<pixel_run_t>> pixel_runs_t;
+
   class mat3_t;
   class font_t;
   class pixel_font_t;
@@ -45,6 +124,7 @@ namespace picovector {
 
   class image_t {
     friend class brush_t;
+    friend class display_list_t;
 
     private:
       void              *_buffer = nullptr;
@@ -56,12 +136,20 @@ namespace picovector {
       rect_t             _clip;
       uint8_t            _alpha = 255;
       antialias_t        _antialias = OFF;
+      rasteriser_t       _rasteriser = FLOAT;
+      bool               _multicore = false;
       pixel_format_t     _pixel_format = RGBA8888;
       bool               _has_palette = false;
       brush_t           *_brush = nullptr;
       font_t            *_font = nullptr;
       pixel_font_t      *_pixel_font = nullptr;
       palette_t          _palette;
+      transparency_t     _transparency = TRANSPARENCY_UNKNOWN;
+      pixel_runs_t       _runs;
+      std::vector<uint32_t, PV_STD_ALLOCATOR<uint32_t>> _run_rows; // first run of each row, plus one past the end
+
+      transparency_t classify();
+      void uncompile();
 
     public:
       blend_func_t       _blend_func = blend_func_over;
@@ -70,16 +158,19 @@ namespace picovector {
 
       image_t();
       image_t(image_t *source, rect_t r);
-      image_t(int w, int h, pixel_format_t pixel_format=RGBA8888, bool has_palette=false);
+      image_t(int w, int h, pixel_format_t pixel_format=RGBA8888, bool has_palette=false, memory_t memory=MEMORY_ANY);
       image_t(void *buffer, int w, int h, pixel_format_t pixel_format=RGBA8888, bool has_palette=false);
       ~image_t();
 
+      static size_t bytes_per_pixel(pixel_format_t pixel_format, bool has_palette);
+
       size_t buffer_size();
       size_t bytes_per_pixel();
       bool is_compatible(image_t *other);
       void window(image_t *source, rect_t viewport);
       image_t window(rect_t r);
       inline void* ptr(int x, int y) const {
+        fill_sync();
         return (uint8_t *)(this->_buffer) + (x * this->_bytes_per_pixel) + (y * this->_row_stride);
       }
       uint32_t row_stride();
@@ -92,13 +183,54 @@ namespace picovector {
       // void delete_palette();
       void palette(uint8_t i, uint32_t c);
       uint32_t palette(uint8_t i);
+      uint8_t palette_index(uint32_t c);
+      const palette_t &palette();
 
       uint8_t alpha();
       void alpha(uint8_t alpha);
 
+      transparency_t transparency();
+      // setting UNKNOWN says the pixels have changed, so also drops any runs
+      // from compile()
+      void transparency(transparency_t transparency);
+
+      // called by everything that draws into the image. blending source
+      // over can't make an opaque image anything else, so only mixed alpha
+      // images and other blend modes lose their classification. writes made
+      // straight to the buffer must reset it with transparency(UNKNOWN)
+      inline void modified() {
+        if(_transparency == BINARY_ALPHA || _blend_func != blend_func_over) {
+          _transparency = TRANSPARENCY_UNKNOWN;
+        }
+        if(!_run_rows.empty()) {
+          uncompile();
+        }
+      }
+
+      // splits every row into runs of opaque and translucent pixels, so
+      // unscaled blits skip the transparent parts without reading them and
+      // copy the opaque parts. the runs are dropped by anything that changes
+      // the image, call it again afterwards
+      void compile();
+      bool compiled() {return !_run_rows.empty();}
+      const pixel_run_t *runs(int y, int &count) {
+        count = _run_rows[y + 1] - _run_rows[y];
+        return &_runs[_run_rows[y]];
+      }
+
       antialias_t antialias();
       void antialias(antialias_t antialias);
 
+      rasteriser_t rasteriser();
+      // where the pixels ended up, ANY if that can't be told from the address
+      memory_t memory();
+      void rasteriser(rasteriser_t rasteriser);
+
+      // split shape and glyph rendering between both cores when a core1
+      // worker is available
+      bool multicore();
+      void multicore(bool multicore);
+
       pixel_format_t pixel_format();
       void pixel_format(pixel_format_t pixel_format);
 
@@ -115,14 +247,22 @@ namespace picovector {
       uint32_t pixel(int x, int y);
       void span(int x, int y, int w);
       void masked_span(int x, int y, int w, uint8_t *mask);
+      // draws the brush through the coverage of an A8 image with its top
+      // left at p, clipped to the image's clip
+      void mask(image_t *mask, const vec2_t p);
       void clear();
       //void clear(uint32_t c);
       void rectangle(rect_t r);
-      void triangle(vec2_t p1, vec2_t p2, vec2_t p3);
-      void round_rectangle(const rect_t &r, int radius);
+      // writes c over r (clipped) regardless of brush, alpha or blend mode
+      void fill(rect_t r, uint32_t c);
+      void triangle(vec2_t p1, vec2_t p2, vec2_t p3, bool aa = false);
+      void round_rectangle(const rect_t &r, int radius, bool aa = false);
       void circle(const vec2_t &p, const int &r);
-      void ellipse(const vec2_t &p, const int &rx, const int &ry);
-      void line(vec2_t p1, vec2_t p2);
+      void ring(const vec2_t &p, const int &r, const int &thickness);
+      void ellipse(const vec2_t &p, const int &rx, const int &ry, bool aa = false);
+      void line(vec2_t p1, vec2_t p2, bool aa = false);
+      void plot(const float *samples, int count, rect_t r, float ymin, float ymax, plot_mode_t mode = PLOT_LINE);
+      void plot(const int16_t *samples, int count, rect_t r, float ymin, float ymax, plot_mode_t mode = PLOT_LINE);
       void put(const vec2_t &p1);
       void put(int x, int y);
       void put_unsafe(int x, int y);
@@ -132,9 +272,19 @@ namespace picovector {
 
       // image filters
       void blur(float radius);
+      void blur(float radius, rect_t area, blur_kernel_t kernel = BLUR_IIR);
       void dither();
+      // maps the pixels onto the first colours entries of an indexed
+      // target's palette, a row at a time, top left to top left
+      void quantise(image_t *target, int colours, quantise_t mode);
       void monochrome();
       void onebit();
+      // runs stages over area in order, fusing each run of per pixel stages
+      // into a single pass over the rows
+      void filter(const filter_stage_t *stages, int count, rect_t area);
+      // composites shape's blurred coverage, moved by offset, with the
+      // current brush. it's rendered and blurred at 1/scale resolution
+      void shadow(shape_t *shape, vec2_t offset, float radius, int scale);
 // pixel(x, y, col) or set(x, y, col)
 // 	•	line(x0, y0, x1, y1)
 // 	•	rect(x, y, w, h)
@@ -150,13 +300,17 @@ namespace picovector {
 
 
       void draw(shape_t *shape);
+      void draw(shape_t *shape, mat3_t *transform);
       void blit(image_t *t, const vec2_t p);
       void blit(image_t *t, rect_t tr);
       void blit(image_t *t, rect_t sr, rect_t tr);
+      void blit(image_t *t, const mat3_t &transform, bool bilinear = false);
+      void blit_sprites(image_t *t, const int16_t *sprites, int count, int stride);
 
 
 
       void vspan_tex(image_t *target, vec2_t p, uint c, vec2_t uvs, vec2_t uve);
+      void vspans_tex(image_t *target, const float *columns, int count, int stride);
   };
 
 }
@@ -0,0 +1,149 @@
+#include <algorithm>
+#include <string.h>
+#include <math.h>
+
+#include "label.hpp"
+#include "font.hpp"
+#include "pixel_font.hpp"
+#include "brush.hpp"
+#include "text_layout.hpp"
+
+using std::min;
+using std::max;
+
+namespace picovector {
+
+  // coverage is kept at its highest where glyphs overlap, so the edges of
+  // neighbouring glyphs don't cut into each other
+  static void label_coverage_span_func(image_t *target, brush_t *brush, int x, int y, int w) {
+    memset(target->ptr(x, y), 255, w);
+  }
+
+  static void label_coverage_masked_span_func(image_t *target, brush_t *brush, int x, int y, int w, uint8_t *mask) {
+    uint8_t *p = (uint8_t *)target->ptr(x, y);
+    for(int i = 0; i < w; i++) {
+      p[i] = max(p[i], mask[i]);
+    }
+  }
+
+  class label_coverage_brush_t : public brush_t {
+  public:
+    span_func_t span_func() {return label_coverage_span_func;}
+    masked_span_func_t masked_span_func() {return label_coverage_masked_span_func;}
+  };
+
+  label_t::~label_t() {
+    this->free_mask();
+  }
+
+  void label_t::free_mask() {
+    if(this->_mask) {
+#ifdef PICO
+      PV_FREE(this->_mask);
+#else
+      PV_FREE(this->_mask, this->_mask_size);
+#endif
+      this->_mask = nullptr;
+    }
+    this->_mask_size = 0;
+    this->_x = this->_y = this->_w = this->_h = 0;
+  }
+
+  void label_t::render(const char *text, antialias_t antialias) {
+    this->free_mask();
+
+    // a canvas big enough for anything the text could reach, vector glyphs
+    // can overhang their advance and descend below the em
+    int cx, cy, cw, ch;
+    if(this->font) {
+      int pad = int(ceilf(this->size * 0.4f)) + 1;
+      cx = -pad;
+      cy = -pad;
+      cw = int(ceilf(this->font->measure(nullptr, text, this->size).w)) + pad * 2;
+      ch = int(ceilf(this->size)) + pad * 2;
+    }else{
+      cx = 0;
+      cy = 0;
+      cw = text_layout_t::max_glyphs(text) * (this->pixel_font->width + 1);
+      ch = this->pixel_font->height;
+    }
+    if(cw <= 0 || ch <= 0) return;
+
+    size_t canvas_size = size_t(cw) * ch;
+    uint8_t *pixels = (uint8_t *)PV_MALLOC(canvas_size);
+    memset(pixels, 0, canvas_size);
+
+    {
+      label_coverage_brush_t coverage;
+      image_t canvas(pixels, cw, ch, A8);
+      canvas.antialias(antialias);
+      canvas.brush(&coverage);
+      canvas._span_func = label_coverage_span_func;
+      canvas._masked_span_func = label_coverage_masked_span_func;
+      if(this->font) {
+        this->font->draw(&canvas, text, -cx, -cy, this->size);
+      }else{
+        this->pixel_font->draw(&canvas, text, -cx, -cy);
+      }
+    }
+
+    // trim to the covered pixels, which usually leaves a fraction of it
+    int x1 = cw, y1 = ch, x2 = 0, y2 = 0;
+    for(int y = 0; y < ch; y++) {
+      uint8_t *row = pixels + y * cw;
+      for(int x = 0; x < cw; x++) {
+        if(row[x]) {
+          x1 = min(x1, x);
+          x2 = max(x2, x + 1);
+          y1 = min(y1, y);
+          y2 = y + 1;
+        }
+      }
+    }
+
+    if(x1 < x2) {
+      this->_x = cx + x1;
+      this->_y = cy + y1;
+      this->_w = x2 - x1;
+      this->_h = y2 - y1;
+      this->_mask_size = size_t(this->_w) * this->_h;
+      this->_mask = (uint8_t *)PV_MALLOC(this->_mask_size);
+      for(int y = 0; y < this->_h; y++) {
+        memcpy(this->_mask + y * this->_w, pixels + (y1 + y) * cw + x1, this->_w);
+      }
+    }
+
+#ifdef PICO
+    PV_FREE(pixels);
+#else
+    PV_FREE(pixels, canvas_size);
+#endif
+  }
+
+  void label_t::draw(image_t *target, brush_t *brush, int x, int y) {
+    if(!this->_mask) return;
+
+    int tx = x + this->_x;
+    int ty = y + this->_y;
+    rect_t r = rect_t(tx, ty, this->_w, this->_h).intersection(target->clip()).intersection(target->bounds());
+    if(r.empty()) return;
+
+    target->modified();
+
+    // the span functions come from the target's brush, so the label's
+    // stands in while it's composited
+    brush_t *previous = target->brush();
+    if(brush != previous) {
+      target->brush(brush);
+    }
+
+    for(int row = r.y; row < r.y + r.h; row++) {
+      render_mask_row(target, brush, r.x, row, r.w, this->_mask + (row - ty) * this->_w + (int(r.x) - tx));
+    }
+
+    if(brush != previous && previous) {
+      target->brush(previous);
+    }
+  }
+
+}
@@ -0,0 +1,42 @@
+#pragma once
+
+#include <stdint.h>
+
+#include "picovector.hpp"
+#include "image.hpp"
+#include "types.hpp"
+
+namespace picovector {
+
+  class font_t;
+  class pixel_font_t;
+
+  // text rasterised once into an a8 coverage mask and composited from it
+  // every draw after, until it's rendered again. the brush is applied as
+  // the mask is composited so changing colour costs nothing
+  class label_t {
+  public:
+    font_t       *font = nullptr;       // one of font or pixel_font is set
+    pixel_font_t *pixel_font = nullptr;
+    float         size = 0.0f;          // ignored for pixel fonts
+
+    ~label_t();
+
+    // replaces the mask with text in the current font and size, trimmed
+    // to the pixels it covers
+    void render(const char *text, antialias_t antialias);
+
+    // area the mask covers relative to the position it's drawn at
+    rect_t bounds() {return rect_t(_x, _y, _w, _h);}
+
+    void draw(image_t *target, brush_t *brush, int x, int y);
+
+  private:
+    uint8_t *_mask = nullptr;
+    size_t   _mask_size = 0;
+    int      _x = 0, _y = 0, _w = 0, _h = 0;
+
+    void free_mask();
+  };
+
+}
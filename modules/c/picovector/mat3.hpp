@@ -87,6 +87,11 @@ namespace picovector {
 
       return *this;
     }
+
+    // largest stretch applied along either axis
+    float max_scale() const {
+      return fmaxf(hypotf(v00, v10), hypotf(v01, v11));
+    }
   };
 
 }
@@ -6,6 +6,8 @@ list(APPEND SOURCES
   ${CMAKE_CURRENT_LIST_DIR}/micropython/picovector_bindings.c
   ${CMAKE_CURRENT_LIST_DIR}/micropython/picovector.cpp
   ${CMAKE_CURRENT_LIST_DIR}/picovector.cpp
+  ${CMAKE_CURRENT_LIST_DIR}/rasteriser.cpp
+  ${CMAKE_CURRENT_LIST_DIR}/display_list.cpp
   ${CMAKE_CURRENT_LIST_DIR}/shape.cpp
   ${CMAKE_CURRENT_LIST_DIR}/font.cpp
   ${CMAKE_CURRENT_LIST_DIR}/pixel_font.cpp
@@ -13,19 +15,36 @@ list(APPEND SOURCES
   ${CMAKE_CURRENT_LIST_DIR}/brush.cpp
   ${CMAKE_CURRENT_LIST_DIR}/color.cpp
   ${CMAKE_CURRENT_LIST_DIR}/primitive.cpp
+  ${CMAKE_CURRENT_LIST_DIR}/stroke.cpp
+  ${CMAKE_CURRENT_LIST_DIR}/tilemap.cpp
+  ${CMAKE_CURRENT_LIST_DIR}/particles.cpp
+  ${CMAKE_CURRENT_LIST_DIR}/spatial_hash.cpp
+  ${CMAKE_CURRENT_LIST_DIR}/text_layout.cpp
+  ${CMAKE_CURRENT_LIST_DIR}/sdf_font.cpp
+  ${CMAKE_CURRENT_LIST_DIR}/label.cpp
+  ${CMAKE_CURRENT_LIST_DIR}/working_buffer.cpp
+  ${CMAKE_CURRENT_LIST_DIR}/sram_pool.cpp
+  ${CMAKE_CURRENT_LIST_DIR}/profile.cpp
   ${CMAKE_CURRENT_LIST_DIR}/algorithms/geometry.cpp
   ${CMAKE_CURRENT_LIST_DIR}/algorithms/dda.cpp
+  ${CMAKE_CURRENT_LIST_DIR}/algorithms/raycast.cpp
   ${CMAKE_CURRENT_LIST_DIR}/brushes/pattern.cpp
   ${CMAKE_CURRENT_LIST_DIR}/brushes/color.cpp
   ${CMAKE_CURRENT_LIST_DIR}/brushes/image.cpp
+  ${CMAKE_CURRENT_LIST_DIR}/brushes/gradient.cpp
   ${CMAKE_CURRENT_LIST_DIR}/filters/blur.cpp
   ${CMAKE_CURRENT_LIST_DIR}/filters/dither.cpp
   ${CMAKE_CURRENT_LIST_DIR}/filters/monochrome.cpp
   ${CMAKE_CURRENT_LIST_DIR}/filters/onebit.cpp
+  ${CMAKE_CURRENT_LIST_DIR}/filters/quantise.cpp
+  ${CMAKE_CURRENT_LIST_DIR}/filters/filter.cpp
+  ${CMAKE_CURRENT_LIST_DIR}/filters/shadow.cpp
   ${CMAKE_CURRENT_LIST_DIR}/micropython/brush.cpp
   ${CMAKE_CURRENT_LIST_DIR}/micropython/color.cpp
   ${CMAKE_CURRENT_LIST_DIR}/micropython/font.cpp
   ${CMAKE_CURRENT_LIST_DIR}/micropython/image_png.cpp
+  ${CMAKE_CURRENT_LIST_DIR}/micropython/image_pvi.cpp
+  ${CMAKE_CURRENT_LIST_DIR}/micropython/image_async.cpp
   ${CMAKE_CURRENT_LIST_DIR}/micropython/image.cpp
   ${CMAKE_CURRENT_LIST_DIR}/micropython/input.cpp
   ${CMAKE_CURRENT_LIST_DIR}/micropython/mat3.cpp
@@ -34,6 +53,12 @@ list(APPEND SOURCES
   ${CMAKE_CURRENT_LIST_DIR}/micropython/rect.cpp
   ${CMAKE_CURRENT_LIST_DIR}/micropython/vec2.cpp
   ${CMAKE_CURRENT_LIST_DIR}/micropython/algorithm.cpp
+  ${CMAKE_CURRENT_LIST_DIR}/micropython/tilemap.cpp
+  ${CMAKE_CURRENT_LIST_DIR}/micropython/particles.cpp
+  ${CMAKE_CURRENT_LIST_DIR}/micropython/spatial_hash.cpp
+  ${CMAKE_CURRENT_LIST_DIR}/micropython/text.cpp
+  ${CMAKE_CURRENT_LIST_DIR}/micropython/sdf_font.cpp
+  ${CMAKE_CURRENT_LIST_DIR}/micropython/label.cpp
 )
 
 target_sources(usermod_picovector INTERFACE
@@ -46,7 +71,11 @@ target_include_directories(usermod_picovector INTERFACE
 
 target_compile_definitions(usermod_picovector INTERFACE PICO=1)
 
-target_link_libraries(usermod INTERFACE usermod_picovector pngdec hardware_interp)
+target_link_libraries(usermod INTERFACE usermod_picovector pngdec hardware_interp hardware_dma)
+
+# every gc collection goes through __wrap_gc_collect() to be counted, see
+# picovector.alloc_stats()
+target_link_options(usermod INTERFACE "-Wl,--wrap=gc_collect")
 
 set_source_files_properties(
   ${SOURCES}
@@ -79,9 +79,51 @@ extern "C" {
     return mp_obj_new_tuple(rays, result);
   })
 
+  // raycast(target, textures, tex_size, map, map_width, pos, angle, fov,
+  // shade_distance=0, depth=None) renders the whole view into the target's
+  // clip in one call, see raycast() for the details. depth is an array('f')
+  // with an entry per column that receives the distance to each wall
+  MPY_BIND_STATICMETHOD_VAR(8, raycast, {
+    if(!mp_obj_is_type(args[0], &type_image) || !mp_obj_is_type(args[1], &type_image)) {
+      mp_raise_msg_varg(&mp_type_TypeError, MP_ERROR_TEXT("invalid parameters, expected raycast(target, textures, tex_size, map, map_width, pos, angle, fov, shade_distance=0, depth=None)"));
+    }
+    const image_obj_t *target = (image_obj_t *)MP_OBJ_TO_PTR(args[0]);
+    const image_obj_t *textures = (image_obj_t *)MP_OBJ_TO_PTR(args[1]);
+    int tex_size = mp_obj_get_int(args[2]);
+
+    mp_buffer_info_t map;
+    mp_get_buffer_raise(args[3], &map, MP_BUFFER_READ);
+    int map_w = mp_obj_get_int(args[4]);
+    if(map_w <= 0 || tex_size <= 0) {
+      mp_raise_msg_varg(&mp_type_ValueError, MP_ERROR_TEXT("map width and texture size must be positive"));
+    }
+    int map_h = map.len / map_w;
+
+    vec2_t pos = mp_obj_get_vec2(args[5]);
+    float angle = mp_obj_get_float(args[6]);
+    float fov = mp_obj_get_float(args[7]);
+    float shade_distance = n_args > 8 ? mp_obj_get_float(args[8]) : 0.0f;
+
+    float *depth = nullptr;
+    if(n_args > 9 && args[9] != mp_const_none) {
+      mp_buffer_info_t info;
+      mp_get_buffer_raise(args[9], &info, MP_BUFFER_WRITE);
+      if(info.typecode != 'f' || info.len / sizeof(float) < size_t(target->image->clip().w)) {
+        mp_raise_msg_varg(&mp_type_ValueError, MP_ERROR_TEXT("depth must be an array('f') with an entry per column"));
+      }
+      depth = (float *)info.buf;
+    }
+
+    image_sync(textures);
+    image_sync(target);
+    raycast(target->image, textures->image, tex_size, (const uint8_t *)map.buf, map_w, map_h, pos, angle, fov, shade_distance, depth);
+    return mp_const_none;
+  })
+
   MPY_BIND_LOCALS_DICT(algorithm,
     MPY_BIND_ROM_PTR_STATIC(clip_line),
     MPY_BIND_ROM_PTR_STATIC(dda),
+    MPY_BIND_ROM_PTR_STATIC(raycast),
   )
 
 
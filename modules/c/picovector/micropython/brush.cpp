@@ -29,7 +29,24 @@ extern "C" {
   // })
 
 
+  // brush.solid(color), a solid brush that can be repainted in place with
+  // brush.color = color. the pens colours hand out are shared by everything
+  // using that colour so they can't be
+  MPY_BIND_STATICMETHOD_VAR(1, solid, {
+    PV_ALLOC_SCOPE(PV_ALLOC_BRUSH);
+    if(!mp_obj_is_type(args[0], &type_color)) {
+      mp_raise_msg_varg(&mp_type_TypeError, MP_ERROR_TEXT("invalid parameter, expected brush.solid(color)"));
+    }
+
+    const color_obj_t *color = (color_obj_t *)MP_OBJ_TO_PTR(args[0]);
+    brush_obj_t *brush = mp_obj_malloc(brush_obj_t, &type_brush);
+    brush->brush = m_new_class(color_brush_t, *color->c);
+    brush->color = args[0];
+    return MP_OBJ_FROM_PTR(brush);
+  })
+
   MPY_BIND_STATICMETHOD_VAR(3, pattern, {
+    PV_ALLOC_SCOPE(PV_ALLOC_BRUSH);
     if(!mp_obj_is_type(args[0], &type_color) ||
        !mp_obj_is_type(args[1], &type_color)) {
       mp_raise_msg_varg(&mp_type_TypeError, MP_ERROR_TEXT("invalid parameter, expected brush.pattern(color, color, index | tuple[8], [on=image])"));
@@ -39,6 +56,7 @@ extern "C" {
     const color_obj_t *c2 = (color_obj_t *)MP_OBJ_TO_PTR(args[1]);
 
     brush_obj_t *brush = mp_obj_malloc(brush_obj_t, &type_brush);
+    brush->color = MP_OBJ_NULL;
     if(mp_obj_is_int(args[2])) { // brush index supplied, use pre-baked brush
       int pattern_index = mp_obj_get_int(args[2]);
       if(pattern_index < 0 || pattern_index > 37) {
@@ -66,32 +84,159 @@ extern "C" {
   })
 
 
+  static wrap_t mp_obj_get_wrap(mp_obj_t wrap_in) {
+    int w = mp_obj_get_int(wrap_in);
+    if(w < WRAP_REPEAT || w > WRAP_NONE) {
+      mp_raise_msg_varg(&mp_type_ValueError, MP_ERROR_TEXT("wrap must be REPEAT, CLAMP, MIRROR or NONE"));
+    }
+    return wrap_t(w);
+  }
+
+  // brush.image(image, [mat3], [wrap]) where wrap is one of brush.REPEAT,
+  // brush.CLAMP, brush.MIRROR or brush.NONE
   MPY_BIND_STATICMETHOD_VAR(1, image, {
+    PV_ALLOC_SCOPE(PV_ALLOC_BRUSH);
     if(!mp_obj_is_type(args[0], &type_image) ||
-       (n_args >= 1 && !mp_obj_is_type(args[1], &type_mat3))) {
-      mp_raise_msg_varg(&mp_type_TypeError, MP_ERROR_TEXT("invalid parameter, expected brush.image(image, [mat3], [on=image])"));
+       (n_args >= 2 && args[1] != mp_const_none && !mp_obj_is_type(args[1], &type_mat3))) {
+      mp_raise_msg_varg(&mp_type_TypeError, MP_ERROR_TEXT("invalid parameter, expected brush.image(image, [mat3], [wrap], [on=image])"));
     }
     brush_obj_t *brush = mp_obj_malloc(brush_obj_t, &type_brush);
+    brush->color = MP_OBJ_NULL;
     const image_obj_t *src = (image_obj_t *)MP_OBJ_TO_PTR(args[0]);
 
-    if(n_args == 1) {
-      brush->brush = m_new_class(image_brush_t, src->image);
+    wrap_t wrap = n_args >= 3 ? mp_obj_get_wrap(args[2]) : WRAP_REPEAT;
+
+    if(n_args == 1 || args[1] == mp_const_none) {
+      brush->brush = m_new_class(image_brush_t, src->image, nullptr, wrap);
     } else {
       mat3_obj_t *transform = (mat3_obj_t *)MP_OBJ_TO_PTR(args[1]);
       mat3_t *m = &transform->m;
-      brush->brush = m_new_class(image_brush_t, src->image, m);
+      brush->brush = m_new_class(image_brush_t, src->image, m, wrap);
+    }
+
+    return MP_OBJ_FROM_PTR(brush);
+  })
+
+
+  // gradient stops are a list or tuple of colours spaced evenly from 0 to
+  // 1, or of (t, color) pairs in increasing order of t
+  const int max_gradient_stops = 16;
+
+  static int mp_obj_get_gradient_stops(mp_obj_t stops_in, gradient_stop_t *stops) {
+    size_t len;
+    mp_obj_t *items;
+    mp_obj_get_array(stops_in, &len, &items);
+    if(len < 1 || len > max_gradient_stops) {
+      mp_raise_msg_varg(&mp_type_ValueError, MP_ERROR_TEXT("gradient needs between 1 and %d stops"), max_gradient_stops);
+    }
+
+    for(size_t i = 0; i < len; i++) {
+      mp_obj_t c = items[i];
+      float t = len > 1 ? float(i) / float(len - 1) : 0.0f;
+      if(mp_obj_is_type(c, &mp_type_tuple)) {
+        size_t pair_len;
+        mp_obj_t *pair;
+        mp_obj_get_array(c, &pair_len, &pair);
+        if(pair_len != 2) {
+          mp_raise_TypeError(MP_ERROR_TEXT("invalid parameter, gradient stop must be (t, color)"));
+        }
+        t = mp_obj_get_float(pair[0]);
+        c = pair[1];
+        if(i > 0 && t < stops[i - 1].t) {
+          mp_raise_msg_varg(&mp_type_ValueError, MP_ERROR_TEXT("gradient stops must be in order"));
+        }
+      }
+      if(!mp_obj_is_type(c, &type_color)) {
+        mp_raise_TypeError(MP_ERROR_TEXT("invalid parameter, gradient stop must be a color"));
+      }
+      stops[i].t = t;
+      stops[i].c = ((color_obj_t *)MP_OBJ_TO_PTR(c))->c->_p;
     }
+    return len;
+  }
+
+  // brush.linear_gradient(vec2, vec2, stops, [wrap]), wrap defaults to
+  // brush.CLAMP
+  MPY_BIND_STATICMETHOD_VAR(3, linear_gradient, {
+    PV_ALLOC_SCOPE(PV_ALLOC_BRUSH);
+    if(!mp_obj_is_type(args[0], &type_vec2) || !mp_obj_is_type(args[1], &type_vec2)) {
+      mp_raise_msg_varg(&mp_type_TypeError, MP_ERROR_TEXT("invalid parameter, expected brush.linear_gradient(vec2, vec2, stops, [wrap])"));
+    }
+    gradient_stop_t stops[max_gradient_stops];
+    int count = mp_obj_get_gradient_stops(args[2], stops);
+    wrap_t wrap = n_args >= 4 ? mp_obj_get_wrap(args[3]) : WRAP_CLAMP;
 
+    brush_obj_t *brush = mp_obj_malloc(brush_obj_t, &type_brush);
+    brush->color = MP_OBJ_NULL;
+    brush->brush = m_new_class(linear_gradient_brush_t, mp_obj_get_vec2(args[0]), mp_obj_get_vec2(args[1]), stops, count, wrap);
     return MP_OBJ_FROM_PTR(brush);
   })
 
+  // brush.radial_gradient(vec2, radius, stops, [wrap]), wrap defaults to
+  // brush.CLAMP
+  MPY_BIND_STATICMETHOD_VAR(3, radial_gradient, {
+    PV_ALLOC_SCOPE(PV_ALLOC_BRUSH);
+    if(!mp_obj_is_type(args[0], &type_vec2)) {
+      mp_raise_msg_varg(&mp_type_TypeError, MP_ERROR_TEXT("invalid parameter, expected brush.radial_gradient(vec2, radius, stops, [wrap])"));
+    }
+    gradient_stop_t stops[max_gradient_stops];
+    int count = mp_obj_get_gradient_stops(args[2], stops);
+    wrap_t wrap = n_args >= 4 ? mp_obj_get_wrap(args[3]) : WRAP_CLAMP;
+
+    brush_obj_t *brush = mp_obj_malloc(brush_obj_t, &type_brush);
+    brush->color = MP_OBJ_NULL;
+    brush->brush = m_new_class(radial_gradient_brush_t, mp_obj_get_vec2(args[0]), mp_obj_get_float(args[1]), stops, count, wrap);
+    return MP_OBJ_FROM_PTR(brush);
+  })
+
+
+  static void brush_attr(mp_obj_t self_in, qstr attr, mp_obj_t *dest) {
+    self(self_in, brush_obj_t);
+
+    action_t action = m_attr_action(dest);
+
+    switch(attr) {
+      case MP_QSTR_color: {
+        if(action == GET) {
+          dest[0] = self->color ? self->color : mp_const_none;
+          return;
+        }
+
+        if(action == SET) {
+          if(!mp_obj_is_type(dest[1], &type_color)) {
+            mp_raise_TypeError(MP_ERROR_TEXT("expected color"));
+          }
+          // deferred images paint with whatever colour the brush has when
+          // they're flushed, the same as they read shapes
+          if(!self->color || ((color_obj_t *)MP_OBJ_TO_PTR(self->color))->brush == self) {
+            mp_raise_TypeError(MP_ERROR_TEXT("only brushes made with brush.solid() can change color"));
+          }
+          const color_obj_t *color = (color_obj_t *)MP_OBJ_TO_PTR(dest[1]);
+          ((color_brush_t *)self->brush)->c = *color->c;
+          self->color = dest[1];
+          dest[0] = MP_OBJ_NULL;
+          return;
+        }
+      };
+    }
+
+    dest[1] = MP_OBJ_SENTINEL;
+  }
 
   MPY_BIND_LOCALS_DICT(brush,
     //MPY_BIND_ROM_PTR_DEL(brush),
     // MPY_BIND_ROM_PTR_STATIC(xor),
     // MPY_BIND_ROM_PTR_STATIC(brighten),
+    MPY_BIND_ROM_PTR_STATIC(solid),
     MPY_BIND_ROM_PTR_STATIC(pattern),
     MPY_BIND_ROM_PTR_STATIC(image),
+    MPY_BIND_ROM_PTR_STATIC(linear_gradient),
+    MPY_BIND_ROM_PTR_STATIC(radial_gradient),
+
+    { MP_ROM_QSTR(MP_QSTR_REPEAT), MP_ROM_INT(WRAP_REPEAT)},
+    { MP_ROM_QSTR(MP_QSTR_CLAMP), MP_ROM_INT(WRAP_CLAMP)},
+    { MP_ROM_QSTR(MP_QSTR_MIRROR), MP_ROM_INT(WRAP_MIRROR)},
+    { MP_ROM_QSTR(MP_QSTR_NONE), MP_ROM_INT(WRAP_NONE)},
   )
 
 
@@ -99,6 +244,7 @@ extern "C" {
       type_brush,
       MP_QSTR_brush,
       MP_TYPE_FLAG_NONE,
+      attr, (const void *)brush_attr,
       locals_dict, &brush_locals_dict
   );
 
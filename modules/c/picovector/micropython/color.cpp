@@ -8,35 +8,68 @@ extern "C" {
 
   #include "py/runtime.h"
 
-  MPY_BIND_STATICMETHOD_VAR(3, rgb, {
-    int r = (int)mp_obj_get_float(args[0]);
-    int g = (int)mp_obj_get_float(args[1]);
-    int b = (int)mp_obj_get_float(args[2]);
-    int a = n_args > 3 ? (int)mp_obj_get_float(args[3]) : 255;
+  // colours never change once made so the same object can be handed out
+  // again for the same values. recent colours are kept in a small direct
+  // mapped cache, making one that's still in it doesn't allocate and nor
+  // does using it as a pen again (its brush is kept, see mp_obj_to_brush())
+  color_obj_t *mp_color_get(color_kind_t kind, uint32_t key) {
+    mp_obj_t *cache = MP_STATE_VM(picovector_color_cache);
+    static_assert(sizeof(MP_STATE_VM(picovector_color_cache)) == 64 * sizeof(mp_obj_t));
+    size_t slot = ((key ^ (kind * 0x9e3779b9u)) * 2654435761u) >> 26;
+
+    if(cache[slot] != MP_OBJ_NULL) {
+      color_obj_t *color = (color_obj_t *)MP_OBJ_TO_PTR(cache[slot]);
+      if(color->kind == kind && color->key == key) {
+        return color;
+      }
+    }
+
+    PV_ALLOC_SCOPE(PV_ALLOC_COLOR);
+    uint8_t x = key >> 24, y = key >> 16, z = key >> 8, a = key;
     color_obj_t *color = mp_obj_malloc(color_obj_t, &type_color);
-    color->c = new rgb_color_t(r, g, b, a);
-    return MP_OBJ_FROM_PTR(color);
+    color->brush = nullptr;
+    color->kind = kind;
+    color->key = key;
+    switch(kind) {
+      case COLOR_HSV:
+        color->c = m_new_class(hsv_color_t, x, y, z, a);
+        break;
+      case COLOR_OKLCH:
+        color->c = m_new_class(oklch_color_t, x, y, z, a);
+        break;
+      case COLOR_PREMUL:
+        color->c = m_new_class(color_t);
+        color->c->_p = key;
+        break;
+      default:
+        color->c = m_new_class(rgb_color_t, x, y, z, a);
+        break;
+    }
+    cache[slot] = MP_OBJ_FROM_PTR(color);
+    return color;
+  }
+
+  static uint32_t pack_color_args(size_t n_args, const mp_obj_t *args) {
+    uint8_t x = (int)mp_obj_get_float(args[0]);
+    uint8_t y = (int)mp_obj_get_float(args[1]);
+    uint8_t z = (int)mp_obj_get_float(args[2]);
+    uint8_t a = n_args > 3 ? (int)mp_obj_get_float(args[3]) : 255;
+    return (uint32_t(x) << 24) | (y << 16) | (z << 8) | a;
+  }
+
+  MPY_BIND_STATICMETHOD_VAR(3, rgb, {
+    return MP_OBJ_FROM_PTR(mp_color_get(COLOR_RGB, pack_color_args(n_args, args)));
   })
 
   MPY_BIND_STATICMETHOD_VAR(3, hsv, {
     int h = (int)mp_obj_get_float(args[0]);
     h = fmod(h, 360.0f);
-    int s = (int)mp_obj_get_float(args[1]);
-    int v = (int)mp_obj_get_float(args[2]);
-    int a = n_args > 3 ? (int)mp_obj_get_float(args[3]) : 255;
-    color_obj_t *color = mp_obj_malloc(color_obj_t, &type_color);
-    color->c = new hsv_color_t(h, s, v, a);
-    return MP_OBJ_FROM_PTR(color);
+    uint32_t key = (pack_color_args(n_args, args) & 0x00ffffff) | (uint32_t(uint8_t(h)) << 24);
+    return MP_OBJ_FROM_PTR(mp_color_get(COLOR_HSV, key));
   })
 
   MPY_BIND_STATICMETHOD_VAR(3, oklch, {
-    int l = (int)mp_obj_get_float(args[0]);
-    int c = (int)mp_obj_get_float(args[1]);
-    int h = (int)mp_obj_get_float(args[2]);
-    int a = n_args > 3 ? (int)mp_obj_get_float(args[3]) : 255;
-    color_obj_t *color = mp_obj_malloc(color_obj_t, &type_color);
-    color->c = new oklch_color_t(l, c, h, a);
-    return MP_OBJ_FROM_PTR(color);
+    return MP_OBJ_FROM_PTR(mp_color_get(COLOR_OKLCH, pack_color_args(n_args, args)));
   })
 
   MPY_BIND_VAR(2, blend, {
@@ -44,6 +77,8 @@ extern "C" {
     const color_obj_t *other = (color_obj_t *)MP_OBJ_TO_PTR(args[1]);
     uint8_t *src = (uint8_t*)&other->c;
     color_obj_t *result = mp_obj_malloc(color_obj_t, &type_color);
+    result->brush = nullptr;
+    result->kind = COLOR_OTHER;
     result->c = self->c;
     // blend_func_over(uint32_t dst, uint32_t r, uint32_t g, uint32_t b, uint32_t a)
 
@@ -59,6 +94,8 @@ extern "C" {
     const color_obj_t *self = (color_obj_t *)MP_OBJ_TO_PTR(args[0]);
     int v = 255 - (int)mp_obj_get_float(args[1]);
     color_obj_t *result = mp_obj_malloc(color_obj_t, &type_color);
+    result->brush = nullptr;
+    result->kind = COLOR_OTHER;
     result->c = self->c;
     // set_r(&result->c, darken_u8(get_r(&self->c), v));
     // set_g(&result->c, darken_u8(get_g(&self->c), v));
@@ -77,6 +114,8 @@ extern "C" {
     const color_obj_t *self = (color_obj_t *)MP_OBJ_TO_PTR(args[0]);
     int v = 256 + (int)mp_obj_get_float(args[1]);
     color_obj_t *result = mp_obj_malloc(color_obj_t, &type_color);
+    result->brush = nullptr;
+    result->kind = COLOR_OTHER;
     result->c = self->c;
     // set_r(&result->c, lighten_u8(get_r(&self->c), v));
     // set_g(&result->c, lighten_u8(get_g(&self->c), v));
@@ -162,31 +201,59 @@ extern "C" {
   rgb_color_t _color_white  = rgb_color_t(0xde, 0xee, 0xd6, 0xff);
   rgb_color_t _color_transparent  = rgb_color_t(0x00, 0x00, 0x00, 0x00);
 
+  // the palette's pens are made up front so setting one as the pen never
+  // allocates, see mp_obj_to_brush()
+  #define PALETTE_BRUSH(name) \
+    extern const color_obj_t color_##name##_obj; \
+    color_brush_t _brush_##name = color_brush_t(_color_##name); \
+    brush_obj_t color_##name##_brush = {.base = {.type = &type_brush}, .brush = &_brush_##name, .color = (mp_obj_t)&color_##name##_obj};
+
+  PALETTE_BRUSH(black)
+  PALETTE_BRUSH(grape)
+  PALETTE_BRUSH(navy)
+  PALETTE_BRUSH(grey)
+  PALETTE_BRUSH(brown)
+  PALETTE_BRUSH(green)
+  PALETTE_BRUSH(red)
+  PALETTE_BRUSH(taupe)
+  PALETTE_BRUSH(blue)
+  PALETTE_BRUSH(orange)
+  PALETTE_BRUSH(smoke)
+  PALETTE_BRUSH(lime)
+  PALETTE_BRUSH(latte)
+  PALETTE_BRUSH(cyan)
+  PALETTE_BRUSH(yellow)
+  PALETTE_BRUSH(white)
+  PALETTE_BRUSH(transparent)
+
   // default palette based on Dawnbringer 16
-  const color_obj_t color_black_obj  = {.base = {.type = &type_color}, .c = &_color_black};
-  const color_obj_t color_grape_obj  = {.base = {.type = &type_color}, .c = &_color_grape};
-  const color_obj_t color_navy_obj   = {.base = {.type = &type_color}, .c = &_color_navy};
-  const color_obj_t color_grey_obj   = {.base = {.type = &type_color}, .c = &_color_grey};
-  const color_obj_t color_brown_obj  = {.base = {.type = &type_color}, .c = &_color_brown};
-  const color_obj_t color_green_obj  = {.base = {.type = &type_color}, .c = &_color_green};
-  const color_obj_t color_red_obj    = {.base = {.type = &type_color}, .c = &_color_red};
-  const color_obj_t color_taupe_obj  = {.base = {.type = &type_color}, .c = &_color_taupe};
-  const color_obj_t color_blue_obj   = {.base = {.type = &type_color}, .c = &_color_blue};
-  const color_obj_t color_orange_obj = {.base = {.type = &type_color}, .c = &_color_orange};
-  const color_obj_t color_smoke_obj  = {.base = {.type = &type_color}, .c = &_color_smoke};
-  const color_obj_t color_lime_obj   = {.base = {.type = &type_color}, .c = &_color_lime};
-  const color_obj_t color_latte_obj  = {.base = {.type = &type_color}, .c = &_color_latte};
-  const color_obj_t color_cyan_obj   = {.base = {.type = &type_color}, .c = &_color_cyan};
-  const color_obj_t color_yellow_obj = {.base = {.type = &type_color}, .c = &_color_yellow};
-  const color_obj_t color_white_obj  = {.base = {.type = &type_color}, .c = &_color_white};
-  const color_obj_t color_transparent_obj  = {.base = {.type = &type_color}, .c = &_color_transparent};
+  const color_obj_t color_black_obj  = {.base = {.type = &type_color}, .c = &_color_black, .brush = &color_black_brush};
+  const color_obj_t color_grape_obj  = {.base = {.type = &type_color}, .c = &_color_grape, .brush = &color_grape_brush};
+  const color_obj_t color_navy_obj   = {.base = {.type = &type_color}, .c = &_color_navy, .brush = &color_navy_brush};
+  const color_obj_t color_grey_obj   = {.base = {.type = &type_color}, .c = &_color_grey, .brush = &color_grey_brush};
+  const color_obj_t color_brown_obj  = {.base = {.type = &type_color}, .c = &_color_brown, .brush = &color_brown_brush};
+  const color_obj_t color_green_obj  = {.base = {.type = &type_color}, .c = &_color_green, .brush = &color_green_brush};
+  const color_obj_t color_red_obj    = {.base = {.type = &type_color}, .c = &_color_red, .brush = &color_red_brush};
+  const color_obj_t color_taupe_obj  = {.base = {.type = &type_color}, .c = &_color_taupe, .brush = &color_taupe_brush};
+  const color_obj_t color_blue_obj   = {.base = {.type = &type_color}, .c = &_color_blue, .brush = &color_blue_brush};
+  const color_obj_t color_orange_obj = {.base = {.type = &type_color}, .c = &_color_orange, .brush = &color_orange_brush};
+  const color_obj_t color_smoke_obj  = {.base = {.type = &type_color}, .c = &_color_smoke, .brush = &color_smoke_brush};
+  const color_obj_t color_lime_obj   = {.base = {.type = &type_color}, .c = &_color_lime, .brush = &color_lime_brush};
+  const color_obj_t color_latte_obj  = {.base = {.type = &type_color}, .c = &_color_latte, .brush = &color_latte_brush};
+  const color_obj_t color_cyan_obj   = {.base = {.type = &type_color}, .c = &_color_cyan, .brush = &color_cyan_brush};
+  const color_obj_t color_yellow_obj = {.base = {.type = &type_color}, .c = &_color_yellow, .brush = &color_yellow_brush};
+  const color_obj_t color_white_obj  = {.base = {.type = &type_color}, .c = &_color_white, .brush = &color_white_brush};
+  const color_obj_t color_transparent_obj  = {.base = {.type = &type_color}, .c = &_color_transparent, .brush = &color_transparent_brush};
 
   // badger E-ink specific greys
   rgb_color_t _color_light_grey = rgb_color_t(0xc0, 0xc0, 0xc0, 0xff);
   rgb_color_t _color_dark_grey  = rgb_color_t(0x40, 0x40, 0x40, 0xff);
 
-  const color_obj_t color_light_grey_obj  = {.base = {.type = &type_color}, .c = &_color_light_grey};
-  const color_obj_t color_dark_grey_obj   = {.base = {.type = &type_color}, .c = &_color_dark_grey};
+  PALETTE_BRUSH(light_grey)
+  PALETTE_BRUSH(dark_grey)
+
+  const color_obj_t color_light_grey_obj  = {.base = {.type = &type_color}, .c = &_color_light_grey, .brush = &color_light_grey_brush};
+  const color_obj_t color_dark_grey_obj   = {.base = {.type = &type_color}, .c = &_color_dark_grey, .brush = &color_dark_grey_brush};
 
   MPY_BIND_LOCALS_DICT(color,
     // static color generators
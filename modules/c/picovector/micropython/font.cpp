@@ -10,15 +10,22 @@ extern "C" {
 
   MPY_BIND_DEL(font, {
     self(self_in, font_obj_t);
+    PV_ALLOC_SCOPE(PV_ALLOC_FONT);
+    self->font.free_cache();
 #if MICROPY_MALLOC_USES_ALLOCATED_SIZE
     m_free(self->buffer, self->buffer_size);
+    m_free(self->points_buffer, self->points_buffer_size);
+    m_free(self->font.kerning_pairs, sizeof(font_kerning_t) * self->font.kerning_count);
 #else
     m_free(self->buffer);
+    m_free(self->points_buffer);
+    m_free(self->font.kerning_pairs);
 #endif
     return mp_const_none;
   })
 
   MPY_BIND_STATICMETHOD_ARGS1(load, path, {
+    PV_ALLOC_SCOPE(PV_ALLOC_FONT);
     //const char *s = mp_obj_str_get_str(path);
     font_obj_t *result = mp_obj_malloc_with_finaliser(font_obj_t, &type_font);
 
@@ -35,87 +42,154 @@ extern "C" {
     // mp_int_t size = mp_obj_get_int(tuple->items[6]);
 
     // open the file for binary reading
-    //mp_obj_t args[2] = {path, MP_ROM_QSTR(MP_QSTR_r)} // Brace enclosed initialiser lists don't work in the binding macros :(
-    mp_obj_t args[2];
-    args[0] = path;
-    args[1] = MP_ROM_QSTR(MP_QSTR_r);;
-    mp_obj_t file = mp_vfs_open(MP_ARRAY_SIZE(args), args, (mp_map_t *)&mp_const_empty_map);
-
-    int error;
+    pv_reader_t file;
+    pv_reader_open(&file, path);
 
     char marker[4];
-    mp_stream_read_exactly(file, &marker, sizeof(marker), &error);
+    pv_reader_read(&file, &marker, sizeof(marker));
 
     if(memcmp(marker, "af!?", 4) != 0) {
+      pv_reader_close(&file);
       mp_raise_msg_varg(&mp_type_OSError, MP_ERROR_TEXT("failed to load font, missing AF header"));
     }
 
-    uint16_t flags       = ru16(file);
-    uint16_t glyph_count = ru16(file);
-    uint16_t path_count  = ru16(file);
-    uint16_t point_count = ru16(file);
+    uint16_t flags       = ru16(&file);
+    uint16_t glyph_count = ru16(&file);
+    uint16_t path_count  = ru16(&file);
+    uint16_t point_count = ru16(&file);
 
     size_t glyph_buffer_size = sizeof(glyph_t) * glyph_count;
     size_t path_buffer_size = sizeof(glyph_path_t) * path_count;
     size_t point_buffer_size = sizeof(glyph_path_point_t) * point_count;
 
-    // allocate buffer to store font glyph, path, and point data
-    result->buffer_size = glyph_buffer_size + path_buffer_size + point_buffer_size;
+    // allocate buffer to store font glyph and path data, the points are
+    // used in place when the file is mapped and read into a buffer of their
+    // own otherwise
+    result->buffer_size = glyph_buffer_size + path_buffer_size;
     result->buffer = (uint8_t*)m_malloc(result->buffer_size);
-
-    if(!result->buffer) {
-      mp_raise_msg_varg(&mp_type_OSError, MP_ERROR_TEXT("couldn't allocate buffer for font data"));
-    }
+    result->points_buffer = nullptr;
+    result->points_buffer_size = 0;
 
     glyph_t *glyphs = (glyph_t*)result->buffer;
     glyph_path_t *paths = (glyph_path_t*)(result->buffer + glyph_buffer_size);
-    glyph_path_point_t *points = (glyph_path_point_t*)(result->buffer + glyph_buffer_size + path_buffer_size);
+    glyph_path_t *all_paths = paths;
 
     // load glyph dictionary
     result->font.glyph_count = glyph_count;
     result->font.glyphs      = glyphs;
     for(int i = 0; i < glyph_count; i++) {
       glyph_t *glyph = &result->font.glyphs[i];
-      glyph->codepoint  = ru16(file);
-      glyph->x          =  rs8(file);
-      glyph->y          =  rs8(file);
-      glyph->w          =  ru8(file);
-      glyph->h          =  ru8(file);
-      glyph->advance    =  ru8(file);
-      glyph->path_count =  ru8(file);
+      glyph->codepoint  = ru16(&file);
+      glyph->x          =  rs8(&file);
+      glyph->y          =  rs8(&file);
+      glyph->w          =  ru8(&file);
+      glyph->h          =  ru8(&file);
+      glyph->advance    =  ru8(&file);
+      glyph->path_count =  ru8(&file);
       glyph->paths      =      paths;
       paths += glyph->path_count;
     }
 
-    // load the glyph paths
-    for(int i = 0; i < glyph_count; i++) {
-      glyph_t *glyph = &result->font.glyphs[i];
-      for(int j = 0; j < glyph->path_count; j++) {
-        glyph_path_t *path = &glyph->paths[j];
-        path->point_count = flags & 0b1 ? ru16(file) : ru8(file);
-        path->points = points;
-        points += path->point_count;
-      }
+    if(paths - all_paths > path_count) {
+      pv_reader_close(&file);
+      mp_raise_msg_varg(&mp_type_OSError, MP_ERROR_TEXT("failed to load font, invalid glyph table"));
     }
 
-    // load the glyph points
-    for(int i = 0; i < glyph_count; i++) {
-      glyph_t *glyph = &result->font.glyphs[i];
-      for(int j = 0; j < glyph->path_count; j++) {
-        glyph_path_t *path = &glyph->paths[j];
-        for(int k = 0; k < path->point_count; k++) {
-          glyph_path_point_t *point = &path->points[k];
-          point->x = ru8(file);
-          point->y = ru8(file);
+    // load the glyph paths, the points they index are laid out in the same
+    // order straight after them
+    for(int i = 0; i < path_count; i++) {
+      all_paths[i].point_count = flags & 0b1 ? ru16(&file) : ru8(&file);
+    }
+
+    glyph_path_point_t *points = (glyph_path_point_t *)pv_reader_map(&file, point_buffer_size);
+    if(!points) {
+      result->points_buffer_size = point_buffer_size;
+      result->points_buffer = (uint8_t*)m_malloc(result->points_buffer_size);
+      pv_reader_read(&file, result->points_buffer, point_buffer_size);
+      points = (glyph_path_point_t *)result->points_buffer;
+    }
+
+    size_t used = 0;
+    for(int i = 0; i < path_count; i++) {
+      all_paths[i].points = points + used;
+      used += all_paths[i].point_count;
+    }
+    if(used > point_count) {
+      pv_reader_close(&file);
+      mp_raise_msg_varg(&mp_type_OSError, MP_ERROR_TEXT("failed to load font, invalid path table"));
+    }
+
+    // optional kerning table, present when flags has 0b10 set. a u16 count
+    // and then that many (u16 left, u16 right, s8 adjust) entries ordered
+    // by left and then right codepoint, adjust is in font units
+    result->font.kerning_pairs = nullptr;
+    result->font.kerning_count = 0;
+    if(flags & 0b10) {
+      uint16_t kerning_count = ru16(&file);
+      font_kerning_t *pairs = m_new(font_kerning_t, kerning_count);
+      result->font.kerning_pairs = pairs;
+      result->font.kerning_count = kerning_count;
+      for(int i = 0; i < kerning_count; i++) {
+        pairs[i].pair = uint32_t(ru16(&file)) << 16;
+        pairs[i].pair |= ru16(&file);
+        pairs[i].adjust = rs8(&file);
+        if(i > 0 && pairs[i].pair <= pairs[i - 1].pair) {
+          pv_reader_close(&file);
+          mp_raise_msg_varg(&mp_type_OSError, MP_ERROR_TEXT("failed to load font, kerning table out of order"));
         }
       }
     }
 
-    mp_stream_close(file);
+    pv_reader_close(&file);
+
+    // glyphs keep their paths wherever they're sorted to
+    result->font.build_index();
+    result->font.fallback = nullptr;
+    result->fallback = mp_const_none;
 
     return MP_OBJ_FROM_PTR(result);
   })
 
+  static void font_attr(mp_obj_t self_in, qstr attr, mp_obj_t *dest) {
+    self(self_in, font_obj_t);
+
+    action_t action = m_attr_action(dest);
+
+    switch(attr) {
+      // font.fallback supplies glyphs this font doesn't have
+      case MP_QSTR_fallback: {
+        if(action == GET) {
+          dest[0] = self->fallback;
+          return;
+        }
+
+        if(action == SET) {
+          font_t *fallback = nullptr;
+          if(dest[1] != mp_const_none) {
+            if(!mp_obj_is_type(dest[1], &type_font)) {
+              mp_raise_TypeError(MP_ERROR_TEXT("value must be of type font or None"));
+            }
+            fallback = &((font_obj_t *)MP_OBJ_TO_PTR(dest[1]))->font;
+            for(font_t *f = fallback; f; f = f->fallback) {
+              if(f == &self->font) {
+                mp_raise_ValueError(MP_ERROR_TEXT("fallback chain can't loop back to this font"));
+              }
+            }
+          }
+
+          self->fallback = dest[1];
+          self->font.fallback = fallback;
+          font_fallback_generation++;
+          dest[0] = MP_OBJ_NULL;
+          return;
+        }
+      };
+    }
+
+    // we didn't handle this, fall back to alternative methods
+    dest[1] = MP_OBJ_SENTINEL;
+  }
+
   static void font_print(const mp_print_t *print, mp_obj_t self_in, mp_print_kind_t kind) {
     self(self_in, font_obj_t);
 
@@ -134,6 +208,7 @@ extern "C" {
     MP_QSTR_font,
     MP_TYPE_FLAG_NONE,
     print, (const void*)font_print,
+    attr, (const void*)font_attr,
     locals_dict, &font_locals_dict
   );
 
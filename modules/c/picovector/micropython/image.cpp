@@ -1,14 +1,70 @@
 #include "mp_helpers.hpp"
 #include "picovector.hpp"
+#include "../blend.hpp"
 
 extern "C" {
 
   #include "py/stream.h"
   #include "py/reader.h"
   #include "py/runtime.h"
+  #include "py/objlist.h"
+  #include "extmod/vfs.h"
+
+  // deferred images record draw calls and replay them on flush(), anything
+  // that reads, filters, or blits from the image has to flush them first
+  void image_sync(const image_obj_t *self) {
+    if(self->display_list) {
+      self->display_list->flush(self->image);
+    }
+  }
+
+  // pngdec's state borrows the working buffer for the length of a decode,
+  // the caller hands it back with working_buffer_release() even on errors
+  static PNG *image_png_claim(int *claim) {
+    *claim = working_buffer_claim("png", sizeof(PNG));
+    if(*claim < 0) {
+      mp_raise_msg(&mp_type_MemoryError, MP_ERROR_TEXT("no room in the working buffer to decode a png"));
+    }
+    return new(working_buffer_data(*claim)) PNG();
+  }
+
+  static display_list_t::command_t *image_defer(const image_obj_t *self, display_list_t::command_type_t type, rect_t bounds) {
+    if(!self->display_list) {
+      return nullptr;
+    }
+    display_list_t::command_t &c = self->display_list->add(self->image, type, bounds);
+    c.owners[0] = (void *)self->brush;
+    c.owners[1] = self->font ? (void *)self->font : (void *)self->pixel_font;
+    return &c;
+  }
+
+  static rect_t points_bounds(const vec2_t *p, int count) {
+    vec2_t tl = p[0], br = p[0];
+    for(int i = 1; i < count; i++) {
+      tl.x = std::min(tl.x, p[i].x); tl.y = std::min(tl.y, p[i].y);
+      br.x = std::max(br.x, p[i].x); br.y = std::max(br.y, p[i].y);
+    }
+    return rect_t(tl.x - 1, tl.y - 1, br.x - tl.x + 2, br.y - tl.y + 2).round();
+  }
+
+  static void image_draw_shape(const image_obj_t *self, const shape_obj_t *shape) {
+    shape_t *s = shape->shape;
+    if(auto c = image_defer(self, display_list_t::SHAPE, display_list_t::shape_bounds(s, &s->transform))) {
+      c->shape = s;
+      c->transform = s->transform;
+      c->owners[2] = (void *)shape;
+      return;
+    }
+    self->image->draw(s);
+  }
 
   mp_obj_t image__del__(mp_obj_t self_in) {
     self(self_in, image_obj_t);
+    PV_ALLOC_SCOPE(PV_ALLOC_IMAGE);
+    if(self->display_list) {
+      m_del_class(display_list_t, self->display_list);
+      self->display_list = nullptr;
+    }
     if(self->image) {
       //self->image->delete_palette();
       m_del_class(image_t, self->image);
@@ -18,49 +74,290 @@ extern "C" {
   static MP_DEFINE_CONST_FUN_OBJ_1(image__del___obj, image__del__);
 
 MPY_BIND_NEW(image, {
+    PV_ALLOC_SCOPE(PV_ALLOC_IMAGE);
     image_obj_t *self = mp_obj_malloc_with_finaliser(image_obj_t, type);
 
     int w = mp_obj_get_int(args[0]);
     int h = mp_obj_get_int(args[1]);
 
-    if (n_args > 2) {
+    // image(w, h, buffer=None, pixel_format=RGBA8888, palette=False,
+    // memory=None), memory can also be passed by name. SRAM puts the pixels
+    // in the sram pool while there's room, PSRAM or None on the gc heap
+    memory_t memory = MEMORY_ANY;
+    mp_obj_t memory_arg = n_args > 5 ? args[5] : mp_const_none;
+    for(size_t i = 0; i < n_kw; i++) {
+      if(args[n_args + i * 2] == MP_OBJ_NEW_QSTR(MP_QSTR_memory)) {
+        memory_arg = args[n_args + i * 2 + 1];
+      }else{
+        mp_raise_TypeError(MP_ERROR_TEXT("unexpected keyword argument"));
+      }
+    }
+    if(memory_arg != mp_const_none) {
+      memory = (memory_t)mp_obj_get_int(memory_arg);
+      if(memory != MEMORY_SRAM && memory != MEMORY_PSRAM) {
+        mp_raise_msg_varg(&mp_type_ValueError, MP_ERROR_TEXT("memory must be SRAM or PSRAM"));
+      }
+    }
+
+    pixel_format_t pixel_format = RGBA8888;
+    if(n_args > 3) {
+      pixel_format = (pixel_format_t)mp_obj_get_int(args[3]);
+      if(pixel_format != RGBA8888 && pixel_format != RGB565 && pixel_format != RGBA4444 && pixel_format != A8) {
+        mp_raise_msg_varg(&mp_type_ValueError, MP_ERROR_TEXT("unsupported pixel format"));
+      }
+    }
+
+    // indexed images hold one byte per pixel into a 256 entry palette
+    bool has_palette = n_args > 4 && mp_obj_is_true(args[4]);
+    if(has_palette && pixel_format == A8) {
+      mp_raise_msg_varg(&mp_type_ValueError, MP_ERROR_TEXT("A8 images can't have a palette"));
+    }
+
+    if (n_args > 2 && args[2] != mp_const_none) {
       mp_buffer_info_t bufinfo;
       mp_get_buffer_raise(args[2], &bufinfo, MP_BUFFER_WRITE);
-      self->image = new(m_malloc(sizeof(image_t))) image_t(bufinfo.buf, w, h);
+      if(bufinfo.len < w * h * image_t::bytes_per_pixel(pixel_format, has_palette)) {
+        mp_raise_msg_varg(&mp_type_ValueError, MP_ERROR_TEXT("buffer too small for image"));
+      }
+      self->image = new(m_malloc(sizeof(image_t))) image_t(bufinfo.buf, w, h, pixel_format, has_palette);
     } else {
-      self->image = new(m_malloc(sizeof(image_t))) image_t(w, h);
+      self->image = new(m_malloc(sizeof(image_t))) image_t(w, h, pixel_format, has_palette, memory);
     }
 
     return MP_OBJ_FROM_PTR(self);
 })
 
-MPY_BIND_STATICMETHOD_ARGS1(load, path, {
-    const char *s = mp_obj_str_get_str(path);
+  static pixel_format_t mp_obj_get_load_format(size_t n_args, const mp_obj_t *args) {
+    pixel_format_t pixel_format = RGBA8888;
+    if(n_args > 1) {
+      pixel_format = (pixel_format_t)mp_obj_get_int(args[1]);
+      if(pixel_format != RGBA8888 && pixel_format != RGB565 && pixel_format != RGBA4444 && pixel_format != A8) {
+        mp_raise_msg_varg(&mp_type_ValueError, MP_ERROR_TEXT("unsupported pixel format"));
+      }
+    }
+    return pixel_format;
+  }
+
+  // load scales are 1, 1/2, 1/4 or 1/8, returned as a shift
+  static int mp_obj_get_load_scale(size_t n_args, const mp_obj_t *args) {
+    if(n_args < 4) {
+      return 0;
+    }
+    float scale = mp_obj_get_float(args[3]);
+    for(int shift = 0; shift <= 3; shift++) {
+      if(scale == 1.0f / float(1 << shift)) {
+        return shift;
+      }
+    }
+    mp_raise_msg_varg(&mp_type_ValueError, MP_ERROR_TEXT("scale must be 1, 1/2, 1/4 or 1/8"));
+  }
+
+  static image_obj_t *image_load(mp_obj_t path, pixel_format_t pixel_format, int shift) {
+    PV_ALLOC_SCOPE(PV_ALLOC_IMAGE);
     image_obj_t *result = mp_obj_malloc_with_finaliser(image_obj_t, &type_image);
 
-    PNG *png = new(PicoVector_working_buffer) PNG();
-    int status = png->open(mp_obj_str_get_str(path), pngdec_open_callback, pngdec_close_callback, pngdec_read_callback, pngdec_seek_callback, pngdec_decode_callback);
-    bool has_palette = png->getPixelType() == PNG_PIXEL_INDEXED;
-    result->image = new(m_malloc(sizeof(image_t))) image_t(png->getWidth(), png->getHeight(), RGBA8888, has_palette);
-    png->decode((void *)result->image, 0);
-    png->close();
+    // pre-decoded images come in whatever format they were converted to
+    size_t len;
+    const char *name = mp_obj_str_get_data(path, &len);
+    if(len > 4 && strcmp(name + len - 4, ".pvi") == 0) {
+      if(shift) {
+        mp_raise_msg_varg(&mp_type_ValueError, MP_ERROR_TEXT("pvi images can't be scaled"));
+      }
+      result->image = pvi_load(path);
+      return result;
+    }
+
+    int claim;
+    PNG *png = image_png_claim(&claim);
+    nlr_buf_t nlr;
+    if(nlr_push(&nlr) == 0) {
+      int status = pngdec_open(png, path);
+      // averaged pixels aren't palette entries, scaled indexed pngs lose theirs
+      bool has_palette = png->getPixelType() == PNG_PIXEL_INDEXED && pixel_format != A8 && !shift;
+      int f = 1 << shift;
+      int w = (png->getWidth() + f - 1) >> shift;
+      int h = (png->getHeight() + f - 1) >> shift;
+      result->image = new(m_malloc(sizeof(image_t))) image_t(w, h, has_palette ? RGBA8888 : pixel_format, has_palette);
+      png_target_t target = {result->image, 0, 0, false, shift};
+      if(shift) {
+        // only one row of box sums is kept, never the full size image
+        target.acc = m_new0(uint16_t, w * 4);
+      }
+      pngdec_decode(png, &target);
+      if(target.acc) {
+        m_del(uint16_t, target.acc, w * 4);
+      }
+      // truecolour and grayscale without a transparent colour can only be
+      // opaque, anything else is looked at now while it's fresh from the decoder
+      bool opaque = !png->hasAlpha() && (png->getPixelType() == PNG_PIXEL_TRUECOLOR || png->getPixelType() == PNG_PIXEL_GRAYSCALE);
+      result->image->transparency(opaque ? OPAQUE : TRANSPARENCY_UNKNOWN);
+      result->image->transparency();
+      png->close();
+      nlr_pop();
+    }else{
+      working_buffer_release(claim);
+      nlr_jump(nlr.ret_val);
+    }
+    working_buffer_release(claim);
+    return result;
+  }
+
+  /*
+    decoded image cache. entries are (path, mtime, format, image) tuples,
+    format being the pixel format with the load's scale shift in bits 8 and
+    up, in a list held as a root pointer, least recently used first, so
+    they live on the gc heap (psram) until evicted. a hit hands back the
+    same image object every time, which callers must treat as read only.
+    evicting only drops the cache's reference, images still in use are
+    freed by the gc once the app lets go of them
+  */
+  static size_t image_cache_budget = 256 * 1024;
+  static size_t image_cache_used = 0;
+
+  static size_t image_cache_size(mp_obj_t entry) {
+    mp_obj_tuple_t *t = (mp_obj_tuple_t *)MP_OBJ_TO_PTR(entry);
+    image_t *image = ((image_obj_t *)MP_OBJ_TO_PTR(t->items[3]))->image;
+    return image->buffer_size() + (image->has_palette() ? 256 * sizeof(uint32_t) : 0);
+  }
+
+  static mp_obj_list_t *image_cache() {
+    if(MP_STATE_VM(picovector_image_cache) == MP_OBJ_NULL) {
+      MP_STATE_VM(picovector_image_cache) = mp_obj_new_list(0, nullptr);
+      image_cache_used = 0;
+    }
+    return (mp_obj_list_t *)MP_OBJ_TO_PTR(MP_STATE_VM(picovector_image_cache));
+  }
+
+  static void image_cache_remove(mp_obj_list_t *cache, size_t i) {
+    image_cache_used -= image_cache_size(cache->items[i]);
+    memmove(&cache->items[i], &cache->items[i + 1], (cache->len - i - 1) * sizeof(mp_obj_t));
+    cache->items[--cache->len] = MP_OBJ_NULL;
+  }
+
+  // evicts least recently used entries until another size bytes would fit
+  static void image_cache_trim(size_t size) {
+    mp_obj_list_t *cache = image_cache();
+    while(cache->len > 0 && image_cache_used + size > image_cache_budget) {
+      image_cache_remove(cache, 0);
+    }
+  }
+
+  static mp_obj_t image_load_cached(mp_obj_t path, pixel_format_t pixel_format, int shift) {
+    // the modification time catches files rewritten since they were cached
+    mp_obj_t stat = mp_vfs_stat(path);
+    mp_int_t format = pixel_format | (shift << 8);
+    mp_obj_t mtime = ((mp_obj_tuple_t *)MP_OBJ_TO_PTR(stat))->items[8];
+
+    mp_obj_list_t *cache = image_cache();
+    for(size_t i = 0; i < cache->len; i++) {
+      mp_obj_t entry = cache->items[i];
+      mp_obj_tuple_t *t = (mp_obj_tuple_t *)MP_OBJ_TO_PTR(entry);
+      if(mp_obj_equal(t->items[0], path) && mp_obj_equal(t->items[1], mtime) && mp_obj_get_int(t->items[2]) == format) {
+        // most recently used moves to the end
+        memmove(&cache->items[i], &cache->items[i + 1], (cache->len - i - 1) * sizeof(mp_obj_t));
+        cache->items[cache->len - 1] = entry;
+        return t->items[3];
+      }
+    }
+
+    // anything left under this path is stale, the file has changed
+    for(size_t i = cache->len; i-- > 0;) {
+      mp_obj_tuple_t *t = (mp_obj_tuple_t *)MP_OBJ_TO_PTR(cache->items[i]);
+      if(mp_obj_equal(t->items[0], path) && mp_obj_get_int(t->items[2]) == format) {
+        image_cache_remove(cache, i);
+      }
+    }
+
+    image_obj_t *result = image_load(path, pixel_format, shift);
+    mp_obj_t items[4] = {path, mtime, MP_OBJ_NEW_SMALL_INT(format), MP_OBJ_FROM_PTR(result)};
+    mp_obj_t entry = mp_obj_new_tuple(4, items);
+    size_t size = image_cache_size(entry);
+    if(size <= image_cache_budget) {
+      image_cache_trim(size);
+      mp_obj_list_append(MP_OBJ_FROM_PTR(cache), entry);
+      image_cache_used += size;
+    }
     return MP_OBJ_FROM_PTR(result);
+  }
+
+MPY_BIND_STATICMETHOD_VAR(1, load, {
+    // image.load(path, pixel_format=RGBA8888, cached=False, scale=1), indexed
+    // pngs keep their palette whatever format is asked for but A8, which
+    // takes the alpha of any png or the grey level of an opaque grayscale one.
+    // .pvi files load in the format they were converted to. cached loads share
+    // one decoded image between every caller, see image.cache(). a scale of
+    // 1/2, 1/4 or 1/8 box filters the png as it's decoded, for thumbnails
+    pixel_format_t pixel_format = mp_obj_get_load_format(n_args, args);
+    int shift = mp_obj_get_load_scale(n_args, args);
+    if(n_args > 2 && mp_obj_is_true(args[2])) {
+      return image_load_cached(args[0], pixel_format, shift);
+    }
+    return MP_OBJ_FROM_PTR(image_load(args[0], pixel_format, shift));
   })
 
-MPY_BIND_CLASSMETHOD_ARGS1(load_into, path, {
-    self(self_in, image_obj_t);
-    //const image_obj_t *self = (image_obj_t *)MP_OBJ_TO_PTR(args[0]);
-    PNG *png = new(PicoVector_working_buffer) PNG();
-    int status = png->open(mp_obj_str_get_str(path), pngdec_open_callback, pngdec_close_callback, pngdec_read_callback, pngdec_seek_callback, pngdec_decode_callback);
-    bool has_palette = png->getPixelType() == PNG_PIXEL_INDEXED;
-    png->decode((void *)self->image, 0);
-    png->close();
+  // image.load_async(path, pixel_format=RGBA8888) loads like image.load()
+  // but decodes on core1, returning a loader at once. loader.ready is true
+  // when it's done and loader.result is the image, waiting if need be
+MPY_BIND_STATICMETHOD_VAR(1, load_async, {
+    return image_load_async(args[0], mp_obj_get_load_format(n_args, args));
+  })
+
+  // image.cache([bytes]) sets how much decoded image data cached loads may
+  // keep, evicting the least recently used to fit, and returns the bytes
+  // currently held. image.cache(0) empties the cache
+MPY_BIND_STATICMETHOD_VAR(0, cache, {
+    if(n_args > 0) {
+      mp_int_t budget = mp_obj_get_int(args[0]);
+      if(budget < 0) {
+        mp_raise_msg_varg(&mp_type_ValueError, MP_ERROR_TEXT("cache size must not be negative"));
+      }
+      image_cache_budget = budget;
+      image_cache_trim(0);
+    }
+    image_cache();
+    return mp_obj_new_int(image_cache_used);
+  })
+
+  // image.load_into(path, [x, y], [blend=False]) decodes straight into the
+  // image with the png's top left at (x, y), clipped to the image's clip. by
+  // default pixels are written as they are, blend draws them over the image
+  // with its blend mode and alpha instead
+MPY_BIND_VAR(2, load_into, {
+    PV_ALLOC_SCOPE(PV_ALLOC_IMAGE);
+    const image_obj_t *self = (image_obj_t *)MP_OBJ_TO_PTR(args[0]);
+    image_sync(self);
+
+    png_target_t target = {self->image, 0, 0, false};
+    if(n_args > 3) {
+      target.x = mp_obj_get_int(args[2]);
+      target.y = mp_obj_get_int(args[3]);
+    }
+    if(n_args > 4) {
+      target.blend = mp_obj_is_true(args[4]);
+    }
+
+    int claim;
+    PNG *png = image_png_claim(&claim);
+    nlr_buf_t nlr;
+    if(nlr_push(&nlr) == 0) {
+      pngdec_open(png, args[1]);
+      pngdec_decode(png, &target);
+      self->image->transparency(TRANSPARENCY_UNKNOWN);
+      png->close();
+      nlr_pop();
+    }else{
+      working_buffer_release(claim);
+      nlr_jump(nlr.ret_val);
+    }
+    working_buffer_release(claim);
     return mp_const_none;
   })
 
 
 MPY_BIND_VAR(2, window, {
+    PV_ALLOC_SCOPE(PV_ALLOC_IMAGE);
     const image_obj_t *self = (image_obj_t *)MP_OBJ_TO_PTR(args[0]);
+    image_sync(self);
 
     int x;
     int y;
@@ -113,7 +410,7 @@ MPY_BIND_VAR(2, window, {
 
     if (mp_obj_is_type(args[1], &type_shape)) {
       const shape_obj_t *shape = (shape_obj_t *)MP_OBJ_TO_PTR(args[1]);
-      self->image->draw(shape->shape);
+      image_draw_shape(self, shape);
       return mp_const_none;
     }
 
@@ -123,7 +420,7 @@ MPY_BIND_VAR(2, window, {
       mp_obj_list_get(args[1], &len, &items);
       for(size_t i = 0; i < len; i++) {
         const shape_obj_t *shape = (shape_obj_t *)MP_OBJ_TO_PTR(items[i]);
-        self->image->draw(shape->shape);
+        image_draw_shape(self, shape);
       }
       return mp_const_none;
     }
@@ -135,39 +432,53 @@ MPY_BIND_VAR(2, window, {
   MPY_BIND_VAR(2, rectangle, {
     const image_obj_t *self = (image_obj_t *)MP_OBJ_TO_PTR(args[0]);
 
+    rect_t r;
     if(mp_obj_is_rect(args[1])) {
-      self->image->rectangle(mp_obj_get_rect(args[1]));
-      return mp_const_none;
+      r = mp_obj_get_rect(args[1]);
+    }else if(n_args == 5) {
+      r = mp_obj_get_rect_from_xywh(&args[1]);
+    }else{
+      mp_raise_msg_varg(&mp_type_ValueError, MP_ERROR_TEXT("invalid parameters, expected either rectangle(r) or rectangle(x, y, w, h)"));
     }
 
-    if(n_args == 5) {
-      self->image->rectangle(mp_obj_get_rect_from_xywh(&args[1]));
+    if(auto c = image_defer(self, display_list_t::RECTANGLE, r)) {
+      c->tr = r;
       return mp_const_none;
     }
 
-    mp_raise_msg_varg(&mp_type_ValueError, MP_ERROR_TEXT("invalid parameters, expected either rectangle(r) or rectangle(x, y, w, h)"));
+    self->image->rectangle(r);
+    return mp_const_none;
   })
 
   MPY_BIND_VAR(3, line, {
     const image_obj_t *self = (image_obj_t *)MP_OBJ_TO_PTR(args[0]);
 
-    if(n_args == 3 && mp_obj_is_vec2(args[1]) && mp_obj_is_vec2(args[2])) {
-      vec2_t p1 = mp_obj_get_vec2(args[1]);
-      vec2_t p2 = mp_obj_get_vec2(args[2]);
-      self->image->line(p1, p2);
-      return mp_const_none;
+    // optional trailing argument asks for an antialiased line
+    vec2_t p[2];
+    int aa_arg;
+    if((n_args == 3 || n_args == 4) && mp_obj_is_vec2(args[1]) && mp_obj_is_vec2(args[2])) {
+      p[0] = mp_obj_get_vec2(args[1]); p[1] = mp_obj_get_vec2(args[2]);
+      aa_arg = 3;
+    }else if(n_args == 5 || n_args == 6) {
+      p[0] = mp_obj_get_vec2_from_xy(&args[1]); p[1] = mp_obj_get_vec2_from_xy(&args[3]);
+      aa_arg = 5;
+    }else{
+      mp_raise_msg_varg(&mp_type_ValueError, MP_ERROR_TEXT("invalid parameters, expected either line(p1, p2, aa=False) or line(x1, y1, x2, y2, aa=False)"));
     }
+    bool aa = int(n_args) > aa_arg && mp_obj_is_true(args[aa_arg]);
 
-    if(n_args == 5) {
-      int x1 = mp_obj_get_float(args[1]);
-      int y1 = mp_obj_get_float(args[2]);
-      int x2 = mp_obj_get_float(args[3]);
-      int y2 = mp_obj_get_float(args[4]);
-      self->image->line(vec2_t(x1, y1), vec2_t(x2, y2));
-      return mp_const_none;
+    if(!aa && aa_arg == 5) {
+      // aliased lines from plain coordinates have always been whole pixels
+      p[0] = vec2_t(int(p[0].x), int(p[0].y)); p[1] = vec2_t(int(p[1].x), int(p[1].y));
     }
 
-    mp_raise_msg_varg(&mp_type_ValueError, MP_ERROR_TEXT("invalid parameters, expected either line(p1, p2) or line(x1, y1, x2, y2)"));
+    if(auto c = image_defer(self, display_list_t::LINE, points_bounds(p, 2))) {
+      c->p[0] = p[0]; c->p[1] = p[1];
+      c->size = aa ? 1.0f : 0.0f;
+      return mp_const_none;
+    }
+    self->image->line(p[0], p[1], aa);
+    return mp_const_none;
   })
 
 
@@ -177,6 +488,10 @@ MPY_BIND_VAR(2, window, {
     if(mp_obj_is_vec2(args[1])) {
       vec2_t p = mp_obj_get_vec2(args[1]);
       float r = mp_obj_get_float(args[2]);
+      if(auto c = image_defer(self, display_list_t::CIRCLE, rect_t(p.x - r - 1, p.y - r - 1, r * 2 + 3, r * 2 + 3).round())) {
+        c->p[0] = p; c->size = r;
+        return mp_const_none;
+      }
       self->image->circle(p, r);
       return mp_const_none;
     }
@@ -185,6 +500,10 @@ MPY_BIND_VAR(2, window, {
       int x = mp_obj_get_float(args[1]);
       int y = mp_obj_get_float(args[2]);
       int r = mp_obj_get_float(args[3]);
+      if(auto c = image_defer(self, display_list_t::CIRCLE, rect_t(x - r - 1, y - r - 1, r * 2 + 3, r * 2 + 3))) {
+        c->p[0] = vec2_t(x, y); c->size = r;
+        return mp_const_none;
+      }
       self->image->circle(vec2_t(x, y), r);
       return mp_const_none;
     }
@@ -192,46 +511,241 @@ MPY_BIND_VAR(2, window, {
     mp_raise_msg_varg(&mp_type_ValueError, MP_ERROR_TEXT("invalid parameters, expected either circle(p, r) or circle(x, y, r)"));
   })
 
-  MPY_BIND_VAR(4, triangle, {
+  MPY_BIND_VAR(4, ring, {
     const image_obj_t *self = (image_obj_t *)MP_OBJ_TO_PTR(args[0]);
 
-    if(n_args == 4 && mp_obj_is_vec2(args[1]) && mp_obj_is_vec2(args[2]) && mp_obj_is_vec2(args[3])) {
-      vec2_t p1 = mp_obj_get_vec2(args[1]);
-      vec2_t p2 = mp_obj_get_vec2(args[2]);
-      vec2_t p3 = mp_obj_get_vec2(args[3]);
-      self->image->triangle(p1, p2, p3);
+    vec2_t p;
+    int radius_arg;
+    if(n_args == 4 && mp_obj_is_vec2(args[1])) {
+      p = mp_obj_get_vec2(args[1]);
+      radius_arg = 2;
+    }else if(n_args == 5) {
+      p = vec2_t(int(mp_obj_get_float(args[1])), int(mp_obj_get_float(args[2])));
+      radius_arg = 3;
+    }else{
+      mp_raise_msg_varg(&mp_type_ValueError, MP_ERROR_TEXT("invalid parameters, expected either ring(p, r, thickness) or ring(x, y, r, thickness)"));
+    }
+    int r = mp_obj_get_float(args[radius_arg]);
+    int thickness = mp_obj_get_float(args[radius_arg + 1]);
+
+    if(auto c = image_defer(self, display_list_t::RING, rect_t(p.x - r - 1, p.y - r - 1, r * 2 + 3, r * 2 + 3).round())) {
+      c->p[0] = p; c->size = r; c->p[1] = vec2_t(thickness, 0);
       return mp_const_none;
     }
+    self->image->ring(p, r, thickness);
+    return mp_const_none;
+  })
+
+  MPY_BIND_VAR(3, round_rectangle, {
+    const image_obj_t *self = (image_obj_t *)MP_OBJ_TO_PTR(args[0]);
+
+    // optional trailing argument asks for antialiased edges
+    rect_t r;
+    int radius_arg;
+    if((n_args == 3 || n_args == 4) && mp_obj_is_rect(args[1])) {
+      r = mp_obj_get_rect(args[1]);
+      radius_arg = 2;
+    }else if(n_args == 6 || n_args == 7) {
+      r = mp_obj_get_rect_from_xywh(&args[1]);
+      radius_arg = 5;
+    }else{
+      mp_raise_msg_varg(&mp_type_ValueError, MP_ERROR_TEXT("invalid parameters, expected either round_rectangle(r, radius, aa=False) or round_rectangle(x, y, w, h, radius, aa=False)"));
+    }
+    int radius = mp_obj_get_float(args[radius_arg]);
+    bool aa = int(n_args) > radius_arg + 1 && mp_obj_is_true(args[radius_arg + 1]);
 
-    if(n_args == 7) {
-      vec2_t p1 = mp_obj_get_vec2_from_xy(&args[1]);
-      vec2_t p2 = mp_obj_get_vec2_from_xy(&args[3]);
-      vec2_t p3 = mp_obj_get_vec2_from_xy(&args[5]);
-      self->image->triangle(p1, p2, p3);
+    if(auto c = image_defer(self, display_list_t::ROUND_RECTANGLE, rect_t(r.x - 1, r.y - 1, r.w + 2, r.h + 2).round())) {
+      c->tr = r; c->p[0] = vec2_t(radius, 0);
+      c->size = aa ? 1.0f : 0.0f;
       return mp_const_none;
     }
+    self->image->round_rectangle(r, radius, aa);
+    return mp_const_none;
+  })
 
-    mp_raise_msg_varg(&mp_type_ValueError, MP_ERROR_TEXT("invalid parameters, expected either triangle(p1, p2, p3) or triangle(x1, y1, x2, y2, x3, y3)"));
+  MPY_BIND_VAR(4, ellipse, {
+    const image_obj_t *self = (image_obj_t *)MP_OBJ_TO_PTR(args[0]);
+
+    // optional trailing argument asks for antialiased edges
+    vec2_t p;
+    int radius_arg;
+    if((n_args == 4 || n_args == 5) && mp_obj_is_vec2(args[1])) {
+      p = mp_obj_get_vec2(args[1]);
+      radius_arg = 2;
+    }else if(n_args == 5 || n_args == 6) {
+      p = mp_obj_get_vec2_from_xy(&args[1]);
+      radius_arg = 3;
+    }else{
+      mp_raise_msg_varg(&mp_type_ValueError, MP_ERROR_TEXT("invalid parameters, expected either ellipse(p, rx, ry, aa=False) or ellipse(x, y, rx, ry, aa=False)"));
+    }
+    int rx = mp_obj_get_float(args[radius_arg]);
+    int ry = mp_obj_get_float(args[radius_arg + 1]);
+    bool aa = int(n_args) > radius_arg + 2 && mp_obj_is_true(args[radius_arg + 2]);
+
+    if(auto c = image_defer(self, display_list_t::ELLIPSE, rect_t(p.x - rx - 1, p.y - ry - 1, rx * 2 + 3, ry * 2 + 3).round())) {
+      c->p[0] = p; c->p[1] = vec2_t(rx, ry);
+      c->size = aa ? 1.0f : 0.0f;
+      return mp_const_none;
+    }
+    self->image->ellipse(p, rx, ry, aa);
+    return mp_const_none;
   })
 
+  MPY_BIND_VAR(4, triangle, {
+    const image_obj_t *self = (image_obj_t *)MP_OBJ_TO_PTR(args[0]);
 
+    // optional trailing argument asks for antialiased edges
+    vec2_t p[3];
+    int aa_arg;
+    if((n_args == 4 || n_args == 5) && mp_obj_is_vec2(args[1]) && mp_obj_is_vec2(args[2]) && mp_obj_is_vec2(args[3])) {
+      p[0] = mp_obj_get_vec2(args[1]); p[1] = mp_obj_get_vec2(args[2]); p[2] = mp_obj_get_vec2(args[3]);
+      aa_arg = 4;
+    }else if(n_args == 7 || n_args == 8) {
+      p[0] = mp_obj_get_vec2_from_xy(&args[1]); p[1] = mp_obj_get_vec2_from_xy(&args[3]); p[2] = mp_obj_get_vec2_from_xy(&args[5]);
+      aa_arg = 7;
+    }else{
+      mp_raise_msg_varg(&mp_type_ValueError, MP_ERROR_TEXT("invalid parameters, expected either triangle(p1, p2, p3, aa=False) or triangle(x1, y1, x2, y2, x3, y3, aa=False)"));
+    }
+    bool aa = int(n_args) > aa_arg && mp_obj_is_true(args[aa_arg]);
+
+    if(auto c = image_defer(self, display_list_t::TRIANGLE, points_bounds(p, 3))) {
+      c->p[0] = p[0]; c->p[1] = p[1]; c->p[2] = p[2];
+      c->size = aa ? 1.0f : 0.0f;
+      return mp_const_none;
+    }
+    self->image->triangle(p[0], p[1], p[2], aa);
+    return mp_const_none;
+  })
+
+
+// blur(radius, rect=None, kernel=BLUR_IIR) blurs rect, or the whole image,
+// within the clip. BLUR_BOX costs the same at any radius, up to 127
 MPY_BIND_VAR(2, blur, {
     const image_obj_t *self = (image_obj_t *)MP_OBJ_TO_PTR(args[0]);
     float radius = mp_obj_get_float(args[1]);
-    self->image->blur(radius);
+    rect_t area = n_args > 2 && args[2] != mp_const_none ? mp_obj_get_rect(args[2]) : self->image->clip();
+    int kernel = n_args > 3 ? mp_obj_get_int(args[3]) : BLUR_IIR;
+    if(kernel != BLUR_IIR && kernel != BLUR_BOX) {
+      mp_raise_msg_varg(&mp_type_ValueError, MP_ERROR_TEXT("kernel must be BLUR_IIR or BLUR_BOX"));
+    }
+    image_sync(self);
+    self->image->blur(radius, area, blur_kernel_t(kernel));
     return mp_const_none;
   })
 
 
 MPY_BIND_VAR(1, dither, {
     const image_obj_t *self = (image_obj_t *)MP_OBJ_TO_PTR(args[0]);
+    image_sync(self);
     self->image->dither();
     return mp_const_none;
   })
 
 
+// quantise(target, mode=QUANTISE_FLOYD_STEINBERG, colours=256) writes the
+// image into the indexed image target using the first colours entries of
+// its palette
+MPY_BIND_VAR(2, quantise, {
+    const image_obj_t *self = (image_obj_t *)MP_OBJ_TO_PTR(args[0]);
+    if(!mp_obj_is_type(args[1], &type_image)) {
+      mp_raise_msg_varg(&mp_type_TypeError, MP_ERROR_TEXT("invalid parameter, expected quantise(target, mode=QUANTISE_FLOYD_STEINBERG, colours=256)"));
+    }
+    const image_obj_t *target = (image_obj_t *)MP_OBJ_TO_PTR(args[1]);
+    int mode = n_args > 2 ? mp_obj_get_int(args[2]) : QUANTISE_FLOYD_STEINBERG;
+    int colours = n_args > 3 ? mp_obj_get_int(args[3]) : 256;
+    if(mode < QUANTISE_NONE || mode > QUANTISE_ATKINSON) {
+      mp_raise_msg_varg(&mp_type_ValueError, MP_ERROR_TEXT("mode must be QUANTISE_NONE, QUANTISE_ORDERED, QUANTISE_FLOYD_STEINBERG or QUANTISE_ATKINSON"));
+    }
+    if(colours < 1 || colours > 256) {
+      mp_raise_msg_varg(&mp_type_ValueError, MP_ERROR_TEXT("colours must be between 1 and 256"));
+    }
+    if(self->image->pixel_format() != RGBA8888 || self->image->has_palette()) {
+      mp_raise_msg_varg(&mp_type_ValueError, MP_ERROR_TEXT("only RGBA8888 images can be quantised"));
+    }
+    if(!target->image->has_palette()) {
+      mp_raise_msg_varg(&mp_type_ValueError, MP_ERROR_TEXT("target must be an indexed image"));
+    }
+    image_sync(self);
+    image_sync(target);
+    self->image->quantise(target->image, colours, quantise_t(mode));
+    return mp_const_none;
+  })
+
+
+// filter(stages, rect=None) runs a chain of filters over rect, or the whole
+// image, within the clip. stages are FILTER_MONOCHROME, FILTER_ONEBIT,
+// FILTER_DITHER or (FILTER_BLUR, radius, kernel=BLUR_IIR). neighbouring per
+// pixel stages share one pass over the image
+#define FILTER_MAX_STAGES 16
+
+MPY_BIND_VAR(2, filter, {
+    const image_obj_t *self = (image_obj_t *)MP_OBJ_TO_PTR(args[0]);
+
+    size_t count;
+    mp_obj_t *items;
+    mp_obj_get_array(args[1], &count, &items);
+    if(count > FILTER_MAX_STAGES) {
+      mp_raise_msg_varg(&mp_type_ValueError, MP_ERROR_TEXT("at most %d filter stages"), FILTER_MAX_STAGES);
+    }
+
+    filter_stage_t stages[FILTER_MAX_STAGES];
+    for(size_t i = 0; i < count; i++) {
+      size_t n = 1;
+      mp_obj_t *stage = &items[i];
+      if(mp_obj_is_type(items[i], &mp_type_tuple) || mp_obj_is_type(items[i], &mp_type_list)) {
+        mp_obj_get_array(items[i], &n, &stage);
+      }
+
+      int type = n > 0 ? mp_obj_get_int(stage[0]) : -1;
+      stages[i].type = filter_stage_t::type_t(type);
+      stages[i].radius = 0.0f;
+      stages[i].kernel = BLUR_IIR;
+      if(type == filter_stage_t::BLUR && (n == 2 || n == 3)) {
+        stages[i].radius = mp_obj_get_float(stage[1]);
+        stages[i].kernel = blur_kernel_t(n > 2 ? mp_obj_get_int(stage[2]) : BLUR_IIR);
+        if(stages[i].kernel != BLUR_IIR && stages[i].kernel != BLUR_BOX) {
+          mp_raise_msg_varg(&mp_type_ValueError, MP_ERROR_TEXT("kernel must be BLUR_IIR or BLUR_BOX"));
+        }
+      }else if(type < filter_stage_t::MONOCHROME || type > filter_stage_t::DITHER || n != 1) {
+        mp_raise_msg_varg(&mp_type_ValueError, MP_ERROR_TEXT("stages must be FILTER_MONOCHROME, FILTER_ONEBIT, FILTER_DITHER or (FILTER_BLUR, radius, kernel=BLUR_IIR)"));
+      }
+    }
+
+    rect_t area = n_args > 2 && args[2] != mp_const_none ? mp_obj_get_rect(args[2]) : self->image->clip();
+    image_sync(self);
+    self->image->filter(stages, count, area);
+    return mp_const_none;
+  })
+
+
+// shadow(shape, radius, offset=None, scale=2) composites a soft shadow of
+// shape, moved by the vec2 offset, with the image's brush. it's blurred at
+// 1/2 or 1/4 resolution, which is cheap enough to animate. draw the shape
+// over it afterwards, with no offset and a bright brush it's a glow
+MPY_BIND_VAR(3, shadow, {
+    const image_obj_t *self = (image_obj_t *)MP_OBJ_TO_PTR(args[0]);
+    if(!mp_obj_is_type(args[1], &type_shape)) {
+      mp_raise_msg_varg(&mp_type_TypeError, MP_ERROR_TEXT("invalid parameter, expected shadow(shape, radius, offset=None, scale=2)"));
+    }
+    const shape_obj_t *shape = (shape_obj_t *)MP_OBJ_TO_PTR(args[1]);
+    float radius = mp_obj_get_float(args[2]);
+    vec2_t offset = n_args > 3 && args[3] != mp_const_none ? mp_obj_get_vec2(args[3]) : vec2_t(0, 0);
+    int scale = n_args > 4 ? mp_obj_get_int(args[4]) : 2;
+    if(scale != 1 && scale != 2 && scale != 4) {
+      mp_raise_msg_varg(&mp_type_ValueError, MP_ERROR_TEXT("scale must be 1, 2 or 4"));
+    }
+    if(radius < 0.0f) {
+      mp_raise_msg_varg(&mp_type_ValueError, MP_ERROR_TEXT("radius must not be negative"));
+    }
+    image_sync(self);
+    self->image->shadow(shape->shape, offset, radius, scale);
+    return mp_const_none;
+  })
+
+
 MPY_BIND_VAR(1, monochrome, {
     const image_obj_t *self = (image_obj_t *)MP_OBJ_TO_PTR(args[0]);
+    image_sync(self);
     self->image->monochrome();
     return mp_const_none;
   })
@@ -239,10 +753,21 @@ MPY_BIND_VAR(1, monochrome, {
 
 MPY_BIND_VAR(1, onebit, {
     const image_obj_t *self = (image_obj_t *)MP_OBJ_TO_PTR(args[0]);
+    image_sync(self);
     self->image->onebit();
     return mp_const_none;
   })
 
+  // compile() records where the image's transparent, translucent and opaque
+  // pixels are so that plain blits of it skip the transparent parts and copy
+  // the opaque ones. drawing into the image undoes it
+MPY_BIND_VAR(1, compile, {
+    const image_obj_t *self = (image_obj_t *)MP_OBJ_TO_PTR(args[0]);
+    image_sync(self);
+    self->image->compile();
+    return mp_const_none;
+  })
+
 // do we want to allow this with premultiplied alpha?
 // would we undo the multiply and return rgba?
 MPY_BIND_VAR(2, get, {
@@ -253,9 +778,8 @@ MPY_BIND_VAR(2, get, {
     } else {
       point = mp_obj_get_vec2_from_xy(&args[1]);
     }
-    color_obj_t *color = mp_obj_malloc(color_obj_t, &type_color);
-    color->c->_p = self->image->get(point.x, point.y);
-    return MP_OBJ_FROM_PTR(color);
+    image_sync(self);
+    return MP_OBJ_FROM_PTR(mp_color_get(COLOR_PREMUL, self->image->get(point.x, point.y)));
   })
 
 MPY_BIND_VAR(2, put, {
@@ -266,10 +790,155 @@ MPY_BIND_VAR(2, put, {
     } else {
       point = mp_obj_get_vec2_from_xy(&args[1]);
     }
+    image_sync(self);
     self->image->put(point.x, point.y);
     return mp_const_none;
   })
 
+
+  // batch drawing, a whole buffer of items is drawn in one call so that
+  // particles and plots don't pay for argument parsing per item.
+  // coordinates come from any int16 or float buffer (array('h'),
+  // array('f'), or a memoryview of one) with a fixed number of values per
+  // item. the optional second buffer holds one 32 bit 0xRRGGBBAA colour
+  // per item, without it the image's brush is used. batches draw straight
+  // to the image, deferred ones flush first so the order is kept
+  enum batch_kind_t {
+    BATCH_RECTANGLES,
+    BATCH_CIRCLES,
+    BATCH_LINES,
+    BATCH_POINTS
+  };
+
+  static inline float batch_value(const mp_buffer_info_t &b, size_t i) {
+    return b.typecode == 'f' ? ((float *)b.buf)[i] : float(((int16_t *)b.buf)[i]);
+  }
+
+  static mp_obj_t image_batch(size_t n_args, const mp_obj_t *args, batch_kind_t kind, int stride) {
+    const image_obj_t *self = (image_obj_t *)MP_OBJ_TO_PTR(args[0]);
+
+    mp_buffer_info_t coords;
+    mp_get_buffer_raise(args[1], &coords, MP_BUFFER_READ);
+    if(coords.typecode != 'h' && coords.typecode != 'f') {
+      mp_raise_msg_varg(&mp_type_ValueError, MP_ERROR_TEXT("coordinates must be an array('h') or array('f')"));
+    }
+    size_t value_size = coords.typecode == 'f' ? sizeof(float) : sizeof(int16_t);
+    size_t count = coords.len / (value_size * stride);
+
+    mp_buffer_info_t colors = {};
+    bool has_colors = n_args > 2 && args[2] != mp_const_none;
+    if(has_colors) {
+      mp_get_buffer_raise(args[2], &colors, MP_BUFFER_READ);
+      if(colors.len / sizeof(uint32_t) < count || !strchr("IiLl", colors.typecode)) {
+        mp_raise_msg_varg(&mp_type_ValueError, MP_ERROR_TEXT("colours must be an array('I') with one entry per item"));
+      }
+    }
+
+    image_sync(self);
+    image_t *image = self->image;
+
+    // per item colours go through a single brush that's updated in place
+    static color_brush_t item_brush = color_brush_t(color_t());
+    brush_t *brush = image->brush();
+    if(has_colors) {
+      image->brush(&item_brush);
+    }
+
+    rect_t clip = image->clip();
+
+    for(size_t i = 0; i < count; i++) {
+      size_t v = i * stride;
+
+      if(has_colors) {
+        uint32_t c = ((uint32_t *)colors.buf)[i];
+        item_brush.c.premul(c >> 24, c >> 16, c >> 8, c);
+      }
+
+      switch(kind) {
+        case BATCH_RECTANGLES: {
+          image->rectangle(rect_t(batch_value(coords, v), batch_value(coords, v + 1), batch_value(coords, v + 2), batch_value(coords, v + 3)));
+        } break;
+
+        case BATCH_CIRCLES: {
+          image->circle(vec2_t(int(batch_value(coords, v)), int(batch_value(coords, v + 1))), int(batch_value(coords, v + 2)));
+        } break;
+
+        case BATCH_LINES: {
+          image->line(
+            vec2_t(int(batch_value(coords, v)), int(batch_value(coords, v + 1))),
+            vec2_t(int(batch_value(coords, v + 2)), int(batch_value(coords, v + 3))));
+        } break;
+
+        case BATCH_POINTS: {
+          // unlike put() points outside the clip are dropped rather than
+          // pinned to its edge
+          int x = floorf(batch_value(coords, v));
+          int y = floorf(batch_value(coords, v + 1));
+          if(x >= clip.x && x < clip.x + clip.w && y >= clip.y && y < clip.y + clip.h) {
+            image->put_unsafe(x, y);
+          }
+        } break;
+      }
+    }
+
+    if(has_colors) {
+      image->brush(brush);
+    }
+
+    return mp_const_none;
+  }
+
+  // rectangles(coords, colours=None) with x, y, w, h per item
+  MPY_BIND_VAR(2, rectangles, {
+    return image_batch(n_args, args, BATCH_RECTANGLES, 4);
+  })
+
+  // circles(coords, colours=None) with x, y, r per item
+  MPY_BIND_VAR(2, circles, {
+    return image_batch(n_args, args, BATCH_CIRCLES, 3);
+  })
+
+  // lines(coords, colours=None) with x1, y1, x2, y2 per item
+  MPY_BIND_VAR(2, lines, {
+    return image_batch(n_args, args, BATCH_LINES, 4);
+  })
+
+  // points(coords, colours=None) with x, y per item
+  MPY_BIND_VAR(2, points, {
+    return image_batch(n_args, args, BATCH_POINTS, 2);
+  })
+
+  // plot(samples, rect, ymin, ymax, mode=PLOT_LINE) draws an array('f') or
+  // array('h') of samples across rect in the current pen
+  MPY_BIND_VAR(5, plot, {
+    const image_obj_t *self = (image_obj_t *)MP_OBJ_TO_PTR(args[0]);
+
+    mp_buffer_info_t samples;
+    mp_get_buffer_raise(args[1], &samples, MP_BUFFER_READ);
+    if(samples.typecode != 'h' && samples.typecode != 'f') {
+      mp_raise_msg_varg(&mp_type_ValueError, MP_ERROR_TEXT("samples must be an array('h') or array('f')"));
+    }
+    if(!mp_obj_is_rect(args[2])) {
+      mp_raise_msg_varg(&mp_type_TypeError, MP_ERROR_TEXT("invalid parameter, expected plot(samples, rect, ymin, ymax, mode=PLOT_LINE)"));
+    }
+    rect_t r = mp_obj_get_rect(args[2]);
+    float ymin = mp_obj_get_float(args[3]);
+    float ymax = mp_obj_get_float(args[4]);
+
+    int mode = n_args > 5 ? mp_obj_get_int(args[5]) : PLOT_LINE;
+    if(mode < PLOT_LINE || mode > PLOT_BARS) {
+      mp_raise_msg_varg(&mp_type_ValueError, MP_ERROR_TEXT("mode must be PLOT_LINE, PLOT_AREA or PLOT_BARS"));
+    }
+
+    image_sync(self);
+    if(samples.typecode == 'f') {
+      self->image->plot((const float *)samples.buf, samples.len / sizeof(float), r, ymin, ymax, plot_mode_t(mode));
+    }else{
+      self->image->plot((const int16_t *)samples.buf, samples.len / sizeof(int16_t), r, ymin, ymax, plot_mode_t(mode));
+    }
+    return mp_const_none;
+  })
+
 MPY_BIND_VAR(3, text, {
     const image_obj_t *self = (image_obj_t *)MP_OBJ_TO_PTR(args[0]);
     const char *text = mp_obj_str_get_str(args[1]);
@@ -291,16 +960,54 @@ MPY_BIND_VAR(3, text, {
 
     if(self->font) {
       float size = mp_obj_get_float(args[arg_offset]);
+      // vector text isn't measured up front, it's replayed into every band
+      if(auto c = image_defer(self, display_list_t::TEXT, self->image->clip())) {
+        c->text = text; c->p[0] = point; c->size = size;
+        c->owners[2] = (void *)args[1];
+        return mp_const_none;
+      }
       self->image->font()->draw(self->image, text, point.x, point.y, size);
     }
 
     if(self->pixel_font) {
+      if(self->display_list) {
+        rect_t b = self->image->pixel_font()->measure(self->image, text);
+        auto c = image_defer(self, display_list_t::PIXEL_TEXT, rect_t(point.x, point.y, b.w, b.h));
+        c->text = text; c->p[0] = point;
+        c->owners[2] = (void *)args[1];
+        return mp_const_none;
+      }
       self->image->pixel_font()->draw(self->image, text, point.x, point.y);
     }
 
     return mp_const_none;
   })
 
+  // text_layout(layout, x, y) or text_layout(layout, p) draws a layout made by
+  // text.layout() with its top left at the point, in the layout's own font
+MPY_BIND_VAR(3, text_layout, {
+    const image_obj_t *self = (image_obj_t *)MP_OBJ_TO_PTR(args[0]);
+    if(!mp_obj_is_type(args[1], &type_text_layout) || (!mp_obj_is_vec2(args[2]) && n_args < 4)) {
+      mp_raise_TypeError(MP_ERROR_TEXT("invalid parameter, expected text_layout(layout, x, y) or text_layout(layout, p)"));
+    }
+    text_layout_obj_t *layout = (text_layout_obj_t *)MP_OBJ_TO_PTR(args[1]);
+    text_layout_t *l = &layout->layout;
+
+    vec2_t point = mp_obj_is_vec2(args[2]) ? mp_obj_get_vec2(args[2]) : mp_obj_get_vec2_from_xy(&args[2]);
+
+    // vector glyphs can reach outside of their advance, they're replayed
+    // into every band like text()
+    rect_t bounds = l->font ? self->image->clip() : rect_t(point.x, point.y, l->width, l->height);
+    if(auto c = image_defer(self, display_list_t::TEXT_LAYOUT, bounds)) {
+      c->layout = l; c->p[0] = point;
+      c->owners[2] = (void *)layout;
+      return mp_const_none;
+    }
+    l->draw(self->image, point.x, point.y);
+
+    return mp_const_none;
+  })
+
 MPY_BIND_VAR(2, measure_text, {
     const image_obj_t *self = (image_obj_t *)MP_OBJ_TO_PTR(args[0]);
     const char *text = mp_obj_str_get_str(args[1]);
@@ -334,10 +1041,37 @@ MPY_BIND_VAR(9, vspan_tex, {
     int c = mp_obj_get_float(args[4]);
     vec2_t us_vs = mp_obj_get_vec2_from_xy(&args[5]);
     vec2_t ue_ve = mp_obj_get_vec2_from_xy(&args[7]);
+    image_sync(self);
+    image_sync(src);
     src->image->vspan_tex(self->image, p, c, us_vs, ue_ve);
     return mp_const_none;
   })
 
+  // vspans_tex(src, columns, shaded=False) draws a whole array('f') of
+  // x, y, count, u1, v1, u2, v2 columns, with a trailing 0..255 brightness
+  // on each when shaded
+  MPY_BIND_VAR(3, vspans_tex, {
+    const image_obj_t *self = (image_obj_t *)MP_OBJ_TO_PTR(args[0]);
+
+    if(!mp_obj_is_type(args[1], &type_image)) {
+      mp_raise_msg_varg(&mp_type_TypeError, MP_ERROR_TEXT("invalid parameter, expected vspans_tex(image, columns, shaded=False)"));
+    }
+    const image_obj_t *src = (image_obj_t *)MP_OBJ_TO_PTR(args[1]);
+
+    mp_buffer_info_t columns;
+    mp_get_buffer_raise(args[2], &columns, MP_BUFFER_READ);
+    if(columns.typecode != 'f') {
+      mp_raise_msg_varg(&mp_type_ValueError, MP_ERROR_TEXT("columns must be an array('f')"));
+    }
+    int stride = n_args > 3 && mp_obj_is_true(args[3]) ? 8 : 7;
+    int count = columns.len / (sizeof(float) * stride);
+
+    image_sync(src);
+    image_sync(self);
+    src->image->vspans_tex(self->image, (const float *)columns.buf, count, stride);
+    return mp_const_none;
+  })
+
 MPY_BIND_VAR(3, blit, {
     const image_obj_t *self = (image_obj_t *)MP_OBJ_TO_PTR(args[0]);
 
@@ -345,24 +1079,136 @@ MPY_BIND_VAR(3, blit, {
 
       const image_obj_t *src = (image_obj_t *)MP_OBJ_TO_PTR(args[1]);
 
+      // the source is read when the blit is replayed, so it must be up to
+      // date and can't be the image being deferred into
+      image_sync(src);
+      if(src == self) {
+        image_sync(self);
+      }
+      bool defer = self->display_list && src != self;
+
       if(n_args == 3 && mp_obj_is_vec2(args[2])) {
-        src->image->blit(self->image, mp_obj_get_vec2(args[2]));
+        vec2_t p = mp_obj_get_vec2(args[2]);
+        if(defer) {
+          rect_t sb = src->image->bounds();
+          auto c = image_defer(self, display_list_t::BLIT, rect_t(p.x, p.y, sb.w, sb.h).round());
+          c->src = src->image; c->p[0] = p;
+          c->owners[2] = (void *)src;
+          return mp_const_none;
+        }
+        src->image->blit(self->image, p);
         return mp_const_none;
       }
 
-      if(n_args == 3 && mp_obj_is_rect(args[2])) {
-        src->image->blit(self->image, mp_obj_get_rect(args[2]));
+      if((n_args == 3 && mp_obj_is_rect(args[2])) || (n_args == 4 && mp_obj_is_rect(args[2]) && mp_obj_is_rect(args[3]))) {
+        rect_t sr = n_args == 4 ? mp_obj_get_rect(args[2]) : src->image->bounds();
+        rect_t tr = mp_obj_get_rect(args[n_args - 1]);
+        if(defer) {
+          auto c = image_defer(self, display_list_t::BLIT_RECT, tr.normalise().round());
+          c->src = src->image; c->sr = sr; c->tr = tr;
+          c->owners[2] = (void *)src;
+          return mp_const_none;
+        }
+        src->image->blit(self->image, sr, tr);
         return mp_const_none;
       }
 
-      if(n_args == 4 && mp_obj_is_rect(args[2]) && mp_obj_is_rect(args[3])) {
-        src->image->blit(self->image, mp_obj_get_rect(args[2]), mp_obj_get_rect(args[3]));
+      // blit(image, transform, bilinear=False) maps the image's pixels
+      // through a mat3, so it can be scaled, rotated and sheared in place
+      if(mp_obj_is_type(args[2], &type_mat3)) {
+        mat3_t m = ((mat3_obj_t *)MP_OBJ_TO_PTR(args[2]))->m;
+        bool bilinear = n_args > 3 && mp_obj_is_true(args[3]);
+        if(defer) {
+          // transform() truncates its corners, so allow for what it drops
+          rect_t sb = src->image->bounds();
+          rect_t fp = rect_t(0, 0, sb.w, sb.h).transform(&m);
+          fp.inflate(2);
+          auto c = image_defer(self, display_list_t::BLIT_TRANSFORM, fp);
+          c->src = src->image; c->transform = m;
+          c->size = bilinear ? 1.0f : 0.0f;
+          c->owners[2] = (void *)src;
+          return mp_const_none;
+        }
+        src->image->blit(self->image, m, bilinear);
         return mp_const_none;
       }
 
     }
 
-    mp_raise_msg_varg(&mp_type_TypeError, MP_ERROR_TEXT("invalid parameter, expected blit(image, point), blit(image, rect) or blit(image, source_rect, dest_rect)"));
+    mp_raise_msg_varg(&mp_type_TypeError, MP_ERROR_TEXT("invalid parameter, expected blit(image, point), blit(image, rect), blit(image, source_rect, dest_rect) or blit(image, transform, bilinear=False)"));
+  })
+
+  // blit_many(atlas, sprites, flipped=False) draws every sprite packed into
+  // an array('h') of (sx, sy, sw, sh, dx, dy) entries, or (sx, sy, sw, sh,
+  // dx, dy, flip) when flipped is set where bit 0 of flip mirrors the sprite
+  // horizontally and bit 1 vertically. sprites are cut straight from the
+  // atlas so no window images are needed
+  MPY_BIND_VAR(3, blit_many, {
+    const image_obj_t *self = (image_obj_t *)MP_OBJ_TO_PTR(args[0]);
+
+    if(!mp_obj_is_type(args[1], &type_image)) {
+      mp_raise_msg_varg(&mp_type_TypeError, MP_ERROR_TEXT("invalid parameter, expected blit_many(image, sprites, flipped=False)"));
+    }
+    const image_obj_t *atlas = (image_obj_t *)MP_OBJ_TO_PTR(args[1]);
+
+    mp_buffer_info_t sprites;
+    mp_get_buffer_raise(args[2], &sprites, MP_BUFFER_READ);
+    if(sprites.typecode != 'h') {
+      mp_raise_msg_varg(&mp_type_ValueError, MP_ERROR_TEXT("sprites must be an array('h')"));
+    }
+    int stride = n_args > 3 && mp_obj_is_true(args[3]) ? 7 : 6;
+    int count = sprites.len / (sizeof(int16_t) * stride);
+
+    image_sync(atlas);
+    image_sync(self);
+    atlas->image->blit_sprites(self->image, (const int16_t *)sprites.buf, count, stride);
+    return mp_const_none;
+  })
+
+  // mask(image, pos) draws the brush through the coverage of an A8 image
+  // with its top left at pos, e.g. to tint an icon
+MPY_BIND_VAR(3, mask, {
+    const image_obj_t *self = (image_obj_t *)MP_OBJ_TO_PTR(args[0]);
+    if(!mp_obj_is_type(args[1], &type_image)) {
+      mp_raise_TypeError(MP_ERROR_TEXT("mask must be of type image"));
+    }
+    const image_obj_t *mask = (image_obj_t *)MP_OBJ_TO_PTR(args[1]);
+    if(mask->image->pixel_format() != A8) {
+      mp_raise_msg_varg(&mp_type_ValueError, MP_ERROR_TEXT("mask must be an A8 image"));
+    }
+
+    image_sync(mask);
+    image_sync(self);
+    self->image->mask(mask->image, mp_obj_get_vec2(args[2]));
+    return mp_const_none;
+  })
+
+  // palette(i) returns entry i, palette(i, color) sets it
+MPY_BIND_VAR(2, palette, {
+    const image_obj_t *self = (image_obj_t *)MP_OBJ_TO_PTR(args[0]);
+
+    if(!self->image->has_palette()) {
+      mp_raise_msg_varg(&mp_type_ValueError, MP_ERROR_TEXT("image has no palette"));
+    }
+
+    int i = mp_obj_get_int(args[1]);
+    if(i < 0 || i > 255) {
+      mp_raise_msg_varg(&mp_type_ValueError, MP_ERROR_TEXT("palette index out of range"));
+    }
+
+    if(n_args > 2) {
+      if(!mp_obj_is_type(args[2], &type_color)) {
+        mp_raise_TypeError(MP_ERROR_TEXT("value must be of type color"));
+      }
+      const color_obj_t *color = (color_obj_t *)MP_OBJ_TO_PTR(args[2]);
+      image_sync(self);
+      self->image->palette(i, color->c->_p);
+      return mp_const_none;
+    }
+
+    uint32_t c = self->image->palette(i);
+    uint32_t key = (_r(c) << 24) | (_g(c) << 16) | (_b(c) << 8) | _a(c);
+    return MP_OBJ_FROM_PTR(mp_color_get(COLOR_RGB, key));
   })
 
 MPY_BIND_VAR(1, clear, {
@@ -372,12 +1218,23 @@ MPY_BIND_VAR(1, clear, {
     //   const color_obj_t *color = (color_obj_t *)MP_OBJ_TO_PTR(args[1]);
     //   self->image->clear(color->c);
     // }else{
+      if(auto c = image_defer(self, display_list_t::RECTANGLE, self->image->clip())) {
+        c->tr = self->image->clip();
+        return mp_const_none;
+      }
       self->image->clear();
 //    }
 
     return mp_const_none;
   })
 
+  // replay any deferred draw calls into the image
+MPY_BIND_VAR(1, flush, {
+    const image_obj_t *self = (image_obj_t *)MP_OBJ_TO_PTR(args[0]);
+    image_sync(self);
+    return mp_const_none;
+  })
+
 MPY_BIND_ATTR(image, {
     self(self_in, image_obj_t);
 
@@ -386,12 +1243,28 @@ MPY_BIND_ATTR(image, {
     switch(attr) {
       case MP_QSTR_raw: {
         if(action == GET) {
+          image_sync(self);
+          self->image->transparency(TRANSPARENCY_UNKNOWN);
           mp_obj_t raw = mp_obj_new_bytearray_by_ref(self->image->buffer_size(), self->image->ptr(0, 0));
           dest[0] = raw;
           return;
         }
       };
 
+      case MP_QSTR_raw_palette: {
+        if(action == GET) {
+          image_sync(self);
+          if(!self->image->has_palette()) {
+            dest[0] = mp_const_none;
+            return;
+          }
+          self->image->transparency(TRANSPARENCY_UNKNOWN);
+          const palette_t &palette = self->image->palette();
+          dest[0] = mp_obj_new_bytearray_by_ref(palette.size() * sizeof(uint32_t), (void *)palette.data());
+          return;
+        }
+      };
+
       case MP_QSTR_clip: {
         if(action == GET) {
           rect_obj_t *result = mp_obj_malloc(rect_obj_t, &type_rect);
@@ -426,6 +1299,13 @@ MPY_BIND_ATTR(image, {
         }
       };
 
+      case MP_QSTR_pixel_format: {
+        if(action == GET) {
+          dest[0] = mp_obj_new_int(self->image->pixel_format());
+          return;
+        }
+      };
+
       case MP_QSTR_has_palette: {
         if(action == GET) {
           dest[0] = mp_obj_new_bool(self->image->has_palette());
@@ -433,6 +1313,15 @@ MPY_BIND_ATTR(image, {
         }
       };
 
+      // SRAM, PSRAM or FLASH, or None if it can't be told
+      case MP_QSTR_memory: {
+        if(action == GET) {
+          memory_t memory = self->image->memory();
+          dest[0] = memory == MEMORY_ANY ? mp_const_none : mp_obj_new_int(memory);
+          return;
+        }
+      };
+
       case MP_QSTR_antialias: {
         if(action == GET) {
           dest[0] = mp_obj_new_int(self->image->antialias());
@@ -446,6 +1335,57 @@ MPY_BIND_ATTR(image, {
         }
       };
 
+      case MP_QSTR_deferred: {
+        if(action == GET) {
+          dest[0] = mp_obj_new_bool(self->display_list != nullptr);
+          return;
+        }
+
+        if(action == SET) {
+          if(mp_obj_is_true(dest[1])) {
+            if(!self->display_list) {
+              self->display_list = m_new_class(display_list_t);
+            }
+          }else if(self->display_list) {
+            self->display_list->flush(self->image);
+            m_del_class(display_list_t, self->display_list);
+            self->display_list = nullptr;
+          }
+          dest[0] = MP_OBJ_NULL;
+          return;
+        }
+      };
+
+      case MP_QSTR_rasteriser: {
+        if(action == GET) {
+          dest[0] = mp_obj_new_int(self->image->rasteriser());
+          return;
+        }
+
+        if(action == SET) {
+          int rasteriser = mp_obj_get_int(dest[1]);
+          if(rasteriser != rasteriser_t::FLOAT && rasteriser != rasteriser_t::FIXED) {
+            mp_raise_msg_varg(&mp_type_ValueError, MP_ERROR_TEXT("unknown rasteriser %d"), rasteriser);
+          }
+          self->image->rasteriser((rasteriser_t)rasteriser);
+          dest[0] = MP_OBJ_NULL;
+          return;
+        }
+      };
+
+      case MP_QSTR_multicore: {
+        if(action == GET) {
+          dest[0] = mp_obj_new_bool(self->image->multicore());
+          return;
+        }
+
+        if(action == SET) {
+          self->image->multicore(mp_obj_is_true(dest[1]));
+          dest[0] = MP_OBJ_NULL;
+          return;
+        }
+      };
+
       case MP_QSTR_alpha: {
         if(action == GET) {
           dest[0] = mp_obj_new_int(self->image->alpha());
@@ -459,6 +1399,28 @@ MPY_BIND_ATTR(image, {
         }
       };
 
+      // OPAQUE, BINARY_ALPHA or TRANSLUCENT, worked out on first read. code
+      // writing to raw or the buffer directly can set UNKNOWN to have it
+      // looked at again, or another value if it knows better
+      case MP_QSTR_transparency: {
+        if(action == GET) {
+          image_sync(self);
+          dest[0] = mp_obj_new_int(self->image->transparency());
+          return;
+        }
+
+        if(action == SET) {
+          int t = mp_obj_get_int(dest[1]);
+          if(t < TRANSPARENCY_UNKNOWN || t > TRANSLUCENT) {
+            mp_raise_msg_varg(&mp_type_ValueError, MP_ERROR_TEXT("transparency must be UNKNOWN, OPAQUE, BINARY_ALPHA or TRANSLUCENT"));
+          }
+          image_sync(self);
+          self->image->transparency(transparency_t(t));
+          dest[0] = MP_OBJ_NULL;
+          return;
+        }
+      };
+
       case MP_QSTR_pen: {
         if(action == GET) {
           if(self->brush) {
@@ -472,7 +1434,7 @@ MPY_BIND_ATTR(image, {
         if(action == SET) {
           brush_obj_t *brush = mp_obj_to_brush(1, &dest[1]);
           if(!brush){
-            mp_raise_TypeError(MP_ERROR_TEXT("value must be of type brush or color"));
+            mp_raise_TypeError(MP_ERROR_TEXT("value must be of type brush, color or int"));
           }
           self->brush = brush;
           self->image->brush(brush->brush);
@@ -527,6 +1489,9 @@ MPY_BIND_ATTR(image, {
 
   static mp_int_t image_get_framebuffer(mp_obj_t self_in, mp_buffer_info_t *bufinfo, mp_uint_t flags) {
     self(self_in, image_obj_t);
+    if(flags & MP_BUFFER_WRITE) {
+      self->image->transparency(TRANSPARENCY_UNKNOWN);
+    }
     bufinfo->buf = self->image->ptr(0, 0);
     bufinfo->len = self->image->buffer_size();
     bufinfo->typecode = 'B';
@@ -537,21 +1502,36 @@ MPY_BIND_LOCALS_DICT(image,
       { MP_ROM_QSTR(MP_QSTR___del__), MP_ROM_PTR(&image__del___obj) },
 
       MPY_BIND_ROM_PTR_STATIC(load),
+      MPY_BIND_ROM_PTR_STATIC(load_async),
+      MPY_BIND_ROM_PTR_STATIC(cache),
       MPY_BIND_ROM_PTR(load_into),
       MPY_BIND_ROM_PTR(window),
+      MPY_BIND_ROM_PTR(palette),
       //MPY_BIND_ROM_PTR(clip),
 
       // primitives
       MPY_BIND_ROM_PTR(clear),
+      MPY_BIND_ROM_PTR(flush),
       MPY_BIND_ROM_PTR(rectangle),
       MPY_BIND_ROM_PTR(line),
       MPY_BIND_ROM_PTR(circle),
+      MPY_BIND_ROM_PTR(ring),
+      MPY_BIND_ROM_PTR(ellipse),
+      MPY_BIND_ROM_PTR(round_rectangle),
       MPY_BIND_ROM_PTR(triangle),
       MPY_BIND_ROM_PTR(get), // Wont get real pixel value due to premult
       MPY_BIND_ROM_PTR(put),
+      MPY_BIND_ROM_PTR(rectangles),
+      MPY_BIND_ROM_PTR(circles),
+      MPY_BIND_ROM_PTR(lines),
+      MPY_BIND_ROM_PTR(points),
+      MPY_BIND_ROM_PTR(plot),
 
       MPY_BIND_ROM_PTR(blur),
       MPY_BIND_ROM_PTR(dither),
+      MPY_BIND_ROM_PTR(quantise),
+      MPY_BIND_ROM_PTR(filter),
+      MPY_BIND_ROM_PTR(shadow),
       MPY_BIND_ROM_PTR(monochrome),
       MPY_BIND_ROM_PTR(onebit),
 
@@ -561,15 +1541,55 @@ MPY_BIND_LOCALS_DICT(image,
       // text
       MPY_BIND_ROM_PTR(text),
       MPY_BIND_ROM_PTR(measure_text),
+      MPY_BIND_ROM_PTR(text_layout),
 
       // blitting
       MPY_BIND_ROM_PTR(vspan_tex),
+      MPY_BIND_ROM_PTR(vspans_tex),
       MPY_BIND_ROM_PTR(blit),
+      MPY_BIND_ROM_PTR(blit_many),
+      MPY_BIND_ROM_PTR(mask),
+      MPY_BIND_ROM_PTR(compile),
 
       // TODO: Just define these in MicroPython?
+      { MP_ROM_QSTR(MP_QSTR_ANALYTIC), MP_ROM_INT(antialias_t::ANALYTIC)},
       { MP_ROM_QSTR(MP_QSTR_X4), MP_ROM_INT(antialias_t::X4)},
       { MP_ROM_QSTR(MP_QSTR_X2), MP_ROM_INT(antialias_t::X2)},
       { MP_ROM_QSTR(MP_QSTR_OFF), MP_ROM_INT(antialias_t::OFF)},
+
+      { MP_ROM_QSTR(MP_QSTR_FLOAT), MP_ROM_INT(rasteriser_t::FLOAT)},
+      { MP_ROM_QSTR(MP_QSTR_FIXED), MP_ROM_INT(rasteriser_t::FIXED)},
+
+      { MP_ROM_QSTR(MP_QSTR_SRAM), MP_ROM_INT(memory_t::MEMORY_SRAM)},
+      { MP_ROM_QSTR(MP_QSTR_PSRAM), MP_ROM_INT(memory_t::MEMORY_PSRAM)},
+      { MP_ROM_QSTR(MP_QSTR_FLASH), MP_ROM_INT(memory_t::MEMORY_FLASH)},
+
+      { MP_ROM_QSTR(MP_QSTR_BLUR_IIR), MP_ROM_INT(blur_kernel_t::BLUR_IIR)},
+      { MP_ROM_QSTR(MP_QSTR_BLUR_BOX), MP_ROM_INT(blur_kernel_t::BLUR_BOX)},
+
+      { MP_ROM_QSTR(MP_QSTR_QUANTISE_NONE), MP_ROM_INT(quantise_t::QUANTISE_NONE)},
+      { MP_ROM_QSTR(MP_QSTR_QUANTISE_ORDERED), MP_ROM_INT(quantise_t::QUANTISE_ORDERED)},
+      { MP_ROM_QSTR(MP_QSTR_QUANTISE_FLOYD_STEINBERG), MP_ROM_INT(quantise_t::QUANTISE_FLOYD_STEINBERG)},
+      { MP_ROM_QSTR(MP_QSTR_QUANTISE_ATKINSON), MP_ROM_INT(quantise_t::QUANTISE_ATKINSON)},
+
+      { MP_ROM_QSTR(MP_QSTR_FILTER_MONOCHROME), MP_ROM_INT(filter_stage_t::MONOCHROME)},
+      { MP_ROM_QSTR(MP_QSTR_FILTER_ONEBIT), MP_ROM_INT(filter_stage_t::ONEBIT)},
+      { MP_ROM_QSTR(MP_QSTR_FILTER_DITHER), MP_ROM_INT(filter_stage_t::DITHER)},
+      { MP_ROM_QSTR(MP_QSTR_FILTER_BLUR), MP_ROM_INT(filter_stage_t::BLUR)},
+
+      { MP_ROM_QSTR(MP_QSTR_PLOT_LINE), MP_ROM_INT(plot_mode_t::PLOT_LINE)},
+      { MP_ROM_QSTR(MP_QSTR_PLOT_AREA), MP_ROM_INT(plot_mode_t::PLOT_AREA)},
+      { MP_ROM_QSTR(MP_QSTR_PLOT_BARS), MP_ROM_INT(plot_mode_t::PLOT_BARS)},
+
+      { MP_ROM_QSTR(MP_QSTR_UNKNOWN), MP_ROM_INT(transparency_t::TRANSPARENCY_UNKNOWN)},
+      { MP_ROM_QSTR(MP_QSTR_OPAQUE), MP_ROM_INT(transparency_t::OPAQUE)},
+      { MP_ROM_QSTR(MP_QSTR_BINARY_ALPHA), MP_ROM_INT(transparency_t::BINARY_ALPHA)},
+      { MP_ROM_QSTR(MP_QSTR_TRANSLUCENT), MP_ROM_INT(transparency_t::TRANSLUCENT)},
+
+      { MP_ROM_QSTR(MP_QSTR_RGBA8888), MP_ROM_INT(pixel_format_t::RGBA8888)},
+      { MP_ROM_QSTR(MP_QSTR_RGB565), MP_ROM_INT(pixel_format_t::RGB565)},
+      { MP_ROM_QSTR(MP_QSTR_RGBA4444), MP_ROM_INT(pixel_format_t::RGBA4444)},
+      { MP_ROM_QSTR(MP_QSTR_A8), MP_ROM_INT(pixel_format_t::A8)},
 )
 
   MP_DEFINE_CONST_OBJ_TYPE(
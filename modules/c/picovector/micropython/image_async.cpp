@@ -0,0 +1,190 @@
+#include "mp_helpers.hpp"
+#include "picovector.hpp"
+#include "../worker.hpp"
+
+extern "C" {
+
+  #include "py/stream.h"
+  #include "py/runtime.h"
+  #include "extmod/vfs.h"
+
+  /*
+    background image loads. the file is mapped (or read into the heap) and
+    the image allocated here on core0, neither the vfs nor the gc can be
+    touched from core1, then the inflate and unfiltering runs on core1 with
+    a decoder of its own rather than the shared PicoVector_working_buffer.
+    core0 is free to carry on drawing and presenting meanwhile
+
+    one load is in flight at a time, starting another waits for the first
+    to finish decoding. the loader in flight is held as a root pointer so
+    nothing core1 is writing to can be collected from under it, even if the
+    app drops the loader
+  */
+  typedef struct _image_loader_obj_t {
+    mp_obj_base_t base;
+    image_obj_t *image;
+    PNG *png;          // the load's decoder, freed once it has finished
+    uint8_t *buffer;   // the file when it had to be read into the heap
+    size_t buffer_size;
+    png_target_t target;
+    int status;
+    bool done;         // set by core1 once the decode has finished
+  } image_loader_obj_t;
+
+  static bool image_loader_done(image_loader_obj_t *self) {
+    return __atomic_load_n(&self->done, __ATOMIC_ACQUIRE);
+  }
+
+  // runs on core1
+  static void image_loader_task(void *arg) {
+    image_loader_obj_t *self = (image_loader_obj_t *)arg;
+    self->status = pngdec_decode(self->png, &self->target);
+    __atomic_store_n(&self->done, true, __ATOMIC_RELEASE);
+  }
+
+  // back on core0 once the decode is done, works out the transparency the
+  // way image.load() does and lets go of the decoder and file
+  static void image_loader_finish(image_loader_obj_t *self) {
+    PV_ALLOC_SCOPE(PV_ALLOC_IMAGE);
+    if(!self->png) {
+      return;
+    }
+
+    PNG *png = self->png;
+    bool opaque = !png->hasAlpha() && (png->getPixelType() == PNG_PIXEL_TRUECOLOR || png->getPixelType() == PNG_PIXEL_GRAYSCALE);
+    self->image->image->transparency(opaque ? OPAQUE : TRANSPARENCY_UNKNOWN);
+    self->image->image->transparency();
+    png->close();
+
+    m_del(PNG, png, 1);
+    self->png = nullptr;
+    if(self->buffer) {
+      m_del(uint8_t, self->buffer, self->buffer_size);
+      self->buffer = nullptr;
+    }
+
+    if(MP_STATE_VM(picovector_image_loader) == MP_OBJ_FROM_PTR(self)) {
+      MP_STATE_VM(picovector_image_loader) = MP_OBJ_NULL;
+    }
+  }
+
+  // blocks until the load has finished, whether or not anyone polled it
+  static void image_loader_wait(image_loader_obj_t *self) {
+    if(!image_loader_done(self) && core1_worker) {
+      core1_worker->wait();
+    }
+    image_loader_finish(self);
+  }
+
+  mp_obj_t image_load_async(mp_obj_t path, pixel_format_t pixel_format) {
+    PV_ALLOC_SCOPE(PV_ALLOC_IMAGE);
+    // any load still in flight has to finish before core1 takes another
+    if(MP_STATE_VM(picovector_image_loader) != MP_OBJ_NULL) {
+      image_loader_wait((image_loader_obj_t *)MP_OBJ_TO_PTR(MP_STATE_VM(picovector_image_loader)));
+    }
+
+    image_loader_obj_t *self = mp_obj_malloc(image_loader_obj_t, &type_image_loader);
+    self->image = mp_obj_malloc_with_finaliser(image_obj_t, &type_image);
+    self->png = nullptr;
+    self->buffer = nullptr;
+    self->status = PNG_SUCCESS;
+    self->done = true;
+
+    // pre-decoded images are ready as soon as they're loaded
+    size_t len;
+    const char *name = mp_obj_str_get_data(path, &len);
+    if(len > 4 && strcmp(name + len - 4, ".pvi") == 0) {
+      self->image->image = pvi_load(path);
+      return MP_OBJ_FROM_PTR(self);
+    }
+
+    size_t size;
+    const uint8_t *data = pv_map_file(path, &size);
+    if(!data) {
+      mp_obj_t stat = mp_vfs_stat(path);
+      size = mp_obj_get_int(((mp_obj_tuple_t *)MP_OBJ_TO_PTR(stat))->items[6]);
+
+      mp_obj_t args[2] = {path, MP_ROM_QSTR(MP_QSTR_rb)};
+      mp_obj_t file = mp_vfs_open(MP_ARRAY_SIZE(args), &args[0], (mp_map_t *)&mp_const_empty_map);
+      self->buffer = m_new(uint8_t, size);
+      self->buffer_size = size;
+      int error;
+      size_t read = mp_stream_read_exactly(file, self->buffer, size, &error);
+      mp_stream_close(file);
+      if(read != size) {
+        mp_raise_msg(&mp_type_OSError, MP_ERROR_TEXT("failed to load image, file is truncated"));
+      }
+      data = self->buffer;
+    }
+
+    self->png = new(m_new(PNG, 1)) PNG();
+    if(self->png->openRAM((uint8_t *)data, size, pngdec_decode_callback) != PNG_SUCCESS) {
+      mp_raise_msg(&mp_type_OSError, MP_ERROR_TEXT("failed to load image, not a valid PNG"));
+    }
+
+    PNG *png = self->png;
+    bool has_palette = png->getPixelType() == PNG_PIXEL_INDEXED && pixel_format != A8;
+    self->image->image = new(m_malloc(sizeof(image_t))) image_t(png->getWidth(), png->getHeight(), has_palette ? RGBA8888 : pixel_format, has_palette);
+    self->target = {self->image->image, 0, 0, false};
+
+    self->done = false;
+    if(core1_worker) {
+      MP_STATE_VM(picovector_image_loader) = MP_OBJ_FROM_PTR(self);
+      core1_worker->run(image_loader_task, self);
+    }else{
+      // nothing to hand it to, decode it now
+      image_loader_task(self);
+      image_loader_finish(self);
+    }
+    return MP_OBJ_FROM_PTR(self);
+  }
+
+  MPY_BIND_ATTR(image_loader, {
+    self(self_in, image_loader_obj_t);
+
+    action_t action = m_attr_action(dest);
+
+    switch(attr) {
+      // loader.ready is true once the image has been decoded
+      case MP_QSTR_ready: {
+        if(action == GET) {
+          bool ready = image_loader_done(self);
+          if(ready) {
+            image_loader_finish(self);
+          }
+          dest[0] = mp_obj_new_bool(ready);
+          return;
+        }
+      };
+
+      // loader.result is the image, waiting for it if it isn't ready yet
+      case MP_QSTR_result: {
+        if(action == GET) {
+          image_loader_wait(self);
+          if(self->status != PNG_SUCCESS) {
+            mp_raise_msg(&mp_type_OSError, MP_ERROR_TEXT("failed to load image, decoding failed"));
+          }
+          dest[0] = MP_OBJ_FROM_PTR(self->image);
+          return;
+        }
+      };
+    }
+
+    // we didn't handle this, fall back to alternative methods
+    dest[1] = MP_OBJ_SENTINEL;
+  })
+
+  static void image_loader_print(const mp_print_t *print, mp_obj_t self_in, mp_print_kind_t kind) {
+    self(self_in, image_loader_obj_t);
+    mp_printf(print, "image_loader(%s)", image_loader_done(self) ? "ready" : "loading");
+  }
+
+  MP_DEFINE_CONST_OBJ_TYPE(
+      type_image_loader,
+      MP_QSTR_image_loader,
+      MP_TYPE_FLAG_NONE,
+      print, (const void *)image_loader_print,
+      attr, (const void *)image_loader_attr
+  );
+
+}
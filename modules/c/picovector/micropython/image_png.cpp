@@ -1,5 +1,11 @@
 #include "mp_helpers.hpp"
 #include "picovector.hpp"
+#include "assets.hpp"
+#include "../profile.hpp"
+
+// built in assets are only there when assets.cpp is linked into the build
+extern const asset_t *assets[] __attribute__((weak));
+extern const size_t asset_count __attribute__((weak));
 
 extern "C" {
 
@@ -15,232 +21,320 @@ extern "C" {
   void *pngdec_open_callback(const char *filename, int32_t *size) {
     mp_obj_t fn = mp_obj_new_str(filename, (mp_uint_t)strlen(filename));
 
-    mp_obj_t args[2] = {
-        fn,
-        MP_ROM_QSTR(MP_QSTR_r),
-    };
-
     // Stat the file to get its size
     // example tuple response: (32768, 0, 0, 0, 0, 0, 5153, 1654709815, 1654709815, 1654709815)
     mp_obj_t stat = mp_vfs_stat(fn);
     mp_obj_tuple_t *tuple = (mp_obj_tuple_t*)MP_OBJ_TO_PTR(stat);
     *size = mp_obj_get_int(tuple->items[6]);
 
+    // pngdec_open only gets here for files that can't be mapped
     png_handle_t *png_handle = (png_handle_t *)m_tracked_calloc(1, sizeof(png_handle_t));
-    png_handle->fhandle = mp_vfs_open(MP_ARRAY_SIZE(args), &args[0], (mp_map_t *)&mp_const_empty_map);
+    pv_reader_open_stream(&png_handle->reader, fn);
 
     return (void *)png_handle;
   }
 
   void pngdec_close_callback(void *handle) {
     png_handle_t *png_handle = (png_handle_t *)(handle);
-    mp_stream_close(png_handle->fhandle);
+    pv_reader_close(&png_handle->reader);
     m_tracked_free(handle);
   }
 
   int32_t pngdec_read_callback(PNGFILE *png, uint8_t *p, int32_t c) {
     png_handle_t *png_handle = (png_handle_t *)(png->fHandle);
-    int error;
-    return mp_stream_read_exactly(png_handle->fhandle, p, c, &error);
+    return pv_reader_read(&png_handle->reader, p, c);
   }
 
-  // Re-implementation of stream.c/static mp_obj_t stream_seek(size_t n_args, const mp_obj_t *args)
   int32_t pngdec_seek_callback(PNGFILE *png, int32_t p) {
     png_handle_t *png_handle = (png_handle_t *)(png->fHandle);
-    struct mp_stream_seek_t seek_s;
-    seek_s.offset = p;
-    seek_s.whence = SEEK_SET;
+    return pv_reader_seek(&png_handle->reader, p);
+  }
 
-    const mp_stream_p_t *stream_p = mp_get_stream(png_handle->fhandle);
+  const uint8_t *pv_map_file(mp_obj_t path, size_t *size) {
+    const char *name = mp_obj_str_get_str(path);
+    if(&asset_count) {
+      for(size_t i = 0; i < asset_count; i++) {
+        // asset names are rooted at "root", as in "root/system/assets/..."
+        if(strcmp(assets[i]->name + 4, name) == 0) {
+          *size = assets[i]->length;
+          return assets[i]->data;
+        }
+      }
+    }
 
-    int error;
-    mp_uint_t res = stream_p->ioctl(png_handle->fhandle, MP_STREAM_SEEK, (mp_uint_t)(uintptr_t)&seek_s, &error);
-    if (res == MP_STREAM_ERROR) {
-        mp_raise_msg_varg(&mp_type_OSError, MP_ERROR_TEXT("PNG: seek failed with %d"), error);
+    // romfs files lend out their bytes in flash through the buffer
+    // protocol, and stay mapped after the file is closed
+    mp_obj_t args[2] = {path, MP_ROM_QSTR(MP_QSTR_rb)};
+    mp_obj_t file = mp_vfs_open(MP_ARRAY_SIZE(args), &args[0], (mp_map_t *)&mp_const_empty_map);
+    mp_buffer_info_t bufinfo;
+    bool mapped = mp_get_buffer(file, &bufinfo, MP_BUFFER_READ);
+    mp_stream_close(file);
+    if(!mapped) {
+      return nullptr;
     }
+    *size = bufinfo.len;
+    return (const uint8_t *)bufinfo.buf;
+  }
 
-    return seek_s.offset;
+  int pngdec_open(PNG *png, mp_obj_t path) {
+    size_t size;
+    if(const uint8_t *data = pv_map_file(path, &size)) {
+      return png->openRAM((uint8_t *)data, size, pngdec_decode_callback);
+    }
+    return png->open(mp_obj_str_get_str(path), pngdec_open_callback, pngdec_close_callback, pngdec_read_callback, pngdec_seek_callback, pngdec_decode_callback);
   }
 
-  void pngdec_decode_callback(PNGDRAW *pDraw) {
-    image_t *target = (image_t *)pDraw->pUser;
+  // decoded pixels are rgba8888 and stored in whatever format the target is
+  static inline void pngdec_store(image_t *target, uint8_t *p, uint32_t c) {
+    if(target->has_palette()) {
+      *p = target->palette_index(c);
+      return;
+    }
+    switch(target->pixel_format()) {
+      case RGB565: *(uint16_t *)p = _rgba8888_to_rgb565(c); break;
+      case RGBA4444: *(uint16_t *)p = _rgba8888_to_rgba4444(c); break;
+      case A8: *p = _a(c); break;
+      default: *(uint32_t *)p = c; break;
+    }
+  }
 
-    uint8_t *psrc = (uint8_t *)pDraw->pPixels;
-    int w = pDraw->iWidth;
+  // the same rounding as rgb_color_t, without building one per pixel
+  static inline uint32_t pngdec_premul(uint32_t r, uint32_t g, uint32_t b, uint32_t a) {
+    if(a == 255) {
+      return r | (g << 8) | (b << 16) | 0xff000000u;
+    }
+    return ((r * a) / 255) | (((g * a) / 255) << 8) | (((b * a) / 255) << 16) | (a << 24);
+  }
 
+  // set up on the first row, since pngdec only reads the chunks after the
+  // header as it decodes. indexed pngs look their pixels up in the palette
+  // and grayscale ones in a table of grey levels. pngdec only keeps the low
+  // byte of each channel of a transparent colour, which is all of it at the
+  // bit depths it decodes
+  static void pngdec_setup(PNGDRAW *pDraw, png_target_t *t) {
+    bool keyed = pDraw->iHasAlpha && pDraw->iPixelType != PNG_PIXEL_INDEXED;
+    t->transparent = keyed ? int32_t(t->png->getTransparentColor()) : -1;
+
+    if(pDraw->iPixelType == PNG_PIXEL_INDEXED) {
+      const uint8_t *p = pDraw->pPalette;
+      for(int i = 0; i < 256; i++) {
+        t->lut[i] = pngdec_premul(p[i * 3 + 0], p[i * 3 + 1], p[i * 3 + 2], pDraw->iHasAlpha ? p[768 + i] : 255);
+      }
+    }else if(pDraw->iPixelType == PNG_PIXEL_GRAYSCALE) {
+      int levels = (1 << pDraw->iBpp) - 1;
+      for(int i = 0; i <= levels; i++) {
+        uint32_t v = i * 255 / levels;
+        t->lut[i] = v | (v << 8) | (v << 16) | 0xff000000u;
+      }
+      if(t->transparent >= 0 && t->transparent <= levels) {
+        t->lut[t->transparent] = 0;
+      }else if(t->image->pixel_format() == A8) {
+        // opaque grayscale gives its grey levels as coverage to a8 images,
+        // which then store as white at that coverage
+        for(int i = 0; i <= levels; i++) {
+          t->lut[i] = (t->lut[i] & 0xff) * 0x01010101u;
+        }
+      }
+    }
+    t->ready = true;
+  }
+
+  // the n samples of bpp bits starting at column sx of a packed row
+  template<int BPP>
+  static void pngdec_unpack(const uint8_t *p, int sx, int n, uint8_t *out) {
+    if(BPP == 8) {
+      memcpy(out, p + sx, n);
+      return;
+    }
+    const int per_byte = 8 / BPP;
+    const uint8_t mask = (1 << BPP) - 1;
+    p += sx / per_byte;
+    int shift = 8 - BPP - (sx % per_byte) * BPP;
+    uint8_t byte = *p++;
+    while(n--) {
+      *out++ = (byte >> shift) & mask;
+      shift -= BPP;
+      if(shift < 0) {
+        shift = 8 - BPP;
+        byte = *p++;
+      }
+    }
+  }
+
+  static void pngdec_unpack(PNGDRAW *pDraw, int sx, int n, uint8_t *out) {
+    switch(pDraw->iBpp) {
+      case 1: pngdec_unpack<1>(pDraw->pPixels, sx, n, out); break;
+      case 2: pngdec_unpack<2>(pDraw->pPixels, sx, n, out); break;
+      case 4: pngdec_unpack<4>(pDraw->pPixels, sx, n, out); break;
+      default: pngdec_unpack<8>(pDraw->pPixels, sx, n, out); break;
+    }
+  }
+
+  // converts n decoded pixels from column sx of the row to rgba8888, n is
+  // at most the 64 that callers convert at a time
+  static bool pngdec_convert(PNGDRAW *pDraw, png_target_t *t, int sx, int n, uint32_t *out) {
+    uint8_t *psrc = (uint8_t *)pDraw->pPixels;
     switch(pDraw->iPixelType) {
       case PNG_PIXEL_TRUECOLOR: {
-        uint32_t *pdst = (uint32_t *)target->ptr(0, pDraw->y);
-        while(w--) {
-          rgb_color_t c(psrc[0], psrc[1], psrc[2], 255);
-          *pdst = c._p;
-          psrc += 3;
-          pdst++;
+        psrc += sx * 3;
+        if(t->transparent >= 0) {
+          // a single colour may be marked transparent
+          while(n--) {
+            uint32_t rgb = (psrc[0] << 16) | (psrc[1] << 8) | psrc[2];
+            *out++ = rgb == uint32_t(t->transparent) ? 0 : pngdec_premul(psrc[0], psrc[1], psrc[2], 255);
+            psrc += 3;
+          }
+        }else{
+          while(n--) {
+            *out++ = psrc[0] | (psrc[1] << 8) | (psrc[2] << 16) | 0xff000000u;
+            psrc += 3;
+          }
         }
       } break;
 
       case PNG_PIXEL_TRUECOLOR_ALPHA: {
-        uint32_t *pdst = (uint32_t *)target->ptr(0, pDraw->y);
-        while(w--) {
-          rgb_color_t c(psrc[0], psrc[1], psrc[2], psrc[3]);
-          *pdst = c._p;
+        psrc += sx * 4;
+        while(n--) {
+          *out++ = pngdec_premul(psrc[0], psrc[1], psrc[2], psrc[3]);
           psrc += 4;
-          pdst++;
         }
       } break;
 
-      case PNG_PIXEL_INDEXED: {
-        if(target->has_palette()) {
-          for(int i = 0; i < 256; i++) {
-            rgb_color_t c(
-              pDraw->pPalette[i * 3 + 0],
-              pDraw->pPalette[i * 3 + 1],
-              pDraw->pPalette[i * 3 + 2],
-              pDraw->iHasAlpha ? pDraw->pPalette[768 + i] : 255
-            );
-            target->palette(i, c._p);
-          }
-
-          uint8_t *pdst = (uint8_t *)target->ptr(0, pDraw->y);
-          while(w--) {
-            *pdst = *psrc;
-            pdst++;
-            psrc++;
-          }
-        } else {
-          uint32_t *pdst = (uint32_t *)target->ptr(0, pDraw->y);
-          while(w--) {
-            *pdst = rgb_color_t(
-              pDraw->pPalette[*psrc * 3 + 0],
-              pDraw->pPalette[*psrc * 3 + 1],
-              pDraw->pPalette[*psrc * 3 + 2],
-              pDraw->iHasAlpha ? pDraw->pPalette[768 + *psrc] : 255
-            )._p;
-            psrc++;
-            pdst++;
-          }
+      case PNG_PIXEL_GRAY_ALPHA: {
+        psrc += sx * 2;
+        while(n--) {
+          *out++ = pngdec_premul(psrc[0], psrc[0], psrc[0], psrc[1]);
+          psrc += 2;
         }
       } break;
-      /*
-      case PNG_PIXEL_GRAYSCALE: {
-        uint32_t *pdst = (uint32_t *)target->ptr(0, pDraw->y);
-        while(w--) {
-          uint8_t src = *psrc;
-          // do something with index here
-
-          switch(pDraw->iBpp) {
-            case 8: {
-              *pdst = rgba(src, src, src);
-              pdst++;
-            } break;
-
-            case 4: {
-              int src1 = (src & 0xf0) | ((src & 0xf0) >> 4);
-              int src2 = (src & 0x0f) | ((src & 0x0f) << 4);
-              *pdst = rgba(src1, src1, src1);
-              pdst++;
-              *pdst = rgba(src2, src2, src2);
-              pdst++;
-            } break;
-
-            case 1: {
-              for(int i = 0; i < 8; i++) {
-                int v = src & 0b10000000 ? 255 : 0;
-                *pdst = rgba(v, v, v);
-                pdst++;
-                src <<= 1;
-              }
-            } break;
-          }
 
-          psrc++;
+      case PNG_PIXEL_INDEXED:
+      case PNG_PIXEL_GRAYSCALE: {
+        uint8_t index[64];
+        pngdec_unpack(pDraw, sx, n, index);
+        for(int i = 0; i < n; i++) {
+          out[i] = t->lut[index[i]];
         }
       } break;
-       */
 
       default: {
         // TODO: raise file not supported error
-      } break;
+        return false;
+      }
     }
+    return true;
+  }
 
-//     } else if (pDraw->iPixelType == PNG_PIXEL_INDEXED) {
-//         for(int x = 0; x < pDraw->iWidth; x++) {
-//             uint8_t i = 0;
-//             if(pDraw->iBpp == 8) {  // 8bpp
-//                 i = *pixel++;
-//             } else if (pDraw->iBpp == 4) {  // 4bpp
-//                 i = *pixel;
-//                 i >>= (x & 0b1) ? 0 : 4;
-//                 i &= 0xf;
-//                 if (x & 1) pixel++;
-//             } else if (pDraw->iBpp == 2) {  // 2bpp
-//                 i = *pixel;
-//                 i >>= 6 - ((x & 0b11) << 1);
-//                 i &= 0x3;
-//                 if ((x & 0b11) == 0b11) pixel++;
-//             } else {  // 1bpp
-//                 i = *pixel;
-//                 i >>= 7 - (x & 0b111);
-//                 i &= 0b1;
-//                 if ((x & 0b111) == 0b111) pixel++;
-//             }
-//             if(x < target->source.x || x >= target->source.x + target->source.w) continue;
-//             // grab the colour from the palette
-//             uint8_t r = pDraw->pPalette[(i * 3) + 0];
-//             uint8_t g = pDraw->pPalette[(i * 3) + 1];
-//             uint8_t b = pDraw->pPalette[(i * 3) + 2];
-//             uint8_t a = pDraw->iHasAlpha ? pDraw->pPalette[768 + i] : 1;
-//             if (a) {
-//                 if (current_graphics->pen_type == PicoGraphics::PEN_RGB332) {
-//                     if (current_mode == MODE_POSTERIZE || current_mode == MODE_COPY) {
-//                         // Posterized output to RGB332
-//                         current_graphics->set_pen(RGB(r, g, b).to_rgb332());
-//                         current_graphics->rectangle({current_position.x, current_position.y, scale.x, scale.y});
-//                     } else {
-//                         // Dithered output to RGB332
-//                         for(auto px = 0; px < scale.x; px++) {
-//                             for(auto py = 0; py < scale.y; py++) {
-//                                 current_graphics->set_pixel_dither(current_position + Point{px, py}, {r, g, b});
-//                             }
-//                         }
-//                     }
-//                 } else if(current_graphics->pen_type == PicoGraphics::PEN_P8
-//                     || current_graphics->pen_type == PicoGraphics::PEN_P4
-//                     || current_graphics->pen_type == PicoGraphics::PEN_3BIT
-//                     || current_graphics->pen_type == PicoGraphics::PEN_INKY7) {
+  // sums the row into the boxes it crosses, then stores their averages once
+  // the last row of a box (or of the png) has arrived. premultiplied
+  // channels average correctly as they are
+  static void pngdec_downscale(PNGDRAW *pDraw, png_target_t *t) {
+    image_t *target = t->image;
+    int f = 1 << t->shift;
+    int w = min((pDraw->iWidth + f - 1) >> t->shift, int(target->bounds().w));
+
+    const int chunk = 64;
+    uint32_t row[chunk];
+    for(int sx = 0; sx < pDraw->iWidth; sx += chunk) {
+      int n = min(pDraw->iWidth - sx, chunk);
+      if(!pngdec_convert(pDraw, t, sx, n, row)) return;
+      for(int i = 0; i < n; i++) {
+        uint16_t *a = t->acc + ((sx + i) >> t->shift) * 4;
+        uint32_t c = row[i];
+        a[0] += _r(c);
+        a[1] += _g(c);
+        a[2] += _b(c);
+        a[3] += _a(c);
+      }
+    }
 
-//                         // Copy raw palette indexes over
-//                         if(current_mode == MODE_COPY) {
-//                             if(current_palette_offset > 0) {
-//                                 i = ((int16_t)(i) + current_palette_offset) & 0xff;
-//                             }
-//                             current_graphics->set_pen(i);
-//                             current_graphics->rectangle({current_position.x, current_position.y, scale.x, scale.y});
-//                         // Posterized output to the available palete
-//                         } else if(current_mode == MODE_POSTERIZE) {
-//                             int closest = RGB(r, g, b).closest(current_graphics->get_palette(), current_graphics->get_palette_size());
-//                             if (closest == -1) {
-//                                 closest = 0;
-//                             }
-//                             current_graphics->set_pen(closest);
-//                             current_graphics->rectangle({current_position.x, current_position.y, scale.x, scale.y});
-//                         } else {
-//                             for(auto px = 0; px < scale.x; px++) {
-//                                 for(auto py = 0; py < scale.y; py++) {
-//                                     current_graphics->set_pixel_dither(current_position + Point{px, py}, {r, g, b});
-//                                 }
-//                             }
-//                         }
-//                 } else {
-//                     current_graphics->set_pen(r, g, b);
-//                     current_graphics->rectangle({current_position.x, current_position.y, scale.x, scale.y});
-//                 }
-//             }
-//             current_position += step;
-//         }
-//     }
+    int rows = (pDraw->y & (f - 1)) + 1;
+    if(rows < f && pDraw->y < t->png->getHeight() - 1) return;
+
+    int y = pDraw->y >> t->shift;
+    if(y < target->bounds().h) {
+      uint8_t *pdst = (uint8_t *)target->ptr(0, y);
+      size_t bpp = target->bytes_per_pixel();
+      for(int x = 0; x < w; x++) {
+        // boxes along the right and bottom edges may be cut short
+        uint32_t count = min(f, pDraw->iWidth - x * f) * rows;
+        uint16_t *a = t->acc + x * 4;
+        uint32_t c = ((a[0] + count / 2) / count) | (((a[1] + count / 2) / count) << 8) |
+                     (((a[2] + count / 2) / count) << 16) | (((a[3] + count / 2) / count) << 24);
+        pngdec_store(target, pdst, c);
+        pdst += bpp;
+      }
+    }
+    memset(t->acc, 0, ((pDraw->iWidth + f - 1) >> t->shift) * 4 * sizeof(uint16_t));
+  }
+
+  int pngdec_decode(PNG *png, png_target_t *target) {
+    profile_scope_t profile(PROFILE_PNG, png->getWidth() * png->getHeight());
+    target->png = png;
+    target->ready = false;
+    return png->decode((void *)target, 0);
+  }
+
+  void pngdec_decode_callback(PNGDRAW *pDraw) {
+    png_target_t *t = (png_target_t *)pDraw->pUser;
+    image_t *target = t->image;
+
+    if(!t->ready) {
+      pngdec_setup(pDraw, t);
+    }
+
+    if(t->shift) {
+      pngdec_downscale(pDraw, t);
+      return;
+    }
+
+    // indexed pngs copied into an indexed image bring their palette along
+    // and their indices are written as they are
+    bool copy_indices = pDraw->iPixelType == PNG_PIXEL_INDEXED && target->has_palette() && !t->blend;
+    if(copy_indices && pDraw->y == 0) {
+      for(int i = 0; i < 256; i++) {
+        target->palette(i, t->lut[i]);
+      }
+    }
+
+    // the part of the row that lands inside the target's clip
+    rect_t c = target->clip().intersection(target->bounds());
+    int y = t->y + pDraw->y;
+    if(y < c.y || y >= c.y + c.h) return;
+    int x = max(t->x, int(c.x));
+    int w = min(t->x + pDraw->iWidth, int(c.x + c.w)) - x;
+    if(w <= 0) return;
+    int sx = x - t->x;
+
+    if(copy_indices) {
+      pngdec_unpack(pDraw, sx, w, (uint8_t *)target->ptr(x, y));
+      return;
+    }
+
+    // converted a chunk at a time on the stack, blending goes through the
+    // blit kernels with the chunk wrapped as a one row image
+    const int chunk = 64;
+    uint32_t row[chunk];
+    size_t bpp = target->bytes_per_pixel();
+    while(w > 0) {
+      int n = min(w, chunk);
+      if(!pngdec_convert(pDraw, t, sx, n, row)) return;
+
+      if(t->blend) {
+        image_t src(row, n, 1);
+        src.blit(target, vec2_t(x, y));
+      }else{
+        uint8_t *pdst = (uint8_t *)target->ptr(x, y);
+        for(int i = 0; i < n; i++) {
+          pngdec_store(target, pdst, row[i]);
+          pdst += bpp;
+        }
+      }
 
-    // samples of other pixel formats at end of file...
+      x += n;
+      sx += n;
+      w -= n;
+    }
   }
 }
 
@@ -0,0 +1,131 @@
+#include "mp_helpers.hpp"
+#include "picovector.hpp"
+
+extern "C" {
+
+  #include "py/stream.h"
+  #include "py/runtime.h"
+  #include "extmod/vfs.h"
+
+  /*
+    .pvi files hold pixels exactly as an image_t stores them, so they load
+    without decoding. all fields are little endian
+
+      0   "pvi!"
+      4   u8  version, 1
+      5   u8  pixel format, as pixel_format_t
+      6   u8  flags, bit 0 set for indexed images
+      7   u8  transparency, as transparency_t (0 if not known)
+      8   u16 width
+      10  u16 height
+      12  u16 palette entries, up to 256
+      14  u16 reserved
+      16  palette, premultiplied rgba8888 words
+          pixels, rows packed top to bottom
+
+    see tools/png2pvi.py
+  */
+  typedef struct _pvi_header_t {
+    char marker[4];
+    uint8_t version;
+    uint8_t pixel_format;
+    uint8_t flags;
+    uint8_t transparency;
+    uint16_t width;
+    uint16_t height;
+    uint16_t palette_count;
+    uint16_t reserved;
+  } pvi_header_t;
+
+  // an open file is closed before raising so it isn't left to the gc
+  MP_NORETURN static void pvi_error(mp_obj_t file, mp_rom_error_text_t message) {
+    if(file != MP_OBJ_NULL) {
+      mp_stream_close(file);
+    }
+    mp_raise_msg(&mp_type_OSError, message);
+  }
+
+  static void pvi_check(const pvi_header_t *header, mp_obj_t file) {
+    if(memcmp(header->marker, "pvi!", 4) != 0 || header->version != 1) {
+      pvi_error(file, MP_ERROR_TEXT("failed to load image, missing PVI header"));
+    }
+    if(header->pixel_format != RGBA8888 && header->pixel_format != RGB565 && header->pixel_format != RGBA4444 && header->pixel_format != A8) {
+      pvi_error(file, MP_ERROR_TEXT("failed to load image, unsupported pixel format"));
+    }
+    if(header->transparency > TRANSLUCENT || header->palette_count > 256) {
+      pvi_error(file, MP_ERROR_TEXT("failed to load image, invalid header"));
+    }
+  }
+
+  static size_t pvi_pixels_size(const pvi_header_t *header) {
+    return size_t(header->width) * header->height * image_t::bytes_per_pixel(pixel_format_t(header->pixel_format), header->flags & 1);
+  }
+
+  image_t *pvi_load(mp_obj_t path) {
+    PV_ALLOC_SCOPE(PV_ALLOC_IMAGE);
+    pvi_header_t header;
+    image_t *image;
+
+    size_t size;
+    if(const uint8_t *data = pv_map_file(path, &size)) {
+      if(size < sizeof(header)) {
+        pvi_error(MP_OBJ_NULL, MP_ERROR_TEXT("failed to load image, missing PVI header"));
+      }
+      memcpy(&header, data, sizeof(header));
+      pvi_check(&header, MP_OBJ_NULL);
+
+      const uint8_t *palette = data + sizeof(header);
+      const uint8_t *pixels = palette + header.palette_count * sizeof(uint32_t);
+      size_t pixels_size = pvi_pixels_size(&header);
+      if(size_t(pixels - data) + pixels_size > size) {
+        pvi_error(MP_OBJ_NULL, MP_ERROR_TEXT("failed to load image, file is truncated"));
+      }
+
+      pixel_format_t pixel_format = pixel_format_t(header.pixel_format);
+      bool has_palette = header.flags & 1;
+      if((uintptr_t(pixels) & 3) == 0) {
+        // used in place, the pixels are never copied out of flash. writing
+        // to an image made this way isn't possible, it must be read only
+        image = new(m_malloc(sizeof(image_t))) image_t((void *)pixels, header.width, header.height, pixel_format, has_palette);
+      }else{
+        image = new(m_malloc(sizeof(image_t))) image_t(header.width, header.height, pixel_format, has_palette);
+        memcpy(image->ptr(0, 0), pixels, pixels_size);
+      }
+
+      for(int i = 0; i < header.palette_count; i++) {
+        uint32_t c;
+        memcpy(&c, palette + i * sizeof(uint32_t), sizeof(c));
+        image->palette(i, c);
+      }
+    }else{
+      mp_obj_t args[2] = {path, MP_ROM_QSTR(MP_QSTR_rb)};
+      mp_obj_t file = mp_vfs_open(MP_ARRAY_SIZE(args), &args[0], (mp_map_t *)&mp_const_empty_map);
+
+      int error;
+      if(mp_stream_read_exactly(file, &header, sizeof(header), &error) != sizeof(header)) {
+        pvi_error(file, MP_ERROR_TEXT("failed to load image, missing PVI header"));
+      }
+      pvi_check(&header, file);
+
+      uint32_t palette[256];
+      size_t palette_size = header.palette_count * sizeof(uint32_t);
+      size_t pixels_size = pvi_pixels_size(&header);
+      image = new(m_malloc(sizeof(image_t))) image_t(header.width, header.height, pixel_format_t(header.pixel_format), header.flags & 1);
+      bool truncated = mp_stream_read_exactly(file, palette, palette_size, &error) != palette_size ||
+                       mp_stream_read_exactly(file, image->ptr(0, 0), pixels_size, &error) != pixels_size;
+      if(truncated) {
+        m_del_class(image_t, image);
+        pvi_error(file, MP_ERROR_TEXT("failed to load image, file is truncated"));
+      }
+      mp_stream_close(file);
+
+      for(int i = 0; i < header.palette_count; i++) {
+        image->palette(i, palette[i]);
+      }
+    }
+
+    image->transparency(transparency_t(header.transparency));
+    return image;
+  }
+
+}
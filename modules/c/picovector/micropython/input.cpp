@@ -1,5 +1,7 @@
 #ifdef PICO
 #include "pico/stdlib.h"
+#include "hardware/gpio.h"
+#include "hardware/sync.h"
 #endif
 
 #include "mp_helpers.hpp"
@@ -15,6 +17,7 @@
 extern "C" {
   #include "py/runtime.h"
   #include "py/mphal.h"
+  #include "py/smallint.h"
 
 mp_obj_t ticks;
 
@@ -24,12 +27,110 @@ mp_obj_t ticks;
   mp_uint_t picovector_ticks;
   mp_uint_t picovector_last_ticks;
 
+  // pressed and released for the current frame, edges caught between polls
+  // included so a tap shorter than a frame still shows up in both
+  static uint8_t picovector_pressed_buttons;
+  static uint8_t picovector_released_buttons;
+
   extern uint32_t powman_get_user_switches(void);
+
+  // every button edge is caught by the gpio irq and queued with the time it
+  // happened, io.events() drains the queue. the irq only ever writes head
+  // and python only ever writes tail so neither needs a lock
+  #define INPUT_QUEUE_SIZE 32
+  static_assert((INPUT_QUEUE_SIZE & (INPUT_QUEUE_SIZE - 1)) == 0, "INPUT_QUEUE_SIZE must be a power of two");
+
+  // edges closer together than this on one button are contact bounce
+  #define INPUT_DEBOUNCE_US 3000
+
+  #define INPUT_PINS (BW_SWITCH_MASK | (1 << BW_SWITCH_HOME))
+
+  struct input_event_t {
+    uint32_t time_us;
+    uint8_t button;
+    bool pressed;
+  };
+
+  static input_event_t input_queue[INPUT_QUEUE_SIZE];
+  static volatile uint32_t input_queue_head = 0;
+  static volatile uint32_t input_queue_tail = 0;
+  static volatile uint32_t input_queue_dropped = 0;
+
+  // set by the irq, taken and cleared by io.poll()
+  static volatile uint8_t input_irq_pressed = 0;
+  static volatile uint8_t input_irq_released = 0;
+
+  // the queue head as io.poll() last saw it, io.wait() waits for newer edges
+  static uint32_t input_poll_head = 0;
+
+  static uint8_t input_pin_button(uint gpio) {
+    switch(gpio) {
+      case BW_SWITCH_A:    return BUTTON_A;
+      case BW_SWITCH_B:    return BUTTON_B;
+      case BW_SWITCH_C:    return BUTTON_C;
+      case BW_SWITCH_UP:   return BUTTON_UP;
+      case BW_SWITCH_DOWN: return BUTTON_DOWN;
+      case BW_SWITCH_HOME: return BUTTON_HOME;
+      default:             return 0;
+    }
+  }
+
+  static void __not_in_flash_func(input_irq_handler)(void) {
+    static uint32_t last_edge_us[BW_SWITCH_HOME + 1];
+    uint32_t now = time_us_32();
+
+    for(uint gpio = 0; gpio <= BW_SWITCH_HOME; gpio++) {
+      if(!(INPUT_PINS & (1u << gpio))) continue;
+      uint32_t events = gpio_get_irq_event_mask(gpio) & (GPIO_IRQ_EDGE_FALL | GPIO_IRQ_EDGE_RISE);
+      if(!events) continue;
+      gpio_acknowledge_irq(gpio, events);
+
+      if(now - last_edge_us[gpio] < INPUT_DEBOUNCE_US) continue;
+      last_edge_us[gpio] = now;
+
+      // switches pull low when pressed, the level now says which edge won
+      // if both arrived since the last irq
+      uint8_t button = input_pin_button(gpio);
+      bool pressed = !gpio_get(gpio);
+      if(pressed) {
+        input_irq_pressed |= button;
+      }else{
+        input_irq_released |= button;
+      }
+
+      uint32_t head = input_queue_head;
+      if(head - input_queue_tail == INPUT_QUEUE_SIZE) {
+        input_queue_dropped++;
+        continue;
+      }
+      input_queue[head & (INPUT_QUEUE_SIZE - 1)] = {now, button, pressed};
+      __compiler_memory_barrier();
+      input_queue_head = head + 1;
+    }
+  }
+
+  static void input_irq_init() {
+    static bool ready = false;
+    if(ready) return;
+    // ahead of micropython's own pin irq handler, which acknowledges every
+    // pending edge whether it has a callback for it or not
+    gpio_add_raw_irq_handler_with_order_priority_masked(INPUT_PINS, input_irq_handler, PICO_SHARED_IRQ_HANDLER_HIGHEST_ORDER_PRIORITY);
+    for(uint gpio = 0; gpio <= BW_SWITCH_HOME; gpio++) {
+      if(INPUT_PINS & (1u << gpio)) {
+        gpio_set_irq_enabled(gpio, GPIO_IRQ_EDGE_FALL | GPIO_IRQ_EDGE_RISE, true);
+      }
+    }
+    irq_set_enabled(IO_IRQ_BANK0, true);
+    ready = true;
+  }
 #else
   extern uint8_t picovector_buttons;
   extern uint8_t picovector_changed_buttons;
   extern double picovector_ticks;
   extern double picovector_last_ticks;
+
+  #define picovector_pressed_buttons (picovector_buttons & picovector_changed_buttons)
+  #define picovector_released_buttons (~picovector_buttons & picovector_changed_buttons)
 #endif
 
   MPY_BIND_ATTR(input, {
@@ -54,13 +155,13 @@ mp_obj_t ticks;
           buttons = picovector_buttons;
           break;
         case MP_QSTR_pressed:
-          buttons = picovector_buttons & picovector_changed_buttons;
+          buttons = picovector_pressed_buttons;
           break;
         case MP_QSTR_released:
-          buttons = ~picovector_buttons & picovector_changed_buttons;
+          buttons = picovector_released_buttons;
           break;
         case MP_QSTR_changed:
-          buttons = picovector_changed_buttons;
+          buttons = picovector_pressed_buttons | picovector_released_buttons;
           break;
         default:
           break;
@@ -97,9 +198,12 @@ mp_obj_t ticks;
     dest[1] = MP_OBJ_SENTINEL;
   })
 
-  // Call io.poll() to set up frame stable input and tick values
-  MPY_BIND_ARGS0(poll, {
+  // Call io.poll() to set up frame stable input and tick values. io.poll(step)
+  // advances ticks by exactly step ms instead of reading the clock, giving a
+  // fixed timestep that runs slow rather than skipping when frames overrun
+  MPY_BIND_VAR(0, poll, {
 #ifdef PICO
+    input_irq_init();
     uint8_t buttons = 0;
 
     // Feed the switch states from wakeup into `pressed`
@@ -121,17 +225,84 @@ mp_obj_t ticks;
     buttons |= gpio_get(BW_SWITCH_DOWN) ? 0 : BUTTON_DOWN;
     buttons |= gpio_get(BW_SWITCH_HOME) ? 0 : BUTTON_HOME;
 
+    uint32_t irq_state = save_and_disable_interrupts();
+    uint8_t irq_pressed = input_irq_pressed;
+    uint8_t irq_released = input_irq_released;
+    input_irq_pressed = 0;
+    input_irq_released = 0;
+    input_poll_head = input_queue_head;
+    restore_interrupts(irq_state);
+
     picovector_changed_buttons = buttons ^ picovector_buttons;
+    picovector_pressed_buttons = (buttons & picovector_changed_buttons) | irq_pressed;
+    picovector_released_buttons = (~buttons & picovector_changed_buttons) | irq_released;
     picovector_buttons = buttons;
     picovector_last_ticks = picovector_ticks;
-    picovector_ticks = mp_hal_ticks_ms();
+    if(n_args > 0 && args[0] != mp_const_none) {
+      picovector_ticks += mp_obj_get_int(args[0]);
+    }else{
+      picovector_ticks = mp_hal_ticks_ms();
+    }
 #endif
     ticks = mp_obj_new_int_from_ll(picovector_ticks);
     return mp_const_none;
   })
 
+  // io.events() returns the button edges since it was last called, oldest
+  // first, as (button, pressed, time_us) tuples. time_us is the microsecond
+  // clock (time.ticks_us()) when the edge happened
+  MPY_BIND_VAR(0, events, {
+#ifdef PICO
+    input_irq_init();
+    uint32_t tail = input_queue_tail;
+    uint32_t count = input_queue_head - tail;
+    if(count == 0) {
+      return mp_const_empty_tuple;
+    }
+    mp_obj_tuple_t *result = (mp_obj_tuple_t *)MP_OBJ_TO_PTR(mp_obj_new_tuple(count, nullptr));
+    for(uint32_t i = 0; i < count; i++) {
+      const input_event_t &e = input_queue[(tail + i) & (INPUT_QUEUE_SIZE - 1)];
+      mp_obj_t items[3] = {
+        MP_OBJ_NEW_SMALL_INT(e.button),
+        mp_obj_new_bool(e.pressed),
+        MP_OBJ_NEW_SMALL_INT(e.time_us & MP_SMALL_INT_POSITIVE_MASK)
+      };
+      result->items[i] = mp_obj_new_tuple(3, items);
+    }
+    __compiler_memory_barrier();
+    input_queue_tail = tail + count;
+    return MP_OBJ_FROM_PTR(result);
+#else
+    return mp_const_empty_tuple;
+#endif
+  })
+
+  // io.wait(timeout_ms=None) sleeps until a button edge the last io.poll()
+  // didn't see, returns False if timeout_ms passed first. the core sleeps
+  // between interrupts rather than spinning, static screens can wait here
+  // instead of redrawing
+  MPY_BIND_VAR(0, wait, {
+#ifdef PICO
+    input_irq_init();
+    bool forever = n_args == 0 || args[0] == mp_const_none;
+    mp_uint_t timeout = forever ? 0 : mp_obj_get_int(args[0]);
+    mp_uint_t start = mp_hal_ticks_ms();
+    while(input_queue_head == input_poll_head) {
+      if(!forever && mp_hal_ticks_ms() - start >= timeout) {
+        return mp_const_false;
+      }
+      // wakes early for any interrupt, runs scheduled callbacks and raises
+      // KeyboardInterrupt as usual
+      mp_hal_delay_ms(1);
+    }
+#endif
+    return mp_const_true;
+  })
+
   static const mp_rom_map_elem_t input_globals_table[] = {
     MPY_BIND_ROM_PTR(poll),
+    MPY_BIND_ROM_PTR(events),
+    MPY_BIND_ROM_PTR(wait),
     // TODO Move these to MicroPython?
     { MP_ROM_QSTR(MP_QSTR_BUTTON_HOME), MP_ROM_INT(BUTTON_HOME) },
     { MP_ROM_QSTR(MP_QSTR_BUTTON_A),    MP_ROM_INT(BUTTON_A) },
@@ -0,0 +1,245 @@
+#include "mp_tracked_allocator.hpp"
+
+#include "mp_helpers.hpp"
+#include "picovector.hpp"
+
+extern "C" {
+  #include "py/runtime.h"
+
+  MPY_BIND_DEL(label, {
+    self(self_in, label_obj_t);
+    m_del_class(label_t, self->label);
+    return mp_const_none;
+  })
+
+  static void label_set_font(label_obj_t *self, mp_obj_t font) {
+    if(mp_obj_is_type(font, &type_font)) {
+      self->label->font = &((font_obj_t *)MP_OBJ_TO_PTR(font))->font;
+      self->label->pixel_font = nullptr;
+    }else if(mp_obj_is_type(font, &type_pixel_font)) {
+      self->label->font = nullptr;
+      self->label->pixel_font = ((pixel_font_obj_t *)MP_OBJ_TO_PTR(font))->font;
+    }else{
+      mp_raise_TypeError(MP_ERROR_TEXT("value must be of type font or pixel_font"));
+    }
+    self->font = font;
+  }
+
+  static void label_set_size(label_obj_t *self, mp_obj_t size) {
+    float s = mp_obj_get_float(size);
+    if(self->label->font && s <= 0.0f) {
+      mp_raise_msg_varg(&mp_type_ValueError, MP_ERROR_TEXT("vector fonts need a size"));
+    }
+    self->label->size = s;
+  }
+
+  // label(font, text, size=0, brush=None) holds text rendered once into a
+  // coverage mask, drawing it again only composites the mask until the
+  // text, font or size changes. with no brush it's drawn with the target's
+  MPY_BIND_NEW(label, {
+    if(n_args < 2 || n_args > 4) {
+      mp_raise_msg_varg(&mp_type_TypeError, MP_ERROR_TEXT("invalid parameters, expected label(font, text, size=0, brush=None)"));
+    }
+
+    label_obj_t *self = mp_obj_malloc_with_finaliser(label_obj_t, type);
+    self->label = m_new_class(label_t);
+    label_set_font(self, args[0]);
+    mp_obj_str_get_str(args[1]);
+    self->text = args[1];
+    label_set_size(self, n_args > 2 ? args[2] : mp_obj_new_int(0));
+    self->brush = nullptr;
+    if(n_args > 3 && args[3] != mp_const_none) {
+      self->brush = mp_obj_to_brush(1, &args[3]);
+      if(!self->brush) {
+        mp_raise_TypeError(MP_ERROR_TEXT("brush must be of type brush, color or int"));
+      }
+    }
+    self->antialias = OFF;
+    self->stale = true;
+    self->changed = true;
+    self->drawn = false;
+    self->area = rect_t(0, 0, 0, 0);
+    self->dirty = rect_t(0, 0, 0, 0);
+    return MP_OBJ_FROM_PTR(self);
+  })
+
+  // draw(image, x, y) composites the label with its top left at x, y,
+  // rendering it first if it has changed
+  MPY_BIND_VAR(4, draw, {
+    self(args[0], label_obj_t);
+
+    if(!mp_obj_is_type(args[1], &type_image)) {
+      mp_raise_msg_varg(&mp_type_TypeError, MP_ERROR_TEXT("invalid parameter, expected draw(image, x, y)"));
+    }
+    const image_obj_t *target = (image_obj_t *)MP_OBJ_TO_PTR(args[1]);
+    int x = mp_obj_get_float(args[2]);
+    int y = mp_obj_get_float(args[3]);
+
+    brush_t *brush = self->brush ? self->brush->brush : target->image->brush();
+    if(!brush) {
+      mp_raise_msg_varg(&mp_type_ValueError, MP_ERROR_TEXT("label has no brush and neither does the image"));
+    }
+
+    image_sync(target);
+    antialias_t antialias = target->image->antialias();
+    if(self->stale || antialias != self->antialias) {
+      self->label->render(mp_obj_str_get_str(self->text), antialias);
+      self->antialias = antialias;
+      self->stale = false;
+      self->changed = true;
+    }
+
+    // dirty covers where the label was and is now, if what's shown changed
+    rect_t b = self->label->bounds();
+    rect_t area(x + b.x, y + b.y, b.w, b.h);
+    if(!self->drawn || self->changed || !(area == self->area) || !self->brush) {
+      rect_t d = area;
+      if(self->drawn && !self->area.empty()) {
+        if(d.empty()) {
+          d = self->area;
+        }else{
+          float x1 = std::min(d.x, self->area.x), y1 = std::min(d.y, self->area.y);
+          float x2 = std::max(d.x + d.w, self->area.x + self->area.w), y2 = std::max(d.y + d.h, self->area.y + self->area.h);
+          d = rect_t(x1, y1, x2 - x1, y2 - y1);
+        }
+      }
+      self->dirty = d;
+    }else{
+      self->dirty = rect_t(0, 0, 0, 0);
+    }
+    self->area = area;
+    self->drawn = true;
+    self->changed = false;
+
+    self->label->draw(target->image, brush, x, y);
+    return mp_const_none;
+  })
+
+  MPY_BIND_ATTR(label, {
+    self(self_in, label_obj_t);
+
+    action_t action = m_attr_action(dest);
+
+    switch(attr) {
+      case MP_QSTR_text: {
+        if(action == GET) {
+          dest[0] = self->text;
+          return;
+        }
+
+        if(action == SET) {
+          mp_obj_str_get_str(dest[1]);
+          self->text = dest[1];
+          self->stale = true;
+          dest[0] = MP_OBJ_NULL;
+          return;
+        }
+      };
+
+      case MP_QSTR_font: {
+        if(action == GET) {
+          dest[0] = self->font;
+          return;
+        }
+
+        if(action == SET) {
+          label_set_font(self, dest[1]);
+          self->stale = true;
+          dest[0] = MP_OBJ_NULL;
+          return;
+        }
+      };
+
+      case MP_QSTR_size: {
+        if(action == GET) {
+          dest[0] = mp_obj_new_float(self->label->size);
+          return;
+        }
+
+        if(action == SET) {
+          label_set_size(self, dest[1]);
+          self->stale = true;
+          dest[0] = MP_OBJ_NULL;
+          return;
+        }
+      };
+
+      case MP_QSTR_brush: {
+        if(action == GET) {
+          dest[0] = self->brush ? MP_OBJ_FROM_PTR(self->brush) : mp_const_none;
+          return;
+        }
+
+        if(action == SET) {
+          brush_obj_t *brush = nullptr;
+          if(dest[1] != mp_const_none) {
+            brush = mp_obj_to_brush(1, &dest[1]);
+            if(!brush) {
+              mp_raise_TypeError(MP_ERROR_TEXT("value must be of type brush, color or None"));
+            }
+          }
+          self->brush = brush;
+          self->changed = true;
+          dest[0] = MP_OBJ_NULL;
+          return;
+        }
+      };
+
+      // area the rendered text covers relative to where it's drawn, it's
+      // rendered now if it's changed
+      case MP_QSTR_bounds: {
+        if(action == GET) {
+          if(self->stale) {
+            self->label->render(mp_obj_str_get_str(self->text), self->antialias);
+            self->stale = false;
+            self->changed = true;
+          }
+          rect_obj_t *result = mp_obj_malloc(rect_obj_t, &type_rect);
+          result->r = self->label->bounds();
+          dest[0] = MP_OBJ_FROM_PTR(result);
+          return;
+        }
+      };
+
+      // area the last draw() changed on screen, covering where the label
+      // was before as well, or None if it drew the same pixels again. a
+      // label drawn with the target's brush is always dirty
+      case MP_QSTR_dirty: {
+        if(action == GET) {
+          if(self->dirty.empty()) {
+            dest[0] = mp_const_none;
+          }else{
+            rect_obj_t *result = mp_obj_malloc(rect_obj_t, &type_rect);
+            result->r = self->dirty;
+            dest[0] = MP_OBJ_FROM_PTR(result);
+          }
+          return;
+        }
+      };
+    }
+
+    // we didn't handle this, fall back to alternative methods
+    dest[1] = MP_OBJ_SENTINEL;
+  })
+
+  static void label_print(const mp_print_t *print, mp_obj_t self_in, mp_print_kind_t kind) {
+    self(self_in, label_obj_t);
+    mp_printf(print, "label(\"%s\")", mp_obj_str_get_str(self->text));
+  }
+
+  MPY_BIND_LOCALS_DICT(label,
+      MPY_BIND_ROM_PTR_DEL(label),
+      MPY_BIND_ROM_PTR(draw),
+  )
+
+  MP_DEFINE_CONST_OBJ_TYPE(
+      type_label,
+      MP_QSTR_label,
+      MP_TYPE_FLAG_NONE,
+      make_new, (const void *)label_new,
+      print, (const void *)label_print,
+      attr, (const void *)label_attr,
+      locals_dict, &label_locals_dict
+  );
+
+}
@@ -65,6 +65,68 @@ extern "C" {
     return MP_OBJ_FROM_PTR(result);
   })
 
+  // transform(src, dst=None, stride=2) transforms every point in a packed
+  // array('f') or array('h') of x, y pairs in one call rather than a vec2 at
+  // a time. dst defaults to src, otherwise it needs as many values and sets
+  // the output type, array('h') rounds to whole pixels ready for the batch
+  // draw calls. with a stride the point is the first two of every stride
+  // values and the rest are copied across untouched, so x, y, r circles
+  // can be transformed as they are
+  static inline float transform_value(const mp_buffer_info_t &b, size_t i) {
+    return b.typecode == 'f' ? ((float *)b.buf)[i] : float(((int16_t *)b.buf)[i]);
+  }
+
+  static inline void transform_store(const mp_buffer_info_t &b, size_t i, float v) {
+    if(b.typecode == 'f') {
+      ((float *)b.buf)[i] = v;
+    }else{
+      ((int16_t *)b.buf)[i] = int16_t(std::clamp(roundf(v), -32768.0f, 32767.0f));
+    }
+  }
+
+  static size_t transform_values(const mp_buffer_info_t &b) {
+    if(b.typecode != 'h' && b.typecode != 'f') {
+      mp_raise_msg_varg(&mp_type_ValueError, MP_ERROR_TEXT("points must be an array('h') or array('f')"));
+    }
+    return b.len / (b.typecode == 'f' ? sizeof(float) : sizeof(int16_t));
+  }
+
+  MPY_BIND_VAR(2, transform, {
+    const mat3_obj_t *self = (mat3_obj_t *)MP_OBJ_TO_PTR(args[0]);
+
+    mp_buffer_info_t src;
+    mp_get_buffer_raise(args[1], &src, MP_BUFFER_READ);
+    size_t values = transform_values(src);
+
+    mp_obj_t dst_obj = n_args > 2 && args[2] != mp_const_none ? args[2] : args[1];
+    mp_buffer_info_t dst;
+    mp_get_buffer_raise(dst_obj, &dst, MP_BUFFER_WRITE);
+    if(transform_values(dst) < values) {
+      mp_raise_msg_varg(&mp_type_ValueError, MP_ERROR_TEXT("dst is smaller than src"));
+    }
+
+    mp_int_t stride = n_args > 3 ? mp_obj_get_int(args[3]) : 2;
+    if(stride < 2) {
+      mp_raise_msg_varg(&mp_type_ValueError, MP_ERROR_TEXT("stride must be at least 2"));
+    }
+
+    const mat3_t &m = self->m;
+    bool copy = dst.buf != src.buf;
+    for(size_t i = 0; i + size_t(stride) <= values; i += stride) {
+      float x = transform_value(src, i);
+      float y = transform_value(src, i + 1);
+      transform_store(dst, i, m.v00 * x + m.v01 * y + m.v02);
+      transform_store(dst, i + 1, m.v10 * x + m.v11 * y + m.v12);
+      if(copy) {
+        for(mp_int_t j = 2; j < stride; j++) {
+          transform_store(dst, i + j, transform_value(src, i + j));
+        }
+      }
+    }
+
+    return dst_obj;
+  })
+
   static mp_obj_t matrix_binary_op(mp_binary_op_t op, mp_obj_t lhs_in, mp_obj_t rhs_in) {
     mat3_obj_t *lhs = (mat3_obj_t*)MP_OBJ_TO_PTR(lhs_in);
 
@@ -93,6 +155,7 @@ extern "C" {
     MPY_BIND_ROM_PTR(scale),
     MPY_BIND_ROM_PTR(multiply),
     MPY_BIND_ROM_PTR(inverse),
+    MPY_BIND_ROM_PTR(transform),
   )
 
   MP_DEFINE_CONST_OBJ_TYPE(
@@ -79,8 +79,36 @@ constexpr size_t DELETE = 0b1 << 29;
 typedef size_t action_t;
 extern action_t m_attr_action(mp_obj_t *dest);
 
-// file reading helpers, defined in picovector.cpp
-extern uint32_t ru32(mp_obj_t file);
-extern uint16_t ru16(mp_obj_t file);
-extern uint8_t ru8(mp_obj_t file);
-extern int8_t rs8(mp_obj_t file);
\ No newline at end of file
+// buffered file reading, defined in picovector.cpp. parsers pull a few
+// bytes at a time and a vfs call per field dominated load times on flash
+// filesystems, so streamed files are read in blocks of this size. files
+// that can be mapped (romfs, built in assets) are read straight from memory
+constexpr size_t PV_READER_BUFFER_SIZE = 4096;
+
+typedef struct _pv_reader_t {
+  mp_obj_t file;        // MP_OBJ_NULL when the file is mapped
+  const uint8_t *data;  // the mapped file or the read buffer
+  uint8_t *buffer;
+  size_t offset;        // file offset of data[0]
+  size_t pos;           // read position within data
+  size_t len;           // bytes held in data
+} pv_reader_t;
+
+// opens path for reading, mapped if possible
+extern void pv_reader_open(pv_reader_t *r, mp_obj_t path);
+// opens path for reading through the vfs even if it could be mapped
+extern void pv_reader_open_stream(pv_reader_t *r, mp_obj_t path);
+// reads up to n bytes, fewer only at the end of the file
+extern size_t pv_reader_read(pv_reader_t *r, void *dst, size_t n);
+// the next n bytes where they sit in memory, stepping over them, if the
+// file is mapped and holds them. nullptr for streamed files
+extern const uint8_t *pv_reader_map(pv_reader_t *r, size_t n);
+// moves to an absolute offset and returns it
+extern size_t pv_reader_seek(pv_reader_t *r, size_t p);
+extern void pv_reader_close(pv_reader_t *r);
+
+// big endian fields, zero past the end of the file
+extern uint32_t ru32(pv_reader_t *r);
+extern uint16_t ru16(pv_reader_t *r);
+extern uint8_t ru8(pv_reader_t *r);
+extern int8_t rs8(pv_reader_t *r);
\ No newline at end of file
@@ -11,6 +11,86 @@ extern "C" {
 #include "py/runtime.h"
 }
 
+// everything picovector allocates from the gc heap is counted by what it was
+// allocated for, picovector.alloc_stats() reports the counts. the kind is set
+// for a stretch of code with PV_ALLOC_SCOPE(), anything outside one is other
+enum pv_alloc_kind_t {
+  PV_ALLOC_OTHER,
+  PV_ALLOC_SHAPE,
+  PV_ALLOC_PATH,
+  PV_ALLOC_BRUSH,
+  PV_ALLOC_IMAGE,
+  PV_ALLOC_FONT,
+  PV_ALLOC_COLOR,
+  PV_ALLOC_KINDS
+};
+
+struct pv_alloc_count_t {
+  uint32_t allocs;  // allocations, reallocations included
+  uint32_t frees;
+  size_t   bytes;   // bytes allocated
+};
+
+extern pv_alloc_count_t pv_alloc_counts[PV_ALLOC_KINDS];
+extern pv_alloc_kind_t pv_alloc_kind;
+
+class pv_alloc_scope_t {
+public:
+  pv_alloc_scope_t(pv_alloc_kind_t kind) : _previous(pv_alloc_kind) {pv_alloc_kind = kind;}
+  ~pv_alloc_scope_t() {pv_alloc_kind = _previous;}
+
+private:
+  pv_alloc_kind_t _previous;
+};
+
+// the gc heap functions called as (m_malloc)() and so on skip the macros
+// below that point picovector's own calls here
+inline void *pv_tracked_malloc(size_t num_bytes) {
+  pv_alloc_count_t &c = pv_alloc_counts[pv_alloc_kind];
+  c.allocs++;
+  c.bytes += num_bytes;
+  return (m_malloc)(num_bytes);
+}
+
+inline void *pv_tracked_malloc0(size_t num_bytes) {
+  pv_alloc_count_t &c = pv_alloc_counts[pv_alloc_kind];
+  c.allocs++;
+  c.bytes += num_bytes;
+  return (m_malloc0)(num_bytes);
+}
+
+#if MICROPY_MALLOC_USES_ALLOCATED_SIZE
+inline void *pv_tracked_realloc(void *ptr, size_t old_num_bytes, size_t new_num_bytes) {
+  pv_alloc_count_t &c = pv_alloc_counts[pv_alloc_kind];
+  c.allocs++;
+  c.bytes += new_num_bytes;
+  return (m_realloc)(ptr, old_num_bytes, new_num_bytes);
+}
+
+inline void pv_tracked_free(void *ptr, size_t num_bytes) {
+  if(ptr) pv_alloc_counts[pv_alloc_kind].frees++;
+  (m_free)(ptr, num_bytes);
+}
+#else
+inline void *pv_tracked_realloc(void *ptr, size_t new_num_bytes) {
+  pv_alloc_count_t &c = pv_alloc_counts[pv_alloc_kind];
+  c.allocs++;
+  c.bytes += new_num_bytes;
+  return (m_realloc)(ptr, new_num_bytes);
+}
+
+inline void pv_tracked_free(void *ptr) {
+  if(ptr) pv_alloc_counts[pv_alloc_kind].frees++;
+  (m_free)(ptr);
+}
+#endif
+
+// m_new(), m_del(), m_new_class() and the rest all end up here
+#define m_malloc(...) pv_tracked_malloc(__VA_ARGS__)
+#define m_malloc0(...) pv_tracked_malloc0(__VA_ARGS__)
+#define m_realloc(...) pv_tracked_realloc(__VA_ARGS__)
+#define m_free(...) pv_tracked_free(__VA_ARGS__)
+
 template<class T>
 struct MPAllocator
 {
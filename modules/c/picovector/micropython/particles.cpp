@@ -0,0 +1,233 @@
+#include "mp_tracked_allocator.hpp"
+
+#include "mp_helpers.hpp"
+#include "picovector.hpp"
+
+extern "C" {
+  #include "py/runtime.h"
+
+  MPY_BIND_DEL(particles, {
+    self(self_in, particles_obj_t);
+    m_del_class(particles_t, self->particles);
+    return mp_const_none;
+  })
+
+  // particles(capacity) makes an empty pool that holds up to capacity
+  // particles, nothing is allocated after this
+  MPY_BIND_NEW(particles, {
+    if(n_args != 1) {
+      mp_raise_msg_varg(&mp_type_ValueError, MP_ERROR_TEXT("invalid parameters, expected particles(capacity)"));
+    }
+
+    int capacity = mp_obj_get_int(args[0]);
+    if(capacity <= 0) {
+      mp_raise_msg_varg(&mp_type_ValueError, MP_ERROR_TEXT("capacity must be positive"));
+    }
+
+    particles_obj_t *self = mp_obj_malloc_with_finaliser(particles_obj_t, type);
+    self->particles = m_new_class(particles_t, capacity);
+    return MP_OBJ_FROM_PTR(self);
+  })
+
+  // emit(n, position=None) bursts up to n particles out of position, or the
+  // emitter's position, and returns how many there was room for
+  MPY_BIND_VAR(2, emit, {
+    self(args[0], particles_obj_t);
+    vec2_t p = n_args > 2 ? mp_obj_get_vec2(args[2]) : self->particles->position;
+    return mp_obj_new_int(self->particles->emit(mp_obj_get_int(args[1]), p));
+  })
+
+  // update(dt) steps every particle on by dt seconds and emits rate * dt
+  // more from the emitter
+  MPY_BIND_VAR(2, update, {
+    self(args[0], particles_obj_t);
+    self->particles->update(mp_obj_get_float(args[1]));
+    return mp_const_none;
+  })
+
+  // draw(target, size=1) draws the particles as size pixel squares, or
+  // draw(target, atlas, frames) as sprites where frames is an array('h') of
+  // sx, sy, sw, sh per frame played through over each particle's life.
+  // squares take their colour from colors if it's set, sprites aren't tinted
+  MPY_BIND_VAR(2, draw, {
+    self(args[0], particles_obj_t);
+
+    if(!mp_obj_is_type(args[1], &type_image)) {
+      mp_raise_msg_varg(&mp_type_TypeError, MP_ERROR_TEXT("invalid parameter, expected draw(image, size=1) or draw(image, atlas, frames)"));
+    }
+    const image_obj_t *target = (image_obj_t *)MP_OBJ_TO_PTR(args[1]);
+    image_sync(target);
+
+    if(n_args > 3) {
+      if(!mp_obj_is_type(args[2], &type_image)) {
+        mp_raise_msg_varg(&mp_type_TypeError, MP_ERROR_TEXT("invalid parameter, expected draw(image, atlas, frames)"));
+      }
+      const image_obj_t *atlas = (image_obj_t *)MP_OBJ_TO_PTR(args[2]);
+
+      mp_buffer_info_t frames;
+      mp_get_buffer_raise(args[3], &frames, MP_BUFFER_READ);
+      if(frames.typecode != 'h') {
+        mp_raise_msg_varg(&mp_type_ValueError, MP_ERROR_TEXT("frames must be an array('h')"));
+      }
+
+      image_sync(atlas);
+      self->particles->draw_sprites(target->image, atlas->image, (const int16_t *)frames.buf, frames.len / (sizeof(int16_t) * 4));
+      return mp_const_none;
+    }
+
+    int size = n_args > 2 ? mp_obj_get_int(args[2]) : 1;
+    self->particles->draw(target->image, std::max(size, 1));
+    return mp_const_none;
+  })
+
+  // clear() retires every particle at once
+  MPY_BIND_VAR(1, clear, {
+    self(args[0], particles_obj_t);
+    self->particles->clear();
+    return mp_const_none;
+  })
+
+  static mp_obj_t particles_range_get(float lo, float hi) {
+    mp_obj_t items[2] = {mp_obj_new_float(lo), mp_obj_new_float(hi)};
+    return mp_obj_new_tuple(2, items);
+  }
+
+  // a single number sets both limits, a pair sets them separately
+  static void particles_range_set(mp_obj_t value, float &lo, float &hi) {
+    if(mp_obj_is_type(value, &mp_type_tuple) || mp_obj_is_type(value, &mp_type_list)) {
+      mp_obj_t *items;
+      mp_obj_get_array_fixed_n(value, 2, &items);
+      lo = mp_obj_get_float(items[0]);
+      hi = mp_obj_get_float(items[1]);
+    }else{
+      lo = hi = mp_obj_get_float(value);
+    }
+  }
+
+  MPY_BIND_ATTR(particles, {
+    self(self_in, particles_obj_t);
+    particles_t *particles = self->particles;
+
+    action_t action = m_attr_action(dest);
+
+    switch(attr) {
+      case MP_QSTR_position:
+      case MP_QSTR_gravity: {
+        vec2_t &v = attr == MP_QSTR_position ? particles->position : particles->gravity;
+        if(action == GET) {
+          vec2_obj_t *result = mp_obj_malloc(vec2_obj_t, &type_vec2);
+          result->v = v;
+          dest[0] = MP_OBJ_FROM_PTR(result);
+          return;
+        }
+
+        if(action == SET) {
+          v = mp_obj_get_vec2(dest[1]);
+          dest[0] = MP_OBJ_NULL;
+          return;
+        }
+      };
+
+      case MP_QSTR_rate:
+      case MP_QSTR_angle:
+      case MP_QSTR_spread:
+      case MP_QSTR_drag: {
+        float &v = attr == MP_QSTR_rate ? particles->rate :
+                   attr == MP_QSTR_angle ? particles->angle :
+                   attr == MP_QSTR_spread ? particles->spread : particles->drag;
+        if(action == GET) {
+          dest[0] = mp_obj_new_float(v);
+          return;
+        }
+
+        if(action == SET) {
+          v = mp_obj_get_float(dest[1]);
+          dest[0] = MP_OBJ_NULL;
+          return;
+        }
+      };
+
+      case MP_QSTR_speed: {
+        if(action == GET) {
+          dest[0] = particles_range_get(particles->speed_min, particles->speed_max);
+          return;
+        }
+
+        if(action == SET) {
+          particles_range_set(dest[1], particles->speed_min, particles->speed_max);
+          dest[0] = MP_OBJ_NULL;
+          return;
+        }
+      };
+
+      case MP_QSTR_life: {
+        if(action == GET) {
+          dest[0] = particles_range_get(particles->life_min, particles->life_max);
+          return;
+        }
+
+        if(action == SET) {
+          particles_range_set(dest[1], particles->life_min, particles->life_max);
+          dest[0] = MP_OBJ_NULL;
+          return;
+        }
+      };
+
+      // colours over life as an array('I') of 0xRRGGBBAA, or None to draw
+      // in the target's brush. the colours are copied and premultiplied
+      // when set so it can't be read back
+      case MP_QSTR_colors: {
+        if(action == SET) {
+          if(dest[1] == mp_const_none) {
+            particles->lut(nullptr, 0);
+          }else{
+            mp_buffer_info_t colors;
+            mp_get_buffer_raise(dest[1], &colors, MP_BUFFER_READ);
+            if(!strchr("IiLl", colors.typecode)) {
+              mp_raise_msg_varg(&mp_type_ValueError, MP_ERROR_TEXT("colors must be an array('I')"));
+            }
+            particles->lut((const uint32_t *)colors.buf, colors.len / sizeof(uint32_t));
+          }
+          dest[0] = MP_OBJ_NULL;
+          return;
+        }
+        break;
+      };
+
+      case MP_QSTR_count: {
+        if(action == GET) {
+          dest[0] = mp_obj_new_int(particles->count());
+          return;
+        }
+      };
+
+      case MP_QSTR_capacity: {
+        if(action == GET) {
+          dest[0] = mp_obj_new_int(particles->capacity());
+          return;
+        }
+      };
+    }
+
+    // we didn't handle this, fall back to alternative methods
+    dest[1] = MP_OBJ_SENTINEL;
+  })
+
+  MPY_BIND_LOCALS_DICT(particles,
+      MPY_BIND_ROM_PTR_DEL(particles),
+      MPY_BIND_ROM_PTR(emit),
+      MPY_BIND_ROM_PTR(update),
+      MPY_BIND_ROM_PTR(draw),
+      MPY_BIND_ROM_PTR(clear),
+  )
+
+  MP_DEFINE_CONST_OBJ_TYPE(
+      type_particles,
+      MP_QSTR_particles,
+      MP_TYPE_FLAG_NONE,
+      make_new, (const void *)particles_new,
+      attr, (const void *)particles_attr,
+      locals_dict, &particles_locals_dict
+  );
+
+}
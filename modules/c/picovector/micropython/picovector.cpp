@@ -1,5 +1,6 @@
-#include "picovector.hpp"
 #include "mp_helpers.hpp"
+#include "picovector.hpp"
+#include "../profile.hpp"
 
 action_t m_attr_action(mp_obj_t *dest) {
   if(dest[0] == MP_OBJ_NULL && dest[1] == MP_OBJ_NULL) {return GET;}
@@ -7,31 +8,163 @@ action_t m_attr_action(mp_obj_t *dest) {
   return SET;
 }
 
-uint32_t ru32(mp_obj_t file) {
+extern "C" {
+  #include "extmod/vfs.h"
+  #include "py/mphal.h"
+}
+
+pv_alloc_count_t pv_alloc_counts[PV_ALLOC_KINDS] = {};
+pv_alloc_kind_t pv_alloc_kind = PV_ALLOC_OTHER;
+
+// the port's gc_collect() is wrapped at link time (see micropython.cmake) so
+// every collection, automatic or asked for, is counted and timed
+static uint32_t gc_collections = 0;
+static uint32_t gc_total_us = 0;
+static uint32_t gc_longest_us = 0;
+
+extern "C" void __real_gc_collect(void);
+extern "C" void __wrap_gc_collect(void) {
+  uint32_t start = mp_hal_ticks_us();
+  __real_gc_collect();
+  uint32_t us = mp_hal_ticks_us() - start;
+  gc_collections++;
+  gc_total_us += us;
+  gc_longest_us = std::max(gc_longest_us, us);
+}
+
+void pv_reader_open_stream(pv_reader_t *r, mp_obj_t path) {
+  mp_obj_t args[2] = {path, MP_ROM_QSTR(MP_QSTR_rb)};
+  r->file = mp_vfs_open(MP_ARRAY_SIZE(args), &args[0], (mp_map_t *)&mp_const_empty_map);
+  r->buffer = m_new(uint8_t, PV_READER_BUFFER_SIZE);
+  r->data = r->buffer;
+  r->offset = 0;
+  r->pos = 0;
+  r->len = 0;
+}
+
+void pv_reader_open(pv_reader_t *r, mp_obj_t path) {
+  size_t size;
+  if(const uint8_t *data = pv_map_file(path, &size)) {
+    r->file = MP_OBJ_NULL;
+    r->buffer = nullptr;
+    r->data = data;
+    r->offset = 0;
+    r->pos = 0;
+    r->len = size;
+    return;
+  }
+  pv_reader_open_stream(r, path);
+}
+
+static size_t pv_reader_fill(pv_reader_t *r, void *dst, size_t n) {
   int error;
-  uint32_t result;
-  mp_stream_read_exactly(file, &result, 4, &error);
-  return __builtin_bswap32(result);
+  mp_uint_t got = mp_stream_read_exactly(r->file, dst, n, &error);
+  return got == MP_STREAM_ERROR ? 0 : got;
+}
+
+size_t pv_reader_read(pv_reader_t *r, void *dst, size_t n) {
+  uint8_t *p = (uint8_t *)dst;
+  size_t done = 0;
+  while(n > 0) {
+    if(r->pos == r->len) {
+      if(r->file == MP_OBJ_NULL) {
+        break;
+      }
+      r->offset += r->len;
+      r->pos = 0;
+      r->len = 0;
+
+      // reads at least a buffer long go straight into the destination
+      if(n >= PV_READER_BUFFER_SIZE) {
+        size_t got = pv_reader_fill(r, p, n);
+        r->offset += got;
+        done += got;
+        break;
+      }
+
+      r->len = pv_reader_fill(r, r->buffer, PV_READER_BUFFER_SIZE);
+      if(r->len == 0) {
+        break;
+      }
+    }
+
+    size_t count = std::min(n, r->len - r->pos);
+    memcpy(p, r->data + r->pos, count);
+    r->pos += count;
+    p += count;
+    n -= count;
+    done += count;
+  }
+  return done;
+}
+
+const uint8_t *pv_reader_map(pv_reader_t *r, size_t n) {
+  if(r->file != MP_OBJ_NULL || r->len - r->pos < n) {
+    return nullptr;
+  }
+  const uint8_t *p = r->data + r->pos;
+  r->pos += n;
+  return p;
 }
 
-uint16_t ru16(mp_obj_t file) {
+size_t pv_reader_seek(pv_reader_t *r, size_t p) {
+  // anywhere within what's already buffered (or mapped) needs no vfs call
+  if(p >= r->offset && p <= r->offset + r->len) {
+    r->pos = p - r->offset;
+    return p;
+  }
+  if(r->file == MP_OBJ_NULL) {
+    r->pos = r->len;
+    return r->len;
+  }
+
+  struct mp_stream_seek_t seek_s;
+  seek_s.offset = p;
+  seek_s.whence = SEEK_SET;
+  const mp_stream_p_t *stream_p = mp_get_stream(r->file);
   int error;
-  uint16_t result;
-  mp_stream_read_exactly(file, &result, 2, &error);
+  mp_uint_t res = stream_p->ioctl(r->file, MP_STREAM_SEEK, (mp_uint_t)(uintptr_t)&seek_s, &error);
+  if(res == MP_STREAM_ERROR) {
+    mp_raise_msg_varg(&mp_type_OSError, MP_ERROR_TEXT("seek failed with %d"), error);
+  }
+  r->offset = seek_s.offset;
+  r->pos = 0;
+  r->len = 0;
+  return seek_s.offset;
+}
+
+void pv_reader_close(pv_reader_t *r) {
+  if(r->file != MP_OBJ_NULL) {
+    mp_stream_close(r->file);
+    r->file = MP_OBJ_NULL;
+  }
+  if(r->buffer) {
+    m_del(uint8_t, r->buffer, PV_READER_BUFFER_SIZE);
+    r->buffer = nullptr;
+  }
+}
+
+uint32_t ru32(pv_reader_t *r) {
+  uint32_t result = 0;
+  pv_reader_read(r, &result, 4);
+  return __builtin_bswap32(result);
+}
+
+uint16_t ru16(pv_reader_t *r) {
+  uint16_t result = 0;
+  pv_reader_read(r, &result, 2);
   return __builtin_bswap16(result);
 }
 
-uint8_t ru8(mp_obj_t file) {
-  int error;
-  uint8_t result;
-  mp_stream_read_exactly(file, &result, 1, &error);
+uint8_t ru8(pv_reader_t *r) {
+  uint8_t result = 0;
+  pv_reader_read(r, &result, 1);
   return result;
 }
 
-int8_t rs8(mp_obj_t file) {
-  int error;
-  int8_t result;
-  mp_stream_read_exactly(file, &result, 1, &error);
+int8_t rs8(pv_reader_t *r) {
+  int8_t result = 0;
+  pv_reader_read(r, &result, 1);
   return result;
 }
 
@@ -39,26 +172,125 @@ extern "C" {
   #include "py/runtime.h"
 
   mp_obj_t modpicovector___init__(void) {
+      // whatever was cached went with the heap on a soft reset
+      memset(MP_STATE_VM(picovector_color_cache), 0, sizeof(MP_STATE_VM(picovector_color_cache)));
+      profile_init();
       return mp_const_none;
   }
 
+  // memory_stats(reset=False) describes how the shared working buffer is
+  // being used, high_water being the furthest anything has reached into it
+  // and users the claims and high water of each part of picovector using
+  // it. reset starts the high water marks again from what's held now. sram
+  // is the image sram pool's (size, used, high_water, largest_free)
+  mp_obj_t modpicovector_memory_stats(size_t n_args, const mp_obj_t *args) {
+    working_buffer_stats_t stats;
+    working_buffer_stats(&stats);
+
+    mp_obj_t users = mp_obj_new_dict(stats.user_count);
+    for(int i = 0; i < stats.user_count; i++) {
+      mp_obj_t usage[2] = {mp_obj_new_int(stats.users[i].claims), mp_obj_new_int(stats.users[i].high_water)};
+      mp_obj_dict_store(users, mp_obj_new_str(stats.users[i].name, strlen(stats.users[i].name)), mp_obj_new_tuple(2, usage));
+    }
+
+    // image buffers asked to live in sram
+    sram_pool_stats_t sram;
+    sram_pool_stats(&sram);
+    mp_obj_t pool[4] = {mp_obj_new_int(sram.size), mp_obj_new_int(sram.used), mp_obj_new_int(sram.high_water), mp_obj_new_int(sram.largest_free)};
+
+    mp_obj_t result = mp_obj_new_dict(7);
+    mp_obj_dict_store(result, MP_OBJ_NEW_QSTR(MP_QSTR_size), mp_obj_new_int(stats.size));
+    mp_obj_dict_store(result, MP_OBJ_NEW_QSTR(MP_QSTR_used), mp_obj_new_int(stats.used));
+    mp_obj_dict_store(result, MP_OBJ_NEW_QSTR(MP_QSTR_high_water), mp_obj_new_int(stats.high_water));
+    mp_obj_dict_store(result, MP_OBJ_NEW_QSTR(MP_QSTR_depth), mp_obj_new_int(stats.depth));
+    mp_obj_dict_store(result, MP_OBJ_NEW_QSTR(MP_QSTR_failures), mp_obj_new_int(stats.failures));
+    mp_obj_dict_store(result, MP_OBJ_NEW_QSTR(MP_QSTR_users), users);
+    mp_obj_dict_store(result, MP_OBJ_NEW_QSTR(MP_QSTR_sram), mp_obj_new_tuple(4, pool));
+
+    if(n_args > 0 && mp_obj_is_true(args[0])) {
+      working_buffer_reset_stats();
+    }
+    return result;
+  }
+
+  // alloc_stats(reset=False) counts what picovector has allocated from the
+  // gc heap as (allocs, frees, bytes) for each of shape, path, brush, image,
+  // font, color and other. gc is (collections, total_us, longest_us) for the
+  // collections run meanwhile. reset starts every count again from zero,
+  // badgeware.run() does so each frame when asked to track allocations
+  mp_obj_t modpicovector_alloc_stats(size_t n_args, const mp_obj_t *args) {
+    static const qstr names[PV_ALLOC_KINDS] = {MP_QSTR_other, MP_QSTR_shape, MP_QSTR_path, MP_QSTR_brush, MP_QSTR_image, MP_QSTR_font, MP_QSTR_color};
+
+    // taken before the dict is built so it doesn't count itself
+    pv_alloc_count_t counts[PV_ALLOC_KINDS];
+    memcpy(counts, pv_alloc_counts, sizeof(counts));
+    mp_obj_t gc[3] = {mp_obj_new_int_from_uint(gc_collections), mp_obj_new_int_from_uint(gc_total_us), mp_obj_new_int_from_uint(gc_longest_us)};
+
+    mp_obj_t result = mp_obj_new_dict(PV_ALLOC_KINDS + 1);
+    for(int i = 0; i < PV_ALLOC_KINDS; i++) {
+      mp_obj_t count[3] = {mp_obj_new_int_from_uint(counts[i].allocs), mp_obj_new_int_from_uint(counts[i].frees), mp_obj_new_int_from_uint(counts[i].bytes)};
+      mp_obj_dict_store(result, MP_OBJ_NEW_QSTR(names[i]), mp_obj_new_tuple(3, count));
+    }
+    mp_obj_dict_store(result, MP_OBJ_NEW_QSTR(MP_QSTR_gc), mp_obj_new_tuple(3, gc));
+
+    if(n_args > 0 && mp_obj_is_true(args[0])) {
+      memset(pv_alloc_counts, 0, sizeof(pv_alloc_counts));
+      gc_collections = gc_total_us = gc_longest_us = 0;
+    }
+    return result;
+  }
+
+  // profile(reset=False) reports the timed entry points as (calls, pixels,
+  // us) for each of render, glyph, blit, filter, png, clear and present,
+  // see profile.hpp. reset starts them again from zero, badgeware.run()
+  // does so each frame when profiling
+  mp_obj_t modpicovector_profile(size_t n_args, const mp_obj_t *args) {
+    static const qstr names[PROFILE_POINTS] = {MP_QSTR_render, MP_QSTR_glyph, MP_QSTR_blit, MP_QSTR_filter, MP_QSTR_png, MP_QSTR_clear, MP_QSTR_present};
+
+    profile_stat_t stats[PROFILE_POINTS];
+    profile_read(stats);
+    uint32_t ticks_per_us = profile_ticks_per_us();
+
+    mp_obj_t result = mp_obj_new_dict(PROFILE_POINTS);
+    for(int i = 0; i < PROFILE_POINTS; i++) {
+      mp_obj_t stat[3] = {mp_obj_new_int_from_uint(stats[i].calls), mp_obj_new_int_from_uint(stats[i].pixels), mp_obj_new_int_from_uint(stats[i].ticks / ticks_per_us)};
+      mp_obj_dict_store(result, MP_OBJ_NEW_QSTR(names[i]), mp_obj_new_tuple(3, stat));
+    }
+
+    if(n_args > 0 && mp_obj_is_true(args[0])) {
+      profile_reset();
+    }
+    return result;
+  }
+
   brush_obj_t *mp_obj_to_brush(size_t n_args, const mp_obj_t *args) {
     if(n_args == 1 && mp_obj_is_type(args[0], &type_brush)) {
       return (brush_obj_t *)MP_OBJ_TO_PTR(args[0]);
     }
 
+    color_obj_t *color = nullptr;
     if(n_args == 1 && mp_obj_is_type(args[0], &type_color)) {
-      color_obj_t *color = (color_obj_t *)MP_OBJ_TO_PTR(args[0]);
-      brush_obj_t *brush = mp_obj_malloc(brush_obj_t, &type_brush);
-      brush->brush = m_new_class(color_brush_t, *color->c);
-      return brush;
+      color = (color_obj_t *)MP_OBJ_TO_PTR(args[0]);
+    }
+
+    // a packed 0xRRGGBBAA paints with the same interned colour color.rgb()
+    // would return for it
+    if(n_args == 1 && mp_obj_is_int(args[0])) {
+      color = mp_color_get(COLOR_RGB, (uint32_t)mp_obj_get_int_truncated(args[0]));
     }
 
-    // if(n_args == 1 && mp_obj_is_int(args[0])) {
-    //   brush_obj_t *brush = mp_obj_malloc(brush_obj_t, &type_brush);
-    //   brush->brush = m_new_class(color_brush_t, mp_obj_get_uint(args[0]));
-    //   return brush;
-    // }
+    if(color) {
+      // colours never change so each one keeps the brush it's painted with,
+      // setting the pen to it again doesn't allocate
+      if(!color->brush) {
+        PV_ALLOC_SCOPE(PV_ALLOC_BRUSH);
+        brush_obj_t *brush = mp_obj_malloc(brush_obj_t, &type_brush);
+        brush->brush = m_new_class(color_brush_t, *color->c);
+        brush->color = MP_OBJ_FROM_PTR(color);
+        color->brush = brush;
+      }
+      return color->brush;
+    }
 
     /*
     if(n_args >= 3 && mp_obj_is_int(args[0]) && mp_obj_is_int(args[1]) && mp_obj_is_int(args[2])) {
@@ -11,6 +11,15 @@
 #include "../color.hpp"
 #include "../pixel_font.hpp"
 #include "../blend.hpp"
+#include "../display_list.hpp"
+#include "../tilemap.hpp"
+#include "../particles.hpp"
+#include "../spatial_hash.hpp"
+#include "../text_layout.hpp"
+#include "../sdf_font.hpp"
+#include "../label.hpp"
+#include "../working_buffer.hpp"
+#include "../sram_pool.hpp"
 #include "PNGdec.h"
 #endif
 
@@ -22,6 +31,7 @@ extern "C" {
   typedef struct _brush_obj_t {
     mp_obj_base_t base;
     brush_t *brush;
+    mp_obj_t color; // the colour a solid brush paints with, null otherwise
   } brush_obj_t;
 
   typedef struct _shape_obj_t {
@@ -36,19 +46,56 @@ extern "C" {
   } mat3_obj_t;
 
   typedef struct _png_handle_t {
-    mp_obj_t fhandle;
+    pv_reader_t reader;
   } png_handle_t;
 
+  // where pngdec_decode_callback puts decoded rows, handed to decode() as
+  // its user pointer. the png's top left lands at (x, y) of image, rows are
+  // clipped to the image's clip and blended over it when blend is set or
+  // written straight in otherwise
+  typedef struct _png_target_t {
+    image_t *image;
+    int x, y;
+    bool blend;
+    // set for downscaled decodes, which write whole images at (0, 0): each
+    // box of 1 << shift pixels square becomes one pixel, summed a row at a
+    // time into acc (four channels per output column)
+    int shift;
+    uint16_t *acc;
+    // filled in by pngdec_decode and the first row: the transparent grey
+    // level or 0xrrggbb of a keyed png (-1 if none) and the palette or grey
+    // levels as premultiplied rgba8888
+    PNG *png;
+    bool ready;
+    int32_t transparent;
+    uint32_t lut[256];
+  } png_target_t;
+
   typedef struct _font_obj_t {
     mp_obj_base_t base;
     font_t font;
     uint8_t *buffer;
     uint32_t buffer_size;
+    uint8_t *points_buffer; // null when the points are used in place
+    uint32_t points_buffer_size;
+    mp_obj_t fallback; // keeps font.fallback alive
   } font_obj_t;
 
+  // how a colour was made, colours made any other way aren't interned
+  enum color_kind_t : uint8_t {
+    COLOR_OTHER,
+    COLOR_RGB,    // key is 0xRRGGBBAA
+    COLOR_HSV,    // key is 0xHHSSVVAA
+    COLOR_OKLCH,  // key is 0xLLCCHHAA
+    COLOR_PREMUL  // key is the pre-multiplied value itself
+  };
+
   typedef struct _color_obj_t {
     mp_obj_base_t base;
     color_t *c;
+    brush_obj_t *brush; // made the first time the colour is used as a pen
+    color_kind_t kind;
+    uint32_t key;       // what it was made from
   } color_obj_t;
 
   typedef struct _pixel_font_obj_t {
@@ -58,8 +105,27 @@ extern "C" {
     uint32_t glyph_buffer_size;
     uint8_t *glyph_data_buffer;
     uint32_t glyph_data_buffer_size;
+    mp_obj_t fallback; // keeps font->fallback alive
+    pv_reader_t reader; // left open while the bitmaps are streamed
+    uint32_t glyph_data_offset;
   } pixel_font_obj_t;
 
+  typedef struct _text_layout_obj_t {
+    mp_obj_base_t base;
+    text_layout_t layout;
+    mp_obj_t font;     // keeps layout.font or layout.pixel_font alive
+    size_t glyphs_size;
+  } text_layout_obj_t;
+
+  typedef struct _sdf_font_obj_t {
+    mp_obj_base_t base;
+    sdf_font_t font;
+    uint8_t *glyph_buffer; // null when the table is used in place
+    uint32_t glyph_buffer_size;
+    uint8_t *data_buffer;  // null when the data is used in place
+    uint32_t data_buffer_size;
+  } sdf_font_obj_t;
+
   typedef struct _image_obj_t {
     mp_obj_base_t base;
     image_t *image;
@@ -67,6 +133,7 @@ extern "C" {
     font_obj_t *font;
     pixel_font_obj_t *pixel_font;
     void *parent;
+    display_list_t *display_list; // set while drawing is deferred
   } image_obj_t;
 
   typedef struct _rect_obj_t {
@@ -79,6 +146,45 @@ extern "C" {
     vec2_t v;
   } vec2_obj_t;
 
+  typedef struct _tilemap_obj_t {
+    mp_obj_base_t base;
+    tilemap_t *tilemap;
+    image_obj_t *atlas;
+    mp_obj_t cells;
+  } tilemap_obj_t;
+
+  typedef struct _particles_obj_t {
+    mp_obj_base_t base;
+    particles_t *particles;
+  } particles_obj_t;
+
+  typedef struct _spatial_hash_obj_t {
+    mp_obj_base_t base;
+    spatial_hash_t *hash;
+    mp_obj_t *objects;  // one per slot, None when there's nothing
+  } spatial_hash_obj_t;
+
+  typedef struct _label_obj_t {
+    mp_obj_base_t base;
+    label_t *label;
+    mp_obj_t font;          // font or pixel_font
+    mp_obj_t text;
+    brush_obj_t *brush;     // null to use the target's
+    antialias_t antialias;  // what the mask was rendered with
+    bool stale;             // text, font or size changed since it was rendered
+    bool changed;           // anything that alters its pixels changed since drawn
+    bool drawn;
+    rect_t area;            // covered by the last draw
+    rect_t dirty;
+  } label_obj_t;
+
+  // flushes any drawing deferred on the image, defined in image.cpp
+  extern void image_sync(const image_obj_t *self);
+
+  // returns the colour made from key, reusing a recent one if there is
+  // one, defined in color.cpp
+  extern color_obj_t *mp_color_get(color_kind_t kind, uint32_t key);
+
   // used by image.pen = N and picovector.pen() (global pen)
   extern brush_obj_t *mp_obj_to_brush(size_t n_args, const mp_obj_t *args);
 
@@ -88,6 +194,24 @@ extern "C" {
   extern int32_t pngdec_read_callback(PNGFILE *png, uint8_t *p, int32_t c);
   extern int32_t pngdec_seek_callback(PNGFILE *png, int32_t p);
   extern void pngdec_decode_callback(PNGDRAW *pDraw);
+
+  // the bytes of a file that can be read in place (built in assets and
+  // romfs files in xip flash) or nullptr if it has to be streamed
+  extern const uint8_t *pv_map_file(mp_obj_t path, size_t *size);
+
+  // opens a png for decoding from memory when it's mapped, otherwise
+  // through the vfs callbacks above
+  extern int pngdec_open(PNG *png, mp_obj_t path);
+
+  // decodes an opened png into target
+  extern int pngdec_decode(PNG *png, png_target_t *target);
+
+  // loads a .pvi image, which is used in place rather than copied when the
+  // file is mapped and its pixels are word aligned
+  extern image_t *pvi_load(mp_obj_t path);
+
+  // starts decoding a png on core1 and returns an image_loader for it
+  extern mp_obj_t image_load_async(mp_obj_t path, pixel_format_t pixel_format);
 }
 
 extern rect_t mp_obj_get_rect(mp_obj_t rect_in);
@@ -5,10 +5,19 @@
 // modpicovector
 extern mp_obj_t modpicovector___init__(void);
 static MP_DEFINE_CONST_FUN_OBJ_0(modpicovector___init___obj, modpicovector___init__);
+extern mp_obj_t modpicovector_memory_stats(size_t n_args, const mp_obj_t *args);
+static MP_DEFINE_CONST_FUN_OBJ_VAR_BETWEEN(modpicovector_memory_stats_obj, 0, 1, modpicovector_memory_stats);
+extern mp_obj_t modpicovector_alloc_stats(size_t n_args, const mp_obj_t *args);
+static MP_DEFINE_CONST_FUN_OBJ_VAR_BETWEEN(modpicovector_alloc_stats_obj, 0, 1, modpicovector_alloc_stats);
+extern mp_obj_t modpicovector_profile(size_t n_args, const mp_obj_t *args);
+static MP_DEFINE_CONST_FUN_OBJ_VAR_BETWEEN(modpicovector_profile_obj, 0, 1, modpicovector_profile);
 
 static const mp_rom_map_elem_t modpicovector_globals_table[] = {
     { MP_ROM_QSTR(MP_QSTR___name__), MP_ROM_QSTR(MP_QSTR_modpicovector) },
     { MP_ROM_QSTR(MP_QSTR___init__), MP_ROM_PTR(&modpicovector___init___obj) },
+    { MP_ROM_QSTR(MP_QSTR_memory_stats), MP_ROM_PTR(&modpicovector_memory_stats_obj) },
+    { MP_ROM_QSTR(MP_QSTR_alloc_stats), MP_ROM_PTR(&modpicovector_alloc_stats_obj) },
+    { MP_ROM_QSTR(MP_QSTR_profile), MP_ROM_PTR(&modpicovector_profile_obj) },
     { MP_ROM_QSTR(MP_QSTR_brush),  MP_ROM_PTR(&type_brush) },
     { MP_ROM_QSTR(MP_QSTR_color),  MP_ROM_PTR(&type_color) },
     { MP_ROM_QSTR(MP_QSTR_rect),  MP_ROM_PTR(&type_rect) },
@@ -19,6 +28,12 @@ static const mp_rom_map_elem_t modpicovector_globals_table[] = {
     { MP_ROM_QSTR(MP_QSTR_algorithm),  MP_ROM_PTR(&type_algorithm) },
     { MP_ROM_QSTR(MP_QSTR_pixel_font),  MP_ROM_PTR(&type_pixel_font) },
     { MP_ROM_QSTR(MP_QSTR_mat3),  MP_ROM_PTR(&type_mat3) },
+    { MP_ROM_QSTR(MP_QSTR_tilemap),  MP_ROM_PTR(&type_tilemap) },
+    { MP_ROM_QSTR(MP_QSTR_particles),  MP_ROM_PTR(&type_particles) },
+    { MP_ROM_QSTR(MP_QSTR_spatial_hash),  MP_ROM_PTR(&type_spatial_hash) },
+    { MP_ROM_QSTR(MP_QSTR_text),  MP_ROM_PTR(&type_text) },
+    { MP_ROM_QSTR(MP_QSTR_sdf_font),  MP_ROM_PTR(&type_sdf_font) },
+    { MP_ROM_QSTR(MP_QSTR_label),  MP_ROM_PTR(&type_label) },
     { MP_ROM_QSTR(MP_QSTR_io),  MP_ROM_PTR(&mod_input) },
 };
 static MP_DEFINE_CONST_DICT(modpicovector_globals, modpicovector_globals_table);
@@ -30,4 +45,13 @@ const mp_obj_module_t modpicovector = {
     .globals = (mp_obj_dict_t *)&modpicovector_globals,
 };
 
-MP_REGISTER_MODULE(MP_QSTR_picovector, modpicovector);
\ No newline at end of file
+MP_REGISTER_MODULE(MP_QSTR_picovector, modpicovector);
+
+// decoded images kept by image.load(path, format, True)
+MP_REGISTER_ROOT_POINTER(mp_obj_t picovector_image_cache);
+
+// the image.load_async() loader core1 is decoding for
+MP_REGISTER_ROOT_POINTER(mp_obj_t picovector_image_loader);
+
+// recently made colours, see mp_color_get() in color.cpp
+MP_REGISTER_ROOT_POINTER(mp_obj_t picovector_color_cache[64]);
\ No newline at end of file
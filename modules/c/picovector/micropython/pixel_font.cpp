@@ -12,6 +12,7 @@ extern "C" {
 
   MPY_BIND_DEL(pixel_font, {
     self(self_in, pixel_font_obj_t);
+    PV_ALLOC_SCOPE(PV_ALLOC_FONT);
 #if MICROPY_MALLOC_USES_ALLOCATED_SIZE
     m_free(self->glyph_buffer, self->glyph_buffer_size);
     m_free(self->glyph_data_buffer, self->glyph_data_buffer_size);
@@ -19,39 +20,57 @@ extern "C" {
     m_free(self->glyph_buffer);
     m_free(self->glyph_data_buffer);
 #endif
+    // a streamed font's file is closed by its own finaliser, it's swept
+    // along with the font
     return mp_const_none;
   })
 
-  MPY_BIND_STATICMETHOD_ARGS1(load, path, {
+  static bool pixel_font_read_glyph(void *context, uint32_t index, uint8_t *dst) {
+    pixel_font_obj_t *self = (pixel_font_obj_t *)context;
+    uint32_t size = self->font->glyph_data_size;
+    pv_reader_seek(&self->reader, self->glyph_data_offset + index * size);
+    return pv_reader_read(&self->reader, dst, size) == size;
+  }
+
+  // flags bit set by tools/ppf_native.py. the header is padded to 48 bytes
+  // and the glyph table is stored as pixel_font_glyph_t records, little
+  // endian, so that a mapped file can be used without copying it
+  constexpr uint16_t PPF_NATIVE = 0b10;
+  static_assert(sizeof(pixel_font_glyph_t) == 8, "native ppf glyph tables are 8 byte records");
+
+  // pixel_font.load(path, cache=0) loads a .ppf font. with a cache size in
+  // bytes a font that can't be mapped keeps only its glyph table in memory
+  // and reads bitmaps as they're first drawn into a cache of that size,
+  // for big fonts where most glyphs are never used
+  MPY_BIND_STATICMETHOD_VAR(1, load, {
+    PV_ALLOC_SCOPE(PV_ALLOC_FONT);
+    mp_obj_t path = args[0];
+    mp_int_t cache_size = n_args > 1 ? mp_obj_get_int(args[1]) : 0;
     pixel_font_obj_t *result = mp_obj_malloc_with_finaliser(pixel_font_obj_t, &type_pixel_font);
 
     // open the file for binary reading
-    //mp_obj_t args[2] = {path, MP_ROM_QSTR(MP_QSTR_r)} // Brace enclosed initialiser lists don't work in the binding macros :(
-    mp_obj_t args[2];
-    args[0] = path;
-    args[1] = MP_ROM_QSTR(MP_QSTR_r);
-    mp_obj_t file = mp_vfs_open(MP_ARRAY_SIZE(args), args, (mp_map_t *)&mp_const_empty_map);
-
-    int error;
+    pv_reader_t &file = result->reader;
+    pv_reader_open(&file, path);
 
     //debug_printf("load pixel font\n");
 
     // check for ppf file header
     char marker[4];
-    mp_stream_read_exactly(file, &marker, sizeof(marker), &error);
+    pv_reader_read(&file, &marker, sizeof(marker));
     if(memcmp(marker, "ppf!", 4) != 0) {
+      pv_reader_close(&file);
       mp_raise_msg_varg(&mp_type_OSError, MP_ERROR_TEXT("failed to load font, missing PPF header"));
     }
     //debug_printf("- valid header\n");
 
-    uint16_t flags        = ru16(file);
-    uint32_t glyph_count  = ru32(file);
-    uint16_t glyph_width  = ru16(file);
-    uint16_t glyph_height = ru16(file);
+    uint16_t flags        = ru16(&file);
+    uint32_t glyph_count  = ru32(&file);
+    uint16_t glyph_width  = ru16(&file);
+    uint16_t glyph_height = ru16(&file);
     //debug_printf("- glyph width = %d, height = %d, count = %" PRIu32 "\n", glyph_width, glyph_height, glyph_count);
 
     char name[32];
-    mp_stream_read_exactly(file, name, sizeof(name), &error);
+    pv_reader_read(&file, name, sizeof(name));
     //debug_printf("- font name '%s'\n", name);
 
     // calculate how much data needed to store each glyphs pixel data
@@ -59,32 +78,61 @@ extern "C" {
     uint32_t glyph_data_size = bpr * glyph_height;
     //debug_printf("- glyph data size = %" PRIu32 " (%" PRIu32 " byes per row)\n", glyph_data_size, bpr);
 
-    // allocate buffers to store glyph and pixel data
-    result->glyph_buffer_size = sizeof(pixel_font_glyph_t) * glyph_count;
-    result->glyph_buffer = (uint8_t*)m_malloc(result->glyph_buffer_size);
-
-    result->glyph_data_buffer_size = glyph_data_size * glyph_count;
-    result->glyph_data_buffer = (uint8_t*)m_malloc(result->glyph_data_buffer_size);
-
-    //debug_printf("- glyph buffer at %p (%" PRIu32 " bytes)\n", result->glyph_buffer, result->glyph_buffer_size);
-    //debug_printf("- glyph data buffer at %p (%" PRIu32 " bytes)\n", result->glyph_data_buffer, result->glyph_data_buffer_size);
-
-    if(!result->glyph_buffer || !result->glyph_data_buffer) {
-      mp_raise_msg_varg(&mp_type_OSError, MP_ERROR_TEXT("couldn't allocate buffer for font data"));
+    // mapped files (romfs, built in assets) are used in place where their
+    // layout allows, the glyph bitmaps always and native glyph tables when
+    // they're word aligned. anything else is read into the heap
+    result->glyph_buffer = nullptr;
+    result->glyph_buffer_size = 0;
+    result->glyph_data_buffer = nullptr;
+    result->glyph_data_buffer_size = 0;
+
+    pixel_font_glyph_t *glyphs;
+    if(flags & PPF_NATIVE) {
+      ru16(&file); // padding that aligns the table
+
+      size_t table_size = sizeof(pixel_font_glyph_t) * glyph_count;
+      const uint8_t *table = pv_reader_map(&file, table_size);
+      if(table && (uintptr_t(table) & 3) == 0) {
+        glyphs = (pixel_font_glyph_t *)table;
+      }else{
+        result->glyph_buffer_size = table_size;
+        result->glyph_buffer = (uint8_t*)m_malloc(result->glyph_buffer_size);
+        if(table) {
+          memcpy(result->glyph_buffer, table, table_size);
+        }else{
+          pv_reader_read(&file, result->glyph_buffer, table_size);
+        }
+        glyphs = (pixel_font_glyph_t *)result->glyph_buffer;
+      }
+    }else{
+      result->glyph_buffer_size = sizeof(pixel_font_glyph_t) * glyph_count;
+      result->glyph_buffer = (uint8_t*)m_malloc(result->glyph_buffer_size);
+      glyphs = (pixel_font_glyph_t *)result->glyph_buffer;
+      for(uint32_t i = 0; i < glyph_count; i++) {
+        glyphs[i].codepoint = ru32(&file);
+        glyphs[i].width = ru16(&file);
+      }
     }
 
-    // read codepoint list
-    pixel_font_glyph_t *glyphs = (pixel_font_glyph_t*)result->glyph_buffer;
+    // lookups binary search the table and drawing trusts the widths, so a
+    // table used in place is checked as thoroughly as one that was read
     for(uint32_t i = 0; i < glyph_count; i++) {
-      glyphs[i].codepoint = ru32(file);
-      glyphs[i].width = ru16(file);
+      if(glyphs[i].width > glyph_width || (i > 0 && glyphs[i].codepoint <= glyphs[i - 1].codepoint)) {
+        pv_reader_close(&file);
+        mp_raise_msg_varg(&mp_type_OSError, MP_ERROR_TEXT("failed to load font, invalid glyph table"));
+      }
     }
-    //debug_printf("- read codepoint list\n");
 
-    // read glyph data into buffer
-    //debug_printf("- writing into glyph data buffer\n");
-    mp_stream_read_exactly(file, result->glyph_data_buffer, result->glyph_data_buffer_size, &error);
-    //debug_printf("- read pixel data\n");
+    size_t glyph_data_total = glyph_data_size * glyph_count;
+    result->glyph_data_offset = file.offset + file.pos;
+    uint8_t *glyph_data = (uint8_t *)pv_reader_map(&file, glyph_data_total);
+    bool streamed = !glyph_data && cache_size > 0 && glyph_data_size > 0 && size_t(cache_size) < glyph_data_total;
+    if(!glyph_data && !streamed) {
+      result->glyph_data_buffer_size = glyph_data_total;
+      result->glyph_data_buffer = (uint8_t*)m_malloc(result->glyph_data_buffer_size);
+      pv_reader_read(&file, result->glyph_data_buffer, result->glyph_data_buffer_size);
+      glyph_data = result->glyph_data_buffer;
+    }
 
     result->font = m_new_class(pixel_font_t);
     result->font->glyph_count     = glyph_count;
@@ -92,10 +140,27 @@ extern "C" {
     result->font->height          = glyph_height;
     result->font->glyph_data_size = glyph_data_size;
     result->font->glyphs          = glyphs;
-    result->font->glyph_data      = result->glyph_data_buffer;
+    result->font->glyph_data      = glyph_data;
     strcpy(result->font->name, name);
+    result->font->fallback        = nullptr;
+    result->fallback = mp_const_none;
+
+    result->font->source = {result, pixel_font_read_glyph};
+    result->font->cache = {};
+    if(streamed) {
+      pixel_font_cache_t *c = &result->font->cache;
+      c->count = std::max(1u, uint32_t(cache_size / glyph_data_size));
+      c->bitmaps = m_new(uint8_t, c->count * glyph_data_size);
+      c->index = m_new(int32_t, c->count);
+      c->used = m_new(uint32_t, c->count);
+      for(uint32_t i = 0; i < c->count; i++) {
+        c->index[i] = -1;
+        c->used[i] = 0;
+      }
+      return MP_OBJ_FROM_PTR(result);
+    }
 
-    mp_stream_close(file);
+    pv_reader_close(&file);
 
     return MP_OBJ_FROM_PTR(result);
   })
@@ -119,6 +184,35 @@ extern "C" {
           return;
         }
       };
+
+      // font.fallback supplies glyphs this font doesn't have
+      case MP_QSTR_fallback: {
+        if(action == GET) {
+          dest[0] = self->fallback;
+          return;
+        }
+
+        if(action == SET) {
+          pixel_font_t *fallback = nullptr;
+          if(dest[1] != mp_const_none) {
+            if(!mp_obj_is_type(dest[1], &type_pixel_font)) {
+              mp_raise_TypeError(MP_ERROR_TEXT("value must be of type pixel_font or None"));
+            }
+            fallback = ((pixel_font_obj_t *)MP_OBJ_TO_PTR(dest[1]))->font;
+            for(pixel_font_t *f = fallback; f; f = f->fallback) {
+              if(f == self->font) {
+                mp_raise_ValueError(MP_ERROR_TEXT("fallback chain can't loop back to this font"));
+              }
+            }
+          }
+
+          self->fallback = dest[1];
+          self->font->fallback = fallback;
+          font_fallback_generation++;
+          dest[0] = MP_OBJ_NULL;
+          return;
+        }
+      };
     }
 
     // we didn't handle this, fall back to alternative methods
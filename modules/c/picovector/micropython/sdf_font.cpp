@@ -0,0 +1,172 @@
+#include "mp_tracked_allocator.hpp"
+
+#include "mp_helpers.hpp"
+#include "picovector.hpp"
+
+extern "C" {
+  #include "py/runtime.h"
+
+  // .sdf files, written by tools/af2sdf.py, are little endian:
+  //
+  //   header   "sdf!", u8 version, u8 flags, u16 glyph count, u16 font units
+  //            per em, u8 field pixels per em, u8 spread in field pixels
+  //   glyphs   12 byte sdf_glyph_t records sorted by codepoint
+  //   data     each glyph's w * h distance bytes, rows top to bottom
+  //
+  // the header keeps the table word aligned so a mapped file's can be used
+  // in place, the distance data is always used in place when mapped
+  constexpr uint8_t SDF_VERSION = 1;
+  static_assert(sizeof(sdf_glyph_t) == 12, "sdf glyph tables are 12 byte records");
+
+  MPY_BIND_DEL(sdf_font, {
+    self(self_in, sdf_font_obj_t);
+    PV_ALLOC_SCOPE(PV_ALLOC_FONT);
+#if MICROPY_MALLOC_USES_ALLOCATED_SIZE
+    m_free(self->glyph_buffer, self->glyph_buffer_size);
+    m_free(self->data_buffer, self->data_buffer_size);
+#else
+    m_free(self->glyph_buffer);
+    m_free(self->data_buffer);
+#endif
+    return mp_const_none;
+  })
+
+  // sdf_font.load(path)
+  MPY_BIND_STATICMETHOD_ARGS1(load, path, {
+    PV_ALLOC_SCOPE(PV_ALLOC_FONT);
+    sdf_font_obj_t *result = mp_obj_malloc_with_finaliser(sdf_font_obj_t, &type_sdf_font);
+    result->glyph_buffer = nullptr;
+    result->glyph_buffer_size = 0;
+    result->data_buffer = nullptr;
+    result->data_buffer_size = 0;
+
+    pv_reader_t file;
+    pv_reader_open(&file, path);
+
+    uint8_t header[12];
+    if(pv_reader_read(&file, header, sizeof(header)) != sizeof(header) || memcmp(header, "sdf!", 4) != 0) {
+      pv_reader_close(&file);
+      mp_raise_msg_varg(&mp_type_OSError, MP_ERROR_TEXT("failed to load font, missing SDF header"));
+    }
+    if(header[4] != SDF_VERSION) {
+      pv_reader_close(&file);
+      mp_raise_msg_varg(&mp_type_OSError, MP_ERROR_TEXT("failed to load font, unsupported SDF version %d"), header[4]);
+    }
+
+    uint16_t glyph_count  = header[6] | (header[7] << 8);
+    uint16_t units_per_em = header[8] | (header[9] << 8);
+    uint8_t field_per_em  = header[10];
+    uint8_t spread        = header[11];
+    if(!units_per_em || !field_per_em || !spread) {
+      pv_reader_close(&file);
+      mp_raise_msg_varg(&mp_type_OSError, MP_ERROR_TEXT("failed to load font, invalid SDF header"));
+    }
+
+    sdf_glyph_t *glyphs;
+    size_t table_size = sizeof(sdf_glyph_t) * glyph_count;
+    const uint8_t *table = pv_reader_map(&file, table_size);
+    if(table && (uintptr_t(table) & 3) == 0) {
+      glyphs = (sdf_glyph_t *)table;
+    }else{
+      result->glyph_buffer_size = table_size;
+      result->glyph_buffer = (uint8_t*)m_malloc(result->glyph_buffer_size);
+      if(table) {
+        memcpy(result->glyph_buffer, table, table_size);
+      }else if(pv_reader_read(&file, result->glyph_buffer, table_size) != table_size) {
+        pv_reader_close(&file);
+        mp_raise_msg_varg(&mp_type_OSError, MP_ERROR_TEXT("failed to load font, glyph table is truncated"));
+      }
+      glyphs = (sdf_glyph_t *)result->glyph_buffer;
+    }
+
+    // lookups binary search the table, and the data has to hold every
+    // glyph's bitmap
+    size_t data_size = 0;
+    for(uint16_t i = 0; i < glyph_count; i++) {
+      if(i > 0 && glyphs[i].codepoint <= glyphs[i - 1].codepoint) {
+        pv_reader_close(&file);
+        mp_raise_msg_varg(&mp_type_OSError, MP_ERROR_TEXT("failed to load font, invalid glyph table"));
+      }
+      data_size = std::max(data_size, size_t(glyphs[i].offset) + glyphs[i].w * glyphs[i].h);
+    }
+
+    const uint8_t *data = pv_reader_map(&file, data_size);
+    if(!data) {
+      result->data_buffer_size = data_size;
+      result->data_buffer = (uint8_t*)m_malloc(result->data_buffer_size);
+      if(pv_reader_read(&file, result->data_buffer, data_size) != data_size) {
+        pv_reader_close(&file);
+        mp_raise_msg_varg(&mp_type_OSError, MP_ERROR_TEXT("failed to load font, glyph data is truncated"));
+      }
+      data = result->data_buffer;
+    }
+
+    pv_reader_close(&file);
+
+    result->font.glyph_count  = glyph_count;
+    result->font.glyphs       = glyphs;
+    result->font.data         = data;
+    result->font.units_per_em = units_per_em;
+    result->font.field_per_em = field_per_em;
+    result->font.spread       = spread;
+
+    return MP_OBJ_FROM_PTR(result);
+  })
+
+  // draw(image, text, x, y, size, effect=FILL, width=0) draws text into image
+  // with the image's brush, width sets how wide OUTLINE and GLOW reach
+  MPY_BIND_VAR(6, draw, {
+    self(args[0], sdf_font_obj_t);
+
+    if(!mp_obj_is_type(args[1], &type_image)) {
+      mp_raise_msg_varg(&mp_type_TypeError, MP_ERROR_TEXT("invalid parameter, expected draw(image, text, x, y, size, effect=FILL, width=0)"));
+    }
+    const image_obj_t *target = (image_obj_t *)MP_OBJ_TO_PTR(args[1]);
+    const char *text = mp_obj_str_get_str(args[2]);
+    float x = mp_obj_get_float(args[3]);
+    float y = mp_obj_get_float(args[4]);
+    float size = mp_obj_get_float(args[5]);
+    int effect = n_args > 6 ? mp_obj_get_int(args[6]) : sdf_font_t::FILL;
+    float width = n_args > 7 ? mp_obj_get_float(args[7]) : 0.0f;
+    if(effect < sdf_font_t::FILL || effect > sdf_font_t::GLOW) {
+      mp_raise_msg_varg(&mp_type_ValueError, MP_ERROR_TEXT("effect must be FILL, OUTLINE or GLOW"));
+    }
+
+    image_sync(target);
+    self->font.draw(target->image, text, x, y, size, sdf_font_t::effect_t(effect), width);
+    return mp_const_none;
+  })
+
+  // measure(text, size) returns the (width, height) text covers at size
+  MPY_BIND_VAR(3, measure, {
+    self(args[0], sdf_font_obj_t);
+    const char *text = mp_obj_str_get_str(args[1]);
+    rect_t r = self->font.measure(text, mp_obj_get_float(args[2]));
+    mp_obj_t result[2] = {mp_obj_new_float(r.w), mp_obj_new_float(r.h)};
+    return mp_obj_new_tuple(2, result);
+  })
+
+  static void sdf_font_print(const mp_print_t *print, mp_obj_t self_in, mp_print_kind_t kind) {
+    self(self_in, sdf_font_obj_t);
+    mp_printf(print, "sdf_font(glyphs=%d)", self->font.glyph_count);
+  }
+
+  MPY_BIND_LOCALS_DICT(sdf_font,
+      MPY_BIND_ROM_PTR_DEL(sdf_font),
+      MPY_BIND_ROM_PTR_STATIC(load),
+      MPY_BIND_ROM_PTR(draw),
+      MPY_BIND_ROM_PTR(measure),
+      { MP_ROM_QSTR(MP_QSTR_FILL), MP_ROM_INT(sdf_font_t::FILL)},
+      { MP_ROM_QSTR(MP_QSTR_OUTLINE), MP_ROM_INT(sdf_font_t::OUTLINE)},
+      { MP_ROM_QSTR(MP_QSTR_GLOW), MP_ROM_INT(sdf_font_t::GLOW)},
+  )
+
+  MP_DEFINE_CONST_OBJ_TYPE(
+      type_sdf_font,
+      MP_QSTR_sdf_font,
+      MP_TYPE_FLAG_NONE,
+      print, (const void *)sdf_font_print,
+      locals_dict, &sdf_font_locals_dict
+  );
+
+}
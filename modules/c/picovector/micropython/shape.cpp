@@ -7,51 +7,61 @@ extern "C" {
 
   mp_obj_t shape__del__(mp_obj_t self_in) {
     self(self_in, shape_obj_t);
+    PV_ALLOC_SCOPE(PV_ALLOC_SHAPE);
     m_del_class(shape_t, self->shape);
     return mp_const_none;
   }
   static MP_DEFINE_CONST_FUN_OBJ_1(shape__del___obj, shape__del__);
 
   MPY_BIND_STATICMETHOD_VAR(1, custom, {
-    shape_obj_t *shape = mp_obj_malloc_with_finaliser(shape_obj_t, &type_shape);
-
+    PV_ALLOC_SCOPE(PV_ALLOC_SHAPE);
     size_t path_count = n_args;
-    shape->shape = new(PV_MALLOC(sizeof(shape_t))) shape_t(path_count);
 
+    // size the shape's point storage up front so it's only allocated once
+    size_t total_points = 0;
     for (size_t i = 0; i < path_count; i++) {
       if(!mp_obj_is_type(args[i], &mp_type_list)) {
         mp_raise_msg_varg(&mp_type_TypeError, MP_ERROR_TEXT("invalid parameter, expected custom([p1, p2, p3, ...], ...)"));
       }
+      size_t points_count;
+      mp_obj_t *points;
+      mp_obj_list_get(args[i], &points_count, &points);
+      total_points += points_count;
+    }
+
+    shape_obj_t *shape = mp_obj_malloc_with_finaliser(shape_obj_t, &type_shape);
+    shape->shape = new(PV_MALLOC(sizeof(shape_t))) shape_t(path_count, total_points);
 
+    for (size_t i = 0; i < path_count; i++) {
       size_t points_count;
       mp_obj_t *points;
       mp_obj_list_get(args[i], &points_count, &points);
 
-      path_t poly(points_count);
+      shape->shape->begin_path();
       for(size_t i = 0; i < points_count; i++) {
         if(!mp_obj_is_type(points[i], &type_vec2)) {
           mp_raise_msg_varg(&mp_type_TypeError, MP_ERROR_TEXT("invalid parameter, expected custom([p1, p2, p3, ...])"));
         }
         const vec2_obj_t *point = (vec2_obj_t *)MP_OBJ_TO_PTR(points[i]);
-        poly.add_point(point->v);
+        shape->shape->add_point(point->v);
       }
-      shape->shape->add_path(poly);
     }
 
     return MP_OBJ_FROM_PTR(shape);
   })
 
-  MPY_BIND_STATICMETHOD_VAR(4, regular_polygon, {
+  // the primitives' arguments are parsed here for both the static
+  // constructors and the set_ methods that rebuild a shape in place
+
+  static void shape_set_regular_polygon(shape_t *shape, size_t n_args, const mp_obj_t *args) {
     float x = mp_obj_get_float(args[0]);
     float y = mp_obj_get_float(args[1]);
     float r = mp_obj_get_float(args[2]);
     int s = mp_obj_get_float(args[3]);
-    shape_obj_t *shape = mp_obj_malloc_with_finaliser(shape_obj_t, &type_shape);
-    shape->shape = regular_polygon(x, y, s, r);
-    return MP_OBJ_FROM_PTR(shape);
-  })
+    set_regular_polygon(shape, x, y, s, r);
+  }
 
-  MPY_BIND_STATICMETHOD_VAR(2, circle, {
+  static void shape_set_circle(shape_t *shape, size_t n_args, const mp_obj_t *args) {
     float x;
     float y;
     float r;
@@ -65,23 +75,18 @@ extern "C" {
       y = mp_obj_get_float(args[1]);
       r = mp_obj_get_float(args[2]);
     }
+    set_circle(shape, x, y, r);
+  }
 
-    shape_obj_t *shape = mp_obj_malloc_with_finaliser(shape_obj_t, &type_shape);
-    shape->shape = circle(x, y, r);
-    return MP_OBJ_FROM_PTR(shape);
-  })
-
-  MPY_BIND_STATICMETHOD_VAR(4, rectangle, {
+  static void shape_set_rectangle(shape_t *shape, size_t n_args, const mp_obj_t *args) {
     float x = mp_obj_get_float(args[0]);
     float y = mp_obj_get_float(args[1]);
     float w = mp_obj_get_float(args[2]);
     float h = mp_obj_get_float(args[3]);
-    shape_obj_t *shape = mp_obj_malloc_with_finaliser(shape_obj_t, &type_shape);
-    shape->shape = rectangle(x, y, w, h);
-    return MP_OBJ_FROM_PTR(shape);
-  })
+    set_rectangle(shape, x, y, w, h);
+  }
 
-  MPY_BIND_STATICMETHOD_VAR(5, rounded_rectangle, {
+  static void shape_set_rounded_rectangle(shape_t *shape, size_t n_args, const mp_obj_t *args) {
     float x = mp_obj_get_float(args[0]);
     float y = mp_obj_get_float(args[1]);
     float w = mp_obj_get_float(args[2]);
@@ -93,13 +98,10 @@ extern "C" {
     if(n_args >= 6) { r2 = mp_obj_get_float(args[5]); }
     if(n_args >= 7) { r3 = mp_obj_get_float(args[6]); }
     if(n_args >= 8) { r4 = mp_obj_get_float(args[7]); }
+    set_rounded_rectangle(shape, x, y, w, h, r1, r2, r3, r4);
+  }
 
-    shape_obj_t *shape = mp_obj_malloc_with_finaliser(shape_obj_t, &type_shape);
-    shape->shape = rounded_rectangle(x, y, w, h, r1, r2, r3, r4);
-    return MP_OBJ_FROM_PTR(shape);
-  })
-
-  MPY_BIND_STATICMETHOD_VAR(3, squircle, {
+  static void shape_set_squircle(shape_t *shape, size_t n_args, const mp_obj_t *args) {
     float x = mp_obj_get_float(args[0]);
     float y = mp_obj_get_float(args[1]);
     float s = mp_obj_get_float(args[2]);
@@ -109,60 +111,212 @@ extern "C" {
       n = max(2.0f, n);
       n = max(2.0f, n);
     }
-    shape_obj_t *shape = mp_obj_malloc_with_finaliser(shape_obj_t, &type_shape);
-    shape->shape = squircle(x, y, s, n);
-    return MP_OBJ_FROM_PTR(shape);
-  })
+    set_squircle(shape, x, y, s, n);
+  }
 
-  MPY_BIND_STATICMETHOD_VAR(6, arc, {
+  static void shape_set_arc(shape_t *shape, size_t n_args, const mp_obj_t *args) {
     float x = mp_obj_get_float(args[0]);
     float y = mp_obj_get_float(args[1]);
     float i = mp_obj_get_float(args[2]);
     float o = mp_obj_get_float(args[3]);
     float f = mp_obj_get_float(args[4]);
     float t = mp_obj_get_float(args[5]);
-    shape_obj_t *shape = mp_obj_malloc_with_finaliser(shape_obj_t, &type_shape);
-    shape->shape = arc(x, y, f, t, i, o);
-    return MP_OBJ_FROM_PTR(shape);
-  })
+    set_arc(shape, x, y, f, t, i, o);
+  }
 
-  MPY_BIND_STATICMETHOD_VAR(4, pie, {
+  static void shape_set_pie(shape_t *shape, size_t n_args, const mp_obj_t *args) {
     float x = mp_obj_get_float(args[0]);
     float y = mp_obj_get_float(args[1]);
     float r = mp_obj_get_float(args[2]);
     float f = mp_obj_get_float(args[3]);
     float t = mp_obj_get_float(args[4]);
-    shape_obj_t *shape = mp_obj_malloc_with_finaliser(shape_obj_t, &type_shape);
-    shape->shape = pie(x, y, f, t, r);
-    return MP_OBJ_FROM_PTR(shape);
-  })
+    set_pie(shape, x, y, f, t, r);
+  }
 
-  MPY_BIND_STATICMETHOD_VAR(4, star, {
+  static void shape_set_star(shape_t *shape, size_t n_args, const mp_obj_t *args) {
     float x = mp_obj_get_float(args[0]);
     float y = mp_obj_get_float(args[1]);
     int s = mp_obj_get_float(args[2]);
     float ro = mp_obj_get_float(args[3]);
     float ri = mp_obj_get_float(args[4]);
-    shape_obj_t *shape = mp_obj_malloc_with_finaliser(shape_obj_t, &type_shape);
-    shape->shape = star(x, y, s, ro, ri);
-    return MP_OBJ_FROM_PTR(shape);
-  })
+    set_star(shape, x, y, s, ro, ri);
+  }
 
-  MPY_BIND_STATICMETHOD_VAR(5, line, {
+  static void shape_set_line(shape_t *shape, size_t n_args, const mp_obj_t *args) {
     float x1 = mp_obj_get_float(args[0]);
     float y1 = mp_obj_get_float(args[1]);
     float x2 = mp_obj_get_float(args[2]);
     float y2 = mp_obj_get_float(args[3]);
     float w = mp_obj_get_float(args[4]);
+    set_line(shape, x1, y1, x2, y2, w);
+  }
+
+  // the shape object owns its shape_t from the start so its finaliser frees
+  // it if the arguments turn out to be bad
+  static shape_obj_t *shape_new_primitive() {
+    PV_ALLOC_SCOPE(PV_ALLOC_SHAPE);
+    shape_obj_t *shape = mp_obj_malloc_with_finaliser(shape_obj_t, &type_shape);
+    shape->shape = new(PV_MALLOC(sizeof(shape_t))) shape_t(1);
+    return shape;
+  }
+
+  // shape.circle(...) and friends make a new shape, shape.set_circle(...)
+  // and friends rebuild an existing one in place reusing its storage.
+  // another shape can be turned into any primitive this way, its transform,
+  // stroke, and brush are kept. deferred images read a shape when they're
+  // flushed, so drawing one, rebuilding it, and drawing it again before a
+  // flush draws the last geometry twice
+
+  MPY_BIND_STATICMETHOD_VAR(4, regular_polygon, {
+    shape_obj_t *shape = shape_new_primitive();
+    shape_set_regular_polygon(shape->shape, n_args, args);
+    return MP_OBJ_FROM_PTR(shape);
+  })
+
+  MPY_BIND_VAR(5, set_regular_polygon, {
+    const shape_obj_t *self = (shape_obj_t *)MP_OBJ_TO_PTR(args[0]);
+    shape_set_regular_polygon(self->shape, n_args - 1, args + 1);
+    return MP_OBJ_FROM_PTR(self);
+  })
+
+  MPY_BIND_STATICMETHOD_VAR(2, circle, {
+    shape_obj_t *shape = shape_new_primitive();
+    shape_set_circle(shape->shape, n_args, args);
+    return MP_OBJ_FROM_PTR(shape);
+  })
+
+  MPY_BIND_VAR(3, set_circle, {
+    const shape_obj_t *self = (shape_obj_t *)MP_OBJ_TO_PTR(args[0]);
+    shape_set_circle(self->shape, n_args - 1, args + 1);
+    return MP_OBJ_FROM_PTR(self);
+  })
+
+  MPY_BIND_STATICMETHOD_VAR(4, rectangle, {
+    shape_obj_t *shape = shape_new_primitive();
+    shape_set_rectangle(shape->shape, n_args, args);
+    return MP_OBJ_FROM_PTR(shape);
+  })
+
+  MPY_BIND_VAR(5, set_rectangle, {
+    const shape_obj_t *self = (shape_obj_t *)MP_OBJ_TO_PTR(args[0]);
+    shape_set_rectangle(self->shape, n_args - 1, args + 1);
+    return MP_OBJ_FROM_PTR(self);
+  })
+
+  MPY_BIND_STATICMETHOD_VAR(5, rounded_rectangle, {
+    shape_obj_t *shape = shape_new_primitive();
+    shape_set_rounded_rectangle(shape->shape, n_args, args);
+    return MP_OBJ_FROM_PTR(shape);
+  })
+
+  MPY_BIND_VAR(6, set_rounded_rectangle, {
+    const shape_obj_t *self = (shape_obj_t *)MP_OBJ_TO_PTR(args[0]);
+    shape_set_rounded_rectangle(self->shape, n_args - 1, args + 1);
+    return MP_OBJ_FROM_PTR(self);
+  })
+
+  MPY_BIND_STATICMETHOD_VAR(3, squircle, {
+    shape_obj_t *shape = shape_new_primitive();
+    shape_set_squircle(shape->shape, n_args, args);
+    return MP_OBJ_FROM_PTR(shape);
+  })
+
+  MPY_BIND_VAR(4, set_squircle, {
+    const shape_obj_t *self = (shape_obj_t *)MP_OBJ_TO_PTR(args[0]);
+    shape_set_squircle(self->shape, n_args - 1, args + 1);
+    return MP_OBJ_FROM_PTR(self);
+  })
+
+  MPY_BIND_STATICMETHOD_VAR(6, arc, {
+    shape_obj_t *shape = shape_new_primitive();
+    shape_set_arc(shape->shape, n_args, args);
+    return MP_OBJ_FROM_PTR(shape);
+  })
+
+  MPY_BIND_VAR(7, set_arc, {
+    const shape_obj_t *self = (shape_obj_t *)MP_OBJ_TO_PTR(args[0]);
+    shape_set_arc(self->shape, n_args - 1, args + 1);
+    return MP_OBJ_FROM_PTR(self);
+  })
+
+  MPY_BIND_STATICMETHOD_VAR(4, pie, {
+    shape_obj_t *shape = shape_new_primitive();
+    shape_set_pie(shape->shape, n_args, args);
+    return MP_OBJ_FROM_PTR(shape);
+  })
+
+  MPY_BIND_VAR(5, set_pie, {
+    const shape_obj_t *self = (shape_obj_t *)MP_OBJ_TO_PTR(args[0]);
+    shape_set_pie(self->shape, n_args - 1, args + 1);
+    return MP_OBJ_FROM_PTR(self);
+  })
+
+  MPY_BIND_STATICMETHOD_VAR(4, star, {
+    shape_obj_t *shape = shape_new_primitive();
+    shape_set_star(shape->shape, n_args, args);
+    return MP_OBJ_FROM_PTR(shape);
+  })
+
+  MPY_BIND_VAR(5, set_star, {
+    const shape_obj_t *self = (shape_obj_t *)MP_OBJ_TO_PTR(args[0]);
+    shape_set_star(self->shape, n_args - 1, args + 1);
+    return MP_OBJ_FROM_PTR(self);
+  })
+
+  MPY_BIND_STATICMETHOD_VAR(5, line, {
+    shape_obj_t *shape = shape_new_primitive();
+    shape_set_line(shape->shape, n_args, args);
+    return MP_OBJ_FROM_PTR(shape);
+  })
+
+  MPY_BIND_VAR(6, set_line, {
+    const shape_obj_t *self = (shape_obj_t *)MP_OBJ_TO_PTR(args[0]);
+    shape_set_line(self->shape, n_args - 1, args + 1);
+    return MP_OBJ_FROM_PTR(self);
+  })
+
+  // an open path through the points, only useful stroked since it has no
+  // inside to fill
+  MPY_BIND_STATICMETHOD_VAR(1, polyline, {
+    PV_ALLOC_SCOPE(PV_ALLOC_SHAPE);
+    if(!mp_obj_is_type(args[0], &mp_type_list)) {
+      mp_raise_msg_varg(&mp_type_TypeError, MP_ERROR_TEXT("invalid parameter, expected polyline([p1, p2, p3, ...])"));
+    }
+
+    size_t points_count;
+    mp_obj_t *points;
+    mp_obj_list_get(args[0], &points_count, &points);
+
     shape_obj_t *shape = mp_obj_malloc_with_finaliser(shape_obj_t, &type_shape);
-    shape->shape = line(x1, y1, x2, y2, w);
+    shape->shape = new(PV_MALLOC(sizeof(shape_t))) shape_t(1, points_count);
+
+    shape->shape->begin_path(false);
+    for(size_t i = 0; i < points_count; i++) {
+      if(!mp_obj_is_type(points[i], &type_vec2)) {
+        mp_raise_msg_varg(&mp_type_TypeError, MP_ERROR_TEXT("invalid parameter, expected polyline([p1, p2, p3, ...])"));
+      }
+      const vec2_obj_t *point = (vec2_obj_t *)MP_OBJ_TO_PTR(points[i]);
+      shape->shape->add_point(point->v);
+    }
+
     return MP_OBJ_FROM_PTR(shape);
   })
 
-  MPY_BIND_VAR(1, stroke, {
+  MPY_BIND_VAR(2, stroke, {
     const shape_obj_t *self = (shape_obj_t *)MP_OBJ_TO_PTR(args[0]);
     float width = mp_obj_get_float(args[1]);
-    self->shape->stroke(width);
+
+    int join = n_args > 2 ? mp_obj_get_int(args[2]) : JOIN_MITER;
+    if(join < JOIN_MITER || join > JOIN_BEVEL) {
+      mp_raise_msg_varg(&mp_type_ValueError, MP_ERROR_TEXT("invalid join, expected JOIN_MITER, JOIN_ROUND, or JOIN_BEVEL"));
+    }
+
+    int cap = n_args > 3 ? mp_obj_get_int(args[3]) : CAP_BUTT;
+    if(cap < CAP_BUTT || cap > CAP_SQUARE) {
+      mp_raise_msg_varg(&mp_type_ValueError, MP_ERROR_TEXT("invalid cap, expected CAP_BUTT, CAP_ROUND, or CAP_SQUARE"));
+    }
+
+    self->shape->stroke(width, join_t(join), cap_t(cap));
     return MP_OBJ_FROM_PTR(self);
   })
 
@@ -212,6 +366,23 @@ extern "C" {
     MPY_BIND_ROM_PTR_STATIC(pie),
     MPY_BIND_ROM_PTR_STATIC(star),
     MPY_BIND_ROM_PTR_STATIC(line),
+    MPY_BIND_ROM_PTR_STATIC(polyline),
+    MPY_BIND_ROM_PTR(set_regular_polygon),
+    MPY_BIND_ROM_PTR(set_squircle),
+    MPY_BIND_ROM_PTR(set_circle),
+    MPY_BIND_ROM_PTR(set_rectangle),
+    MPY_BIND_ROM_PTR(set_rounded_rectangle),
+    MPY_BIND_ROM_PTR(set_arc),
+    MPY_BIND_ROM_PTR(set_pie),
+    MPY_BIND_ROM_PTR(set_star),
+    MPY_BIND_ROM_PTR(set_line),
+
+    { MP_ROM_QSTR(MP_QSTR_JOIN_MITER), MP_ROM_INT(JOIN_MITER)},
+    { MP_ROM_QSTR(MP_QSTR_JOIN_ROUND), MP_ROM_INT(JOIN_ROUND)},
+    { MP_ROM_QSTR(MP_QSTR_JOIN_BEVEL), MP_ROM_INT(JOIN_BEVEL)},
+    { MP_ROM_QSTR(MP_QSTR_CAP_BUTT), MP_ROM_INT(CAP_BUTT)},
+    { MP_ROM_QSTR(MP_QSTR_CAP_ROUND), MP_ROM_INT(CAP_ROUND)},
+    { MP_ROM_QSTR(MP_QSTR_CAP_SQUARE), MP_ROM_INT(CAP_SQUARE)},
   )
 
   MP_DEFINE_CONST_OBJ_TYPE(
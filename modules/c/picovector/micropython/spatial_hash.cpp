@@ -0,0 +1,191 @@
+#include "mp_tracked_allocator.hpp"
+
+#include "mp_helpers.hpp"
+#include "picovector.hpp"
+
+extern "C" {
+  #include "py/runtime.h"
+
+  static int spatial_hash_handle(const spatial_hash_obj_t *self, mp_obj_t handle_in) {
+    int handle = mp_obj_get_int(handle_in);
+    if(handle < 0 || handle >= self->hash->capacity()) {
+      mp_raise_msg_varg(&mp_type_IndexError, MP_ERROR_TEXT("handle out of range"));
+    }
+    return handle;
+  }
+
+  static mp_buffer_info_t spatial_hash_out(mp_obj_t out_in) {
+    mp_buffer_info_t out;
+    mp_get_buffer_raise(out_in, &out, MP_BUFFER_WRITE);
+    if(out.typecode != 'H') {
+      mp_raise_msg_varg(&mp_type_ValueError, MP_ERROR_TEXT("out must be an array('H')"));
+    }
+    return out;
+  }
+
+  MPY_BIND_DEL(spatial_hash, {
+    self(self_in, spatial_hash_obj_t);
+    m_del_class(spatial_hash_t, self->hash);
+    return mp_const_none;
+  })
+
+  // spatial_hash(cell_size, capacity) holds up to capacity boxes, cells
+  // around the size of the boxes usually work best
+  MPY_BIND_NEW(spatial_hash, {
+    if(n_args != 2) {
+      mp_raise_msg_varg(&mp_type_ValueError, MP_ERROR_TEXT("invalid parameters, expected spatial_hash(cell_size, capacity)"));
+    }
+
+    float cell_size = mp_obj_get_float(args[0]);
+    int capacity = mp_obj_get_int(args[1]);
+    if(cell_size <= 0.0f || capacity <= 0 || capacity > spatial_hash_t::MAX_CAPACITY) {
+      mp_raise_msg_varg(&mp_type_ValueError, MP_ERROR_TEXT("cell size must be positive and capacity from 1 to 65535"));
+    }
+
+    spatial_hash_obj_t *self = mp_obj_malloc_with_finaliser(spatial_hash_obj_t, type);
+    self->hash = m_new_class(spatial_hash_t, cell_size, capacity);
+    self->objects = m_new(mp_obj_t, capacity);
+    for(int i = 0; i < capacity; i++) {
+      self->objects[i] = mp_const_none;
+    }
+    return MP_OBJ_FROM_PTR(self);
+  })
+
+  // insert(rect, obj=None) files rect in a free slot and returns its
+  // handle, obj is kept alongside it for object()
+  MPY_BIND_VAR(2, insert, {
+    self(args[0], spatial_hash_obj_t);
+    int handle = self->hash->insert(mp_obj_get_rect(args[1]));
+    if(handle < 0) {
+      mp_raise_msg(&mp_type_MemoryError, MP_ERROR_TEXT("spatial hash is full"));
+    }
+    self->objects[handle] = n_args > 2 ? args[2] : mp_const_none;
+    return mp_obj_new_int(handle);
+  })
+
+  // set(handle, rect) moves the box in slot handle, or puts one there
+  MPY_BIND_VAR(3, set, {
+    self(args[0], spatial_hash_obj_t);
+    self->hash->set(spatial_hash_handle(self, args[1]), mp_obj_get_rect(args[2]));
+    return mp_const_none;
+  })
+
+  // set_many(rects, first=0) sets the slots from first onwards from an
+  // array('h') or array('f') of x, y, w, h per box, games that keep their
+  // objects in a list can move them all with one call each frame
+  MPY_BIND_VAR(2, set_many, {
+    self(args[0], spatial_hash_obj_t);
+
+    mp_buffer_info_t rects;
+    mp_get_buffer_raise(args[1], &rects, MP_BUFFER_READ);
+    if(rects.typecode != 'h' && rects.typecode != 'f') {
+      mp_raise_msg_varg(&mp_type_ValueError, MP_ERROR_TEXT("rects must be an array('h') or array('f')"));
+    }
+    bool is_float = rects.typecode == 'f';
+    int count = rects.len / ((is_float ? sizeof(float) : sizeof(int16_t)) * 4);
+
+    int first = n_args > 2 ? spatial_hash_handle(self, args[2]) : 0;
+    if(first + count > self->hash->capacity()) {
+      mp_raise_msg_varg(&mp_type_IndexError, MP_ERROR_TEXT("more rects than slots"));
+    }
+
+    for(int i = 0; i < count; i++) {
+      if(is_float) {
+        const float *r = (const float *)rects.buf + i * 4;
+        self->hash->set(first + i, rect_t(r[0], r[1], r[2], r[3]));
+      }else{
+        const int16_t *r = (const int16_t *)rects.buf + i * 4;
+        self->hash->set(first + i, rect_t(r[0], r[1], r[2], r[3]));
+      }
+    }
+    return mp_const_none;
+  })
+
+  // remove(handle) frees the slot and forgets its object
+  MPY_BIND_VAR(2, remove, {
+    self(args[0], spatial_hash_obj_t);
+    int handle = spatial_hash_handle(self, args[1]);
+    self->hash->remove(handle);
+    self->objects[handle] = mp_const_none;
+    return mp_const_none;
+  })
+
+  MPY_BIND_VAR(1, clear, {
+    self(args[0], spatial_hash_obj_t);
+    self->hash->clear();
+    for(int i = 0; i < self->hash->capacity(); i++) {
+      self->objects[i] = mp_const_none;
+    }
+    return mp_const_none;
+  })
+
+  // object(handle) returns what was passed to insert() for the slot
+  MPY_BIND_VAR(2, object, {
+    self(args[0], spatial_hash_obj_t);
+    return self->objects[spatial_hash_handle(self, args[1])];
+  })
+
+  // pairs(out) writes the handles of every pair of overlapping boxes into
+  // an array('H'), two entries a pair, and returns how many pairs there
+  // were room for
+  MPY_BIND_VAR(2, pairs, {
+    self(args[0], spatial_hash_obj_t);
+    mp_buffer_info_t out = spatial_hash_out(args[1]);
+    return mp_obj_new_int(self->hash->pairs((uint16_t *)out.buf, out.len / (sizeof(uint16_t) * 2)));
+  })
+
+  // query(rect, out) writes the handles of the boxes overlapping rect into
+  // an array('H') and returns how many there were room for
+  MPY_BIND_VAR(3, query, {
+    self(args[0], spatial_hash_obj_t);
+    mp_buffer_info_t out = spatial_hash_out(args[2]);
+    return mp_obj_new_int(self->hash->query(mp_obj_get_rect(args[1]), (uint16_t *)out.buf, out.len / sizeof(uint16_t)));
+  })
+
+  MPY_BIND_ATTR(spatial_hash, {
+    self(self_in, spatial_hash_obj_t);
+
+    action_t action = m_attr_action(dest);
+
+    switch(attr) {
+      case MP_QSTR_count: {
+        if(action == GET) {
+          dest[0] = mp_obj_new_int(self->hash->count());
+          return;
+        }
+      };
+
+      case MP_QSTR_capacity: {
+        if(action == GET) {
+          dest[0] = mp_obj_new_int(self->hash->capacity());
+          return;
+        }
+      };
+    }
+
+    // we didn't handle this, fall back to alternative methods
+    dest[1] = MP_OBJ_SENTINEL;
+  })
+
+  MPY_BIND_LOCALS_DICT(spatial_hash,
+      MPY_BIND_ROM_PTR_DEL(spatial_hash),
+      MPY_BIND_ROM_PTR(insert),
+      MPY_BIND_ROM_PTR(set),
+      MPY_BIND_ROM_PTR(set_many),
+      MPY_BIND_ROM_PTR(remove),
+      MPY_BIND_ROM_PTR(clear),
+      MPY_BIND_ROM_PTR(object),
+      MPY_BIND_ROM_PTR(pairs),
+      MPY_BIND_ROM_PTR(query),
+  )
+
+  MP_DEFINE_CONST_OBJ_TYPE(
+      type_spatial_hash,
+      MP_QSTR_spatial_hash,
+      MP_TYPE_FLAG_NONE,
+      make_new, (const void *)spatial_hash_new,
+      attr, (const void *)spatial_hash_attr,
+      locals_dict, &spatial_hash_locals_dict
+  );
+
+}
@@ -0,0 +1,112 @@
+#include "mp_helpers.hpp"
+#include "picovector.hpp"
+
+extern "C" {
+  #include "py/runtime.h"
+
+  // text.layout(font, text, width, size=0, line_spacing=1, align=LEFT) breaks
+  // text into lines no wider than width and positions every glyph once, the
+  // layout it returns is drawn with image.text_layout(layout, x, y). size is
+  // ignored for pixel fonts
+  MPY_BIND_STATICMETHOD_VAR(3, layout, {
+    bool vector = mp_obj_is_type(args[0], &type_font);
+    if(!vector && !mp_obj_is_type(args[0], &type_pixel_font)) {
+      mp_raise_msg_varg(&mp_type_TypeError, MP_ERROR_TEXT("invalid parameter, expected layout(font, text, width, size=0, line_spacing=1, align=LEFT)"));
+    }
+
+    const char *text = mp_obj_str_get_str(args[1]);
+    float width = mp_obj_get_float(args[2]);
+    float size = n_args > 3 ? mp_obj_get_float(args[3]) : 0.0f;
+    float line_spacing = n_args > 4 ? mp_obj_get_float(args[4]) : 1.0f;
+    int align = n_args > 5 ? mp_obj_get_int(args[5]) : text_layout_t::LEFT;
+    if(align < text_layout_t::LEFT || align > text_layout_t::RIGHT) {
+      mp_raise_msg_varg(&mp_type_ValueError, MP_ERROR_TEXT("align must be LEFT, CENTER or RIGHT"));
+    }
+    if(vector && size <= 0.0f) {
+      mp_raise_msg_varg(&mp_type_ValueError, MP_ERROR_TEXT("vector fonts need a size"));
+    }
+
+    text_layout_obj_t *result = mp_obj_malloc(text_layout_obj_t, &type_text_layout);
+    result->font = args[0];
+    text_layout_t *l = &result->layout;
+    l->font = vector ? &((font_obj_t *)MP_OBJ_TO_PTR(args[0]))->font : nullptr;
+    l->pixel_font = vector ? nullptr : ((pixel_font_obj_t *)MP_OBJ_TO_PTR(args[0]))->font;
+    l->size = size;
+
+    // room for every codepoint, then trimmed to what was laid out
+    size_t count = text_layout_t::max_glyphs(text);
+    l->glyphs = m_new(text_layout_glyph_t, count);
+    l->layout(text, width, line_spacing, text_layout_t::align_t(align));
+    l->glyphs = m_renew(text_layout_glyph_t, l->glyphs, count, l->glyph_count);
+    result->glyphs_size = l->glyph_count;
+
+    return MP_OBJ_FROM_PTR(result);
+  })
+
+  MPY_BIND_LOCALS_DICT(text,
+      MPY_BIND_ROM_PTR_STATIC(layout),
+      { MP_ROM_QSTR(MP_QSTR_LEFT), MP_ROM_INT(text_layout_t::LEFT)},
+      { MP_ROM_QSTR(MP_QSTR_CENTER), MP_ROM_INT(text_layout_t::CENTER)},
+      { MP_ROM_QSTR(MP_QSTR_RIGHT), MP_ROM_INT(text_layout_t::RIGHT)},
+  )
+
+  MP_DEFINE_CONST_OBJ_TYPE(
+      type_text,
+      MP_QSTR_text,
+      MP_TYPE_FLAG_NONE,
+      locals_dict, &text_locals_dict
+  );
+
+  MPY_BIND_ATTR(text_layout, {
+    self(self_in, text_layout_obj_t);
+
+    action_t action = m_attr_action(dest);
+
+    switch(attr) {
+      case MP_QSTR_width: {
+        if(action == GET) {
+          dest[0] = mp_obj_new_float(self->layout.width);
+          return;
+        }
+      };
+
+      case MP_QSTR_height: {
+        if(action == GET) {
+          dest[0] = mp_obj_new_float(self->layout.height);
+          return;
+        }
+      };
+
+      case MP_QSTR_lines: {
+        if(action == GET) {
+          dest[0] = mp_obj_new_int(self->layout.line_count);
+          return;
+        }
+      };
+
+      case MP_QSTR_font: {
+        if(action == GET) {
+          dest[0] = self->font;
+          return;
+        }
+      };
+    }
+
+    // we didn't handle this, fall back to alternative methods
+    dest[1] = MP_OBJ_SENTINEL;
+  })
+
+  static void text_layout_print(const mp_print_t *print, mp_obj_t self_in, mp_print_kind_t kind) {
+    self(self_in, text_layout_obj_t);
+    mp_printf(print, "text_layout(lines=%d, glyphs=%d)", self->layout.line_count, self->layout.glyph_count);
+  }
+
+  MP_DEFINE_CONST_OBJ_TYPE(
+      type_text_layout,
+      MP_QSTR_text_layout,
+      MP_TYPE_FLAG_NONE,
+      print, (const void *)text_layout_print,
+      attr, (const void *)text_layout_attr
+  );
+
+}
@@ -0,0 +1,200 @@
+#include "mp_tracked_allocator.hpp"
+
+#include "mp_helpers.hpp"
+#include "picovector.hpp"
+
+extern "C" {
+  #include "py/runtime.h"
+
+  // the cells buffer may have been resized since it was last looked at, so
+  // anything that reads the cells picks it up again first
+  static void tilemap_refresh_cells(tilemap_obj_t *self) {
+    mp_buffer_info_t cells;
+    mp_get_buffer_raise(self->cells, &cells, MP_BUFFER_READ);
+    self->tilemap->cells = cells.buf;
+    self->tilemap->rows = cells.len / ((self->tilemap->wide ? 2 : 1) * self->tilemap->columns);
+  }
+
+  MPY_BIND_DEL(tilemap, {
+    self(self_in, tilemap_obj_t);
+    m_del_class(tilemap_t, self->tilemap);
+    return mp_const_none;
+  })
+
+  // tilemap(atlas, tile_w, tile_h, cells, columns) where cells is a bytes,
+  // bytearray or array('B') of 8 bit tile indices or an array('H') of 16 bit
+  // ones. the map keeps using cells so changing it changes the map
+  MPY_BIND_NEW(tilemap, {
+    if(n_args != 5 || !mp_obj_is_type(args[0], &type_image)) {
+      mp_raise_msg_varg(&mp_type_ValueError, MP_ERROR_TEXT("invalid parameters, expected tilemap(atlas, tile_w, tile_h, cells, columns)"));
+    }
+
+    image_obj_t *atlas = (image_obj_t *)MP_OBJ_TO_PTR(args[0]);
+    int tile_w = mp_obj_get_int(args[1]);
+    int tile_h = mp_obj_get_int(args[2]);
+    int columns = mp_obj_get_int(args[4]);
+    if(tile_w <= 0 || tile_h <= 0 || columns <= 0) {
+      mp_raise_msg_varg(&mp_type_ValueError, MP_ERROR_TEXT("tile size and columns must be positive"));
+    }
+
+    mp_buffer_info_t cells;
+    mp_get_buffer_raise(args[3], &cells, MP_BUFFER_READ);
+    bool wide = cells.typecode == 'H' || cells.typecode == 'h';
+    if(!wide && cells.typecode != 'B' && cells.typecode != 'b') {
+      mp_raise_msg_varg(&mp_type_ValueError, MP_ERROR_TEXT("cells must be bytes, a bytearray, array('B') or array('H')"));
+    }
+    int rows = cells.len / ((wide ? 2 : 1) * columns);
+
+    image_sync(atlas);
+
+    tilemap_obj_t *self = mp_obj_malloc_with_finaliser(tilemap_obj_t, type);
+    self->atlas = atlas;
+    self->cells = args[3];
+    self->tilemap = m_new_class(tilemap_t, atlas->image, tile_w, tile_h, cells.buf, wide, columns, rows);
+    return MP_OBJ_FROM_PTR(self);
+  })
+
+  // draw(target, area=None) draws the map into area on the target, or over
+  // the whole target, with the map pixel at scroll in the top left corner
+  MPY_BIND_VAR(2, draw, {
+    self(args[0], tilemap_obj_t);
+
+    if(!mp_obj_is_type(args[1], &type_image)) {
+      mp_raise_msg_varg(&mp_type_TypeError, MP_ERROR_TEXT("invalid parameter, expected draw(image, area=None)"));
+    }
+    const image_obj_t *target = (image_obj_t *)MP_OBJ_TO_PTR(args[1]);
+    rect_t area = n_args > 2 ? mp_obj_get_rect(args[2]) : target->image->bounds();
+
+    tilemap_refresh_cells(self);
+    image_sync(self->atlas);
+    image_sync(target);
+    self->tilemap->draw(target->image, area);
+    return mp_const_none;
+  })
+
+  // refresh() rescans the atlas for opaque tiles after it's been drawn into
+  MPY_BIND_VAR(1, refresh, {
+    self(args[0], tilemap_obj_t);
+    image_sync(self->atlas);
+    self->tilemap->update_opacity();
+    return mp_const_none;
+  })
+
+  // overlaps(rect, out) writes the column, row of every solid cell under
+  // rect, in map pixels, into an array('h') and returns how many cells
+  // there was room for
+  MPY_BIND_VAR(3, overlaps, {
+    self(args[0], tilemap_obj_t);
+
+    mp_buffer_info_t out;
+    mp_get_buffer_raise(args[2], &out, MP_BUFFER_WRITE);
+    if(out.typecode != 'h') {
+      mp_raise_msg_varg(&mp_type_ValueError, MP_ERROR_TEXT("out must be an array('h')"));
+    }
+
+    tilemap_refresh_cells(self);
+    int count = self->tilemap->overlaps(mp_obj_get_rect(args[1]), (int16_t *)out.buf, out.len / (sizeof(int16_t) * 2));
+    return mp_obj_new_int(count);
+  })
+
+  // segment(p1, p2) finds the first solid cell on the way from p1 to p2, in
+  // map pixels, and returns (column, row, hit, edge) or None if the way is
+  // clear. edge is the side entered through, 0 top, 1 right, 2 bottom,
+  // 3 left, or -1 if p1 is already inside
+  MPY_BIND_VAR(3, segment, {
+    self(args[0], tilemap_obj_t);
+
+    tilemap_refresh_cells(self);
+    int column, row, edge;
+    vec2_t hit;
+    if(!self->tilemap->segment(mp_obj_get_vec2(args[1]), mp_obj_get_vec2(args[2]), column, row, hit, edge)) {
+      return mp_const_none;
+    }
+
+    vec2_obj_t *p = mp_obj_malloc(vec2_obj_t, &type_vec2);
+    p->v = hit;
+    mp_obj_t items[4] = {mp_obj_new_int(column), mp_obj_new_int(row), MP_OBJ_FROM_PTR(p), mp_obj_new_int(edge)};
+    return mp_obj_new_tuple(4, items);
+  })
+
+  MPY_BIND_ATTR(tilemap, {
+    self(self_in, tilemap_obj_t);
+
+    action_t action = m_attr_action(dest);
+
+    switch(attr) {
+      case MP_QSTR_scroll: {
+        if(action == GET) {
+          vec2_obj_t *result = mp_obj_malloc(vec2_obj_t, &type_vec2);
+          result->v = self->tilemap->scroll;
+          dest[0] = MP_OBJ_FROM_PTR(result);
+          return;
+        }
+
+        if(action == SET) {
+          self->tilemap->scroll = mp_obj_get_vec2(dest[1]);
+          dest[0] = MP_OBJ_NULL;
+          return;
+        }
+      };
+
+      case MP_QSTR_empty: {
+        if(action == GET) {
+          dest[0] = self->tilemap->empty < 0 ? mp_const_none : mp_obj_new_int(self->tilemap->empty);
+          return;
+        }
+
+        if(action == SET) {
+          self->tilemap->empty = dest[1] == mp_const_none ? -1 : mp_obj_get_int(dest[1]);
+          dest[0] = MP_OBJ_NULL;
+          return;
+        }
+      };
+
+      case MP_QSTR_atlas: {
+        if(action == GET) {
+          dest[0] = MP_OBJ_FROM_PTR(self->atlas);
+          return;
+        }
+      };
+
+      case MP_QSTR_columns: {
+        if(action == GET) {
+          dest[0] = mp_obj_new_int(self->tilemap->columns);
+          return;
+        }
+      };
+
+      case MP_QSTR_rows: {
+        if(action == GET) {
+          tilemap_refresh_cells(self);
+          dest[0] = mp_obj_new_int(self->tilemap->rows);
+          return;
+        }
+      };
+    }
+
+    // we didn't handle this, fall back to alternative methods
+    dest[1] = MP_OBJ_SENTINEL;
+  })
+
+  MPY_BIND_LOCALS_DICT(tilemap,
+      MPY_BIND_ROM_PTR_DEL(tilemap),
+      MPY_BIND_ROM_PTR(draw),
+      MPY_BIND_ROM_PTR(refresh),
+      MPY_BIND_ROM_PTR(overlaps),
+      MPY_BIND_ROM_PTR(segment),
+      { MP_ROM_QSTR(MP_QSTR_FLIP_H), MP_ROM_INT(tilemap_t::FLIP_H)},
+      { MP_ROM_QSTR(MP_QSTR_FLIP_V), MP_ROM_INT(tilemap_t::FLIP_V)},
+  )
+
+  MP_DEFINE_CONST_OBJ_TYPE(
+      type_tilemap,
+      MP_QSTR_tilemap,
+      MP_TYPE_FLAG_NONE,
+      make_new, (const void *)tilemap_new,
+      attr, (const void *)tilemap_attr,
+      locals_dict, &tilemap_locals_dict
+  );
+
+}
@@ -2,6 +2,7 @@
 
 extern const mp_obj_type_t type_brush;
 extern const mp_obj_type_t type_image;
+extern const mp_obj_type_t type_image_loader;
 extern const mp_obj_type_t type_color;
 extern const mp_obj_type_t type_font;
 extern const mp_obj_type_t type_input;
@@ -11,4 +12,11 @@ extern const mp_obj_type_t type_shape;
 extern const mp_obj_type_t type_rect;
 extern const mp_obj_type_t type_vec2;
 extern const mp_obj_type_t type_algorithm;
+extern const mp_obj_type_t type_tilemap;
+extern const mp_obj_type_t type_particles;
+extern const mp_obj_type_t type_spatial_hash;
+extern const mp_obj_type_t type_text;
+extern const mp_obj_type_t type_text_layout;
+extern const mp_obj_type_t type_sdf_font;
+extern const mp_obj_type_t type_label;
 extern const mp_obj_module_t mod_input;
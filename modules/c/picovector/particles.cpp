@@ -0,0 +1,147 @@
+#include <math.h>
+#include <algorithm>
+
+#include "particles.hpp"
+#include "brush.hpp"
+#include "color.hpp"
+#include "profile.hpp"
+
+using std::min, std::max;
+
+namespace picovector {
+
+  particles_t::particles_t(int capacity)
+    : position(0, 0), gravity(0, 0), _capacity(capacity),
+      _x(capacity), _y(capacity), _vx(capacity), _vy(capacity), _age(capacity), _inv_life(capacity) {
+  }
+
+  // xorshift, plenty for scattering particles and it never touches the
+  // micropython random state
+  float particles_t::random(float lo, float hi) {
+    _seed ^= _seed << 13;
+    _seed ^= _seed >> 17;
+    _seed ^= _seed << 5;
+    return lo + (hi - lo) * float(_seed >> 8) * (1.0f / 16777216.0f);
+  }
+
+  int particles_t::emit(int n, vec2_t p) {
+    n = min(n, _capacity - _count);
+    const float to_radians = float(M_PI) / 180.0f;
+    for(int i = _count; i < _count + n; i++) {
+      float a = (angle + random(-spread, spread) * 0.5f) * to_radians;
+      float s = random(speed_min, speed_max);
+      float life = random(life_min, life_max);
+      _x[i] = p.x;
+      _y[i] = p.y;
+      _vx[i] = cosf(a) * s;
+      _vy[i] = sinf(a) * s;
+      _age[i] = 0.0f;
+      _inv_life[i] = life > 0.0f ? 1.0f / life : FLT_MAX;
+    }
+    _count += n;
+    return n;
+  }
+
+  void particles_t::update(float dt) {
+    float *x = _x.data(), *y = _y.data(), *vx = _vx.data(), *vy = _vy.data();
+    float *age = _age.data(), *inv_life = _inv_life.data();
+
+    // drag is applied as a scale so the loops stay free of branches
+    float keep = max(0.0f, 1.0f - drag * dt);
+    float gx = gravity.x * dt, gy = gravity.y * dt;
+    for(int i = 0; i < _count; i++) {
+      vx[i] = (vx[i] + gx) * keep;
+      vy[i] = (vy[i] + gy) * keep;
+      x[i] += vx[i] * dt;
+      y[i] += vy[i] * dt;
+      age[i] += dt;
+    }
+
+    // slide the survivors down over the dead, order is kept so a lut or
+    // frame change doesn't make particles jump in front of each other
+    int live = 0;
+    for(int i = 0; i < _count; i++) {
+      if(age[i] * inv_life[i] >= 1.0f) continue;
+      if(live != i) {
+        x[live] = x[i]; y[live] = y[i];
+        vx[live] = vx[i]; vy[live] = vy[i];
+        age[live] = age[i]; inv_life[live] = inv_life[i];
+      }
+      live++;
+    }
+    _count = live;
+
+    _backlog += rate * dt;
+    int n = int(_backlog);
+    if(n > 0) {
+      _backlog -= n;
+      emit(n, position);
+    }
+  }
+
+  void particles_t::lut(const uint32_t *colors, int count) {
+    _lut.resize(count);
+    for(int i = 0; i < count; i++) {
+      uint32_t c = colors[i];
+      color_t p;
+      p.premul(c >> 24, c >> 16, c >> 8, c);
+      _lut[i] = p._p;
+    }
+  }
+
+  void particles_t::draw(image_t *target, int size) {
+    profile_scope_t profile(PROFILE_RENDER, _count * size * size);
+
+    // lut colours go through a single brush that's updated in place, as the
+    // batch draw calls do
+    static color_brush_t item_brush = color_brush_t(color_t());
+    brush_t *brush = target->brush();
+    bool tinted = !_lut.empty();
+    if(tinted) {
+      target->brush(&item_brush);
+    }
+
+    int steps = _lut.size();
+    int half = size / 2;
+    rect_t clip = target->clip().intersection(target->bounds());
+    for(int i = 0; i < _count; i++) {
+      if(tinted) {
+        item_brush.c._p = _lut[stage(i, steps)];
+      }
+
+      int x = floorf(_x[i]), y = floorf(_y[i]);
+      if(size <= 1) {
+        if(x >= clip.x && x < clip.x + clip.w && y >= clip.y && y < clip.y + clip.h) {
+          target->put_unsafe(x, y);
+        }
+      }else{
+        target->rectangle(rect_t(x - half, y - half, size, size));
+      }
+    }
+
+    if(tinted) {
+      target->brush(brush);
+    }
+  }
+
+  void particles_t::draw_sprites(image_t *target, image_t *atlas, const int16_t *frames, int frame_count) {
+    if(frame_count <= 0) return;
+
+    // sprites are handed to blit_sprites a chunk at a time from the stack
+    const int chunk = 32;
+    int16_t sprites[chunk * 6];
+    for(int first = 0; first < _count; first += chunk) {
+      int n = min(chunk, _count - first);
+      for(int j = 0; j < n; j++) {
+        int i = first + j;
+        const int16_t *f = &frames[stage(i, frame_count) * 4];
+        int16_t *s = &sprites[j * 6];
+        s[0] = f[0]; s[1] = f[1]; s[2] = f[2]; s[3] = f[3];
+        s[4] = int16_t(std::clamp(floorf(_x[i]) - f[2] / 2, -32768.0f, 32767.0f));
+        s[5] = int16_t(std::clamp(floorf(_y[i]) - f[3] / 2, -32768.0f, 32767.0f));
+      }
+      atlas->blit_sprites(target, sprites, n, 6);
+    }
+  }
+
+}
@@ -0,0 +1,77 @@
+#pragma once
+
+#include <stdint.h>
+#include <vector>
+
+#include "picovector.hpp"
+#include "image.hpp"
+#include "types.hpp"
+
+namespace picovector {
+
+  // a fixed size pool of particles kept as one array per property so that
+  // stepping them is a handful of straight loops. dead particles are
+  // compacted away each step, the live ones are always the first count()
+  class particles_t {
+  public:
+    // the built in emitter, rate particles a second leave position heading
+    // angle degrees (0 is right, 90 down) give or take spread / 2, with a
+    // speed and lifetime picked between the two limits
+    vec2_t  position;
+    float   rate = 0.0f;
+    float   angle = 0.0f;
+    float   spread = 360.0f;
+    float   speed_min = 10.0f, speed_max = 20.0f;
+    float   life_min = 1.0f, life_max = 1.0f;
+
+    vec2_t  gravity;        // pixels per second per second
+    float   drag = 0.0f;    // fraction of the velocity lost per second
+
+    particles_t(int capacity);
+
+    int capacity() const {return _capacity;}
+    int count() const {return _count;}
+
+    // adds up to n particles at p from the emitter's settings, returns how
+    // many fitted
+    int emit(int n, vec2_t p);
+    void clear() {_count = 0;}
+
+    // moves everything on by dt seconds, retires particles that have lived
+    // out their life and emits whatever the rate has built up
+    void update(float dt);
+
+    // colours over life as 0xRRGGBBAA, entry 0 at birth through to the last
+    // at death. an empty lut draws in the target's brush
+    void lut(const uint32_t *colors, int count);
+
+    // draws every particle as a size pixel square centred on it, size 1
+    // draws single pixels
+    void draw(image_t *target, int size);
+
+    // draws every particle as a sprite cut from atlas centred on it, frames
+    // is frame_count sx, sy, sw, sh entries stepped through over life
+    void draw_sprites(image_t *target, image_t *atlas, const int16_t *frames, int frame_count);
+
+  private:
+    typedef std::vector<float, PV_STD_ALLOCATOR<float>> values_t;
+
+    int      _capacity;
+    int      _count = 0;
+    float    _backlog = 0.0f;   // part particles the rate hasn't emitted yet
+    uint32_t _seed = 2350;
+
+    values_t _x, _y, _vx, _vy;
+    values_t _age, _inv_life;   // seconds lived and one over the lifetime
+    std::vector<uint32_t, PV_STD_ALLOCATOR<uint32_t>> _lut;
+
+    float random(float lo, float hi);
+
+    // where particle i is through its life in lut or frame steps
+    int stage(int i, int steps) const {
+      int s = int(_age[i] * _inv_life[i] * steps);
+      return s < steps ? s : steps - 1;
+    }
+  };
+
+}
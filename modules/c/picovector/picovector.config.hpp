@@ -1,4 +1,13 @@
-#include "micropython/mp_tracked_allocator.hpp"
+#pragma once
+
+#include <stddef.h>
+
+// PICOVECTOR_HOST builds the core on its own against malloc and free, with
+// no micropython to link against, for profiling and checking renders on a pc.
+// host/CMakeLists.txt builds it with the golden image tests and benchmarks
+#ifdef PICOVECTOR_HOST
+#include "config_default.hpp"
+#else
 
 #ifdef __cplusplus
 extern "C" {
@@ -16,7 +25,12 @@ extern "C" {
 }
 #endif
 
+#include "micropython/mp_tracked_allocator.hpp"
+
 #define PV_STD_ALLOCATOR MPAllocator
 #define PV_MALLOC m_malloc
 #define PV_FREE m_free
-#define PV_REALLOC m_realloc
\ No newline at end of file
+#define PV_REALLOC m_realloc
+#define PV_ALLOC_SCOPE(kind) pv_alloc_scope_t _pv_alloc_scope(kind)
+
+#endif
@@ -1,4 +1,11 @@
 #include <algorithm>
+#include <float.h>
+#include <math.h>
+#include <string.h>
+
+#ifdef PICO
+#include "pico/stdlib.h"
+#endif
 
 #include "picovector.hpp"
 #include "brush.hpp"
@@ -8,6 +15,12 @@
 #include "types.hpp"
 #include "mat3.hpp"
 #include "blend.hpp"
+#include "worker.hpp"
+#include "primitive.hpp"
+#include "working_buffer.hpp"
+#include "display_list.hpp"
+#include "sram_pool.hpp"
+#include "profile.hpp"
 
 using std::sort, std::min, std::max;
 
@@ -16,19 +29,14 @@ using std::sort, std::min, std::max;
 // found out the hard way.)
 char __attribute__((aligned(4))) PicoVector_working_buffer[working_buffer_size];
 
-#define TILE_WIDTH 32
-#define TILE_HEIGHT 16
-#define MAX_NODES_PER_SCANLINE 64
-
-#define TILE_BUFFER_SIZE (TILE_WIDTH * TILE_HEIGHT * sizeof(uint8_t)) // 8kB tile buffer
-#define NODE_BUFFER_ROW_SIZE (MAX_NODES_PER_SCANLINE * sizeof(int16_t))
-#define NODE_BUFFER_SIZE (TILE_HEIGHT * 4 * NODE_BUFFER_ROW_SIZE) // 32kB node buffer
-#define NODE_COUNT_BUFFER_SIZE (TILE_HEIGHT * 4 * sizeof(uint8_t)) // 256 byte node count buffer
+#define TILE_WIDTH 64
+#define TILE_HEIGHT 32
+#define TILE_SAMPLE_ROWS (TILE_HEIGHT * 4) // sample rows at the highest antialias level
+#define MAX_TILE_NODES 1536
 
-// buffer that each tile is rendered into before callback
-uint8_t *tile_buffer = (uint8_t *)&PicoVector_working_buffer[0];
-int16_t *node_buffer = (int16_t *)&PicoVector_working_buffer[TILE_BUFFER_SIZE];
-uint8_t *node_count_buffer = (uint8_t *)&PicoVector_working_buffer[TILE_BUFFER_SIZE + NODE_BUFFER_SIZE];
+#define TILE_BUFFER_SIZE (TILE_WIDTH * TILE_HEIGHT * sizeof(uint8_t)) // 2kB tile buffer
+#define NODE_BUFFER_SIZE (MAX_TILE_NODES * (sizeof(uint32_t) + sizeof(int16_t))) // 9kB packed and sorted nodes
+#define NODE_COUNT_BUFFER_SIZE (TILE_SAMPLE_ROWS * sizeof(uint16_t)) // 256 byte node count buffer
 
 static inline void insertion_sort_i16(int16_t* a, int n) {
   for (int i = 1; i < n; ++i) {
@@ -44,9 +52,92 @@ static inline void insertion_sort_i16(int16_t* a, int n) {
 
 namespace picovector {
 
+  worker_t *core1_worker = nullptr;
+
+  int current_core() {
+#ifdef PICO
+    return get_core_num();
+#else
+    return 0;
+#endif
+  }
+
+  struct parallel_job_t {
+    void (*fn)(void *arg, int part);
+    void *arg;
+  };
+
+  static void run_parallel_part1(void *job) {
+    parallel_job_t *j = (parallel_job_t *)job;
+    j->fn(j->arg, 1);
+  }
+
+  void run_parallel(void (*fn)(void *arg, int part), void *arg) {
+    if(!core1_worker || core1_worker->busy()) {
+      fn(arg, 0);
+      fn(arg, 1);
+      return;
+    }
+
+    parallel_job_t job = {fn, arg};
+    core1_worker->run(run_parallel_part1, &job);
+    fn(arg, 0);
+    core1_worker->wait();
+  }
+
+  // edges are set up once per shape rather than once per tile: each vertex
+  // is transformed, scaled for antialiasing and converted to 24.8 fixed point
+  // a single time. edges are then sorted by their first scanline so that each
+  // row of tiles only visits the edges that actually cross it
+  struct tile_edge_t {
+    int32_t row0, row1; // scanlines covered, sampled at their centres
+    int64_t x;          // x at the centre of row0, 40.24
+    int64_t step;       // change in x per scanline, 40.24
+  };
+
+  // per tile row state for each edge that crosses it
+  struct active_tile_edge_t {
+    tile_edge_t *edge;
+    int32_t row0, row1; // scanlines within this tile row
+    int32_t minx, maxx; // horizontal extent within this tile row
+    bool left;          // already counted into the left parity
+  };
+
+  // per core rasteriser scratch. core0 carves its buffers out of a claim on
+  // PicoVector_working_buffer while core1 has a smaller block of its own in
+  // sram. the edge and coverage segment lists are built once by core0 and
+  // only read while both cores render
+  //
+  // a tile's scanline nodes go into one packed list as (row << 16) | x in
+  // whatever order the edges produce them and are counting sorted by row
+  // before rendering, so a busy scanline can use as many nodes as it needs.
+  // if the list fills up the tile is split in half and built again
+  struct raster_context_t {
+    uint8_t *tile_buffer;        // tile that coverage is accumulated into
+    uint32_t *node_buffer;       // packed nodes for the tile
+    int16_t *sorted_node_buffer; // node x positions grouped by row
+    uint16_t *node_count_buffer; // node count per scanline
+    float *coverage_buffer;      // analytic coverage rows, overlaps node_buffer
+    active_tile_edge_t *active_edge_buffer;
+    int max_active_edges;
+    uint32_t *active_segment_buffer; // coverage segments crossing the tile row
+    int max_active_segments;
+    int node_count = 0;          // nodes in node_buffer
+    bool node_overflow = false;  // nodes were dropped, the tile must be split
+  };
+
   int sign(int v) {return (v > 0) - (v < 0);}
 
-  void add_line_segment_to_nodes(vec2_t start, vec2_t end, rect_t *tb) {
+  static inline void add_node(raster_context_t &ctx, int row, int x) {
+    if(ctx.node_count < MAX_TILE_NODES) {
+      ctx.node_buffer[ctx.node_count++] = (uint32_t(row) << 16) | uint16_t(x);
+      ctx.node_count_buffer[row]++;
+    }else{
+      ctx.node_overflow = true;
+    }
+  }
+
+  void add_line_segment_to_nodes(raster_context_t &ctx, vec2_t start, vec2_t end, rect_t *tb) {
     if(end.y < start.y) {
       vec2_t tmp = start; start = end; end = tmp;
     }
@@ -73,29 +164,27 @@ namespace picovector {
 
     for(int iy = sy; iy < ey; iy++) {
       int ix = max(min(int(x), maxx), minx);
-
-      node_buffer[(iy * MAX_NODES_PER_SCANLINE) + node_count_buffer[iy]] = ix;
-      node_count_buffer[iy]++;
+      add_node(ctx, iy, ix);
 
       x += dx;
     }
   }
 
-  void build_nodes(path_t *path, rect_t *tb, mat3_t *transform, uint aa) {
+  void build_nodes(raster_context_t &ctx, point_span_t points, rect_t *tb, mat3_t *transform, uint aa) {
     vec2_t offset = tb->tl();
     // start with the last point to close the loop, transform it, scale for antialiasing, and offset to tile origin
-    vec2_t last = path->points[path->points.size() - 1];
+    vec2_t last = points.back();
     if(transform) last = last.transform(transform);
     last *= (1 << aa);
     last -= offset;
 
-    for(auto next : path->points) {
+    for(auto next : points) {
       if(transform) next = next.transform(transform);
       next *= (1 << aa);
       next -= offset;
 
       //printf("   - add line segment %d, %d -> %d, %d\n", int(last.x), int(last.y), int(next.x), int(next.y));
-      add_line_segment_to_nodes(last, next, tb);
+      add_line_segment_to_nodes(ctx, last, next, tb);
       last = next;
     }
   }
@@ -108,27 +197,90 @@ namespace picovector {
   uint8_t alpha_map_x4[5] = {0, 63, 127, 190, 255};
   uint8_t alpha_map_x16[17] = {0, 16, 32, 48, 64, 80, 96, 112, 128, 144, 160, 176, 192, 208, 224, 240, 255};
 
-  rect_t render_nodes(rect_t *tb, uint aa) {
-    int minx = tb->w;
-    int miny = tb->h;
-    int maxx = 0;
-    int maxy = 0;
+  // fully covered runs shorter than this stay in the masked span, the extra
+  // call costs more than the mask multiply saves
+  #define SOLID_RUN_MIN 4
+
+  // hand a row of coverage values to the target: fully covered runs go
+  // through the unmasked span function, uncovered pixels are skipped, and
+  // only the partially covered edges pay for the masked blend
+  void render_mask_row(image_t *target, brush_t *brush, int x, int y, int w, uint8_t *mask) {
+    span_func_t span = target->_span_func;
+    masked_span_func_t masked_span = target->_masked_span_func;
+
+    int i = 0;
+    while(i < w) {
+      while(i < w && !mask[i]) i++;
+
+      // partially covered pixels, absorbing any short solid runs
+      int s = i;
+      while(i < w && mask[i]) {
+        if(mask[i] == 255) {
+          int e = i;
+          while(e < w && mask[e] == 255) e++;
+          if(e - i >= SOLID_RUN_MIN) break;
+          i = e;
+        }else{
+          i++;
+        }
+      }
+      if(i > s) {
+        masked_span(target, brush, x + s, y, i - s, &mask[s]);
+      }
+
+      s = i;
+      while(i < w && mask[i] == 255) i++;
+      if(i > s) {
+        span(target, brush, x + s, y, i - s);
+      }
+    }
+  }
+
+  // sample space extent of the nodes accumulated into a tile
+  struct node_extent_t {
+    int minx, miny, maxx, maxy;
+  };
+
+  // accumulate the nodes for the rows of tb into the tile buffer, tb starts
+  // row_offset sample rows below the top of the tile
+  void render_nodes(raster_context_t &ctx, rect_t *tb, int row_offset, uint aa, node_extent_t &extent) {
+    int rows = int(tb->h);
+
+    // counting sort by row, afterwards each row's count has become the
+    // offset just past its last node
+    uint16_t *row_end = ctx.node_count_buffer;
+    int offset = 0;
+    for(int y = 0; y < rows; y++) {
+      int count = row_end[y];
+      row_end[y] = offset;
+      offset += count;
+    }
+    for(int i = 0; i < ctx.node_count; i++) {
+      uint32_t node = ctx.node_buffer[i];
+      ctx.sorted_node_buffer[row_end[node >> 16]++] = int16_t(node & 0xffff);
+    }
+
+    int row_start = 0;
+    for(int y = 0; y < rows; y++) {
+      int count = row_end[y] - row_start;
+      int16_t *nodes = &ctx.sorted_node_buffer[row_start];
+      row_start = row_end[y];
 
-    for(int y = 0; y <= int(tb->h); y++) {
-      if(node_count_buffer[y] == 0) {
+      if(count == 0) {
         continue; // no nodes on this raster line
       }
 
-      miny = min(miny, y);
-      maxy = max(maxy, y);
+      int ty = y + row_offset;
+      extent.miny = min(extent.miny, ty);
+      extent.maxy = max(extent.maxy, ty);
 
       // sort scanline nodes
-      int16_t *nodes = &node_buffer[(y * MAX_NODES_PER_SCANLINE)];
-      insertion_sort_i16(nodes, node_count_buffer[y]);
+      insertion_sort_i16(nodes, count);
 
-      uint8_t *row_data = &tile_buffer[(y >> aa) * TILE_WIDTH];
+      uint8_t *row_data = &ctx.tile_buffer[(ty >> aa) * TILE_WIDTH];
 
-      for(uint32_t i = 0; i < node_count_buffer[y]; i += 2) {
+      // an odd count only happens when a single row overflowed
+      for(int i = 0; i + 1 < count; i += 2) {
         int sx = *nodes++;
         int ex = *nodes++;
 
@@ -136,150 +288,801 @@ namespace picovector {
           continue;
         }
 
-        minx = min(minx, sx);
-        maxx = max(maxx, ex);
+        extent.minx = min(extent.minx, sx);
+        extent.maxx = max(extent.maxx, ex);
 
         do {
           row_data[sx >> aa]++;
         } while(++sx < ex);
       }
+    }
+  }
 
-      // for(int i = 0; i < TILE_WIDTH; i++) {
-      //   row_data[i] = 1;
-      // }
+  #define EDGE_BUFFER_OFFSET (TILE_BUFFER_SIZE + NODE_BUFFER_SIZE + NODE_COUNT_BUFFER_SIZE)
+
+  // the edge lists take whatever core0's claim leaves after the tile buffers
+  tile_edge_t *edge_buffer = nullptr;
+  int max_edges = 0;
+
+  // core1 only takes on shapes whose edges all fit in its active list
+  #define CORE1_MAX_ACTIVE_EDGES 512
+  #define CORE1_BUFFER_SIZE (EDGE_BUFFER_OFFSET + CORE1_MAX_ACTIVE_EDGES * sizeof(active_tile_edge_t))
+  char __attribute__((aligned(4))) core1_working_buffer[CORE1_BUFFER_SIZE];
+
+#ifdef PICO
+  // everything picovector and the display keep in sram for good, the
+  // st7789 framebuffer is 320x240 rgba8888
+  static_assert(320 * 240 * 4 + working_buffer_size + band_buffer_size + CORE1_BUFFER_SIZE + PV_SRAM_POOL_SIZE <= PV_SRAM_BUDGET,
+    "static sram buffers exceed PV_SRAM_BUDGET, shrink PV_SRAM_POOL_SIZE");
+#endif
+
+  raster_context_t raster_contexts[2] = {
+    {}, // pointed into the working buffer by claim_core0_buffers()
+    {
+      (uint8_t *)&core1_working_buffer[0],
+      (uint32_t *)&core1_working_buffer[TILE_BUFFER_SIZE],
+      (int16_t *)&core1_working_buffer[TILE_BUFFER_SIZE + MAX_TILE_NODES * sizeof(uint32_t)],
+      (uint16_t *)&core1_working_buffer[TILE_BUFFER_SIZE + NODE_BUFFER_SIZE],
+      (float *)&core1_working_buffer[TILE_BUFFER_SIZE],
+      (active_tile_edge_t *)&core1_working_buffer[EDGE_BUFFER_OFFSET],
+      CORE1_MAX_ACTIVE_EDGES,
+      (uint32_t *)&core1_working_buffer[EDGE_BUFFER_OFFSET], // shares the active edges' space
+      CORE1_MAX_ACTIVE_EDGES * sizeof(active_tile_edge_t) / sizeof(uint32_t)
+    }
+  };
 
+  static inline int32_t to_fx8(float v) {
+    return int32_t(floorf(v * 256.0f + 0.5f));
+  }
+
+  static inline bool add_edge(int32_t x0, int32_t y0, int32_t x1, int32_t y1, int &count) {
+    if(y0 == y1) return true; // horizontal edges never produce nodes
 
+    if(y1 < y0) {
+      std::swap(x0, x1); std::swap(y0, y1);
     }
 
-    if(minx > maxx || miny > maxy) {
-      return rect_t(0, 0, 0, 0);
+    // scanlines whose centre falls in [y0, y1)
+    int32_t row0 = (y0 - 128 + 255) >> 8;
+    int32_t row1 = (y1 - 128 + 255) >> 8;
+    if(row0 >= row1) return true;
+
+    if(count >= max_edges) return false;
+
+    int64_t dxdy = (int64_t(x1 - x0) << 16) / (y1 - y0); // 16.16
+    tile_edge_t &e = edge_buffer[count++];
+    e.row0 = row0;
+    e.row1 = row1;
+    e.x = (int64_t(x0) << 16) + int64_t(row0 * 256 + 128 - y0) * dxdy;
+    e.step = dxdy << 8;
+    return true;
+  }
+
+  // flattening tolerance for round joins and caps, in shape space
+  static float stroke_tolerance(mat3_t *transform, uint aa) {
+    float tolerance = curve_tolerance(transform, aa);
+    return tolerance > 0.0f ? tolerance : 1.0f;
+  }
+
+  // gathers the outline of a stroked shape as the stroker emits it in
+  // device space, along with its bounds
+  struct stroke_edges_t {
+    float minx = FLT_MAX, miny = FLT_MAX, maxx = -FLT_MAX, maxy = -FLT_MAX;
+    float scale = 1.0f;
+    int count = 0;
+    bool fits = true;
+
+    // every outline is a closed loop so each point starts exactly one edge
+    void grow(vec2_t p) {
+      minx = min(minx, p.x); miny = min(miny, p.y);
+      maxx = max(maxx, p.x); maxy = max(maxy, p.y);
     }
+  };
 
-    int out_minx = (minx >> aa);
-    int out_maxx = ((maxx - (1 << aa)) >> aa);
-    int out_miny = (miny >> aa);
-    int out_maxy = ((maxy - (1 << aa)) >> aa);
+  static void stroke_tile_edge(void *arg, vec2_t a, vec2_t b) {
+    stroke_edges_t &s = *(stroke_edges_t *)arg;
+    s.grow(a);
+    if(s.fits) {
+      s.fits = add_edge(to_fx8(a.x * s.scale), to_fx8(a.y * s.scale), to_fx8(b.x * s.scale), to_fx8(b.y * s.scale), s.count);
+    }
+  }
 
-    return rect_t(out_minx, out_miny,
-              (out_maxx - out_minx) + 1,
-              (out_maxy - out_miny) + 2);
+  // transforms every vertex once, returns the edge count or -1 if the
+  // shape has more edges than fit in the working buffer
+  static int build_edges(shape_t *shape, mat3_t *transform, uint aa, rect_t &bounds) {
+    float minx = FLT_MAX, miny = FLT_MAX, maxx = -FLT_MAX, maxy = -FLT_MAX;
+    float scale = float(1 << aa);
+    int count = 0;
+    bool fits = true;
+
+    if(shape->_stroke.width > 0.0f) {
+      stroke_edges_t s;
+      s.scale = scale;
+      float tolerance = stroke_tolerance(transform, aa);
+      for(auto &path : shape->paths) {
+        stroke_path(shape->points(path).data(), path.count, path.closed, shape->_stroke, transform, tolerance, stroke_tile_edge, &s);
+      }
+      minx = s.minx; miny = s.miny; maxx = s.maxx; maxy = s.maxy;
+      count = s.count;
+      fits = s.fits;
+    }else{
+      for(auto &path : shape->paths) {
+        point_span_t points = shape->points(path);
+        if(points.empty()) continue;
+
+        vec2_t last = points.back();
+        if(transform) last = last.transform(transform);
+        int32_t lx = to_fx8(last.x * scale), ly = to_fx8(last.y * scale);
+
+        for(auto next : points) {
+          if(transform) next = next.transform(transform);
+          minx = min(minx, next.x);
+          miny = min(miny, next.y);
+          maxx = max(maxx, next.x);
+          maxy = max(maxy, next.y);
+
+          int32_t nx = to_fx8(next.x * scale), ny = to_fx8(next.y * scale);
+          if(fits) {
+            fits = add_edge(lx, ly, nx, ny, count);
+          }
+          lx = nx; ly = ny;
+        }
+      }
+    }
+
+    bounds = rect_t(minx, miny, ceil(maxx) - minx, ceil(maxy) - miny);
+    if(!fits) return -1;
+
+    std::sort(edge_buffer, edge_buffer + count, [](const tile_edge_t &a, const tile_edge_t &b) {
+      return a.row0 < b.row0;
+    });
+    return count;
   }
 
-  void render(shape_t *shape, image_t *target, mat3_t *transform, brush_t *brush) {
+  // fills in the nodes for some rows of a tile, tb is in sample space and
+  // nodes are relative to its top left corner
+  typedef void (*node_source_t)(raster_context_t &ctx, void *arg, rect_t &tb);
 
-    if(shape->paths.empty()) return;
+  // builds and accumulates the nodes for sample rows [r0, r1) of the tile.
+  // when they don't all fit the rows are split in two and each half built
+  // again, only a single sample row that still overflows loses nodes
+  static void build_tile_nodes(raster_context_t &ctx, node_source_t source, void *arg, rect_t &tb, int r0, int r1, uint aa, node_extent_t &extent) {
+    rect_t rows = rect_t(tb.x, tb.y + r0, tb.w, r1 - r0);
 
-    // antialias level of target image
-    uint aa = (uint)target->antialias();
+    memset(ctx.node_count_buffer, 0, (r1 - r0) * sizeof(uint16_t));
+    ctx.node_count = 0;
+    ctx.node_overflow = false;
 
-    uint8_t *p_alpha_map = alpha_map_none;
-    if(aa == 1) p_alpha_map = alpha_map_x4;
-    if(aa == 2) p_alpha_map = alpha_map_x16;
+    source(ctx, arg, rows);
 
-    //mask_span_func_t sf = target->_mask_span_func;
-    //printf("render shape\n");
+    if(ctx.node_overflow && r1 - r0 > 1) {
+      int split = (r0 + r1) / 2;
+      build_tile_nodes(ctx, source, arg, tb, r0, split, aa, extent);
+      build_tile_nodes(ctx, source, arg, tb, split, r1, aa, extent);
+      return;
+    }
 
-    // determine bounds of shape to be rendered
-    rect_t sb = shape->bounds().round();
+    render_nodes(ctx, &rows, r0, aa, extent);
+  }
 
-    rect_t clip = target->clip();
+  // renders the tile at sx, sy (in pixels) with nodes from source
+  static void render_tile(raster_context_t &ctx, node_source_t source, void *arg, image_t *target, brush_t *brush, uint8_t *p_alpha_map, int sx, int sy, int sw, int sh, uint aa) {
+    rect_t tb = rect_t(sx << aa, sy << aa, sw << aa, sh << aa);
+
+    // clear existing tile data
+    for (int row = 0; row < sh; ++row) {
+      memset(&ctx.tile_buffer[row * TILE_WIDTH], 0, sw);
+    }
 
-    masked_span_func_t fn = target->_masked_span_func;
+    node_extent_t extent = {int(tb.w), int(tb.h), 0, 0};
+    build_tile_nodes(ctx, source, arg, tb, 0, tb.h, aa, extent);
 
-    //printf("- shape bounds %d, %d (%d x %d)\n", sbx, sby, sbw, sbh);
-    //printf("- clip bounds %d, %d (%d x %d)\n", int(clip.x), int(clip.y), int(clip.w), int(clip.h));
+    if(extent.minx > extent.maxx || extent.miny > extent.maxy) {
+      return;
+    }
+
+    // maxx is exclusive, include the pixel holding its last sample
+    int rbx = extent.minx >> aa;
+    int rby = extent.miny >> aa;
+    int rbw = ((extent.maxx - 1) >> aa) - rbx + 1;
+    int rbh = ((extent.maxy - (1 << aa)) >> aa) - rby + 2;
+
+    for(int ty = rby; ty < rby + rbh; ty++) {
+      uint8_t* p;
+
+      // scale tile buffer values to alpha values
+      p = &ctx.tile_buffer[ty * TILE_WIDTH + rbx];
+      int c = rbw;
+      while(c--) {
+        *p = p_alpha_map[*p];
+        p++;
+      }
+
+      // render tile span
+      p = &ctx.tile_buffer[ty * TILE_WIDTH + rbx];
+
+      render_mask_row(target, brush, sx + rbx, sy + ty, rbw, p);
+    }
+  }
+
+  struct stroke_nodes_t {
+    raster_context_t *ctx;
+    rect_t *tb;
+    float scale;
+  };
+
+  static void stroke_node_edge(void *arg, vec2_t a, vec2_t b) {
+    stroke_nodes_t &sn = *(stroke_nodes_t *)arg;
+    vec2_t offset = sn.tb->tl();
+    add_line_segment_to_nodes(*sn.ctx, a * sn.scale - offset, b * sn.scale - offset, sn.tb);
+  }
+
+  struct shape_nodes_t {
+    shape_t *shape;
+    mat3_t *transform;
+    uint aa;
+    float tolerance;
+  };
+
+  // walks every path of the shape for each tile
+  static void shape_nodes(raster_context_t &ctx, void *arg, rect_t &tb) {
+    shape_nodes_t &job = *(shape_nodes_t *)arg;
+    shape_t *shape = job.shape;
+
+    if(shape->_stroke.width > 0.0f) {
+      stroke_nodes_t sn = {&ctx, &tb, float(1 << job.aa)};
+      for(auto &path : shape->paths) {
+        stroke_path(shape->points(path).data(), path.count, path.closed, shape->_stroke, job.transform, job.tolerance, stroke_node_edge, &sn);
+      }
+    }else{
+      for(auto &path : shape->paths) {
+        if(path.count) {
+          build_nodes(ctx, shape->points(path), &tb, job.transform, job.aa);
+        }
+      }
+    }
+  }
+
+  // fallback for shapes with more edges than the edge buffer holds, every
+  // tile walks every path
+  static void render_unbinned(shape_t *shape, image_t *target, mat3_t *transform, brush_t *brush, rect_t sb, uint8_t *p_alpha_map, uint aa) {
+    raster_context_t &ctx = raster_contexts[0];
+    rect_t clip = target->clip();
+    shape_nodes_t job = {shape, transform, aa, stroke_tolerance(transform, aa)};
 
-    // iterate over tiles
-    //printf("> processing tiles\n");
     for(int y = sb.y; y < sb.y + sb.h; y += TILE_HEIGHT) {
       for(int x = sb.x; x < sb.x + sb.w; x += TILE_WIDTH) {
-        //printf(" > tile %d x %d\n", x, y);
         rect_t tb = rect_t(x, y, TILE_WIDTH, TILE_HEIGHT);
-
-        //printf("  - tile bounds %d, %d (%d x %d)\n", int(tb.x), int(tb.y), int(tb.w), int(tb.h));
-
         tb = clip.intersection(tb).intersection(sb).round();
         if(tb.empty()) { continue; } // if tile empty, skip it
 
-        //printf("  - clipped tile bounds %d, %d (%d x %d)\n", int(tb.x), int(tb.y), int(tb.w), int(tb.h));
-        // screen coordinates for clipped tile
-        int sx = tb.x;
-        int sy = tb.y;
-        int sw = tb.w;
-        int sh = tb.h;
+        render_tile(ctx, shape_nodes, &job, target, brush, p_alpha_map, tb.x, tb.y, tb.w, tb.h, aa);
+      }
+    }
+  }
 
-        tb.x *= (1 << aa);
-        tb.y *= (1 << aa);
-        tb.w *= (1 << aa);
-        tb.h *= (1 << aa);
+  // analytic coverage antialiasing, instead of counting supersampled nodes
+  // each edge deposits its signed area into an accumulation row per scanline
+  // (after the approach used by font-rs). a prefix sum along the row then
+  // gives exact per pixel coverage in a single pass at native resolution
+  struct coverage_segment_t {
+    float x0, y0, x1, y1;
+  };
+
+  #define COVERAGE_STRIDE (TILE_WIDTH + 2)
+
+  coverage_segment_t *coverage_segments = nullptr;
+  int max_coverage_segments = 0;
+  static_assert(COVERAGE_STRIDE * TILE_HEIGHT * sizeof(float) <= NODE_BUFFER_SIZE, "coverage buffer exceeds node buffer");
+
+  // core0 claims the rest of the working buffer while it rasterises a shape
+  // and lays its buffers out from the start of the claim, the edge and
+  // coverage segment lists share the space after the tile buffers
+  #define CORE0_MIN_BUFFER_SIZE (EDGE_BUFFER_OFFSET + 256 * (sizeof(tile_edge_t) + sizeof(active_tile_edge_t)))
+
+  static void claim_core0_buffers(working_buffer_scope_t &scope) {
+    char *buffer = scope.data();
+    size_t lists = scope.size() - EDGE_BUFFER_OFFSET;
+    max_edges = lists / (sizeof(tile_edge_t) + sizeof(active_tile_edge_t));
+    max_coverage_segments = lists / (sizeof(coverage_segment_t) + sizeof(uint32_t));
+    edge_buffer = (tile_edge_t *)&buffer[EDGE_BUFFER_OFFSET];
+    coverage_segments = (coverage_segment_t *)&buffer[EDGE_BUFFER_OFFSET];
+
+    raster_context_t &ctx = raster_contexts[0];
+    ctx.tile_buffer = (uint8_t *)&buffer[0];
+    ctx.node_buffer = (uint32_t *)&buffer[TILE_BUFFER_SIZE];
+    ctx.sorted_node_buffer = (int16_t *)&buffer[TILE_BUFFER_SIZE + MAX_TILE_NODES * sizeof(uint32_t)];
+    ctx.node_count_buffer = (uint16_t *)&buffer[TILE_BUFFER_SIZE + NODE_BUFFER_SIZE];
+    ctx.coverage_buffer = (float *)&buffer[TILE_BUFFER_SIZE];
+    ctx.active_edge_buffer = (active_tile_edge_t *)&buffer[EDGE_BUFFER_OFFSET + max_edges * sizeof(tile_edge_t)];
+    ctx.max_active_edges = max_edges;
+    ctx.active_segment_buffer = (uint32_t *)&buffer[EDGE_BUFFER_OFFSET + max_coverage_segments * sizeof(coverage_segment_t)];
+    ctx.max_active_segments = max_coverage_segments;
+  }
 
-        //printf("  - clipped and scaled tile bounds %d, %d (%d x %d)\n", int(tb.x), int(tb.y), int(tb.w), int(tb.h));
+  static inline bool add_coverage_segment(vec2_t a, vec2_t b, int &count) {
+    if(a.y == b.y) return true; // horizontal edges contribute no area
+    if(count >= max_coverage_segments) return false;
+    coverage_segments[count++] = {a.x, a.y, b.x, b.y};
+    return true;
+  }
 
-        // clear existing tile data and nodes
-        memset(node_count_buffer, 0, NODE_COUNT_BUFFER_SIZE);
-        for (int row = 0; row < sh; ++row) {
-          memset(&tile_buffer[row * TILE_WIDTH], 0, sw);
-        }
+  static void stroke_coverage_edge(void *arg, vec2_t a, vec2_t b) {
+    stroke_edges_t &s = *(stroke_edges_t *)arg;
+    s.grow(a);
+    if(s.fits) {
+      s.fits = add_coverage_segment(a, b, s.count);
+    }
+  }
 
-        //memset(tile_buffer, 0, TILE_WIDTH * TILE_HEIGHT);
+  // accumulate a segment that lies entirely within [0, w] horizontally,
+  // coordinates are relative to the tile origin
+  static void accumulate_segment(raster_context_t &ctx, float x0, float y0, float x1, float y1, int h) {
+    float dir = 1.0f;
+    if(y1 < y0) {
+      std::swap(x0, x1); std::swap(y0, y1);
+      dir = -1.0f;
+    }
 
-        // build the nodes for each path
-        for(auto &path : shape->paths) {
-          build_nodes(&path, &tb, transform, aa);
+    if(y1 <= 0.0f || y0 >= h) return;
+
+    float dxdy = (x1 - x0) / (y1 - y0);
+    float x = x0;
+    if(y0 < 0.0f) {
+      x -= y0 * dxdy;
+    }
+
+    int ys = max(0, int(floorf(y0)));
+    int ye = min(h, int(ceilf(y1)));
+
+    for(int y = ys; y < ye; y++) {
+      float *row = &ctx.coverage_buffer[y * COVERAGE_STRIDE];
+      float dy = min(float(y + 1), y1) - max(float(y), y0);
+      float xnext = x + dxdy * dy;
+      float d = dy * dir;
+
+      float xa = min(x, xnext), xb = max(x, xnext);
+      float xaf = floorf(xa);
+      int xai = int(xaf);
+      int xbi = int(ceilf(xb));
+
+      if(xbi <= xai + 1) {
+        // the segment stays within one pixel on this scanline
+        float xmf = 0.5f * (x + xnext) - xaf;
+        row[xai] += d - d * xmf;
+        row[xai + 1] += d * xmf;
+      }else{
+        // spread the area across every pixel the segment passes through
+        float s = 1.0f / (xb - xa);
+        float x0f = xa - xaf;
+        float a0 = 0.5f * s * (1.0f - x0f) * (1.0f - x0f);
+        float x1f = xb - float(xbi) + 1.0f;
+        float am = 0.5f * s * x1f * x1f;
+
+        row[xai] += d * a0;
+        if(xbi == xai + 2) {
+          row[xai + 1] += d * (1.0f - a0 - am);
+        }else{
+          float a1 = s * (1.5f - x0f);
+          row[xai + 1] += d * (a1 - a0);
+          for(int xi = xai + 2; xi < xbi - 1; xi++) {
+            row[xi] += d * s;
+          }
+          float a2 = a1 + float(xbi - xai - 3) * s;
+          row[xbi - 1] += d * (1.0f - a2 - am);
         }
+        row[xbi] += d * am;
+      }
 
-        rect_t rb = render_nodes(&tb, aa).round();
+      x = xnext;
+    }
+  }
+
+  // split a segment where it crosses the left and right tile edges, pieces
+  // outside the tile become vertical lines on the edge which contributes
+  // exactly the same coverage to the pixels inside it
+  static void accumulate_clipped_segment(raster_context_t &ctx, float x0, float y0, float x1, float y1, int w, int h) {
+    float ts[4] = {0.0f, 0.0f, 0.0f, 1.0f};
+    int tc = 1;
+
+    if(x0 != x1) {
+      float t;
+      t = (0.0f - x0) / (x1 - x0);
+      if(t > 0.0f && t < 1.0f) ts[tc++] = t;
+      t = (float(w) - x0) / (x1 - x0);
+      if(t > 0.0f && t < 1.0f) ts[tc++] = t;
+      if(tc == 3 && ts[1] > ts[2]) std::swap(ts[1], ts[2]);
+    }
+    ts[tc++] = 1.0f;
+
+    float px = x0, py = y0;
+    for(int i = 1; i < tc; i++) {
+      float nx = x0 + (x1 - x0) * ts[i];
+      float ny = y0 + (y1 - y0) * ts[i];
+      if(i == tc - 1) { nx = x1; ny = y1; }
+      accumulate_segment(ctx,
+        max(0.0f, min(px, float(w))), py,
+        max(0.0f, min(nx, float(w))), ny, h);
+      px = nx; py = ny;
+    }
+  }
+
+  // a shape or glyph's rows of tiles, split between the cores when the
+  // target asks for it. part n renders every other row starting at row n,
+  // both parts only read the shared edge or segment list and each has its
+  // own tile and node buffers
+  struct tile_job_t {
+    image_t *target;
+    brush_t *brush;
+    uint8_t *p_alpha_map;
+    rect_t sb;
+    uint aa;
+    int count;          // edges or coverage segments
+    int parts;          // 1 when rendering on a single core
+    glyph_t *glyph;
+    mat3_t *transform;
+  };
+
+  // only worth waking core1 for shapes covering more than one row of tiles
+  static int tile_job_parts(image_t *target, rect_t sb) {
+    return (target->multicore() && core1_worker && sb.h > TILE_HEIGHT) ? 2 : 1;
+  }
+
+  static void run_tile_job(void (*fn)(void *arg, int part), tile_job_t &job) {
+    if(job.parts == 1) {
+      fn(&job, 0);
+    }else{
+      run_parallel(fn, &job);
+    }
+  }
 
+  // sort by top so segments can be admitted to each tile row in order
+  static void sort_coverage_segments(int segment_count) {
+    std::sort(coverage_segments, coverage_segments + segment_count, [](const coverage_segment_t &a, const coverage_segment_t &b) {
+      return min(a.y0, a.y1) < min(b.y0, b.y1);
+    });
+  }
+
+  static void render_coverage(void *arg, int part) {
+    tile_job_t &job = *(tile_job_t *)arg;
+    raster_context_t &ctx = raster_contexts[part];
+    image_t *target = job.target;
+    rect_t sb = job.sb;
+    int segment_count = job.count;
+    rect_t clip = target->clip();
+
+    // indices of the segments crossing the current tile row, in sorted order
+    uint32_t *active = ctx.active_segment_buffer;
+    int next_segment = 0;
+    int active_count = 0;
+
+    int tile_row = 0;
+    for(int y = sb.y; y < sb.y + sb.h; y += TILE_HEIGHT, tile_row++) {
+      // as in render_tile_rows the other core's rows are skipped and the
+      // active list catches up on the next row this core renders
+      if(tile_row % job.parts != part) { continue; }
+
+      // every tile in the row shares the same vertical extent
+      rect_t rowb = clip.intersection(rect_t(sb.x, y, sb.w, TILE_HEIGHT)).intersection(sb).round();
+      if(rowb.empty()) { continue; }
+
+      // admit segments that start above the bottom of this row, retire
+      // those that ended above its top
+      while(next_segment < segment_count) {
+        coverage_segment_t &s = coverage_segments[next_segment];
+        if(min(s.y0, s.y1) >= rowb.y + rowb.h) break;
+        active[active_count++] = next_segment++;
+      }
+
+      int kept = 0;
+      for(int i = 0; i < active_count; i++) {
+        coverage_segment_t &s = coverage_segments[active[i]];
+        if(max(s.y0, s.y1) <= rowb.y) continue;
+        active[kept++] = active[i];
+      }
+      active_count = kept;
+
+      for(int x = sb.x; x < sb.x + sb.w; x += TILE_WIDTH) {
+        rect_t tb = clip.intersection(rect_t(x, y, TILE_WIDTH, TILE_HEIGHT)).intersection(sb).round();
         if(tb.empty()) { continue; }
 
-        int rbx = rb.x;
-        int rby = rb.y;
-        int rbw = rb.w;
-        int rbh = rb.h;
+        int tx = tb.x;
+        int ty = tb.y;
+        int tw = tb.w;
+        int th = tb.h;
 
-        for(int ty = rby; ty < rby + rbh; ty++) {
-          uint8_t* p;
+        memset(ctx.coverage_buffer, 0, COVERAGE_STRIDE * th * sizeof(float));
 
-          // scale tile buffer values to alpha values
-          p = &tile_buffer[ty * TILE_WIDTH + rbx];
-          int c = rbw;
-          while(c--) {
-            *p = p_alpha_map[*p];
-            p++;
+        bool touched = false;
+        for(int i = 0; i < active_count; i++) {
+          coverage_segment_t &s = coverage_segments[active[i]];
+          if(min(s.x0, s.x1) >= tx + tw) continue; // only affects pixels to its right
+
+          accumulate_clipped_segment(ctx, s.x0 - tx, s.y0 - ty, s.x1 - tx, s.y1 - ty, tw, th);
+          touched = true;
+        }
+
+        if(!touched) { continue; }
+
+        for(int row = 0; row < th; row++) {
+          float *acc = &ctx.coverage_buffer[row * COVERAGE_STRIDE];
+          uint8_t *p = &ctx.tile_buffer[row * TILE_WIDTH];
+
+          // integrate along the row, folding the winding for even-odd fill
+          // to match the other antialias modes
+          float sum = 0.0f;
+          int x1 = tw, x2 = 0;
+          for(int i = 0; i < tw; i++) {
+            sum += acc[i];
+            float c = fabsf(sum);
+            if(c > 1.0f) {
+              c = fmodf(c, 2.0f);
+              if(c > 1.0f) c = 2.0f - c;
+            }
+            uint8_t a = uint8_t(c * 255.0f + 0.5f);
+            p[i] = a;
+            if(a) {
+              x1 = min(x1, i);
+              x2 = i + 1;
+            }
           }
 
-          // render tile span
-          p = &tile_buffer[ty * TILE_WIDTH + rbx];
+          if(x2 > x1) {
+            render_mask_row(target, job.brush, tx + x1, ty + row, x2 - x1, &p[x1]);
+          }
+        }
+      }
+    }
+  }
 
-          fn(target, brush, sx + rbx, sy + ty, rbw, p);
-          //sf(target, brush, sx + rbx, sy + ty, rbw, (uint8_t*)p);
+  // the active edges of a row of tiles, tiles must be visited left to right
+  // so that edges passing wholly to their left are only counted once
+  struct tile_row_nodes_t {
+    active_tile_edge_t *active;
+    int active_count;
+    uint8_t *left_parity; // per scanline of the tile row
+    int ry0;              // first scanline of the tile row
+  };
+
+  static void tile_row_nodes(raster_context_t &ctx, void *arg, rect_t &tb) {
+    tile_row_nodes_t &row = *(tile_row_nodes_t *)arg;
+
+    int tx = tb.x;
+    int tw = tb.w;
+    int ty0 = tb.y;
+    int ty1 = tb.y + tb.h;
+
+    for(int i = 0; i < row.active_count; i++) {
+      active_tile_edge_t &a = row.active[i];
+      if(a.row0 >= a.row1) continue;
+
+      if(a.maxx < tx) {
+        // edges left of the tile would all clamp to column 0, only their
+        // parity matters and that doesn't change for the rest of the row
+        if(!a.left) {
+          for(int r = a.row0; r < a.row1; r++) {
+            row.left_parity[r - row.ry0] ^= 1;
+          }
+          a.left = true;
         }
+        continue;
+      }
+
+      if(a.minx >= tx + tw) {
+        // likewise edges to the right all clamp to the last column, their
+        // pairing is restored below
+        continue;
+      }
+
+      // a split tile only covers some of the row's scanlines
+      int r0 = max(a.row0, ty0);
+      int r1 = min(a.row1, ty1);
+
+      tile_edge_t *e = a.edge;
+      int64_t ex = e->x + int64_t(r0 - e->row0) * e->step;
+      for(int r = r0; r < r1; r++) {
+        int ix = int(ex >> 24) - tx;
+        add_node(ctx, r - ty0, max(min(ix, tw), 0));
+        ex += e->step;
+      }
+    }
+
+    for(int r = 0; r < ty1 - ty0; r++) {
+      if(row.left_parity[r + ty0 - row.ry0]) {
+        add_node(ctx, r, 0);
+      }
+      if(ctx.node_count_buffer[r] & 1) {
+        add_node(ctx, r, tw);
       }
     }
   }
 
+  static void render_tile_rows(void *arg, int part) {
+    tile_job_t &job = *(tile_job_t *)arg;
+    raster_context_t &ctx = raster_contexts[part];
+    image_t *target = job.target;
+    rect_t sb = job.sb;
+    uint aa = job.aa;
+    int edge_count = job.count;
+    rect_t clip = target->clip();
+
+    // parity of the edges wholly to the left of the current tile, per scanline
+    uint8_t left_parity[TILE_SAMPLE_ROWS];
 
+    int next_edge = 0;
+    int active_count = 0;
 
+    int tile_row = 0;
+    for(int y = sb.y; y < sb.y + sb.h; y += TILE_HEIGHT, tile_row++) {
+      // rows belonging to the other core are skipped outright, edges are
+      // admitted and retired by position so the active list catches up on
+      // the next row this core renders
+      if(tile_row % job.parts != part) { continue; }
 
+      // every tile in the row shares the same vertical extent
+      rect_t rowb = clip.intersection(rect_t(sb.x, y, sb.w, TILE_HEIGHT)).intersection(sb).round();
+      if(rowb.empty()) { continue; }
 
+      int ry0 = int(rowb.y) << aa;
+      int ry1 = int(rowb.y + rowb.h) << aa;
+
+      // admit edges that start above the bottom of this row, retire those
+      // that ended above its top
+      while(next_edge < edge_count && edge_buffer[next_edge].row0 < ry1) {
+        ctx.active_edge_buffer[active_count++].edge = &edge_buffer[next_edge++];
+      }
 
+      int kept = 0;
+      for(int i = 0; i < active_count; i++) {
+        active_tile_edge_t a = ctx.active_edge_buffer[i];
+        tile_edge_t *e = a.edge;
+        if(e->row1 <= ry0) continue;
+
+        a.row0 = max(e->row0, ry0);
+        a.row1 = min(e->row1, ry1);
+        a.left = false;
+
+        if(a.row0 < a.row1) {
+          int x0 = int((e->x + int64_t(a.row0 - e->row0) * e->step) >> 24);
+          int x1 = int((e->x + int64_t(a.row1 - 1 - e->row0) * e->step) >> 24);
+          a.minx = min(x0, x1);
+          a.maxx = max(x0, x1);
+        } else {
+          // starts further down, nothing to contribute to this row yet
+          a.minx = INT32_MAX;
+          a.maxx = INT32_MIN;
+        }
+
+        ctx.active_edge_buffer[kept++] = a;
+      }
+      active_count = kept;
 
+      memset(left_parity, 0, sizeof(left_parity));
+      tile_row_nodes_t nodes = {ctx.active_edge_buffer, active_count, left_parity, ry0};
 
+      for(int x = sb.x; x < sb.x + sb.w; x += TILE_WIDTH) {
+        rect_t tb = rect_t(x, y, TILE_WIDTH, TILE_HEIGHT);
+        tb = clip.intersection(tb).intersection(sb).round();
+        if(tb.empty()) { continue; } // if tile empty, skip it
+
+        render_tile(ctx, tile_row_nodes, &nodes, target, job.brush, job.p_alpha_map, tb.x, tb.y, tb.w, tb.h, aa);
+      }
+    }
+  }
 
+  void render(shape_t *shape, image_t *target, mat3_t *transform, brush_t *brush) {
 
+    if(shape->paths.empty()) return;
+    profile_scope_t profile(PROFILE_RENDER);
 
+    working_buffer_scope_t scope("render", CORE0_MIN_BUFFER_SIZE, true);
+    if(!scope.ok()) return;
+    claim_core0_buffers(scope);
 
+    // antialias level of target image
+    uint aa = (uint)target->antialias();
 
+    if(aa == ANALYTIC) {
+      int count = 0;
+      bool fits = true;
+      float minx = FLT_MAX, miny = FLT_MAX, maxx = -FLT_MAX, maxy = -FLT_MAX;
+      if(shape->_stroke.width > 0.0f) {
+        stroke_edges_t s;
+        float tolerance = stroke_tolerance(transform, aa);
+        for(auto &path : shape->paths) {
+          stroke_path(shape->points(path).data(), path.count, path.closed, shape->_stroke, transform, tolerance, stroke_coverage_edge, &s);
+        }
+        minx = s.minx; miny = s.miny; maxx = s.maxx; maxy = s.maxy;
+        count = s.count;
+        fits = s.fits;
+      }else{
+        for(auto &path : shape->paths) {
+          point_span_t points = shape->points(path);
+          if(points.empty()) continue;
+          vec2_t last = points.back();
+          if(transform) last = last.transform(transform);
+          for(auto next : points) {
+            if(transform) next = next.transform(transform);
+            minx = min(minx, next.x); miny = min(miny, next.y);
+            maxx = max(maxx, next.x); maxy = max(maxy, next.y);
+            if(fits) fits = add_coverage_segment(last, next, count);
+            last = next;
+          }
+        }
+      }
 
+      scope.used(fits ? EDGE_BUFFER_OFFSET + count * (sizeof(coverage_segment_t) + sizeof(uint32_t)) : scope.size());
+      if(fits) {
+        sort_coverage_segments(count);
+        rect_t sb = rect_t(minx, miny, maxx - minx, maxy - miny).round();
+        profile.pixels(sb.intersection(target->clip()).area());
+        tile_job_t job = {target, brush, nullptr, sb, aa, count, tile_job_parts(target, sb), nullptr, transform};
+        // core1's active segment list is smaller, busier shapes stay on this core
+        if(count > raster_contexts[1].max_active_segments) {
+          job.parts = 1;
+        }
+        run_tile_job(render_coverage, job);
+        return;
+      }
 
+      // too many edges to hold at once, supersample instead
+      aa = X4;
+    }
 
+    uint8_t *p_alpha_map = alpha_map_none;
+    if(aa == 1) p_alpha_map = alpha_map_x4;
+    if(aa == 2) p_alpha_map = alpha_map_x16;
 
+    // transform the shape once, the bounds come out of the same pass
+    rect_t sb;
+    int edge_count;
+
+    shape_cache_t &cache = shape->_cache;
+    mat3_t t = transform ? *transform : mat3_t();
+    bool unchanged = cache.aa == int(aa) && cache.version == shape->version && memcmp(&cache.transform, &t, sizeof(mat3_t)) == 0;
+
+    if(unchanged && cache.edge_count && cache.edge_count <= max_edges) {
+      // nothing moved since the last draw, skip transform and setup
+      edge_count = cache.edge_count;
+      memcpy(edge_buffer, cache.edges.data(), edge_count * sizeof(tile_edge_t));
+      sb = cache.bounds;
+    }else{
+      edge_count = build_edges(shape, transform, aa, sb);
+      sb = sb.round();
+
+      if(!unchanged) {
+        // remember the key, the edges are only kept once the shape is drawn
+        // the same way twice so animated shapes never pay for the copy
+        cache.version = shape->version;
+        cache.transform = t;
+        cache.aa = aa;
+        cache.edge_count = 0;
+      }else if(edge_count > 0) {
+        cache.edges.resize(edge_count * sizeof(tile_edge_t));
+        memcpy(cache.edges.data(), edge_buffer, edge_count * sizeof(tile_edge_t));
+        cache.edge_count = edge_count;
+        cache.bounds = sb;
+      }
+    }
 
+    profile.pixels(sb.intersection(target->clip()).area());
+    scope.used(edge_count < 0 ? scope.size() : EDGE_BUFFER_OFFSET + edge_count * (sizeof(tile_edge_t) + sizeof(active_tile_edge_t)));
+    if(edge_count < 0) {
+      render_unbinned(shape, target, transform, brush, sb, p_alpha_map, aa);
+      return;
+    }
 
+    tile_job_t job = {target, brush, p_alpha_map, sb, aa, edge_count, tile_job_parts(target, sb), nullptr, transform};
 
+    // core1's active edge list is smaller, busier shapes stay on this core
+    if(edge_count > raster_contexts[1].max_active_edges) {
+      job.parts = 1;
+    }
 
+    run_tile_job(render_tile_rows, job);
+  }
 
-  void build_glyph_nodes(glyph_path_t *path, rect_t *tb, mat3_t *transform, uint aa) {
+  void build_glyph_nodes(raster_context_t &ctx, glyph_path_t *path, rect_t *tb, mat3_t *transform, uint aa) {
     vec2_t offset = tb->tl();
     // start with the last point to close the loop, transform it, scale for antialiasing, and offset to tile origin
     glyph_path_point_t *p = &path->points[path->point_count - 1];
@@ -296,100 +1099,102 @@ namespace picovector {
       next -= offset;
 
       //printf("   - add line segment %d, %d -> %d, %d\n", int(last.x), int(last.y), int(next.x), int(next.y));
-      add_line_segment_to_nodes(last, next, tb);
+      add_line_segment_to_nodes(ctx, last, next, tb);
       last = next;
     }
   }
 
-  void render_glyph(glyph_t *glyph, image_t *target, mat3_t *transform, brush_t *brush) {
+  struct glyph_nodes_t {
+    glyph_t *glyph;
+    mat3_t *transform;
+    uint aa;
+  };
 
-    if(!glyph->path_count) return;
-
-    // antialias level of target image
-    uint aa = (uint)target->antialias();
-
-
-    uint8_t *p_alpha_map = alpha_map_none;
-    if(aa == 1) p_alpha_map = alpha_map_x4;
-    if(aa == 2) p_alpha_map = alpha_map_x16;
-
-    //printf("render shape\n");
+  static void glyph_nodes(raster_context_t &ctx, void *arg, rect_t &tb) {
+    glyph_nodes_t &job = *(glyph_nodes_t *)arg;
+    for(int i = 0; i < job.glyph->path_count; i++) {
+      build_glyph_nodes(ctx, &job.glyph->paths[i], &tb, job.transform, job.aa);
+    }
+  }
 
-    // determine bounds of shape to be rendered
-    rect_t sb = glyph->bounds(transform).round();
+  static void render_glyph_tiles(void *arg, int part) {
+    tile_job_t &job = *(tile_job_t *)arg;
+    raster_context_t &ctx = raster_contexts[part];
+    image_t *target = job.target;
+    rect_t sb = job.sb;
+    uint aa = job.aa;
 
     rect_t clip = target->clip();
+    glyph_nodes_t nodes = {job.glyph, job.transform, aa};
 
-    masked_span_func_t fn = target->_masked_span_func;
-
-    //printf("- shape bounds %d, %d (%d x %d)\n", sbx, sby, sbw, sbh);
-    //printf("- clip bounds %d, %d (%d x %d)\n", int(clip.x), int(clip.y), int(clip.w), int(clip.h));
+    int tile_row = 0;
+    for(int y = sb.y; y < sb.y + sb.h; y += TILE_HEIGHT, tile_row++) {
+      if(tile_row % job.parts != part) { continue; }
 
-    // iterate over tiles
-    //printf("> processing tiles\n");
-    for(int y = sb.y; y < sb.y + sb.h; y += TILE_HEIGHT) {
       for(int x = sb.x; x < sb.x + sb.w; x += TILE_WIDTH) {
-        //printf(" > tile %d x %d\n", x, y);
         rect_t tb = rect_t(x, y, TILE_WIDTH, TILE_HEIGHT);
-
-        //printf("  - tile bounds %d, %d (%d x %d)\n", int(tb.x), int(tb.y), int(tb.w), int(tb.h));
-
         tb = clip.intersection(tb).intersection(sb).round();
         if(tb.empty()) { continue; } // if tile empty, skip it
 
-        //printf("  - clipped tile bounds %d, %d (%d x %d)\n", int(tb.x), int(tb.y), int(tb.w), int(tb.h));
-        // screen coordinates for clipped tile
-        int sx = tb.x;
-        int sy = tb.y;
-        int sw = tb.w;
-        int sh = tb.h;
+        render_tile(ctx, glyph_nodes, &nodes, target, job.brush, job.p_alpha_map, tb.x, tb.y, tb.w, tb.h, aa);
+      }
+    }
+  }
 
-        tb.x *= (1 << aa);
-        tb.y *= (1 << aa);
-        tb.w *= (1 << aa);
-        tb.h *= (1 << aa);
+  void render_glyph(glyph_t *glyph, image_t *target, mat3_t *transform, brush_t *brush) {
 
-        //printf("  - clipped and scaled tile bounds %d, %d (%d x %d)\n", int(tb.x), int(tb.y), int(tb.w), int(tb.h));
+    if(!glyph->path_count) return;
+    profile_scope_t profile(PROFILE_GLYPH);
 
-        // clear existing tile data and nodes
-        memset(node_count_buffer, 0, NODE_COUNT_BUFFER_SIZE);
-        for (int row = 0; row < sh; ++row) {
-          memset(&tile_buffer[row * TILE_WIDTH], 0, sw);
-        }
+    working_buffer_scope_t scope("render", CORE0_MIN_BUFFER_SIZE, true);
+    if(!scope.ok()) return;
+    claim_core0_buffers(scope);
 
-        //memset(tile_buffer, 0, TILE_WIDTH * TILE_HEIGHT);
+    // antialias level of target image
+    uint aa = (uint)target->antialias();
 
-        // build the nodes for each path
-        for(int i = 0; i < glyph->path_count; i++) {
-          glyph_path_t *p = &glyph->paths[i];
-          build_glyph_nodes(p, &tb, transform, aa);
+    // determine bounds of shape to be rendered
+    rect_t sb = glyph->bounds(transform).round();
+    profile.pixels(sb.intersection(target->clip()).area());
+
+    if(aa == ANALYTIC) {
+      int count = 0;
+      bool fits = true;
+      for(int i = 0; i < glyph->path_count && fits; i++) {
+        glyph_path_t *path = &glyph->paths[i];
+        if(!path->point_count) continue;
+        glyph_path_point_t *p = &path->points[path->point_count - 1];
+        vec2_t last = vec2_t(p->x, p->y);
+        if(transform) last = last.transform(transform);
+        for(int j = 0; j < path->point_count && fits; j++) {
+          p = &path->points[j];
+          vec2_t next = vec2_t(p->x, p->y);
+          if(transform) next = next.transform(transform);
+          fits = add_coverage_segment(last, next, count);
+          last = next;
         }
+      }
 
-        rect_t rb = render_nodes(&tb, aa).round();
-
-        if(tb.empty()) { continue; }
-
-        int rbx = rb.x;
-        int rby = rb.y;
-        int rbw = rb.w;
-        int rbh = rb.h;
-
-        for(int ty = rby; ty < rby + rbh; ty++) {
-          uint8_t* p;
-
-          // scale tile buffer values to alpha values
-          p = &tile_buffer[ty * TILE_WIDTH + rbx];
-          int c = rbw;
-          while(c--) {
-            *p = p_alpha_map[*p];
-            p++;
-          }
-
-          // render tile span
-          p = &tile_buffer[ty * TILE_WIDTH + rbx];
-          fn(target, brush, sx + rbx, sy + ty, rbw, p);
+      scope.used(fits ? EDGE_BUFFER_OFFSET + count * (sizeof(coverage_segment_t) + sizeof(uint32_t)) : scope.size());
+      if(fits) {
+        sort_coverage_segments(count);
+        tile_job_t job = {target, brush, nullptr, sb, aa, count, tile_job_parts(target, sb), glyph, transform};
+        if(count > raster_contexts[1].max_active_segments) {
+          job.parts = 1;
         }
+        run_tile_job(render_coverage, job);
+        return;
       }
+
+      aa = X4;
     }
+
+    uint8_t *p_alpha_map = alpha_map_none;
+    if(aa == 1) p_alpha_map = alpha_map_x4;
+    if(aa == 2) p_alpha_map = alpha_map_x16;
+
+    scope.used(EDGE_BUFFER_OFFSET);
+    tile_job_t job = {target, brush, p_alpha_map, sb, aa, 0, tile_job_parts(target, sb), glyph, transform};
+    run_tile_job(render_glyph_tiles, job);
   }
 }
@@ -26,6 +26,12 @@
 #define PV_REALLOC realloc
 #endif
 
+// tags what's allocated in the rest of the enclosing scope with what it's
+// for (PV_ALLOC_SHAPE, PV_ALLOC_PATH, ...) so ports can count allocations
+#ifndef PV_ALLOC_SCOPE
+#define PV_ALLOC_SCOPE(kind)
+#endif
+
 // TODO: bring back AA support
 const size_t working_buffer_size = (50 + 20) * 1024;
 extern char __attribute__((aligned(4))) PicoVector_working_buffer[working_buffer_size];
@@ -53,5 +59,6 @@ namespace picovector {
 
   void render(shape_t *shape, image_t *target, mat3_t *transform, brush_t *brush);
   void render_glyph(glyph_t *shape, image_t *target, mat3_t *transform, brush_t *brush);
+  void render_mask_row(image_t *target, brush_t *brush, int x, int y, int w, uint8_t *mask);
 
 }
\ No newline at end of file
@@ -33,28 +33,102 @@ namespace picovector {
     return -1;  // not found
   }
 
+  uint8_t *pixel_font_t::glyph_bitmap(int index) {
+    if(this->glyph_data) {
+      return &this->glyph_data[this->glyph_data_size * index];
+    }
+
+    pixel_font_cache_t *c = &this->cache;
+    c->tick++;
+
+    uint32_t slot = 0;
+    for(uint32_t i = 0; i < c->count; i++) {
+      if(c->index[i] == index) {
+        c->used[i] = c->tick;
+        return &c->bitmaps[this->glyph_data_size * i];
+      }
+      if(c->used[i] < c->used[slot]) {
+        slot = i;
+      }
+    }
+
+    uint8_t *bitmap = &c->bitmaps[this->glyph_data_size * slot];
+    c->index[slot] = -1;
+    if(!this->source.read(this->source.context, index, bitmap)) {
+      return nullptr;
+    }
+    c->index[slot] = index;
+    c->used[slot] = c->tick;
+    return bitmap;
+  }
+
+  bool pixel_font_t::resolve(int codepoint, pixel_font_t *&font, int &index) {
+    font = this;
+    index = this->glyph_index(codepoint);
+    if(index != -1 || !this->fallback) {
+      return index != -1;
+    }
+
+    auto e = this->fallback_cache.lookup(codepoint);
+    if(!e) {
+      pixel_font_t *f = this->fallback;
+      int i = -1;
+      for(; f; f = f->fallback) {
+        i = f->glyph_index(codepoint);
+        if(i != -1) {
+          break;
+        }
+      }
+      this->fallback_cache.store(codepoint, f, i);
+      e = this->fallback_cache.lookup(codepoint);
+    }
+
+    font = e->font;
+    index = e->index;
+    return index != -1;
+  }
+
+  // 32 columns of a packed glyph row, starting at column word * 32 and
+  // with the leftmost column in the top bit
+  static inline uint32_t row_bits(const uint8_t *data, uint32_t bytes_per_row, int word) {
+    uint32_t bits = 0;
+    for(uint32_t i = word * 4; i < uint32_t(word * 4 + 4); i++) {
+      bits = (bits << 8) | (i < bytes_per_row ? data[i] : 0);
+    }
+    return bits;
+  }
+
   rect_t pixel_font_t::measure(image_t *target, const char *text) {
     rect_t tb = target->clip();
     rect_t b(tb.x + tb.w, tb.y + tb.h, 0, this->height);
 
     vec2_t caret(0, 0);
-    while(*text != '\0') {
+    auto glyph = [&](int codepoint) {
       // special case for "space"
-      if(*text == 32) {
+      if(codepoint == 32) {
         caret.x += this->width / 3;
-        text++;
-        continue;
+        return;
       }
 
-      int glyph_index = this->glyph_index(*text);
-      if(glyph_index != -1) {
-        pixel_font_glyph_t *glyph = &this->glyphs[glyph_index];
+      pixel_font_t *font;
+      int glyph_index;
+      if(this->resolve(codepoint, font, glyph_index)) {
+        pixel_font_glyph_t *glyph = &font->glyphs[glyph_index];
         caret.x += glyph->width + 1;
 
         b.x = min(caret.x, b.x);
         b.w = max(caret.x, b.w);
       }
-      text++;
+    };
+
+    // runs of ascii skip the decoder
+    while(*text != '\0') {
+      for(const char *end = text + ascii_run(text); text < end; text++) {
+        glyph(*text);
+      }
+      if(*text != '\0') {
+        glyph(utf8_next(text));
+      }
     }
     return b;
   }
@@ -77,29 +151,57 @@ namespace picovector {
     int xc = glyph->width - xoff;
     xc = min(xc, int(bounds.x + bounds.w - xf));
 
-    //uint32_t *dst = (uint32_t *)target->ptr(0, yf);
-    uint32_t row_stride = target->row_stride() / 4;
-
     span_func_t fn = target->_span_func;
 
+    // runs of set bits are found a word at a time and each one drawn as a
+    // single span, rather than testing and drawing the glyph pixel by pixel
+    int first = xoff >> 5;
+    int last = (xoff + xc - 1) >> 5;
+
     data += yoff * bytes_per_row;
-    for(int yo = yf; yo < yf + yc; yo++) {
-      for(int xo = xf; xo < xf + xc; xo++) {
-        int bit = xo - x;
-        uint8_t b = data[bit >> 3];
-        if(b & (0b1 << (7 - (bit & 0b111)))) {
-          //brush->pixel(&dst[xo]);
-          //brush->render_span(target, xo, yo, 1);
-          fn(target, brush, xo, yo, 1);
+    for(int yo = yf; yo < yf + yc && xc > 0; yo++) {
+      int run_x = 0, run_w = 0;
+
+      for(int word = first; word <= last; word++) {
+        uint32_t bits = row_bits(data, bytes_per_row, word);
+
+        // drop any columns outside of the clipped range
+        int lo = xoff - (word << 5);
+        int hi = xoff + xc - (word << 5);
+        if(lo > 0) bits &= ~0u >> lo;
+        if(hi < 32) bits &= ~(~0u >> hi);
+
+        while(bits) {
+          int start = __builtin_clz(bits);
+          uint32_t rest = ~(bits << start);
+          int length = rest ? __builtin_clz(rest) : 32 - start;
+          bits = start + length < 32 ? bits & (~0u >> (start + length)) : 0;
+
+          // runs that carry on across a word boundary are joined up
+          int column = (word << 5) + start;
+          if(run_w && run_x + run_w == column) {
+            run_w += length;
+          }else{
+            if(run_w) {
+              fn(target, brush, x + run_x, yo, run_w);
+            }
+            run_x = column;
+            run_w = length;
+          }
         }
       }
 
-      //dst += row_stride;
+      if(run_w) {
+        fn(target, brush, x + run_x, yo, run_w);
+      }
+
       data += bytes_per_row;
     }
   }
 
   void pixel_font_t::draw(image_t *target, const char *text, int x, int y) {
+    target->modified();
+
     // check if text is within clipping area
     rect_t text_bounds = this->measure(target, text);
     text_bounds.x = x;
@@ -114,27 +216,38 @@ namespace picovector {
 
     brush_t *brush = target->brush();
 
-    while(*text != '\0') {
+    auto glyph = [&](int codepoint) {
       // special case for "space"
-      if(*text == 32) {
+      if(codepoint == 32) {
         x += this->width / 3;
-        text++;
-        continue;
+        return;
       }
 
-      int glyph_index = this->glyph_index(*text);
-      if(glyph_index != -1) {
-        pixel_font_glyph_t *glyph = &this->glyphs[glyph_index];
-        uint8_t *data = &this->glyph_data[this->glyph_data_size * glyph_index];
+      pixel_font_t *font;
+      int glyph_index;
+      if(this->resolve(codepoint, font, glyph_index)) {
+        pixel_font_glyph_t *glyph = &font->glyphs[glyph_index];
 
-        draw_glyph(target, glyph, data, brush, bounds, x, y);
+        // glyphs off to either side aren't worth fetching from a stream
+        if(x + glyph->width > bounds.x && x < bounds.x + bounds.w) {
+          if(uint8_t *data = font->glyph_bitmap(glyph_index)) {
+            font->draw_glyph(target, glyph, data, brush, bounds, x, y);
+          }
+        }
 
         x += glyph->width + 1;
       }
+    };
 
-      text++;
+    // runs of ascii skip the decoder
+    while(*text != '\0') {
+      for(const char *end = text + ascii_run(text); text < end; text++) {
+        glyph(*text);
+      }
+      if(*text != '\0') {
+        glyph(utf8_next(text));
+      }
     }
-
   }
 
 }
\ No newline at end of file
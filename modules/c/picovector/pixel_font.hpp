@@ -8,6 +8,7 @@
 #include "shape.hpp"
 #include "types.hpp"
 #include "mat3.hpp"
+#include "text.hpp"
 
 using std::vector;
 using std::pair;
@@ -22,6 +23,23 @@ namespace picovector {
     uint16_t width;
   };
 
+  // where a streamed font's glyph bitmaps come from, read fills dst with
+  // the bitmap of glyph index and returns false if it couldn't
+  struct pixel_font_source_t {
+    void *context;
+    bool (*read)(void *context, uint32_t index, uint8_t *dst);
+  };
+
+  // bitmaps of a streamed font's recently drawn glyphs, when it's full the
+  // least recently used slot is reused
+  struct pixel_font_cache_t {
+    uint32_t count;
+    uint8_t *bitmaps;   // count slots of glyph_data_size bytes
+    int32_t *index;     // glyph held by each slot, -1 when empty
+    uint32_t *used;     // tick each slot was last drawn at
+    uint32_t tick;
+  };
+
   class pixel_font_t {
   public:
     uint32_t glyph_count;
@@ -31,10 +49,26 @@ namespace picovector {
     char name[32];
 
     pixel_font_glyph_t *glyphs;
-    uint8_t *glyph_data;
+    uint8_t *glyph_data;       // null when the bitmaps are streamed
+
+    pixel_font_source_t source;
+    pixel_font_cache_t cache;
 
     int glyph_index(int codepoint);
 
+    // the bitmap for glyph index, read into the cache first for streamed
+    // fonts. null if it couldn't be read
+    uint8_t *glyph_bitmap(int index);
+
+    // font to take glyphs from when this one doesn't have them, which may
+    // have a fallback of its own
+    pixel_font_t *fallback;
+    fallback_cache_t<pixel_font_t> fallback_cache;
+
+    // finds the font and glyph index used to draw codepoint, following the
+    // fallback chain, returns false if nothing in the chain has it
+    bool resolve(int codepoint, pixel_font_t *&font, int &index);
+
     void draw(image_t *target, const char *text, int x, int y);
     void draw_glyph(image_t *target, const pixel_font_glyph_t *glyph, uint8_t *data, brush_t *brush, const rect_t &bounds, int x, int y);
     rect_t measure(image_t *target, const char *text);
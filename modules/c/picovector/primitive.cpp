@@ -1,161 +1,279 @@
+#include <initializer_list>
+
 #include "picovector.hpp"
 #include "primitive.hpp"
 
 namespace picovector {
 
-  shape_t* regular_polygon(float x, float y, float sides, float radius) {
-    shape_t *result = new(PV_MALLOC(sizeof(shape_t))) shape_t(1);
-    path_t poly(sides);
+  // primitives are a single closed path of up to point_count points, the
+  // shape's storage is kept so a shape rebuilt every frame stops allocating
+  static void reuse_path(shape_t *shape, int point_count) {
+    PV_ALLOC_SCOPE(PV_ALLOC_PATH);
+    shape->clear();
+    shape->_points.reserve(point_count);
+    shape->begin_path();
+  }
+
+  // shapes without curves to flatten are plain paths once built
+  static shape_t *built_path(shape_t *shape) {
+    shape->_primitive.type = primitive_t::NONE;
+    shape->invalidate();
+    return shape;
+  }
+
+  static shape_t *new_shape() {
+    PV_ALLOC_SCOPE(PV_ALLOC_SHAPE);
+    return new(PV_MALLOC(sizeof(shape_t))) shape_t(1);
+  }
+
+  shape_t* set_regular_polygon(shape_t *shape, float x, float y, float sides, float radius) {
+    reuse_path(shape, sides);
     for(int i = 0; i < sides; i++) {
       float theta = ((M_PI * 2.0f) / (float)sides) * (float)i;
-      poly.add_point(sin(theta) * radius + x, cos(theta) * radius + y);
+      shape->add_point(sin(theta) * radius + x, cos(theta) * radius + y);
     }
-    result->add_path(poly);
-    return result;
+    return built_path(shape);
   }
 
-  shape_t* circle(float x, float y, float radius) {
-    int sides = 32;
-    return regular_polygon(x, y, sides, radius);
+  shape_t* regular_polygon(float x, float y, float sides, float radius) {
+    return set_regular_polygon(new_shape(), x, y, sides, radius);
   }
 
-  shape_t* rectangle(float x, float y, float w, float h) {
-    shape_t *result = new(PV_MALLOC(sizeof(shape_t))) shape_t(1);
-    path_t poly(4);
-    poly.add_point(x, y);
-    poly.add_point(x + w, y);
-    poly.add_point(x + w, y + h);
-    poly.add_point(x, y + h);
-    result->add_path(poly);
-    return result;
-  }
-
-  void _build_rounded_rectangle_corner(path_t *path, float x, float y, float r, int q) {
-    float quality = 5; // higher the number, lower the quality - selected by experiment
-    int steps = ceil(r / quality) + 1;
+  // maximum distance between a flattened curve and the true one in device
+  // pixels, for each antialias level. finer sampling shows finer facets
+  static const float flatten_tolerance[] = {0.5f, 0.25f, 0.2f, 0.2f};
+
+  // segments needed to keep a curve of radius r within tolerance over a
+  // full turn, a handful at minimum so tiny shapes stay round
+  static int curve_segments(float r, float tolerance) {
+    if(r <= tolerance) return 8;
+    float theta = 2.0f * acosf(1.0f - tolerance / r);
+    return max(8, min(256, int(ceilf(float(M_PI * 2) / theta))));
+  }
+
+  // segments for a sweep of part of a turn, at least one
+  static int sweep_segments(int segments, float sweep) {
+    return max(1, int(ceilf(segments * fabsf(sweep) / float(M_PI * 2))));
+  }
+
+  static void build_circle(shape_t *shape, float *p, int segments) {
+    for(int i = 0; i < segments; i++) {
+      float theta = ((M_PI * 2.0f) / (float)segments) * (float)i;
+      shape->add_point(sin(theta) * p[2] + p[0], cos(theta) * p[2] + p[1]);
+    }
+  }
+
+  void _build_rounded_rectangle_corner(shape_t *shape, float x, float y, float r, int q, int segments) {
+    int steps = sweep_segments(segments, M_PI / 2);
     float delta = -(M_PI / 2) / float(steps);
     float theta = (M_PI / 2) * q; // select start theta for this quadrant
     for(int i = 0; i <= steps; i++) {
       float xo = sin(theta) * r, yo = cos(theta) * r;
-      path->add_point((vec2_t){x + xo, y + yo});
+      shape->add_point((vec2_t){x + xo, y + yo});
       theta += delta;
     }
   }
 
-  shape_t* rounded_rectangle(float x, float y, float w, float h, float r1, float r2, float r3, float r4) {
-    shape_t *result = new(PV_MALLOC(sizeof(shape_t))) shape_t(1);
-    path_t poly(4);
+  static void build_rounded_rectangle(shape_t *shape, float *p, float tolerance) {
+    float x = p[0], y = p[1], w = p[2], h = p[3];
+    float r1 = p[4], r2 = p[5], r3 = p[6], r4 = p[7];
 
     // render corners (either hard if radius == 0 or calculate rounded corner vec2s)
-    r1 == 0 ? poly.add_point((vec2_t){x    , y    }) : _build_rounded_rectangle_corner(&poly, x + 0 + r1, y + 0 + r1, r1, 3);
-    r2 == 0 ? poly.add_point((vec2_t){x + w, y    }) : _build_rounded_rectangle_corner(&poly, x + w - r2, y + 0 + r2, r2, 2);
-    r3 == 0 ? poly.add_point((vec2_t){x + w, y + h}) : _build_rounded_rectangle_corner(&poly, x + w - r3, y + h - r3, r3, 1);
-    r4 == 0 ? poly.add_point((vec2_t){x    , y + h}) : _build_rounded_rectangle_corner(&poly, x + 0 + r4, y + h - r4, r4, 0);
-
-    result->add_path(poly);
-    return result;
+    r1 == 0 ? shape->add_point((vec2_t){x    , y    }) : _build_rounded_rectangle_corner(shape, x + 0 + r1, y + 0 + r1, r1, 3, curve_segments(r1, tolerance));
+    r2 == 0 ? shape->add_point((vec2_t){x + w, y    }) : _build_rounded_rectangle_corner(shape, x + w - r2, y + 0 + r2, r2, 2, curve_segments(r2, tolerance));
+    r3 == 0 ? shape->add_point((vec2_t){x + w, y + h}) : _build_rounded_rectangle_corner(shape, x + w - r3, y + h - r3, r3, 1, curve_segments(r3, tolerance));
+    r4 == 0 ? shape->add_point((vec2_t){x    , y + h}) : _build_rounded_rectangle_corner(shape, x + 0 + r4, y + h - r4, r4, 0, curve_segments(r4, tolerance));
   }
 
+  static void build_squircle(shape_t *shape, float *p, int segments) {
+    float x = p[0], y = p[1], size = p[2], n = p[3];
 
-    // static shape rounded_rectangle(float x1, float y1, float x2, float y2, float r1, float r2, float r3, float r4, float stroke=0.0f) {
-    // }
-
-  shape_t* squircle(float x, float y, float size, float n) {
-    shape_t *result = new(PV_MALLOC(sizeof(shape_t))) shape_t(1);
-
-    //shape *result = new shape(1);
-    constexpr int vec2s = 32;
-    path_t poly(vec2s);
-    for(int i = 0; i < vec2s; i++) {
-        float t = 2 * M_PI * (vec2s - i) / vec2s;
+    // the corners of a squircle curve tighter than a circle of the same
+    // size, the exponent states by how much
+    segments = min(256, int(segments * max(1.0f, n / 4.0f)));
+    for(int i = 0; i < segments; i++) {
+        float t = 2 * M_PI * (segments - i) / segments;
         float ct = cos(t);
         float st = sin(t);
 
-        poly.add_point(
+        shape->add_point(
           x + copysign(pow(abs(ct), 2.0 / n), ct) * size,
           y + copysign(pow(abs(st), 2.0 / n), st) * size
         );
     }
-    result->add_path(poly);
-    return result;
   }
 
-  shape_t* arc(float x, float y, float from, float to, float inner, float outer) {
-   shape_t *result = new(PV_MALLOC(sizeof(shape_t))) shape_t(1);
-
-    from = fmod(from, 360.0f) - 90.0f;
-    to = fmod(to, 360.0f) - 90.0f;
-    float delta = fabs(to - from);
-    int steps = (int)(32.0f * (delta / 360.0f));
+  static void build_arc(shape_t *shape, float *p, int segments) {
+    float x = p[0], y = p[1], inner = p[4], outer = p[5];
+    float from = fmod(p[2], 360.0f) - 90.0f;
+    float to = fmod(p[3], 360.0f) - 90.0f;
     from *= (M_PI / 180.0f);
     to *= (M_PI / 180.0f);
-
-    path_t outline(steps + 1); // TODO: is this right?
+    int steps = sweep_segments(segments, to - from);
 
     float astep = (to - from) / (float)steps;
     float a = from;
 
     for(int i = 0; i <= steps; i++) {
-      outline.add_point(cos(a) * outer + x, sin(a) * outer + y);
+      shape->add_point(cos(a) * outer + x, sin(a) * outer + y);
       a += astep;
     }
 
     a -= astep;
     for(int i = 0; i <= steps; i++) {
-      outline.add_point(cos(a) * inner + x, sin(a) * inner + y);
+      shape->add_point(cos(a) * inner + x, sin(a) * inner + y);
       a -= astep;
     }
-
-    //outline.add_point(x, y); // + 1 vec2?
-
-    result->add_path(outline);
-
-    return result;
   }
 
-  shape_t* pie(float x, float y, float from, float to, float radius) {
-    shape_t *result = new(PV_MALLOC(sizeof(shape_t))) shape_t(1);
-
-    from = fmod(from, 360.0f) - 90.0f;
-    to = fmod(to, 360.0f) - 90.0f;
-    float delta = fabs(to - from);
-    int steps = (int)(32.0f * (delta / 360.0f));
+  static void build_pie(shape_t *shape, float *p, int segments) {
+    float x = p[0], y = p[1], radius = p[4];
+    float from = fmod(p[2], 360.0f) - 90.0f;
+    float to = fmod(p[3], 360.0f) - 90.0f;
     from *= (M_PI / 180.0f);
     to *= (M_PI / 180.0f);
-
-    path_t outline(steps + 1); // TODO: is this right?
+    int steps = sweep_segments(segments, to - from);
 
     float astep = (to - from) / (float)steps;
     float a = from;
 
     for(int i = 0; i <= steps; i++) {
-      outline.add_point(cos(a) * radius + x, sin(a) * radius + y);
+      shape->add_point(cos(a) * radius + x, sin(a) * radius + y);
       a += astep;
     }
 
-    outline.add_point(x, y); // + 1 vec2?
+    shape->add_point(x, y);
+  }
 
-    result->add_path(outline);
+  // rebuild the paths of a primitive with a tolerance in shape space
+  static void build_primitive(shape_t *shape, float tolerance) {
+    primitive_t &prim = shape->_primitive;
+    if(prim.type == primitive_t::NONE) return;
+    int segments = curve_segments(prim.radius, tolerance);
+
+    reuse_path(shape, segments + 2);
+    switch(prim.type) {
+      case primitive_t::CIRCLE: build_circle(shape, prim.p, segments); break;
+      case primitive_t::ROUNDED_RECTANGLE: build_rounded_rectangle(shape, prim.p, tolerance); break;
+      case primitive_t::SQUIRCLE: build_squircle(shape, prim.p, segments); break;
+      case primitive_t::ARC: build_arc(shape, prim.p, segments); break;
+      case primitive_t::PIE: build_pie(shape, prim.p, segments); break;
+      default: break;
+    }
 
-    return result;
+    prim.segments = segments;
+    prim.tolerance = tolerance;
+    shape->invalidate();
   }
 
+  static shape_t *set_primitive(shape_t *shape, primitive_t::type_t type, float radius, std::initializer_list<float> params) {
+    primitive_t &prim = shape->_primitive;
+    prim.type = type;
+    prim.radius = fabsf(radius);
+    std::copy(params.begin(), params.end(), prim.p);
 
-  shape_t* star(float x, float y, int spikes, float outer_radius, float inner_radius) {
-    shape_t *result = new(PV_MALLOC(sizeof(shape_t))) shape_t(1);
-    path_t poly(spikes * 2);
+    // until it's drawn assume shape space is device space, after that keep
+    // the tolerance it was last drawn with so the draw needn't rebuild it
+    build_primitive(shape, prim.tolerance > 0.0f ? prim.tolerance : flatten_tolerance[0]);
+    return shape;
+  }
+
+  float curve_tolerance(mat3_t *transform, int aa) {
+    float scale = transform ? transform->max_scale() : 1.0f;
+    if(scale <= 0.0f) return 0.0f;
+    return flatten_tolerance[aa & 3] / scale;
+  }
+
+  void flatten_primitive(shape_t *shape, mat3_t *transform, int aa) {
+    primitive_t &prim = shape->_primitive;
+    if(prim.type == primitive_t::NONE) return;
+
+    float tolerance = curve_tolerance(transform, aa);
+    if(tolerance <= 0.0f) return;
+    int segments = curve_segments(prim.radius, tolerance);
+
+    // a shape being scaled smoothly keeps a slightly finer outline for a
+    // while rather than being rebuilt every frame
+    if(segments <= prim.segments && segments * 4 >= prim.segments * 3) return;
+
+    build_primitive(shape, tolerance);
+  }
+
+  shape_t* set_circle(shape_t *shape, float x, float y, float radius) {
+    return set_primitive(shape, primitive_t::CIRCLE, radius, {x, y, radius});
+  }
+
+  shape_t* circle(float x, float y, float radius) {
+    return set_circle(new_shape(), x, y, radius);
+  }
+
+  shape_t* set_rectangle(shape_t *shape, float x, float y, float w, float h) {
+    reuse_path(shape, 4);
+    shape->add_point(x, y);
+    shape->add_point(x + w, y);
+    shape->add_point(x + w, y + h);
+    shape->add_point(x, y + h);
+    return built_path(shape);
+  }
+
+  shape_t* rectangle(float x, float y, float w, float h) {
+    return set_rectangle(new_shape(), x, y, w, h);
+  }
+
+  shape_t* set_rounded_rectangle(shape_t *shape, float x, float y, float w, float h, float r1, float r2, float r3, float r4) {
+    float r = max(max(r1, r2), max(r3, r4));
+    return set_primitive(shape, primitive_t::ROUNDED_RECTANGLE, r, {x, y, w, h, r1, r2, r3, r4});
+  }
+
+  shape_t* rounded_rectangle(float x, float y, float w, float h, float r1, float r2, float r3, float r4) {
+    return set_rounded_rectangle(new_shape(), x, y, w, h, r1, r2, r3, r4);
+  }
+
+
+    // static shape rounded_rectangle(float x1, float y1, float x2, float y2, float r1, float r2, float r3, float r4, float stroke=0.0f) {
+    // }
+
+  shape_t* set_squircle(shape_t *shape, float x, float y, float size, float n) {
+    return set_primitive(shape, primitive_t::SQUIRCLE, size, {x, y, size, n});
+  }
+
+  shape_t* squircle(float x, float y, float size, float n) {
+    return set_squircle(new_shape(), x, y, size, n);
+  }
+
+  shape_t* set_arc(shape_t *shape, float x, float y, float from, float to, float inner, float outer) {
+    return set_primitive(shape, primitive_t::ARC, max(fabsf(inner), fabsf(outer)), {x, y, from, to, inner, outer});
+  }
+
+  shape_t* arc(float x, float y, float from, float to, float inner, float outer) {
+    return set_arc(new_shape(), x, y, from, to, inner, outer);
+  }
+
+  shape_t* set_pie(shape_t *shape, float x, float y, float from, float to, float radius) {
+    return set_primitive(shape, primitive_t::PIE, radius, {x, y, from, to, radius});
+  }
+
+  shape_t* pie(float x, float y, float from, float to, float radius) {
+    return set_pie(new_shape(), x, y, from, to, radius);
+  }
+
+
+  shape_t* set_star(shape_t *shape, float x, float y, int spikes, float outer_radius, float inner_radius) {
+    reuse_path(shape, spikes * 2);
     for(int i = 0; i < spikes * 2; i++) {
       float step = ((M_PI * 2) / (float)(spikes * 2)) * (float)i;
       float r = i % 2 == 0 ? outer_radius : inner_radius;
-      poly.add_point(sin(step) * r + x, cos(step) * r + y);
+      shape->add_point(sin(step) * r + x, cos(step) * r + y);
     }
-    result->add_path(poly);
-    return result;
+    return built_path(shape);
   }
 
-  shape_t* line(float x1, float y1, float x2, float y2, float w) {
-    shape_t *result = new(PV_MALLOC(sizeof(shape_t))) shape_t(1);
-    path_t poly(4);
+  shape_t* star(float x, float y, int spikes, float outer_radius, float inner_radius) {
+    return set_star(new_shape(), x, y, spikes, outer_radius, inner_radius);
+  }
+
+  shape_t* set_line(shape_t *shape, float x1, float y1, float x2, float y2, float w) {
+    reuse_path(shape, 4);
 
     float dx = x2 - x1;
     float dy = y2 - y1;
@@ -164,12 +282,14 @@ namespace picovector {
     dy /= m;
     float hw = w / 2.0f;
 
-    poly.add_point(x1 + (dy * hw), y1 - (dx * hw));
-    poly.add_point(x2 + (dy * hw), y2 - (dx * hw));
-    poly.add_point(x2 - (dy * hw), y2 + (dx * hw));
-    poly.add_point(x1 - (dy * hw), y1 + (dx * hw));
-    result->add_path(poly);
+    shape->add_point(x1 + (dy * hw), y1 - (dx * hw));
+    shape->add_point(x2 + (dy * hw), y2 - (dx * hw));
+    shape->add_point(x2 - (dy * hw), y2 + (dx * hw));
+    shape->add_point(x1 - (dy * hw), y1 + (dx * hw));
+    return built_path(shape);
+  }
 
-    return result;
+  shape_t* line(float x1, float y1, float x2, float y2, float w) {
+    return set_line(new_shape(), x1, y1, x2, y2, w);
   }
 }
\ No newline at end of file
@@ -14,4 +14,25 @@ namespace picovector {
   shape_t* star(float x, float y, int spikes, float outer_radius, float inner_radius);
   shape_t* line(float x1, float y1, float x2, float y2, float w);
 
+  // rebuild an existing shape as one of the above in place, its storage is
+  // reused so a shape moved or resized every frame doesn't allocate once it
+  // has grown to fit. returns the shape
+  shape_t* set_regular_polygon(shape_t *shape, float x, float y, float sides, float radius);
+  shape_t* set_circle(shape_t *shape, float x, float y, float radius);
+  shape_t* set_rectangle(shape_t *shape, float x, float y, float w, float h);
+  shape_t* set_rounded_rectangle(shape_t *shape, float x, float y, float w, float h, float r1, float r2, float r3, float r4);
+  shape_t* set_squircle(shape_t *shape, float x, float y, float size, float n=4.0f);
+  shape_t* set_arc(shape_t *shape, float x, float y, float from, float to, float inner, float outer);
+  shape_t* set_pie(shape_t *shape, float x, float y, float from, float to, float radius);
+  shape_t* set_star(shape_t *shape, float x, float y, int spikes, float outer_radius, float inner_radius);
+  shape_t* set_line(shape_t *shape, float x1, float y1, float x2, float y2, float w);
+
+  // re-flatten a primitive's curves for the transform and antialias level it's
+  // about to be drawn with, does nothing for other shapes
+  void flatten_primitive(shape_t *shape, mat3_t *transform, int aa);
+
+  // the flattening tolerance in shape space for curves drawn with transform
+  // at antialias level aa, zero if the transform collapses the shape
+  float curve_tolerance(mat3_t *transform, int aa);
+
 };
@@ -0,0 +1,45 @@
+#include <string.h>
+
+#include "profile.hpp"
+
+#ifdef PICO
+#include "hardware/clocks.h"
+#endif
+
+namespace picovector {
+
+  profile_stat_t profile_stats[2][PROFILE_POINTS] = {};
+
+  void profile_init() {
+#if defined(PICO) && PICO_RP2350
+    // the cycle counter only runs with tracing enabled
+    m33_hw->demcr |= M33_DEMCR_TRCENA_BITS;
+    m33_hw->dwt_ctrl |= M33_DWT_CTRL_CYCCNTENA_BITS;
+#endif
+  }
+
+  uint32_t profile_ticks_per_us() {
+#ifdef PICO
+#if PICO_RP2350
+    return clock_get_hz(clk_sys) / 1000000;
+#else
+    return 1;
+#endif
+#else
+    return 1000;
+#endif
+  }
+
+  void profile_read(profile_stat_t *stats) {
+    for(int i = 0; i < PROFILE_POINTS; i++) {
+      stats[i].calls = profile_stats[0][i].calls + profile_stats[1][i].calls;
+      stats[i].pixels = profile_stats[0][i].pixels + profile_stats[1][i].pixels;
+      stats[i].ticks = profile_stats[0][i].ticks + profile_stats[1][i].ticks;
+    }
+  }
+
+  void profile_reset() {
+    memset(profile_stats, 0, sizeof(profile_stats));
+  }
+
+}
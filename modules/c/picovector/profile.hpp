@@ -0,0 +1,95 @@
+#pragma once
+
+#include <stdint.h>
+
+#ifdef PICO
+#include "pico/stdlib.h"
+#if PICO_RP2350
+#include "hardware/structs/m33.h"
+#endif
+#else
+#include <chrono>
+#endif
+
+// present() runs from ram on core1, nothing it calls may end up in flash
+#define PROFILE_INLINE inline __attribute__((always_inline))
+
+namespace picovector {
+
+  // timers around the expensive entry points, each counts the calls made to
+  // it, the pixels they covered and the time they took. times are inclusive
+  // so a blit made by a filter counts towards both. counters are kept per
+  // core and added together when read, present() runs on core1 for async
+  // updates and background image loads decode there
+  enum profile_point_t {
+    PROFILE_RENDER,   // shapes, render()
+    PROFILE_GLYPH,    // vector font glyphs, render_glyph()
+    PROFILE_BLIT,     // image blits
+    PROFILE_FILTER,   // blur, dither, shadows and the other filters
+    PROFILE_PNG,      // png decodes
+    PROFILE_CLEAR,    // image clears
+    PROFILE_PRESENT,  // frames sent to the display
+    PROFILE_POINTS
+  };
+
+  struct profile_stat_t {
+    uint32_t calls;
+    uint32_t pixels;
+    uint32_t ticks;   // see profile_ticks_per_us()
+  };
+
+  extern profile_stat_t profile_stats[2][PROFILE_POINTS];
+
+  // a free running counter, the cpu cycle counter where there is one
+  static PROFILE_INLINE uint32_t profile_ticks() {
+#ifdef PICO
+#if PICO_RP2350
+    return m33_hw->dwt_cyccnt;
+#else
+    return time_us_32();
+#endif
+#else
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+#endif
+  }
+
+  static PROFILE_INLINE int profile_core() {
+#ifdef PICO
+    return get_core_num();
+#else
+    return 0;
+#endif
+  }
+
+  // starts the cycle counter, call once before reading the counters
+  void profile_init();
+  uint32_t profile_ticks_per_us();
+
+  // totals for both cores
+  void profile_read(profile_stat_t *stats);
+  void profile_reset();
+
+  // counts one call for the lifetime of the scope
+  class profile_scope_t {
+  public:
+    PROFILE_INLINE profile_scope_t(profile_point_t point, uint32_t pixels = 0) : _stat(&profile_stats[profile_core()][point]), _start(profile_ticks()) {
+      _stat->calls++;
+      _stat->pixels += pixels;
+    }
+
+    PROFILE_INLINE ~profile_scope_t() {
+      _stat->ticks += profile_ticks() - _start;
+    }
+
+    profile_scope_t(const profile_scope_t &) = delete;
+    profile_scope_t &operator=(const profile_scope_t &) = delete;
+
+    // for calls that only know how much they covered once they've started
+    PROFILE_INLINE void pixels(uint32_t pixels) {_stat->pixels += pixels;}
+
+  private:
+    profile_stat_t *_stat;
+    uint32_t _start;
+  };
+
+}
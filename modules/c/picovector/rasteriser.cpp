@@ -1,17 +1,34 @@
 #include <algorithm>
+#include <limits.h>
+#include <math.h>
+#include <string.h>
 
 #include "types.hpp"
 #include "rasteriser.hpp"
+#include "working_buffer.hpp"
+
+// fixed point alternative to render() in picovector.cpp - vertices are
+// transformed and converted to 16:16 once when the path is added, after
+// that the edge walking, node sorting, and coverage accumulation never touch
+// a float
+//
+// claims its buffers from PicoVector_working_buffer in pvr_reset() and
+// hands them back once pvr_render() is done with them
 
 namespace picovector {
-  struct edge_t {
-    fx16_vec2_t *p1;
-    fx16_vec2_t *p2;
-  };
 
-  struct node_t {
-    int x;
-    int y;
+  extern uint8_t alpha_map_none[2];
+  extern uint8_t alpha_map_x4[5];
+  extern uint8_t alpha_map_x16[17];
+
+  // an edge between two path points, always pointing "down". row0 and row1
+  // are the first and one past the last sample row whose centre it crosses,
+  // x is the edge's x position at the centre of row0
+  struct edge_t {
+    int32_t row0;
+    int32_t row1;
+    fx16_t x;
+    fx16_t step;
   };
 
   struct bounds_t {
@@ -21,181 +38,280 @@ namespace picovector {
     int y2;
   };
 
-  // tile buffer
+  // tile buffer, tiles always cover 64 sample rows so the node buffer
+  // requirement doesn't grow with the antialias level
   constexpr int max_tile_width = 64;
   constexpr int max_tile_height = 64;
   constexpr size_t tile_buffer_offset = 0;
   constexpr size_t tile_buffer_size = max_tile_width * max_tile_height;
-  uint8_t *tile = (uint8_t*)(PicoVector_working_buffer + tile_buffer_offset);
+  uint8_t *tile = nullptr;
 
-  // scanline node buffer
-  constexpr int max_nodes = 8192;
-  constexpr size_t node_buffer_offset = tile_buffer_offset + tile_buffer_size;
-  constexpr size_t node_buffer_size = sizeof(node_t) * max_nodes;
-  node_t *nodes = (node_t*)(PicoVector_working_buffer + node_buffer_offset);
-
-  // path vec2s buffer size
-  constexpr int max_vec2s = 1024;
-  constexpr size_t vec2_buffer_offset = node_buffer_offset + node_buffer_size;
-  constexpr size_t vec2_buffer_size = sizeof(fx16_vec2_t) * max_vec2s;
-  fx16_vec2_t *vec2s = (fx16_vec2_t*)(PicoVector_working_buffer + vec2_buffer_offset);
-
-  // edge buffer size
+  // edge buffer
   constexpr int max_edges = 1024;
-  constexpr size_t edge_buffer_offset = vec2_buffer_offset + vec2_buffer_size;
+  constexpr size_t edge_buffer_offset = tile_buffer_offset + tile_buffer_size;
   constexpr size_t edge_buffer_size = sizeof(edge_t) * max_edges;
-  edge_t *edges = (edge_t*)(PicoVector_working_buffer + edge_buffer_offset);
+  edge_t *edges = nullptr;
+
+  // scanline node buffer, each node is packed as (row << 16) | x so a plain
+  // integer sort orders them by row and then by column
+  constexpr int max_nodes = 8192;
+  constexpr size_t node_buffer_offset = edge_buffer_offset + edge_buffer_size;
+  constexpr size_t node_buffer_size = sizeof(uint32_t) * max_nodes;
+  uint32_t *nodes = nullptr;
+
+  constexpr size_t pvr_buffer_size = node_buffer_offset + node_buffer_size;
+  static_assert(pvr_buffer_size <= working_buffer_size, "pvr buffers exceed working buffer");
+  int claim = -1;
 
   // buffer counters
   int node_count = 0;
-  int vec2_count = 0;
   int edge_count = 0;
   fx16_t minx = INT_MAX;
   fx16_t miny = INT_MAX;
   fx16_t maxx = INT_MIN;
   fx16_t maxy = INT_MIN;
 
-  int aa_scale = 1;
+  int aa_shift = 0;
+
+  // set when an edge didn't fit, the shape can't be drawn correctly here
+  bool edge_overflow = false;
+
+  void pvr_reset(int aa) {
+    if(claim < 0) {
+      claim = working_buffer_claim("pvr", pvr_buffer_size);
+    }
+    if(claim >= 0) {
+      char *buffer = working_buffer_data(claim);
+      tile = (uint8_t *)(buffer + tile_buffer_offset);
+      edges = (edge_t *)(buffer + edge_buffer_offset);
+      nodes = (uint32_t *)(buffer + node_buffer_offset);
+    }
 
-  void pvr_reset() {
     node_count = 0;
-    vec2_count = 0;
     edge_count = 0;
     minx = INT_MAX;
     miny = INT_MAX;
     maxx = INT_MIN;
     maxy = INT_MIN;
+    aa_shift = aa;
+    edge_overflow = false;
   }
 
-  // add a new path to the rasteriser with optional transformation matrix
-  void pvr_add_path(vec2_t *p, int count, mat3_t *transform) {
-    // transform path vec2s, convert to fixed vec2, scale for antialiasing
-    // and add to vec2s buffer
-    for(int i = 0; i < count; i++) {
-      vec2_t t = p->transform(*transform);
-      fx16_vec2_t *fxt = &vec2s[vec2_count + i];
-      fxt->x = f_to_fx16(t.x * aa_scale);
-      fxt->y = f_to_fx16(t.y * aa_scale);
+  static void pvr_add_edge(const fx16_vec2_t &p1, const fx16_vec2_t &p2) {
+    const fx16_vec2_t *s = &p1;
+    const fx16_vec2_t *e = &p2;
+    if(e->y < s->y) std::swap(s, e);
 
-      // update overall polygon bounds
-      minx = std::min(minx, fxt->x);
-      maxx = std::max(maxx, fxt->x);
-      miny = std::min(miny, fxt->y);
-      maxy = std::max(maxy, fxt->y);
+    // sample rows whose centre lies in [s->y, e->y), horizontal edges and
+    // those too short to cross a centre produce no nodes
+    int32_t row0 = (s->y - 0x8000 + 0xffff) >> 16;
+    int32_t row1 = (e->y - 0x8000 + 0xffff) >> 16;
+    if(row0 >= row1) return;
 
-      p++;
+    if(edge_count >= max_edges || claim < 0) {
+      edge_overflow = true;
+      return;
     }
 
-    // build edges, swap vec2 indices so that edges always vec2 "down" and
-    // discard any horizontal edges
-    fx16_vec2_t *last = &vec2s[count - 1];
-    for(int i = 0; i < count; i++) {
-      fx16_vec2_t *next = &vec2s[vec2_count + i];
+    int64_t step = (int64_t(e->x - s->x) << 16) / (e->y - s->y);
+    fx16_t cy = (row0 << 16) + 0x8000;
+
+    edge_t &edge = edges[edge_count++];
+    edge.row0 = row0;
+    edge.row1 = row1;
+    edge.x = s->x + fx16_t((int64_t(cy - s->y) * step) >> 16);
+    edge.step = fx16_t(step);
+  }
 
-      if(last->y == next->y) continue; // skip horizontal edges
+  // converts a point to fixed point sample space. far off points are
+  // pulled in so that neither the conversion nor the differences between
+  // points in pvr_add_edge() can overflow, the visible part of the shape
+  // barely moves
+  static fx16_vec2_t pvr_point(vec2_t p) {
+    const float limit = 16000.0f;
+    float scale = float(1 << aa_shift);
+    return fx16_vec2_t(
+      std::max(-limit, std::min(p.x * scale, limit)),
+      std::max(-limit, std::min(p.y * scale, limit)));
+  }
 
-      edge_t *edge = &edges[edge_count];
-      if(last->y < next->y) {
-        edge->p1 = last;
-        edge->p2 = next;
-      }else{
-        edge->p1 = next;
-        edge->p2 = last;
-      }
+  // add a new path to the rasteriser with optional transformation matrix
+  void pvr_add_path(vec2_t *p, int count, mat3_t *transform) {
+    if(count < 2) return;
+
+    // start with the last point to close the loop
+    vec2_t t = p[count - 1];
+    if(transform) t = t.transform(transform);
+    fx16_vec2_t last = pvr_point(t);
 
-      edge_count++;
+    for(int i = 0; i < count; i++) {
+      // transform path points, convert to fixed point, and scale for
+      // antialiasing
+      t = p[i];
+      if(transform) t = t.transform(transform);
+      fx16_vec2_t next = pvr_point(t);
+
+      // update overall polygon bounds
+      minx = std::min(minx, next.x);
+      maxx = std::max(maxx, next.x);
+      miny = std::min(miny, next.y);
+      maxy = std::max(maxy, next.y);
+
+      pvr_add_edge(last, next);
       last = next;
     }
+  }
 
-    vec2_count += count;
+  // add a single edge already in device space, used by the stroker which
+  // emits its outline an edge at a time
+  void pvr_add_line(vec2_t a, vec2_t b) {
+    fx16_vec2_t s = pvr_point(a);
+    fx16_vec2_t e = pvr_point(b);
+
+    minx = std::min(minx, s.x);
+    maxx = std::max(maxx, s.x);
+    miny = std::min(miny, s.y);
+    maxy = std::max(maxy, s.y);
+
+    pvr_add_edge(s, e);
   }
 
-  void pvr_build_nodes(const bounds_t &tb) {
+  // builds the nodes for sample rows y1 to y2 of the tile stb (in sample
+  // space), rows are numbered from the top of the tile. returns false if
+  // they don't all fit, a single row that overflows drops the edges that
+  // don't fit rather than leave the row half built
+  static bool pvr_build_nodes(const bounds_t &stb, int y1, int y2) {
     node_count = 0;
 
-    // printf("- edge count %d\n", edge_count);
-    // printf("working buffer size = %d\n", int(sizeof(PicoVector_working_buffer)));
-    // printf("buffer size total = %d\n", int(vec2_buffer_offset + vec2_buffer_size));
+    int tw = stb.x2 - stb.x1;
+    fx16_t tx = (stb.x1 << 16) - 0x8000; // nodes round to the nearest sample
+    bool splittable = y2 - y1 > 1;
 
     for(int i = 0; i < edge_count; i++) {
-      // printf(" - edge %d\n", i);
-      // printf(" - %p -> %p\n", edges[i].p1, edges[i].p2);
-      // printf(" - %d, %d -> %d, %d\n", edges[i].p1->x >> 16, edges[i].p1->y >> 16, edges[i].p2->x >> 16, edges[i].p2->y >> 16);
+      const edge_t &e = edges[i];
 
-      fx16_vec2_t *p1 = edges[i].p1;
-      fx16_vec2_t *p2 = edges[i].p2;
+      // if edge not within vertical bounds of the rows skip
+      int r0 = std::max(e.row0, int32_t(y1));
+      int r1 = std::min(e.row1, int32_t(y2));
+      if(r0 >= r1) continue;
 
-      // tile offset in fp16
-      fx16_t tx = (tb.x1 << 16);
-      fx16_t ty = (tb.y1 << 16);
+      if(node_count + (r1 - r0) > max_nodes) {
+        if(splittable) return false;
+        continue;
+      }
 
-      // adjust edge vec2s relative to tile offset
-      fx16_t sx = p1->x - tx;
-      fx16_t sy = p1->y - ty;
-      fx16_t ex = p2->x - tx;
-      fx16_t ey = p2->y - ty;
-      fx16_t x = sx;
+      fx16_t x = e.x + fx16_t(int64_t(r0 - e.row0) * e.step) - tx;
+      uint32_t row = uint32_t(r0 - stb.y1) << 16;
+      for(int y = r0; y < r1; y++) {
+        int nx = std::max(std::min(int(x >> 16), tw), 0);
+        nodes[node_count++] = row | nx;
+        row += 1 << 16;
+        x += e.step;
+      }
+    }
 
-      // tile height in fp16
-      fx16_t th = (tb.y2 - tb.y1) << 16;
+    // sort the nodes by row and by column
+    std::sort(nodes, nodes + node_count);
+    return true;
+  }
 
-      // if edge not within vertical bounds of tile skip
-      if(sy >= th || ey <= 0) continue;
+  // bounds of the tile buffer that received any coverage
+  struct tile_coverage_t {
+    int cx1, cy1, cx2, cy2;
+  };
 
-      // calculate x step per scanline
-      fx16_t stepx = (ex - sx) / (ey - sy);
+  // draws (or accumulates into the tile buffer when antialiasing) sample
+  // rows y1 to y2 of the tile, halving the rows until their nodes fit in
+  // the node buffer
+  static void pvr_tile_rows(image_t *target, brush_t *brush, const bounds_t &tb, const bounds_t &stb, int y1, int y2, tile_coverage_t &c) {
+    if(!pvr_build_nodes(stb, y1, y2)) {
+      int mid = (y1 + y2) / 2;
+      pvr_tile_rows(target, brush, tb, stb, y1, mid, c);
+      pvr_tile_rows(target, brush, tb, stb, mid, y2, c);
+      return;
+    }
 
-      // if edge starts above tile then jump to intersection with top edge
-      if(sy < 0) {
-        x += stepx * abs(sy);
-        sy = 0;
+    if(!aa_shift) {
+      // without antialiasing every node pair is a span, no need for the
+      // tile buffer
+      span_func_t span = target->_span_func;
+      int i = 0;
+      while(i + 1 < node_count) {
+        uint32_t row = nodes[i] >> 16;
+        if((nodes[i + 1] >> 16) != row) {i++; continue;}
+
+        int nsx = nodes[i] & 0xffff;
+        int nex = nodes[i + 1] & 0xffff;
+        if(nex > nsx) {
+          span(target, brush, tb.x1 + nsx, tb.y1 + row, nex - nsx);
+        }
+        i += 2;
       }
+      return;
+    }
 
-      // if edge ends after tile then clamp to at most tile height
-      if(ey > th) {
-        ey = th;
+    int samples = 1 << aa_shift;
+    int sample_mask = samples - 1;
+
+    int i = 0;
+    while(i + 1 < node_count) {
+      uint32_t row = nodes[i] >> 16;
+      if((nodes[i + 1] >> 16) != row) {i++; continue;}
+
+      int nsx = nodes[i] & 0xffff;
+      int nex = nodes[i + 1] & 0xffff;
+      i += 2;
+      if(nex <= nsx) continue;
+
+      int py = row >> aa_shift;
+      int px0 = nsx >> aa_shift;
+      int px1 = nex >> aa_shift;
+      uint8_t *p = &tile[py * max_tile_width];
+
+      c.cx1 = std::min(c.cx1, px0);
+      c.cy1 = std::min(c.cy1, py);
+      c.cx2 = std::max(c.cx2, (nex + sample_mask) >> aa_shift);
+      c.cy2 = std::max(c.cy2, py);
+
+      // partial pixels at either end, whole pixels in between
+      if(px0 == px1) {
+        p[px0] += nex - nsx;
+        continue;
       }
 
-      sy >>= 16;
-      ey >>= 16;
-
-      //printf(" - interpolate edge %d -> %d\n", sy, ey);
-      for(int y = sy; y < ey; y++) {
-        nodes[node_count].x = x >> 16;
-        nodes[node_count].y = y >> 16;
-        node_count++;
-        x += stepx;
+      p[px0] += samples - (nsx & sample_mask);
+      for(int px = px0 + 1; px < px1; px++) {
+        p[px] += samples;
       }
-      //printf(" - node_count %d\n", node_count);
-    }
-
-    //printf("- sort nodes\n");
-    // sort the nodes by row and by column
-    std::sort(nodes, nodes + node_count,
-      [](const node_t& a, const node_t& b) {
-        if(a.y == b.y) return a.x < b.x;
-        return a.y < b.y;
+      if(nex & sample_mask) {
+        p[px1] += nex & sample_mask;
       }
-    );
+    }
   }
 
-  void pvr_render(image_t *target, rect_t clip, brush_t *brush) {
-    // floored and ceiled bounds of the shape
+  static void pvr_render_tiles(image_t *target, rect_t clip, brush_t *brush) {
+    if(!edge_count) return;
+
+    // floored and ceiled bounds of the shape in pixels
     bounds_t sb;
-    sb.x1 = minx >> 16;
-    sb.y1 = miny >> 16;
-    sb.x2 = (maxx >> 16) + 1;
-    sb.y2 = (maxy >> 16) + 1;
+    sb.x1 = (minx >> 16) >> aa_shift;
+    sb.y1 = (miny >> 16) >> aa_shift;
+    sb.x2 = ((maxx >> 16) >> aa_shift) + 1;
+    sb.y2 = ((maxy >> 16) >> aa_shift) + 1;
 
     // clip render bounds to clip rectangle
     sb.x1 = std::max(int(floor(clip.x)), sb.x1);
     sb.y1 = std::max(int(floor(clip.y)), sb.y1);
     sb.x2 = std::min(int(ceil(clip.x + clip.w)), sb.x2);
-    sb.y2 = std::min(int(ceil(clip.h + clip.h)), sb.y2);
+    sb.y2 = std::min(int(ceil(clip.y + clip.h)), sb.y2);
 
-    // get tile width for aa level
+    // get tile size for aa level
     int tw = max_tile_width;
-    int th = max_tile_height;
+    int th = max_tile_height >> aa_shift;
+
+    uint8_t *alpha_map = alpha_map_none;
+    if(aa_shift == 1) alpha_map = alpha_map_x4;
+    if(aa_shift == 2) alpha_map = alpha_map_x16;
 
     for(int y = sb.y1; y < sb.y2; y += th) {
       for(int x = sb.x1; x < sb.x2; x += tw) {
@@ -206,116 +322,51 @@ namespace picovector {
         tb.x2 = std::min(tb.x1 + tw, sb.x2);
         tb.y2 = std::min(tb.y1 + th, sb.y2);
 
-        //printf("render tile %d, %d\n", x, y);
-
-        // build the nodes for this tile
-        pvr_build_nodes(tb);
-
-        for(int i = 0; i < node_count; i += 2) {
-          int nsx = nodes[node_count].x;
-          int nex = nodes[node_count + 1].x;
-
-          if(nsx == nex) continue;
-
-          int ny = nodes[node_count].y;
-          int to = nsx + (ny * tw);
-          uint8_t *p = tile + to;
+        // build the nodes for this tile in sample space
+        bounds_t stb;
+        stb.x1 = tb.x1 << aa_shift;
+        stb.y1 = tb.y1 << aa_shift;
+        stb.x2 = tb.x2 << aa_shift;
+        stb.y2 = tb.y2 << aa_shift;
+
+        tile_coverage_t c = {tb.x2 - tb.x1, tb.y2 - tb.y1, 0, -1};
+        if(aa_shift) {
+          for(int row = 0; row < tb.y2 - tb.y1; row++) {
+            memset(&tile[row * max_tile_width], 0, tb.x2 - tb.x1);
+          }
+        }
 
-          brush->span_func(brush, nsx, ny, nex - nsx);
-//          brush->render_span(target, nsx, ny, nex - nsx);
+        pvr_tile_rows(target, brush, tb, stb, stb.y1, stb.y2, c);
+        if(!aa_shift) continue;
 
+        int cx1 = c.cx1, cy1 = c.cy1, cx2 = c.cx2, cy2 = c.cy2;
+        for(int py = cy1; py <= cy2; py++) {
+          // scale tile buffer values to alpha values
+          uint8_t *p = &tile[py * max_tile_width + cx1];
+          for(int c = cx2 - cx1; c > 0; c--) {
+            *p = alpha_map[*p];
+            p++;
+          }
 
+          render_mask_row(target, brush, tb.x1 + cx1, tb.y1 + py, cx2 - cx1, &tile[py * max_tile_width + cx1]);
         }
-
       }
     }
 
-    miny = INT_MAX;
-    maxx = INT_MIN;
-    maxy = INT_MIN;
+    pvr_reset(aa_shift);
   }
-}
-
-/*
-
-};
-
-fx16_t minx, miny, maxx, maxy; // bounds for polygon rendering
 
-int max_tile_height = 32; // maximum number of scanlines per tile
-int max_ei = 256; // buffer for up to 256 edge interpolators
-int max_nodes = 64; // maximum nodes per scanline
-
-size_t ei_buffer_size = sizeof(ei) * max_ei;
-int ei_count = 0; // number of active edge interpolators
-ei *eis = (ei*)(PicoVector_working_buffer); // edge interpolator buffer
-
-int node_count = 0;
-fx16_t *nodes = (fx16_t*)(PicoVector_working_buffer + ei_buffer_size);
-
-
-
-namespace picovector {
-
-  void pr_reset() {
-    // reset overall bounds
-    minx = INT_MAX;
-    miny = INT_MAX;
-    maxx = INT_MIN;
-    maxy = INT_MIN;
-
-    // reset interpolator count
-    ei_count = 0;
-    node_count = 0;
-  }
-
-  // create an edge interpolator
-  void pr_add_edge(vec2_t p1, vec2_t p2) {
-    if(ei_count < max_ei) {
-      eis[ei_count] = ei(p1, p2);
-      ei_count++;
+  bool pvr_render(image_t *target, rect_t clip, brush_t *brush) {
+    // a shape missing edges would fill wrongly, leave it to the caller
+    bool drawn = !edge_overflow && claim >= 0;
+    if(drawn) {
+      pvr_render_tiles(target, clip, brush);
     }
+    if(claim >= 0) {
+      working_buffer_release(claim);
+      claim = -1;
+    }
+    return drawn;
   }
 
-  void pr_render() {
-
-  }
-
-  // void render(shape_t *shape, mat3_t *transform, image_t *target, brush_t *brush) {
-  //   if(!shape->paths.size()) {return;};
-
-  //   // will contain transformed shape bounds
-  //   float minx = FLT_MAX, miny = FLT_MAX, maxx = FLT_MIN, maxy = FLT_MIN;
-
-  //   // setup edge interpolators
-  //   int edge_interpolator_count = 0;
-  //   for(auto &path : shape->paths) {
-  //     auto last = path.vec2s.back(); // start with last vec2 to close loop
-  //     last = last.transform(transform);
-
-  //     for(auto next : path.vec2s) {
-  //       next = next.transform(transform);
-
-  //       // update transformed bounds
-  //       minx = min(minx, next.x);
-  //       miny = min(miny, next.y);
-  //       maxx = max(maxx, next.x);
-  //       maxy = max(maxy, next.y);
-
-  //       // add new edge interpolator
-  //       edge_interpolators[edge_interpolator_count] = _edgeinterp(last, next);
-  //       edge_interpolator_count++;
-  //       last = next;
-  //     }
-  //   }
-
-  //   rect_t b = shape->bounds();
-  //   b.
-  //   .transform(transform);
-
-  //   int tile_buffer_size = 8096;
-  //   //
-  //   64*64
-  //   uint8_t *tile_buffer = (uint8_t*)&PicoVector_working_buffer[0];
-  // }
-}*/
\ No newline at end of file
+}
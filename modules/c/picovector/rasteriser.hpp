@@ -1,3 +1,5 @@
+#pragma once
+
 #include "picovector.hpp"
 #include "types.hpp"
 #include "shape.hpp"
@@ -6,7 +8,10 @@
 #include "brush.hpp"
 
 namespace picovector {
-  void pvr_reset();
+  void pvr_reset(int aa = 0);
   void pvr_add_path(vec2_t *p, int count, mat3_t *transform);
-  void pvr_render(image_t *target, rect_t bounds, brush_t *brush);
+  void pvr_add_line(vec2_t a, vec2_t b);
+  // returns false, having drawn nothing, if the shape had more edges than
+  // the rasteriser holds
+  bool pvr_render(image_t *target, rect_t bounds, brush_t *brush);
 }
\ No newline at end of file
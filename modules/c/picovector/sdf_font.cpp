@@ -0,0 +1,163 @@
+#include <algorithm>
+#include <math.h>
+
+#include "sdf_font.hpp"
+#include "image.hpp"
+#include "picovector.hpp"
+#include "text.hpp"
+
+using std::min;
+using std::max;
+
+namespace picovector {
+
+  // samples carry two bits below the stored byte once interpolated
+  #define SDF_COVERAGE_LUT_SIZE 1024
+  // columns passed to render_mask_row at a time
+  #define SDF_MASK_CHUNK 256
+
+  int sdf_font_t::glyph_index(int codepoint) {
+    int low = 0;
+    int high = this->glyph_count;
+    while(low < high) {
+      int mid = low + (high - low) / 2;
+      int compare = this->glyphs[mid].codepoint;
+      if(compare == codepoint) {
+        return mid;
+      }
+
+      if(compare < codepoint) {
+        low = mid + 1;
+      } else {
+        high = mid;
+      }
+    }
+
+    return -1;  // not found
+  }
+
+  // maps interpolated samples straight to coverage, built once per string
+  // so the per pixel work is the bilinear lookup. d is in target pixels,
+  // positive inside the glyph
+  static void build_coverage(uint8_t *lut, float spread_px, sdf_font_t::effect_t effect, float width) {
+    for(int n = 0; n < SDF_COVERAGE_LUT_SIZE; n++) {
+      float d = (n / 4.0f - 128.0f) / 127.0f * spread_px;
+      float c;
+      switch(effect) {
+        case sdf_font_t::OUTLINE: {
+          c = width / 2.0f - fabsf(d) + 0.5f;
+        } break;
+
+        case sdf_font_t::GLOW: {
+          float t = d >= 0.0f ? 1.0f : max(0.0f, 1.0f + d / width);
+          c = t * t;
+        } break;
+
+        default: {
+          c = d + 0.5f;
+        } break;
+      }
+      lut[n] = uint8_t(min(1.0f, max(0.0f, c)) * 255.0f + 0.5f);
+    }
+  }
+
+  // texels outside the bitmap are as far from the edge as the field records
+  static inline int texel(const uint8_t *row, int w, int x) {
+    return row && x >= 0 && x < w ? row[x] : 0;
+  }
+
+  static void draw_sdf_glyph(image_t *target, brush_t *brush, rect_t clip, const uint8_t *bits, sdf_glyph_t *g, float gx, float gy, float s, const uint8_t *lut) {
+    // pixels the scaled bitmap touches
+    int x1 = max(int(floorf(gx)), int(clip.x));
+    int y1 = max(int(floorf(gy)), int(clip.y));
+    int x2 = min(int(ceilf(gx + g->w * s)), int(clip.x + clip.w));
+    int y2 = min(int(ceilf(gy + g->h * s)), int(clip.y + clip.h));
+    if(x1 >= x2 || y1 >= y2) return;
+
+    // texel coordinates of pixel centres, 16.16 fixed point
+    int32_t step = int32_t(65536.0f / s);
+    int32_t u1 = int32_t(((x1 + 0.5f - gx) / s - 0.5f) * 65536.0f);
+    int32_t v = int32_t(((y1 + 0.5f - gy) / s - 0.5f) * 65536.0f);
+
+    uint8_t mask[SDF_MASK_CHUNK];
+    for(int y = y1; y < y2; y++, v += step) {
+      int iy = v >> 16;
+      int fy = (v >> 8) & 0xff;
+      const uint8_t *r0 = iy >= 0 && iy < g->h ? bits + iy * g->w : nullptr;
+      const uint8_t *r1 = iy + 1 >= 0 && iy + 1 < g->h ? bits + (iy + 1) * g->w : nullptr;
+
+      int32_t u = u1;
+      for(int x = x1; x < x2; x += SDF_MASK_CHUNK) {
+        int n = min(SDF_MASK_CHUNK, x2 - x);
+        for(int i = 0; i < n; i++, u += step) {
+          int ix = u >> 16;
+          int fx = (u >> 8) & 0xff;
+          int top = texel(r0, g->w, ix) * (256 - fx) + texel(r0, g->w, ix + 1) * fx;
+          int bottom = texel(r1, g->w, ix) * (256 - fx) + texel(r1, g->w, ix + 1) * fx;
+          mask[i] = lut[(top * (256 - fy) + bottom * fy) >> 14];
+        }
+        render_mask_row(target, brush, x, y, n, mask);
+      }
+    }
+  }
+
+  void sdf_font_t::draw(image_t *target, const char *text, float x, float y, float size, effect_t effect, float width) {
+    target->modified();
+
+    rect_t clip = target->clip().intersection(target->bounds());
+    if(clip.empty()) return;
+
+    // field pixels to target pixels, effects can't reach past the spread
+    float s = size / this->field_per_em;
+    float spread_px = this->spread * s;
+    width = min(max(width, 0.0f), spread_px);
+
+    uint8_t lut[SDF_COVERAGE_LUT_SIZE];
+    build_coverage(lut, spread_px, effect, width > 0.0f ? width : 1.0f);
+
+    brush_t *brush = target->brush();
+    float advance_scale = size / this->units_per_em;
+    float caret = x;
+    auto glyph = [&](int codepoint) {
+      int j = this->glyph_index(codepoint);
+      if(j < 0) return;
+      sdf_glyph_t *g = &this->glyphs[j];
+      if(g->w && g->h) {
+        draw_sdf_glyph(target, brush, clip, this->data + g->offset, g, caret + g->left * s, y + size + g->top * s, s, lut);
+      }
+      caret += g->advance * advance_scale;
+    };
+
+    // runs of ascii skip the decoder
+    while(*text != '\0') {
+      for(const char *end = text + ascii_run(text); text < end; text++) {
+        glyph(*text);
+      }
+      if(*text != '\0') {
+        glyph(utf8_next(text));
+      }
+    }
+  }
+
+  rect_t sdf_font_t::measure(const char *text, float size) {
+    uint32_t units = 0;
+    auto glyph = [&](int codepoint) {
+      int j = this->glyph_index(codepoint);
+      if(j >= 0) {
+        units += this->glyphs[j].advance;
+      }
+    };
+
+    while(*text != '\0') {
+      for(const char *end = text + ascii_run(text); text < end; text++) {
+        glyph(*text);
+      }
+      if(*text != '\0') {
+        glyph(utf8_next(text));
+      }
+    }
+
+    return rect_t(0, 0, units * size / this->units_per_em, size);
+  }
+
+}
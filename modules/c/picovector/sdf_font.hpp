@@ -0,0 +1,48 @@
+#pragma once
+
+#include <stdint.h>
+
+#include "types.hpp"
+
+namespace picovector {
+
+  class image_t;
+
+  // laid out exactly as the records in a .sdf file, so that a mapped file's
+  // table can be used in place
+  struct sdf_glyph_t {
+    uint16_t codepoint;
+    uint16_t advance;    // in font units
+    int8_t left, top;    // bitmap's top left from the origin, in field pixels
+    uint8_t w, h;        // bitmap size in field pixels
+    uint32_t offset;     // bitmap start within the font's data
+  };
+
+  // fonts stored as signed distance fields. each glyph is a small bitmap
+  // of distances to its outline (128 on the edge, higher inside) which is
+  // sampled bilinearly at any size, edges stay sharp however far it's
+  // scaled up and outlines and glows come from the same data
+  class sdf_font_t {
+  public:
+    enum effect_t {
+      FILL,
+      OUTLINE,      // a band width pixels wide centred on the edge
+      GLOW          // the glyph plus a falloff width pixels out from it
+    };
+
+    int glyph_count;
+    sdf_glyph_t *glyphs;       // sorted by codepoint
+    const uint8_t *data;
+    uint16_t units_per_em;
+    uint8_t field_per_em;      // field pixels per em
+    uint8_t spread;            // field pixels recorded either side of the edge
+
+    int glyph_index(int codepoint);
+
+    // text is positioned as with font_t, size pixels to the em. effects
+    // reach at most the spread, scaled to size, out from the edge
+    void draw(image_t *target, const char *text, float x, float y, float size, effect_t effect, float width);
+    rect_t measure(const char *text, float size);
+  };
+
+}
@@ -1,8 +1,6 @@
 #include <float.h>
 #include "shape.hpp"
 
-using std::vector;
-
 namespace picovector {
 
 
@@ -47,25 +45,57 @@ namespace picovector {
 
 
 
-  shape_t::shape_t(int path_count) {
+  shape_t::shape_t(int path_count, int point_count) {
     //debug_printf("shape constructed\n");
     paths.reserve(path_count);
+    _points.reserve(point_count);
   }
 
-  void shape_t::add_path(path_t path) {
+  void shape_t::begin_path(bool closed) {
+    PV_ALLOC_SCOPE(PV_ALLOC_PATH);
+    path_t path;
+    path.offset = _points.size();
+    path.closed = closed;
     paths.push_back(path);
+    invalidate();
+  }
+
+  void shape_t::add_point(const vec2_t &point) {
+    if(_points.size() == _points.capacity()) {
+      PV_ALLOC_SCOPE(PV_ALLOC_PATH);
+      _points.reserve(max(size_t(16), _points.capacity() * 2));
+    }
+    _points.push_back(point);
+    paths.back().count++;
+  }
+
+  void shape_t::add_point(float x, float y) {
+    add_point(vec2_t(x, y));
+  }
+
+  void shape_t::clear() {
+    _points.clear();
+    paths.clear();
+    invalidate();
+  }
+
+  void shape_t::invalidate() {
+    version++;
   }
 
   rect_t shape_t::bounds() {
     float minx = FLT_MAX, miny = FLT_MAX, maxx = -FLT_MAX, maxy = -FLT_MAX;
-    for(const path_t &path : paths) {
-      for(vec2_t vec2 : path.points) {
-        vec2 = vec2.transform(&transform);
-        minx = min(minx, vec2.x);
-        miny = min(miny, vec2.y);
-        maxx = max(maxx, vec2.x);
-        maxy = max(maxy, vec2.y);
-      }
+    for(vec2_t vec2 : _points) {
+      vec2 = vec2.transform(&transform);
+      minx = min(minx, vec2.x);
+      miny = min(miny, vec2.y);
+      maxx = max(maxx, vec2.x);
+      maxy = max(maxy, vec2.y);
+    }
+    if(_stroke.width > 0.0f) {
+      // generous for anything but tight miters, the outline isn't built here
+      float e = stroke_extent(_stroke) * transform.max_scale();
+      minx -= e; miny -= e; maxx += e; maxy += e;
     }
     return rect_t(minx, miny, ceil(maxx) - minx, ceil(maxy) - miny);
   }
@@ -81,84 +111,42 @@ namespace picovector {
     this->_brush = brush;
   }
 
-  void shape_t::stroke(float thickness) {
-    for(int i = 0; i < (int)this->paths.size(); i++) {
-      this->paths[i].stroke(thickness);
-    }
+  void shape_t::stroke(float thickness, join_t join, cap_t cap) {
+    _stroke.width = thickness;
+    _stroke.join = join;
+    _stroke.cap = cap;
+    invalidate();
   }
 
 
 
-  path_t::path_t(int vec2_count) {
-    points.reserve(vec2_count);
-  }
+  void shape_t::inflate(float offset) {
+    for(path_t &path : paths) {
+      int n = path.count;
+      if(!path.closed || n < 3) continue;
 
-  void path_t::add_point(const vec2_t &vec2) {
-    points.push_back(vec2);
-  }
+      // each point becomes where the offset edges either side of the next
+      // one meet. the first two are overwritten before the last edges are
+      // reached so they're kept aside
+      vec2_t *p = &_points[path.offset];
+      vec2_t first = p[0], second = p[1];
+      auto at = [&](int i) {return i == n ? first : (i == n + 1 ? second : p[i]);};
 
-  void path_t::add_point(float x, float y) {
-    points.push_back(vec2_t(x, y));
-  }
-
-  void path_t::edge_points(int edge, vec2_t &s, vec2_t &e) {
-    // return the two vec2s that make up an edge
-    s = edge == -1 ? points.back() : points[edge];
-    e = edge == (int)points.size() - 1 ? points.front() : points[edge + 1];
-  }
-
-  void path_t::stroke(float offset) {
-    int c = points.size();
-    vector<vec2_t, PV_STD_ALLOCATOR<vec2_t>> new_points(c);
-
-    if(c == 2) {
-        vec2_t p1, p2; // edge 1 start and end
-        edge_points(0, p1, p2);
-        offset_line_segment(p1, p2, offset);
-        points.push_back(p2);
-        points.push_back(p1);
-    }else{
-      for(int i = 0; i < c; i++) {
-        vec2_t p1, p2; // edge 1 start and end
-        edge_points(i - 1, p1, p2);
+      for(int i = 0; i < n; i++) {
+        vec2_t p1 = at(i), p2 = at(i + 1); // edge 1 start and end
         offset_line_segment(p1, p2, offset);
 
-        vec2_t p3, p4; // edge 2 start and end
-        edge_points(i, p3, p4);
+        vec2_t p3 = at(i + 1), p4 = at(i + 2); // edge 2 start and end
         offset_line_segment(p3, p4, offset);
 
-        // find intersection of the edges
+        // find intersection of the edges, where they're parallel the end
+        // of the first will do
         vec2_t pi;
-        bool ok = intersection(p1, p2, p3, p4, pi);
-        new_points[i] = pi;
+        if(!intersection(p1, p2, p3, p4, pi)) pi = p2;
+        p[i] = pi;
       }
-
-      points.push_back(points.front());
-      points.insert(points.end(), new_points.begin(), new_points.end());
-      points.push_back(new_points.front());
     }
+    invalidate();
   }
 
-  void path_t::inflate(float offset) {
-    vector<vec2_t, PV_STD_ALLOCATOR<vec2_t>> new_points(points.size());
-
-    int edge_count = points.size();
-    for(int i = 0; i < edge_count; i++) {
-      vec2_t p1, p2; // edge 1 start and end
-      edge_points(i, p1, p2);
-      offset_line_segment(p1, p2, offset);
-
-      vec2_t p3, p4; // edge 2 start and end
-      edge_points(i + 1, p3, p4);
-      offset_line_segment(p3, p4, offset);
-
-      // find intersection of the edges
-      vec2_t pi;
-      bool ok = intersection(p1, p2, p3, p4, pi);
-      new_points[i] = pi;
-    }
-
-    points = new_points;
-  }
-
-}
+}
\ No newline at end of file
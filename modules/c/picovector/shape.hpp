@@ -4,37 +4,97 @@
 #include "picovector.hpp"
 #include "mat3.hpp"
 #include "types.hpp"
+#include "stroke.hpp"
 
 namespace picovector {
 
+  // a run of points in the arena of the shape it belongs to
   class path_t {
   public:
-    std::vector<vec2_t, PV_STD_ALLOCATOR<vec2_t>> points;
+    uint32_t offset = 0; // first point in shape_t::_points
+    uint32_t count = 0;
+    bool closed = true;  // open paths only differ when stroked
+  };
 
-    path_t(int point_count = 0);
-    void add_point(const vec2_t &point);
-    void add_point(float x, float y);
-    void edge_points(int edge, vec2_t &s, vec2_t &e);
-    void offset_edge(vec2_t &s, vec2_t &e, float offset);
-    void stroke(float offset);
-    void inflate(float offset);
+  // a path's points where they sit in the arena, only good until points are
+  // next added to the shape
+  struct point_span_t {
+    vec2_t *p;
+    int n;
+
+    vec2_t *begin() const {return p;}
+    vec2_t *end() const {return p + n;}
+    vec2_t *data() const {return p;}
+    int size() const {return n;}
+    bool empty() const {return n == 0;}
+    vec2_t &operator[](int i) const {return p[i];}
+    vec2_t &back() const {return p[n - 1];}
+  };
+
+  // device space edges from a previous draw, reused by render() while the
+  // geometry, transform, and antialias level are unchanged
+  struct shape_cache_t {
+    uint32_t version = 0;
+    mat3_t transform;
+    int aa = -1;
+    rect_t bounds;
+    int edge_count = 0;
+    std::vector<uint8_t, PV_STD_ALLOCATOR<uint8_t>> edges;
+  };
+
+  // primitives keep the parameters they were built from so that their curves
+  // can be flattened again for the size they end up being drawn at, see
+  // flatten_primitive() in primitive.hpp
+  struct primitive_t {
+    enum type_t {NONE, CIRCLE, ROUNDED_RECTANGLE, SQUIRCLE, ARC, PIE};
+    type_t type = NONE;
+    float p[8];          // constructor parameters
+    float radius = 0.0f; // largest curve radius, in shape space
+    int segments = 0;    // segments per full turn the paths were built with
+    float tolerance = 0.0f; // tolerance they were built with, in shape space
   };
 
   class shape_t {
   public:
+    // every path's points end to end in one allocation that's kept when
+    // the shape is rebuilt, paths index into it
+    std::vector<vec2_t, PV_STD_ALLOCATOR<vec2_t>> _points;
     std::vector<path_t, PV_STD_ALLOCATOR<path_t>> paths;
     mat3_t transform;
     brush_t *_brush = nullptr;
 
-    shape_t(int path_count = 0);
+    // paths are outlined with this when it has a width, the outline is
+    // generated as the shape is rasterised and never stored
+    stroke_t _stroke;
+
+    // bumped whenever paths change, call invalidate() after editing points
+    // directly
+    uint32_t version = 1;
+    shape_cache_t _cache;
+    primitive_t _primitive;
+
+    shape_t(int path_count = 0, int point_count = 0);
     ~shape_t() {
       //debug_printf("shape destructed\n");
     }
-    void add_path(path_t path);
+
+    // paths are built in place, points are added to the last path begun.
+    // new shapes aren't primitives, anything rebuilding one as plain paths
+    // sets _primitive.type back to NONE itself
+    void begin_path(bool closed = true);
+    void add_point(const vec2_t &point);
+    void add_point(float x, float y);
+    // removes every path keeping the storage for whatever's built next
+    void clear();
+    point_span_t points(const path_t &path) {return {_points.data() + path.offset, int(path.count)};}
+
     rect_t bounds();
     /*void draw(image &img); // methods should be on image perhaps? with style/brush and transform passed in?*/
-    void stroke(float thickness);
+    void stroke(float thickness, join_t join = JOIN_MITER, cap_t cap = CAP_BUTT);
     void brush(brush_t *brush);
+    // moves the edges of every closed path out by offset, in place
+    void inflate(float offset);
+    void invalidate();
   };
 
 }
\ No newline at end of file
@@ -0,0 +1,172 @@
+#include <math.h>
+#include <algorithm>
+
+#include "spatial_hash.hpp"
+
+using std::min, std::max;
+
+namespace picovector {
+
+  spatial_hash_t::spatial_hash_t(float cell_size, int capacity)
+    : _inv_cell(1.0f / cell_size), _boxes(capacity), _live(capacity, 0) {
+    // around two buckets a box keeps the runs short without costing much
+    uint32_t buckets = 64;
+    while(buckets < uint32_t(capacity) * 2) buckets <<= 1;
+    _starts.resize(buckets + 1);
+    _mask = buckets - 1;
+  }
+
+  int spatial_hash_t::cell(float v) const {
+    return std::clamp(int(floorf(v * _inv_cell)), -32768, 32767);
+  }
+
+  // the cells an edge to edge range touches, hi is exclusive so a box that
+  // ends on a cell boundary stays out of the next cell
+  void spatial_hash_t::cells(float lo, float hi, int &c1, int &c2) const {
+    c1 = cell(lo);
+    c2 = max(c1, std::clamp(int(ceilf(hi * _inv_cell)) - 1, -32768, 32767));
+  }
+
+  int spatial_hash_t::insert(rect_t r) {
+    int n = _boxes.size();
+    while(_next_free < n && _live[_next_free]) _next_free++;
+    if(_next_free == n) return -1;
+    set(_next_free, r);
+    return _next_free;
+  }
+
+  void spatial_hash_t::set(int handle, rect_t r) {
+    if(!_live[handle]) {
+      _live[handle] = 1;
+      _count++;
+    }
+    _boxes[handle] = {r.x, r.y, r.x + r.w, r.y + r.h};
+    _dirty = true;
+  }
+
+  void spatial_hash_t::remove(int handle) {
+    if(!_live[handle]) return;
+    _live[handle] = 0;
+    _count--;
+    _next_free = min(_next_free, handle);
+    _dirty = true;
+  }
+
+  void spatial_hash_t::clear() {
+    std::fill(_live.begin(), _live.end(), 0);
+    _count = 0;
+    _next_free = 0;
+    _dirty = true;
+  }
+
+  // a counting sort of every box's cells into their buckets, _refs only
+  // ever grows so once it's big enough nothing is allocated
+  void spatial_hash_t::rebuild() {
+    if(!_dirty) return;
+    _dirty = false;
+
+    uint32_t buckets = _mask + 1;
+    std::fill(_starts.begin(), _starts.end(), 0);
+
+    int n = _boxes.size();
+    size_t total = 0;
+    for(int h = 0; h < n; h++) {
+      if(!_live[h]) continue;
+      const box_t &b = _boxes[h];
+      int cx1, cx2, cy1, cy2;
+      cells(b.x1, b.x2, cx1, cx2);
+      cells(b.y1, b.y2, cy1, cy2);
+      for(int cy = cy1; cy <= cy2; cy++) {
+        for(int cx = cx1; cx <= cx2; cx++) {
+          _starts[bucket(cx, cy) + 1]++;
+        }
+      }
+      total += (cx2 - cx1 + 1) * (cy2 - cy1 + 1);
+    }
+
+    for(uint32_t i = 0; i < buckets; i++) {
+      _starts[i + 1] += _starts[i];
+    }
+    if(_refs.size() < total) {
+      _refs.resize(total);
+    }
+
+    // the starts are used as write positions and end up one bucket along,
+    // shifting them back afterwards restores them
+    for(int h = 0; h < n; h++) {
+      if(!_live[h]) continue;
+      const box_t &b = _boxes[h];
+      int cx1, cx2, cy1, cy2;
+      cells(b.x1, b.x2, cx1, cx2);
+      cells(b.y1, b.y2, cy1, cy2);
+      for(int cy = cy1; cy <= cy2; cy++) {
+        for(int cx = cx1; cx <= cx2; cx++) {
+          _refs[_starts[bucket(cx, cy)]++] = {uint16_t(h), int16_t(cx), int16_t(cy)};
+        }
+      }
+    }
+    for(uint32_t i = buckets; i > 0; i--) {
+      _starts[i] = _starts[i - 1];
+    }
+    _starts[0] = 0;
+  }
+
+  // a pair of boxes can share several cells, it's only reported from the
+  // cell holding the top left corner of their overlap
+  int spatial_hash_t::pairs(uint16_t *out, int limit) {
+    rebuild();
+
+    int found = 0;
+    uint32_t buckets = _mask + 1;
+    for(uint32_t bk = 0; bk < buckets; bk++) {
+      uint32_t start = _starts[bk], end = _starts[bk + 1];
+      for(uint32_t i = start; i < end; i++) {
+        const ref_t &ri = _refs[i];
+        const box_t &a = _boxes[ri.handle];
+        for(uint32_t j = i + 1; j < end; j++) {
+          const ref_t &rj = _refs[j];
+          if(rj.cx != ri.cx || rj.cy != ri.cy) continue;
+
+          const box_t &b = _boxes[rj.handle];
+          if(a.x1 >= b.x2 || b.x1 >= a.x2 || a.y1 >= b.y2 || b.y1 >= a.y2) continue;
+          if(cell(max(a.x1, b.x1)) != ri.cx || cell(max(a.y1, b.y1)) != ri.cy) continue;
+
+          if(found == limit) return found;
+          out[found * 2] = min(ri.handle, rj.handle);
+          out[found * 2 + 1] = max(ri.handle, rj.handle);
+          found++;
+        }
+      }
+    }
+    return found;
+  }
+
+  int spatial_hash_t::query(rect_t r, uint16_t *out, int limit) {
+    rebuild();
+
+    box_t q = {r.x, r.y, r.x + r.w, r.y + r.h};
+    int cx1, cx2, cy1, cy2;
+    cells(q.x1, q.x2, cx1, cx2);
+    cells(q.y1, q.y2, cy1, cy2);
+
+    int found = 0;
+    for(int cy = cy1; cy <= cy2; cy++) {
+      for(int cx = cx1; cx <= cx2; cx++) {
+        uint32_t bk = bucket(cx, cy);
+        for(uint32_t i = _starts[bk]; i < _starts[bk + 1]; i++) {
+          const ref_t &ref = _refs[i];
+          if(ref.cx != cx || ref.cy != cy) continue;
+
+          const box_t &b = _boxes[ref.handle];
+          if(q.x1 >= b.x2 || b.x1 >= q.x2 || q.y1 >= b.y2 || b.y1 >= q.y2) continue;
+          if(cell(max(q.x1, b.x1)) != cx || cell(max(q.y1, b.y1)) != cy) continue;
+
+          if(found == limit) return found;
+          out[found++] = ref.handle;
+        }
+      }
+    }
+    return found;
+  }
+
+}
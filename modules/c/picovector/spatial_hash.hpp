@@ -0,0 +1,81 @@
+#pragma once
+
+#include <stdint.h>
+#include <vector>
+
+#include "picovector.hpp"
+#include "types.hpp"
+
+namespace picovector {
+
+  // a broad phase for collisions, boxes are filed under every square cell
+  // of cell_size pixels they touch so only boxes sharing a cell are ever
+  // compared. cells are hashed into a fixed number of buckets which means
+  // the world doesn't need bounds. boxes live in slots numbered 0 to
+  // capacity - 1, the slot number is the handle used everywhere else. the
+  // buckets are rebuilt on the first query after anything has moved
+  class spatial_hash_t {
+  public:
+    static const int MAX_CAPACITY = 65535;
+
+    spatial_hash_t(float cell_size, int capacity);
+
+    int capacity() const {return _boxes.size();}
+    int count() const {return _count;}
+    bool live(int handle) const {return _live[handle];}
+    rect_t box(int handle) const {
+      const box_t &b = _boxes[handle];
+      return rect_t(b.x1, b.y1, b.x2 - b.x1, b.y2 - b.y1);
+    }
+
+    // puts r in a free slot and returns its handle, -1 when they're all used
+    int insert(rect_t r);
+    // puts r in slot handle whether it was in use or not
+    void set(int handle, rect_t r);
+    void remove(int handle);
+    void clear();
+
+    // writes the handles of overlapping boxes to out two at a time, lower
+    // handle first and each pair once, up to limit pairs. returns how many
+    // pairs were written
+    int pairs(uint16_t *out, int limit);
+
+    // writes the handles of the boxes overlapping r to out, up to limit of
+    // them, and returns how many
+    int query(rect_t r, uint16_t *out, int limit);
+
+  private:
+    // edges rather than sizes, x2 and y2 are exclusive
+    struct box_t {
+      float x1, y1, x2, y2;
+    };
+
+    // one entry for every cell a box touches, the cell is kept so boxes
+    // from different cells that share a bucket can be told apart
+    struct ref_t {
+      uint16_t handle;
+      int16_t cx, cy;
+    };
+
+    float    _inv_cell;
+    int      _count = 0;
+    int      _next_free = 0;   // no slot below this is free
+    bool     _dirty = true;
+
+    std::vector<box_t, PV_STD_ALLOCATOR<box_t>> _boxes;
+    std::vector<uint8_t, PV_STD_ALLOCATOR<uint8_t>> _live;
+
+    // refs sorted by bucket, bucket b's run starts at _starts[b]
+    std::vector<ref_t, PV_STD_ALLOCATOR<ref_t>> _refs;
+    std::vector<uint32_t, PV_STD_ALLOCATOR<uint32_t>> _starts;
+    uint32_t _mask;
+
+    int cell(float v) const;
+    void cells(float lo, float hi, int &c1, int &c2) const;
+    uint32_t bucket(int cx, int cy) const {
+      return (uint32_t(cx) * 73856093u ^ uint32_t(cy) * 19349663u) & _mask;
+    }
+    void rebuild();
+  };
+
+}
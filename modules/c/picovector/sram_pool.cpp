@@ -0,0 +1,92 @@
+#include <algorithm>
+
+#include "sram_pool.hpp"
+
+namespace picovector {
+
+  // every block starts with its header, sizes include it and are multiples
+  // of eight so the pixels that follow stay aligned
+  struct sram_block_t {
+    uint32_t size;
+    uint32_t free;
+  };
+
+  // leftovers smaller than this stay with the allocation instead of being
+  // split off as a block of their own
+  #define SRAM_MIN_SPLIT 64
+
+  static size_t sram_used = 0;
+  static size_t sram_high_water = 0;
+
+#if PV_SRAM_POOL_SIZE > 0
+  static uint8_t __attribute__((aligned(8))) sram_pool[PV_SRAM_POOL_SIZE];
+  static bool sram_ready = false;
+
+  static inline sram_block_t *block_at(size_t offset) {
+    return (sram_block_t *)&sram_pool[offset];
+  }
+
+  static void sram_init() {
+    *block_at(0) = {PV_SRAM_POOL_SIZE, 1};
+    sram_ready = true;
+  }
+
+  void *sram_alloc(size_t size) {
+    if(!sram_ready) sram_init();
+    if(size == 0 || size > PV_SRAM_POOL_SIZE) return nullptr;
+
+    size_t need = (size + sizeof(sram_block_t) + 7) & ~size_t(7);
+    for(size_t offset = 0; offset < PV_SRAM_POOL_SIZE; offset += block_at(offset)->size) {
+      sram_block_t *b = block_at(offset);
+      if(!b->free || b->size < need) continue;
+
+      if(b->size - need >= SRAM_MIN_SPLIT) {
+        *block_at(offset + need) = {uint32_t(b->size - need), 1};
+        b->size = need;
+      }
+      b->free = 0;
+      sram_used += b->size;
+      sram_high_water = std::max(sram_high_water, sram_used);
+      return b + 1;
+    }
+    return nullptr;
+  }
+
+  void sram_free(void *p) {
+    if(!p) return;
+    sram_block_t *b = (sram_block_t *)p - 1;
+    b->free = 1;
+    sram_used -= b->size;
+
+    // merge every run of free blocks, there are only ever a handful
+    for(size_t offset = 0; offset < PV_SRAM_POOL_SIZE; offset += block_at(offset)->size) {
+      sram_block_t *a = block_at(offset);
+      while(a->free && offset + a->size < PV_SRAM_POOL_SIZE && block_at(offset + a->size)->free) {
+        a->size += block_at(offset + a->size)->size;
+      }
+    }
+  }
+
+  bool sram_owns(const void *p) {
+    return (const uint8_t *)p >= sram_pool && (const uint8_t *)p < sram_pool + PV_SRAM_POOL_SIZE;
+  }
+#else
+  // no pool, every request falls back to PV_MALLOC
+  void *sram_alloc(size_t size) {return nullptr;}
+  void sram_free(void *p) {}
+  bool sram_owns(const void *p) {return false;}
+#endif
+
+  void sram_pool_stats(sram_pool_stats_t *stats) {
+    size_t largest = 0;
+#if PV_SRAM_POOL_SIZE > 0
+    if(!sram_ready) sram_init();
+    for(size_t offset = 0; offset < PV_SRAM_POOL_SIZE; offset += block_at(offset)->size) {
+      sram_block_t *b = block_at(offset);
+      if(b->free) largest = std::max(largest, size_t(b->size) - sizeof(sram_block_t));
+    }
+#endif
+    *stats = {PV_SRAM_POOL_SIZE, sram_used, sram_high_water, largest};
+  }
+
+}
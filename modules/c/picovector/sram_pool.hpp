@@ -0,0 +1,39 @@
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+
+namespace picovector {
+
+  // a fixed block of sram for image buffers that are asked to live there,
+  // with psram fitted the gc heap is entirely psram so nothing from
+  // PV_MALLOC is. allocations are first fit and neighbouring free blocks
+  // are merged as they're freed. the pool is always reserved so it's off
+  // unless a build asks for it, without it SRAM images come from the gc
+  // heap like any other
+  #ifndef PV_SRAM_POOL_SIZE
+  #define PV_SRAM_POOL_SIZE 0
+  #endif
+
+  // sram the statically allocated picovector and display buffers may take
+  // between them (the display framebuffer, the working buffers and the sram
+  // pool), what's left is for micropython's own statics and the stacks.
+  // checked at build time in picovector.cpp
+  #ifndef PV_SRAM_BUDGET
+  #define PV_SRAM_BUDGET (440 * 1024)
+  #endif
+
+  struct sram_pool_stats_t {
+    size_t size;          // bytes in the pool
+    size_t used;          // bytes allocated now, headers included
+    size_t high_water;    // most ever allocated at once
+    size_t largest_free;  // biggest allocation that would succeed now
+  };
+
+  // returns nullptr if there's no free block big enough
+  void *sram_alloc(size_t size);
+  void sram_free(void *p);
+  bool sram_owns(const void *p);
+  void sram_pool_stats(sram_pool_stats_t *stats);
+
+}
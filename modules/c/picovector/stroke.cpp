@@ -0,0 +1,291 @@
+#include <math.h>
+
+#include "stroke.hpp"
+#include "shape.hpp"
+
+namespace picovector {
+
+  // walks the distinct points of a path, in either direction, without
+  // copying it. a point is skipped when it coincides with the one before
+  struct polyline_t {
+    const vec2_t *points;
+    int n;
+    bool closed;
+    bool reverse;
+
+    vec2_t at(int i) const {
+      return points[reverse ? n - 1 - i : i];
+    }
+
+    bool same(vec2_t a, vec2_t b) const {
+      return fabsf(a.x - b.x) < 1e-5f && fabsf(a.y - b.y) < 1e-5f;
+    }
+
+    bool dup(int i) const {
+      if(i > 0) return same(at(i), at(i - 1));
+      return closed && same(at(0), at(n - 1));
+    }
+
+    int first() const {
+      for(int i = 0; i < n; i++) {
+        if(!dup(i)) return i;
+      }
+      return -1;
+    }
+
+    int last() const {
+      for(int i = n - 1; i >= 0; i--) {
+        if(!dup(i)) return i;
+      }
+      return -1;
+    }
+
+    // the next distinct point, wrapping around closed paths, or -1 at the
+    // end of an open one
+    int next(int i) const {
+      do {
+        if(++i == n) {
+          if(!closed) return -1;
+          i = 0;
+        }
+      } while(dup(i));
+      return i;
+    }
+
+    int count() const {
+      int c = 0;
+      for(int i = 0; i < n; i++) {
+        if(!dup(i)) c++;
+      }
+      return c;
+    }
+  };
+
+  // joins emitted points into a closed outline, transforming them on the way
+  struct outline_t {
+    edge_sink_t sink;
+    void *ctx;
+    mat3_t *transform;
+    vec2_t first, last;
+    bool started = false;
+
+    void line_to(vec2_t p) {
+      p = p.transform(transform);
+      if(!started) {
+        first = p;
+        started = true;
+      }else{
+        sink(ctx, last, p);
+      }
+      last = p;
+    }
+
+    void close() {
+      if(started) {
+        sink(ctx, last, first);
+      }
+      started = false;
+    }
+  };
+
+  static inline vec2_t direction(vec2_t a, vec2_t b) {
+    vec2_t d = b - a;
+    return d / sqrtf(d.x * d.x + d.y * d.y);
+  }
+
+  static inline vec2_t normal(vec2_t t) {
+    return vec2_t(-t.y, t.x);
+  }
+
+  static inline vec2_t rotate(vec2_t v, float a) {
+    float c = cosf(a), s = sinf(a);
+    return vec2_t(v.x * c - v.y * s, v.x * s + v.y * c);
+  }
+
+  static inline float length(vec2_t v) {
+    return sqrtf(v.x * v.x + v.y * v.y);
+  }
+
+  // segments needed for an arc of radius r turning through angle a
+  static int arc_steps(float r, float a, float tolerance) {
+    r = fabsf(r);
+    if(r <= tolerance) return 1;
+    float step = 2.0f * acosf(1.0f - tolerance / r);
+    return max(1, min(64, int(ceilf(fabsf(a) / step))));
+  }
+
+  static void arc(outline_t &out, vec2_t c, vec2_t from, float a, float tolerance) {
+    int steps = arc_steps(length(from), a, tolerance);
+    for(int i = 1; i < steps; i++) {
+      out.line_to(c + rotate(from, a * float(i) / float(steps)));
+    }
+  }
+
+  // the join at vertex v between an edge arriving along t1 and one leaving
+  // along t2, for the side offset by d. l1 and l2 are the lengths of the
+  // two edges
+  static void join(outline_t &out, vec2_t v, vec2_t t1, float l1, vec2_t t2, float l2, float d, const stroke_t &style, float tolerance) {
+    vec2_t n1 = normal(t1), n2 = normal(t2);
+    vec2_t a = v + n1 * d;
+    vec2_t b = v + n2 * d;
+
+    float cross = t1.x * t2.y - t1.y * t2.x;
+    float dot = t1.x * t2.x + t1.y * t2.y;
+
+    if(fabsf(cross) < 1e-6f && dot > 0.0f) {
+      // carries straight on
+      out.line_to(a);
+      return;
+    }
+
+    if(cross * d > 0.0f) {
+      // inside of the turn, meet where the offset edges cross if that's
+      // within both of them, otherwise pivot around the vertex
+      if(1.0f + dot > 1e-4f) {
+        vec2_t m = v + (n1 + n2) * (d / (1.0f + dot));
+        float back = (a.x - m.x) * t1.x + (a.y - m.y) * t1.y;
+        float forward = (m.x - b.x) * t2.x + (m.y - b.y) * t2.y;
+        if(back <= l1 && forward <= l2) {
+          out.line_to(m);
+          return;
+        }
+      }
+      out.line_to(a);
+      out.line_to(v);
+      out.line_to(b);
+      return;
+    }
+
+    out.line_to(a);
+
+    switch(style.join) {
+      case JOIN_MITER: {
+        // miter length relative to the stroke width is 1 / cos(theta / 2)
+        if((1.0f + dot) * style.miter_limit * style.miter_limit >= 2.0f) {
+          out.line_to(v + (n1 + n2) * (d / (1.0f + dot)));
+        }
+      } break;
+
+      case JOIN_ROUND: {
+        arc(out, v, n1 * d, atan2f(cross, dot), tolerance);
+      } break;
+
+      case JOIN_BEVEL: {
+      } break;
+    }
+
+    out.line_to(b);
+  }
+
+  // cap at point e reached travelling along t, from e + n * hw round to
+  // e - n * hw
+  static void cap(outline_t &out, vec2_t e, vec2_t t, float hw, const stroke_t &style, float tolerance) {
+    vec2_t n = normal(t);
+    switch(style.cap) {
+      case CAP_BUTT: {
+      } break;
+
+      case CAP_ROUND: {
+        arc(out, e, n * hw, -float(M_PI), tolerance);
+      } break;
+
+      case CAP_SQUARE: {
+        out.line_to(e + (n + t) * hw);
+        out.line_to(e + (t - n) * hw);
+      } break;
+    }
+  }
+
+  // one side of an open path offset by d, from its first point to its last
+  static void open_side(outline_t &out, const polyline_t &pl, float d, const stroke_t &style, float tolerance, vec2_t &t_end) {
+    int i0 = pl.first();
+    int i1 = pl.next(i0);
+
+    vec2_t a = pl.at(i0), b = pl.at(i1);
+    vec2_t t = direction(a, b);
+    float l = length(b - a);
+    out.line_to(a + normal(t) * d);
+
+    int i2;
+    while((i2 = pl.next(i1)) >= 0) {
+      vec2_t c = pl.at(i2);
+      vec2_t t2 = direction(b, c);
+      float l2 = length(c - b);
+      join(out, b, t, l, t2, l2, d, style, tolerance);
+      b = c; t = t2; l = l2; i1 = i2;
+    }
+
+    out.line_to(b + normal(t) * d);
+    t_end = t;
+  }
+
+  // a closed path offset by d, with a join at every vertex
+  static void closed_side(outline_t &out, const polyline_t &pl, float d, const stroke_t &style, float tolerance) {
+    int i0 = pl.first();
+    vec2_t prev = pl.at(pl.last());
+    vec2_t v = pl.at(i0);
+    vec2_t t = direction(prev, v);
+    float l = length(v - prev);
+
+    int i = i0;
+    do {
+      int j = pl.next(i);
+      vec2_t w = pl.at(j);
+      vec2_t t2 = direction(v, w);
+      float l2 = length(w - v);
+      join(out, v, t, l, t2, l2, d, style, tolerance);
+      v = w; t = t2; l = l2; i = j;
+    } while(i != i0);
+
+    out.close();
+  }
+
+  void stroke_path(const vec2_t *points, int count, bool closed, const stroke_t &style, mat3_t *transform, float tolerance, edge_sink_t sink, void *ctx) {
+    int n = count;
+    if(n < 2 || style.width <= 0.0f) return;
+
+    // two point paths have no inside so are always treated as open
+    closed = closed && n > 2;
+    polyline_t pl = {points, n, closed, false};
+    int distinct = pl.count();
+    if(distinct < 2) return;
+    if(distinct == 2) closed = pl.closed = false;
+
+    outline_t out = {sink, ctx, transform};
+
+    if(closed) {
+      // the path itself bounds the inside of the band
+      int i0 = pl.first(), i = i0;
+      do {
+        out.line_to(pl.at(i));
+        i = pl.next(i);
+      } while(i != i0);
+      out.close();
+
+      closed_side(out, pl, style.width, style, tolerance);
+      return;
+    }
+
+    float hw = style.width / 2.0f;
+    vec2_t t_end, t_start;
+
+    open_side(out, pl, hw, style, tolerance, t_end);
+    cap(out, pl.at(pl.last()), t_end, hw, style, tolerance);
+
+    polyline_t rl = pl;
+    rl.reverse = true;
+    open_side(out, rl, hw, style, tolerance, t_start);
+    cap(out, pl.at(pl.first()), t_start, hw, style, tolerance);
+
+    out.close();
+  }
+
+  float stroke_extent(const stroke_t &style) {
+    float extent = style.width;
+    if(style.join == JOIN_MITER) {
+      extent *= max(1.0f, style.miter_limit);
+    }
+    return extent;
+  }
+
+}
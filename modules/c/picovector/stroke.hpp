@@ -0,0 +1,42 @@
+#pragma once
+
+#include "types.hpp"
+#include "mat3.hpp"
+
+namespace picovector {
+
+  enum join_t {
+    JOIN_MITER = 0,
+    JOIN_ROUND = 1,
+    JOIN_BEVEL = 2
+  };
+
+  enum cap_t {
+    CAP_BUTT = 0,
+    CAP_ROUND = 1,
+    CAP_SQUARE = 2
+  };
+
+  // how a shape's paths are outlined, a width of zero fills them instead
+  struct stroke_t {
+    float width = 0.0f;
+    join_t join = JOIN_MITER;
+    cap_t cap = CAP_BUTT;
+    float miter_limit = 4.0f;
+  };
+
+  // receives each edge of the stroke outline in device space
+  typedef void (*edge_sink_t)(void *ctx, vec2_t a, vec2_t b);
+
+  // emits the outline of a stroked path of count points straight to the
+  // rasteriser without touching the path. closed paths get a band of the given width along the
+  // side their edge normals point to (the outside of the built in
+  // primitives), open paths are centred on the line and capped at each end.
+  // tolerance is in shape space and sets how finely round joins and caps
+  // are flattened
+  void stroke_path(const vec2_t *points, int count, bool closed, const stroke_t &style, mat3_t *transform, float tolerance, edge_sink_t sink, void *ctx);
+
+  // furthest the outline can reach beyond the path
+  float stroke_extent(const stroke_t &style);
+
+}
@@ -0,0 +1,107 @@
+#pragma once
+
+#include <stdint.h>
+
+namespace picovector {
+
+  // decoded in place of anything that isn't well formed utf-8
+  const int UTF8_REPLACEMENT = 0xfffd;
+
+  // decodes the codepoint at text and steps past it. a malformed sequence
+  // decodes as UTF8_REPLACEMENT and is stepped over one byte at a time
+  inline int utf8_next(const char *&text) {
+    const uint8_t *p = (const uint8_t *)text;
+    int c = p[0];
+    if(c < 0x80) {
+      text++;
+      return c;
+    }
+
+    int length, codepoint;
+    if((c & 0xe0) == 0xc0) {
+      length = 2; codepoint = c & 0x1f;
+    }else if((c & 0xf0) == 0xe0) {
+      length = 3; codepoint = c & 0x0f;
+    }else if((c & 0xf8) == 0xf0) {
+      length = 4; codepoint = c & 0x07;
+    }else{
+      text++;
+      return UTF8_REPLACEMENT;
+    }
+
+    // continuation bytes, a nul terminator fails this too
+    for(int i = 1; i < length; i++) {
+      if((p[i] & 0xc0) != 0x80) {
+        text++;
+        return UTF8_REPLACEMENT;
+      }
+      codepoint = (codepoint << 6) | (p[i] & 0x3f);
+    }
+
+    text += length;
+    return codepoint;
+  }
+
+  // length of the run of ascii at the start of text, up to the first byte
+  // with its top bit set or the terminator. once aligned it checks a word
+  // at a time, an aligned word never straddles the end of the allocation
+  // though it can read past the terminator, which sanitisers object to
+  __attribute__((no_sanitize_address)) inline int ascii_run(const char *text) {
+    const char *p = text;
+    while(uintptr_t(p) & 3) {
+      if(*p == 0 || (*p & 0x80)) {
+        return p - text;
+      }
+      p++;
+    }
+
+    // with no top bits set a borrow into one only comes from a nul byte
+    while(true) {
+      uint32_t w = *(const uint32_t *)p;
+      if(((w - 0x01010101u) | w) & 0x80808080u) {
+        break;
+      }
+      p += 4;
+    }
+
+    while(*p && !(*p & 0x80)) {
+      p++;
+    }
+    return p - text;
+  }
+
+  // bumped whenever a fallback is changed anywhere, so every font's cached
+  // resolutions go stale even if the change was further down its chain
+  extern uint32_t font_fallback_generation;
+
+  // codepoints a font didn't have that were resolved through its fallback
+  // chain, so following the chain happens once per codepoint rather than
+  // on every draw. an index of -1 records that nothing in the chain has it
+  template<typename font_type> struct fallback_cache_t {
+    static const int SIZE = 32;
+
+    struct entry_t {
+      int codepoint;
+      uint32_t generation;
+      font_type *font;
+      int index;
+    } entries[SIZE];
+
+    entry_t *lookup(int codepoint) {
+      entry_t *e = &entries[codepoint & (SIZE - 1)];
+      if(e->generation == font_fallback_generation && e->codepoint == codepoint) {
+        return e;
+      }
+      return nullptr;
+    }
+
+    void store(int codepoint, font_type *font, int index) {
+      entry_t *e = &entries[codepoint & (SIZE - 1)];
+      e->codepoint = codepoint;
+      e->generation = font_fallback_generation;
+      e->font = font;
+      e->index = index;
+    }
+  };
+
+}
@@ -0,0 +1,226 @@
+#include <algorithm>
+
+#include "text_layout.hpp"
+#include "font.hpp"
+#include "pixel_font.hpp"
+#include "image.hpp"
+#include "text.hpp"
+
+using std::max;
+
+namespace picovector {
+
+  // metrics for the two kinds of font, vector fonts scale theirs by size
+  static float space_advance(font_t *font, float size) {
+    font_t *f;
+    int j;
+    return font->resolve(32, f, j) ? f->glyphs[j].advance * size / 128.0f : 0.0f;
+  }
+
+  static float space_advance(pixel_font_t *font, float size) {
+    return font->width / 3;
+  }
+
+  static float glyph_advance(font_t *font, int index, float size) {
+    return font->glyphs[index].advance * size / 128.0f;
+  }
+
+  static float glyph_advance(pixel_font_t *font, int index, float size) {
+    return font->glyphs[index].width + 1;
+  }
+
+  static float kerning(font_t *font, int left, int right, float size) {
+    return font->kerning(left, right) * size / 128.0f;
+  }
+
+  static float kerning(pixel_font_t *font, int left, int right, float size) {
+    return 0.0f;
+  }
+
+  static float line_height(font_t *font, float size) {
+    return size;
+  }
+
+  static float line_height(pixel_font_t *font, float size) {
+    return font->height;
+  }
+
+  template<typename font_type> static int chain_depth(font_type *font, font_type *used) {
+    int depth = 0;
+    for(; font && font != used; font = font->fallback) {
+      depth++;
+    }
+    return depth;
+  }
+
+  // the font depth steps down the chain, null if the chain has since been
+  // shortened
+  template<typename font_type> static font_type *chain_font(font_type *font, int depth) {
+    while(font && depth--) {
+      font = font->fallback;
+    }
+    return font;
+  }
+
+  template<typename font_type> static void layout_text(text_layout_t *l, font_type *font, const char *text, float width, float line_spacing, text_layout_t::align_t align) {
+    float line_h = line_height(font, l->size) * line_spacing;
+    float space = space_advance(font, l->size);
+
+    text_layout_glyph_t *glyphs = l->glyphs;
+    int count = 0;
+    int line_start = 0;         // first glyph on the current line
+    int word_start = 0;         // first glyph of the current word
+    float word_x = 0.0f;        // caret where the current word started
+    float word_line_end = 0.0f; // end of the line before the current word
+    float line_end = 0.0f;      // end of the last glyph, trailing spaces don't count
+    float caret = 0.0f;
+    float y = 0.0f;
+    bool line_open = false;
+    font_type *last_font = nullptr; // kerning only applies within a word
+    int last = 0;
+
+    l->line_count = 0;
+    l->width = 0.0f;
+
+    auto finish_line = [&](int end, float right) {
+      float offset = 0.0f;
+      if(align == text_layout_t::CENTER) offset = (width - right) / 2.0f;
+      if(align == text_layout_t::RIGHT) offset = width - right;
+      for(int i = line_start; i < end; i++) {
+        glyphs[i].x += offset;
+      }
+      l->width = max(l->width, right);
+      l->line_count++;
+      line_start = end;
+    };
+
+    auto glyph = [&](int codepoint) {
+      line_open = true;
+
+      if(codepoint == '\n') {
+        finish_line(count, line_end);
+        y += line_h;
+        caret = word_x = word_line_end = line_end = 0.0f;
+        word_start = count;
+        line_open = false;
+        last_font = nullptr;
+        return;
+      }
+
+      if(codepoint == ' ') {
+        caret += space;
+        word_start = count;
+        word_x = caret;
+        word_line_end = line_end;
+        last_font = nullptr;
+        return;
+      }
+
+      font_type *used;
+      int j;
+      if(!font->resolve(codepoint, used, j)) {
+        return;
+      }
+      float a = glyph_advance(used, j, l->size);
+      if(used == last_font) {
+        caret += kerning(used, last, codepoint, l->size);
+      }
+      last_font = used;
+      last = codepoint;
+
+      // the word so far moves down a line once it'd run past the width,
+      // unless it's the first on its line
+      if(caret + a > width && word_x > 0.0f) {
+        finish_line(word_start, word_line_end);
+        y += line_h;
+        for(int i = word_start; i < count; i++) {
+          glyphs[i].x -= word_x;
+          glyphs[i].y = y;
+        }
+        caret -= word_x;
+        word_x = word_line_end = 0.0f;
+      }
+
+      glyphs[count++] = {caret, y, uint16_t(j), uint8_t(chain_depth(font, used))};
+      caret += a;
+      line_end = caret;
+    };
+
+    // runs of ascii skip the decoder
+    while(*text != '\0') {
+      for(const char *end = text + ascii_run(text); text < end; text++) {
+        glyph(*text);
+      }
+      if(*text != '\0') {
+        glyph(utf8_next(text));
+      }
+    }
+
+    if(line_open) {
+      finish_line(count, line_end);
+    }
+
+    l->glyph_count = count;
+    l->height = l->line_count * line_h;
+  }
+
+  int text_layout_t::max_glyphs(const char *text) {
+    // one per codepoint, continuation bytes don't start one
+    int count = 0;
+    for(; *text != '\0'; text++) {
+      if((*text & 0xc0) != 0x80) {
+        count++;
+      }
+    }
+    return count;
+  }
+
+  void text_layout_t::layout(const char *text, float width, float line_spacing, align_t align) {
+    if(this->font) {
+      layout_text(this, this->font, text, width, line_spacing, align);
+    }else{
+      layout_text(this, this->pixel_font, text, width, line_spacing, align);
+    }
+  }
+
+  void text_layout_t::draw(image_t *target, float x, float y) {
+    target->modified();
+
+    if(this->font) {
+      float scale = this->size / 128.0f;
+      for(int i = 0; i < this->glyph_count; i++) {
+        text_layout_glyph_t *g = &this->glyphs[i];
+        font_t *f = chain_font(this->font, g->depth);
+        if(!f || g->index >= f->glyph_count) {
+          continue;
+        }
+
+        mat3_t transform;
+        transform = transform.translate(x + g->x, y + g->y + this->size);
+        transform = transform.scale(scale, scale);
+        f->draw_glyph(target, g->index, &transform, this->size);
+      }
+      return;
+    }
+
+    // text isn't within the target bounds at all, escape early
+    rect_t bounds = target->clip();
+    if(!rect_t(x, y, this->width, this->height).intersects(bounds)) {
+      return;
+    }
+
+    brush_t *brush = target->brush();
+    for(int i = 0; i < this->glyph_count; i++) {
+      text_layout_glyph_t *g = &this->glyphs[i];
+      pixel_font_t *f = chain_font(this->pixel_font, g->depth);
+      if(!f || g->index >= f->glyph_count) {
+        continue;
+      }
+
+      if(uint8_t *data = f->glyph_bitmap(g->index)) {
+        f->draw_glyph(target, &f->glyphs[g->index], data, brush, bounds, int(x + g->x), int(y + g->y));
+      }
+    }
+  }
+
+}
@@ -0,0 +1,48 @@
+#pragma once
+
+#include <stdint.h>
+
+#include "types.hpp"
+
+namespace picovector {
+
+  class image_t;
+  class font_t;
+  class pixel_font_t;
+
+  struct text_layout_glyph_t {
+    float x, y;       // top left of the glyph's line slot, from the layout origin
+    uint16_t index;   // glyph in the font it's drawn from
+    uint8_t depth;    // how far down the fallback chain that font is
+  };
+
+  // text broken into lines and positioned once, so drawing it again is only
+  // a walk over the packed glyphs. words are wrapped at spaces when they'd
+  // run past the width, a word wider than the width is left to overflow
+  class text_layout_t {
+  public:
+    enum align_t {
+      LEFT,
+      CENTER,
+      RIGHT
+    };
+
+    // exactly one of font or pixel_font is set
+    font_t *font;
+    pixel_font_t *pixel_font;
+    float size;       // vector fonts only
+
+    text_layout_glyph_t *glyphs;
+    int glyph_count;
+    int line_count;
+    float width;      // widest line
+    float height;     // line_count lines of line height
+
+    // upper bound on the glyphs text lays out into, the size glyphs needs
+    static int max_glyphs(const char *text);
+
+    void layout(const char *text, float width, float line_spacing, align_t align);
+    void draw(image_t *target, float x, float y);
+  };
+
+}
@@ -0,0 +1,163 @@
+#include <math.h>
+#include <string.h>
+#include <algorithm>
+
+#include "tilemap.hpp"
+#include "blend.hpp"
+#include "blit.hpp"
+#include "algorithms/algorithms.hpp"
+
+using std::min, std::max;
+
+namespace picovector {
+
+  tilemap_t::tilemap_t(image_t *atlas, int tile_w, int tile_h, const void *cells, bool wide, int columns, int rows)
+    : atlas(atlas), tile_w(tile_w), tile_h(tile_h), cells(cells), wide(wide), columns(columns), rows(rows), scroll(0, 0) {
+    update_opacity();
+  }
+
+  void tilemap_t::update_opacity() {
+    rect_t b = atlas->bounds();
+    int across = b.w / tile_w, down = b.h / tile_h;
+
+    if(atlas->transparency() == OPAQUE) {
+      _opaque.assign(across * down, 1);
+      return;
+    }
+
+    _opaque.assign(across * down, 0);
+    for(int t = 0; t < across * down; t++) {
+      int sx = b.x + (t % across) * tile_w, sy = b.y + (t / across) * tile_h;
+      bool opaque = true;
+      for(int y = sy; y < sy + tile_h && opaque; y++) {
+        for(int x = sx; x < sx + tile_w; x++) {
+          if(_a(atlas->get_unsafe(x, y)) != 255) {
+            opaque = false;
+            break;
+          }
+        }
+      }
+      _opaque[t] = opaque;
+    }
+  }
+
+  static inline int floor_div(int n, int d) {
+    return n >= 0 ? n / d : -((-n + d - 1) / d);
+  }
+
+  // only cells overlapping the clipped area are visited. opaque tiles are
+  // copied a row at a time when the atlas and target share a format and the
+  // copy would look no different to blending, everything else goes through
+  // the same row kernels as sprites
+  void tilemap_t::draw(image_t *target, rect_t area) {
+    rect_t c = target->clip().intersection(target->bounds()).intersection(area);
+    int cx1 = c.x, cy1 = c.y, cx2 = c.x + c.w, cy2 = c.y + c.h;
+    if(cx1 >= cx2 || cy1 >= cy2) return;
+
+    rect_t b = atlas->bounds();
+    int across = b.w / tile_w;
+    int count = _opaque.size();
+    if(!count) return;
+
+    blit_span_t normal = blit_span(atlas, target);
+    blit_span_t mirrored = blit_span(atlas, target, true);
+    blend_func_t bf = target->_blend_func;
+
+    bool copy = bf == blend_func_over && atlas->alpha() == 255 &&
+      atlas->pixel_format() == target->pixel_format() && atlas->has_palette() == target->has_palette() &&
+      (!atlas->has_palette() || atlas->palette() == target->palette());
+    size_t bpp = target->bytes_per_pixel();
+
+    // target position of the map's top left corner
+    int ox = int(area.x) - int(floorf(scroll.x));
+    int oy = int(area.y) - int(floorf(scroll.y));
+
+    int c1 = max(0, floor_div(cx1 - ox, tile_w)), c2 = min(columns, floor_div(cx2 - 1 - ox, tile_w) + 1);
+    int r1 = max(0, floor_div(cy1 - oy, tile_h)), r2 = min(rows, floor_div(cy2 - 1 - oy, tile_h) + 1);
+
+    for(int row = r1; row < r2; row++) {
+      int dy = oy + row * tile_h;
+      int y1 = max(dy, cy1), y2 = min(dy + tile_h, cy2);
+
+      for(int column = c1; column < c2; column++) {
+        uint16_t cell = this->cell(column, row);
+        int index = wide ? cell & INDEX_MASK : cell;
+        if(index == empty || index >= count) continue;
+
+        bool fh = wide && (cell & FLIP_H);
+        bool fv = wide && (cell & FLIP_V);
+
+        int sx = b.x + (index % across) * tile_w, sy = b.y + (index / across) * tile_h;
+        int dx = ox + column * tile_w;
+        int x1 = max(dx, cx1), x2 = min(dx + tile_w, cx2);
+
+        int u = fh ? sx + tile_w - 1 - (x1 - dx) : sx + (x1 - dx);
+
+        if(copy && !fh && _opaque[index]) {
+          for(int y = y1; y < y2; y++) {
+            int v = fv ? sy + tile_h - 1 - (y - dy) : sy + (y - dy);
+            memcpy(target->ptr(x1, y), atlas->ptr(u, v), (x2 - x1) * bpp);
+          }
+          continue;
+        }
+
+        blit_span_t fn = fh ? mirrored : normal;
+        for(int y = y1; y < y2; y++) {
+          int v = fv ? sy + tile_h - 1 - (y - dy) : sy + (y - dy);
+          fn(atlas, target, bf, u, v, x1, y, x2 - x1);
+        }
+      }
+    }
+  }
+
+  // r's right and bottom edges are exclusive so a box resting on a tile
+  // doesn't overlap it
+  int tilemap_t::overlaps(rect_t r, int16_t *out, int limit) const {
+    int c1 = max(0, int(floorf(r.x / tile_w))), c2 = min(columns, int(ceilf((r.x + r.w) / tile_w)));
+    int r1 = max(0, int(floorf(r.y / tile_h))), r2 = min(rows, int(ceilf((r.y + r.h) / tile_h)));
+
+    int n = 0;
+    for(int row = r1; row < r2; row++) {
+      for(int column = c1; column < c2; column++) {
+        if(!solid(column, row)) continue;
+        if(n == limit) return n;
+        out[n * 2] = column;
+        out[n * 2 + 1] = row;
+        n++;
+      }
+    }
+    return n;
+  }
+
+  // dda steps through square cells, so it's run in tile units and the hit
+  // scaled back up to pixels
+  bool tilemap_t::segment(vec2_t p1, vec2_t p2, int &column, int &row, vec2_t &hit, int &edge) const {
+    vec2_t p(p1.x / tile_w, p1.y / tile_h);
+    vec2_t v((p2.x - p1.x) / tile_w, (p2.y - p1.y) / tile_h);
+
+    column = floorf(p.x);
+    row = floorf(p.y);
+    if(solid(column, row)) {
+      hit = p1;
+      edge = -1;
+      return true;
+    }
+
+    float length = sqrtf(v.x * v.x + v.y * v.y);
+    if(length == 0.0f) return false;
+
+    bool found = false;
+    dda(p, v, [&](float hit_x, float hit_y, int gx, int gy, int e, float offset, float distance) -> bool {
+      if(distance > length) return false;
+      if(!solid(gx, gy)) return true;
+      column = gx;
+      row = gy;
+      hit = vec2_t(hit_x * tile_w, hit_y * tile_h);
+      edge = e;
+      found = true;
+      return false;
+    });
+    return found;
+  }
+
+}
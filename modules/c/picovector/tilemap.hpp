@@ -0,0 +1,65 @@
+#pragma once
+
+#include <stdint.h>
+#include <vector>
+
+#include "picovector.hpp"
+#include "image.hpp"
+#include "types.hpp"
+
+namespace picovector {
+
+  // a grid of tiles cut from an atlas image. cells hold tile indices counted
+  // left to right then top to bottom across the atlas, either 8 or 16 bits
+  // wide. 16 bit cells keep their top two bits for flipping the tile
+  class tilemap_t {
+  public:
+    static const uint16_t FLIP_H = 1 << 14;
+    static const uint16_t FLIP_V = 1 << 15;
+    static const uint16_t INDEX_MASK = FLIP_H - 1;
+
+    image_t     *atlas;
+    int          tile_w, tile_h;
+    const void  *cells;
+    bool         wide;        // 16 bit cells
+    int          columns, rows;
+    int          empty = -1;  // index that's never drawn, -1 for none
+    vec2_t       scroll;      // map pixel shown at the top left of the area drawn into
+
+    tilemap_t(image_t *atlas, int tile_w, int tile_h, const void *cells, bool wide, int columns, int rows);
+
+    // notes which tiles have no transparent pixels, call again if the atlas
+    // is drawn into
+    void update_opacity();
+
+    uint16_t cell(int column, int row) const {
+      int i = row * columns + column;
+      return wide ? ((const uint16_t *)cells)[i] : ((const uint8_t *)cells)[i];
+    }
+
+    // draws the part of the map visible through area on the target
+    void draw(image_t *target, rect_t area);
+
+    // collision queries work in map pixels with the map's top left at
+    // (0, 0), scroll isn't applied. every cell that doesn't hold the empty
+    // index is solid, the map's surroundings aren't
+    bool solid(int column, int row) const {
+      if(column < 0 || row < 0 || column >= columns || row >= rows) return false;
+      uint16_t c = cell(column, row);
+      return int(wide ? c & INDEX_MASK : c) != empty;
+    }
+
+    // writes the column, row of each solid cell r overlaps to out, up to limit
+    // cells, and returns how many were written
+    int overlaps(rect_t r, int16_t *out, int limit) const;
+
+    // walks the cells from p1 towards p2 and stops at the first solid one.
+    // hit is where the segment enters it through edge (0 top, 1 right,
+    // 2 bottom, 3 left, -1 when p1 starts inside it)
+    bool segment(vec2_t p1, vec2_t p2, int &column, int &row, vec2_t &hit, int &edge) const;
+
+  private:
+    std::vector<uint8_t, PV_STD_ALLOCATOR<uint8_t>> _opaque;
+  };
+
+}
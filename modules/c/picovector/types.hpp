@@ -134,6 +134,10 @@ namespace picovector {
       return w == 0 || h == 0;
     }
 
+    float area() const {
+      return w * h;
+    }
+
     bool contains(const vec2_t &p) {
       return p.x >= x && p.x <= x + w && p.y >= y && p.y <= y + h;
     }
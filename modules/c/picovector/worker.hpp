@@ -0,0 +1,26 @@
+#pragma once
+
+namespace picovector {
+
+  // the second core, registered by whichever driver owns core1 (the st7789
+  // driver services it between async updates). run() queues fn(arg) there
+  // and returns at once, wait() blocks until it has finished. busy() is
+  // true while a queued fn hasn't finished, background work (image loads)
+  // can hold core1 for a long time so short jobs check it before waiting
+  struct worker_t {
+    void (*run)(void (*fn)(void *arg), void *arg);
+    void (*wait)();
+    bool (*busy)();
+  };
+
+  extern worker_t *core1_worker;
+
+  // index of the calling core, for state that can't be shared between them
+  int current_core();
+
+  // calls fn(arg, 1) on core1 and fn(arg, 0) on this core, returning once
+  // both have finished. without a worker, or while it's busy with something
+  // else, both parts run here in turn
+  void run_parallel(void (*fn)(void *arg, int part), void *arg);
+
+}
@@ -0,0 +1,90 @@
+#include <string.h>
+
+#include "working_buffer.hpp"
+
+namespace picovector {
+
+  struct working_buffer_claim_t {
+    size_t offset;
+    size_t size;
+    int    user;
+  };
+
+  static working_buffer_claim_t claims[WORKING_BUFFER_MAX_CLAIMS];
+  static int depth = 0;
+  static working_buffer_stats_t stats = {working_buffer_size, 0, 0, 0, 0, 0, {}};
+
+  static int find_user(const char *name) {
+    for(int i = 0; i < stats.user_count; i++) {
+      if(stats.users[i].name == name || strcmp(stats.users[i].name, name) == 0) return i;
+    }
+    if(stats.user_count == WORKING_BUFFER_MAX_USERS) return -1;
+    stats.users[stats.user_count] = {name, 0, 0};
+    return stats.user_count++;
+  }
+
+  static void record(int claim, size_t bytes) {
+    working_buffer_claim_t &c = claims[claim];
+    stats.high_water = std::max(stats.high_water, c.offset + bytes);
+    if(c.user >= 0) {
+      working_buffer_user_t &u = stats.users[c.user];
+      u.high_water = std::max(u.high_water, bytes);
+    }
+  }
+
+  int working_buffer_claim(const char *name, size_t size, bool rest) {
+    size_t offset = depth ? claims[depth - 1].offset + claims[depth - 1].size : 0;
+    offset = (offset + WORKING_BUFFER_ALIGN - 1) & ~size_t(WORKING_BUFFER_ALIGN - 1);
+
+    int user = find_user(name);
+    if(user >= 0) stats.users[user].claims++;
+
+    if(depth == WORKING_BUFFER_MAX_CLAIMS || offset > working_buffer_size || working_buffer_size - offset < size) {
+      stats.failures++;
+      return -1;
+    }
+
+    int claim = depth++;
+    claims[claim] = {offset, rest ? working_buffer_size - offset : size, user};
+    stats.depth = depth;
+    stats.used = claims[claim].offset + claims[claim].size;
+    if(!rest) record(claim, size);
+    return claim;
+  }
+
+  void working_buffer_release(int claim) {
+    // anything claimed later would overlap whatever reuses this space
+    assert(claim == depth - 1 && "working buffer claims must be released last first");
+    depth = claim;
+    stats.depth = depth;
+    stats.used = depth ? claims[depth - 1].offset + claims[depth - 1].size : 0;
+  }
+
+  char *working_buffer_data(int claim) {
+    return &PicoVector_working_buffer[claims[claim].offset];
+  }
+
+  size_t working_buffer_claimed(int claim) {
+    return claims[claim].size;
+  }
+
+  void working_buffer_used(int claim, size_t bytes) {
+    assert(bytes <= claims[claim].size && "used more of the working buffer than was claimed");
+    record(claim, bytes);
+  }
+
+  void working_buffer_stats(working_buffer_stats_t *result) {
+    *result = stats;
+  }
+
+  void working_buffer_reset_stats() {
+    // names stay, they're still attached to the claims being held
+    stats.high_water = stats.used;
+    stats.failures = 0;
+    for(int i = 0; i < stats.user_count; i++) {
+      stats.users[i].claims = 0;
+      stats.users[i].high_water = 0;
+    }
+  }
+
+}
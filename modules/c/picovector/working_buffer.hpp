@@ -0,0 +1,71 @@
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+
+#include "picovector.hpp"
+
+namespace picovector {
+
+  // PicoVector_working_buffer is handed out as named claims that stack: a
+  // claim takes the next aligned bytes above those still held and claims
+  // are released last first, so nested users never overlap. claims are
+  // only made from core0, core1 has scratch of its own
+  #define WORKING_BUFFER_MAX_CLAIMS 8
+  #define WORKING_BUFFER_MAX_USERS 8
+  #define WORKING_BUFFER_ALIGN 8
+
+  struct working_buffer_user_t {
+    const char *name;       // the name claims are made under, a literal
+    uint32_t    claims;     // claims made under it
+    size_t      high_water; // most of a claim it's used
+  };
+
+  struct working_buffer_stats_t {
+    size_t   size;          // bytes in the buffer
+    size_t   used;          // bytes claimed now
+    size_t   high_water;    // furthest into the buffer anything has reached
+    int      depth;         // claims held now
+    uint32_t failures;      // claims refused for lack of room
+    int      user_count;
+    working_buffer_user_t users[WORKING_BUFFER_MAX_USERS];
+  };
+
+  // claims size bytes, or with rest everything left provided that's at
+  // least size. returns the claim or -1 if there's no room for it
+  int working_buffer_claim(const char *name, size_t size, bool rest = false);
+  void working_buffer_release(int claim);
+  char *working_buffer_data(int claim);
+  size_t working_buffer_claimed(int claim);
+
+  // reports how much of a claim was touched, claims taking the rest of the
+  // buffer only count what they report towards the high water marks
+  void working_buffer_used(int claim, size_t bytes);
+
+  void working_buffer_stats(working_buffer_stats_t *stats);
+  void working_buffer_reset_stats();
+
+  // a claim held for the lifetime of the scope
+  class working_buffer_scope_t {
+  public:
+    working_buffer_scope_t(const char *name, size_t size, bool rest = false) {
+      _claim = working_buffer_claim(name, size, rest);
+    }
+
+    ~working_buffer_scope_t() {
+      if(_claim >= 0) working_buffer_release(_claim);
+    }
+
+    working_buffer_scope_t(const working_buffer_scope_t &) = delete;
+    working_buffer_scope_t &operator=(const working_buffer_scope_t &) = delete;
+
+    bool ok() const {return _claim >= 0;}
+    char *data() const {return _claim >= 0 ? working_buffer_data(_claim) : nullptr;}
+    size_t size() const {return _claim >= 0 ? working_buffer_claimed(_claim) : 0;}
+    void used(size_t bytes) {if(_claim >= 0) working_buffer_used(_claim, bytes);}
+
+  private:
+    int _claim;
+  };
+
+}
@@ -186,6 +186,48 @@ mp_obj_t _sleep_goto_dormant_for(mp_obj_t time_seconds_in) {
 }
 static MP_DEFINE_CONST_FUN_OBJ_1(_sleep_goto_dormant_for_obj, _sleep_goto_dormant_for);
 
+/*! \brief Start averaging the battery, reference and light sensor in the background
+ *
+ * \param rate_hz samples per second of each, 245 to 100000, default 1000
+ *
+ * The ADC belongs to the sampler until sense_stop(), machine.ADC reads
+ * made while it runs aren't valid.
+ */
+mp_obj_t _sense_start(size_t n_args, const mp_obj_t *args) {
+    uint32_t rate_hz = n_args > 0 ? mp_obj_get_int(args[0]) : 1000;
+    if(rate_hz < SENSE_MIN_RATE_HZ || rate_hz > SENSE_MAX_RATE_HZ) {
+        mp_raise_ValueError(MP_ERROR_TEXT("rate_hz out of range"));
+    }
+    sense_start(rate_hz);
+    return mp_const_none;
+}
+static MP_DEFINE_CONST_FUN_OBJ_VAR_BETWEEN(_sense_start_obj, 0, 1, _sense_start);
+
+mp_obj_t _sense_stop(void) {
+    sense_stop();
+    return mp_const_none;
+}
+static MP_DEFINE_CONST_FUN_OBJ_0(_sense_stop_obj, _sense_stop);
+
+/*! \brief The latest filtered (vbat, vref, light) readings in read_u16() units
+ *
+ * Starts the sampler if it isn't running, the very first read waits for a
+ * block of samples (32ms at the default rate).
+ */
+mp_obj_t _sense_read(void) {
+    if(!sense_running()) {
+        sense_start(1000);
+    }
+    float values[SENSE_CHANNELS];
+    sense_read(values);
+    mp_obj_t items[SENSE_CHANNELS];
+    for(int c = 0; c < SENSE_CHANNELS; c++) {
+        items[c] = mp_obj_new_float(values[c]);
+    }
+    return mp_obj_new_tuple(SENSE_CHANNELS, items);
+}
+static MP_DEFINE_CONST_FUN_OBJ_0(_sense_read_obj, _sense_read);
+
 static mp_obj_t _test_psram_cs() {
     return mp_obj_new_bool(psram_cs1_pullup_check());
 }
@@ -200,6 +242,9 @@ static const mp_map_elem_t sleep_globals_table[] = {
     { MP_ROM_QSTR(MP_QSTR_get_wake_buttons), MP_ROM_PTR(&_sleep_get_wake_buttons_obj) },
     { MP_ROM_QSTR(MP_QSTR_shipping_mode), MP_ROM_PTR(&_shipping_mode_obj) },
     { MP_ROM_QSTR(MP_QSTR__test_psram_cs), MP_ROM_PTR(&_test_psram_cs_obj) },
+    { MP_ROM_QSTR(MP_QSTR_sense_start), MP_ROM_PTR(&_sense_start_obj) },
+    { MP_ROM_QSTR(MP_QSTR_sense_stop), MP_ROM_PTR(&_sense_stop_obj) },
+    { MP_ROM_QSTR(MP_QSTR_sense), MP_ROM_PTR(&_sense_read_obj) },
 
     { MP_ROM_QSTR(MP_QSTR_WAKE_BUTTON_A), MP_ROM_INT(WAKE_BUTTON_A) },
     { MP_ROM_QSTR(MP_QSTR_WAKE_BUTTON_B), MP_ROM_INT(WAKE_BUTTON_B) },
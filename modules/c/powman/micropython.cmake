@@ -4,13 +4,14 @@ target_sources(usermod_sleep INTERFACE
     ${CMAKE_CURRENT_LIST_DIR}/bindings.c
     ${CMAKE_CURRENT_LIST_DIR}/powman.c
     ${CMAKE_CURRENT_LIST_DIR}/rosc.c
+    ${CMAKE_CURRENT_LIST_DIR}/sense.c
 )
 
 target_include_directories(usermod_sleep INTERFACE
     ${CMAKE_CURRENT_LIST_DIR}
 )
 
-target_link_libraries(usermod_sleep INTERFACE hardware_powman hardware_gpio)
+target_link_libraries(usermod_sleep INTERFACE hardware_powman hardware_gpio hardware_adc hardware_dma)
 
 target_link_libraries(usermod INTERFACE usermod_sleep)
 
@@ -53,6 +53,23 @@ bool powman_wake_watchdog(void);
 
 bool psram_cs1_pullup_check(void);
 
+// background averaged sampling of the battery, 1.1v reference and light
+// sensor, see sense.c. values are in read_u16() units in SENSE_* order
+#define SENSE_VBAT 0
+#define SENSE_1V1 1
+#define SENSE_LIGHT 2
+#define SENSE_CHANNELS 3
+
+// rate_hz limits per channel, below the minimum the adc clock divider's 16
+// bit integer part can't stretch the rounds out far enough
+#define SENSE_MIN_RATE_HZ 245
+#define SENSE_MAX_RATE_HZ 100000
+
+void sense_start(uint32_t rate_hz);
+void sense_stop(void);
+bool sense_running(void);
+bool sense_read(float *values);
+
 void powman_init();
 int powman_setup_gpio_wakeup(int hw_wakeup, int gpio, bool edge, bool high, uint64_t timeout_ms);
 int powman_off(void);
\ No newline at end of file
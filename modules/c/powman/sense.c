@@ -0,0 +1,148 @@
+#include "pico/stdlib.h"
+#include "hardware/adc.h"
+#include "hardware/dma.h"
+#include "hardware/irq.h"
+#include "hardware/sync.h"
+#include "powman.h"
+
+// the adc steps round robin through the battery, 1.1v reference and light
+// sensor inputs, dma copies each block of samples out of the fifo and its
+// completion irq restarts it into the other half of the buffer before
+// averaging the block it just finished into the filtered values
+
+#define SENSE_BLOCK 32          // samples per channel in each block
+#define SENSE_DMA_IRQ_INDEX 1   // DMA_IRQ_1, shared with anything else using it
+
+static const uint sense_gpios[SENSE_CHANNELS] = {BW_VBAT_SENSE, BW_SENSE_1V1, BW_LIGHT_SENSE};
+
+static uint16_t sense_buffer[2][SENSE_BLOCK * SENSE_CHANNELS];
+static int sense_dma = -1;
+static int sense_half = 0;
+
+// read_u16() scale, 12-bit samples << 4, with 8 fractional bits
+static volatile int32_t sense_filtered[SENSE_CHANNELS];
+static volatile uint32_t sense_blocks = 0;
+
+static void __not_in_flash_func(sense_dma_handler)(void) {
+    if(sense_dma < 0 || !dma_irqn_get_channel_status(SENSE_DMA_IRQ_INDEX, sense_dma)) {
+        return;
+    }
+    dma_irqn_acknowledge_channel(SENSE_DMA_IRQ_INDEX, sense_dma);
+
+    // if the fifo over or underflowed the samples no longer line up with
+    // the channels, throw the block away and restart the round from the
+    // first input
+    if(adc_hw->fcs & (ADC_FCS_OVER_BITS | ADC_FCS_UNDER_BITS)) {
+        adc_run(false);
+        dma_channel_abort(sense_dma);
+        dma_irqn_acknowledge_channel(SENSE_DMA_IRQ_INDEX, sense_dma);
+        adc_fifo_drain();
+        hw_set_bits(&adc_hw->fcs, ADC_FCS_OVER_BITS | ADC_FCS_UNDER_BITS);
+        adc_select_input(sense_gpios[0] - ADC_BASE_PIN);
+        dma_channel_set_write_addr(sense_dma, sense_buffer[sense_half], true);
+        adc_run(true);
+        return;
+    }
+
+    // the fifo holds the samples that arrive in the meantime, the channel
+    // order is kept since every block is a whole number of rounds
+    const uint16_t *done = sense_buffer[sense_half];
+    sense_half ^= 1;
+    dma_channel_set_write_addr(sense_dma, sense_buffer[sense_half], true);
+
+    uint32_t sum[SENSE_CHANNELS] = {0};
+    for(int i = 0; i < SENSE_BLOCK * SENSE_CHANNELS; i += SENSE_CHANNELS) {
+        for(int c = 0; c < SENSE_CHANNELS; c++) {
+            sum[c] += done[i + c];
+        }
+    }
+
+    for(int c = 0; c < SENSE_CHANNELS; c++) {
+        int32_t mean = (int32_t)((sum[c] << (4 + 8)) / SENSE_BLOCK);
+        // the first block stands as it is, after that each moves the value
+        // a quarter of the way towards it
+        sense_filtered[c] = sense_blocks ? sense_filtered[c] + ((mean - sense_filtered[c]) >> 2) : mean;
+    }
+    sense_blocks++;
+}
+
+bool sense_running(void) {
+    return sense_dma >= 0;
+}
+
+void sense_start(uint32_t rate_hz) {
+    sense_stop();
+
+    adc_init();
+    for(int c = 0; c < SENSE_CHANNELS; c++) {
+        adc_gpio_init(sense_gpios[c]);
+    }
+
+    // the inputs are converted in ascending order from the first, which the
+    // order of sense_gpios matches
+    adc_select_input(sense_gpios[0] - ADC_BASE_PIN);
+    uint32_t mask = 0;
+    for(int c = 0; c < SENSE_CHANNELS; c++) {
+        mask |= 1u << (sense_gpios[c] - ADC_BASE_PIN);
+    }
+    adc_set_round_robin(mask);
+    adc_fifo_setup(true, true, 1, false, false);
+
+    // rate_hz per channel, the adc clock is 48MHz. the divider's integer
+    // part is 16 bits so slower rates are pinned to the slowest it can do
+    float div = 48000000.0f / (float)(rate_hz * SENSE_CHANNELS) - 1.0f;
+    adc_set_clkdiv(div < 0.0f ? 0.0f : (div > 65535.0f ? 65535.0f : div));
+
+    sense_dma = dma_claim_unused_channel(true);
+    dma_channel_config config = dma_channel_get_default_config(sense_dma);
+    channel_config_set_transfer_data_size(&config, DMA_SIZE_16);
+    channel_config_set_read_increment(&config, false);
+    channel_config_set_write_increment(&config, true);
+    channel_config_set_dreq(&config, DREQ_ADC);
+
+    sense_half = 0;
+    sense_blocks = 0;
+    dma_irqn_set_channel_enabled(SENSE_DMA_IRQ_INDEX, sense_dma, true);
+    irq_add_shared_handler(DMA_IRQ_0 + SENSE_DMA_IRQ_INDEX, sense_dma_handler, PICO_SHARED_IRQ_HANDLER_DEFAULT_ORDER_PRIORITY);
+    irq_set_enabled(DMA_IRQ_0 + SENSE_DMA_IRQ_INDEX, true);
+
+    dma_channel_configure(sense_dma, &config, sense_buffer[0], &adc_hw->fifo, SENSE_BLOCK * SENSE_CHANNELS, true);
+
+    adc_fifo_drain();
+    adc_run(true);
+}
+
+void sense_stop(void) {
+    if(sense_dma < 0) {
+        return;
+    }
+
+    adc_run(false);
+    dma_irqn_set_channel_enabled(SENSE_DMA_IRQ_INDEX, sense_dma, false);
+    dma_channel_abort(sense_dma);
+    dma_irqn_acknowledge_channel(SENSE_DMA_IRQ_INDEX, sense_dma);
+    irq_remove_handler(DMA_IRQ_0 + SENSE_DMA_IRQ_INDEX, sense_dma_handler);
+    dma_channel_unclaim(sense_dma);
+    sense_dma = -1;
+
+    // leave the adc as machine.ADC expects to find it
+    adc_set_round_robin(0);
+    adc_fifo_setup(false, false, 0, false, false);
+    adc_fifo_drain();
+    adc_set_clkdiv(0.0f);
+}
+
+bool sense_read(float *values) {
+    // the first block lands SENSE_BLOCK rounds after starting, only wait if
+    // it hasn't yet
+    while(sense_dma >= 0 && sense_blocks == 0) {
+        __wfe();
+    }
+    if(sense_dma < 0) {
+        return false;
+    }
+    for(int c = 0; c < SENSE_CHANNELS; c++) {
+        values[c] = (float)sense_filtered[c] / 256.0f;
+    }
+    return true;
+}
@@ -12,6 +12,6 @@ pico_generate_pio_header(st7789 ${CMAKE_CURRENT_LIST_DIR}/st7789_parallel.pio)
 target_include_directories(st7789 INTERFACE ${CMAKE_CURRENT_LIST_DIR})
 
 # Pull in pico libraries that we need
-target_link_libraries(st7789 INTERFACE pico_stdlib hardware_pwm hardware_pio hardware_dma)
+target_link_libraries(st7789 INTERFACE pico_stdlib pico_multicore hardware_pwm hardware_pio hardware_dma)
 
 target_link_libraries(usermod INTERFACE st7789)
\ No newline at end of file
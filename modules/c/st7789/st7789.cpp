@@ -1,4 +1,5 @@
 #include "st7789.hpp"
+#include "profile.hpp"
 
 
 namespace pimoroni {
@@ -6,6 +7,12 @@ namespace pimoroni {
   uint32_t __attribute__((section(".uninitialized_data"))) __attribute__ ((aligned (4))) framebuffer[320 * 240];
   uint16_t __attribute__((section(".uninitialized_data"))) __attribute__ ((aligned (4))) linebuffer[240 * 4];
 
+  ST7789 *ST7789::core1_display = nullptr;
+
+  static inline __attribute__((always_inline)) uint16_t rgba8888_to_rgb565(uint32_t c) {
+    return ((c & 0xf8) << 8) | ((c & 0xfc00) >> 5) | ((c & 0xf80000) >> 19);
+  }
+
   // If we configure MicroPython's main.c to skip the first 320 * 240 * sizeof(uint32_t)
   // bytes we can steal this as a backbuffer.
   // auto backbuffer = new((uintptr_t *)XIP_PSRAM_CACHED) uint32_t[320 * 240];
@@ -54,7 +61,14 @@ namespace pimoroni {
     PWMFRSEL  = 0xCC
   };
 
-  void ST7789::init() {
+  // marks the panel as asleep with its registers and ram intact, powman
+  // scratch registers survive powman_off() but not a power cycle
+  static const uint PANEL_SCRATCH = 7;
+  static const uint32_t PANEL_ASLEEP = 0x57789510;
+
+  void ST7789::init(const uint16_t *splash) {
+    source = framebuffer;
+
     gpio_set_function(dc, GPIO_FUNC_SIO);
     gpio_set_dir(dc, GPIO_OUT);
 
@@ -69,10 +83,77 @@ namespace pimoroni {
     gpio_set_function(bl, GPIO_FUNC_PWM);
     set_backlight(0); // Turn backlight off initially to avoid nasty surprises
 
-    command(reg::SWRESET);
+    init_warm = powman_hw->scratch[PANEL_SCRATCH] == PANEL_ASLEEP;
+    powman_hw->scratch[PANEL_SCRATCH] = 0;
+
+    // the panel needs time after waking or resetting before it takes the
+    // rest of its setup, rather than sleeping through it here finish_init()
+    // picks up from the first call that needs the panel and python carries
+    // on starting up in the meantime
+    if(init_warm) {
+      // the panel kept its configuration and last frame through sleep-in,
+      // it only needs waking. commands are accepted 5ms after SLPOUT
+      command(reg::SLPOUT);
+      init_ready_us = time_us_32() + 5000;
+    } else {
+      command(reg::SWRESET);
+      init_ready_us = time_us_32() + 150000;
+    }
+    init_pending = true;
+
+    // a splash is meant to be the first thing shown and only lives as long
+    // as the caller's buffer, send it now
+    if(splash) {
+      finish_init(splash);
+    }
+  }
 
-    sleep_ms(150);
+  void ST7789::finish_init(const uint16_t *splash) {
+    if(!init_pending) {
+      return;
+    }
+    init_pending = false;
+
+    int32_t remaining_us = int32_t(init_ready_us - time_us_32());
+    if(remaining_us > 0) {
+      sleep_us(remaining_us);
+    }
 
+    if(!init_warm) {
+      cold_init();
+    }
+
+    set_orientation();
+
+    if(splash) {
+      send_splash(splash);
+    } else if(!init_warm) {
+      // Set up the screen for a display update
+      uint8_t cmd = reg::RAMWR;
+      gpio_put(dc, 0); // command mode
+      gpio_put(cs, 0);
+      write_blocking(&cmd, 1);
+      gpio_put(dc, 1); // data mode
+
+      // Temporarily reconfigure the DMA with no read increment so we can
+      // clock out just one zero (no need to memset) to clear the whole display.
+      linebuffer[0] = 0;
+      configure_dma(false);
+      write_blocking((uint8_t *)linebuffer, fullres_width * fullres_height * sizeof(uint16_t)); // Clear display to black
+      configure_dma(true);
+    }
+
+    invalidate();
+
+    command(reg::TEON, 1, "\x00");  // enable frame sync signal
+    command(reg::STE, 2, "\x00\x00");
+    command(reg::DISPON);  // turn display on
+    set_backlight(230); // Turn backlight on now surprises have passed, 180 = about half perceptual brightness
+  }
+
+  // register setup after a reset, only needed when the panel has lost power.
+  // init() sends SWRESET and finish_init() waits out the 150ms it needs
+  void ST7789::cold_init() {
     // Common init
     command(reg::COLMOD,    1, "\x05");  // 16 bits per pixel
 
@@ -102,7 +183,9 @@ namespace pimoroni {
     command(reg::SLPOUT);  // leave sleep mode
 
     sleep_ms(100);
+  }
 
+  void ST7789::set_orientation() {
     uint8_t madctl = MADCTL::ROW_ORDER; //MADCTL::ROW_ORDER | MADCTL::SWAP_XY | MADCTL::SCAN_ORDER;
     uint16_t caset[2] = {0, 239};
     uint16_t raset[2] = {0, 319};
@@ -116,25 +199,39 @@ namespace pimoroni {
     command(reg::CASET,  4, (char *)caset);
     command(reg::RASET,  4, (char *)raset);
     command(reg::MADCTL, 1, (char *)&madctl);
+  }
+
+  // sends a 320x240 row-major rgb565 image, usually straight out of flash,
+  // as the first thing shown after init
+  void ST7789::send_splash(const uint16_t *splash) {
+    uint8_t madctl = MADCTL::COL_ORDER | MADCTL::SWAP_XY;
+    command(reg::MADCTL, 1, (char *)&madctl);
+    set_window(0, 0, fullres_width, fullres_height);
 
-    // Set up the screen for a display update
     uint8_t cmd = reg::RAMWR;
     gpio_put(dc, 0); // command mode
     gpio_put(cs, 0);
     write_blocking(&cmd, 1);
     gpio_put(dc, 1); // data mode
 
-    // Temporarily reconfigure the DMA with no read increment so we can
-    // clock out just one zero (no need to memset) to clear the whole display.
-    linebuffer[0] = 0;
-    configure_dma(false);
-    write_blocking((uint8_t *)linebuffer, fullres_width * fullres_height * sizeof(uint16_t)); // Clear display to black
-    configure_dma(true);
+    configure_dma(true, true);
+    write_blocking((const uint8_t *)splash, fullres_width * fullres_height);
+    gpio_put(cs, 1);
 
-    command(reg::TEON, 1, "\x00");  // enable frame sync signal
-    command(reg::STE, 2, "\x00\x00");
-    command(reg::DISPON);  // turn display on
-    set_backlight(230); // Turn backlight on now surprises have passed, 180 = about half perceptual brightness
+    set_orientation();
+  }
+
+  // puts the panel into sleep-in, which keeps its registers and the last
+  // frame, so that the next init can skip the reset and clear
+  void ST7789::sleep() {
+    wait();
+    finish_init();
+    set_backlight(0);
+    command(reg::SLPIN);
+    invalidate();
+    // the panel needs 5ms after SLPIN before its supply can go away
+    sleep_ms(5);
+    powman_hw->scratch[PANEL_SCRATCH] = PANEL_ASLEEP;
   }
 
   uint32_t *ST7789::get_framebuffer() {
@@ -148,28 +245,53 @@ namespace pimoroni {
         ;
   }
 
-  inline void ST7789::wait_for_dma(void) {
+  inline void __not_in_flash_func(ST7789::wait_for_dma)(void) {
+    uint32_t start_us = time_us_32();
+
     dma_channel_wait_for_finish_blocking(st_dma);
 
     // Prevent a race between PIO and chip-select or data/command
     // What's up with pio_sm_is_exec_stalled?
     pio_sm_block_until_stalled(parallel_pio, parallel_sm);
+
+    frame_stats.dma_wait_us += time_us_32() - start_us;
+  }
+
+  // counts what goes out on the bus, the doubling program sends every
+  // pixel twice
+  inline void __not_in_flash_func(ST7789::count_bytes)(size_t len) {
+    frame_stats.bytes += len * (dma_wide ? 2 : 1) * (pixel_doubling ? 2 : 1);
   }
 
-  void ST7789::write_blocking(const uint8_t *src, size_t len) {
+  void __not_in_flash_func(ST7789::write_blocking)(const uint8_t *src, size_t len) {
+    count_bytes(len);
     dma_channel_set_trans_count(st_dma, len, false);
     dma_channel_set_read_addr(st_dma, src, true);
     wait_for_dma();
   }
 
-  void ST7789::start_dma(const uint8_t *src, size_t len) {
+  // waits for any transfer in flight, then starts the next one
+  void __not_in_flash_func(ST7789::start_dma)(const uint8_t *src, size_t len) {
+    uint32_t start_us = time_us_32();
+    dma_channel_wait_for_finish_blocking(st_dma);
+    frame_stats.dma_wait_us += time_us_32() - start_us;
+
+    count_bytes(len);
     dma_channel_set_trans_count(st_dma, len, false);
     dma_channel_set_read_addr(st_dma, src, true);
   }
 
-  void ST7789::command(uint8_t command, size_t len, const char *data) {
+  void __not_in_flash_func(ST7789::command)(uint8_t command, size_t len, const char *data) {
     wait_for_dma();
 
+    // commands are always sent a byte at a time
+    if(pixel_doubling) {
+      set_pixel_doubling(false);
+    }
+    if(dma_wide) {
+      configure_dma(true, false);
+    }
+
     gpio_put(dc, 0); // command mode
 
     gpio_put(cs, 0);
@@ -183,67 +305,683 @@ namespace pimoroni {
     gpio_put(cs, 1);
   }
 
+  // set the panel ram window, x/y are panel ram addresses (CASET/RASET)
+  void __not_in_flash_func(ST7789::set_window)(uint16_t x, uint16_t y, uint16_t w, uint16_t h) {
+    uint16_t caset[2] = {__builtin_bswap16(x), __builtin_bswap16(uint16_t(x + w - 1))};
+    uint16_t raset[2] = {__builtin_bswap16(y), __builtin_bswap16(uint16_t(y + h - 1))};
+    command(reg::CASET, 4, (char *)caset);
+    command(reg::RASET, 4, (char *)raset);
+  }
+
   void ST7789::update(bool fullres) {
-    // Determine clock divider
+    region_t full = {0, 0, fullres ? fullres_width : width, fullres ? fullres_height : height};
+    update(fullres, &full, 1);
+  }
+
+  // update rectangles of the framebuffer, coordinates are in framebuffer
+  // space so in lores mode they are 160x120 and scaled up for the panel
+  void ST7789::update(bool fullres, const region_t *regions, int count) {
+    wait();
+    finish_init();
+    update_clock();
+    present(source, fullres, regions, count);
+  }
+
+  void ST7789::update_async(bool fullres) {
+    region_t full = {0, 0, fullres ? fullres_width : width, fullres ? fullres_height : height};
+    update_async(fullres, &full, 1);
+  }
+
+  // hand the frame off to core1 and return immediately, the framebuffer must
+  // not be drawn into until wait() returns or busy() is false
+  void ST7789::update_async(bool fullres, const region_t *regions, int count) {
+    wait();
+    finish_init();
+    update_clock();
+
+    // core1 is busy with a long task (a background image load), rather than
+    // queue the frame behind it send it from here
+    if(task_busy) {
+      present(source, fullres, regions, count);
+      return;
+    }
+
+    launch_core1();
+
+    async_source = source;
+    async_fullres = fullres;
+    if(count <= MAX_ASYNC_REGIONS) {
+      for(int i = 0; i < count; i++) {
+        async_regions[i] = regions[i];
+      }
+      async_region_count = count;
+    } else {
+      // too many to queue, send their bounding box instead
+      int x1 = regions[0].x, y1 = regions[0].y;
+      int x2 = x1 + regions[0].w, y2 = y1 + regions[0].h;
+      for(int i = 1; i < count; i++) {
+        x1 = std::min(x1, regions[i].x);
+        y1 = std::min(y1, regions[i].y);
+        x2 = std::max(x2, regions[i].x + regions[i].w);
+        y2 = std::max(y2, regions[i].y + regions[i].h);
+      }
+      async_regions[0] = {x1, y1, x2 - x1, y2 - y1};
+      async_region_count = 1;
+    }
+    async_busy = true;
+    __dmb();
+    async_pending = true;
+    __sev();
+  }
+
+  // runs on either core
+  void __not_in_flash_func(ST7789::present)(const void *buffer, bool fullres, const region_t *regions, int count) {
+    wait_vsync();
+
+    frame_stats.dma_wait_us = 0;
+    frame_stats.bytes = 0;
+    uint32_t start_us = time_us_32();
+
+    // a whole frame only sends the bands that changed, and nothing at all
+    // if none did. anything less than the whole frame leaves the panel
+    // showing a mix the crcs can't describe, so they're forgotten
+    int fb_width = fullres ? fullres_width : width;
+    int fb_height = fullres ? fullres_height : height;
+    region_t changed[CHANGE_BANDS];
+    bool whole = count == 1 && regions[0].x <= 0 && regions[0].y <= 0 &&
+      regions[0].x + regions[0].w >= fb_width && regions[0].y + regions[0].h >= fb_height;
+    if(whole && skip_unchanged && sniff_dma >= 0) {
+      count = changed_bands(buffer, fullres, changed);
+      regions = changed;
+      if(count == 0) {
+        frame_stats.convert_us = time_us_32() - start_us;
+        frame_stats.skipped++;
+        stats = frame_stats;
+        return;
+      }
+    } else if(!whole) {
+      bands_valid = false;
+    }
+
+    picovector::profile_scope_t profile(picovector::PROFILE_PRESENT);
+    for(int i = 0; i < count; i++) {
+      profile.pixels(regions[i].w * regions[i].h);
+    }
+
+    for(int i = 0; i < count; i++) {
+      update_region(buffer, fullres, regions[i].x, regions[i].y, regions[i].w, regions[i].h);
+    }
+
+    // a source outside sram is in psram, which goes away while flash is
+    // written. the last transfer can't be left reading it after we return
+    if((uintptr_t)buffer < SRAM_BASE || (uintptr_t)buffer >= SRAM_END) {
+      uint32_t wait_us = time_us_32();
+      dma_channel_wait_for_finish_blocking(st_dma);
+      frame_stats.dma_wait_us += time_us_32() - wait_us;
+    }
+
+    // whatever wasn't spent blocked on the bus went on converting pixels
+    uint32_t total_us = time_us_32() - start_us;
+    frame_stats.convert_us = total_us - std::min(total_us, frame_stats.dma_wait_us);
+    frame_stats.frames++;
+    stats = frame_stats;
+  }
+
+  // crcs each band of the framebuffer with the sniffer on a dma channel of
+  // its own that reads the band into a single word, much quicker than the
+  // cpu and it leaves the other core alone. bands that differ from the last
+  // frame are merged into runs and written to changed, returns how many
+  int __not_in_flash_func(ST7789::changed_bands)(const void *buffer, bool fullres, region_t *changed) {
+    int fb_width = fullres ? fullres_width : width;
+    int fb_height = fullres ? fullres_height : height;
+    int bytes_per_pixel = pixel_format == RGBA8888 ? 4 : pixel_format == RGB565 ? 2 : 1;
+    int band_h = fb_height / CHANGE_BANDS;
+    uint32_t band_words = band_h * fb_width * bytes_per_pixel / 4;
+
+    // a different resolution shares nothing with what the panel shows
+    bool compare = bands_valid && bands_fullres == fullres;
+
+    static uint32_t sink;
+    dma_channel_config c = dma_channel_get_default_config(sniff_dma);
+    channel_config_set_transfer_data_size(&c, DMA_SIZE_32);
+    channel_config_set_read_increment(&c, true);
+    channel_config_set_write_increment(&c, false);
+    channel_config_set_sniff_enable(&c, true);
+    dma_sniffer_enable(sniff_dma, DMA_SNIFF_CTRL_CALC_VALUE_CRC32, true);
+
+    int count = 0;
+    const uint8_t *band = (const uint8_t *)buffer;
+    for(int i = 0; i < CHANGE_BANDS; i++) {
+      dma_sniffer_set_data_accumulator(0xffffffff);
+      dma_channel_configure(sniff_dma, &c, &sink, band, band_words, true);
+      dma_channel_wait_for_finish_blocking(sniff_dma);
+      uint32_t crc = dma_sniffer_get_data_accumulator();
+      band += band_words * 4;
+
+      if(compare && crc == band_crc[i]) {
+        continue;
+      }
+      band_crc[i] = crc;
+
+      // extend the run if the band above was sent too
+      if(count > 0 && changed[count - 1].y + changed[count - 1].h == i * band_h) {
+        changed[count - 1].h += band_h;
+      } else {
+        changed[count++] = {0, i * band_h, fb_width, band_h};
+      }
+    }
+
+    dma_sniffer_disable();
+    bands_valid = true;
+    bands_fullres = fullres;
+    return count;
+  }
+
+  // full frame updates skip bands, and whole frames, that haven't changed
+  // since they were last sent. on by default
+  void ST7789::set_skip_unchanged(bool enable) {
+    wait();
+    skip_unchanged = enable;
+    bands_valid = false;
+  }
+
+  bool ST7789::get_skip_unchanged() {
+    return skip_unchanged;
+  }
+
+  // forgets what the panel is showing so the next update is sent in full,
+  // for anything that changes the panel without going through an update
+  void ST7789::invalidate() {
+    bands_valid = false;
+  }
+
+  // sets the buffer that following updates scan out from, nullptr selects
+  // the built in sram framebuffer. a frame already queued on core1 keeps the
+  // buffer it was queued with
+  void ST7789::set_source(const void *buffer) {
+    source = buffer ? buffer : framebuffer;
+  }
+
+  const void *ST7789::get_source() {
+    return source;
+  }
+
+  // rising edges on the te pin are counted by a raw gpio irq, ahead of
+  // micropython's own pin irq handler as the buttons are. waiting for the
+  // count to change lets whichever core presents sleep in __wfe()
+  static volatile uint32_t te_edges = 0;
+  static int te_irq_pin = -1;
+
+  static void __not_in_flash_func(te_irq_handler)(void) {
+    if(te_irq_pin < 0) return;
+    if(gpio_get_irq_event_mask(te_irq_pin) & GPIO_IRQ_EDGE_RISE) {
+      gpio_acknowledge_irq(te_irq_pin, GPIO_IRQ_EDGE_RISE);
+      te_edges++;
+      __sev();
+    }
+  }
+
+  // divider locks presentation to 60 / divider hz, 0 disables pacing
+  void ST7789::set_vsync(uint divider, int te_pin) {
+    wait();
+
+    if(this->te_pin >= 0) {
+      gpio_set_irq_enabled(this->te_pin, GPIO_IRQ_EDGE_RISE, false);
+      gpio_remove_raw_irq_handler(this->te_pin, te_irq_handler);
+      te_irq_pin = -1;
+      gpio_deinit(this->te_pin);
+    }
+
+    vsync_divider = divider;
+    this->te_pin = te_pin;
+    vsync_frames = 0;
+    vsync_missed = 0;
+    last_present_us = time_us_32();
+
+    if(te_pin >= 0) {
+      gpio_init(te_pin);
+      gpio_set_dir(te_pin, GPIO_IN);
+      te_irq_pin = te_pin;
+      gpio_add_raw_irq_handler_with_order_priority(te_pin, te_irq_handler, PICO_SHARED_IRQ_HANDLER_HIGHEST_ORDER_PRIORITY);
+      gpio_set_irq_enabled(te_pin, GPIO_IRQ_EDGE_RISE, true);
+      irq_set_enabled(IO_IRQ_BANK0, true);
+    }
+  }
+
+  uint32_t ST7789::get_vsync_frames() {
+    return vsync_frames;
+  }
+
+  uint32_t ST7789::get_vsync_missed() {
+    return vsync_missed;
+  }
+
+  void __not_in_flash_func(ST7789::wait_vsync)() {
+    if(!vsync_divider) {
+      return;
+    }
+
+    uint32_t target = last_present_us + frame_period_us * vsync_divider;
+    int32_t late = int32_t(time_us_32() - target);
+
+    if(late > int32_t(frame_period_us / 2)) {
+      // the intended refresh has already gone by
+      vsync_missed += (late + frame_period_us / 2) / frame_period_us;
+    } else if(te_pin >= 0) {
+      // sleep on a timer alarm until we're close to the refresh we're
+      // aiming for, the te edge then picks the exact moment
+      int32_t early_us = int32_t(target - frame_period_us / 2 - time_us_32());
+      if(early_us > 0) {
+        sleep_us(early_us);
+      }
+    }
+
+    if(te_pin >= 0) {
+      // start the transfer right on the tearing effect edge, the panel scan
+      // is always behind us from there. give up after two frames in case the
+      // pin isn't actually wired
+      absolute_time_t timeout = make_timeout_time_us(frame_period_us * 2);
+      uint32_t seen = te_edges;
+      while(te_edges == seen) {
+        if(best_effort_wfe_or_timeout(timeout)) break;
+      }
+    } else {
+      // sleep on a timer alarm until the refresh is due
+      int32_t wait_us = int32_t(target - time_us_32());
+      if(wait_us > 0) {
+        sleep_us(wait_us);
+      }
+    }
+
+    last_present_us = time_us_32();
+    vsync_frames++;
+  }
+
+  void ST7789::launch_core1() {
+    if(!core1_running) {
+      core1_display = this;
+      multicore_reset_core1();
+      multicore_launch_core1(core1_entry);
+      core1_running = true;
+    }
+  }
+
+  bool ST7789::busy() {
+    return async_busy;
+  }
+
+  // lends core1 to other work (picovector renders part of a shape on it),
+  // the task runs once any update in flight has been sent
+  void ST7789::run_task(void (*fn)(void *arg), void *arg) {
+    wait_task();
+    launch_core1();
+
+    task_fn = fn;
+    task_arg = arg;
+    task_busy = true;
+    __dmb();
+    task_pending = true;
+    __sev();
+  }
+
+  void ST7789::wait_task() {
+    while(task_busy) {
+      __wfe();
+    }
+  }
+
+  bool ST7789::task_running() {
+    return task_busy;
+  }
+
+  void ST7789::wait() {
+    while(async_busy) {
+      __wfe();
+    }
+  }
+
+  static irq_handler_t sdk_lockout_handler = nullptr;
+
+  // core1's own loop runs from ram, but tasks and background image loads run
+  // from flash and read it. micropython pauses the other core through the
+  // sdk's multicore lockout before any flash write disables xip, so core1
+  // signs up for that before anything else
+  void __not_in_flash_func(ST7789::core1_entry)() {
+    multicore_lockout_victim_init();
+
+    // interpose on the sdk's lockout handler, see core1_lockout()
+    uint irq = SIO_FIFO_IRQ_NUM(1);
+    sdk_lockout_handler = irq_get_exclusive_handler(irq);
+    irq_remove_handler(irq, sdk_lockout_handler);
+    irq_set_exclusive_handler(irq, core1_lockout);
+
+    core1_display->core1_main();
+  }
+
+  // the lockout stops core1 itself, but dma it started from a psram source
+  // (rgb565 frames go straight out, and the change crcs) would carry on
+  // reading with xip disabled. let that finish before acknowledging
+  void __not_in_flash_func(ST7789::core1_lockout)() {
+    dma_channel_wait_for_finish_blocking(core1_display->st_dma);
+    if(core1_display->sniff_dma >= 0) {
+      dma_channel_wait_for_finish_blocking(core1_display->sniff_dma);
+    }
+    sdk_lockout_handler();
+  }
+
+  // run as a task on core1 before it's reset
+  void ST7789::core1_release(void *arg) {
+    uint irq = SIO_FIFO_IRQ_NUM(1);
+    irq_remove_handler(irq, core1_lockout);
+    irq_set_exclusive_handler(irq, sdk_lockout_handler);
+    multicore_lockout_victim_deinit();
+  }
+
+  void __not_in_flash_func(ST7789::core1_main)() {
+    while(true) {
+      while(!async_pending && !task_pending) {
+        __wfe();
+      }
+
+      if(task_pending) {
+        task_pending = false;
+        __dmb();
+
+        // tasks may run from flash, a flash write on core0 pauses core1
+        // through the lockout until it's done
+        task_fn(task_arg);
+
+        __dmb();
+        task_busy = false;
+        __sev();
+        continue;
+      }
+
+      async_pending = false;
+      __dmb();
+
+      present(async_source, async_fullres, async_regions, async_region_count);
+      wait_for_dma();
+
+      async_busy = false;
+      __sev();
+    }
+  }
+
+  // the pio clock divider has to follow any change in system clock, this uses
+  // flash resident sdk functions so must only be called from core0
+  void ST7789::update_clock() {
     const uint32_t sys_clk_hz = clock_get_hz(clk_sys);
 
     if (sys_clk_hz != startup_hz) {
       startup_hz = sys_clk_hz;
-      pio_sm_set_clkdiv(parallel_pio, parallel_sm, fmax(1.0f, float(sys_clk_hz) / max_pio_clk));
+      float div = fmax(1.0f, float(sys_clk_hz) / max_pio_clk);
+      pio_sm_set_clkdiv(parallel_pio, parallel_sm, div);
+      frame_stats.pio_hz = uint32_t(sys_clk_hz / div);
+    }
+  }
+
+  // counters for the most recently completed update
+  ST7789::stats_t ST7789::get_stats() {
+    stats_t result = stats;
+    result.pio_hz = frame_stats.pio_hz;
+    return result;
+  }
+
+  void __not_in_flash_func(ST7789::update_region)(const void *buffer, bool fullres, int rx, int ry, int rw, int rh) {
+    int fb_width = fullres ? fullres_width : width;
+    int fb_height = fullres ? fullres_height : height;
+
+    // clip the region to the framebuffer
+    if(rx < 0) {rw += rx; rx = 0;}
+    if(ry < 0) {rh += ry; ry = 0;}
+    rw = rw < fb_width - rx ? rw : fb_width - rx;
+    rh = rh < fb_height - ry ? rh : fb_height - ry;
+    if(rw <= 0 || rh <= 0) {
+      return;
     }
 
+    uint32_t start_us = time_us_32();
+
     wait_for_dma();
 
+    if(pixel_format == RGB565) {
+      update_region_rgb565((const uint16_t *)buffer, fullres, rx, ry, rw, rh);
+      update_us[fullres ? RGB565_HIRES : RGB565_LORES] = time_us_32() - start_us;
+      return;
+    }
+
+    if(pixel_format == PAL8) {
+      update_region_pal8((const uint8_t *)buffer, fullres, rx, ry, rw, rh);
+      update_us[fullres ? PAL8_HIRES : PAL8_LORES] = time_us_32() - start_us;
+      return;
+    }
+
+    // the panel is rotated, framebuffer columns are panel rows
+    int scale = fullres ? 1 : 2;
+    set_window(ry * scale, rx * scale, rh * scale, rw * scale);
+
     uint8_t cmd = reg::RAMWR;
     gpio_put(dc, 0); // command mode
     gpio_put(cs, 0);
     write_blocking(&cmd, 1);
     gpio_put(dc, 1); // data mode
 
+    // pixels are sent as 16-bit words so they need no byte swapping
+    configure_dma(true, true);
+
     // Take an "a" and a "b" pointer into the linebuffer, we will swap between
     // these, converting pixels into one while the other is DMA'd to the screen.
     uint16_t *buf_a = linebuffer;
     uint16_t *buf_b = linebuffer + 240 * 2;
 
+    const uint32_t *fb = (const uint32_t *)buffer;
+
     // The copy from framebuffer to linebuffer also serves to rotate the image
     // 90 degrees to match the scan orientation and prevent diagonal tearing.
     if(fullres) {
-      for(int x = 0; x < fullres_width; x++) {
-        for(int y = 0; y < fullres_height; y++) {
-          uint32_t src = framebuffer[y * fullres_width + x];
-          buf_a[y] = __builtin_bswap16(((src & 0xf8) << 8) | ((src & 0xfc00) >> 5) | ((src & 0xf80000) >> 19));
+      for(int x = rx; x < rx + rw; x++) {
+        const uint32_t *src = &fb[ry * fullres_width + x];
+        uint16_t *dst = buf_a;
+        for(int y = 0; y < rh; y++) {
+          *dst++ = rgba8888_to_rgb565(*src);
+          src += fullres_width;
+        }
+        if(transform != TRANSFORM_NONE) {
+          transform_row(buf_a, buf_a, rh);
         }
-        // Transfer a single full res (full 240 pixel height) column
+        // Transfer a single full res column (or the dirty part of it)
         // In full-res we can "chase the beam" as it were, replacing pixels
         // behind the outgoing DMA transfer.
-        wait_for_dma();
-        start_dma((uint8_t *)buf_a, fullres_height * 2);
+        start_dma((uint8_t *)buf_a, rh);
         std::swap(buf_a, buf_b);
       }
     } else {
-      for(int x = 0; x < width; x++) {
-        for(int y = 0; y < height; y++) {
-          uint32_t src = framebuffer[y * width + x];
-          uint16_t pixel = __builtin_bswap16(((src & 0xf8) << 8) | ((src & 0xfc00) >> 5) | ((src & 0xf80000) >> 19));
-          buf_a[y * 2] = pixel;
-          buf_a[y * 2 + 1] = pixel;
-          // It's slightly faster to prepare to rows, rather than prepare
-          // a single row and copy it twice.
-          buf_a[(height + y) * 2] = pixel;
-          buf_a[(height + y) * 2 + 1] = pixel;
+      // each lores column is converted once and sent twice as it's two panel
+      // rows, the pio repeats every pixel to double the row width
+      set_pixel_doubling(true);
+
+      for(int x = rx; x < rx + rw; x++) {
+        const uint32_t *src = &fb[ry * width + x];
+        uint16_t *dst = buf_a;
+        for(int y = 0; y < rh; y++) {
+          *dst++ = rgba8888_to_rgb565(*src);
+          src += width;
+        }
+        if(transform != TRANSFORM_NONE) {
+          transform_row(buf_a, buf_a, rh);
         }
-        wait_for_dma();
-        start_dma((uint8_t *)buf_a, fullres_height * 2 * 2);
+        start_dma((uint8_t *)buf_a, rh);
+        start_dma((uint8_t *)buf_a, rh);
         std::swap(buf_a, buf_b);
       }
     }
 
+    update_us[fullres ? RGBA8888_HIRES : RGBA8888_LORES] = time_us_32() - start_us;
+
     // Yeet the last column into the abyss and save a little time
     // wait_for_dma();
     // gpio_put(cs, 1);
   }
 
+  // rgb565 framebuffers are already in panel format, with the panel axes
+  // swapped the rows can be streamed straight out of the framebuffer
+  void __not_in_flash_func(ST7789::update_region_rgb565)(const uint16_t *fb, bool fullres, int rx, int ry, int rw, int rh) {
+    int scale = fullres ? 1 : 2;
+    set_window(rx * scale, ry * scale, rw * scale, rh * scale);
+
+    uint8_t cmd = reg::RAMWR;
+    gpio_put(dc, 0); // command mode
+    gpio_put(cs, 0);
+    write_blocking(&cmd, 1);
+    gpio_put(dc, 1); // data mode
+
+    configure_dma(true, true);
+
+    if(transform != TRANSFORM_NONE) {
+      // transformed rows can't be sent straight from the framebuffer, they
+      // pass through the linebuffer like the converted formats
+      if(!fullres) {
+        set_pixel_doubling(true);
+      }
+
+      uint16_t *buf_a = linebuffer;
+      uint16_t *buf_b = linebuffer + 240 * 2;
+      int stride = fullres ? fullres_width : width;
+
+      for(int y = ry; y < ry + rh; y++) {
+        transform_row(&fb[y * stride + rx], buf_a, rw);
+        start_dma((uint8_t *)buf_a, rw);
+        if(!fullres) {
+          start_dma((uint8_t *)buf_a, rw);
+        }
+        std::swap(buf_a, buf_b);
+      }
+      return;
+    }
+
+    if(fullres) {
+      if(rw == fullres_width) {
+        // whole rows are contiguous so this is a single transfer
+        start_dma((uint8_t *)&fb[ry * fullres_width], rw * rh);
+      } else {
+        for(int y = ry; y < ry + rh; y++) {
+          start_dma((uint8_t *)&fb[y * fullres_width + rx], rw);
+        }
+      }
+      return;
+    }
+
+    // in lores the pio doubles each pixel and every framebuffer row is sent
+    // twice, so nothing is touched by the cpu at all
+    set_pixel_doubling(true);
+
+    for(int y = ry; y < ry + rh; y++) {
+      const uint16_t *src = &fb[y * width + rx];
+      start_dma((uint8_t *)src, rw);
+      start_dma((uint8_t *)src, rw);
+    }
+  }
+
+  // indexed framebuffers share the rgb565 panel orientation, each row is
+  // expanded through the palette lut into one half of the linebuffer while
+  // the other half is sent
+  void __not_in_flash_func(ST7789::update_region_pal8)(const uint8_t *fb, bool fullres, int rx, int ry, int rw, int rh) {
+    int scale = fullres ? 1 : 2;
+    set_window(rx * scale, ry * scale, rw * scale, rh * scale);
+
+    uint8_t cmd = reg::RAMWR;
+    gpio_put(dc, 0); // command mode
+    gpio_put(cs, 0);
+    write_blocking(&cmd, 1);
+    gpio_put(dc, 1); // data mode
+
+    configure_dma(true, true);
+
+    if(!fullres) {
+      // lores rows are sent twice with the pio doubling each pixel
+      set_pixel_doubling(true);
+    }
+
+    uint16_t *buf_a = linebuffer;
+    uint16_t *buf_b = linebuffer + 240 * 2;
+    int stride = fullres ? fullres_width : width;
+
+    for(int y = ry; y < ry + rh; y++) {
+      const uint8_t *src = &fb[y * stride + rx];
+      uint16_t *dst = buf_a;
+      for(int x = 0; x < rw; x++) {
+        *dst++ = palette_lut[*src++];
+      }
+      start_dma((uint8_t *)buf_a, rw);
+      if(!fullres) {
+        start_dma((uint8_t *)buf_a, rw);
+      }
+      std::swap(buf_a, buf_b);
+    }
+  }
+
+  static inline __attribute__((always_inline)) uint32_t expand5(uint32_t c) {return (c << 3) | (c >> 2);}
+  static inline __attribute__((always_inline)) uint32_t expand6(uint32_t c) {return (c << 2) | (c >> 4);}
+
+  static inline __attribute__((always_inline)) uint32_t clamp8(int32_t c) {
+    return c < 0 ? 0 : c > 255 ? 255 : c;
+  }
+
+  // applies the colour transform to a row of rgb565 pixels, src and dst may
+  // be the same. curves are looked up per 565 channel so a row costs three
+  // loads per pixel, the matrix works on expanded 8-bit channels in 8.8
+  void __not_in_flash_func(ST7789::transform_row)(const uint16_t *src, uint16_t *dst, int count) {
+    if(transform == TRANSFORM_CURVES) {
+      while(count--) {
+        uint32_t p = *src++;
+        *dst++ = curve_r[p >> 11] | curve_g[(p >> 5) & 0x3f] | curve_b[p & 0x1f];
+      }
+      return;
+    }
+
+    const int16_t *m = matrix;
+    while(count--) {
+      uint32_t p = *src++;
+      int32_t r = expand5(p >> 11);
+      int32_t g = expand6((p >> 5) & 0x3f);
+      int32_t b = expand5(p & 0x1f);
+      uint32_t tr = clamp8((m[0] * r + m[1] * g + m[2] * b + 128) >> 8);
+      uint32_t tg = clamp8((m[3] * r + m[4] * g + m[5] * b + 128) >> 8);
+      uint32_t tb = clamp8((m[6] * r + m[7] * g + m[8] * b + 128) >> 8);
+      *dst++ = ((tr & 0xf8) << 8) | ((tg & 0xfc) << 3) | (tb >> 3);
+    }
+  }
+
+  // switches the state machine between the plain and pixel doubling programs,
+  // the state machine must be stalled with an empty fifo
+  void __not_in_flash_func(ST7789::set_pixel_doubling)(bool enable) {
+    if(enable) {
+      hw_clear_bits(&parallel_pio->sm[parallel_sm].shiftctrl, PIO_SM0_SHIFTCTRL_AUTOPULL_BITS);
+      pio_sm_set_wrap(parallel_pio, parallel_sm,
+        parallel_double_offset + st7789_parallel_double_wrap_target,
+        parallel_double_offset + st7789_parallel_double_wrap);
+      pio_sm_exec(parallel_pio, parallel_sm, pio_encode_jmp(parallel_double_offset) | pio_encode_sideset(1, 0));
+    } else {
+      pio_sm_set_wrap(parallel_pio, parallel_sm,
+        parallel_offset + st7789_parallel_wrap_target,
+        parallel_offset + st7789_parallel_wrap);
+      pio_sm_exec(parallel_pio, parallel_sm, pio_encode_jmp(parallel_offset) | pio_encode_sideset(1, 0));
+      hw_set_bits(&parallel_pio->sm[parallel_sm].shiftctrl, PIO_SM0_SHIFTCTRL_AUTOPULL_BITS);
+    }
+    pixel_doubling = enable;
+  }
+
+  uint32_t ST7789::get_update_us(update_mode_t mode) {
+    return update_us[mode];
+  }
+
   void ST7789::set_backlight(uint8_t brightness) {
+    // init() turns the backlight off and finish_init() back on, a level set
+    // in between has to come after
+    if(init_pending && brightness) {
+      finish_init();
+    }
     // gamma correct the provided 0-255 brightness value onto a
     // 0-65535 range for the pwm counter
     float gamma = 2.8;
@@ -251,13 +989,102 @@ namespace pimoroni {
     pwm_set_gpio_level(bl, value);
   }
 
-  void ST7789::configure_dma(bool enable_read_increment) {
+  // in wide mode the dma writes 16-bit pixels, which the bus replicates into
+  // both halves of the fifo word, and the pio pulls 16 bits at a time shifting
+  // out the high byte first. this sends native rgb565 in the big endian order
+  // the panel expects without any byte swapping
+  void __not_in_flash_func(ST7789::configure_dma)(bool enable_read_increment, bool wide) {
     dma_channel_config config = dma_channel_get_default_config(st_dma);
     channel_config_set_read_increment(&config, enable_read_increment);
-    channel_config_set_transfer_data_size(&config, DMA_SIZE_8);
+    channel_config_set_transfer_data_size(&config, wide ? DMA_SIZE_16 : DMA_SIZE_8);
     channel_config_set_bswap(&config, false);
     channel_config_set_dreq(&config, pio_get_dreq(parallel_pio, parallel_sm, true));
     dma_channel_configure(st_dma, &config, &parallel_pio->txf[parallel_sm], NULL, 0, false);
+
+    hw_write_masked(&parallel_pio->sm[parallel_sm].shiftctrl,
+      (wide ? 16u : 8u) << PIO_SM0_SHIFTCTRL_PULL_THRESH_LSB,
+      PIO_SM0_SHIFTCTRL_PULL_THRESH_BITS);
+
+    dma_wide = wide;
+  }
+
+  void ST7789::set_pixel_format(pixel_format_t pixel_format) {
+    wait();
+
+    if(pixel_format == this->pixel_format) {
+      return;
+    }
+    finish_init();
+    this->pixel_format = pixel_format;
+    invalidate();
+
+    // rgb565 framebuffers are sent to the panel untouched so the panel must
+    // accept rows in framebuffer order, swap the address axes to match. indexed
+    // framebuffers are expanded a row at a time so they do the same
+    uint8_t madctl = pixel_format == RGBA8888 ? MADCTL::ROW_ORDER : MADCTL::COL_ORDER | MADCTL::SWAP_XY;
+    command(reg::MADCTL, 1, (char *)&madctl);
+  }
+
+  ST7789::pixel_format_t ST7789::get_pixel_format() {
+    return pixel_format;
+  }
+
+  // converts rgba8888 palette entries into the scanout lut, changes apply
+  // from the next update so palette cycling costs nothing per pixel
+  void ST7789::set_palette(const uint32_t *palette, int count, int offset) {
+    wait();
+
+    for(int i = 0; i < count && offset + i < 256; i++) {
+      this->palette[offset + i] = rgba8888_to_rgb565(palette[i]);
+    }
+    update_palette_lut();
+  }
+
+  // indexed framebuffers get the colour transform for free by applying it
+  // to the 256 palette entries instead of every pixel
+  void ST7789::update_palette_lut() {
+    invalidate();
+    if(transform == TRANSFORM_NONE) {
+      for(int i = 0; i < 256; i++) {
+        palette_lut[i] = palette[i];
+      }
+    } else {
+      transform_row(palette, palette_lut, 256);
+    }
+  }
+
+  // per channel curves, such as gamma or a night mode tint, each maps an
+  // 8-bit channel value to a new 8-bit value
+  void ST7789::set_transform_curves(const uint8_t *r, const uint8_t *g, const uint8_t *b) {
+    wait();
+
+    for(int i = 0; i < 32; i++) {
+      curve_r[i] = (r[expand5(i)] & 0xf8) << 8;
+      curve_b[i] = b[expand5(i)] >> 3;
+    }
+    for(int i = 0; i < 64; i++) {
+      curve_g[i] = (g[expand6(i)] & 0xfc) << 3;
+    }
+    transform = TRANSFORM_CURVES;
+    update_palette_lut();
+  }
+
+  // 3x3 row-major colour matrix in 8.8 fixed point, so 256 is 1.0
+  void ST7789::set_transform_matrix(const int16_t *matrix) {
+    wait();
+
+    for(int i = 0; i < 9; i++) {
+      this->matrix[i] = matrix[i];
+    }
+    transform = TRANSFORM_MATRIX;
+    update_palette_lut();
+  }
+
+  void ST7789::clear_transform() {
+    wait();
+
+    transform = TRANSFORM_NONE;
+    update_palette_lut();
   }
 
   void ST7789::set_max_pio_clock(uint32_t hz) {
@@ -10,7 +10,9 @@
 #include "hardware/pio.h"
 #include "hardware/pwm.h"
 #include "hardware/clocks.h"
+#include "hardware/structs/powman.h"
 #include "pico/stdlib.h"
+#include "pico/multicore.h"
 
 #ifndef NO_QSTR
 #include "st7789_parallel.pio.h"
@@ -24,6 +26,31 @@
 
 namespace pimoroni {
   class ST7789 {
+  public:
+    // rgba8888 and rgb565 match picovector's pixel_format_t values, indexed
+    // images are flagged separately there
+    enum pixel_format_t {
+      RGBA8888 = 1,
+      RGB565   = 3,
+      PAL8     = 8
+    };
+
+    enum transform_t {
+      TRANSFORM_NONE   = 0,
+      TRANSFORM_CURVES = 1,
+      TRANSFORM_MATRIX = 2
+    };
+
+    enum update_mode_t {
+      RGBA8888_LORES = 0,
+      RGBA8888_HIRES = 1,
+      RGB565_LORES   = 2,
+      RGB565_HIRES   = 3,
+      PAL8_LORES     = 4,
+      PAL8_HIRES     = 5,
+      UPDATE_MODE_COUNT
+    };
+
   private:
     int width = 160;
     int height = 120;
@@ -46,11 +73,95 @@ namespace pimoroni {
     // Regular commands
     uint parallel_sm;
     int parallel_offset;
+    int parallel_double_offset;
     uint st_dma;
+    bool dma_wide = false;
+    bool pixel_doubling = false;
+
+    // the second half of init, see finish_init()
+    bool init_pending = false;
+    bool init_warm = false;
+    uint32_t init_ready_us = 0;
+
+    // cpu time spent in the last update for each format and resolution
+    uint32_t update_us[UPDATE_MODE_COUNT] = {0};
+
+    pixel_format_t pixel_format = RGBA8888;
+
+    // rgb565 lookup for PAL8 framebuffers, already in panel format. the
+    // colour transform is folded into palette_lut, palette keeps the original
+    uint16_t palette[256] = {0};
+    uint16_t palette_lut[256] = {0};
+
+    // colour transform applied to every converted row on its way out
+    transform_t transform = TRANSFORM_NONE;
+    uint16_t curve_r[32];
+    uint16_t curve_g[64];
+    uint16_t curve_b[32];
+    int16_t matrix[9];
+
+    // the buffer updates are sent from
+    const void *source;
+
+    // async present on core1
+    static ST7789 *core1_display;
+    bool core1_running = false;
+    volatile bool async_pending = false;
+    volatile bool async_busy = false;
+    bool async_fullres;
+    const void *async_source;
+
+    // work handed to core1 between updates
+    volatile bool task_pending = false;
+    volatile bool task_busy = false;
+    void (*task_fn)(void *arg);
+    void *task_arg;
 
   public:
-    // Parallel init
-    ST7789() {
+    struct region_t {
+      int x, y, w, h;
+    };
+    static const int MAX_ASYNC_REGIONS = 8;
+
+    struct stats_t {
+      uint32_t frames;       // updates presented
+      uint32_t convert_us;   // cpu time converting pixels
+      uint32_t dma_wait_us;  // time blocked on the dma or pio
+      uint32_t bytes;        // bytes clocked out to the panel
+      uint32_t pio_hz;       // state machine clock after the divider
+      uint32_t skipped;      // full frame updates found unchanged and not sent
+    };
+
+  private:
+    region_t async_regions[MAX_ASYNC_REGIONS];
+    int async_region_count = 0;
+
+    // counters for the update in progress and the last one to finish
+    stats_t frame_stats = {0};
+    stats_t stats = {0};
+
+    // frame pacing, locked to the panel's tearing effect output when the te
+    // pin is connected and to the nominal refresh period otherwise
+    int te_pin = -1;
+    uint vsync_divider = 0;
+    uint32_t frame_period_us = 16667;
+    uint32_t last_present_us = 0;
+    uint32_t vsync_frames = 0;
+    uint32_t vsync_missed = 0;
+
+    // change detection for full frame updates, the framebuffer is split into
+    // bands of rows and each is crc'd by the dma sniffer so only bands that
+    // differ from what the panel last showed are sent
+    static const int CHANGE_BANDS = 15;
+    int sniff_dma = -1;
+    bool skip_unchanged = true;
+    bool bands_valid = false;
+    bool bands_fullres = false;
+    uint32_t band_crc[CHANGE_BANDS];
+
+  public:
+    // Parallel init, an optional rgb565 splash is sent before anything else
+    ST7789(const uint16_t *splash = nullptr) {
       pio_set_gpio_base(parallel_pio, d0 + 8 >= 32 ? 16 : 0);
 
       parallel_sm = pio_claim_unused_sm(parallel_pio, true);
@@ -59,6 +170,11 @@ namespace pimoroni {
         panic("Could not add parallel PIO program.");
       }
 
+      parallel_double_offset = pio_add_program(parallel_pio, &st7789_parallel_double_program);
+      if(parallel_double_offset == -1) {
+        panic("Could not add parallel pixel doubling PIO program.");
+      }
+
       pio_gpio_init(parallel_pio, wr_sck);
 
       gpio_set_function(rd_sck,  GPIO_FUNC_SIO);
@@ -79,7 +195,9 @@ namespace pimoroni {
 
       // Determine clock divider
       startup_hz = clock_get_hz(clk_sys);
-      sm_config_set_clkdiv(&c, fmax(1.0f, float(startup_hz) / max_pio_clk));
+      float div = fmax(1.0f, float(startup_hz) / max_pio_clk);
+      sm_config_set_clkdiv(&c, div);
+      frame_stats.pio_hz = uint32_t(startup_hz / div);
 
       pio_sm_init(parallel_pio, parallel_sm, parallel_offset, &c);
       pio_sm_set_enabled(parallel_pio, parallel_sm, true);
@@ -87,35 +205,104 @@ namespace pimoroni {
       st_dma = dma_claim_unused_channel(true);
       configure_dma(true);
 
+      // without a spare channel every frame is sent in full
+      sniff_dma = dma_claim_unused_channel(false);
+
       gpio_put(rd_sck, 1);
 
-      init();
+      init(splash);
     }
 
     ~ST7789() {
+      if(te_pin >= 0) {
+        set_vsync(0);
+      }
+
+      if(core1_running) {
+        wait();
+        wait_task();
+        // core1 has to stop being a lockout victim before it's reset, or the
+        // next flash write would wait forever for it to acknowledge
+        run_task(core1_release, nullptr);
+        wait_task();
+        multicore_reset_core1();
+        core1_running = false;
+      }
+
       if(dma_channel_is_claimed(st_dma)) {
         dma_channel_abort(st_dma);
         dma_channel_unclaim(st_dma);
       }
 
+      if(sniff_dma >= 0) {
+        dma_channel_unclaim(sniff_dma);
+      }
+
       if(pio_sm_is_claimed(parallel_pio, parallel_sm)) {
         pio_sm_set_enabled(parallel_pio, parallel_sm, false);
         pio_sm_drain_tx_fifo(parallel_pio, parallel_sm);
         //pio_sm_unclaim(parallel_pio, parallel_sm);
+        pio_remove_program(parallel_pio, &st7789_parallel_double_program, parallel_double_offset);
         pio_remove_program_and_unclaim_sm(&st7789_parallel_program, parallel_pio, parallel_sm, parallel_offset);
       }
     }
 
     void update(bool fullres);
+    void update(bool fullres, const region_t *regions, int count);
+    void update_async(bool fullres);
+    void update_async(bool fullres, const region_t *regions, int count);
+    void set_vsync(uint divider, int te_pin = -1);
+    uint32_t get_vsync_frames();
+    uint32_t get_vsync_missed();
+    bool busy();
+    void wait();
+    void run_task(void (*fn)(void *arg), void *arg);
+    void wait_task();
+    bool task_running();
     void set_backlight(uint8_t brightness);
+    void finish_init(const uint16_t *splash = nullptr);
+    void sleep();
     uint32_t *get_framebuffer();
+    void set_source(const void *buffer);
+    const void *get_source();
     void command(uint8_t command, size_t len = 0, const char *data = NULL);
     void set_max_pio_clock(uint32_t hz);
+    void set_pixel_format(pixel_format_t pixel_format);
+    pixel_format_t get_pixel_format();
+    void set_palette(const uint32_t *palette, int count, int offset = 0);
+    void set_transform_curves(const uint8_t *r, const uint8_t *g, const uint8_t *b);
+    void set_transform_matrix(const int16_t *matrix);
+    void clear_transform();
+    uint32_t get_update_us(update_mode_t mode);
+    stats_t get_stats();
+    void set_skip_unchanged(bool enable);
+    bool get_skip_unchanged();
+    void invalidate();
 
   private:
-    void init();
-    void configure_dma(bool enable_read_increment = true);
+    void init(const uint16_t *splash);
+    void cold_init();
+    void set_orientation();
+    void send_splash(const uint16_t *splash);
+    void set_window(uint16_t x, uint16_t y, uint16_t w, uint16_t h);
+    void update_clock();
+    void present(const void *buffer, bool fullres, const region_t *regions, int count);
+    int changed_bands(const void *buffer, bool fullres, region_t *changed);
+    void wait_vsync();
+    void update_region(const void *buffer, bool fullres, int x, int y, int w, int h);
+    void update_region_rgb565(const uint16_t *buffer, bool fullres, int x, int y, int w, int h);
+    void update_region_pal8(const uint8_t *buffer, bool fullres, int x, int y, int w, int h);
+    void transform_row(const uint16_t *src, uint16_t *dst, int count);
+    void update_palette_lut();
+    void launch_core1();
+    static void core1_entry();
+    static void core1_lockout();
+    static void core1_release(void *arg);
+    void core1_main();
+    void configure_dma(bool enable_read_increment = true, bool wide = false);
+    void set_pixel_doubling(bool enable);
     inline void wait_for_dma(void);
+    inline void count_bytes(size_t len);
     void write_blocking(const uint8_t *src, size_t len);
     void start_dma(const uint8_t *src, size_t len);
   };
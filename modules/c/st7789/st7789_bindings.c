@@ -3,18 +3,46 @@
 /***** Module Functions *****/
 
 static MP_DEFINE_CONST_FUN_OBJ_1(st7789___del___obj, st7789___del__);
-static MP_DEFINE_CONST_FUN_OBJ_2(st7789_update_obj, st7789_update);
+static MP_DEFINE_CONST_FUN_OBJ_VAR(st7789_update_obj, 2, st7789_update);
+static MP_DEFINE_CONST_FUN_OBJ_VAR(st7789_update_async_obj, 2, st7789_update_async);
+static MP_DEFINE_CONST_FUN_OBJ_VAR_BETWEEN(st7789_vsync_obj, 2, 3, st7789_vsync);
+static MP_DEFINE_CONST_FUN_OBJ_1(st7789_vsync_stats_obj, st7789_vsync_stats);
+static MP_DEFINE_CONST_FUN_OBJ_2(st7789_pace_obj, st7789_pace);
+static MP_DEFINE_CONST_FUN_OBJ_VAR_BETWEEN(st7789_source_obj, 1, 2, st7789_source);
+static MP_DEFINE_CONST_FUN_OBJ_1(st7789_sleep_obj, st7789_sleep);
+static MP_DEFINE_CONST_FUN_OBJ_1(st7789_wait_obj, st7789_wait);
+static MP_DEFINE_CONST_FUN_OBJ_1(st7789_busy_obj, st7789_busy);
 static MP_DEFINE_CONST_FUN_OBJ_2(st7789_set_backlight_obj, st7789_set_backlight);
 static MP_DEFINE_CONST_FUN_OBJ_3(st7789_command_obj, st7789_command);
+static MP_DEFINE_CONST_FUN_OBJ_VAR_BETWEEN(st7789_pixel_format_obj, 1, 2, st7789_pixel_format);
+static MP_DEFINE_CONST_FUN_OBJ_VAR_BETWEEN(st7789_palette_obj, 2, 3, st7789_palette);
+static MP_DEFINE_CONST_FUN_OBJ_VAR_BETWEEN(st7789_transform_obj, 2, 4, st7789_transform);
+static MP_DEFINE_CONST_FUN_OBJ_1(st7789_timings_obj, st7789_timings);
+static MP_DEFINE_CONST_FUN_OBJ_1(st7789_stats_obj, st7789_stats);
+static MP_DEFINE_CONST_FUN_OBJ_VAR_BETWEEN(st7789_skip_unchanged_obj, 1, 2, st7789_skip_unchanged);
 static MP_DEFINE_CONST_FUN_OBJ_2(st7789_set_max_pio_clock_obj, st7789_set_max_pio_clock);
 
 /* Class Methods */
 static const mp_rom_map_elem_t st7789_locals[] = {
     { MP_ROM_QSTR(MP_QSTR___del__), MP_ROM_PTR(&st7789___del___obj) },
     { MP_ROM_QSTR(MP_QSTR_update), MP_ROM_PTR(&st7789_update_obj) },
+    { MP_ROM_QSTR(MP_QSTR_update_async), MP_ROM_PTR(&st7789_update_async_obj) },
+    { MP_ROM_QSTR(MP_QSTR_source), MP_ROM_PTR(&st7789_source_obj) },
+    { MP_ROM_QSTR(MP_QSTR_wait), MP_ROM_PTR(&st7789_wait_obj) },
+    { MP_ROM_QSTR(MP_QSTR_sleep), MP_ROM_PTR(&st7789_sleep_obj) },
+    { MP_ROM_QSTR(MP_QSTR_vsync), MP_ROM_PTR(&st7789_vsync_obj) },
+    { MP_ROM_QSTR(MP_QSTR_vsync_stats), MP_ROM_PTR(&st7789_vsync_stats_obj) },
+    { MP_ROM_QSTR(MP_QSTR_pace), MP_ROM_PTR(&st7789_pace_obj) },
+    { MP_ROM_QSTR(MP_QSTR_busy), MP_ROM_PTR(&st7789_busy_obj) },
     { MP_ROM_QSTR(MP_QSTR_backlight), MP_ROM_PTR(&st7789_set_backlight_obj) },
     { MP_ROM_QSTR(MP_QSTR_command), MP_ROM_PTR(&st7789_command_obj) },
     { MP_ROM_QSTR(MP_QSTR_set_max_pio_clock), MP_ROM_PTR(&st7789_set_max_pio_clock_obj) },
+    { MP_ROM_QSTR(MP_QSTR_pixel_format), MP_ROM_PTR(&st7789_pixel_format_obj) },
+    { MP_ROM_QSTR(MP_QSTR_palette), MP_ROM_PTR(&st7789_palette_obj) },
+    { MP_ROM_QSTR(MP_QSTR_transform), MP_ROM_PTR(&st7789_transform_obj) },
+    { MP_ROM_QSTR(MP_QSTR_timings), MP_ROM_PTR(&st7789_timings_obj) },
+    { MP_ROM_QSTR(MP_QSTR_stats), MP_ROM_PTR(&st7789_stats_obj) },
+    { MP_ROM_QSTR(MP_QSTR_skip_unchanged), MP_ROM_PTR(&st7789_skip_unchanged_obj) },
 };
 static MP_DEFINE_CONST_DICT(mp_module_st7789_locals, st7789_locals);
 
@@ -33,6 +61,9 @@ static const mp_map_elem_t st7789_globals[] = {
     { MP_OBJ_NEW_QSTR(MP_QSTR_ST7789), (mp_obj_t)&ST7789_type },
     { MP_ROM_QSTR(MP_QSTR_WIDTH), MP_ROM_INT(160) },
     { MP_ROM_QSTR(MP_QSTR_HEIGHT), MP_ROM_INT(120) },
+    { MP_ROM_QSTR(MP_QSTR_RGBA8888), MP_ROM_INT(1) },
+    { MP_ROM_QSTR(MP_QSTR_RGB565), MP_ROM_INT(3) },
+    { MP_ROM_QSTR(MP_QSTR_PAL8), MP_ROM_INT(8) },
 };
 static MP_DEFINE_CONST_DICT(mp_module_st7789_globals, st7789_globals);
 
@@ -42,3 +73,6 @@ const mp_obj_module_t st7789_user_cmodule = {
 };
 
 MP_REGISTER_MODULE(MP_QSTR_st7789, st7789_user_cmodule);
+
+// the buffer passed to source() has to outlive any in flight update
+MP_REGISTER_ROOT_POINTER(mp_obj_t st7789_source);
@@ -6,19 +6,42 @@
 #include <new>  // for placement new
 
 #include "st7789.hpp"
+#include "worker.hpp"
+#include "fill.hpp"
 
 using namespace pimoroni;
 
 static ST7789 *display = nullptr;
 static uint32_t display_refcount = 0;
 
+// core1 waits in the driver between async updates, lend it to picovector
+static void display_worker_run(void (*fn)(void *arg), void *arg) {
+    display->run_task(fn, arg);
+}
+
+static void display_worker_wait() {
+    display->wait_task();
+}
+
+static bool display_worker_busy() {
+    return display->task_running();
+}
+
+static picovector::worker_t display_worker = {display_worker_run, display_worker_wait, display_worker_busy};
+
+// the driver lives in sram rather than on the (psram) gc heap since core1
+// touches it during async updates and psram shares xip with flash
+static uint8_t __attribute__((aligned(8))) display_storage[sizeof(ST7789)];
+
+// the size of the buffer passed to source(), for checking against the mode
+static size_t source_len = 320 * 240 * 4;
+
 #define MP_OBJ_TO_PTR2(o, t) ((t *)(uintptr_t)(o))
-#define m_new_class(cls, ...) new(m_new(cls, 1)) cls(__VA_ARGS__)
-#define m_del_class(cls, ptr) ptr->~cls();m_del(cls, ptr, 1)
 
 extern "C" {
 #include "st7789_bindings.h"
 #include "py/builtin.h"
+#include "py/mphal.h"
 
 typedef struct _ST7789_obj_t {
     mp_obj_base_t base;
@@ -27,9 +50,22 @@ typedef struct _ST7789_obj_t {
 
 
 mp_obj_t st7789_make_new(const mp_obj_type_t *type, size_t n_args, size_t n_kw, const mp_obj_t *all_args) {
+    mp_arg_check_num(n_args, n_kw, 0, 1, false);
     _ST7789_obj_t *self = mp_obj_malloc_with_finaliser(ST7789_obj_t, &ST7789_type);
     if(!display) {
-        display = m_new_class(ST7789);
+        // ST7789(splash=None), splash is a 320x240 rgb565 image sent as the
+        // very first transfer, ideally a bytes object frozen into flash
+        const uint16_t *splash = nullptr;
+        if(n_args > 0 && all_args[0] != mp_const_none) {
+            mp_buffer_info_t bufinfo;
+            mp_get_buffer_raise(all_args[0], &bufinfo, MP_BUFFER_READ);
+            if(bufinfo.len < 320 * 240 * sizeof(uint16_t)) {
+                mp_raise_msg_varg(&mp_type_ValueError, MP_ERROR_TEXT("splash must be 320x240 rgb565"));
+            }
+            splash = (const uint16_t *)bufinfo.buf;
+        }
+        display = new(display_storage) ST7789(splash);
+        picovector::core1_worker = &display_worker;
     }
     self->display = display;
     display_refcount++;
@@ -39,22 +75,201 @@ mp_obj_t st7789_make_new(const mp_obj_type_t *type, size_t n_args, size_t n_kw,
 mp_obj_t st7789___del__(mp_obj_t self_in) {
     display_refcount--;
     if(display_refcount == 0) {
-        m_del_class(ST7789, display);
+        MP_STATE_VM(st7789_source) = MP_OBJ_NULL;
+        source_len = 320 * 240 * 4;
+        picovector::core1_worker = nullptr;
+        display->~ST7789();
         display = nullptr;
     }
     return mp_const_none;
 }
 
-mp_obj_t st7789_update(mp_obj_t self_in, mp_obj_t fullres_in) {
+// each rect is an (x, y, w, h) tuple or an object with x, y, w, h attributes
+static void get_rect(mp_obj_t rect_in, ST7789::region_t &r) {
+    if(mp_obj_is_type(rect_in, &mp_type_tuple) || mp_obj_is_type(rect_in, &mp_type_list)) {
+        mp_obj_t *items;
+        mp_obj_get_array_fixed_n(rect_in, 4, &items);
+        r.x = (int)mp_obj_get_float(items[0]);
+        r.y = (int)mp_obj_get_float(items[1]);
+        r.w = (int)mp_obj_get_float(items[2]);
+        r.h = (int)mp_obj_get_float(items[3]);
+    } else {
+        r.x = (int)mp_obj_get_float(mp_load_attr(rect_in, MP_QSTR_x));
+        r.y = (int)mp_obj_get_float(mp_load_attr(rect_in, MP_QSTR_y));
+        r.w = (int)mp_obj_get_float(mp_load_attr(rect_in, MP_QSTR_w));
+        r.h = (int)mp_obj_get_float(mp_load_attr(rect_in, MP_QSTR_h));
+    }
+}
+
+static void check_source(bool fullres) {
+    size_t pixels = fullres ? 320 * 240 : 160 * 120;
+    size_t bpp;
+    switch(display->get_pixel_format()) {
+        case ST7789::RGB565: bpp = 2; break;
+        case ST7789::PAL8: bpp = 1; break;
+        default: bpp = 4; break;
+    }
+    if(source_len < pixels * bpp) {
+        mp_raise_msg_varg(&mp_type_ValueError, MP_ERROR_TEXT("source buffer too small for display mode"));
+    }
+}
+
+// source(buffer=None)
+// sets the buffer that updates are sent from, None selects the built in
+// framebuffer. swapping sources between async updates gives double buffering
+mp_obj_t st7789_source(size_t n_args, const mp_obj_t *args) {
+    // the old source may be in use by an async update
+    display->wait();
+
+    if(n_args == 1 || args[1] == mp_const_none) {
+        display->set_source(nullptr);
+        MP_STATE_VM(st7789_source) = MP_OBJ_NULL;
+        source_len = 320 * 240 * 4;
+        return mp_const_none;
+    }
+
+    mp_buffer_info_t bufinfo;
+    mp_get_buffer_raise(args[1], &bufinfo, MP_BUFFER_READ);
+    display->set_source(bufinfo.buf);
+    MP_STATE_VM(st7789_source) = args[1];
+    source_len = bufinfo.len;
+    return mp_const_none;
+}
+
+// update(fullres, *rects)
+// if no rects are given the whole screen is updated
+mp_obj_t st7789_update(size_t n_args, const mp_obj_t *args) {
+    bool fullres = mp_obj_is_true(args[1]);
+    check_source(fullres);
+    // a clear may still be landing in the framebuffer
+    picovector::fill_sync();
+
+    if(n_args == 2) {
+        display->update(fullres);
+        return mp_const_none;
+    }
+
+    ST7789::region_t regions[n_args - 2];
+    for(size_t i = 2; i < n_args; i++) {
+        get_rect(args[i], regions[i - 2]);
+    }
+    display->update(fullres, regions, n_args - 2);
+
+    return mp_const_none;
+}
+
+// update_async(fullres, *rects)
+// returns as soon as the frame has been handed to core1, call wait() before
+// drawing into the framebuffer again
+mp_obj_t st7789_update_async(size_t n_args, const mp_obj_t *args) {
+    bool fullres = mp_obj_is_true(args[1]);
+    check_source(fullres);
+    // a clear may still be landing in the framebuffer
+    picovector::fill_sync();
+
+    if(n_args == 2) {
+        display->update_async(fullres);
+        return mp_const_none;
+    }
+
+    ST7789::region_t regions[n_args - 2];
+    for(size_t i = 2; i < n_args; i++) {
+        get_rect(args[i], regions[i - 2]);
+    }
+    display->update_async(fullres, regions, n_args - 2);
+
+    return mp_const_none;
+}
+
+// vsync(divider, te=None)
+// locks presentation to 60 / divider hz (so 1, 2 or 3 for 60, 30 or 20 hz),
+// 0 turns pacing off. te is the gpio wired to the panel's TE output if any
+mp_obj_t st7789_vsync(size_t n_args, const mp_obj_t *args) {
+    int divider = mp_obj_get_int(args[1]);
+    if(divider < 0) {
+        mp_raise_msg_varg(&mp_type_ValueError, MP_ERROR_TEXT("divider must be positive"));
+    }
+
+    int te_pin = -1;
+    if(n_args > 2 && args[2] != mp_const_none) {
+        te_pin = mp_obj_get_int(args[2]);
+    }
+
+    display->set_vsync(divider, te_pin);
+    return mp_const_none;
+}
+
+// vsync_stats()
+// returns (presented, missed), missed counts refreshes that went by while
+// a frame was late
+mp_obj_t st7789_vsync_stats(mp_obj_t self_in) {
+    (void)self_in;
+    mp_obj_t result[2] = {
+        mp_obj_new_int_from_uint(display->get_vsync_frames()),
+        mp_obj_new_int_from_uint(display->get_vsync_missed())
+    };
+    return mp_obj_new_tuple(2, result);
+}
+
+// when the frame being drawn was due to start, set by pace()
+static uint32_t pace_frame_us = 0;
+static bool paced = false;
+
+// pace(fps)
+// sleeps until the next frame at fps is due, returning the microseconds the
+// frame spent working before it. the core waits for events (wfe) rather
+// than spinning and scheduled callbacks still run. a frame that overruns
+// starts the next straight away and the cadence restarts from there
+mp_obj_t st7789_pace(mp_obj_t self_in, mp_obj_t fps_in) {
+    (void)self_in;
+    float fps = mp_obj_get_float(fps_in);
+    uint32_t period_us = fps > 0.0f ? uint32_t(1000000.0f / fps) : 0;
+    uint32_t now_us = time_us_32();
+    uint32_t busy_us = paced ? now_us - pace_frame_us : 0;
+
+    uint32_t next_us = pace_frame_us + period_us;
+    int32_t remaining_us = int32_t(next_us - now_us);
+    if(!paced || period_us == 0 || remaining_us <= 0) {
+        pace_frame_us = now_us;
+    } else {
+        // whole milliseconds only, a frame that starts a little early gives
+        // the time back to the next since the cadence is kept from next_us
+        mp_hal_delay_ms(remaining_us / 1000);
+        pace_frame_us = next_us;
+    }
+    paced = true;
+    return mp_obj_new_int_from_uint(busy_us);
+}
+
+// sleep()
+// puts the panel into sleep-in ahead of powman.sleep(), the next boot then
+// wakes it without a reset and with the last frame still on screen
+mp_obj_t st7789_sleep(mp_obj_t self_in) {
+    (void)self_in;
+    display->sleep();
+    return mp_const_none;
+}
+
+mp_obj_t st7789_wait(mp_obj_t self_in) {
     (void)self_in;
-    display->update(mp_obj_is_true(fullres_in));
+    display->wait();
     return mp_const_none;
 }
 
+mp_obj_t st7789_busy(mp_obj_t self_in) {
+    (void)self_in;
+    return mp_obj_new_bool(display->busy());
+}
+
 mp_obj_t st7789_command(mp_obj_t self_in, mp_obj_t reg_in, mp_obj_t data_in) {
     (void)self_in;
     uint8_t reg = mp_obj_get_int(reg_in);
 
+    display->wait();
+    display->finish_init();
+    // a raw command may change what's on the panel behind the driver's back
+    display->invalidate();
+
     if(mp_obj_is_type(data_in, &mp_type_tuple)) {
         mp_obj_tuple_t *tuple = (mp_obj_tuple_t *)MP_OBJ_TO_PTR(data_in);
         uint8_t data[tuple->len] = {0};
@@ -75,6 +290,125 @@ mp_obj_t st7789_set_backlight(mp_obj_t self_in, mp_obj_t value_in) {
     return mp_const_none;
 }
 
+// pixel_format(format=None)
+// gets or sets the framebuffer pixel format, RGB565 framebuffers are sent
+// to the panel without conversion
+mp_obj_t st7789_pixel_format(size_t n_args, const mp_obj_t *args) {
+    if(n_args == 1) {
+        return mp_obj_new_int(display->get_pixel_format());
+    }
+
+    int pixel_format = mp_obj_get_int(args[1]);
+    if(pixel_format != ST7789::RGBA8888 && pixel_format != ST7789::RGB565 && pixel_format != ST7789::PAL8) {
+        mp_raise_msg_varg(&mp_type_ValueError, MP_ERROR_TEXT("unsupported pixel format"));
+    }
+    display->set_pixel_format((ST7789::pixel_format_t)pixel_format);
+    return mp_const_none;
+}
+
+// palette(entries, offset=0)
+// loads the PAL8 scanout lut from a buffer of rgba8888 words, such as an
+// indexed image's raw_palette
+mp_obj_t st7789_palette(size_t n_args, const mp_obj_t *args) {
+    mp_buffer_info_t bufinfo;
+    mp_get_buffer_raise(args[1], &bufinfo, MP_BUFFER_READ);
+
+    int offset = n_args > 2 ? mp_obj_get_int(args[2]) : 0;
+    if(offset < 0 || offset > 255) {
+        mp_raise_msg_varg(&mp_type_ValueError, MP_ERROR_TEXT("palette offset out of range"));
+    }
+
+    display->set_palette((const uint32_t *)bufinfo.buf, bufinfo.len / sizeof(uint32_t), offset);
+    return mp_const_none;
+}
+
+// transform(None) / transform(matrix) / transform(r, g, b)
+// colour transform applied while pixels are converted for the panel. matrix
+// is nine floats, row-major, mapping (r, g, b) to the new colour. r, g and b
+// are 256 byte curves mapping each channel value to a new one
+mp_obj_t st7789_transform(size_t n_args, const mp_obj_t *args) {
+    if(args[1] == mp_const_none) {
+        display->clear_transform();
+        return mp_const_none;
+    }
+
+    if(n_args == 4) {
+        const uint8_t *curves[3];
+        for(int i = 0; i < 3; i++) {
+            mp_buffer_info_t bufinfo;
+            mp_get_buffer_raise(args[i + 1], &bufinfo, MP_BUFFER_READ);
+            if(bufinfo.len < 256) {
+                mp_raise_msg_varg(&mp_type_ValueError, MP_ERROR_TEXT("curves must have 256 entries"));
+            }
+            curves[i] = (const uint8_t *)bufinfo.buf;
+        }
+        display->set_transform_curves(curves[0], curves[1], curves[2]);
+        return mp_const_none;
+    }
+
+    if(n_args != 2) {
+        mp_raise_TypeError(MP_ERROR_TEXT("expected a matrix or three curves"));
+    }
+
+    mp_obj_t *items;
+    mp_obj_get_array_fixed_n(args[1], 9, &items);
+    int16_t matrix[9];
+    for(int i = 0; i < 9; i++) {
+        float v = mp_obj_get_float(items[i]);
+        v = v < -127.0f ? -127.0f : v > 127.0f ? 127.0f : v;
+        matrix[i] = (int16_t)(v * 256.0f + (v < 0 ? -0.5f : 0.5f));
+    }
+    display->set_transform_matrix(matrix);
+    return mp_const_none;
+}
+
+// timings()
+// returns the cpu time in microseconds spent by the most recent update in
+// each format and resolution
+mp_obj_t st7789_timings(mp_obj_t self_in) {
+    (void)self_in;
+    mp_obj_t result = mp_obj_new_dict(6);
+    mp_obj_dict_store(result, MP_OBJ_NEW_QSTR(MP_QSTR_rgba8888_lores), mp_obj_new_int_from_uint(display->get_update_us(ST7789::RGBA8888_LORES)));
+    mp_obj_dict_store(result, MP_OBJ_NEW_QSTR(MP_QSTR_rgba8888_hires), mp_obj_new_int_from_uint(display->get_update_us(ST7789::RGBA8888_HIRES)));
+    mp_obj_dict_store(result, MP_OBJ_NEW_QSTR(MP_QSTR_rgb565_lores), mp_obj_new_int_from_uint(display->get_update_us(ST7789::RGB565_LORES)));
+    mp_obj_dict_store(result, MP_OBJ_NEW_QSTR(MP_QSTR_rgb565_hires), mp_obj_new_int_from_uint(display->get_update_us(ST7789::RGB565_HIRES)));
+    mp_obj_dict_store(result, MP_OBJ_NEW_QSTR(MP_QSTR_pal8_lores), mp_obj_new_int_from_uint(display->get_update_us(ST7789::PAL8_LORES)));
+    mp_obj_dict_store(result, MP_OBJ_NEW_QSTR(MP_QSTR_pal8_hires), mp_obj_new_int_from_uint(display->get_update_us(ST7789::PAL8_HIRES)));
+    return result;
+}
+
+// stats()
+// counters for the most recent update: convert_us is cpu time spent
+// converting pixels, dma_wait_us time blocked on the dma and pio, bytes what
+// was clocked out to the panel and pio_hz the state machine clock. frames
+// and skipped count every update sent and every full frame left unsent as
+// nothing had changed
+mp_obj_t st7789_stats(mp_obj_t self_in) {
+    (void)self_in;
+    ST7789::stats_t stats = display->get_stats();
+    mp_obj_t result = mp_obj_new_dict(6);
+    mp_obj_dict_store(result, MP_OBJ_NEW_QSTR(MP_QSTR_frames), mp_obj_new_int_from_uint(stats.frames));
+    mp_obj_dict_store(result, MP_OBJ_NEW_QSTR(MP_QSTR_convert_us), mp_obj_new_int_from_uint(stats.convert_us));
+    mp_obj_dict_store(result, MP_OBJ_NEW_QSTR(MP_QSTR_dma_wait_us), mp_obj_new_int_from_uint(stats.dma_wait_us));
+    mp_obj_dict_store(result, MP_OBJ_NEW_QSTR(MP_QSTR_bytes), mp_obj_new_int_from_uint(stats.bytes));
+    mp_obj_dict_store(result, MP_OBJ_NEW_QSTR(MP_QSTR_pio_hz), mp_obj_new_int_from_uint(stats.pio_hz));
+    mp_obj_dict_store(result, MP_OBJ_NEW_QSTR(MP_QSTR_skipped), mp_obj_new_int_from_uint(stats.skipped));
+    return result;
+}
+
+// skip_unchanged(enable=None)
+// full frame updates crc the framebuffer in bands as they start and only
+// send the bands that changed since the last one, or nothing if none did.
+// on by default, returns the setting when called without an argument
+mp_obj_t st7789_skip_unchanged(size_t n_args, const mp_obj_t *args) {
+    if(n_args == 1) {
+        return mp_obj_new_bool(display->get_skip_unchanged());
+    }
+
+    display->set_skip_unchanged(mp_obj_is_true(args[1]));
+    return mp_const_none;
+}
+
 mp_obj_t st7789_set_max_pio_clock(mp_obj_t self_in, mp_obj_t value_in) {
     (void)self_in;
     display->set_max_pio_clock(mp_obj_get_uint(value_in));
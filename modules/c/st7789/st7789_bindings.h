@@ -6,8 +6,22 @@ extern const mp_obj_type_t ST7789_type;
 // Declare the functions we'll make available in Python
 extern mp_obj_t st7789_make_new(const mp_obj_type_t *type, size_t n_args, size_t n_kw, const mp_obj_t *all_args);
 extern mp_obj_t st7789___del__(mp_obj_t self_in);
-extern mp_obj_t st7789_update(mp_obj_t self_in, mp_obj_t fullres_in);
+extern mp_obj_t st7789_update(size_t n_args, const mp_obj_t *args);
+extern mp_obj_t st7789_update_async(size_t n_args, const mp_obj_t *args);
+extern mp_obj_t st7789_source(size_t n_args, const mp_obj_t *args);
+extern mp_obj_t st7789_sleep(mp_obj_t self_in);
+extern mp_obj_t st7789_wait(mp_obj_t self_in);
+extern mp_obj_t st7789_busy(mp_obj_t self_in);
 extern mp_int_t st7789_get_framebuffer(mp_obj_t self_in, mp_buffer_info_t *bufinfo, mp_uint_t flags);
 extern mp_obj_t st7789_set_backlight(mp_obj_t self_in, mp_obj_t value_in);
 extern mp_obj_t st7789_command(mp_obj_t self_in, mp_obj_t reg_in, mp_obj_t data_in);
+extern mp_obj_t st7789_pixel_format(size_t n_args, const mp_obj_t *args);
+extern mp_obj_t st7789_palette(size_t n_args, const mp_obj_t *args);
+extern mp_obj_t st7789_transform(size_t n_args, const mp_obj_t *args);
+extern mp_obj_t st7789_vsync(size_t n_args, const mp_obj_t *args);
+extern mp_obj_t st7789_vsync_stats(mp_obj_t self_in);
+extern mp_obj_t st7789_pace(mp_obj_t self_in, mp_obj_t fps_in);
+extern mp_obj_t st7789_timings(mp_obj_t self_in);
+extern mp_obj_t st7789_stats(mp_obj_t self_in);
+extern mp_obj_t st7789_skip_unchanged(size_t n_args, const mp_obj_t *args);
 extern mp_obj_t st7789_set_max_pio_clock(mp_obj_t self_in, mp_obj_t value_in);
\ No newline at end of file
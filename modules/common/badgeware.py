@@ -1,3 +1,4 @@
+import array
 import gc
 import json
 import os
@@ -5,6 +6,7 @@ import io as stream
 import sys
 import time
 import random
+import struct
 import pcf85063a
 
 import machine
@@ -14,6 +16,11 @@ import builtins
 
 import picovector
 
+# first, the panel's reset and wake delays run out while the rest of this
+# module loads and the driver only waits on whatever is left of them when
+# the first frame (or command) goes out
+display = st7789.ST7789()
+
 _CASE_LIGHTS = [machine.PWM(machine.Pin.board.CL0), machine.PWM(machine.Pin.board.CL1),
                 machine.PWM(machine.Pin.board.CL2), machine.PWM(machine.Pin.board.CL3)]
 
@@ -58,7 +65,7 @@ def set_brightness(value):
 
 def get_light():
     # TODO: Returning the raw u16 is a little meh here, can we do an approx lux conversion?
-    return LIGHT_SENSOR.read_u16()
+    return round(powman.sense()[2])
 
 
 def localtime_to_rtc():
@@ -148,7 +155,7 @@ def text_tokenise(image, text, glyph_renderers=None, size=24):
     return tokens
 
 
-def text_draw(image, text, bounds=None, line_spacing=1, word_spacing=1, size=24):
+def text_draw(image, text, bounds=None, line_spacing=1, word_spacing=1, size=24, native=False):
     WORD = 1
     SPACE = 2
     LINE_BREAK = 3
@@ -158,6 +165,16 @@ def text_draw(image, text, bounds=None, line_spacing=1, word_spacing=1, size=24)
     else:
         bounds = rect(int(bounds.x), int(bounds.y), int(bounds.w), int(bounds.h))
 
+    # with native=True plain strings are laid out by text.layout(), which
+    # spaces words by the font's space advance and returns the layout extent
+    if native and isinstance(text, str) and "[" not in text and word_spacing == 1:
+        layout = picovector.text.layout(image.font, text, bounds.w, size, line_spacing)
+        old_clip = image.clip
+        image.clip = bounds
+        image.text_layout(layout, bounds.x, bounds.y)
+        image.clip = old_clip
+        return rect(0, 0, bounds.x + layout.width, bounds.y + layout.height)
+
     if isinstance(text, str):
         tokens = text_tokenise(image, text, size=size)
     else:
@@ -247,6 +264,14 @@ class SpriteSheet:
     def sprite(self, x, y):
         return self.sprites[x][y]
 
+    # source rectangle of a sprite within the sheet, for use with
+    # image.blit_many() or a SpriteBatch
+    def source(self, x, y):
+        return (self.sw * x, self.sh * y, self.sw, self.sh)
+
+    def batch(self, capacity=64):
+        return SpriteBatch(self, capacity)
+
     def animation(self, x=0, y=0, count=None, horizontal=True):
         if not count:
             count = int(self.image.width / self.sw)
@@ -275,6 +300,108 @@ class AnimatedSprite:
         return len(self.frames)
 
 
+# collects sprites from a sheet and draws them all with a single call to
+# image.blit_many(), avoiding a window image and a blit() per sprite
+class SpriteBatch:
+    def __init__(self, spritesheet, capacity=64):
+        self.spritesheet = spritesheet
+        self.capacity = capacity
+        self.entries = array.array("h", bytes(capacity * 7 * 2))
+        self.count = 0
+
+    def add(self, x, y, dx, dy, flip=0):
+        if self.count == self.capacity:
+            raise ValueError("sprite batch is full")
+        o = self.count * 7
+        e = self.entries
+        sheet = self.spritesheet
+        e[o] = sheet.sw * x
+        e[o + 1] = sheet.sh * y
+        e[o + 2] = sheet.sw
+        e[o + 3] = sheet.sh
+        e[o + 4] = int(dx)
+        e[o + 5] = int(dy)
+        e[o + 6] = flip
+        self.count += 1
+
+    def clear(self):
+        self.count = 0
+
+    def draw(self, target=None):
+        target = target or screen
+        target.blit_many(self.spritesheet.image, memoryview(self.entries)[:self.count * 7], True)
+
+
+# packs the icons of a set of app directories into one image, persisted as a
+# pre-decoded .pvi under /state so that later loads are a single file read
+# rather than a png decode per icon. the atlas is rebuilt whenever the list
+# of directories or the size or modification time of any icon changes
+class IconAtlas:
+    COLUMNS = 8
+
+    def __init__(self, root, names, icon="icon.png", cache="/state/icons"):
+        key = []
+        for name in names:
+            stat = os.stat(f"{root}/{name}/{icon}")
+            key.append([name, stat[6], stat[8]])
+
+        self.image = None
+        try:
+            with open(f"{cache}.json", "r") as f:
+                meta = json.loads(f.read())
+            if meta["key"] == key:
+                self.image = image.load(f"{cache}.pvi")
+                cells = meta["cells"]
+        except (OSError, ValueError, KeyError):
+            pass
+
+        if self.image is None:
+            cells = self._build(root, names, icon)
+            self._save(cache, key, cells)
+
+        # each icon is a window onto the atlas, so drawing one blits a
+        # sub-rect of the shared image
+        self.icons = {}
+        for name, (x, y, w, h) in zip(names, cells):
+            self.icons[name] = self.image.window(x, y, w, h)
+
+    def _build(self, root, names, icon):
+        icons = [image.load(f"{root}/{name}/{icon}") for name in names]
+        cw = max([i.width for i in icons] or [1])
+        ch = max([i.height for i in icons] or [1])
+        columns = min(self.COLUMNS, max(len(icons), 1))
+        rows = max((len(icons) + columns - 1) // columns, 1)
+
+        self.image = image(cw * columns, ch * rows)
+        cells = []
+        for i, sprite in enumerate(icons):
+            x, y = (i % columns) * cw, (i // columns) * ch
+            self.image.blit(sprite, vec2(x, y))
+            cells.append([x, y, sprite.width, sprite.height])
+        return cells
+
+    def _save(self, cache, key, cells):
+        # flash writes stall psram, as in State.save()
+        display.wait()
+        try:
+            os.stat("/state")
+        except OSError:
+            os.mkdir("/state")
+        try:
+            with open(f"{cache}.pvi", "wb") as f:
+                # see modules/c/picovector/micropython/image_pvi.cpp
+                f.write(struct.pack("<4sBBBBHHHH", b"pvi!", 1, image.RGBA8888, 0, 0, self.image.width, self.image.height, 0, 0))
+                f.write(self.image)
+            with open(f"{cache}.json", "w") as f:
+                f.write(json.dumps({"key": key, "cells": cells}))
+        except OSError:
+            # a read only filesystem just means building it every time
+            pass
+
+    def icon(self, name):
+        return self.icons[name]
+
+
 # show the current free memory including the delta since last time the
 # function was called, optionally include a custom message
 _lf = None
@@ -295,6 +422,67 @@ def free(message=""):
     _lf = f
 
 
+# per frame allocation counts, see track_allocs()
+_track_allocs = False
+_frame_allocs = None
+
+
+def track_allocs(enable=True):
+    """Count what each frame of run() allocates.
+
+    With tracking on frame_allocs() returns picovector.alloc_stats() for the
+    last complete frame: allocations, frees and bytes for each kind of
+    object plus the gc collections the frame triggered and how long they
+    took.
+    """
+    global _track_allocs, _frame_allocs
+    _track_allocs = enable
+    _frame_allocs = None
+    picovector.alloc_stats(True)
+
+
+def frame_allocs():
+    return _frame_allocs
+
+
+# per frame profile, see track_profile()
+_track_profile = False
+_profile_overlay = False
+_frame_profile = None
+
+
+def track_profile(enable=True, overlay=False):
+    """Time picovector's expensive calls for each frame of run().
+
+    With profiling on frame_profile() returns picovector.profile() for the
+    last complete frame: calls, pixels and microseconds for render, glyph,
+    blit, filter, png, clear and present. overlay draws them over the top
+    left of every frame.
+    """
+    global _track_profile, _profile_overlay, _frame_profile
+    _track_profile = enable
+    _profile_overlay = enable and overlay
+    _frame_profile = None
+    picovector.profile(True)
+
+
+def frame_profile():
+    return _frame_profile
+
+
+def _draw_profile(stats):
+    pen, font = screen.pen, screen.font
+    names = [k for k in stats if stats[k][0]]
+    screen.pen = color.rgb(0, 0, 0, 180)
+    screen.rectangle(0, 0, 100, len(names) * 9 + 2)
+    screen.font = DEFAULT_FONT
+    screen.pen = color.rgb(255, 255, 255)
+    for i, k in enumerate(names):
+        calls, _pixels, us = stats[k]
+        screen.text(f"{k} {calls} {us / 1000:.1f}ms", 2, i * 9)
+    screen.pen, screen.font = pen, font
+
+
 def woken_by_button():
     return powman.get_wake_reason() in (
         powman.WAKE_BUTTON_A,
@@ -316,7 +504,9 @@ def woken_by_reset():
 
 
 def sleep():
-    display.set_backlight(0)
+    # sleep-in keeps the panel configured and showing its last frame so the
+    # next boot can skip the reset and clear
+    display.sleep()
     powman.sleep()
 
 
@@ -356,9 +546,10 @@ def sample_adc_u16(adc, samples=1):
 def get_battery_level():
     # Use the battery voltage to estimate the remaining percentage
 
-    # Get the average reading over 20 samples from our VBAT and VREF
-    voltage = sample_adc_u16(VBAT_SENSE, 10) * conversion_factor * 2
-    vref = sample_adc_u16(SENSE_1V1, 10) * conversion_factor
+    # powman averages VBAT and VREF in the background, reading costs nothing
+    vbat, vref, _ = powman.sense()
+    voltage = vbat * conversion_factor * 2
+    vref = vref * conversion_factor
     voltage = voltage / vref * 1.1
 
     # Return the battery level as a percentage
@@ -392,6 +583,9 @@ class State:
 
     @staticmethod
     def save(app, data):
+        # flash writes stall psram, don't pull a double buffered frame out
+        # from under the display
+        display.wait()
         try:
             with open("/state/{}.json".format(app), "w") as f:
                 f.write(json.dumps(data))
@@ -427,7 +621,7 @@ class State:
 
 
 def mode(mode, force=False):
-    global _current_mode
+    global _current_mode, _screens
 
     if mode == _current_mode and not force:
         return False
@@ -435,17 +629,176 @@ def mode(mode, force=False):
     _current_mode = mode
 
     # TODO: Mutate the existing screen object?
-    font = getattr(getattr(builtins, "screen", None), "font", None)
-    brush = getattr(getattr(builtins, "screen", None), "pen", None)
-    resolution = (320, 240) if mode == HIRES else (160, 120)
-    builtins.screen = image(*resolution, memoryview(display))
+    previous = getattr(builtins, "screen", None)
+    font = getattr(previous, "font", None)
+    brush = getattr(previous, "pen", None)
+    resolution = (320, 240) if mode & HIRES else (160, 120)
+    # RGB565 halves the framebuffer bandwidth and is sent to the display as-is,
+    # PAL8 quarters it and is expanded through the palette as it's sent
+    indexed = bool(mode & PAL8)
+    pixel_format = image.RGB565 if mode & RGB565 and not indexed else image.RGBA8888
+    display.source(None)
+    if indexed:
+        display.pixel_format(st7789.PAL8)
+    else:
+        display.pixel_format(st7789.RGB565 if mode & RGB565 else st7789.RGBA8888)
+
+    framebuffer = memoryview(display)
+    if mode & DOUBLE_BUFFER:
+        # RGB565 and PAL8 frames are small enough for both to live in the sram
+        # framebuffer, otherwise the back buffer comes from the psram heap
+        size = resolution[0] * resolution[1] * (1 if indexed else 2 if mode & RGB565 else 4)
+        back = bytearray(size) if pixel_format == image.RGBA8888 and not indexed else framebuffer[size:size * 2]
+        _screens = (image(*resolution, framebuffer, pixel_format, indexed), image(*resolution, back, pixel_format, indexed))
+    else:
+        _screens = (image(*resolution, framebuffer, pixel_format, indexed),)
+
+    if indexed:
+        # carry the palette over from an indexed screen, otherwise start with
+        # the default colours in the first sixteen entries
+        if getattr(previous, "has_palette", False):
+            palette = previous.raw_palette
+        else:
+            palette = None
+            for i, c in enumerate(_DEFAULT_PALETTE):
+                _screens[0].palette(i, c)
+        for s in _screens:
+            if palette is not None:
+                s.raw_palette[:] = palette
+            elif s is not _screens[0]:
+                s.raw_palette[:] = _screens[0].raw_palette
+
+    builtins.screen = _screens[0]
     screen.font = font if font is not None else DEFAULT_FONT
     screen.pen = brush if brush is not None else BG
 
     return True
 
 
-def run(update, init=None, on_exit=None, auto_clear=True):
+def present(wait=False):
+    """Send the screen to the display.
+
+    With DOUBLE_BUFFER the frame is scanned out while the next one is drawn
+    into the other buffer, which then becomes `screen`.
+    """
+    current = screen
+    current.flush()
+    display.source(current)
+    if current.has_palette:
+        # palette changes (cycling and the like) take effect with this frame
+        display.palette(current.raw_palette)
+    if wait:
+        display.update(current.width == 320)
+    else:
+        display.update_async(current.width == 320)
+
+    if len(_screens) > 1:
+        builtins.screen = _screens[1] if current is _screens[0] else _screens[0]
+        screen.font = current.font
+        screen.pen = current.pen
+        screen.alpha = current.alpha
+        screen.antialias = current.antialias
+        screen.clip = current.clip
+        screen.deferred = current.deferred
+        screen.multicore = current.multicore
+        if current.has_palette:
+            screen.raw_palette[:] = current.raw_palette
+
+
+# set by frame_unchanged(), cleared as each frame of run() starts
+_unchanged = False
+
+
+def frame_unchanged():
+    """Tell run() this frame looks the same as the last.
+
+    The frame isn't presented, the display keeps what it's showing and
+    nothing is sent to it. Mostly useful with auto_clear=False or when the
+    update drew nothing at all.
+    """
+    global _unchanged
+    _unchanged = True
+
+
+# power governor for run(), see set_power_save(). the clock steps between
+# these fractions of the boot clock
+_FULL_FREQ = machine.freq()
+_FREQS = (_FULL_FREQ, _FULL_FREQ // 2, _FULL_FREQ // 4)
+_power_save = True
+_freq_level = 0
+_quiet_frames = 0
+
+# frames with headroom before the clock steps down, stepping up is immediate
+_GOVERNOR_FRAMES = 30
+# how long an unchanged frame without an fps sleeps waiting for input, ms
+_IDLE_WAIT_MS = 20
+
+
+def set_power_save(enable=True):
+    """Let run() slow the clock when frames don't need it.
+
+    With an fps the clock drops while frames finish well inside their
+    budget and comes straight back up when they don't. Without one, frames
+    that call frame_unchanged() sleep until a button is pressed (or 20ms)
+    and a run of them drops to the lowest clock until something changes.
+    PWM frequencies (case lights, tones) scale with the clock, apps that
+    depend on them can turn this off.
+    """
+    global _power_save
+    _power_save = enable
+    if not enable:
+        _set_freq_level(0)
+
+
+def _set_freq_level(level):
+    global _freq_level, _quiet_frames
+    _quiet_frames = 0
+    if level == _freq_level:
+        return
+    # nothing may be reading psram for the display while the clock moves,
+    # machine.freq() retimes flash and psram and st7789 re-derives its pio
+    # divider from clk_sys as the next frame is sent
+    display.wait()
+    machine.freq(_FREQS[level])
+    _freq_level = level
+
+
+def _govern_load(busy_us, period_us):
+    global _quiet_frames
+    load = busy_us / period_us
+    if load > 0.8 and _freq_level > 0:
+        _set_freq_level(_freq_level - 1)
+    elif load < 0.3 and _freq_level < len(_FREQS) - 1:
+        # would still use under 60% of the frame at half the clock
+        _quiet_frames += 1
+        if _quiet_frames >= _GOVERNOR_FRAMES:
+            _set_freq_level(_freq_level + 1)
+    else:
+        _quiet_frames = 0
+
+
+def _govern_idle(unchanged):
+    global _quiet_frames
+    if not unchanged:
+        if _freq_level:
+            _set_freq_level(0)
+        _quiet_frames = 0
+        return
+    _quiet_frames += 1
+    if _quiet_frames >= _GOVERNOR_FRAMES and _freq_level < len(_FREQS) - 1:
+        _set_freq_level(len(_FREQS) - 1)
+    io.wait(_IDLE_WAIT_MS)
+
+
+def run(update, init=None, on_exit=None, auto_clear=True, fps=None, timestep=None):
+    """Call update() once a frame until it returns something other than None.
+
+    fps limits the frame rate, the core sleeps rather than spins between
+    frames. timestep fixes io.ticks to advance that many ms each frame
+    regardless of how long frames take, otherwise it follows the clock.
+    The clock is slowed while frames leave it idle, see set_power_save().
+    """
+    global _frame_allocs, _frame_profile, _unchanged
     screen.font = DEFAULT_FONT
     screen.pen = BG
     screen.clear()
@@ -456,16 +809,37 @@ def run(update, init=None, on_exit=None, auto_clear=True):
             gc.collect()
         try:
             while True:
+                if fps:
+                    busy_us = display.pace(fps)
+                    if _power_save:
+                        _govern_load(busy_us, 1000000 / fps)
+                elif _power_save:
+                    _govern_idle(_unchanged)
+                if _track_allocs:
+                    _frame_allocs = picovector.alloc_stats(True)
+                if _track_profile:
+                    _frame_profile = picovector.profile(True)
+                _unchanged = False
+                io.poll(timestep)
+                # the previous frame is pushed to the display by core1 while
+                # we poll input, wait for it to finish before drawing again
+                # (unless double buffered, then present() waits instead)
+                if len(_screens) == 1:
+                    display.wait()
                 if auto_clear:
                     screen.pen = BG
                     screen.clear()
                     screen.pen = FG
-                io.poll()
                 if (result := update()) is not None:
+                    display.wait()
                     gc.collect()
                     return result
-                display.update(screen.width == 320)
+                if not _unchanged:
+                    if _profile_overlay and _frame_profile:
+                        _draw_profile(_frame_profile)
+                    present()
         finally:
+            _set_freq_level(0)
             if on_exit:
                 on_exit()
                 gc.collect()
@@ -582,16 +956,16 @@ def fatal_error(title, error):
         error = get_exception(error)
     print(f"- ERROR: {error}")
 
-    if _current_mode == LORES:
+    if not _current_mode & HIRES:
         contents = image(160, 120)
         contents.blit(screen, vec2(0, 0))
-        mode(HIRES)
+        mode(HIRES | (_current_mode & RGB565))
         screen.blit(contents, rect(0, 0, 320, 240))
         del contents
 
     message(title, error)
 
-    display.update(screen.width == 320)
+    present(True)
     while True:
         io.poll()
         if io.pressed:
@@ -623,11 +997,20 @@ def load_font(font_file):
 
 
 class ROMFonts:
+    # romfs fonts are mapped straight from flash, each is loaded once and
+    # the same font handed out after that
+    def __init__(self):
+        self._fonts = {}
+
     def __getattr__(self, key):
-        try:
-            return pixel_font.load(f"/rom/fonts/{key}.ppf")
-        except OSError as e:
-            raise AttributeError(f"Font {key} not found!") from e
+        f = self._fonts.get(key)
+        if f is None:
+            try:
+                f = pixel_font.load(f"/rom/fonts/{key}.ppf")
+            except OSError as e:
+                raise AttributeError(f"Font {key} not found!") from e
+            self._fonts[key] = f
+        return f
 
     def __dir__(self):
         return [f[:-4] for f in os.listdir("/rom/fonts") if f.endswith(".ppf")]
@@ -645,8 +1028,6 @@ elif rtc.datetime()[0] >= 2025:
     rtc_to_localtime()
 
 
-display = st7789.ST7789()
-
 # Import PicoSystem module constants to builtins,
 # so they are available globally.
 for k, v in picovector.__dict__.items():
@@ -655,23 +1036,54 @@ for k, v in picovector.__dict__.items():
 
 
 ASSETS = "/system/assets"
-LIGHT_SENSOR = machine.ADC(machine.Pin("LIGHT_SENSE"))
 DEFAULT_FONT = rom_font.sins
-ERROR_FONT = rom_font.desert
 
 FG = color.rgb(255, 255, 255)
 BG = color.rgb(20, 40, 60)
 
-VBAT_SENSE = machine.ADC(machine.Pin.board.VBAT_SENSE)
 VBUS_DETECT = machine.Pin.board.VBUS_DETECT
 CHARGE_STAT = machine.Pin.board.CHARGE_STAT
-SENSE_1V1 = machine.ADC(machine.Pin.board.SENSE_1V1)
+
+# made on first use as bw.VBAT_SENSE and so on rather than while every app
+# starts up. get_light() and get_battery_level() read powman.sense() instead,
+# call powman.sense_stop() before reading these yourself
+_LAZY = {
+    "LIGHT_SENSOR": lambda: machine.ADC(machine.Pin("LIGHT_SENSE")),
+    "VBAT_SENSE": lambda: machine.ADC(machine.Pin.board.VBAT_SENSE),
+    "SENSE_1V1": lambda: machine.ADC(machine.Pin.board.SENSE_1V1),
+    "ERROR_FONT": lambda: rom_font.desert,
+}
+
+
+def __getattr__(name):
+    make = _LAZY.get(name)
+    if make is None:
+        raise AttributeError(name)
+    value = make()
+    globals()[name] = value
+    return value
+
 
 BAT_MAX = 4.10
 BAT_MIN = 3.00
 
 HIRES = 1
 LORES = 0
+# flag, combine with HIRES or LORES for a 16-bit screen without alpha
+RGB565 = 2
+# flag, draw into one buffer while the other is being sent to the display
+DOUBLE_BUFFER = 4
+# flag, 8-bit indexed screen using screen.palette(i, color), overrides RGB565
+PAL8 = 8
+
+_DEFAULT_PALETTE = (
+    color.black, color.grape, color.navy, color.grey,
+    color.brown, color.green, color.red, color.taupe,
+    color.blue, color.orange, color.smoke, color.lime,
+    color.latte, color.cyan, color.yellow, color.white
+)
+
+_screens = ()
 
 conversion_factor = 3.3 / 65536
 
@@ -681,16 +1093,17 @@ mode(LORES, True)
 
 
 # Build in some badgeware helpers, so we don't have to "bw.lores" etc
-for k in ("mode", "HIRES", "LORES", "SpriteSheet", "load_font", "rom_font", "text_tokenise", "text_draw", "clamp", "rnd", "frnd"):
+for k in ("mode", "present", "HIRES", "LORES", "RGB565", "DOUBLE_BUFFER", "PAL8", "SpriteSheet", "load_font", "rom_font", "text_tokenise", "text_draw", "clamp", "rnd", "frnd"):
     setattr(builtins, k, locals()[k])  # noqa: B010
 
 
 # Temporary shim to keep "pen()" working
-def _pen(*args):
-    if len(args) in (3, 4):
-        screen.pen = color.rgb(*args)
+# (no *args, the tuple would be allocated on every call)
+def _pen(r, g=None, b=None, a=255):
+    if b is not None:
+        screen.pen = color.rgb(r, g, b, a)
     else:
-        screen.pen = args[0]
+        screen.pen = r
 
 
 builtins.pen = _pen
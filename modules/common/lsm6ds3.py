@@ -5,6 +5,14 @@ CTRL1_XL = const(0x10)
 CTRL10_C = const(0x19)
 CTRL3_C = const(0x12)
 
+# FIFO
+FIFO_CTRL1 = const(0x06)
+FIFO_CTRL2 = const(0x07)
+FIFO_CTRL3 = const(0x08)
+FIFO_CTRL5 = const(0x0A)
+FIFO_STATUS1 = const(0x3A)
+FIFO_DATA_OUT_L = const(0x3E)
+
 # This is the start of the data registers for the Gyro and Accelerometer
 # There are 12 Bytes in total starting at 0x23 and ending at 0x2D
 OUTX_L_G = const(0x22)
@@ -32,6 +40,13 @@ TAP_EN_XYZ = const(0x8E)
 TAP_THRESHOLD = const(0x02)
 DOUBLE_TAP_EN = const(0x80)
 DOUBLE_TAP_DUR = const(0x20)
+BDU_IF_INC = const(0x44)
+FIFO_NO_DECIMATION = const(0x09)
+FIFO_MODE_BYPASS = const(0x00)
+FIFO_MODE_CONTINUOUS = const(0x06)
+
+# one gyro and accel reading, six little endian int16 words
+FIFO_SAMPLE_BYTES = const(12)
 
 
 def twos_comp(val, bits=16):
@@ -77,6 +92,61 @@ class LSM6DS3:
     def _read_reg(self, reg, size):
         return self.bus.readfrom_mem(self.address, reg, size)
 
+    def fifo_start(self, samples=64):
+        """Queue readings in the sensor's FIFO at its output rate.
+
+        read_fifo() then drains them in burst reads, up to samples at a
+        time into a buffer allocated here, instead of polling one reading
+        per frame with get_readings().
+        """
+        self._fifo_buffer = bytearray(samples * FIFO_SAMPLE_BYTES)
+        self._fifo_view = memoryview(self._fifo_buffer)
+        self._fifo_status = bytearray(4)
+
+        # readings mustn't change halfway through a read
+        self.bus.writeto_mem(self.address, CTRL3_C, bytearray([BDU_IF_INC]))
+        self.bus.writeto_mem(self.address, FIFO_CTRL1, bytearray([0]))
+        self.bus.writeto_mem(self.address, FIFO_CTRL2, bytearray([0]))
+        self.bus.writeto_mem(self.address, FIFO_CTRL3, bytearray([FIFO_NO_DECIMATION]))
+        # the FIFO ODR codes match the gyro/accel ones in the top of mode
+        odr = (self.mode >> 4) << 3
+        self.bus.writeto_mem(self.address, FIFO_CTRL5, bytearray([FIFO_MODE_BYPASS]))
+        self.bus.writeto_mem(self.address, FIFO_CTRL5, bytearray([odr | FIFO_MODE_CONTINUOUS]))
+
+    def fifo_stop(self):
+        self.bus.writeto_mem(self.address, FIFO_CTRL5, bytearray([FIFO_MODE_BYPASS]))
+        self._fifo_buffer = self._fifo_view = None
+
+    def read_fifo(self):
+        """Drain what's queued since the last call, oldest first.
+
+        Returns a memoryview of packed readings, FIFO_SAMPLE_BYTES each as
+        little endian int16 gx, gy, gz, ax, ay, az. It's only valid until
+        the next call, ulab's np.frombuffer(view, dtype=np.int16) reads it
+        without copying. When more than fifo_start(samples) are queued the
+        rest wait for the next call.
+        """
+        status = self._fifo_status
+        self.bus.readfrom_mem_into(self.address, FIFO_STATUS1, status)
+        words = status[0] | ((status[1] & 0x0F) << 8)
+        pattern = status[2] | ((status[3] & 0x03) << 8)
+
+        # after an overrun the next word may be from the middle of a
+        # reading, skip to the start of the next one
+        if pattern and words:
+            skip = min(6 - pattern, words)
+            self.bus.readfrom_mem_into(self.address, FIFO_DATA_OUT_L, self._fifo_view[:skip * 2])
+            words -= skip
+
+        n = min(words // 6 * FIFO_SAMPLE_BYTES, len(self._fifo_buffer))
+        if n == 0:
+            return self._fifo_view[:0]
+        # the sensor rolls back to FIFO_DATA_OUT_L after every word, so the
+        # whole lot comes out in one transaction
+        view = self._fifo_view[:n]
+        self.bus.readfrom_mem_into(self.address, FIFO_DATA_OUT_L, view)
+        return view
+
     def get_readings(self):
 
         # Read 12 bytes starting from 0x22. This covers the XYZ data for gyro and accel
@@ -0,0 +1,136 @@
+#!/usr/bin/env python3
+"""
+Converts .af vector fonts to .sdf, picovector's signed distance field font
+format. Each glyph becomes a small bitmap of distances to its outline which
+sdf_font scales to any size, so large text costs a bilinear lookup per pixel
+rather than rasterising the outline.
+
+    python3 tools/af2sdf.py [--field 32] [--spread 4] input.af [output.sdf]
+
+--field is the bitmap resolution in pixels per em and --spread how far, in
+field pixels, distances are recorded either side of the outline. outlines
+and glows drawn from the font can reach out as far as the spread. The
+layout is described at the top of modules/c/picovector/micropython/sdf_font.cpp.
+"""
+
+import argparse
+import math
+import pathlib
+import struct
+import sys
+
+UNITS_PER_EM = 128
+
+
+def read_af(path):
+    """Returns a list of (codepoint, advance, contours) where contours are
+    lists of (x, y) points in font units, y down from the baseline."""
+    data = pathlib.Path(path).read_bytes()
+    if data[:4] != b"af!?":
+        raise ValueError(f"{path} is not an af font")
+
+    flags, glyph_count, path_count, point_count = struct.unpack_from(">HHHH", data, 4)
+    offset = 12
+    glyphs = []
+    for _ in range(glyph_count):
+        codepoint, _, _, _, _, advance, paths = struct.unpack_from(">HbbBBBB", data, offset)
+        glyphs.append([codepoint, advance, paths])
+        offset += 8
+
+    lengths = []
+    for _ in range(path_count):
+        if flags & 0b1:
+            lengths.append(struct.unpack_from(">H", data, offset)[0])
+            offset += 2
+        else:
+            lengths.append(data[offset])
+            offset += 1
+
+    result = []
+    p = 0
+    for codepoint, advance, paths in glyphs:
+        contours = []
+        for _ in range(paths):
+            n = lengths[p]
+            p += 1
+            points = struct.unpack_from(f"{n * 2}b", data, offset)
+            offset += n * 2
+            contours.append([(points[i * 2], points[i * 2 + 1]) for i in range(n)])
+        result.append((codepoint, advance, contours))
+    return result
+
+
+def distance_field(contours, field, spread):
+    """Returns (left, top, width, height, values) for the glyph, where left
+    and top are in field pixels from the glyph origin."""
+    scale = field / UNITS_PER_EM
+    points = [(x * scale, y * scale) for c in contours for x, y in c]
+    if not points:
+        return 0, 0, 0, 0, b""
+
+    left = math.floor(min(p[0] for p in points)) - spread
+    top = math.floor(min(p[1] for p in points)) - spread
+    width = math.ceil(max(p[0] for p in points)) + spread - left
+    height = math.ceil(max(p[1] for p in points)) + spread - top
+
+    segments = []
+    for c in contours:
+        scaled = [(x * scale, y * scale) for x, y in c]
+        for i in range(len(scaled)):
+            segments.append((scaled[i], scaled[(i + 1) % len(scaled)]))
+
+    values = bytearray()
+    for j in range(height):
+        py = top + j + 0.5
+        for i in range(width):
+            px = left + i + 0.5
+            nearest = float("inf")
+            inside = False
+            for (ax, ay), (bx, by) in segments:
+                dx, dy = bx - ax, by - ay
+                length = dx * dx + dy * dy
+                t = 0.0 if length == 0 else max(0.0, min(1.0, ((px - ax) * dx + (py - ay) * dy) / length))
+                ex, ey = ax + dx * t - px, ay + dy * t - py
+                nearest = min(nearest, ex * ex + ey * ey)
+                # even-odd crossing test
+                if (ay > py) != (by > py) and px < ax + (py - ay) * dx / dy:
+                    inside = not inside
+            d = math.sqrt(nearest) * (1 if inside else -1)
+            values.append(max(0, min(255, round(128 + d / spread * 127))))
+    return left, top, width, height, bytes(values)
+
+
+def convert(path, field, spread):
+    glyphs = sorted(read_af(path))
+    table = b""
+    bitmaps = b""
+    for codepoint, advance, contours in glyphs:
+        left, top, width, height, values = distance_field(contours, field, spread)
+        if width > 255 or height > 255:
+            raise ValueError(f"glyph {codepoint} is too large for the field size")
+        table += struct.pack("<HHbbBBI", codepoint, advance, left, top, width, height, len(bitmaps))
+        bitmaps += values
+
+    header = struct.pack("<4sBBHHBB", b"sdf!", 1, 0, len(glyphs), UNITS_PER_EM, field, spread)
+    return header + table + bitmaps
+
+
+def main():
+    parser = argparse.ArgumentParser(description="Convert an af font to picovector's signed distance field .sdf format")
+    parser.add_argument("--field", type=int, default=32, help="distance field pixels per em, 32 by default")
+    parser.add_argument("--spread", type=int, default=4, help="field pixels recorded either side of the outline, 4 by default")
+    parser.add_argument("input", type=pathlib.Path)
+    parser.add_argument("output", type=pathlib.Path, nargs="?")
+    args = parser.parse_args()
+
+    output = args.output or args.input.with_suffix(".sdf")
+    try:
+        output.write_bytes(convert(args.input, args.field, args.spread))
+    except ValueError as e:
+        print(e, file=sys.stderr)
+        return 1
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
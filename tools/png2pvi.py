@@ -0,0 +1,206 @@
+#!/usr/bin/env python3
+"""
+Converts PNGs to .pvi, picovector's pre-decoded image format, which
+image.load() can use straight from romfs without decoding or copying.
+
+    python3 tools/png2pvi.py [--format FORMAT] input.png [output.pvi]
+
+FORMAT is rgba8888, rgb565, rgba4444, a8 or indexed. Paletted PNGs default
+to indexed and everything else to rgba8888. a8 keeps only alpha, or the grey
+level of an opaque grayscale PNG. The layout is described at the
+top of modules/c/picovector/micropython/image_pvi.cpp.
+"""
+
+import argparse
+import pathlib
+import struct
+import sys
+import zlib
+
+RGBA8888 = 1
+RGBA4444 = 2
+RGB565 = 3
+A8 = 4
+
+FORMATS = {"rgba8888": RGBA8888, "rgba4444": RGBA4444, "rgb565": RGB565, "a8": A8, "indexed": RGBA8888}
+
+TRANSPARENCY_OPAQUE = 1
+TRANSPARENCY_BINARY_ALPHA = 2
+TRANSPARENCY_TRANSLUCENT = 3
+
+
+def read_png(path):
+    """Returns (width, height, pixels, palette, grey) where pixels is a list
+    of rows of (r, g, b, a) tuples, or of palette indices when palette is a
+    list of (r, g, b, a) entries. grey is set for opaque grayscale pngs."""
+    data = pathlib.Path(path).read_bytes()
+    if data[:8] != b"\x89PNG\r\n\x1a\n":
+        raise ValueError(f"{path} is not a png")
+
+    chunks = {}
+    idat = b""
+    offset = 8
+    while offset < len(data):
+        length, kind = struct.unpack(">I4s", data[offset:offset + 8])
+        body = data[offset + 8:offset + 8 + length]
+        if kind == b"IDAT":
+            idat += body
+        else:
+            chunks[kind] = body
+        offset += length + 12
+
+    width, height, depth, colour, _, _, interlace = struct.unpack(">IIBBBBB", chunks[b"IHDR"])
+    if interlace:
+        raise ValueError(f"{path} is interlaced, which isn't supported")
+
+    channels = {0: 1, 2: 3, 3: 1, 4: 2, 6: 4}[colour]
+    bits = depth * channels
+    stride = (width * bits + 7) // 8
+    step = max(1, bits // 8)
+
+    raw = zlib.decompress(idat)
+    rows = []
+    prior = bytearray(stride)
+    for y in range(height):
+        start = y * (stride + 1)
+        kind = raw[start]
+        line = bytearray(raw[start + 1:start + 1 + stride])
+        for i in range(stride):
+            a = line[i - step] if i >= step else 0
+            b = prior[i]
+            c = prior[i - step] if i >= step else 0
+            if kind == 1:
+                line[i] = (line[i] + a) & 0xff
+            elif kind == 2:
+                line[i] = (line[i] + b) & 0xff
+            elif kind == 3:
+                line[i] = (line[i] + (a + b) // 2) & 0xff
+            elif kind == 4:
+                p = a + b - c
+                pa, pb, pc = abs(p - a), abs(p - b), abs(p - c)
+                pred = a if pa <= pb and pa <= pc else (b if pb <= pc else c)
+                line[i] = (line[i] + pred) & 0xff
+        rows.append(line)
+        prior = line
+
+    def samples(line):
+        if depth == 8:
+            return list(line)
+        if depth == 16:
+            return [line[i] for i in range(0, len(line), 2)]
+        out = []
+        mask = (1 << depth) - 1
+        for byte in line:
+            for shift in range(8 - depth, -1, -depth):
+                out.append((byte >> shift) & mask)
+        return out
+
+    trns = chunks.get(b"tRNS", b"")
+    palette = None
+    if colour == 3:
+        plte = chunks[b"PLTE"]
+        palette = []
+        for i in range(len(plte) // 3):
+            a = trns[i] if i < len(trns) else 255
+            palette.append((plte[i * 3], plte[i * 3 + 1], plte[i * 3 + 2], a))
+
+    scale = 255 // ((1 << min(depth, 8)) - 1)
+    key = None
+    if trns and colour in (0, 2) and depth <= 8:
+        key = tuple(struct.unpack(">HHH", trns[:6])) if colour == 2 else (struct.unpack(">H", trns[:2])[0],)
+    pixels = []
+    for line in rows:
+        s = samples(line)[:width * channels]
+        if colour == 3:
+            pixels.append(s)
+            continue
+        row = []
+        for x in range(width):
+            v = s[x * channels:(x + 1) * channels]
+            if colour == 0:
+                g = v[0] * scale
+                row.append((g, g, g, 0 if tuple(v) == key else 255))
+            elif colour == 4:
+                row.append((v[0], v[0], v[0], v[1]))
+            elif colour == 2:
+                row.append((v[0], v[1], v[2], 0 if tuple(v) == key else 255))
+            else:
+                row.append(tuple(v))
+        pixels.append(row)
+
+    return width, height, pixels, palette, colour == 0 and key is None
+
+
+def premul(r, g, b, a):
+    # matches picovector's rgb_color_t, red in the low byte
+    return (r * a // 255) | ((g * a // 255) << 8) | ((b * a // 255) << 16) | (a << 24)
+
+
+def transparency(alphas):
+    alphas = set(alphas)
+    if alphas <= {255}:
+        return TRANSPARENCY_OPAQUE
+    if alphas <= {0, 255}:
+        return TRANSPARENCY_BINARY_ALPHA
+    return TRANSPARENCY_TRANSLUCENT
+
+
+def convert(path, fmt=None):
+    width, height, pixels, palette, grey = read_png(path)
+    if fmt is None:
+        fmt = "indexed" if palette else "rgba8888"
+
+    if fmt == "indexed":
+        if not palette:
+            raise ValueError(f"{path} has no palette, it can't be stored as indexed")
+        used = {i for row in pixels for i in row}
+        table = b"".join(struct.pack("<I", premul(*c)) for c in palette)
+        data = b"".join(bytes(row) for row in pixels)
+        flags = 1
+        alphas = [palette[i][3] if i < len(palette) else 0 for i in used]
+    else:
+        if palette:
+            pixels = [[palette[i] for i in row] for row in pixels]
+        table = b""
+        flags = 0
+        alphas = [p[3] for row in pixels for p in row]
+        out = bytearray()
+        for row in pixels:
+            for r, g, b, a in row:
+                c = premul(r, g, b, a)
+                if fmt == "rgba8888":
+                    out += struct.pack("<I", c)
+                elif fmt == "a8":
+                    out.append(r if grey else a)
+                elif fmt == "rgb565":
+                    out += struct.pack("<H", ((c & 0xf8) << 8) | ((c & 0xfc00) >> 5) | ((c & 0xf80000) >> 19))
+                else:
+                    out += struct.pack("<H", ((c & 0xf0) << 8) | ((c & 0xf000) >> 4) | ((c & 0xf00000) >> 16) | (c >> 28))
+        data = bytes(out)
+
+    # rgb565 has no alpha, whatever the png held
+    if fmt == "a8" and grey:
+        alphas = [p[0] for row in pixels for p in row]
+    clarity = TRANSPARENCY_OPAQUE if fmt == "rgb565" else transparency(alphas)
+    header = struct.pack("<4sBBBBHHHH", b"pvi!", 1, FORMATS[fmt], flags, clarity, width, height, len(table) // 4, 0)
+    return header + table + data
+
+
+def main():
+    parser = argparse.ArgumentParser(description="Convert a png to picovector's pre-decoded .pvi format")
+    parser.add_argument("--format", choices=sorted(FORMATS), help="pixel format to store, by default indexed for paletted pngs and rgba8888 otherwise")
+    parser.add_argument("input", type=pathlib.Path)
+    parser.add_argument("output", type=pathlib.Path, nargs="?")
+    args = parser.parse_args()
+
+    output = args.output or args.input.with_suffix(".pvi")
+    try:
+        output.write_bytes(convert(args.input, args.format))
+    except ValueError as e:
+        print(e, file=sys.stderr)
+        return 1
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
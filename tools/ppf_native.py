@@ -0,0 +1,65 @@
+#!/usr/bin/env python3
+"""
+Rewrites .ppf pixel fonts with their glyph table in pixel_font_t's own
+layout, so pixel_font.load() can use a font in romfs or the built in assets
+straight from flash without copying any of it to the heap.
+
+    python3 tools/ppf_native.py input.ppf [output.ppf]
+
+The header gains flag 0b10 and two bytes of padding, taking it to 48 bytes.
+Each glyph becomes a little endian (u32 codepoint, u16 width, u16 0) record.
+The glyph bitmaps follow unchanged. Fonts that are already native are left
+as they are. See modules/c/picovector/micropython/pixel_font.cpp.
+"""
+
+import argparse
+import pathlib
+import struct
+import sys
+
+PPF_NATIVE = 0b10
+HEADER = ">4sHIHH32s"
+
+
+def convert(data):
+    marker, flags, count, width, height, name = struct.unpack_from(HEADER, data)
+    if marker != b"ppf!":
+        raise ValueError("not a ppf font")
+    if flags & PPF_NATIVE:
+        return data
+
+    offset = struct.calcsize(HEADER)
+    table = b""
+    previous = -1
+    for i in range(count):
+        codepoint, advance = struct.unpack_from(">IH", data, offset + i * 6)
+        if codepoint <= previous or advance > width:
+            raise ValueError("glyph table is out of order or has glyphs wider than the font")
+        previous = codepoint
+        table += struct.pack("<IHH", codepoint, advance, 0)
+
+    bitmaps = data[offset + count * 6:]
+    if len(bitmaps) != count * ((width + 7) // 8) * height:
+        raise ValueError("glyph bitmaps are truncated")
+
+    header = struct.pack(HEADER, marker, flags | PPF_NATIVE, count, width, height, name) + b"\0\0"
+    return header + table + bitmaps
+
+
+def main():
+    parser = argparse.ArgumentParser(description="Convert a ppf font to the native layout picovector can use in place")
+    parser.add_argument("input", type=pathlib.Path)
+    parser.add_argument("output", type=pathlib.Path, nargs="?")
+    args = parser.parse_args()
+
+    output = args.output or args.input
+    try:
+        output.write_bytes(convert(args.input.read_bytes()))
+    except ValueError as e:
+        print(f"{args.input}: {e}", file=sys.stderr)
+        return 1
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())